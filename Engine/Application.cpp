@@ -1,99 +1,636 @@
 #include "Application.h"
 
+#include <algorithm>
+#include <sstream>
+
+namespace
+{
+	// Copies a software rendered frame to the window with GDI. The buffer is kept between frames to hold the BGRA copy.
+	void PresentToWindow(HWND hwnd, const std::vector<uint32_t>& color, uint width, uint height, std::vector<uint32_t>& buffer)
+	{
+		// GDI wants BGRA, so swap red and blue.
+		buffer.resize(color.size());
+		for (size_t i = 0; i < color.size(); ++i)
+		{
+			uint32_t pixel = color[i];
+			buffer[i] = (pixel & 0xFF00FF00u) | ((pixel & 0x00FF0000u) >> 16) | ((pixel & 0x000000FFu) << 16);
+		}
+
+		BITMAPINFO bitmapInfo;
+		ZeroMemory(&bitmapInfo, sizeof(bitmapInfo));
+		bitmapInfo.bmiHeader.biSize = sizeof(BITMAPINFOHEADER);
+		bitmapInfo.bmiHeader.biWidth = (LONG)width;
+		bitmapInfo.bmiHeader.biHeight = -(LONG)height; // Negative height means the rows are stored top-down.
+		bitmapInfo.bmiHeader.biPlanes = 1;
+		bitmapInfo.bmiHeader.biBitCount = 32;
+		bitmapInfo.bmiHeader.biCompression = BI_RGB;
+
+		HDC deviceContext = GetDC(hwnd);
+		SetDIBitsToDevice(deviceContext, 0, 0, width, height, 0, 0, 0, height, buffer.data(), &bitmapInfo, DIB_RGB_COLORS);
+		ReleaseDC(hwnd, deviceContext);
+	}
+}
 
 Application::Application(uint screenWidth, uint screenHeight, HWND hwnd, Input* input)
-	: _direct3D(D3D::InitParams{ hwnd, screenWidth, screenHeight, SCREEN_NEAR, SCREEN_DEPTH, VSYNC_ENABLED, FULL_SCREEN })
+	: _frameLoop(_clock, FrameLoop::Desc{ UPDATE_RATE, FRAME_RATE_LIMIT })
 	, _input(input)
+	, _screenWidth(screenWidth)
+	, _screenHeight(screenHeight)
+	, _startTime(std::chrono::steady_clock::now())
 {
+	// Create the render backend that draws every frame.
+	if (SOFTWARE_RENDERER)
+	{
+		SoftwareRenderer::InitParams initParams{ screenWidth, screenHeight, SCREEN_NEAR, SCREEN_DEPTH };
+		initParams.present = [hwnd, buffer = std::vector<uint32_t>()](const std::vector<uint32_t>& color, uint width, uint height) mutable
+		{
+			PresentToWindow(hwnd, color, width, height, buffer);
+		};
+		_renderer = std::make_unique<SoftwareRenderer>(initParams);
+	}
+	else
+	{
+		D3D::InitParams initParams{ hwnd, screenWidth, screenHeight, SCREEN_NEAR, SCREEN_DEPTH, VSYNC_ENABLED, FULL_SCREEN };
+		_renderer = std::make_unique<D3D>(initParams);
+	}
+
+	// Time the frame on the GPU too, where the backend has one.
+	_gpuProfiler = std::make_unique<GpuProfiler>(_renderer->GetGpuTimer());
+
 	// Set the initial position of the camera.
 	_camera.SetPosition(-0.0f, -0.0f, -15.0f);
-	_camera.SetRotation(-30.0f, 30.0f, -53.0f);
+	_cameraRotation = { -30.0f, 30.0f, -53.0f };
+	_lastCameraRotation = _cameraRotation;
+	_camera.SetRotation(_cameraRotation.x, _cameraRotation.y, _cameraRotation.z);
+
+	auto loadStart = std::chrono::steady_clock::now();
+
+	// Map the packed assets when an archive has been built, otherwise fall back to the loose files.
+	_assets = std::make_unique<AssetArchive>(ASSET_ARCHIVE);
+	const AssetArchive* archive = _assets->IsValid() ? _assets.get() : nullptr;
+
+	std::string textureFilename = archive ? MODEL_TEXTURE : std::string(ASSET_DIRECTORY) + MODEL_TEXTURE;
+
+	// Create the model's texture. When streaming it is a placeholder until a worker has decoded it.
+	std::shared_ptr<Texture> texture;
+	if (STREAM_TEXTURES)
+	{
+		_streamer = std::make_unique<TextureStreamer>(GetDevice(*_renderer), archive);
+		texture = _streamer->Request(textureFilename.c_str(), TEXTURE_COMPRESSION);
+	}
+	else
+	{
+		texture = std::make_shared<Texture>(GetDevice(*_renderer), textureFilename.c_str(), TEXTURE_COMPRESSION, archive);
+	}
+
+	// Create and initialize the model object, from the cooked mesh when there is one.
+	if (*MODEL_MESH)
+	{
+		std::unique_ptr<MeshFile> meshFile;
+		if (archive)
+		{
+			AssetArchive::Asset asset = archive->Find(MODEL_MESH);
+			meshFile = std::make_unique<MeshFile>(asset.data, asset.size);
+		}
+		else
+		{
+			meshFile = std::make_unique<MeshFile>((std::string(ASSET_DIRECTORY) + MODEL_MESH).c_str());
+		}
+
+		MeshData mesh;
+		if (!meshFile->IsValid() || !meshFile->Decode(mesh))
+			throw std::runtime_error(std::format("Failed to load the mesh {}", MODEL_MESH));
+		_model = std::make_unique<Model>(*_renderer, mesh);
+	}
+	else
+	{
+		_model = std::make_unique<Model>(*_renderer);
+	}
+
+	// Lay out a grid of scaled-down copies of the model under one root, covering the area the grid model alone used to.
+	// Each copy is moved so the corner of its bounds, which is the grid model's origin, lies on its cell's corner.
+	const Bounds& modelBounds = _model->GetBounds();
+	const float gridSize = 10.0f;
+	const float modelSize = 2.0f * (modelBounds.extents.x > modelBounds.extents.y ? modelBounds.extents.x : modelBounds.extents.y);
+	const float spacing = gridSize / SCENE_GRID_SIZE;
+	const float scale = modelSize > 0.0f ? spacing * 0.8f / modelSize : 1.0f;
+	Math::Matrix4 modelOffset = Math::Translation(modelBounds.extents.x - modelBounds.center.x,
+		modelBounds.extents.y - modelBounds.center.y, -modelBounds.center.z);
+
+	_sceneRoot = _scene.Create(Scene::INVALID_NODE, Math::Identity());
+	for (uint row = 0u; row < SCENE_GRID_SIZE; ++row)
+	{
+		for (uint column = 0u; column < SCENE_GRID_SIZE; ++column)
+		{
+			Math::Matrix4 localMatrix = Math::Multiply(Math::Multiply(modelOffset, Math::Scaling(scale, scale, scale)),
+				Math::Translation(column * spacing, row * spacing, 0.0f));
+			_objects.push_back(_scene.Create(_sceneRoot, localMatrix));
+		}
+	}
+
+	// Create the terrain from its heightmap, centred under the grid with its highest point just behind the objects.
+	if (*TERRAIN_HEIGHTMAP)
+	{
+		std::unique_ptr<Heightmap> heightmap;
+		if (archive)
+		{
+			AssetArchive::Asset asset = archive->Find(TERRAIN_HEIGHTMAP);
+			heightmap = std::make_unique<Heightmap>(asset.data, asset.size);
+		}
+		else
+		{
+			heightmap = std::make_unique<Heightmap>((std::string(ASSET_DIRECTORY) + TERRAIN_HEIGHTMAP).c_str());
+		}
+
+		if (!heightmap->IsValid())
+			throw std::runtime_error(std::format("Failed to load the heightmap {}", TERRAIN_HEIGHTMAP));
 
-	const char* textureFilename = "../Engine/data/sidewalk.tga";
+		Terrain::Desc terrainDesc;
+		terrainDesc.cellSize = TERRAIN_CELL_SIZE;
+		terrainDesc.heightScale = TERRAIN_HEIGHT_SCALE;
+		terrainDesc.maxPixelError = TERRAIN_PIXEL_ERROR;
+		_terrain = std::make_unique<Terrain>(*_renderer, std::move(*heightmap), terrainDesc);
 
-	// Create and initialize the model object.
-	_model = std::make_unique<Model>(_direct3D.GetDevice(), _direct3D.GetDeviceContext(), "../Engine/data/sidewalk.tga");
+		// Terrain x stays x, terrain z becomes y and terrain up becomes -z, towards the camera.
+		const Bounds& terrainBounds = _terrain->GetBounds();
+		_terrainOffset = Math::Float3(gridSize * 0.5f - terrainBounds.center.x, gridSize * 0.5f - terrainBounds.center.z, 1.0f + TERRAIN_HEIGHT_SCALE);
+		_terrainWorldMatrix = Math::Multiply(Math::Rotation(Math::RotationAxis(Math::Float3(1.0f, 0.0f, 0.0f), -Math::PI * 0.5f)),
+			Math::Translation(_terrainOffset.x, _terrainOffset.y, _terrainOffset.z));
+		const Terrain::Stats& terrainStats = _terrain->GetStats();
+		std::cout << std::format("Terrain quadtree of {} levels and {} chunks built in {:.2f} ms", terrainStats.levels, terrainStats.nodes,
+			terrainStats.buildMilliseconds) << std::endl;
+	}
+
+	// Build the hierarchy the objects are culled and picked with.
+	_scene.Update();
+	for (Scene::Node object : _objects)
+		_objectBounds.push_back(_model->GetBounds().Transform(_scene.GetWorldMatrix(object)));
+	_bvh.Build(_objectBounds);
+
+	// Create the software depth buffer the nearest objects are rasterized into to hide the ones behind them.
+	if (OCCLUSION_CULLING)
+	{
+		const std::vector<Model::VertexType>& vertices = _model->GetVertices();
+		const std::vector<uint>& indices = _model->GetIndices();
+		_occluderMesh = OcclusionCuller::Mesh(vertices.data(), (uint)vertices.size(), sizeof(Model::VertexType), indices.data(), (uint)indices.size());
+		_occlusionCuller = std::make_unique<OcclusionCuller>();
+	}
+
+	// Report the load time; the first run after a reboot measures a cold file cache, later runs a warm one.
+	double loadMilliseconds = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - loadStart).count();
+	std::cout << std::format("{} assets from {} in {:.2f} ms", STREAM_TEXTURES ? "Requested" : "Loaded",
+		archive ? ASSET_ARCHIVE : ASSET_DIRECTORY, loadMilliseconds) << std::endl;
+
+	auto shaderStart = std::chrono::steady_clock::now();
+	_shaderCache = std::make_unique<ShaderCache>(SHADER_CACHE, D3D::CompileShader);
+
+	// Create the textured shader program and the material the model is drawn with. texture.ps samples its texture from slot 0.
+	ShaderProgram::Desc programDesc;
+	programDesc.vsFilename = "../Engine/texture.vs";
+	programDesc.vsEntryPoint = "TextureVertexShader";
+	programDesc.psFilename = "../Engine/texture.ps";
+	programDesc.psEntryPoint = "TexturePixelShader";
+	programDesc.vertexFormat = &Model::GetVertexFormat();
+	_textureProgram = std::make_shared<ShaderProgram>(*_renderer, *_shaderCache, programDesc);
+
+	// The same vertex shader reading each object's world matrix and texture offset from the instance stream, so the
+	// whole grid is drawn with one call.
+	ShaderProgram::Desc instancedProgramDesc = programDesc;
+	instancedProgramDesc.vsFilename = "../Engine/textureInstanced.vs";
+	instancedProgramDesc.vsEntryPoint = "TextureInstancedVertexShader";
+	instancedProgramDesc.instanceFormat = &InstanceBuffer::GetFormat();
+	_instancedTextureProgram = std::make_shared<ShaderProgram>(*_renderer, *_shaderCache, instancedProgramDesc);
 
-	// Create and initialize the color shader object.
-	_colorShader = std::make_unique<ColorShader>(_direct3D.GetDevice(), hwnd);
+	_material = std::make_unique<Material>(_textureProgram);
+	_material->SetInstancedProgram(_instancedTextureProgram);
+	_material->SetTexture(0u, std::move(texture));
 
-	_textureShader = std::make_unique<TextureShader>(_direct3D.GetDevice(), hwnd);
+	// Create the ring every draw's constants are written into, and the buffer instanced draws read their instances from.
+	_constants = std::make_unique<ConstantBufferRing>(*_renderer);
+	_instances = std::make_unique<InstanceBuffer>(*_renderer);
+
+	// Keep whatever had to be compiled for the next launch, and report how much compiling the cache spared.
+	if (!_shaderCache->Save())
+		std::cout << std::format("Could not write the shader cache {}", SHADER_CACHE) << std::endl;
+
+	const ShaderCache::Stats& shaderStats = _shaderCache->GetStats();
+	double shaderMilliseconds = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - shaderStart).count();
+	std::cout << std::format("Shaders created in {:.2f} ms: {} cache hits, {} misses ({:.0f}% hit rate), {:.2f} ms compiling, {:.2f} ms saved",
+		shaderMilliseconds, shaderStats.hits, shaderStats.misses, shaderStats.GetHitRate() * 100.0, shaderStats.compileMilliseconds,
+		shaderStats.savedMilliseconds) << std::endl;
+}
+
+Application::~Application()
+{
+	// The reports still being written are the last ones; let them finish.
+	JobSystem::GetDefault().Wait(_logWriting);
 }
 
-bool Application::Render()
+bool Application::Render(const FrameLoop::Frame& frameStep)
 {
-	DirectX::XMMATRIX worldMatrix, viewMatrix, projectionMatrix;
-	bool result;
+	PROFILE_SCOPE("Application::Render");
+	Math::Matrix4 viewMatrix, projectionMatrix;
 
-	// Clear the buffers to begin the scene.
-	_direct3D.BeginScene(0.0f, 0.0f, 0.0f, 1.0f);
+	// Draw the simulation between its last two steps, as far as the frame loop says the time since the last step goes.
+	const float t = frameStep.interpolation;
+	_camera.SetRotation(_lastCameraRotation.x + (_cameraRotation.x - _lastCameraRotation.x) * t,
+		_lastCameraRotation.y + (_cameraRotation.y - _lastCameraRotation.y) * t,
+		_lastCameraRotation.z + (_cameraRotation.z - _lastCameraRotation.z) * t);
+	const float sceneAngle = _lastSceneAngle + (_sceneAngle - _lastSceneAngle) * t;
 
 	// Generate the view matrix based on the camera's position.
 	_camera.Render();
 
-	// Get the world, view, and projection matrices from the camera and d3d objects.
-	_direct3D.GetWorldMatrix(worldMatrix);
+	// Get the view and projection matrices from the camera and d3d objects.
 	_camera.GetViewMatrix(viewMatrix);
-	_direct3D.GetProjectionMatrix(projectionMatrix);
+	_renderer->GetProjectionMatrix(projectionMatrix);
 
-	// Put the model vertex and index buffers on the graphics pipeline to prepare them for drawing.
-	_model->Render(_direct3D.GetDeviceContext());
+	// Fill in the constants every shader shares for the frame. Time is the simulation's, at the state drawn.
+	PerFrameConstants frame = {};
+	frame.time = frameStep.time > 0.0 ? (float)(frameStep.time - (1.0 - t) * frameStep.stepSeconds) : 0.0f;
+	frame.frameTime = (float)frameStep.frameSeconds;
 
-	// Render the model using the color shader.
-	result = _textureShader->Render(_direct3D.GetDeviceContext(), _model->GetIndexCount(), worldMatrix, viewMatrix, projectionMatrix, _model->GetTexture());
-	if (!result)
-		return false;
+	// Turn the grid about its centre; only the root is touched, and Update carries it down to every object.
+	{
+		PROFILE_SCOPE("Scene update");
+		const float center = 5.0f;
+		Math::Matrix4 rootMatrix = Math::Translation(-center, -center, 0.0f);
+		rootMatrix = Math::Multiply(rootMatrix, Math::Rotation(Math::RotationAxis(Math::Float3(0.0f, 0.0f, 1.0f), sceneAngle)));
+		rootMatrix = Math::Multiply(rootMatrix, Math::Translation(center, center, 0.0f));
+		_scene.SetLocalMatrix(_sceneRoot, rootMatrix);
+		_scene.Update();
+		_sceneUpdateSum += _scene.GetStats().updateMilliseconds;
+	}
 
-	// Present the rendered scene to the screen.
-	_direct3D.EndScene();
+	// Start rasterizing the occluders before anything else, so the jobs run while this thread uploads textures, runs
+	// its own jobs, reads the GPU's timings, clears, moves the bounds and frustum culls. They cannot start any earlier,
+	// under the previous frame's Present: the view is only known once the frame loop says how far to interpolate, and
+	// occluders from the last view would hide what has moved since.
+	if (_occlusionCuller)
+		StartOcclusion(viewMatrix, projectionMatrix);
 
-	return true;
-}
+	// Run the jobs that have to run on this thread, such as work on the immediate context.
+	JobSystem::GetDefault().RunMainThreadJobs();
 
-bool Application::Frame()
-{
-	if (_input->IsKeyDown(VK_DOWN))
+	// Release the constant memory of the frames the GPU has finished.
+	_constants->BeginFrame();
+
+	// Upload the textures that finished streaming since the last frame.
+	if (_streamer)
 	{
-		auto rotation = _camera.GetRotation();
-		rotation.x += 1.0f;
-		_camera.SetRotation(rotation.x, rotation.y, rotation.z);
-		std::cout << rotation.x << " " << rotation.y << " " << rotation.z << std::endl;
+		_streamer->Update();
+		if (!_streamingReported && _streamer->IsIdle())
+		{
+			double milliseconds = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - _startTime).count();
+			Log(std::format("All textures streamed in {:.2f} ms after startup\n", milliseconds));
+			_streamingReported = true;
+		}
 	}
-	if (_input->IsKeyDown(VK_UP))
+
+	// Clear the buffers to begin the scene, reading the GPU times of the frames it has finished first.
+	_gpuProfiler->BeginFrame();
 	{
-		auto rotation = _camera.GetRotation();
-		rotation.x -= 1.0f;
-		_camera.SetRotation(rotation.x, rotation.y, rotation.z);
-		std::cout << rotation.x << " " << rotation.y << " " << rotation.z << std::endl;
+		PROFILE_GPU_SCOPE(*_gpuProfiler, "Clear");
+		_renderer->BeginScene(0.0f, 0.0f, 0.0f, 1.0f);
 	}
-	if (_input->IsKeyDown(VK_RIGHT))
+
+	// Move the bounds with the objects, then keep the objects inside the view frustum.
+	UpdateBounds();
+
 	{
-		auto rotation = _camera.GetRotation();
-		rotation.y += 1.0f;
-		_camera.SetRotation(rotation.x, rotation.y, rotation.z);
-		std::cout << rotation.x << " " << rotation.y << " " << rotation.z << std::endl;
+		PROFILE_SCOPE("Frustum culling");
+		auto cullStart = std::chrono::steady_clock::now();
+		_visibleObjects.clear();
+		_bvh.QueryFrustum(Frustum(Math::Multiply(viewMatrix, projectionMatrix)), _visibleObjects);
+		_cullSum += std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - cullStart).count();
+		_culledSum += (uint)(_objects.size() - _visibleObjects.size());
 	}
-	if (_input->IsKeyDown(VK_LEFT))
+
+	// Then drop the ones hidden behind the occluders.
+	if (_occlusionCuller)
 	{
-		auto rotation = _camera.GetRotation();
-		rotation.y -= 1.0f;
-		_camera.SetRotation(rotation.x, rotation.y, rotation.z);
-		std::cout << rotation.x << " " << rotation.y << " " << rotation.z << std::endl;
+		PROFILE_SCOPE("Occlusion culling");
+		_occlusionCuller->Wait();
+		_occlusionCuller->Cull(_objectBounds, _visibleObjects);
+		const OcclusionCuller::Stats& occlusionStats = _occlusionCuller->GetStats();
+		_occlusionRenderSum += occlusionStats.renderMilliseconds;
+		_occlusionTestSum += occlusionStats.testMilliseconds;
+		_occlusionTestedSum += occlusionStats.tested;
+		_occludedSum += occlusionStats.occluded;
 	}
-	if (_input->IsKeyDown(VK_RETURN))
+
+	// Queue every visible object and draw them grouped by program and material, instancing the copies of the model.
 	{
-		auto rotation = _camera.GetRotation();
-		rotation.z += 0.1f;
-		_camera.SetRotation(rotation.x, rotation.y, rotation.z);
-		std::cout << rotation.x << " " << rotation.y << " " << rotation.z << std::endl;
+		PROFILE_SCOPE("Draw submission");
+		auto submitStart = std::chrono::steady_clock::now();
+		_drawList.Clear();
+		for (uint index : _visibleObjects)
+			_drawList.Add(*_material, *_model, _scene.GetWorldMatrix(_objects[index]));
+
+		// Queue the terrain chunks chosen for this view.
+		if (_terrain)
+		{
+			UpdateTerrain(viewMatrix, projectionMatrix);
+			for (const Terrain::Chunk& chunk : _terrain->GetVisibleChunks())
+				_drawList.Add(*_material, *chunk.model, _terrainWorldMatrix);
+		}
+		{
+			PROFILE_GPU_SCOPE(*_gpuProfiler, "Draws");
+			_drawList.Execute(*_renderer, *_constants, *_instances, frame, viewMatrix, projectionMatrix);
+		}
+		_submitTimeSum += std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - submitStart).count();
 	}
-	if (_input->IsKeyDown(VK_SPACE))
+
+	// Fence the frame's constants before presenting.
+	_constants->EndFrame();
+	const DrawList::Stats& drawStats = _drawList.GetStats();
+	_drawSum += drawStats.draws;
+	_drawCallSum += drawStats.drawCalls;
+	_instancedDrawCallSum += drawStats.instancedDrawCalls;
+	_constantMapSum += _constants->GetStats().mapsThisFrame;
+	_sortSum += drawStats.sortMilliseconds;
+	_recordSum += drawStats.recordMilliseconds;
+	_recorderSum += drawStats.recorders;
+	_stateChangeSum += drawStats.programChanges + drawStats.materialChanges + drawStats.meshChanges;
+	if (StateCache* stateCache = GetStateCache(*_renderer))
 	{
-		auto rotation = _camera.GetRotation();
-		rotation.z -= 0.1f;
-		_camera.SetRotation(rotation.x, rotation.y, rotation.z);
-		std::cout << rotation.x << " " << rotation.y << " " << rotation.z << std::endl;
+		_bindSum += stateCache->GetStats().bindsThisFrame;
+		_skippedBindSum += stateCache->GetStats().skippedThisFrame;
 	}
-	return Render();
+
+	// Present the rendered scene to the screen. The GPU frame ends before it, so what Present waits for shows as the
+	// CPU's Present scope running past the GPU frame.
+	_gpuProfiler->EndFrame();
+	{
+		PROFILE_SCOPE("Present");
+		_renderer->EndScene();
+	}
+
+	ReportFrameTime();
+
+	return true;
+}
+
+void Application::UpdateBounds()
+{
+	PROFILE_SCOPE("Application::UpdateBounds");
+	auto start = std::chrono::steady_clock::now();
+
+	// Only objects whose world matrix changed need new bounds; the scene does not say which, so every object is moved.
+	// The objects are independent, so they are shared out on the job system; the tree is updated on this thread.
+	const uint objectCount = (uint)_objects.size();
+	JobSystem::GetDefault().ParallelFor((objectCount + BOUNDS_PER_TASK - 1u) / BOUNDS_PER_TASK, 0u, [&](uint task)
+	{
+		uint end = objectCount - task * BOUNDS_PER_TASK > BOUNDS_PER_TASK ? (task + 1u) * BOUNDS_PER_TASK : objectCount;
+		for (uint i = task * BOUNDS_PER_TASK; i < end; ++i)
+			_objectBounds[i] = _model->GetBounds().Transform(_scene.GetWorldMatrix(_objects[i]));
+	});
+	for (uint i = 0u; i < objectCount; ++i)
+		_bvh.SetBounds(i, _objectBounds[i]);
+
+	// Refitting keeps the tree shape, which suits objects moving together; rebuild once it no longer fits them.
+	_bvh.Refit();
+	if (_bvh.GetCost() > _bvh.GetBuildCost() * BVH_REBUILD_RATIO)
+	{
+		_bvh.Build(_objectBounds);
+		_rebuildCount++;
+	}
+
+	_boundsSum += std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+}
+
+void Application::StartOcclusion(const Math::Matrix4& viewMatrix, const Math::Matrix4& projectionMatrix)
+{
+	PROFILE_SCOPE("Application::StartOcclusion");
+
+	// The nearest objects hide the most. They are picked by last frame's bounds, which is close enough for occluders.
+	Math::Float3 camera = _camera.GetPosition();
+	auto distance = [&](uint object)
+	{
+		const Math::Float3& center = _objectBounds[object].center;
+		Math::Float3 offset(center.x - camera.x, center.y - camera.y, center.z - camera.z);
+		return Math::Dot(offset, offset);
+	};
+
+	_occluders.resize(_objects.size());
+	for (uint i = 0u; i < (uint)_occluders.size(); ++i)
+		_occluders[i] = i;
+	uint occluderCount = OCCLUDER_COUNT < (uint)_occluders.size() ? OCCLUDER_COUNT : (uint)_occluders.size();
+	std::partial_sort(_occluders.begin(), _occluders.begin() + occluderCount, _occluders.end(),
+		[&](uint a, uint b) { return distance(a) < distance(b); });
+
+	_occlusionCuller->BeginFrame(Math::Multiply(viewMatrix, projectionMatrix));
+	for (uint i = 0u; i < occluderCount; ++i)
+		_occlusionCuller->AddOccluder(_occluderMesh, _scene.GetWorldMatrix(_objects[_occluders[i]]));
+	_occlusionCuller->Render();
+}
+
+void Application::UpdateTerrain(const Math::Matrix4& viewMatrix, const Math::Matrix4& projectionMatrix)
+{
+	PROFILE_SCOPE("Application::UpdateTerrain");
+
+	// Take the camera into terrain space by undoing _terrainWorldMatrix: the translation, then the turn about x.
+	Math::Float3 camera = _camera.GetPosition();
+	camera = Math::Float3(camera.x - _terrainOffset.x, camera.y - _terrainOffset.y, camera.z - _terrainOffset.z);
+
+	// Chunks are chosen and culled in terrain space, with the projection the renderer draws with, a quarter turn high.
+	Frustum frustum(Math::Multiply(Math::Multiply(_terrainWorldMatrix, viewMatrix), projectionMatrix));
+	Terrain::View view;
+	view.position = Math::Float3(camera.x, -camera.z, camera.y);
+	// The projection's y scale is 1 / tan(fovY / 2), so it gives the pixels a unit size covers at unit distance.
+	view.projectionScale = projectionMatrix.m[1][1] * _screenHeight * 0.5f;
+	view.frustum = &frustum;
+	_terrain->Update(view);
+
+	const Terrain::Stats& stats = _terrain->GetStats();
+	_terrainSelectSum += stats.selectMilliseconds;
+	_terrainChunkSum += stats.chunks;
+	_terrainTriangleSum += stats.triangles;
+	_terrainMissingSum += stats.missing;
+	_terrainLoadSum += stats.loadedThisFrame;
+	_terrainEvictSum += stats.evictedThisFrame;
+}
+
+void Application::Pick(int x, int y)
+{
+	Math::Matrix4 viewMatrix;
+	_camera.GetViewMatrix(viewMatrix);
+	Math::Matrix4 projectionMatrix;
+	_renderer->GetProjectionMatrix(projectionMatrix);
+
+	// Cast the ray under the cursor against the object bounds.
+	Ray ray = Ray::FromScreen((float)x, (float)y, (float)_screenWidth, (float)_screenHeight, viewMatrix, projectionMatrix);
+	Bvh::Hit hit;
+	if (_bvh.Raycast(ray, hit))
+		std::cout << std::format("Picked object {} at distance {:.2f}", hit.item, hit.distance) << std::endl;
+	else
+		std::cout << "Picked nothing" << std::endl;
+}
+
+void Application::Log(std::string text)
+{
+	// One write per report, so reports queued close together do not interleave their lines.
+	JobSystem::GetDefault().RunInBackground([text = std::move(text)] { std::cout << text << std::flush; }, &_logWriting);
+}
+
+void Application::ReportFrameTime()
+{
+	auto now = std::chrono::steady_clock::now();
+
+	// Time to the first frame shows how long loading blocks startup; after that, the worst frame of each
+	// interval shows the hitches that loading or uploads cause.
+	if (_frameCount == 0u)
+	{
+		double milliseconds = std::chrono::duration<double, std::milli>(now - _startTime).count();
+		Log(std::format("First frame presented {:.2f} ms after startup\n", milliseconds));
+	}
+	else
+	{
+		double frameTime = std::chrono::duration<double, std::milli>(now - _lastFrameTime).count();
+		_frameTimeSum += frameTime;
+		if (frameTime > _worstFrameTime)
+			_worstFrameTime = frameTime;
+
+		if (_frameCount % FRAME_REPORT_INTERVAL == 0u)
+		{
+			// Format the report here, where the counters are, and leave the profiler's table and the console to a job.
+			std::ostringstream report;
+			report << std::format("Frame time over {} frames: average {:.2f} ms, worst {:.2f} ms",
+				FRAME_REPORT_INTERVAL, _frameTimeSum / FRAME_REPORT_INTERVAL, _worstFrameTime) << std::endl;
+
+			// Draw submission rate and how often the constant ring had to be mapped for it.
+			double drawsPerSecond = _submitTimeSum > 0.0 ? _drawSum * 1000.0 / _submitTimeSum : 0.0;
+			report << std::format("Submitted {:.0f} draws/s, {:.2f} constant maps per frame ({})", drawsPerSecond,
+				(double)_constantMapSum / FRAME_REPORT_INTERVAL, _constants->UsesOffsets() ? "ring offsets" : "discard per draw") << std::endl;
+			report << std::format("Draw calls: {:.1f} per frame for {:.1f} objects, {:.1f} of them instanced", (double)_drawCallSum / FRAME_REPORT_INTERVAL,
+				(double)_drawSum / FRAME_REPORT_INTERVAL, (double)_instancedDrawCallSum / FRAME_REPORT_INTERVAL) << std::endl;
+			report << std::format("Draw sorting: average {:.3f} ms, {:.1f} state changes, {:.1f} bindings and {:.1f} redundant ones skipped per frame",
+				_sortSum / FRAME_REPORT_INTERVAL, (double)_stateChangeSum / FRAME_REPORT_INTERVAL, (double)_bindSum / FRAME_REPORT_INTERVAL,
+				(double)_skippedBindSum / FRAME_REPORT_INTERVAL) << std::endl;
+			report << std::format("Draw recording: average {:.3f} ms on {:.1f} recorders ({} available)", _recordSum / FRAME_REPORT_INTERVAL,
+				(double)_recorderSum / FRAME_REPORT_INTERVAL, _renderer->GetRecorderCount()) << std::endl;
+			report << std::format("Scene update of {} nodes: average {:.3f} ms", _scene.GetNodeCount(),
+				_sceneUpdateSum / FRAME_REPORT_INTERVAL) << std::endl;
+			report << std::format("Bounding volume hierarchy: refit average {:.3f} ms, {} rebuilds, cost {:.2f} (built at {:.2f})",
+				_boundsSum / FRAME_REPORT_INTERVAL, _rebuildCount, _bvh.GetCost(), _bvh.GetBuildCost()) << std::endl;
+			report << std::format("Frustum culling: {:.1f} of {} objects culled per frame, average {:.3f} ms",
+				(double)_culledSum / FRAME_REPORT_INTERVAL, _objects.size(), _cullSum / FRAME_REPORT_INTERVAL) << std::endl;
+			if (_occlusionCuller)
+			{
+				report << std::format("Occlusion culling: {:.1f} of {:.1f} objects culled per frame, average {:.3f} ms rasterizing on jobs, {:.3f} ms testing",
+					(double)_occludedSum / FRAME_REPORT_INTERVAL, (double)_occlusionTestedSum / FRAME_REPORT_INTERVAL,
+					_occlusionRenderSum / FRAME_REPORT_INTERVAL, _occlusionTestSum / FRAME_REPORT_INTERVAL) << std::endl;
+			}
+			if (_terrain)
+			{
+				report << std::format("Terrain: {:.1f} chunks and {:.0f} triangles per frame, {:.1f} drawn coarser while loading, selection average {:.3f} ms",
+					(double)_terrainChunkSum / FRAME_REPORT_INTERVAL, (double)_terrainTriangleSum / FRAME_REPORT_INTERVAL,
+					(double)_terrainMissingSum / FRAME_REPORT_INTERVAL, _terrainSelectSum / FRAME_REPORT_INTERVAL) << std::endl;
+				report << std::format("Terrain streaming: {} chunks loaded, {} released, {} resident", _terrainLoadSum, _terrainEvictSum,
+					_terrain->GetStats().resident) << std::endl;
+			}
+
+			// How evenly frames came, and how the frame loop waited for the limit.
+			const FrameTimeHistogram& frameTimes = _frameLoop.GetFrameTimes();
+			const FrameLoop::Stats& loopStats = _frameLoop.GetStats();
+			double waited = loopStats.sleepMilliseconds + loopStats.spinMilliseconds;
+			report << std::format("Frame pacing: p50 {:.1f} ms, p90 {:.1f} ms, p99 {:.1f} ms, {:.2f} steps per frame, {} steps dropped, {} frames late, {:.0f}% of waiting slept",
+				frameTimes.GetPercentileMilliseconds(0.5), frameTimes.GetPercentileMilliseconds(0.9), frameTimes.GetPercentileMilliseconds(0.99),
+				(double)loopStats.steps / loopStats.frames, loopStats.droppedSteps, loopStats.lateFrames,
+				waited > 0.0 ? loopStats.sleepMilliseconds * 100.0 / waited : 0.0) << std::endl;
+			_frameLoop.ResetStats();
+
+			// Where the frame time went, scope by scope, over the profiler's window. GPU scopes are on the GPU track.
+			const GpuProfiler::Stats& gpuStats = _gpuProfiler->GetStats();
+			if (gpuStats.resolved > 0u)
+			{
+				report << std::format("GPU timing: {} frames read {} frames after they were issued, {} skipped, {} disjoint",
+					gpuStats.resolved, gpuStats.latency, gpuStats.skipped, gpuStats.disjoint) << std::endl;
+			}
+			std::vector<Profiler::ScopeStats> scopes = Profiler::Get().GetStats();
+			JobSystem::GetDefault().RunInBackground([text = report.str(), scopes = std::move(scopes)]
+			{
+				std::ostringstream summary;
+				Profiler::WriteSummary(scopes, summary);
+				std::cout << text << summary.str() << std::flush;
+			}, &_logWriting);
+			_frameTimeSum = 0.0;
+			_worstFrameTime = 0.0;
+			_submitTimeSum = 0.0;
+			_drawSum = 0u;
+			_drawCallSum = 0u;
+			_instancedDrawCallSum = 0u;
+			_constantMapSum = 0u;
+			_sortSum = 0.0;
+			_recordSum = 0.0;
+			_recorderSum = 0u;
+			_stateChangeSum = 0u;
+			_bindSum = 0u;
+			_skippedBindSum = 0u;
+			_sceneUpdateSum = 0.0;
+			_boundsSum = 0.0;
+			_cullSum = 0.0;
+			_culledSum = 0u;
+			_rebuildCount = 0u;
+			_occlusionRenderSum = 0.0;
+			_occlusionTestSum = 0.0;
+			_occlusionTestedSum = 0u;
+			_occludedSum = 0u;
+			_terrainSelectSum = 0.0;
+			_terrainChunkSum = 0u;
+			_terrainTriangleSum = 0u;
+			_terrainMissingSum = 0u;
+			_terrainLoadSum = 0u;
+			_terrainEvictSum = 0u;
+		}
+	}
+
+	_lastFrameTime = now;
+	_frameCount++;
+}
+
+void Application::Update(float seconds)
+{
+	PROFILE_SCOPE("Application::Update");
+
+	// Keep the state before the step for frames drawn between it and the next.
+	_lastCameraRotation = _cameraRotation;
+	_lastSceneAngle = _sceneAngle;
+
+	// Turn the camera while the keys are held, at the same speed whatever the frame rate.
+	const float turn = CAMERA_TURN_SPEED * seconds;
+	const float roll = CAMERA_ROLL_SPEED * seconds;
+	if (_input->IsKeyDown(VK_DOWN))
+		_cameraRotation.x += turn;
+	if (_input->IsKeyDown(VK_UP))
+		_cameraRotation.x -= turn;
+	if (_input->IsKeyDown(VK_RIGHT))
+		_cameraRotation.y += turn;
+	if (_input->IsKeyDown(VK_LEFT))
+		_cameraRotation.y -= turn;
+	if (_input->IsKeyDown(VK_RETURN))
+		_cameraRotation.z += roll;
+	if (_input->IsKeyDown(VK_SPACE))
+		_cameraRotation.z -= roll;
+
+	_sceneAngle += SCENE_ROTATION_SPEED * seconds;
+}
+
+bool Application::Frame()
+{
+	// Run the simulation steps the time since the last frame holds.
+	FrameLoop::Frame frameStep = _frameLoop.BeginFrame();
+	for (uint step = 0u; step < frameStep.steps; ++step)
+		Update(frameStep.stepSeconds);
+
+	// Report what is under the cursor when the window is clicked.
+	int clickX, clickY;
+	if (_input->TakeClick(clickX, clickY))
+		Pick(clickX, clickY);
+
+	// Draw, then wait for the frame rate limit.
+	bool result = Render(frameStep);
+	_frameLoop.EndFrame();
+	return result;
 }
 
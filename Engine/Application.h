@@ -1,16 +1,59 @@
 #pragma once
 
 #include "Common.h"
+
+#include <chrono>
 #include "D3D.h"
+#include "SoftwareRenderer.h"
 
 #include "Camera.h"
+#include "EngineMath.h"
 #include "Model.h"
-#include "ColorShader.h"
-#include "TextureShader.h"
+#include "MeshFile.h"
+#include "ShaderProgram.h"
+#include "Material.h"
+#include "DrawList.h"
+#include "Scene.h"
+#include "Bvh.h"
+#include "ConstantBufferRing.h"
+#include "InstanceBuffer.h"
 #include "Input.h"
+#include "AssetArchive.h"
+#include "TextureStreamer.h"
+#include "ShaderCache.h"
+#include "JobSystem.h"
+#include "Terrain.h"
+#include "OcclusionCuller.h"
+#include "Profiler.h"
+#include "GpuProfiler.h"
+#include "FrameLoop.h"
 
 const bool FULL_SCREEN = false;
 const bool VSYNC_ENABLED = true;
+const bool SOFTWARE_RENDERER = false; // Draw with the CPU rasterizer instead of Direct3D, for machines without a GPU.
+const Texture::Compression TEXTURE_COMPRESSION = Texture::Compression::BC1; // Block compression for TGA textures, encoded as they load; BC7 is too slow for that, so cook it offline with "Engine.exe -cook-texture".
+const bool STREAM_TEXTURES = true; // Load textures in background jobs and draw a placeholder until they arrive.
+const double UPDATE_RATE = 60.0; // Fixed simulation steps per second, whatever the frame rate.
+const double FRAME_RATE_LIMIT = 240.0; // Frames per second the frame loop sleeps down to, so frames without vsync do not spin a core; 0 for no limit.
+const float CAMERA_TURN_SPEED = 60.0f; // Degrees per second the arrow keys turn the camera.
+const float CAMERA_ROLL_SPEED = 6.0f; // Degrees per second return and space roll the camera.
+const uint FRAME_REPORT_INTERVAL = 600u; // Frames between reports of the average and worst frame time.
+const char* const PROFILE_TRACE = "../Engine/profile.json"; // Chrome trace of the last frames' profiled scopes, written on exit for chrome://tracing or ui.perfetto.dev; empty for none.
+const char* const ASSET_DIRECTORY = "../Engine/data/"; // Loose asset files, used when no archive has been packed.
+const char* const ASSET_ARCHIVE = "../Engine/data.pak"; // Built from ASSET_DIRECTORY with "Engine.exe -pack".
+const char* const MODEL_TEXTURE = "sidewalk.tga"; // TGA, or DDS cooked with "Engine.exe -cook-texture", in ASSET_DIRECTORY or the archive.
+const char* const MODEL_MESH = ""; // Mesh cooked with "Engine.exe -cook-mesh", in ASSET_DIRECTORY or the archive, drawn instead of the built-in grid; empty for the grid.
+const char* const TERRAIN_HEIGHTMAP = ""; // Greyscale TGA in ASSET_DIRECTORY or the archive, drawn as terrain beneath the grid; empty for none.
+const float TERRAIN_CELL_SIZE = 0.1f; // Distance between neighbouring heights of the terrain.
+const float TERRAIN_HEIGHT_SCALE = 2.0f; // Height of the terrain's highest sample.
+const float TERRAIN_PIXEL_ERROR = 2.0f; // Screen space error, in pixels, above which terrain chunks are refined.
+const char* const SHADER_CACHE = "../Engine/shaders.cache"; // Compiled shader bytecode, rebuilt for any shader whose source changed.
+const uint SCENE_GRID_SIZE = 8u; // Objects per side of the grid the scene is made of.
+const float SCENE_ROTATION_SPEED = 0.2f; // Radians per second the whole grid turns about its centre.
+const float BVH_REBUILD_RATIO = 1.5f; // Rebuild the hierarchy once refitting has made queries this much more expensive than after a build.
+const uint BOUNDS_PER_TASK = 1024u; // Objects whose bounds one job moves; fewer objects are moved on the main thread.
+const bool OCCLUSION_CULLING = true; // Test objects against a software depth buffer of the objects nearest the camera before drawing them.
+const uint OCCLUDER_COUNT = 16u; // Objects nearest the camera rasterized as occluders.
 const float SCREEN_DEPTH = 1000.0f;
 const float SCREEN_NEAR = 0.3f;
 
@@ -19,18 +62,95 @@ class Application
 public:
 	
 	Application(uint screenWidth, uint screenHeight, HWND hwnd, Input* input);
+	~Application();
 
 	bool Frame();
 
 private:
 
-	bool Render();
+	void Update(float seconds);
+	bool Render(const FrameLoop::Frame& frameStep);
+	void UpdateBounds();
+	void StartOcclusion(const Math::Matrix4& viewMatrix, const Math::Matrix4& projectionMatrix);
+	void UpdateTerrain(const Math::Matrix4& viewMatrix, const Math::Matrix4& projectionMatrix);
+	void Pick(int x, int y);
+	void ReportFrameTime();
+	void Log(std::string text);
+
+	SystemClock _clock;
+	FrameLoop _frameLoop; // Declared after _clock, which it paces frames with.
+
+	// The simulation's state after the last two steps; frames draw between them.
+	Math::Float3 _cameraRotation;
+	Math::Float3 _lastCameraRotation;
+	float _sceneAngle = 0.0f;
+	float _lastSceneAngle = 0.0f;
 
-	D3D _direct3D;
+	std::unique_ptr<RenderBackend> _renderer;
+	std::unique_ptr<GpuProfiler> _gpuProfiler;
 	Input* _input = nullptr;
+	uint _screenWidth = 0u;
+	uint _screenHeight = 0u;
+	std::unique_ptr<AssetArchive> _assets;
+	std::unique_ptr<TextureStreamer> _streamer; // Declared after _assets, which it reads from.
+
+	std::unique_ptr<ShaderCache> _shaderCache;
 
 	Camera _camera;
+	Scene _scene;
+	Scene::Node _sceneRoot = Scene::INVALID_NODE;
+	std::vector<Scene::Node> _objects; // Scene nodes drawn with the model.
+	std::vector<Bounds> _objectBounds; // World space bounds of every object, indexed like _objects.
+	Bvh _bvh; // Over _objectBounds, for culling and picking.
+	std::vector<uint> _visibleObjects; // Indices into _objects of the objects the camera can see.
+	std::unique_ptr<OcclusionCuller> _occlusionCuller;
+	OcclusionCuller::Mesh _occluderMesh; // The model's triangles, rasterized for each occluding object.
+	std::vector<uint> _occluders; // Scratch space of StartOcclusion: objects by distance from the camera.
 	std::unique_ptr<Model> _model;
-	std::unique_ptr<ColorShader> _colorShader;
-	std::unique_ptr<TextureShader> _textureShader;
+	std::shared_ptr<ShaderProgram> _textureProgram;
+	std::shared_ptr<ShaderProgram> _instancedTextureProgram;
+	std::unique_ptr<Material> _material;
+	DrawList _drawList;
+	std::unique_ptr<ConstantBufferRing> _constants;
+	std::unique_ptr<InstanceBuffer> _instances;
+	std::unique_ptr<Terrain> _terrain;
+	Math::Matrix4 _terrainWorldMatrix; // Lays terrain space, y up, under the grid, which is in the xy plane facing -z.
+	Math::Float3 _terrainOffset; // The translation in _terrainWorldMatrix.
+
+	// Startup and frame time measurements.
+	std::chrono::steady_clock::time_point _startTime;
+	std::chrono::steady_clock::time_point _lastFrameTime;
+	uint _frameCount = 0u;
+	double _frameTimeSum = 0.0;
+	double _worstFrameTime = 0.0;
+	double _submitTimeSum = 0.0;	// Spent in DrawList::Execute.
+	uint _drawSum = 0u;
+	uint _drawCallSum = 0u;
+	uint _instancedDrawCallSum = 0u;
+	uint _constantMapSum = 0u;
+	double _sortSum = 0.0;
+	double _recordSum = 0.0;	// Spent binding and drawing, and the recorders it was split between, 0 on the render thread.
+	uint _recorderSum = 0u;
+	uint _stateChangeSum = 0u;	// Program, material and mesh changes between sorted draws.
+	uint _bindSum = 0u;	// Bindings that reached the device context, and redundant ones the state cache dropped.
+	uint _skippedBindSum = 0u;
+	double _sceneUpdateSum = 0.0;
+	double _boundsSum = 0.0;	// Spent moving the bounds and refitting or rebuilding the hierarchy.
+	double _cullSum = 0.0;
+	uint _culledSum = 0u;
+	uint _rebuildCount = 0u;
+	double _occlusionRenderSum = 0.0;	// Spent rasterizing occluders on the jobs, and testing on the render thread.
+	double _occlusionTestSum = 0.0;
+	uint _occlusionTestedSum = 0u;
+	uint _occludedSum = 0u;
+	double _terrainSelectSum = 0.0;
+	uint _terrainChunkSum = 0u;
+	uint _terrainTriangleSum = 0u;
+	uint _terrainMissingSum = 0u;
+	uint _terrainLoadSum = 0u;
+	uint _terrainEvictSum = 0u;
+	bool _streamingReported = false;
+
+	// Reports written to the console by background jobs, so a blocked console never stalls a frame.
+	JobSystem::Counter _logWriting;
 };
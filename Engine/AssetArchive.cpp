@@ -0,0 +1,215 @@
+#include "AssetArchive.h"
+
+#include <algorithm>
+#include <filesystem>
+#include <string.h>
+
+namespace
+{
+	const char MAGIC[4] = { 'A', 'P', 'A', 'K' };
+	const uint32_t VERSION = 1u;
+
+	uint64_t AlignUp(uint64_t value, uint64_t alignment)
+	{
+		return (value + alignment - 1u) / alignment * alignment;
+	}
+}
+
+AssetArchive::AssetArchive(const char* filename)
+	: _file(filename)
+{
+	if (!_file.IsValid())
+		return;
+
+	_view = _file.GetData();
+	_size = _file.GetSize();
+	_isValid = ReadTable();
+}
+
+bool AssetArchive::ReadTable()
+{
+	if (_size < sizeof(Header))
+		return false;
+
+	const Header* header = (const Header*)_view;
+	if (memcmp(header->magic, MAGIC, sizeof(MAGIC)) != 0 || header->version != VERSION)
+		return false;
+
+	// Every table entry, name and payload has to lie inside the file before anything is handed out.
+	uint64_t tableSize = (uint64_t)header->entryCount * sizeof(Entry);
+	if (header->tableOffset > _size || tableSize > _size - header->tableOffset || header->namesOffset > _size)
+		return false;
+
+	const Entry* entries = (const Entry*)(_view + header->tableOffset);
+	uint64_t namesSize = _size - header->namesOffset;
+	for (uint i = 0u; i < header->entryCount; ++i)
+	{
+		const Entry& entry = entries[i];
+		if (entry.offset > _size || entry.size > _size - entry.offset)
+			return false;
+		if ((uint64_t)entry.nameOffset + entry.nameLength > namesSize)
+			return false;
+		if (i > 0u && entries[i - 1u].nameHash >= entry.nameHash)
+			return false;
+	}
+
+	_entries = entries;
+	_entryCount = header->entryCount;
+	_names = (const char*)(_view + header->namesOffset);
+	return true;
+}
+
+bool AssetArchive::IsValid() const
+{
+	return _isValid;
+}
+
+uint AssetArchive::GetAssetCount() const
+{
+	return _entryCount;
+}
+
+const AssetArchive::Entry* AssetArchive::FindEntry(const char* name) const
+{
+	if (!_isValid)
+		return nullptr;
+
+	size_t nameLength = strlen(name);
+	uint64_t nameHash = Hash((const uchar*)name, nameLength);
+
+	// The table is sorted by name hash; the stored name guards against a hash collision with an unknown name.
+	const Entry* end = _entries + _entryCount;
+	const Entry* entry = std::lower_bound(_entries, end, nameHash, [](const Entry& entry, uint64_t hash) { return entry.nameHash < hash; });
+	if (entry == end || entry->nameHash != nameHash)
+		return nullptr;
+	if (entry->nameLength != nameLength || memcmp(_names + entry->nameOffset, name, nameLength) != 0)
+		return nullptr;
+
+	return entry;
+}
+
+AssetArchive::Asset AssetArchive::Find(const char* name) const
+{
+	Asset asset;
+	const Entry* entry = FindEntry(name);
+	if (!entry)
+		return asset;
+
+	asset.data = _view + entry->offset;
+	asset.size = (size_t)entry->size;
+	return asset;
+}
+
+bool AssetArchive::Verify(const char* name) const
+{
+	const Entry* entry = FindEntry(name);
+	if (!entry)
+		return false;
+
+	return Hash(_view + entry->offset, (size_t)entry->size) == entry->contentHash;
+}
+
+bool AssetArchive::Pack(const char* directory, const char* filename)
+{
+	namespace fs = std::filesystem;
+
+	struct Source
+	{
+		fs::path path;
+		std::string name;
+		Entry entry;
+	};
+
+	// Collect every file, named by its path relative to the directory.
+	std::vector<Source> sources;
+	std::error_code error;
+	for (fs::recursive_directory_iterator it(directory, error), end; !error && it != end; it.increment(error))
+	{
+		if (!it->is_regular_file())
+			continue;
+
+		Source source;
+		source.path = it->path();
+		source.name = fs::relative(it->path(), directory).generic_string();
+		source.entry = Entry();
+		source.entry.nameHash = Hash((const uchar*)source.name.data(), source.name.size());
+		source.entry.size = (uint64_t)it->file_size();
+		sources.push_back(std::move(source));
+	}
+	if (error)
+		return false;
+
+	std::sort(sources.begin(), sources.end(), [](const Source& a, const Source& b) { return a.entry.nameHash < b.entry.nameHash; });
+	for (size_t i = 1u; i < sources.size(); ++i)
+	{
+		if (sources[i - 1u].entry.nameHash == sources[i].entry.nameHash)
+			return false;
+	}
+
+	// Lay out the header, table and names, then give every payload its own aligned slot.
+	Header header;
+	memcpy(header.magic, MAGIC, sizeof(MAGIC));
+	header.version = VERSION;
+	header.entryCount = (uint32_t)sources.size();
+	header.reserved = 0u;
+	header.tableOffset = sizeof(Header);
+	header.namesOffset = header.tableOffset + sources.size() * sizeof(Entry);
+
+	std::string names;
+	for (Source& source : sources)
+	{
+		source.entry.nameOffset = (uint32_t)names.size();
+		source.entry.nameLength = (uint32_t)source.name.size();
+		names += source.name;
+	}
+
+	uint64_t offset = AlignUp(header.namesOffset + names.size(), PAYLOAD_ALIGNMENT);
+	for (Source& source : sources)
+	{
+		source.entry.offset = offset;
+		offset = AlignUp(offset + source.entry.size, PAYLOAD_ALIGNMENT);
+	}
+
+	std::ofstream output(filename, std::ios::binary);
+	if (!output)
+		return false;
+
+	// Copy the payloads one at a time, hashing each on the way. The table holds the hashes, so it is written last.
+	const std::vector<char> padding(PAYLOAD_ALIGNMENT, 0);
+	std::vector<uchar> payload;
+	uint64_t position = 0u;
+	for (Source& source : sources)
+	{
+		std::ifstream input(source.path, std::ios::binary);
+		payload.resize((size_t)source.entry.size);
+		if (!input.read((char*)payload.data(), (std::streamsize)payload.size()))
+			return false;
+
+		source.entry.contentHash = Hash(payload.data(), payload.size());
+		output.seekp((std::streamoff)source.entry.offset);
+		output.write((const char*)payload.data(), (std::streamsize)payload.size());
+		position = source.entry.offset + payload.size();
+	}
+
+	// Pad the last payload too, so the file size is a whole number of pages.
+	output.seekp((std::streamoff)position);
+	output.write(padding.data(), (std::streamsize)(offset - position));
+
+	output.seekp(0);
+	output.write((const char*)&header, sizeof(header));
+	for (const Source& source : sources)
+		output.write((const char*)&source.entry, sizeof(Entry));
+	output.write(names.data(), (std::streamsize)names.size());
+	return (bool)output;
+}
+
+uint64_t AssetArchive::Hash(const uchar* data, size_t size)
+{
+	uint64_t hash = 14695981039346656037ull;
+	for (size_t i = 0u; i < size; ++i)
+	{
+		hash ^= data[i];
+		hash *= 1099511628211ull;
+	}
+	return hash;
+}
@@ -0,0 +1,77 @@
+#pragma once
+
+#include "Common.h"
+#include "MappedFile.h"
+
+// Read-only packed asset archive. The file is memory-mapped once and assets are returned as pointers into the
+// mapping, so loaders decode or upload straight from it without reading the file into intermediate buffers.
+//
+// Layout: a header, a table of contents sorted by name hash, the names, then every payload on its own
+// PAYLOAD_ALIGNMENT boundary so each asset starts on a fresh page. Each entry also stores a hash of its
+// content, checked on demand with Verify.
+class AssetArchive
+{
+public:
+
+	static const uint PAYLOAD_ALIGNMENT = 4096u;
+
+	struct Asset
+	{
+		const uchar* data = nullptr;	// Null when the archive has no asset of that name.
+		size_t size = 0u;
+	};
+
+	// Maps the archive. Check IsValid; a missing or malformed file leaves the archive empty.
+	AssetArchive(const char* filename);
+
+	AssetArchive(const AssetArchive&) = delete;
+	AssetArchive& operator=(const AssetArchive&) = delete;
+
+	bool IsValid() const;
+	uint GetAssetCount() const;
+
+	// Looks an asset up by its path relative to the packed directory, with forward slashes.
+	Asset Find(const char* name) const;
+
+	// Hashes the asset's bytes and compares them with the table of contents.
+	bool Verify(const char* name) const;
+
+	// Packs every file under directory into a new archive. Returns false if a file cannot be read or written.
+	static bool Pack(const char* directory, const char* filename);
+
+	// 64-bit FNV-1a, used for both names and contents.
+	static uint64_t Hash(const uchar* data, size_t size);
+
+private:
+
+	struct Header
+	{
+		char magic[4];
+		uint32_t version;
+		uint32_t entryCount;
+		uint32_t reserved;
+		uint64_t tableOffset;
+		uint64_t namesOffset;
+	};
+
+	struct Entry
+	{
+		uint64_t nameHash;
+		uint64_t offset;
+		uint64_t size;
+		uint64_t contentHash;
+		uint32_t nameOffset;
+		uint32_t nameLength;
+	};
+
+	bool ReadTable();
+	const Entry* FindEntry(const char* name) const;
+
+	MappedFile _file;
+	const uchar* _view = nullptr;
+	size_t _size = 0u;
+	const Entry* _entries = nullptr;
+	const char* _names = nullptr;
+	uint _entryCount = 0u;
+	bool _isValid = false;
+};
@@ -0,0 +1,218 @@
+#include "AssetLoadBenchmark.h"
+#include "AssetArchive.h"
+#include "DdsFile.h"
+#include "MeshFile.h"
+#include "TargaDecoder.h"
+
+#include <algorithm>
+#include <chrono>
+#include <filesystem>
+
+#ifdef _WIN32
+#define WIN32_LEAN_AND_MEAN
+#define NOMINMAX
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <unistd.h>
+#endif
+
+namespace
+{
+	const uint COLD_RUNS = 3u;
+	const uint WARM_RUNS = 20u;
+
+	struct AssetFile
+	{
+		std::filesystem::path path;
+		std::string name;	// Relative to the asset directory, as the archive names it.
+	};
+
+	double MillisecondsSince(std::chrono::steady_clock::time_point start)
+	{
+		return std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+	}
+
+	// Drops the file's pages from the OS file cache, so the next read comes from the disk. Returns false where the
+	// system does not allow it.
+	bool EvictFromCache(const std::filesystem::path& path)
+	{
+#ifdef _WIN32
+		// Opening a file without buffering makes the cache manager flush and purge its pages, as long as nothing maps it.
+		HANDLE file = CreateFileW(path.c_str(), GENERIC_READ, FILE_SHARE_READ, nullptr, OPEN_EXISTING, FILE_FLAG_NO_BUFFERING, nullptr);
+		if (file == INVALID_HANDLE_VALUE)
+			return false;
+		CloseHandle(file);
+		return true;
+#else
+		// Only clean pages can be dropped, and the archive has just been written.
+		int file = open(path.c_str(), O_RDONLY);
+		if (file < 0)
+			return false;
+		bool evicted = fsync(file) == 0 && posix_fadvise(file, 0, 0, POSIX_FADV_DONTNEED) == 0;
+		close(file);
+		return evicted;
+#endif
+	}
+
+	uint64_t HashMesh(const MeshData& mesh)
+	{
+		return AssetArchive::Hash((const uchar*)mesh.vertices.data(), mesh.vertices.size() * sizeof(MeshData::Vertex)) ^
+			AssetArchive::Hash((const uchar*)mesh.indices.data(), mesh.indices.size() * sizeof(uint)) * 31u;
+	}
+
+	uint64_t HashDds(const DdsFile& dds)
+	{
+		uint64_t hash = 0u;
+		for (uint level = 0u; level < dds.GetLevelCount(); ++level)
+		{
+			DdsFile::Level data = dds.GetLevel(level);
+			size_t size = DdsFile::GetLevelSize(dds.GetFormat(), data.width, data.height);
+			hash = hash * 31u + AssetArchive::Hash(data.data, size);
+		}
+		return hash;
+	}
+
+	// Decodes one asset the way the engine loads its type, from the file when data is null and from memory
+	// otherwise, and returns a hash of the result, or 0 if it does not load.
+	uint64_t LoadAsset(const AssetFile& asset, const uchar* data, size_t size, std::vector<uchar>& pixels)
+	{
+		std::string extension = asset.path.extension().string();
+		std::string filename = asset.path.string();
+		if (extension == ".tga")
+		{
+			TargaDecoder decoder = data ? TargaDecoder(data, size) : TargaDecoder(filename.c_str());
+			if (!decoder.IsValid())
+				return 0u;
+			pixels.resize((size_t)decoder.GetWidth() * decoder.GetHeight() * 4u);
+			if (!decoder.Decode(pixels.data()))
+				return 0u;
+			return AssetArchive::Hash(pixels.data(), pixels.size());
+		}
+		if (extension == ".dds")
+		{
+			DdsFile dds = data ? DdsFile(data, size) : DdsFile(filename.c_str());
+			return dds.IsValid() ? HashDds(dds) : 0u;
+		}
+		if (extension == ".mesh")
+		{
+			MeshData mesh;
+			std::unique_ptr<MeshFile> meshFile = data ? std::make_unique<MeshFile>(data, size) : std::make_unique<MeshFile>(filename.c_str());
+			if (!meshFile->IsValid() || !meshFile->Decode(mesh))
+				return 0u;
+			return HashMesh(mesh);
+		}
+
+		// Anything else is read whole.
+		if (data)
+			return AssetArchive::Hash(data, size);
+		std::ifstream file(asset.path, std::ios::binary | std::ios::ate);
+		if (!file)
+			return 0u;
+		pixels.resize((size_t)file.tellg());
+		file.seekg(0);
+		if (!file.read((char*)pixels.data(), (std::streamsize)pixels.size()))
+			return 0u;
+		return AssetArchive::Hash(pixels.data(), pixels.size());
+	}
+
+	// Loads every asset from its own file. Returns the milliseconds taken; hashes receives one hash per asset.
+	double LoadLoose(const std::vector<AssetFile>& assets, std::vector<uint64_t>& hashes)
+	{
+		std::vector<uchar> pixels;
+		hashes.clear();
+		auto start = std::chrono::steady_clock::now();
+		for (const AssetFile& asset : assets)
+			hashes.push_back(LoadAsset(asset, nullptr, 0u, pixels));
+		return MillisecondsSince(start);
+	}
+
+	// Maps the archive and loads every asset from the mapping, including the time to open it.
+	double LoadArchive(const std::filesystem::path& archivePath, const std::vector<AssetFile>& assets, std::vector<uint64_t>& hashes)
+	{
+		std::vector<uchar> pixels;
+		hashes.clear();
+		auto start = std::chrono::steady_clock::now();
+		AssetArchive archive(archivePath.string().c_str());
+		for (const AssetFile& asset : assets)
+		{
+			AssetArchive::Asset data = archive.Find(asset.name.c_str());
+			hashes.push_back(data.data ? LoadAsset(asset, data.data, data.size, pixels) : 0u);
+		}
+		return MillisecondsSince(start);
+	}
+}
+
+bool RunAssetLoadBenchmark(const char* assetDirectory, std::ostream& output)
+{
+	namespace fs = std::filesystem;
+
+	// The archive goes next to the asset directory, so cold loads of both come from the same disk.
+	std::error_code error;
+	fs::path archivePath = fs::path(assetDirectory) / ".." / "asset-load-benchmark.pak";
+	if (!AssetArchive::Pack(assetDirectory, archivePath.string().c_str()))
+	{
+		output << std::format("Could not pack {} into {}", assetDirectory, archivePath.string()) << std::endl;
+		return false;
+	}
+
+	// The asset set is every file the archive was packed from.
+	std::vector<AssetFile> assets;
+	uint64_t totalBytes = 0u;
+	for (fs::recursive_directory_iterator it(assetDirectory, error), end; !error && it != end; it.increment(error))
+	{
+		if (!it->is_regular_file())
+			continue;
+		assets.push_back({ it->path(), fs::relative(it->path(), assetDirectory).generic_string() });
+		totalBytes += it->file_size();
+	}
+	std::sort(assets.begin(), assets.end(), [](const AssetFile& a, const AssetFile& b) { return a.name < b.name; });
+
+	// Both paths must load every asset to the same bytes, and the archive must hold them unchanged.
+	bool allMatch = !assets.empty();
+	std::vector<uint64_t> looseHashes, archiveHashes;
+	LoadLoose(assets, looseHashes);
+	LoadArchive(archivePath, assets, archiveHashes);
+	{
+		// Unmapped again before the cold runs, which cannot drop a mapped file from the cache.
+		AssetArchive archive(archivePath.string().c_str());
+		for (size_t i = 0u; i < assets.size(); ++i)
+		{
+			bool match = looseHashes[i] != 0u && looseHashes[i] == archiveHashes[i] && archive.Verify(assets[i].name.c_str());
+			if (!match)
+				output << std::format("{}: loose and archived loads differ: MISMATCH", assets[i].name) << std::endl;
+			allMatch = allMatch && match;
+		}
+	}
+	output << std::format("{} assets, {:.1f} KB loose, {:.1f} KB packed", assets.size(), totalBytes / 1024.0, fs::file_size(archivePath, error) / 1024.0) << std::endl;
+
+	// Cold loads, each after dropping every file from the cache.
+	double looseCold = 0.0;
+	double archiveCold = 0.0;
+	bool evicted = true;
+	for (uint run = 0u; run < COLD_RUNS; ++run)
+	{
+		for (const AssetFile& asset : assets)
+			evicted = EvictFromCache(asset.path) && evicted;
+		looseCold += LoadLoose(assets, looseHashes) / COLD_RUNS;
+
+		evicted = EvictFromCache(archivePath) && evicted;
+		archiveCold += LoadArchive(archivePath, assets, archiveHashes) / COLD_RUNS;
+	}
+	output << std::format("Cold: loose files {:.2f} ms, archive {:.2f} ms ({:.1f}x){}", looseCold, archiveCold, looseCold / archiveCold,
+		evicted ? "" : ", but the files could not be dropped from the file cache") << std::endl;
+
+	// Warm loads from the file cache.
+	double looseWarm = 0.0;
+	double archiveWarm = 0.0;
+	for (uint run = 0u; run < WARM_RUNS; ++run)
+	{
+		looseWarm += LoadLoose(assets, looseHashes) / WARM_RUNS;
+		archiveWarm += LoadArchive(archivePath, assets, archiveHashes) / WARM_RUNS;
+	}
+	output << std::format("Warm: loose files {:.2f} ms, archive {:.2f} ms ({:.1f}x): {}", looseWarm, archiveWarm, looseWarm / archiveWarm,
+		allMatch ? "OK" : "MISMATCH") << std::endl;
+
+	fs::remove(archivePath, error);
+	return allMatch;
+}
@@ -0,0 +1,11 @@
+#pragma once
+
+#include <ostream>
+#include "Common.h"
+
+// Packs assetDirectory into a temporary AssetArchive and times loading every asset in it both from the loose files
+// and from the mapped archive: TGAs and cooked meshes are decoded, DDS files parsed and their levels read, and other
+// files read whole. Cold loads first drop the files from the OS file cache; warm loads are averaged after a first
+// untimed one. Checks that both paths decode every asset to the same bytes and that the archive verifies.
+// Run with "Engine.exe -benchmark-assets". Returns false if any check fails.
+bool RunAssetLoadBenchmark(const char* assetDirectory, std::ostream& output);
@@ -0,0 +1,860 @@
+#include "BlockCompressor.h"
+#include "JobSystem.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <limits>
+#include <string.h>
+
+namespace
+{
+	const uint BLOCK_PIXELS = 16u;
+	const float INFINITE_ERROR = std::numeric_limits<float>::max();
+
+	// BC7 interpolation weights out of 64 for 2, 3 and 4-bit indices.
+	const uint WEIGHTS2[4] = { 0u, 21u, 43u, 64u };
+	const uint WEIGHTS3[8] = { 0u, 9u, 18u, 27u, 37u, 46u, 55u, 64u };
+	const uint WEIGHTS4[16] = { 0u, 4u, 9u, 13u, 17u, 21u, 26u, 30u, 34u, 38u, 43u, 47u, 51u, 55u, 60u, 64u };
+
+	// Weight of the second endpoint for each BC1 palette index, in four and three color mode.
+	const float FOUR_COLOR_WEIGHTS[4] = { 0.0f, 1.0f, 1.0f / 3.0f, 2.0f / 3.0f };
+	const float THREE_COLOR_WEIGHTS[4] = { 0.0f, 1.0f, 0.5f, 0.0f };
+
+	// The 16 pixels of one block as floats in the 0-255 range.
+	struct Block
+	{
+		float pixels[BLOCK_PIXELS][4];
+	};
+
+	Block LoadBlock(const uchar* pixels, uint width, uint height, uint blockX, uint blockY)
+	{
+		Block block;
+		for (uint y = 0u; y < 4u; ++y)
+		{
+			uint sourceY = std::min(blockY * 4u + y, height - 1u);
+			for (uint x = 0u; x < 4u; ++x)
+			{
+				uint sourceX = std::min(blockX * 4u + x, width - 1u);
+				const uchar* pixel = pixels + ((size_t)sourceY * width + sourceX) * 4u;
+				for (uint channel = 0u; channel < 4u; ++channel)
+					block.pixels[y * 4u + x][channel] = pixel[channel];
+			}
+		}
+		return block;
+	}
+
+	void StoreBlock(const uchar (*decoded)[4], uchar* pixels, uint width, uint height, uint blockX, uint blockY)
+	{
+		for (uint y = 0u; y < 4u && blockY * 4u + y < height; ++y)
+		{
+			for (uint x = 0u; x < 4u && blockX * 4u + x < width; ++x)
+				memcpy(pixels + ((size_t)(blockY * 4u + y) * width + blockX * 4u + x) * 4u, decoded[y * 4u + x], 4u);
+		}
+	}
+
+	int Quantize(float value, int maximum)
+	{
+		return std::clamp((int)std::lround(value * maximum / 255.0f), 0, maximum);
+	}
+
+	uint Interpolate(uint value0, uint value1, uint weight)
+	{
+		return ((64u - weight) * value0 + weight * value1 + 32u) >> 6;
+	}
+
+	// Mean and principal axis of a set of points, the axis found by power iteration on their covariance matrix.
+	void ComputePrincipalAxis(const float (*points)[4], uint count, uint channels, float* mean, float* axis)
+	{
+		for (uint channel = 0u; channel < 4u; ++channel)
+		{
+			mean[channel] = 0.0f;
+			axis[channel] = 0.0f;
+		}
+
+		for (uint i = 0u; i < count; ++i)
+		{
+			for (uint channel = 0u; channel < channels; ++channel)
+				mean[channel] += points[i][channel];
+		}
+		for (uint channel = 0u; channel < channels; ++channel)
+			mean[channel] /= (float)count;
+
+		float covariance[4][4] = {};
+		for (uint i = 0u; i < count; ++i)
+		{
+			for (uint row = 0u; row < channels; ++row)
+			{
+				for (uint column = 0u; column < channels; ++column)
+					covariance[row][column] += (points[i][row] - mean[row]) * (points[i][column] - mean[column]);
+			}
+		}
+
+		// Start from the row of the channel with the largest spread, which is close to the answer for most blocks.
+		uint largest = 0u;
+		for (uint channel = 1u; channel < channels; ++channel)
+		{
+			if (covariance[channel][channel] > covariance[largest][largest])
+				largest = channel;
+		}
+		if (covariance[largest][largest] <= 0.0f)
+			return;
+
+		float vector[4] = {};
+		for (uint channel = 0u; channel < channels; ++channel)
+			vector[channel] = covariance[largest][channel];
+
+		for (uint iteration = 0u; iteration < 8u; ++iteration)
+		{
+			float next[4] = {};
+			float scale = 0.0f;
+			for (uint row = 0u; row < channels; ++row)
+			{
+				for (uint column = 0u; column < channels; ++column)
+					next[row] += covariance[row][column] * vector[column];
+				scale = std::max(scale, std::fabs(next[row]));
+			}
+			if (scale <= 0.0f)
+				return;
+			for (uint channel = 0u; channel < channels; ++channel)
+				vector[channel] = next[channel] / scale;
+		}
+
+		float length = 0.0f;
+		for (uint channel = 0u; channel < channels; ++channel)
+			length += vector[channel] * vector[channel];
+		length = std::sqrt(length);
+		for (uint channel = 0u; channel < channels; ++channel)
+			axis[channel] = vector[channel] / length;
+	}
+
+	// Endpoints at both ends of the projection of the points on the principal axis, moved inwards by inset of the range.
+	void ComputeAxisEndpoints(const float (*points)[4], uint count, uint channels, float inset, float* endpoint0, float* endpoint1)
+	{
+		float mean[4];
+		float axis[4];
+		ComputePrincipalAxis(points, count, channels, mean, axis);
+
+		float minimum = 0.0f;
+		float maximum = 0.0f;
+		for (uint i = 0u; i < count; ++i)
+		{
+			float projection = 0.0f;
+			for (uint channel = 0u; channel < channels; ++channel)
+				projection += (points[i][channel] - mean[channel]) * axis[channel];
+			minimum = std::min(minimum, projection);
+			maximum = std::max(maximum, projection);
+		}
+
+		float shrink = (maximum - minimum) * inset;
+		for (uint channel = 0u; channel < 4u; ++channel)
+		{
+			endpoint0[channel] = mean[channel] + axis[channel] * (maximum - shrink);
+			endpoint1[channel] = mean[channel] + axis[channel] * (minimum + shrink);
+		}
+	}
+
+	// Least squares fit of both endpoints to the pixels, given each pixel's palette index and the weight of the
+	// second endpoint for every index. Pixels flagged in skip do not take part. Fails when all pixels share one weight.
+	bool FitEndpoints(const Block& block, const uint* indices, const float* weights, uint channels, const bool* skip, float* endpoint0, float* endpoint1)
+	{
+		float weight00 = 0.0f;
+		float weight01 = 0.0f;
+		float weight11 = 0.0f;
+		float sum0[4] = {};
+		float sum1[4] = {};
+
+		for (uint i = 0u; i < BLOCK_PIXELS; ++i)
+		{
+			if (skip && skip[i])
+				continue;
+
+			float weight1 = weights[indices[i]];
+			float weight0 = 1.0f - weight1;
+			weight00 += weight0 * weight0;
+			weight01 += weight0 * weight1;
+			weight11 += weight1 * weight1;
+			for (uint channel = 0u; channel < channels; ++channel)
+			{
+				sum0[channel] += weight0 * block.pixels[i][channel];
+				sum1[channel] += weight1 * block.pixels[i][channel];
+			}
+		}
+
+		float determinant = weight00 * weight11 - weight01 * weight01;
+		if (std::fabs(determinant) < 1e-6f)
+			return false;
+
+		for (uint channel = 0u; channel < channels; ++channel)
+		{
+			endpoint0[channel] = (sum0[channel] * weight11 - sum1[channel] * weight01) / determinant;
+			endpoint1[channel] = (sum1[channel] * weight00 - sum0[channel] * weight01) / determinant;
+		}
+		return true;
+	}
+
+	uint QuantizeColor565(const float* color)
+	{
+		return ((uint)Quantize(color[0], 31) << 11) | ((uint)Quantize(color[1], 63) << 5) | (uint)Quantize(color[2], 31);
+	}
+
+	void ExpandColor565(uint color, int* rgb)
+	{
+		uint red = (color >> 11) & 31u;
+		uint green = (color >> 5) & 63u;
+		uint blue = color & 31u;
+		rgb[0] = (int)((red << 3) | (red >> 2));
+		rgb[1] = (int)((green << 2) | (green >> 4));
+		rgb[2] = (int)((blue << 3) | (blue >> 2));
+	}
+
+	// Palette of a BC1 color block. In three color mode the fourth entry is transparent black.
+	void GetColorPalette(uint color0, uint color1, bool threeColor, int (*palette)[3])
+	{
+		ExpandColor565(color0, palette[0]);
+		ExpandColor565(color1, palette[1]);
+		for (uint channel = 0u; channel < 3u; ++channel)
+		{
+			int value0 = palette[0][channel];
+			int value1 = palette[1][channel];
+			if (threeColor)
+			{
+				palette[2][channel] = (value0 + value1 + 1) / 2;
+				palette[3][channel] = 0;
+			}
+			else
+			{
+				palette[2][channel] = (2 * value0 + value1 + 1) / 3;
+				palette[3][channel] = (value0 + 2 * value1 + 1) / 3;
+			}
+		}
+	}
+
+	// Chooses the nearest palette entry for every pixel and returns the squared error.
+	// In three color mode transparent pixels take index 3 and opaque pixels never do.
+	float SelectColorIndices(const Block& block, const bool* transparent, uint color0, uint color1, bool threeColor, uint* indices)
+	{
+		int palette[4][3];
+		GetColorPalette(color0, color1, threeColor, palette);
+		uint entries = threeColor ? 3u : 4u;
+
+		float error = 0.0f;
+		for (uint i = 0u; i < BLOCK_PIXELS; ++i)
+		{
+			if (transparent && transparent[i])
+			{
+				indices[i] = 3u;
+				continue;
+			}
+
+			float bestDistance = INFINITE_ERROR;
+			for (uint entry = 0u; entry < entries; ++entry)
+			{
+				float distance = 0.0f;
+				for (uint channel = 0u; channel < 3u; ++channel)
+				{
+					float difference = block.pixels[i][channel] - (float)palette[entry][channel];
+					distance += difference * difference;
+				}
+				if (distance < bestDistance)
+				{
+					bestDistance = distance;
+					indices[i] = entry;
+				}
+			}
+			error += bestDistance;
+		}
+		return error;
+	}
+
+	// Writes the 8 byte color block. BC1 blocks use three color mode to encode transparent pixels;
+	// the color part of a BC3 block is always decoded with four colors, whatever the endpoint order.
+	void EncodeColorBlock(const Block& block, bool bc1, uint refinements, uchar* output)
+	{
+		bool transparent[BLOCK_PIXELS];
+		float points[BLOCK_PIXELS][4];
+		uint count = 0u;
+		for (uint i = 0u; i < BLOCK_PIXELS; ++i)
+		{
+			transparent[i] = bc1 && block.pixels[i][3] < 128.0f;
+			if (!transparent[i])
+				memcpy(points[count++], block.pixels[i], sizeof(points[0]));
+		}
+		bool anyTransparent = count < BLOCK_PIXELS;
+
+		uint color0 = 0u;
+		uint color1 = 0u;
+		uint indices[BLOCK_PIXELS] = {};
+		bool threeColor = false;
+
+		// Quantize a pair of endpoints, put them in the order the mode needs and pick the indices.
+		auto encode = [&](const float* endpoint0, const float* endpoint1, uint& outColor0, uint& outColor1, bool& outThreeColor, uint* outIndices)
+		{
+			outColor0 = QuantizeColor565(endpoint0);
+			outColor1 = QuantizeColor565(endpoint1);
+			if (bc1 && (anyTransparent ? outColor0 > outColor1 : outColor0 < outColor1))
+				std::swap(outColor0, outColor1);
+
+			// Equal endpoints also select three color mode in BC1, which only matters for index 3.
+			outThreeColor = bc1 && outColor0 <= outColor1;
+			return SelectColorIndices(block, anyTransparent ? transparent : nullptr, outColor0, outColor1, outThreeColor, outIndices);
+		};
+
+		if (count == 0u)
+		{
+			// Fully transparent: equal endpoints select three color mode and every pixel takes index 3.
+			color0 = color1 = 0u;
+			threeColor = true;
+			for (uint i = 0u; i < BLOCK_PIXELS; ++i)
+				indices[i] = 3u;
+		}
+		else
+		{
+			float endpoint0[4];
+			float endpoint1[4];
+			ComputeAxisEndpoints(points, count, 3u, 1.0f / 16.0f, endpoint0, endpoint1);
+			float bestError = encode(endpoint0, endpoint1, color0, color1, threeColor, indices);
+
+			for (uint pass = 0u; pass < refinements && bestError > 0.0f; ++pass)
+			{
+				if (!FitEndpoints(block, indices, threeColor ? THREE_COLOR_WEIGHTS : FOUR_COLOR_WEIGHTS, 3u, transparent, endpoint0, endpoint1))
+					break;
+
+				uint fittedColor0, fittedColor1;
+				bool fittedThreeColor;
+				uint fittedIndices[BLOCK_PIXELS];
+				float error = encode(endpoint0, endpoint1, fittedColor0, fittedColor1, fittedThreeColor, fittedIndices);
+				if (error >= bestError)
+					break;
+
+				bestError = error;
+				color0 = fittedColor0;
+				color1 = fittedColor1;
+				threeColor = fittedThreeColor;
+				memcpy(indices, fittedIndices, sizeof(indices));
+			}
+		}
+
+		uint packedIndices = 0u;
+		for (uint i = 0u; i < BLOCK_PIXELS; ++i)
+			packedIndices |= indices[i] << (i * 2u);
+
+		output[0] = (uchar)color0;
+		output[1] = (uchar)(color0 >> 8);
+		output[2] = (uchar)color1;
+		output[3] = (uchar)(color1 >> 8);
+		for (uint i = 0u; i < 4u; ++i)
+			output[4u + i] = (uchar)(packedIndices >> (i * 8u));
+	}
+
+	void DecodeColorBlock(const uchar* input, bool bc1, uchar (*decoded)[4])
+	{
+		uint color0 = input[0] | ((uint)input[1] << 8);
+		uint color1 = input[2] | ((uint)input[3] << 8);
+		uint indices = input[4] | ((uint)input[5] << 8) | ((uint)input[6] << 16) | ((uint)input[7] << 24);
+		bool threeColor = bc1 && color0 <= color1;
+
+		int palette[4][3];
+		GetColorPalette(color0, color1, threeColor, palette);
+		for (uint i = 0u; i < BLOCK_PIXELS; ++i)
+		{
+			uint index = (indices >> (i * 2u)) & 3u;
+			for (uint channel = 0u; channel < 3u; ++channel)
+				decoded[i][channel] = (uchar)palette[index][channel];
+			decoded[i][3] = (threeColor && index == 3u) ? 0u : 255u;
+		}
+	}
+
+	// Palette of an alpha block: eight interpolated values when alpha0 > alpha1, otherwise six plus 0 and 255.
+	void GetAlphaPalette(uint alpha0, uint alpha1, uint* palette)
+	{
+		palette[0] = alpha0;
+		palette[1] = alpha1;
+		if (alpha0 > alpha1)
+		{
+			for (uint i = 2u; i < 8u; ++i)
+				palette[i] = ((8u - i) * alpha0 + (i - 1u) * alpha1 + 3u) / 7u;
+		}
+		else
+		{
+			for (uint i = 2u; i < 6u; ++i)
+				palette[i] = ((6u - i) * alpha0 + (i - 1u) * alpha1 + 2u) / 5u;
+			palette[6] = 0u;
+			palette[7] = 255u;
+		}
+	}
+
+	uint SelectAlphaIndices(const Block& block, uint alpha0, uint alpha1, uint* indices)
+	{
+		uint palette[8];
+		GetAlphaPalette(alpha0, alpha1, palette);
+
+		uint error = 0u;
+		for (uint i = 0u; i < BLOCK_PIXELS; ++i)
+		{
+			int alpha = (int)block.pixels[i][3];
+			uint bestDistance = ~0u;
+			for (uint entry = 0u; entry < 8u; ++entry)
+			{
+				uint distance = (uint)std::abs(alpha - (int)palette[entry]);
+				if (distance < bestDistance)
+				{
+					bestDistance = distance;
+					indices[i] = entry;
+				}
+			}
+			error += bestDistance * bestDistance;
+		}
+		return error;
+	}
+
+	// Writes the 8 byte interpolated alpha block of BC3.
+	void EncodeAlphaBlock(const Block& block, uchar* output)
+	{
+		uint minimum = 255u;
+		uint maximum = 0u;
+		uint innerMinimum = 255u;
+		uint innerMaximum = 0u;
+		for (uint i = 0u; i < BLOCK_PIXELS; ++i)
+		{
+			uint alpha = (uint)block.pixels[i][3];
+			minimum = std::min(minimum, alpha);
+			maximum = std::max(maximum, alpha);
+			if (alpha != 0u && alpha != 255u)
+			{
+				innerMinimum = std::min(innerMinimum, alpha);
+				innerMaximum = std::max(innerMaximum, alpha);
+			}
+		}
+
+		// The eight value mode spans the whole range. The six value mode has exact 0 and 255, so it only needs to span
+		// the values in between, which wins for blocks mixing fully transparent or opaque pixels with partial ones.
+		uint indices[BLOCK_PIXELS];
+		uint alpha0 = maximum;
+		uint alpha1 = minimum;
+		uint error = SelectAlphaIndices(block, alpha0, alpha1, indices);
+
+		if (error > 0u && innerMinimum <= innerMaximum)
+		{
+			uint innerIndices[BLOCK_PIXELS];
+			uint innerError = SelectAlphaIndices(block, innerMinimum, innerMaximum, innerIndices);
+			if (innerError < error)
+			{
+				alpha0 = innerMinimum;
+				alpha1 = innerMaximum;
+				memcpy(indices, innerIndices, sizeof(indices));
+			}
+		}
+
+		uint64_t packedIndices = 0u;
+		for (uint i = 0u; i < BLOCK_PIXELS; ++i)
+			packedIndices |= (uint64_t)indices[i] << (i * 3u);
+
+		output[0] = (uchar)alpha0;
+		output[1] = (uchar)alpha1;
+		for (uint i = 0u; i < 6u; ++i)
+			output[2u + i] = (uchar)(packedIndices >> (i * 8u));
+	}
+
+	void DecodeAlphaBlock(const uchar* input, uchar (*decoded)[4])
+	{
+		uint palette[8];
+		GetAlphaPalette(input[0], input[1], palette);
+
+		uint64_t indices = 0u;
+		for (uint i = 0u; i < 6u; ++i)
+			indices |= (uint64_t)input[2u + i] << (i * 8u);
+
+		for (uint i = 0u; i < BLOCK_PIXELS; ++i)
+			decoded[i][3] = (uchar)palette[(indices >> (i * 3u)) & 7u];
+	}
+
+	// BC7 fields are packed from the least significant bit of the first byte upwards.
+	void WriteBits(uchar* block, uint& position, uint value, uint count)
+	{
+		for (uint i = 0u; i < count; ++i, ++position)
+		{
+			if ((value >> i) & 1u)
+				block[position >> 3] |= (uchar)(1u << (position & 7u));
+		}
+	}
+
+	uint ReadBits(const uchar* block, uint& position, uint count)
+	{
+		uint value = 0u;
+		for (uint i = 0u; i < count; ++i, ++position)
+			value |= ((block[position >> 3] >> (position & 7u)) & 1u) << i;
+		return value;
+	}
+
+	// Widens an endpoint stored with fewer bits to 8 bits by replicating its top bits.
+	uint ExpandBits(uint value, uint bits)
+	{
+		value <<= 8u - bits;
+		return value | (value >> bits);
+	}
+
+	// Mode 6 endpoint: seven bits per channel and a p-bit that becomes the lowest bit of every channel.
+	struct Mode6Endpoint
+	{
+		uint values[4];
+		uint pbit;
+	};
+
+	Mode6Endpoint QuantizeMode6(const float* endpoint, uint pbit)
+	{
+		Mode6Endpoint quantized;
+		quantized.pbit = pbit;
+		for (uint channel = 0u; channel < 4u; ++channel)
+			quantized.values[channel] = (uint)std::clamp((int)std::lround((endpoint[channel] - pbit) * 0.5f), 0, 127);
+		return quantized;
+	}
+
+	float SelectMode6Indices(const Block& block, const Mode6Endpoint& endpoint0, const Mode6Endpoint& endpoint1, uint* indices)
+	{
+		float palette[16][4];
+		for (uint entry = 0u; entry < 16u; ++entry)
+		{
+			for (uint channel = 0u; channel < 4u; ++channel)
+			{
+				uint value0 = (endpoint0.values[channel] << 1) | endpoint0.pbit;
+				uint value1 = (endpoint1.values[channel] << 1) | endpoint1.pbit;
+				palette[entry][channel] = (float)Interpolate(value0, value1, WEIGHTS4[entry]);
+			}
+		}
+
+		// Projecting each pixel on the line between the endpoints gives the index up to rounding,
+		// so only it and its two neighbours are compared exactly.
+		float direction[4];
+		float lengthSquared = 0.0f;
+		for (uint channel = 0u; channel < 4u; ++channel)
+		{
+			direction[channel] = palette[15][channel] - palette[0][channel];
+			lengthSquared += direction[channel] * direction[channel];
+		}
+		float scale = lengthSquared > 0.0f ? 64.0f / lengthSquared : 0.0f;
+
+		float error = 0.0f;
+		for (uint i = 0u; i < BLOCK_PIXELS; ++i)
+		{
+			float projection = 0.0f;
+			for (uint channel = 0u; channel < 4u; ++channel)
+				projection += (block.pixels[i][channel] - palette[0][channel]) * direction[channel];
+			int weight = (int)(projection * scale);
+
+			uint guess = 0u;
+			while (guess < 15u && (int)WEIGHTS4[guess + 1u] <= weight)
+				++guess;
+
+			float bestDistance = INFINITE_ERROR;
+			for (uint entry = guess > 0u ? guess - 1u : 0u; entry <= std::min(guess + 1u, 15u); ++entry)
+			{
+				float distance = 0.0f;
+				for (uint channel = 0u; channel < 4u; ++channel)
+				{
+					float difference = block.pixels[i][channel] - palette[entry][channel];
+					distance += difference * difference;
+				}
+				if (distance < bestDistance)
+				{
+					bestDistance = distance;
+					indices[i] = entry;
+				}
+			}
+			error += bestDistance;
+		}
+		return error;
+	}
+
+	// Quantizes both endpoints with each of the four p-bit combinations and keeps the one with the smallest error.
+	float QuantizeMode6Endpoints(const Block& block, const float* endpoint0, const float* endpoint1,
+		Mode6Endpoint& quantized0, Mode6Endpoint& quantized1, uint* indices)
+	{
+		float bestError = INFINITE_ERROR;
+		for (uint pbits = 0u; pbits < 4u; ++pbits)
+		{
+			Mode6Endpoint candidate0 = QuantizeMode6(endpoint0, pbits & 1u);
+			Mode6Endpoint candidate1 = QuantizeMode6(endpoint1, pbits >> 1);
+			uint candidateIndices[BLOCK_PIXELS];
+			float error = SelectMode6Indices(block, candidate0, candidate1, candidateIndices);
+			if (error < bestError)
+			{
+				bestError = error;
+				quantized0 = candidate0;
+				quantized1 = candidate1;
+				memcpy(indices, candidateIndices, sizeof(candidateIndices));
+			}
+		}
+		return bestError;
+	}
+
+	// Writes a 16 byte BC7 block in mode 6: one subset, RGBA endpoints and 4-bit indices.
+	void EncodeBC7Block(const Block& block, uint refinements, uchar* output)
+	{
+		float endpoint0[4];
+		float endpoint1[4];
+		ComputeAxisEndpoints(block.pixels, BLOCK_PIXELS, 4u, 0.0f, endpoint0, endpoint1);
+
+		Mode6Endpoint quantized0, quantized1;
+		uint indices[BLOCK_PIXELS];
+		float bestError = QuantizeMode6Endpoints(block, endpoint0, endpoint1, quantized0, quantized1, indices);
+
+		float weights[16];
+		for (uint entry = 0u; entry < 16u; ++entry)
+			weights[entry] = WEIGHTS4[entry] / 64.0f;
+
+		for (uint pass = 0u; pass < refinements && bestError > 0.0f; ++pass)
+		{
+			if (!FitEndpoints(block, indices, weights, 4u, nullptr, endpoint0, endpoint1))
+				break;
+
+			Mode6Endpoint fitted0, fitted1;
+			uint fittedIndices[BLOCK_PIXELS];
+			float error = QuantizeMode6Endpoints(block, endpoint0, endpoint1, fitted0, fitted1, fittedIndices);
+			if (error >= bestError)
+				break;
+
+			bestError = error;
+			quantized0 = fitted0;
+			quantized1 = fitted1;
+			memcpy(indices, fittedIndices, sizeof(indices));
+		}
+
+		// The first index is stored without its top bit, so the endpoints are swapped when it is set.
+		if (indices[0] >= 8u)
+		{
+			std::swap(quantized0, quantized1);
+			for (uint i = 0u; i < BLOCK_PIXELS; ++i)
+				indices[i] = 15u - indices[i];
+		}
+
+		memset(output, 0, 16u);
+		uint position = 0u;
+		WriteBits(output, position, 1u << 6, 7u);
+		for (uint channel = 0u; channel < 4u; ++channel)
+		{
+			WriteBits(output, position, quantized0.values[channel], 7u);
+			WriteBits(output, position, quantized1.values[channel], 7u);
+		}
+		WriteBits(output, position, quantized0.pbit, 1u);
+		WriteBits(output, position, quantized1.pbit, 1u);
+		for (uint i = 0u; i < BLOCK_PIXELS; ++i)
+			WriteBits(output, position, indices[i], i == 0u ? 3u : 4u);
+	}
+
+	bool DecodeBC7Block(const uchar* input, uchar (*decoded)[4])
+	{
+		// The mode is the number of zero bits before the first set bit.
+		uint mode = 0u;
+		while (mode < 8u && !((input[0] >> mode) & 1u))
+			++mode;
+		uint position = mode + 1u;
+
+		uint endpoints[2][4];
+
+		if (mode == 6u)
+		{
+			for (uint channel = 0u; channel < 4u; ++channel)
+			{
+				endpoints[0][channel] = ReadBits(input, position, 7u) << 1;
+				endpoints[1][channel] = ReadBits(input, position, 7u) << 1;
+			}
+			uint pbit0 = ReadBits(input, position, 1u);
+			uint pbit1 = ReadBits(input, position, 1u);
+			for (uint channel = 0u; channel < 4u; ++channel)
+			{
+				endpoints[0][channel] |= pbit0;
+				endpoints[1][channel] |= pbit1;
+			}
+
+			for (uint i = 0u; i < BLOCK_PIXELS; ++i)
+			{
+				uint weight = WEIGHTS4[ReadBits(input, position, i == 0u ? 3u : 4u)];
+				for (uint channel = 0u; channel < 4u; ++channel)
+					decoded[i][channel] = (uchar)Interpolate(endpoints[0][channel], endpoints[1][channel], weight);
+			}
+			return true;
+		}
+
+		if (mode == 4u || mode == 5u)
+		{
+			uint rotation = ReadBits(input, position, 2u);
+			uint indexMode = mode == 4u ? ReadBits(input, position, 1u) : 0u;
+			uint colorBits = mode == 4u ? 5u : 7u;
+			uint alphaBits = mode == 4u ? 6u : 8u;
+
+			for (uint channel = 0u; channel < 3u; ++channel)
+			{
+				endpoints[0][channel] = ExpandBits(ReadBits(input, position, colorBits), colorBits);
+				endpoints[1][channel] = ExpandBits(ReadBits(input, position, colorBits), colorBits);
+			}
+			endpoints[0][3] = ExpandBits(ReadBits(input, position, alphaBits), alphaBits);
+			endpoints[1][3] = ExpandBits(ReadBits(input, position, alphaBits), alphaBits);
+
+			// Two index sets follow, each with a one bit shorter first index. The first normally drives color and
+			// the second alpha; in mode 4 the index mode bit swaps them.
+			uint primaryBits = 2u;
+			uint secondaryBits = mode == 4u ? 3u : 2u;
+			uint primary[BLOCK_PIXELS];
+			uint secondary[BLOCK_PIXELS];
+			for (uint i = 0u; i < BLOCK_PIXELS; ++i)
+				primary[i] = ReadBits(input, position, i == 0u ? primaryBits - 1u : primaryBits);
+			for (uint i = 0u; i < BLOCK_PIXELS; ++i)
+				secondary[i] = ReadBits(input, position, i == 0u ? secondaryBits - 1u : secondaryBits);
+
+			const uint* colorIndices = indexMode ? secondary : primary;
+			const uint* alphaIndices = indexMode ? primary : secondary;
+			const uint* colorWeights = (indexMode ? secondaryBits : primaryBits) == 3u ? WEIGHTS3 : WEIGHTS2;
+			const uint* alphaWeights = (indexMode ? primaryBits : secondaryBits) == 3u ? WEIGHTS3 : WEIGHTS2;
+
+			for (uint i = 0u; i < BLOCK_PIXELS; ++i)
+			{
+				for (uint channel = 0u; channel < 3u; ++channel)
+					decoded[i][channel] = (uchar)Interpolate(endpoints[0][channel], endpoints[1][channel], colorWeights[colorIndices[i]]);
+				decoded[i][3] = (uchar)Interpolate(endpoints[0][3], endpoints[1][3], alphaWeights[alphaIndices[i]]);
+
+				// The rotation swaps alpha with one of the color channels after decoding.
+				if (rotation != 0u)
+					std::swap(decoded[i][3], decoded[i][rotation - 1u]);
+			}
+			return true;
+		}
+
+		if (mode == 8u)
+		{
+			// Reserved mode: the specification decodes it as transparent black.
+			memset(decoded, 0, BLOCK_PIXELS * 4u);
+			return true;
+		}
+
+		return false;
+	}
+
+	double ComputePsnr(double squaredError, double sampleCount)
+	{
+		if (squaredError <= 0.0)
+			return std::numeric_limits<double>::infinity();
+		return 10.0 * std::log10(255.0 * 255.0 * sampleCount / squaredError);
+	}
+}
+
+uint BlockCompressor::GetBlockBytes(Format format)
+{
+	return format == Format::BC1 ? 8u : 16u;
+}
+
+size_t BlockCompressor::GetCompressedSize(Format format, uint width, uint height)
+{
+	return (size_t)((width + 3u) / 4u) * ((height + 3u) / 4u) * GetBlockBytes(format);
+}
+
+std::vector<uchar> BlockCompressor::Compress(const uchar* pixels, uint width, uint height, const Options& options)
+{
+	std::vector<uchar> blocks;
+	if (!pixels || width == 0u || height == 0u)
+		return blocks;
+
+	uint blocksWide = (width + 3u) / 4u;
+	uint blocksHigh = (height + 3u) / 4u;
+	uint blockBytes = GetBlockBytes(options.format);
+	blocks.resize(GetCompressedSize(options.format, width, height));
+
+	uint threadCount = options.threadCount;
+	if (threadCount == 0u)
+		threadCount = JobSystem::GetDefault().GetThreadCount();
+
+	// Every block is independent, so rows of blocks are simply shared out between the threads.
+	JobSystem::GetDefault().ParallelFor(blocksHigh, threadCount, [&](uint blockY)
+	{
+		uchar* output = blocks.data() + (size_t)blockY * blocksWide * blockBytes;
+		for (uint blockX = 0u; blockX < blocksWide; ++blockX, output += blockBytes)
+		{
+			Block block = LoadBlock(pixels, width, height, blockX, blockY);
+			switch (options.format)
+			{
+			case Format::BC1:
+				EncodeColorBlock(block, true, options.refinements, output);
+				break;
+			case Format::BC3:
+				EncodeAlphaBlock(block, output);
+				EncodeColorBlock(block, false, options.refinements, output + 8u);
+				break;
+			case Format::BC7:
+				EncodeBC7Block(block, options.refinements, output);
+				break;
+			}
+		}
+	});
+
+	return blocks;
+}
+
+std::vector<uchar> BlockCompressor::Decompress(const uchar* blocks, uint width, uint height, Format format)
+{
+	std::vector<uchar> pixels;
+	if (!blocks || width == 0u || height == 0u)
+		return pixels;
+
+	uint blocksWide = (width + 3u) / 4u;
+	uint blocksHigh = (height + 3u) / 4u;
+	uint blockBytes = GetBlockBytes(format);
+	pixels.resize((size_t)width * height * 4u);
+
+	const uchar* input = blocks;
+	for (uint blockY = 0u; blockY < blocksHigh; ++blockY)
+	{
+		for (uint blockX = 0u; blockX < blocksWide; ++blockX, input += blockBytes)
+		{
+			uchar decoded[BLOCK_PIXELS][4];
+			switch (format)
+			{
+			case Format::BC1:
+				DecodeColorBlock(input, true, decoded);
+				break;
+			case Format::BC3:
+				DecodeColorBlock(input + 8u, false, decoded);
+				DecodeAlphaBlock(input, decoded);
+				break;
+			case Format::BC7:
+				if (!DecodeBC7Block(input, decoded))
+					return std::vector<uchar>();
+				break;
+			}
+			StoreBlock(decoded, pixels.data(), width, height, blockX, blockY);
+		}
+	}
+
+	return pixels;
+}
+
+BlockCompressor::Measurement BlockCompressor::Measure(const uchar* pixels, uint width, uint height, const Options& options)
+{
+	Measurement measurement;
+	if (!pixels || width == 0u || height == 0u)
+		return measurement;
+
+	auto start = std::chrono::steady_clock::now();
+	std::vector<uchar> blocks = Compress(pixels, width, height, options);
+	double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+	std::vector<uchar> decoded = Decompress(blocks.data(), width, height, options.format);
+
+	size_t pixelCount = (size_t)width * height;
+	double colorError = 0.0;
+	double alphaError = 0.0;
+	for (size_t i = 0u; i < pixelCount * 4u; i += 4u)
+	{
+		for (uint channel = 0u; channel < 3u; ++channel)
+		{
+			double difference = (double)pixels[i + channel] - decoded[i + channel];
+			colorError += difference * difference;
+		}
+		double difference = (double)pixels[i + 3u] - decoded[i + 3u];
+		alphaError += difference * difference;
+	}
+
+	measurement.colorPsnr = ComputePsnr(colorError, (double)pixelCount * 3.0);
+	measurement.alphaPsnr = ComputePsnr(alphaError, (double)pixelCount);
+	measurement.megapixelsPerSecond = seconds > 0.0 ? pixelCount / seconds / 1e6 : 0.0;
+	return measurement;
+}
@@ -0,0 +1,46 @@
+#pragma once
+
+#include "Common.h"
+
+// CPU encoder and decoder for the BC1, BC3 and BC7 block compressed texture formats. Encoding works on top-down RGBA8
+// images of any size (edge blocks repeat the last column and row) and spreads rows of blocks across threads.
+// The library has no Direct3D dependency, so asset tools can use it and its quality and speed can be measured without a GPU.
+class BlockCompressor
+{
+public:
+
+	enum class Format
+	{
+		BC1,	// 4 bits per pixel, RGB with optional 1-bit alpha.
+		BC3,	// 8 bits per pixel, BC1 color plus an interpolated alpha block.
+		BC7		// 8 bits per pixel, RGBA with higher endpoint precision. Encoded with mode 6.
+	};
+
+	struct Options
+	{
+		Format format = Format::BC1;
+		uint refinements = 2u;	// Least squares endpoint refinement passes per block; 0 is fastest.
+		uint threadCount = 0u;	// 0 uses every thread of the job system.
+	};
+
+	// Quality and speed of one encode, as reported by Measure.
+	struct Measurement
+	{
+		double colorPsnr = 0.0;				// Peak signal to noise ratio over RGB in dB, infinite when lossless.
+		double alphaPsnr = 0.0;				// The same over alpha.
+		double megapixelsPerSecond = 0.0;	// Encoding throughput.
+	};
+
+	static uint GetBlockBytes(Format format);
+	static size_t GetCompressedSize(Format format, uint width, uint height);
+
+	// Encodes width * height RGBA8 pixels into rows of 4x4 blocks.
+	static std::vector<uchar> Compress(const uchar* pixels, uint width, uint height, const Options& options);
+
+	// Decodes blocks back to RGBA8. BC7 blocks are decoded for the single subset modes 4, 5 and 6;
+	// returns an empty vector if any block uses another mode.
+	static std::vector<uchar> Decompress(const uchar* blocks, uint width, uint height, Format format);
+
+	// Encodes the image, decodes it again and compares it with the original.
+	static Measurement Measure(const uchar* pixels, uint width, uint height, const Options& options);
+};
@@ -0,0 +1,80 @@
+#include "Bounds.h"
+
+#include <algorithm>
+#include <math.h>
+
+Bounds Bounds::FromPoints(const Math::Float3* points, size_t count, size_t stride)
+{
+	Bounds bounds;
+	if (count == 0u)
+		return bounds;
+
+	auto point = [&](size_t i) -> const Math::Float3& { return *(const Math::Float3*)((const uchar*)points + i * stride); };
+
+	// Find the box first, then the sphere around its centre that reaches the farthest point.
+	Math::Float3 minimum = point(0u);
+	Math::Float3 maximum = point(0u);
+	for (size_t i = 1u; i < count; ++i)
+	{
+		const Math::Float3& p = point(i);
+		minimum = Math::Float3(std::min(minimum.x, p.x), std::min(minimum.y, p.y), std::min(minimum.z, p.z));
+		maximum = Math::Float3(std::max(maximum.x, p.x), std::max(maximum.y, p.y), std::max(maximum.z, p.z));
+	}
+
+	bounds.center = Math::Float3((minimum.x + maximum.x) * 0.5f, (minimum.y + maximum.y) * 0.5f, (minimum.z + maximum.z) * 0.5f);
+	bounds.extents = Math::Float3((maximum.x - minimum.x) * 0.5f, (maximum.y - minimum.y) * 0.5f, (maximum.z - minimum.z) * 0.5f);
+
+	float radiusSquared = 0.0f;
+	for (size_t i = 0u; i < count; ++i)
+	{
+		const Math::Float3& p = point(i);
+		float x = p.x - bounds.center.x, y = p.y - bounds.center.y, z = p.z - bounds.center.z;
+		radiusSquared = std::max(radiusSquared, x * x + y * y + z * z);
+	}
+	bounds.radius = sqrtf(radiusSquared);
+	return bounds;
+}
+
+Bounds Bounds::Merge(const Bounds& a, const Bounds& b)
+{
+	Math::Float3 minimum(std::min(a.center.x - a.extents.x, b.center.x - b.extents.x), std::min(a.center.y - a.extents.y, b.center.y - b.extents.y),
+		std::min(a.center.z - a.extents.z, b.center.z - b.extents.z));
+	Math::Float3 maximum(std::max(a.center.x + a.extents.x, b.center.x + b.extents.x), std::max(a.center.y + a.extents.y, b.center.y + b.extents.y),
+		std::max(a.center.z + a.extents.z, b.center.z + b.extents.z));
+
+	Bounds merged;
+	merged.center = Math::Float3((minimum.x + maximum.x) * 0.5f, (minimum.y + maximum.y) * 0.5f, (minimum.z + maximum.z) * 0.5f);
+	merged.extents = Math::Float3((maximum.x - minimum.x) * 0.5f, (maximum.y - minimum.y) * 0.5f, (maximum.z - minimum.z) * 0.5f);
+
+	// The merged sphere shares the box centre, so it has to reach the far side of both input spheres from there.
+	auto reach = [&](const Bounds& bounds)
+	{
+		float x = bounds.center.x - merged.center.x, y = bounds.center.y - merged.center.y, z = bounds.center.z - merged.center.z;
+		return sqrtf(x * x + y * y + z * z) + bounds.radius;
+	};
+	merged.radius = std::max(reach(a), reach(b));
+	return merged;
+}
+
+Bounds Bounds::Transform(const Math::Matrix4& matrix) const
+{
+	const auto& m = matrix.m;
+
+	Bounds transformed;
+
+	// Row vectors: the centre is transformed as a point.
+	transformed.center.x = center.x * m[0][0] + center.y * m[1][0] + center.z * m[2][0] + m[3][0];
+	transformed.center.y = center.x * m[0][1] + center.y * m[1][1] + center.z * m[2][1] + m[3][1];
+	transformed.center.z = center.x * m[0][2] + center.y * m[1][2] + center.z * m[2][2] + m[3][2];
+
+	// Each world axis of the box gathers the absolute contribution of every local axis.
+	transformed.extents.x = extents.x * fabsf(m[0][0]) + extents.y * fabsf(m[1][0]) + extents.z * fabsf(m[2][0]);
+	transformed.extents.y = extents.x * fabsf(m[0][1]) + extents.y * fabsf(m[1][1]) + extents.z * fabsf(m[2][1]);
+	transformed.extents.z = extents.x * fabsf(m[0][2]) + extents.y * fabsf(m[1][2]) + extents.z * fabsf(m[2][2]);
+
+	float scaleX = m[0][0] * m[0][0] + m[0][1] * m[0][1] + m[0][2] * m[0][2];
+	float scaleY = m[1][0] * m[1][0] + m[1][1] * m[1][1] + m[1][2] * m[1][2];
+	float scaleZ = m[2][0] * m[2][0] + m[2][1] * m[2][1] + m[2][2] * m[2][2];
+	transformed.radius = radius * sqrtf(std::max(scaleX, std::max(scaleY, scaleZ)));
+	return transformed;
+}
@@ -0,0 +1,23 @@
+#pragma once
+
+#include "Common.h"
+#include "EngineMath.h"
+
+// Bounding volume of a mesh or object: an axis-aligned box and a sphere sharing the box's centre. Both are kept
+// because each is tighter for different shapes; culling treats an object as outside if either volume is.
+struct Bounds
+{
+	Math::Float3 center = { 0.0f, 0.0f, 0.0f };
+	Math::Float3 extents = { 0.0f, 0.0f, 0.0f };	// Half the size of the box along each axis.
+	float radius = 0.0f;
+
+	// Bounds of count positions spaced stride bytes apart.
+	static Bounds FromPoints(const Math::Float3* points, size_t count, size_t stride);
+
+	// Bounds that contain both a and b.
+	static Bounds Merge(const Bounds& a, const Bounds& b);
+
+	// Bounds of the volume after transforming it by an affine matrix. The box stays axis-aligned, so it grows
+	// under rotation; the sphere grows by the largest scale of the matrix.
+	Bounds Transform(const Math::Matrix4& matrix) const;
+};
@@ -0,0 +1,456 @@
+#include "Bvh.h"
+
+#include <algorithm>
+#include <chrono>
+
+namespace
+{
+	const uint BIN_COUNT = 16u;
+	const uint MAX_LEAF_ITEMS = 8u;		// Larger nodes are split even when the heuristic prefers a leaf.
+	const float TRAVERSAL_COST = 1.0f;	// Cost of visiting a node, relative to testing one item.
+	const uint ALL_PLANES = (1u << Frustum::PLANE_COUNT) - 1u;
+
+	float SurfaceArea(const Math::Float3& minimum, const Math::Float3& maximum)
+	{
+		float x = maximum.x - minimum.x, y = maximum.y - minimum.y, z = maximum.z - minimum.z;
+		return 2.0f * (x * y + y * z + z * x);
+	}
+
+	void Grow(Math::Float3& minimum, Math::Float3& maximum, const Math::Float3& otherMinimum, const Math::Float3& otherMaximum)
+	{
+		minimum = Math::Float3(std::min(minimum.x, otherMinimum.x), std::min(minimum.y, otherMinimum.y), std::min(minimum.z, otherMinimum.z));
+		maximum = Math::Float3(std::max(maximum.x, otherMaximum.x), std::max(maximum.y, otherMaximum.y), std::max(maximum.z, otherMaximum.z));
+	}
+
+	float GetAxis(const Math::Float3& vector, uint axis)
+	{
+		return axis == 0u ? vector.x : axis == 1u ? vector.y : vector.z;
+	}
+
+	// Tests a box, and optionally a sphere around the same centre, against the planes left in mask. Returns false if
+	// the volume is outside; clears the planes the box is entirely in front of, which its contents need not test again.
+	bool ClassifyVolume(const Frustum& frustum, const Math::Float3& center, const Math::Float3& extents, float radius, uint& mask)
+	{
+		for (uint p = 0u; p < Frustum::PLANE_COUNT; ++p)
+		{
+			if ((mask & (1u << p)) == 0u)
+				continue;
+
+			const Math::Float4& plane = frustum.GetPlane(p);
+			float distance = plane.x * center.x + plane.y * center.y + plane.z * center.z + plane.w;
+			float boxReach = fabsf(plane.x) * extents.x + fabsf(plane.y) * extents.y + fabsf(plane.z) * extents.z;
+			if (distance + std::min(boxReach, radius) < 0.0f)
+				return false;
+			if (distance - boxReach >= 0.0f)
+				mask &= ~(1u << p);
+		}
+		return true;
+	}
+
+	// Slab test of a node box against a ray given by its origin and the reciprocal of its direction.
+	bool IntersectBox(const Math::Float3& origin, const Math::Float3& inverseDirection, const Math::Float3& minimum, const Math::Float3& maximum,
+		float maxDistance, float& distance)
+	{
+		float x0 = (minimum.x - origin.x) * inverseDirection.x, x1 = (maximum.x - origin.x) * inverseDirection.x;
+		float y0 = (minimum.y - origin.y) * inverseDirection.y, y1 = (maximum.y - origin.y) * inverseDirection.y;
+		float z0 = (minimum.z - origin.z) * inverseDirection.z, z1 = (maximum.z - origin.z) * inverseDirection.z;
+
+		float enter = std::max(std::max(std::min(x0, x1), std::min(y0, y1)), std::max(std::min(z0, z1), 0.0f));
+		float exit = std::min(std::min(std::max(x0, x1), std::max(y0, y1)), std::min(std::max(z0, z1), maxDistance));
+		distance = enter;
+		return enter <= exit;
+	}
+
+	struct StackEntry
+	{
+		uint node;
+		uint mask;
+	};
+}
+
+void Bvh::Build(const std::vector<Bounds>& bounds)
+{
+	auto start = std::chrono::steady_clock::now();
+
+	uint itemCount = (uint)bounds.size();
+	_items.resize(itemCount);
+	_bounds = bounds;
+	_centroids.resize(itemCount);
+	for (uint i = 0u; i < itemCount; ++i)
+	{
+		_items[i] = i;
+		_centroids[i] = bounds[i].center;
+	}
+
+	// A tree over n items has at most 2n - 1 nodes; reserving them keeps node references valid while splitting.
+	_nodes.clear();
+	_nodes.reserve(std::max(1u, itemCount * 2u));
+	_nodes.push_back(Node{ Math::Float3(0.0f, 0.0f, 0.0f), 0u, Math::Float3(0.0f, 0.0f, 0.0f), itemCount });
+	FitNode(_nodes[0]);
+
+	_stats = Stats();
+	Subdivide(0u, 0u);
+
+	// Record where every item ended up, for SetBounds.
+	_slots.resize(itemCount);
+	_leaves.resize(itemCount);
+	for (uint slot = 0u; slot < itemCount; ++slot)
+		_slots[_items[slot]] = slot;
+	for (uint nodeIndex = 0u; nodeIndex < (uint)_nodes.size(); ++nodeIndex)
+	{
+		const Node& node = _nodes[nodeIndex];
+		for (uint slot = node.first; slot < node.first + node.count; ++slot)
+			_leaves[slot] = nodeIndex;
+	}
+
+	_dirtyNodes.assign(_nodes.size(), 0u);
+	_dirty = false;
+	_centroids.clear();
+
+	_buildCost = _cost = ComputeCost();
+	_stats.nodes = (uint)_nodes.size();
+	_stats.buildMilliseconds = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+}
+
+void Bvh::Subdivide(uint rootIndex, uint rootDepth)
+{
+	// Split depth first with an explicit stack; a badly distributed scene can make the tree deeper than the call stack allows.
+	std::vector<std::pair<uint, uint>> pending = { { rootIndex, rootDepth } };
+	while (!pending.empty())
+	{
+		auto [nodeIndex, depth] = pending.back();
+		pending.pop_back();
+		_stats.depth = std::max(_stats.depth, depth + 1u);
+
+		Node& node = _nodes[nodeIndex];
+		uint axis = 0u;
+		float position = 0.0f;
+		bool split = FindSplit(node, axis, position);
+		if (!split && node.count <= MAX_LEAF_ITEMS)
+		{
+			_stats.leaves++;
+			continue;
+		}
+
+		// Move the items left of the split to the front of the node's range, keeping the three slot arrays in step.
+		uint middle = node.first;
+		if (split)
+		{
+			for (uint slot = node.first; slot < node.first + node.count; ++slot)
+			{
+				if (GetAxis(_centroids[slot], axis) < position)
+				{
+					std::swap(_items[slot], _items[middle]);
+					std::swap(_bounds[slot], _bounds[middle]);
+					std::swap(_centroids[slot], _centroids[middle]);
+					middle++;
+				}
+			}
+		}
+
+		// Items that all share one centroid cannot be told apart by position; halve them instead.
+		if (middle == node.first || middle == node.first + node.count)
+			middle = node.first + node.count / 2u;
+
+		uint left = (uint)_nodes.size();
+		_nodes.push_back(Node{ Math::Float3(0.0f, 0.0f, 0.0f), node.first, Math::Float3(0.0f, 0.0f, 0.0f), middle - node.first });
+		_nodes.push_back(Node{ Math::Float3(0.0f, 0.0f, 0.0f), middle, Math::Float3(0.0f, 0.0f, 0.0f), node.first + node.count - middle });
+		FitNode(_nodes[left]);
+		FitNode(_nodes[left + 1u]);
+
+		node.first = left;
+		node.count = 0u;
+		pending.push_back({ left + 1u, depth + 1u });
+		pending.push_back({ left, depth + 1u });
+	}
+}
+
+bool Bvh::FindSplit(const Node& node, uint& bestAxis, float& bestPosition) const
+{
+	struct Bin
+	{
+		Math::Float3 minimum = Math::Float3(INFINITY, INFINITY, INFINITY);
+		Math::Float3 maximum = Math::Float3(-INFINITY, -INFINITY, -INFINITY);
+		uint count = 0u;
+	};
+
+	// Splitting pays off only if visiting two children and testing their items costs less than testing every item here.
+	// Nodes over the leaf size take the best split whatever it costs.
+	float area = SurfaceArea(node.minimum, node.maximum);
+	float bestCost = node.count > MAX_LEAF_ITEMS ? INFINITY : (node.count - TRAVERSAL_COST) * area;
+	bool found = false;
+
+	for (uint axis = 0u; axis < 3u; ++axis)
+	{
+		// Bin the items by centroid along the axis.
+		float minimum = INFINITY, maximum = -INFINITY;
+		for (uint slot = node.first; slot < node.first + node.count; ++slot)
+		{
+			float centroid = GetAxis(_centroids[slot], axis);
+			minimum = std::min(minimum, centroid);
+			maximum = std::max(maximum, centroid);
+		}
+		if (!(maximum > minimum))
+			continue;
+
+		Bin bins[BIN_COUNT];
+		float scale = BIN_COUNT / (maximum - minimum);
+		for (uint slot = node.first; slot < node.first + node.count; ++slot)
+		{
+			uint bin = std::min(BIN_COUNT - 1u, (uint)((GetAxis(_centroids[slot], axis) - minimum) * scale));
+			const Bounds& bounds = _bounds[slot];
+			Math::Float3 boundsMinimum(bounds.center.x - bounds.extents.x, bounds.center.y - bounds.extents.y, bounds.center.z - bounds.extents.z);
+			Math::Float3 boundsMaximum(bounds.center.x + bounds.extents.x, bounds.center.y + bounds.extents.y, bounds.center.z + bounds.extents.z);
+			Grow(bins[bin].minimum, bins[bin].maximum, boundsMinimum, boundsMaximum);
+			bins[bin].count++;
+		}
+
+		// Sweep from both ends to get the area and count on each side of every bin boundary.
+		// Boundaries with nothing on one side are no split at all.
+		float leftCost[BIN_COUNT - 1u];
+		Bin left, right;
+		for (uint i = 0u; i + 1u < BIN_COUNT; ++i)
+		{
+			left.count += bins[i].count;
+			Grow(left.minimum, left.maximum, bins[i].minimum, bins[i].maximum);
+			leftCost[i] = left.count > 0u ? left.count * SurfaceArea(left.minimum, left.maximum) : INFINITY;
+		}
+		for (uint i = BIN_COUNT - 1u; i > 0u; --i)
+		{
+			right.count += bins[i].count;
+			Grow(right.minimum, right.maximum, bins[i].minimum, bins[i].maximum);
+			if (right.count == 0u)
+				continue;
+
+			float cost = leftCost[i - 1u] + right.count * SurfaceArea(right.minimum, right.maximum);
+			if (cost < bestCost)
+			{
+				bestCost = cost;
+				bestAxis = axis;
+				bestPosition = minimum + i / scale;
+				found = true;
+			}
+		}
+	}
+
+	return found;
+}
+
+void Bvh::FitNode(Node& node) const
+{
+	node.minimum = Math::Float3(INFINITY, INFINITY, INFINITY);
+	node.maximum = Math::Float3(-INFINITY, -INFINITY, -INFINITY);
+	for (uint slot = node.first; slot < node.first + node.count; ++slot)
+	{
+		const Bounds& bounds = _bounds[slot];
+		Grow(node.minimum, node.maximum,
+			Math::Float3(bounds.center.x - bounds.extents.x, bounds.center.y - bounds.extents.y, bounds.center.z - bounds.extents.z),
+			Math::Float3(bounds.center.x + bounds.extents.x, bounds.center.y + bounds.extents.y, bounds.center.z + bounds.extents.z));
+	}
+}
+
+void Bvh::SetBounds(uint item, const Bounds& bounds)
+{
+	uint slot = _slots[item];
+	_bounds[slot] = bounds;
+	_dirtyNodes[_leaves[slot]] = 1u;
+	_dirty = true;
+}
+
+void Bvh::Refit()
+{
+	if (!_dirty)
+		return;
+
+	auto start = std::chrono::steady_clock::now();
+
+	// Children come after their parents, so walking backwards finishes both children before their parent.
+	for (uint nodeIndex = (uint)_nodes.size(); nodeIndex-- > 0u; )
+	{
+		Node& node = _nodes[nodeIndex];
+		if (node.count > 0u)
+		{
+			if (_dirtyNodes[nodeIndex])
+				FitNode(node);
+			continue;
+		}
+
+		uint left = node.first;
+		if (!_dirtyNodes[left] && !_dirtyNodes[left + 1u])
+			continue;
+
+		node.minimum = _nodes[left].minimum;
+		node.maximum = _nodes[left].maximum;
+		Grow(node.minimum, node.maximum, _nodes[left + 1u].minimum, _nodes[left + 1u].maximum);
+		_dirtyNodes[nodeIndex] = 1u;
+	}
+
+	std::fill(_dirtyNodes.begin(), _dirtyNodes.end(), (uchar)0u);
+	_dirty = false;
+	_cost = ComputeCost();
+	_stats.refitMilliseconds = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+}
+
+void Bvh::QueryFrustum(const Frustum& frustum, std::vector<uint>& items) const
+{
+	if (_items.empty())
+		return;
+
+	std::vector<StackEntry> stack;
+	stack.reserve(64u);
+	stack.push_back({ 0u, ALL_PLANES });
+	while (!stack.empty())
+	{
+		StackEntry entry = stack.back();
+		stack.pop_back();
+
+		// A node inside every plane needs no more tests below it.
+		const Node& node = _nodes[entry.node];
+		if (entry.mask == 0u)
+		{
+			if (node.count > 0u)
+			{
+				items.insert(items.end(), _items.begin() + node.first, _items.begin() + node.first + node.count);
+			}
+			else
+			{
+				stack.push_back({ node.first + 1u, 0u });
+				stack.push_back({ node.first, 0u });
+			}
+			continue;
+		}
+
+		Math::Float3 center((node.minimum.x + node.maximum.x) * 0.5f, (node.minimum.y + node.maximum.y) * 0.5f, (node.minimum.z + node.maximum.z) * 0.5f);
+		Math::Float3 extents((node.maximum.x - node.minimum.x) * 0.5f, (node.maximum.y - node.minimum.y) * 0.5f, (node.maximum.z - node.minimum.z) * 0.5f);
+
+		uint mask = entry.mask;
+		if (!ClassifyVolume(frustum, center, extents, INFINITY, mask))
+			continue;
+
+		if (node.count == 0u)
+		{
+			stack.push_back({ node.first + 1u, mask });
+			stack.push_back({ node.first, mask });
+			continue;
+		}
+
+		for (uint slot = node.first; slot < node.first + node.count; ++slot)
+		{
+			const Bounds& bounds = _bounds[slot];
+			uint itemMask = mask;
+			if (ClassifyVolume(frustum, bounds.center, bounds.extents, bounds.radius, itemMask))
+				items.push_back(_items[slot]);
+		}
+	}
+}
+
+bool Bvh::Raycast(const Ray& ray, Hit& hit, float maxDistance) const
+{
+	if (_items.empty())
+		return false;
+
+	Math::Float3 inverseDirection(1.0f / ray.direction.x, 1.0f / ray.direction.y, 1.0f / ray.direction.z);
+	float nearest = maxDistance;
+	bool found = false;
+
+	float rootDistance;
+	if (!IntersectBox(ray.origin, inverseDirection, _nodes[0].minimum, _nodes[0].maximum, nearest, rootDistance))
+		return false;
+
+	std::vector<std::pair<uint, float>> stack;
+	stack.reserve(64u);
+	stack.push_back({ 0u, rootDistance });
+	while (!stack.empty())
+	{
+		auto [nodeIndex, entryDistance] = stack.back();
+		stack.pop_back();
+
+		// Something nearer was found since the node was pushed.
+		if (entryDistance > nearest)
+			continue;
+
+		const Node& node = _nodes[nodeIndex];
+		if (node.count > 0u)
+		{
+			for (uint slot = node.first; slot < node.first + node.count; ++slot)
+			{
+				float distance;
+				if (ray.Intersects(_bounds[slot], distance) && distance < nearest)
+				{
+					nearest = distance;
+					hit.item = _items[slot];
+					hit.distance = distance;
+					found = true;
+				}
+			}
+			continue;
+		}
+
+		// Visit the nearer child first, so the farther one is often skipped.
+		uint left = node.first;
+		float leftDistance, rightDistance;
+		bool hitLeft = IntersectBox(ray.origin, inverseDirection, _nodes[left].minimum, _nodes[left].maximum, nearest, leftDistance);
+		bool hitRight = IntersectBox(ray.origin, inverseDirection, _nodes[left + 1u].minimum, _nodes[left + 1u].maximum, nearest, rightDistance);
+		if (hitLeft && hitRight)
+		{
+			if (leftDistance <= rightDistance)
+			{
+				stack.push_back({ left + 1u, rightDistance });
+				stack.push_back({ left, leftDistance });
+			}
+			else
+			{
+				stack.push_back({ left, leftDistance });
+				stack.push_back({ left + 1u, rightDistance });
+			}
+		}
+		else if (hitLeft)
+		{
+			stack.push_back({ left, leftDistance });
+		}
+		else if (hitRight)
+		{
+			stack.push_back({ left + 1u, rightDistance });
+		}
+	}
+
+	return found;
+}
+
+uint Bvh::GetItemCount() const
+{
+	return (uint)_items.size();
+}
+
+float Bvh::ComputeCost() const
+{
+	if (_nodes.empty())
+		return 0.0f;
+
+	float rootArea = SurfaceArea(_nodes[0].minimum, _nodes[0].maximum);
+	if (!(rootArea > 0.0f))
+		return 0.0f;
+
+	float cost = 0.0f;
+	for (const Node& node : _nodes)
+	{
+		float area = SurfaceArea(node.minimum, node.maximum) / rootArea;
+		cost += node.count > 0u ? area * node.count : area * TRAVERSAL_COST;
+	}
+	return cost;
+}
+
+float Bvh::GetCost() const
+{
+	return _cost;
+}
+
+float Bvh::GetBuildCost() const
+{
+	return _buildCost;
+}
+
+const Bvh::Stats& Bvh::GetStats() const
+{
+	return _stats;
+}
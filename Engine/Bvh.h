@@ -0,0 +1,92 @@
+#pragma once
+
+#include <math.h>
+#include "Bounds.h"
+#include "Common.h"
+#include "EngineMath.h"
+#include "Frustum.h"
+#include "Ray.h"
+
+// Bounding volume hierarchy over a set of items (scene objects), each given by its Bounds and identified by its
+// index in the array Build was given.
+//
+// - Build splits nodes with a binned surface area heuristic, so queries visit few nodes for any distribution.
+// - Nodes are flattened into one array of 32-byte entries: box, then either the first item and count of a leaf or
+//   the index of the first of two adjacent children. Children always come after their parent and items of a leaf
+//   are stored contiguously, with their bounds copied next to each other, so traversal walks forward through memory.
+// - Moving items are handled by SetBounds and Refit, which recomputes only the boxes above changed leaves. Refit
+//   keeps the tree shape, so its quality drifts as items move; GetCost against GetBuildCost tells when to Build again.
+//
+// The hierarchy has no Direct3D dependency. Queries are const and may run on several threads at once.
+class Bvh
+{
+public:
+
+	struct Hit
+	{
+		uint item = ~0u;
+		float distance = 0.0f;
+	};
+
+	struct Stats
+	{
+		uint nodes = 0u;
+		uint leaves = 0u;
+		uint depth = 0u;
+		double buildMilliseconds = 0.0;
+		double refitMilliseconds = 0.0;	// Of the last Refit.
+	};
+
+	// Builds the hierarchy over the bounds, replacing any previous one.
+	void Build(const std::vector<Bounds>& bounds);
+
+	// Replaces one item's bounds. The hierarchy reflects it after the next Refit.
+	void SetBounds(uint item, const Bounds& bounds);
+
+	// Brings the node boxes above every changed item up to date.
+	void Refit();
+
+	// Appends the items whose bounds intersect the frustum, in no particular order.
+	void QueryFrustum(const Frustum& frustum, std::vector<uint>& items) const;
+
+	// Finds the nearest item whose box the ray enters within maxDistance. False if there is none.
+	bool Raycast(const Ray& ray, Hit& hit, float maxDistance = INFINITY) const;
+
+	uint GetItemCount() const;
+
+	// Expected cost of a query relative to testing the root box alone, by the surface area heuristic.
+	float GetCost() const;
+	float GetBuildCost() const;
+
+	const Stats& GetStats() const;
+
+private:
+
+	struct Node
+	{
+		Math::Float3 minimum;
+		uint first;	// Leaf: first item slot. Inner node: index of the left child; the right child follows it.
+		Math::Float3 maximum;
+		uint count;	// Leaf: number of items. Inner node: 0.
+	};
+
+	void Subdivide(uint nodeIndex, uint depth);
+	void FitNode(Node& node) const;
+	bool FindSplit(const Node& node, uint& axis, float& position) const;
+	float ComputeCost() const;
+
+	std::vector<Node> _nodes;
+	std::vector<uchar> _dirtyNodes;
+
+	// Items in leaf order: the item in each slot, its bounds and its leaf, and the slot of every item.
+	std::vector<uint> _items;
+	std::vector<Bounds> _bounds;
+	std::vector<uint> _leaves;
+	std::vector<uint> _slots;
+	std::vector<Math::Float3> _centroids; // Scratch space of Build.
+
+	float _buildCost = 0.0f;
+	float _cost = 0.0f;
+	bool _dirty = false;
+	Stats _stats;
+};
@@ -0,0 +1,141 @@
+#include "BvhBenchmark.h"
+#include "Bvh.h"
+#include "FrustumCuller.h"
+
+#include <algorithm>
+#include <chrono>
+#include <math.h>
+#include <random>
+
+namespace
+{
+	const uint OBJECT_COUNTS[] = { 100000u, 1000000u };
+	const float WORLD_SIZE = 1000.0f;	// Objects are scattered over a cube this wide around the camera.
+	const uint QUERY_COUNT = 10u;		// Frustum queries per size, each from a different direction.
+	const uint RAY_COUNT = 1000u;
+
+	double MillisecondsSince(std::chrono::steady_clock::time_point start)
+	{
+		return std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+	}
+
+	Bounds RandomBounds(std::mt19937& random)
+	{
+		std::uniform_real_distribution<float> position(-WORLD_SIZE * 0.5f, WORLD_SIZE * 0.5f);
+		std::uniform_real_distribution<float> size(0.5f, 5.0f);
+
+		Bounds bounds;
+		bounds.center = Math::Float3(position(random), position(random), position(random));
+		bounds.extents = Math::Float3(size(random), size(random), size(random));
+		bounds.radius = sqrtf(bounds.extents.x * bounds.extents.x + bounds.extents.y * bounds.extents.y + bounds.extents.z * bounds.extents.z);
+		return bounds;
+	}
+
+	// Nearest hit by testing every object.
+	bool RaycastBruteForce(const std::vector<Bounds>& bounds, const Ray& ray, Bvh::Hit& hit)
+	{
+		bool found = false;
+		for (uint i = 0u; i < (uint)bounds.size(); ++i)
+		{
+			float distance;
+			if (ray.Intersects(bounds[i], distance) && (!found || distance < hit.distance))
+			{
+				hit.item = i;
+				hit.distance = distance;
+				found = true;
+			}
+		}
+		return found;
+	}
+}
+
+bool RunBvhBenchmark(std::ostream& output)
+{
+	bool allMatch = true;
+	std::mt19937 random(1u);
+	std::uniform_real_distribution<float> angle(0.0f, Math::TWO_PI);
+	std::uniform_real_distribution<float> unit(-1.0f, 1.0f);
+
+	output << std::format("Bounding volume hierarchy against brute force, {} frustum queries and {} rays per size", QUERY_COUNT, RAY_COUNT) << std::endl;
+
+	for (uint objectCount : OBJECT_COUNTS)
+	{
+		std::vector<Bounds> bounds(objectCount);
+		for (Bounds& object : bounds)
+			object = RandomBounds(random);
+
+		Bvh bvh;
+		bvh.Build(bounds);
+
+		// Move every object a little and refit, as a scene where everything moves each frame would.
+		for (uint i = 0u; i < objectCount; ++i)
+		{
+			bounds[i].center.x += 0.5f;
+			bvh.SetBounds(i, bounds[i]);
+		}
+		bvh.Refit();
+
+		FrustumCuller culler;
+		culler.Reserve(objectCount);
+		for (const Bounds& object : bounds)
+			culler.Add(object);
+
+		// Frustum queries from the origin in random directions.
+		double bvhCull = 0.0, bruteCull = 0.0;
+		size_t visibleTotal = 0u;
+		for (uint query = 0u; query < QUERY_COUNT; ++query)
+		{
+			float yaw = angle(random);
+			Math::Matrix4 view = Math::LookToLH(Math::Float3(0.0f, 0.0f, 0.0f), Math::Float3(sinf(yaw), 0.0f, cosf(yaw)),
+				Math::Float3(0.0f, 1.0f, 0.0f));
+			Math::Matrix4 projection = Math::PerspectiveFovLH(Math::PI / 4.0f, 16.0f / 9.0f, 0.3f, WORLD_SIZE * 0.5f);
+			Frustum frustum(Math::Multiply(view, projection));
+
+			std::vector<uint> fromBvh, fromCuller;
+			auto start = std::chrono::steady_clock::now();
+			bvh.QueryFrustum(frustum, fromBvh);
+			bvhCull += MillisecondsSince(start);
+
+			culler.Cull(frustum, fromCuller, 1u);
+			bruteCull += culler.GetStats().cullMilliseconds;
+
+			std::sort(fromBvh.begin(), fromBvh.end());
+			allMatch = allMatch && fromBvh == fromCuller;
+			visibleTotal += fromCuller.size();
+		}
+
+		// Rays from random points in random directions.
+		double bvhRays = 0.0, bruteRays = 0.0;
+		uint hits = 0u;
+		for (uint i = 0u; i < RAY_COUNT; ++i)
+		{
+			Ray ray;
+			ray.origin = Math::Float3(unit(random) * WORLD_SIZE * 0.5f, unit(random) * WORLD_SIZE * 0.5f, unit(random) * WORLD_SIZE * 0.5f);
+			ray.direction = Math::Normalize(Math::Float3(unit(random), unit(random), unit(random)));
+
+			Bvh::Hit fromBvh, fromBruteForce;
+			auto start = std::chrono::steady_clock::now();
+			bool hitBvh = bvh.Raycast(ray, fromBvh);
+			bvhRays += MillisecondsSince(start);
+
+			start = std::chrono::steady_clock::now();
+			bool hitBruteForce = RaycastBruteForce(bounds, ray, fromBruteForce);
+			bruteRays += MillisecondsSince(start);
+
+			allMatch = allMatch && hitBvh == hitBruteForce && (!hitBvh || fromBvh.distance == fromBruteForce.distance);
+			hits += hitBvh ? 1u : 0u;
+		}
+
+		const Bvh::Stats& stats = bvh.GetStats();
+		output << std::format("{:>8} objects: build {:.1f} ms ({} nodes, depth {}), refit {:.2f} ms, cost {:.2f} after refit, {:.2f} built",
+			objectCount, stats.buildMilliseconds, stats.nodes, stats.depth, stats.refitMilliseconds, bvh.GetCost(), bvh.GetBuildCost()) << std::endl;
+		output << std::format("          frustum: bvh {:.3f} ms, brute force {:.3f} ms per query, {} visible on average", bvhCull / QUERY_COUNT,
+			bruteCull / QUERY_COUNT, visibleTotal / QUERY_COUNT) << std::endl;
+		output << std::format("          rays: bvh {:.2f} us, brute force {:.2f} us per ray, {} of {} hit", bvhRays * 1000.0 / RAY_COUNT,
+			bruteRays * 1000.0 / RAY_COUNT, hits, RAY_COUNT) << std::endl;
+	}
+
+	if (!allMatch)
+		output << "MISMATCH between the hierarchy and brute force" << std::endl;
+	return allMatch;
+}
@@ -0,0 +1,9 @@
+#pragma once
+
+#include <ostream>
+#include "Common.h"
+
+// Compares the bounding volume hierarchy with brute force on 100k and 1M random objects: build and refit times,
+// frustum queries against FrustumCuller, and ray casts against testing every object. Checks that both give the same
+// answers. Run with "Engine.exe -benchmark-bvh". Returns false if they disagree.
+bool RunBvhBenchmark(std::ostream& output);
@@ -14,62 +14,29 @@ void Camera::SetRotation(float x, float y, float z)
 	_rotationZ = z;
 }
 
-DirectX::XMFLOAT3 Camera::GetPosition()
+Math::Float3 Camera::GetPosition()
 {
-	return DirectX::XMFLOAT3(_positionX, _positionY, _positionZ);
+	return Math::Float3(_positionX, _positionY, _positionZ);
 }
 
-DirectX::XMFLOAT3 Camera::GetRotation()
+Math::Float3 Camera::GetRotation()
 {
-	return DirectX::XMFLOAT3(_rotationX, _rotationY, _rotationZ);
+	return Math::Float3(_rotationX, _rotationY, _rotationZ);
 }
 
 void Camera::Render() 
 {
-	DirectX::XMFLOAT3 up, position, lookAt;
-	float yaw, pitch, roll;
+	Math::Float3 position(_positionX, _positionY, _positionZ);
 
-	up.x = 0.0f;
-	up.y = 1.0f;
-	up.z = 0.0f;
+	// Look at a fixed point over the grid, with the up vector perpendicular to the view and to the screen's right.
+	Math::Float3 focusPosition(5.0f, 5.0f, 0.0f);
+	Math::Float3 cameraRight(0.71f, -0.71f, 0.0f);
+	Math::Float3 up = Math::Cross(focusPosition - position, cameraRight);
 
-	position.x = _positionX;
-	position.y = _positionY;
-	position.z = _positionZ;
-
-	lookAt.x = 0.0f;
-	lookAt.y = 0.0f;
-	lookAt.z = 1.0f;
-
-	pitch = _rotationX * 0.0174532925f;
-	yaw = _rotationY * 0.0174532925f;
-	roll = _rotationZ * 0.0174532925f;
-
-	//DirectX::XMMATRIX rotationMatrix = DirectX::XMMatrixRotationRollPitchYaw(pitch, yaw, roll);
-
-	//DirectX::XMVECTOR lookAtVector = DirectX::XMVector3TransformCoord(DirectX::XMLoadFloat3(&lookAt), rotationMatrix);
-	//DirectX::XMVECTOR upVector = DirectX::XMVector3TransformCoord(DirectX::XMLoadFloat3(&up), rotationMatrix);
-	DirectX::XMVECTOR positionVector = DirectX::XMLoadFloat3(&position);
-
-	//lookAtVector = DirectX::XMVectorAdd(positionVector, lookAtVector);
-
-	DirectX::XMFLOAT3 focusPosition;
-	focusPosition.x = 5.0f;
-	focusPosition.y = 5.0f;
-	focusPosition.z = 0.0f;
-
-	auto lookAtV = DirectX::XMVectorSubtract(DirectX::XMLoadFloat3(&focusPosition), positionVector);
-	DirectX::XMFLOAT3 cameraRight;
-	cameraRight.x = 0.71f;
-	cameraRight.y = -0.71f;
-	cameraRight.z = 0.0f;
-
-	auto upV = DirectX::XMVector3Cross(lookAtV, DirectX::XMLoadFloat3(&cameraRight));
-
-	_viewMatrix = DirectX::XMMatrixLookAtLH(positionVector, DirectX::XMLoadFloat3(&focusPosition), upV);
+	_viewMatrix = Math::LookAtLH(position, focusPosition, up);
 }
 
-void Camera::GetViewMatrix(DirectX::XMMATRIX& viewMatrix)
+void Camera::GetViewMatrix(Math::Matrix4& viewMatrix)
 {
 	viewMatrix = _viewMatrix;
 }
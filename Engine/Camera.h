@@ -1,6 +1,6 @@
 #pragma once
 
-#include <directxmath.h>
+#include "EngineMath.h"
 
 class Camera
 {
@@ -9,11 +9,11 @@ public:
 	void SetPosition(float, float, float);
 	void SetRotation(float, float, float);
 
-	DirectX::XMFLOAT3 GetPosition();
-	DirectX::XMFLOAT3 GetRotation();
+	Math::Float3 GetPosition();
+	Math::Float3 GetRotation();
 
 	void Render();
-	void GetViewMatrix(DirectX::XMMATRIX&);
+	void GetViewMatrix(Math::Matrix4&);
 
 private:
 	float _positionX = 0.0f;
@@ -23,5 +23,5 @@ private:
 	float _rotationY = 0.0f;
 	float _rotationZ = 0.0f;
 
-	DirectX::XMMATRIX _viewMatrix;
+	Math::Matrix4 _viewMatrix;
 };
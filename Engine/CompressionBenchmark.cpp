@@ -0,0 +1,211 @@
+#include "CompressionBenchmark.h"
+#include "BlockCompressor.h"
+#include "DdsFile.h"
+#include "PixelConvert.h"
+#include "TargaDecoder.h"
+
+#include <algorithm>
+#include <filesystem>
+#include <limits>
+#include <string.h>
+
+namespace
+{
+	const uint GRADIENT_SIZE = 512u;
+	const uint MEASURE_RUNS = 5u;	// Throughput is the best of these; the quality is the same every run.
+	const uint REFINEMENTS[] = { 0u, 2u };
+
+	// Below these a format is broken rather than lossy.
+	const double MIN_COLOR_PSNR = 20.0;
+	const double MIN_ALPHA_PSNR = 25.0;
+
+	const BlockCompressor::Format FORMATS[] = { BlockCompressor::Format::BC1, BlockCompressor::Format::BC3, BlockCompressor::Format::BC7 };
+	const char* const FORMAT_NAMES[] = { "BC1", "BC3", "BC7" };
+	const DdsFile::Format DDS_FORMATS[] = { DdsFile::Format::BC1, DdsFile::Format::BC3, DdsFile::Format::BC7 };
+
+	struct TestImage
+	{
+		std::string name;
+		uint width = 0u;
+		uint height = 0u;
+		std::vector<uchar> pixels;	// Top-down RGBA8.
+	};
+
+	bool LoadTarga(const std::filesystem::path& path, TestImage& image)
+	{
+		TargaDecoder decoder(path.string().c_str());
+		if (!decoder.IsValid())
+			return false;
+
+		image.width = decoder.GetWidth();
+		image.height = decoder.GetHeight();
+		image.pixels.resize((size_t)image.width * image.height * 4u);
+		return decoder.Decode(image.pixels.data());
+	}
+
+	// Uncompressed DDS files only; compressed ones are already blocks.
+	bool LoadDds(const std::filesystem::path& path, TestImage& image)
+	{
+		DdsFile dds(path.string().c_str());
+		if (!dds.IsValid() || DdsFile::IsBlockCompressed(dds.GetFormat()))
+			return false;
+
+		DdsFile::Level level = dds.GetLevel(0u);
+		image.width = level.width;
+		image.height = level.height;
+		image.pixels.resize((size_t)image.width * image.height * 4u);
+		for (uint y = 0u; y < image.height; ++y)
+		{
+			const uchar* source = level.data + (size_t)y * level.rowPitch;
+			uchar* destination = image.pixels.data() + (size_t)y * image.width * 4u;
+			switch (dds.GetFormat())
+			{
+			case DdsFile::Format::R8G8B8A8:
+			case DdsFile::Format::R8G8B8A8Srgb:
+				memcpy(destination, source, (size_t)image.width * 4u);
+				break;
+			case DdsFile::Format::B8G8R8A8:
+			case DdsFile::Format::B8G8R8A8Srgb:
+				PixelConvert::BgraToRgba(source, destination, image.width);
+				break;
+			case DdsFile::Format::B8G8R8X8:
+				PixelConvert::BgraToRgba(source, destination, image.width);
+				for (uint x = 0u; x < image.width; ++x)
+					destination[x * 4u + 3u] = 255u;
+				break;
+			default:
+				return false;
+			}
+		}
+		return true;
+	}
+
+	// Smooth ramps in every channel, where banding from too few endpoint bits shows up most.
+	TestImage MakeGradient()
+	{
+		TestImage image;
+		image.name = "gradient (synthetic)";
+		image.width = GRADIENT_SIZE;
+		image.height = GRADIENT_SIZE;
+		image.pixels.resize((size_t)GRADIENT_SIZE * GRADIENT_SIZE * 4u);
+		for (uint y = 0u; y < GRADIENT_SIZE; ++y)
+		{
+			for (uint x = 0u; x < GRADIENT_SIZE; ++x)
+			{
+				uchar* pixel = image.pixels.data() + ((size_t)y * GRADIENT_SIZE + x) * 4u;
+				pixel[0] = (uchar)(x * 255u / (GRADIENT_SIZE - 1u));
+				pixel[1] = (uchar)(y * 255u / (GRADIENT_SIZE - 1u));
+				pixel[2] = (uchar)((x + y) * 255u / (2u * (GRADIENT_SIZE - 1u)));
+				pixel[3] = (uchar)(255u - x * 255u / (GRADIENT_SIZE - 1u));
+			}
+		}
+		return image;
+	}
+
+	// Whether the blocks read back from a DDS file exactly as they were written.
+	bool SurvivesDds(const std::vector<uchar>& blocks, DdsFile::Format format, uint width, uint height, const std::filesystem::path& path)
+	{
+		DdsFile written(format, width, height);
+		written.AddLevel(blocks.data());
+		if (!written.Save(path.string().c_str()))
+			return false;
+
+		DdsFile read(path.string().c_str());
+		if (!read.IsValid() || read.GetFormat() != format || read.GetWidth() != width || read.GetHeight() != height || read.GetLevelCount() != 1u)
+			return false;
+		return memcmp(read.GetLevel(0u).data, blocks.data(), blocks.size()) == 0;
+	}
+
+	// BC1 is for opaque textures: its one bit of alpha turns every texel below half alpha into transparent black,
+	// which would count as color error. It is measured on a copy of the image with alpha set to 255.
+	std::vector<uchar> MakeOpaque(const std::vector<uchar>& pixels)
+	{
+		std::vector<uchar> opaque = pixels;
+		for (size_t i = 3u; i < opaque.size(); i += 4u)
+			opaque[i] = 255u;
+		return opaque;
+	}
+
+	std::string FormatPsnr(double psnr)
+	{
+		return psnr == std::numeric_limits<double>::infinity() ? std::string("lossless") : std::format("{:.2f} dB", psnr);
+	}
+}
+
+bool RunCompressionBenchmark(const char* assetDirectory, std::ostream& output)
+{
+	namespace fs = std::filesystem;
+
+	bool allMatch = true;
+	std::error_code error;
+	fs::path ddsPath = fs::temp_directory_path(error) / "compression-benchmark.dds";
+
+	// Every texture shipped with the engine, then the gradient.
+	std::vector<TestImage> images;
+	std::vector<fs::path> paths;
+	for (fs::directory_iterator it(assetDirectory, error), end; !error && it != end; it.increment(error))
+	{
+		if (it->is_regular_file(error))
+			paths.push_back(it->path());
+	}
+	std::sort(paths.begin(), paths.end());
+	for (const fs::path& path : paths)
+	{
+		std::string extension = path.extension().string();
+		if (extension != ".tga" && extension != ".dds")
+			continue;
+
+		TestImage image;
+		image.name = path.filename().string();
+		bool loaded = extension == ".tga" ? LoadTarga(path, image) : LoadDds(path, image);
+		if (!loaded)
+		{
+			output << std::format("{}: could not be loaded: MISMATCH", image.name) << std::endl;
+			allMatch = false;
+			continue;
+		}
+		images.push_back(std::move(image));
+	}
+	if (images.empty())
+	{
+		output << std::format("No textures found in {}", assetDirectory) << std::endl;
+		allMatch = false;
+	}
+	images.push_back(MakeGradient());
+
+	for (const TestImage& image : images)
+	{
+		output << std::format("{} {}x{}", image.name, image.width, image.height) << std::endl;
+		std::vector<uchar> opaque = MakeOpaque(image.pixels);
+		for (uint i = 0u; i < sizeof(FORMATS) / sizeof(FORMATS[0]); ++i)
+		{
+			const uchar* pixels = FORMATS[i] == BlockCompressor::Format::BC1 ? opaque.data() : image.pixels.data();
+			for (uint refinements : REFINEMENTS)
+			{
+				BlockCompressor::Options options;
+				options.format = FORMATS[i];
+				options.refinements = refinements;
+
+				BlockCompressor::Measurement measurement;
+				for (uint run = 0u; run < MEASURE_RUNS; ++run)
+				{
+					BlockCompressor::Measurement next = BlockCompressor::Measure(pixels, image.width, image.height, options);
+					if (next.megapixelsPerSecond > measurement.megapixelsPerSecond)
+						measurement = next;
+				}
+
+				bool match = measurement.colorPsnr >= MIN_COLOR_PSNR && measurement.alphaPsnr >= MIN_ALPHA_PSNR;
+
+				std::vector<uchar> blocks = BlockCompressor::Compress(pixels, image.width, image.height, options);
+				match = SurvivesDds(blocks, DDS_FORMATS[i], image.width, image.height, ddsPath) && match;
+				allMatch = allMatch && match;
+
+				output << std::format("  {} refinements {}: color {}, alpha {}, {:.1f} MPix/s: {}", FORMAT_NAMES[i], refinements,
+					FormatPsnr(measurement.colorPsnr), FormatPsnr(measurement.alphaPsnr), measurement.megapixelsPerSecond, match ? "OK" : "MISMATCH") << std::endl;
+			}
+		}
+	}
+
+	fs::remove(ddsPath, error);
+	return allMatch;
+}
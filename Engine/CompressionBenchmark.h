@@ -0,0 +1,11 @@
+#pragma once
+
+#include <ostream>
+#include "Common.h"
+
+// Measures BlockCompressor on the textures shipped in assetDirectory and on a synthetic gradient: for BC1, BC3 and
+// BC7, with and without endpoint refinement, it prints the color and alpha PSNR of the decoded blocks against the
+// source and the encoding throughput in MPix/s. BC1 is measured with alpha made opaque. Checks that every texture
+// loads, that every encode decodes again above a minimum quality, and that the blocks survive a DDS save and load.
+// Run with "Engine.exe -benchmark-compression". Returns false if any check fails.
+bool RunCompressionBenchmark(const char* assetDirectory, std::ostream& output);
@@ -0,0 +1,15 @@
+#pragma once
+
+#include "Common.h"
+#include "RingAllocator.h"
+
+// A constant block written into a ConstantBufferRing: where it is and how to bind it. Kept apart from the ring, so
+// code that only carries allocations, such as DrawList, needs no device headers.
+struct ConstantAllocation
+{
+	size_t offset = RingAllocator::INVALID_OFFSET;
+	uint size = 0u;
+	bool staged = false; // Held in the CPU copy rather than the ring.
+
+	bool IsValid() const;
+};
@@ -0,0 +1,245 @@
+#include "ConstantBufferRing.h"
+#include "D3DContext.h"
+
+#include <string.h>
+
+#ifdef _WIN32
+#include "D3D.h"
+#endif
+
+bool ConstantAllocation::IsValid() const
+{
+	return offset != RingAllocator::INVALID_OFFSET;
+}
+
+ConstantBufferRing::ConstantBufferRing(RenderBackend& renderer, size_t capacity)
+	: _device(GetDevice(renderer))
+	, _deviceContext(GetDeviceContext(renderer))
+	, _ring(capacity, ALIGNMENT)
+{
+	if (!_device)
+		return;
+
+#ifdef _WIN32
+	// Binding by offset needs Direct3D 11.1 and a driver that allows WRITE_NO_OVERWRITE on constant buffers.
+	D3D11_FEATURE_DATA_D3D11_OPTIONS options = {};
+	HRESULT result = _device->CheckFeatureSupport(D3D11_FEATURE_D3D11_OPTIONS, &options, sizeof(options));
+	if (FAILED(result) || !options.ConstantBufferOffsetting || !options.MapNoOverwriteOnDynamicConstantBuffer)
+		return;
+
+	if (!GetDeviceContext1(renderer))
+		return;
+
+	// Setup the description of the dynamic constant buffer the ring lives in.
+	D3D11_BUFFER_DESC bufferDesc;
+	bufferDesc.Usage = D3D11_USAGE_DYNAMIC;
+	bufferDesc.ByteWidth = (uint)_ring.GetCapacity();
+	bufferDesc.BindFlags = D3D11_BIND_CONSTANT_BUFFER;
+	bufferDesc.CPUAccessFlags = D3D11_CPU_ACCESS_WRITE;
+	bufferDesc.MiscFlags = 0;
+	bufferDesc.StructureByteStride = 0;
+
+	ReleasePtr<ID3D11Buffer> buffer;
+	result = _device->CreateBuffer(&bufferDesc, nullptr, &buffer);
+	if (FAILED(result))
+		throw D3DError("Failed to create the constant ring buffer");
+
+	_buffer = std::move(buffer);
+#endif
+}
+
+ConstantBufferRing::~ConstantBufferRing() = default;
+
+void ConstantBufferRing::BeginFrame()
+{
+#ifdef _WIN32
+	// Release every frame whose fence has passed, without waiting for the ones that have not.
+	while (!_fences.empty())
+	{
+		Fence& fence = _fences.front();
+		if (_deviceContext->GetData(fence.query.get(), nullptr, 0u, D3D11_ASYNC_GETDATA_DONOTFLUSH) != S_OK)
+			break;
+
+		_ring.Retire(fence.frame);
+		_freeQueries.push_back(std::move(fence.query));
+		_fences.pop_front();
+	}
+#endif
+
+	_ring.BeginFrame();
+	_staging.clear();
+	_mapsThisFrame = 0u;
+	_stagedBindsThisFrame = 0u;
+}
+
+void ConstantBufferRing::EndFrame()
+{
+	Flush();
+	_ring.EndFrame();
+
+	if (!_buffer)
+		return;
+
+#ifdef _WIN32
+	// Issue an event query behind the frame's draws; it signals once the GPU has finished them. The ring only moves on
+	// to the next frame in BeginFrame.
+	Fence fence;
+	fence.frame = _ring.GetCurrentFrame();
+	if (!_freeQueries.empty())
+	{
+		fence.query = std::move(_freeQueries.back());
+		_freeQueries.pop_back();
+	}
+	else
+	{
+		D3D11_QUERY_DESC queryDesc;
+		queryDesc.Query = D3D11_QUERY_EVENT;
+		queryDesc.MiscFlags = 0;
+
+		HRESULT result = _device->CreateQuery(&queryDesc, &fence.query);
+		if (FAILED(result))
+			throw D3DError("Failed to create a frame fence");
+	}
+
+	_deviceContext->End(fence.query.get());
+	_fences.push_back(std::move(fence));
+#endif
+}
+
+ConstantBufferRing::Allocation ConstantBufferRing::Write(const void* data, size_t size)
+{
+	Allocation allocation;
+	if (!_device)
+		return allocation;
+
+#ifdef _WIN32
+	// Write straight into the ring while it has room.
+	if (_buffer)
+	{
+		size_t offset = _ring.Allocate(size);
+		if (offset != RingAllocator::INVALID_OFFSET)
+		{
+			if (!_mapped)
+			{
+				D3D11_MAPPED_SUBRESOURCE mappedResource;
+				HRESULT result = _deviceContext->Map(_buffer.get(), 0, _discardNext ? D3D11_MAP_WRITE_DISCARD : D3D11_MAP_WRITE_NO_OVERWRITE, 0,
+					&mappedResource);
+				if (FAILED(result))
+					throw D3DError("Failed to map the constant ring buffer");
+
+				_mapped = (uchar*)mappedResource.pData;
+				_discardNext = false;
+				_mapsThisFrame++;
+			}
+
+			memcpy(_mapped + offset, data, size);
+			allocation.offset = offset;
+			allocation.size = (uint)((size + ALIGNMENT - 1u) / ALIGNMENT * ALIGNMENT);
+			return allocation;
+		}
+	}
+#endif
+
+	// Otherwise keep a copy to upload when it is bound.
+	allocation.offset = _staging.size();
+	allocation.size = (uint)size;
+	allocation.staged = true;
+	_staging.insert(_staging.end(), (const uchar*)data, (const uchar*)data + size);
+	return allocation;
+}
+
+void ConstantBufferRing::Flush()
+{
+	if (!_mapped)
+		return;
+
+#ifdef _WIN32
+	_deviceContext->Unmap(_buffer.get(), 0);
+#endif
+	_mapped = nullptr;
+}
+
+void ConstantBufferRing::Bind([[maybe_unused]] RenderBackend& renderer, [[maybe_unused]] uint vsSlot, [[maybe_unused]] uint psSlot, const Allocation& allocation)
+{
+	if (!_device || !allocation.IsValid())
+		return;
+
+#ifdef _WIN32
+	// A buffer cannot be drawn with while it is mapped.
+	Flush();
+
+	ID3D11Buffer* buffer = nullptr;
+	if (!allocation.staged)
+	{
+		// Point the slots at the block's window of the ring.
+		ID3D11DeviceContext1* deviceContext1 = GetDeviceContext1(renderer);
+		buffer = _buffer.get();
+		uint firstConstant = (uint)(allocation.offset / 16u);
+		uint constantCount = allocation.size / 16u;
+		if (vsSlot != INVALID_SLOT)
+			deviceContext1->VSSetConstantBuffers1(vsSlot, 1, &buffer, &firstConstant, &constantCount);
+		if (psSlot != INVALID_SLOT)
+			deviceContext1->PSSetConstantBuffers1(psSlot, 1, &buffer, &firstConstant, &constantCount);
+		return;
+	}
+
+	// Upload the block into the slots' own buffer, discarding what the previous draw used.
+	buffer = GetStagingBuffer(vsSlot, psSlot, allocation.size);
+	D3D11_MAPPED_SUBRESOURCE mappedResource;
+	HRESULT result = _deviceContext->Map(buffer, 0, D3D11_MAP_WRITE_DISCARD, 0, &mappedResource);
+	if (FAILED(result))
+		throw D3DError("Failed to map a constant buffer");
+
+	memcpy(mappedResource.pData, _staging.data() + allocation.offset, allocation.size);
+	_deviceContext->Unmap(buffer, 0);
+	_mapsThisFrame++;
+	_stagedBindsThisFrame++;
+
+	if (vsSlot != INVALID_SLOT)
+		_deviceContext->VSSetConstantBuffers(vsSlot, 1, &buffer);
+	if (psSlot != INVALID_SLOT)
+		_deviceContext->PSSetConstantBuffers(psSlot, 1, &buffer);
+#endif
+}
+
+#ifdef _WIN32
+ID3D11Buffer* ConstantBufferRing::GetStagingBuffer(uint vsSlot, uint psSlot, uint size)
+{
+	StagingBuffer& staging = _stagingBuffers[{ vsSlot, psSlot }];
+	if (staging.buffer && staging.size >= size)
+		return staging.buffer.get();
+
+	// Setup the description of a dynamic constant buffer big enough for the block.
+	D3D11_BUFFER_DESC bufferDesc;
+	bufferDesc.Usage = D3D11_USAGE_DYNAMIC;
+	bufferDesc.ByteWidth = (size + 15u) / 16u * 16u;
+	bufferDesc.BindFlags = D3D11_BIND_CONSTANT_BUFFER;
+	bufferDesc.CPUAccessFlags = D3D11_CPU_ACCESS_WRITE;
+	bufferDesc.MiscFlags = 0;
+	bufferDesc.StructureByteStride = 0;
+
+	ReleasePtr<ID3D11Buffer> buffer;
+	HRESULT result = _device->CreateBuffer(&bufferDesc, nullptr, &buffer);
+	if (FAILED(result))
+		throw D3DError("Failed to create a constant buffer");
+
+	staging.buffer = std::move(buffer);
+	staging.size = bufferDesc.ByteWidth;
+	return staging.buffer.get();
+}
+#endif
+
+bool ConstantBufferRing::UsesOffsets() const
+{
+	return _buffer.get() != nullptr;
+}
+
+ConstantBufferRing::Stats ConstantBufferRing::GetStats() const
+{
+	Stats stats;
+	stats.ring = _ring.GetStats();
+	stats.mapsThisFrame = _mapsThisFrame;
+	stats.stagedBindsThisFrame = _stagedBindsThisFrame;
+	stats.usesOffsets = UsesOffsets();
+	return stats;
+}
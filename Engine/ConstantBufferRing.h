@@ -0,0 +1,107 @@
+#pragma once
+
+#include <deque>
+
+#include "Common.h"
+#include "ConstantAllocation.h"
+#include "ReleasePtr.h"
+#include "RenderBackend.h"
+#include "RingAllocator.h"
+
+struct ID3D11Device;
+struct ID3D11DeviceContext;
+struct ID3D11Query;
+
+// Constant memory for a frame's draws. Every constant block is written into one large dynamic buffer, mapped once
+// per batch with WRITE_NO_OVERWRITE, and bound per draw by offset with VSSetConstantBuffers1, instead of mapping a
+// small buffer with WRITE_DISCARD for every draw. An event query issued at the end of each frame fences the ring,
+// so space is only reused once the GPU has finished the frame that wrote it.
+//
+// Without constant buffer offsetting (drivers older than Direct3D 11.1) blocks are kept in a CPU copy and uploaded
+// into a small buffer per binding with WRITE_DISCARD when bound, which is what the shaders used to do. Blocks that
+// do not fit in a full ring take the same path, so a frame never waits for the GPU.
+//
+// Backends without a device get an empty ring: Write returns invalid allocations and Bind does nothing.
+class ConstantBufferRing
+{
+public:
+
+	static const size_t DEFAULT_CAPACITY = 4u * 1024u * 1024u;
+
+	// VSSetConstantBuffers1 takes offsets and sizes in 16-byte constants, in multiples of 16 constants.
+	static const size_t ALIGNMENT = 256u;
+
+	static const uint INVALID_SLOT = ~0u;
+
+	using Allocation = ConstantAllocation;
+
+	struct Stats
+	{
+		RingAllocator::Stats ring;
+		uint mapsThisFrame = 0u;
+		uint stagedBindsThisFrame = 0u;
+		bool usesOffsets = false;
+	};
+
+	ConstantBufferRing(RenderBackend& renderer, size_t capacity = DEFAULT_CAPACITY);
+	~ConstantBufferRing();
+
+	ConstantBufferRing(const ConstantBufferRing&) = delete;
+	ConstantBufferRing& operator=(const ConstantBufferRing&) = delete;
+
+	// Releases the frames the GPU has finished. Call at the start of every frame, before the first Write.
+	void BeginFrame();
+
+	// Fences the frame's allocations. Call after the frame's last draw.
+	void EndFrame();
+
+	// Copies a constant block into the ring. Consecutive writes share one Map of the buffer, which stays mapped until
+	// the next Bind or Flush. Allocations last until the end of the frame.
+	Allocation Write(const void* data, size_t size);
+
+	// Unmaps the ring so the blocks written so far can be drawn with.
+	void Flush();
+
+	// Binds a block to a vertex shader slot, a pixel shader slot or both of the backend's context; INVALID_SLOT skips a
+	// stage. Blocks in the ring can be bound on any backend the ring's renderer records with, once the ring is flushed,
+	// and from several threads at once. Staged blocks are uploaded when bound, so they are bound on the ring's renderer
+	// only.
+	void Bind(RenderBackend& renderer, uint vsSlot, uint psSlot, const Allocation& allocation);
+
+	bool UsesOffsets() const;
+	Stats GetStats() const;
+
+private:
+
+	struct Fence
+	{
+		uint64_t frame;
+		ReleasePtr<ID3D11Query> query;
+	};
+
+	struct StagingBuffer
+	{
+		ReleasePtr<ID3D11Buffer> buffer;
+		uint size = 0u;
+	};
+
+	ID3D11Buffer* GetStagingBuffer(uint vsSlot, uint psSlot, uint size);
+
+	ID3D11Device* _device = nullptr;
+	ID3D11DeviceContext* _deviceContext = nullptr;
+
+	RingAllocator _ring;
+	ReleasePtr<ID3D11Buffer> _buffer;
+	uchar* _mapped = nullptr;
+	bool _discardNext = true; // The first map of the buffer has to discard it.
+
+	std::deque<Fence> _fences; // Frames the GPU may still be working on, oldest first.
+	std::vector<ReleasePtr<ID3D11Query>> _freeQueries;
+
+	// Blocks that are uploaded when bound, and the buffers they are uploaded into, one per pair of slots.
+	std::vector<uchar> _staging;
+	std::map<std::pair<uint, uint>, StagingBuffer> _stagingBuffers;
+
+	uint _mapsThisFrame = 0u;
+	uint _stagedBindsThisFrame = 0u;
+};
@@ -0,0 +1,570 @@
+#include "ConstantRingBenchmark.h"
+#include "RingAllocator.h"
+
+#include <algorithm>
+#include <chrono>
+#include <deque>
+#include <random>
+#include <string.h>
+#include <thread>
+
+#ifdef _WIN32
+#include <d3dcompiler.h>
+#include "ConstantBufferRing.h"
+#include "D3D.h"
+#endif
+
+namespace
+{
+	const uint RANDOM_SEED = 1234u;
+	const uint MODEL_FRAMES = 20000u;
+	const uint MAX_ALLOCATIONS_PER_FRAME = 24u;
+	const uint MAX_GPU_LATENCY = 3u;	// Frames a fence normally takes to signal.
+	const uint STALL_LATENCY = 40u;		// Frames it takes when the GPU stalls, enough to fill any of the rings.
+
+	struct RingConfig
+	{
+		size_t capacity;
+		size_t alignment;
+	};
+
+	// A ring of a few hundred blocks like ConstantBufferRing's, one that holds three blocks, and one with a fine
+	// alignment and a capacity that is not a multiple of it.
+	const RingConfig RING_CONFIGS[] =
+	{
+		{ 64u * 1024u, 256u },
+		{ 1000u, 256u },
+		{ 4096u + 8u, 16u },
+	};
+
+	// Keeps every live range with the frame that owns it and looks for room by testing the places RingAllocator may
+	// use against all of them: the head, or the start of the ring once the rest of it is free to be skipped.
+	class ReferenceRing
+	{
+	public:
+
+		ReferenceRing(size_t capacity, size_t alignment)
+			: _capacity(capacity / alignment * alignment)
+			, _alignment(alignment)
+		{
+		}
+
+		void BeginFrame()
+		{
+			_frame++;
+		}
+
+		void EndFrame()
+		{
+			for (Range& range : _ranges)
+				range.ended = true;
+		}
+
+		void Retire(uint64_t frame)
+		{
+			std::erase_if(_ranges, [frame](const Range& range) { return range.ended && range.frame <= frame; });
+		}
+
+		void Reset()
+		{
+			_ranges.clear();
+			_head = 0u;
+		}
+
+		size_t Allocate(size_t size)
+		{
+			size_t aligned = std::max((size + _alignment - 1u) / _alignment * _alignment, _alignment);
+			if (aligned > _capacity)
+				return RingAllocator::INVALID_OFFSET;
+			if (_ranges.empty())
+				_head = 0u;
+
+			if (_head + aligned <= _capacity && IsFree(_head, _head + aligned))
+			{
+				_ranges.push_back({ _head, _head + aligned, _frame, false });
+			}
+			else if (IsFree(_head, _capacity) && IsFree(0u, aligned))
+			{
+				// The skipped end of the ring belongs to the frame until it is retired.
+				if (_head < _capacity)
+					_ranges.push_back({ _head, _capacity, _frame, false });
+				_ranges.push_back({ 0u, aligned, _frame, false });
+				_wraps++;
+			}
+			else
+			{
+				return RingAllocator::INVALID_OFFSET;
+			}
+
+			_head = _ranges.back().end;
+			return _ranges.back().begin;
+		}
+
+		size_t GetUsed() const
+		{
+			size_t used = 0u;
+			for (const Range& range : _ranges)
+				used += range.end - range.begin;
+			return used;
+		}
+
+		uint GetFramesInFlight() const
+		{
+			std::vector<uint64_t> frames;
+			for (const Range& range : _ranges)
+				if (range.ended)
+					frames.push_back(range.frame);
+			std::sort(frames.begin(), frames.end());
+			return (uint)(std::unique(frames.begin(), frames.end()) - frames.begin());
+		}
+
+		uint GetWraps() const
+		{
+			return _wraps;
+		}
+
+	private:
+
+		struct Range
+		{
+			size_t begin;
+			size_t end;
+			uint64_t frame;
+			bool ended;
+		};
+
+		bool IsFree(size_t begin, size_t end) const
+		{
+			for (const Range& range : _ranges)
+				if (range.begin < end && begin < range.end)
+					return false;
+			return true;
+		}
+
+		size_t _capacity;
+		size_t _alignment;
+		size_t _head = 0u;
+		uint64_t _frame = 0u;
+		uint _wraps = 0u;
+		std::vector<Range> _ranges;
+	};
+
+	// The fence the simulated GPU signals behind a frame's work, as ConstantBufferRing issues one per frame.
+	struct PendingFence
+	{
+		uint fence;
+		uint64_t frame;
+		uint64_t signalsAt;		// Frame number at whose start the fence has signalled.
+	};
+
+	struct ModelResult
+	{
+		bool match = true;
+		uint allocations = 0u;
+		uint failures = 0u;
+		uint wraps = 0u;
+		uint resets = 0u;
+		uint fencesCreated = 0u;
+		uint fencesReused = 0u;
+	};
+
+	ModelResult RunModel(const RingConfig& config, std::mt19937& random)
+	{
+		ModelResult result;
+		RingAllocator ring(config.capacity, config.alignment);
+		ReferenceRing reference(config.capacity, config.alignment);
+		size_t capacity = ring.GetCapacity();
+
+		std::deque<PendingFence> pending;
+		std::vector<uint> freeFences;
+		std::vector<bool> fenceInUse;
+		uint64_t lastSignal = 0u;
+
+		auto retire = [&](uint64_t frame)
+		{
+			ring.Retire(frame);
+			reference.Retire(frame);
+		};
+
+		for (uint frameIndex = 0u; frameIndex < MODEL_FRAMES && result.match; ++frameIndex)
+		{
+			uint64_t frame = ring.BeginFrame();
+			reference.BeginFrame();
+
+			// Release the frames whose fences have signalled, in order, and put the fences back in the pool.
+			while (!pending.empty() && pending.front().signalsAt <= frame)
+			{
+				retire(pending.front().frame);
+				fenceInUse[pending.front().fence] = false;
+				freeFences.push_back(pending.front().fence);
+				pending.pop_front();
+			}
+
+			// Retiring what is already retired, the current frame or frames the GPU has not finished must agree too.
+			uint extra = random() % 50u;
+			if (extra == 0u && frame > 2u)
+				retire(frame - 2u);
+			else if (extra == 1u)
+				retire(frame);
+			else if (extra == 2u)
+				retire(frame + 5u);
+
+			// The device went away and the memory behind the ring with it; the GPU's fences go with it.
+			if (random() % 2000u == 0u)
+			{
+				ring.Reset();
+				reference.Reset();
+				for (const PendingFence& fence : pending)
+				{
+					fenceInUse[fence.fence] = false;
+					freeFences.push_back(fence.fence);
+				}
+				pending.clear();
+				result.resets++;
+			}
+
+			uint allocations = random() % 10u == 0u ? 0u : random() % (MAX_ALLOCATIONS_PER_FRAME + 1u);
+			for (uint i = 0u; i < allocations; ++i)
+			{
+				// Mostly small blocks, then large ones, ones that never fit and empty ones.
+				uint kind = random() % 100u;
+				size_t size = kind < 85u ? 1u + random() % (config.alignment * 2u) :
+					kind < 95u ? 1u + random() % (capacity / 2u) :
+					kind < 97u ? capacity + 1u + random() % config.alignment : 0u;
+
+				size_t offset = ring.Allocate(size);
+				size_t expected = reference.Allocate(size);
+				bool inside = offset == RingAllocator::INVALID_OFFSET || (offset % config.alignment == 0u && offset + size <= capacity);
+				result.match = result.match && offset == expected && inside;
+				if (offset == RingAllocator::INVALID_OFFSET)
+					result.failures++;
+				else
+					result.allocations++;
+			}
+
+			ring.EndFrame();
+			reference.EndFrame();
+
+			// Fence the frame, with a fence back from the pool when there is one, and have it signal after the
+			// frames before it. Two frames waiting on the same fence would release one of them early.
+			uint fence = 0u;
+			if (!freeFences.empty())
+			{
+				fence = freeFences.back();
+				freeFences.pop_back();
+				result.fencesReused++;
+			}
+			else
+			{
+				fence = result.fencesCreated++;
+				fenceInUse.push_back(false);
+			}
+			result.match = result.match && !fenceInUse[fence];
+			fenceInUse[fence] = true;
+
+			uint64_t latency = random() % 100u == 0u ? STALL_LATENCY : 1u + random() % MAX_GPU_LATENCY;
+			lastSignal = std::max(lastSignal, frame + latency);
+			pending.push_back({ fence, frame, lastSignal });
+
+			const RingAllocator::Stats& stats = ring.GetStats();
+			result.match = result.match && stats.used == reference.GetUsed() && stats.used <= capacity &&
+				stats.framesInFlight == reference.GetFramesInFlight() && stats.wraps == reference.GetWraps();
+		}
+
+		result.wraps = ring.GetStats().wraps;
+		return result;
+	}
+
+#ifdef _WIN32
+	const uint GRID_SIZE = 64u;
+	const uint DRAWS_PER_FRAME = GRID_SIZE * GRID_SIZE;
+	const uint BENCHMARK_FRAMES = 200u;
+
+	// Just over one frame of blocks, so a frame only fits once the GPU has finished the one before.
+	const size_t SMALL_RING_CAPACITY = DRAWS_PER_FRAME * ConstantBufferRing::ALIGNMENT * 3u / 2u;
+
+	// Each draw is a quad over one pixel of the grid in its own color, both taken from its constant block.
+	const char* const SHADER_SOURCE =
+		"cbuffer DrawConstants : register(b0) { float4 rect; float4 color; };\n"
+		"float4 VertexMain(uint id : SV_VertexID) : SV_Position { return float4(rect.xy + float2(id & 1, id >> 1) * rect.zw, 0.5, 1); }\n"
+		"float4 PixelMain() : SV_Target { return color; }\n";
+
+	struct DrawConstants
+	{
+		float rect[4];	// Left, top, width and height in clip space.
+		float color[4];
+	};
+
+	enum class Path
+	{
+		DISCARD,
+		RING,
+	};
+
+	DrawConstants MakeConstants(uint draw, uint frame)
+	{
+		float cell = 2.0f / GRID_SIZE;
+		float x = (float)(draw % GRID_SIZE);
+		float y = (float)(draw / GRID_SIZE);
+		return
+		{
+			{ x * cell - 1.0f, 1.0f - y * cell, cell, -cell },
+			{ (draw & 255u) / 255.0f, (draw >> 8) / 255.0f, (frame & 255u) / 255.0f, 1.0f },
+		};
+	}
+
+	ReleasePtr<ID3D10Blob> CompileShader(const char* entryPoint, const char* profile)
+	{
+		ReleasePtr<ID3D10Blob> shaderBuffer;
+		ReleasePtr<ID3D10Blob> errorMessage;
+		HRESULT result = D3DCompile(SHADER_SOURCE, strlen(SHADER_SOURCE), nullptr, nullptr, nullptr, entryPoint, profile, 0, 0, &shaderBuffer,
+			&errorMessage);
+		if (FAILED(result))
+			throw D3DError(errorMessage ? (const char*)errorMessage->GetBufferPointer() : "Failed to compile the benchmark shader");
+		return shaderBuffer;
+	}
+
+	// Renders into a grid of its own with the device of a D3D backend on a hidden window, since D3D needs a window
+	// for its swap chain.
+	class DrawBench
+	{
+	public:
+
+		DrawBench(D3D& d3d)
+			: _d3d(d3d)
+			, _device(d3d.GetDevice())
+			, _deviceContext(d3d.GetDeviceContext())
+		{
+			ReleasePtr<ID3D10Blob> vertexShader = CompileShader("VertexMain", "vs_5_0");
+			ReleasePtr<ID3D10Blob> pixelShader = CompileShader("PixelMain", "ps_5_0");
+			Check(_device->CreateVertexShader(vertexShader->GetBufferPointer(), vertexShader->GetBufferSize(), nullptr, &_vertexShader));
+			Check(_device->CreatePixelShader(pixelShader->GetBufferPointer(), pixelShader->GetBufferSize(), nullptr, &_pixelShader));
+
+			// The constant buffer the discard path maps for every draw.
+			D3D11_BUFFER_DESC bufferDesc;
+			bufferDesc.Usage = D3D11_USAGE_DYNAMIC;
+			bufferDesc.ByteWidth = sizeof(DrawConstants);
+			bufferDesc.BindFlags = D3D11_BIND_CONSTANT_BUFFER;
+			bufferDesc.CPUAccessFlags = D3D11_CPU_ACCESS_WRITE;
+			bufferDesc.MiscFlags = 0;
+			bufferDesc.StructureByteStride = 0;
+			Check(_device->CreateBuffer(&bufferDesc, nullptr, &_constantBuffer));
+
+			// The grid, and a staging copy to read it back from.
+			D3D11_TEXTURE2D_DESC textureDesc = {};
+			textureDesc.Width = GRID_SIZE;
+			textureDesc.Height = GRID_SIZE;
+			textureDesc.MipLevels = 1;
+			textureDesc.ArraySize = 1;
+			textureDesc.Format = DXGI_FORMAT_R8G8B8A8_UNORM;
+			textureDesc.SampleDesc.Count = 1;
+			textureDesc.Usage = D3D11_USAGE_DEFAULT;
+			textureDesc.BindFlags = D3D11_BIND_RENDER_TARGET;
+			Check(_device->CreateTexture2D(&textureDesc, nullptr, &_target));
+			Check(_device->CreateRenderTargetView(_target.get(), nullptr, &_targetView));
+			textureDesc.Usage = D3D11_USAGE_STAGING;
+			textureDesc.BindFlags = 0;
+			textureDesc.CPUAccessFlags = D3D11_CPU_ACCESS_READ;
+			Check(_device->CreateTexture2D(&textureDesc, nullptr, &_readback));
+
+			// The quads are mirrored down the grid, so draw them whichever way they wind.
+			D3D11_RASTERIZER_DESC rasterDesc = D3D::DescribeRasterState();
+			rasterDesc.CullMode = D3D11_CULL_NONE;
+			Check(_device->CreateRasterizerState(&rasterDesc, &_rasterState));
+
+			D3D11_QUERY_DESC queryDesc;
+			queryDesc.Query = D3D11_QUERY_EVENT;
+			queryDesc.MiscFlags = 0;
+			Check(_device->CreateQuery(&queryDesc, &_idle));
+		}
+
+		// Draws the frames one way and returns the draws per second, up to the GPU finishing the last frame.
+		// match is cleared unless the last frame drew every quad in its own color.
+		double Run(Path path, size_t ringCapacity, ConstantBufferRing::Stats& ringStats, bool& match)
+		{
+			std::unique_ptr<ConstantBufferRing> ring;
+			if (path == Path::RING)
+				ring = std::make_unique<ConstantBufferRing>(_d3d, ringCapacity);
+
+			std::vector<DrawConstants> constants(DRAWS_PER_FRAME);
+			std::vector<ConstantBufferRing::Allocation> allocations(DRAWS_PER_FRAME);
+			uint stagedBinds = 0u;
+			uint maps = 0u;
+
+			WaitForGpu();
+			auto start = std::chrono::steady_clock::now();
+			for (uint frame = 0u; frame < BENCHMARK_FRAMES; ++frame)
+			{
+				BindPipeline();
+				for (uint draw = 0u; draw < DRAWS_PER_FRAME; ++draw)
+					constants[draw] = MakeConstants(draw, frame);
+
+				if (path == Path::DISCARD)
+				{
+					// What the shaders did before the ring: map, fill and bind one small buffer per draw.
+					for (uint draw = 0u; draw < DRAWS_PER_FRAME; ++draw)
+					{
+						D3D11_MAPPED_SUBRESOURCE mappedResource;
+						Check(_deviceContext->Map(_constantBuffer.get(), 0, D3D11_MAP_WRITE_DISCARD, 0, &mappedResource));
+						memcpy(mappedResource.pData, &constants[draw], sizeof(DrawConstants));
+						_deviceContext->Unmap(_constantBuffer.get(), 0);
+
+						ID3D11Buffer* buffer = _constantBuffer.get();
+						_deviceContext->VSSetConstantBuffers(0, 1, &buffer);
+						_deviceContext->PSSetConstantBuffers(0, 1, &buffer);
+						_deviceContext->Draw(4, 0);
+					}
+					continue;
+				}
+
+				// What DrawList does: write every block up front, then bind each by offset for its draw.
+				ring->BeginFrame();
+				for (uint draw = 0u; draw < DRAWS_PER_FRAME; ++draw)
+					allocations[draw] = ring->Write(&constants[draw], sizeof(DrawConstants));
+				ring->Flush();
+				for (uint draw = 0u; draw < DRAWS_PER_FRAME; ++draw)
+				{
+					ring->Bind(_d3d, 0, 0, allocations[draw]);
+					_deviceContext->Draw(4, 0);
+				}
+				ring->EndFrame();
+
+				ringStats = ring->GetStats();
+				stagedBinds += ringStats.stagedBindsThisFrame;
+				maps += ringStats.mapsThisFrame;
+			}
+			WaitForGpu();
+			double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+			ringStats.stagedBindsThisFrame = stagedBinds;
+			ringStats.mapsThisFrame = maps;
+			match = ReadBackMatches(BENCHMARK_FRAMES - 1u) && match;
+			return (double)DRAWS_PER_FRAME * BENCHMARK_FRAMES / seconds;
+		}
+
+	private:
+
+		static void Check(HRESULT result)
+		{
+			if (FAILED(result))
+				throw D3DError("Constant ring benchmark: a Direct3D call failed");
+		}
+
+		void BindPipeline()
+		{
+			float black[4] = { 0.0f, 0.0f, 0.0f, 0.0f };
+			D3D11_VIEWPORT viewport = { 0.0f, 0.0f, (float)GRID_SIZE, (float)GRID_SIZE, 0.0f, 1.0f };
+			ID3D11RenderTargetView* targetView = _targetView.get();
+			_deviceContext->OMSetRenderTargets(1, &targetView, nullptr);
+			_deviceContext->ClearRenderTargetView(targetView, black);
+			_deviceContext->RSSetViewports(1, &viewport);
+			_deviceContext->RSSetState(_rasterState.get());
+			_deviceContext->IASetInputLayout(nullptr);
+			_deviceContext->IASetPrimitiveTopology(D3D11_PRIMITIVE_TOPOLOGY_TRIANGLESTRIP);
+			_deviceContext->VSSetShader(_vertexShader.get(), nullptr, 0);
+			_deviceContext->PSSetShader(_pixelShader.get(), nullptr, 0);
+		}
+
+		void WaitForGpu()
+		{
+			_deviceContext->End(_idle.get());
+			while (_deviceContext->GetData(_idle.get(), nullptr, 0u, 0u) != S_OK)
+				std::this_thread::yield();
+		}
+
+		bool ReadBackMatches(uint frame)
+		{
+			_deviceContext->CopyResource(_readback.get(), _target.get());
+			D3D11_MAPPED_SUBRESOURCE mappedResource;
+			Check(_deviceContext->Map(_readback.get(), 0, D3D11_MAP_READ, 0, &mappedResource));
+
+			bool match = true;
+			for (uint draw = 0u; draw < DRAWS_PER_FRAME; ++draw)
+			{
+				const uchar* pixel = (const uchar*)mappedResource.pData + (draw / GRID_SIZE) * mappedResource.RowPitch + (draw % GRID_SIZE) * 4u;
+				match = match && pixel[0] == (draw & 255u) && pixel[1] == (draw >> 8) && pixel[2] == (frame & 255u) && pixel[3] == 255u;
+			}
+			_deviceContext->Unmap(_readback.get(), 0);
+			return match;
+		}
+
+		D3D& _d3d;
+		ID3D11Device* _device;
+		ID3D11DeviceContext* _deviceContext;
+		ReleasePtr<ID3D11VertexShader> _vertexShader;
+		ReleasePtr<ID3D11PixelShader> _pixelShader;
+		ReleasePtr<ID3D11Buffer> _constantBuffer;
+		ReleasePtr<ID3D11Texture2D> _target;
+		ReleasePtr<ID3D11RenderTargetView> _targetView;
+		ReleasePtr<ID3D11Texture2D> _readback;
+		ReleasePtr<ID3D11RasterizerState> _rasterState;
+		ReleasePtr<ID3D11Query> _idle;
+	};
+
+	bool RunDrawBenchmark(std::ostream& output)
+	{
+		HWND hwnd = CreateWindowExA(0, "STATIC", "Constant ring benchmark", WS_POPUP, 0, 0, GRID_SIZE, GRID_SIZE, nullptr, nullptr,
+			GetModuleHandle(nullptr), nullptr);
+		if (!hwnd)
+		{
+			output << "Could not create a window for the draw benchmark" << std::endl;
+			return false;
+		}
+
+		bool allMatch = true;
+		try
+		{
+			D3D d3d({ hwnd, GRID_SIZE, GRID_SIZE, 0.1f, 1000.0f, false, false });
+			DrawBench bench(d3d);
+
+			ConstantBufferRing::Stats stats;
+			bool match = true;
+			double discard = bench.Run(Path::DISCARD, 0u, stats, match);
+			output << std::format("Map WRITE_DISCARD per draw: {:.2f} M draws/s: {}", discard / 1e6, match ? "OK" : "MISMATCH") << std::endl;
+			allMatch = allMatch && match;
+
+			const size_t capacities[] = { ConstantBufferRing::DEFAULT_CAPACITY, SMALL_RING_CAPACITY };
+			for (size_t capacity : capacities)
+			{
+				match = true;
+				double ring = bench.Run(Path::RING, capacity, stats, match);
+				output << std::format("Ring of {} KB{}: {:.2f} M draws/s ({:.1f}x), {} maps, {} staged binds, {} wraps, {} frames in flight: {}",
+					capacity / 1024u, stats.usesOffsets ? " bound by offset" : " without offsets, so staged", ring / 1e6, ring / discard,
+					stats.mapsThisFrame, stats.stagedBindsThisFrame, stats.ring.wraps, stats.ring.framesInFlight, match ? "OK" : "MISMATCH") << std::endl;
+				allMatch = allMatch && match;
+			}
+		}
+		catch (const D3DError& error)
+		{
+			output << error.what() << std::endl;
+			allMatch = false;
+		}
+
+		DestroyWindow(hwnd);
+		return allMatch;
+	}
+#endif
+}
+
+bool RunConstantRingBenchmark(std::ostream& output)
+{
+	bool allMatch = true;
+	std::mt19937 random(RANDOM_SEED);
+	for (const RingConfig& config : RING_CONFIGS)
+	{
+		// A run that never wraps or fills up has not tested much.
+		ModelResult result = RunModel(config, random);
+		bool match = result.match && result.wraps > 0u && result.failures > 0u && result.fencesReused > 0u;
+		output << std::format("Ring of {} bytes, {}-byte alignment: {} allocations, {} failed, {} wraps, {} resets, {} fences reused {} times: {}",
+			config.capacity / config.alignment * config.alignment, config.alignment, result.allocations, result.failures, result.wraps,
+			result.resets, result.fencesCreated, result.fencesReused, match ? "OK" : "MISMATCH") << std::endl;
+		allMatch = allMatch && match;
+	}
+
+#ifdef _WIN32
+	allMatch = RunDrawBenchmark(output) && allMatch;
+#else
+	output << "The draw comparison needs Direct3D and was skipped" << std::endl;
+#endif
+	return allMatch;
+}
@@ -0,0 +1,16 @@
+#pragma once
+
+#include <ostream>
+#include "Common.h"
+
+// Drives RingAllocator through tens of thousands of random frames next to a reference model that keeps every live
+// range and looks for room the slow obvious way. Frames are fenced from a pool of reused fences that signal in order
+// after a random GPU latency, with stalls long enough to fill the ring, and are also retired twice, out of turn and
+// ahead of the GPU, with the odd Reset. Checks that every allocation lands where the model puts it, wrap-around
+// included, that failures happen exactly when the model has no room, and that the bytes and frames in use agree.
+// On Windows it then draws 4096 one-pixel quads a frame, each with its own constant block, once mapping one small
+// buffer with WRITE_DISCARD per draw and once through ConstantBufferRing bound by offset with VSSetConstantBuffers1,
+// with a ring that holds several frames and one that holds little more than one. Reports draws per second for each
+// and checks that every path draws every quad with its own constants. Run with "Engine.exe -benchmark-constant-ring".
+// Returns false if any check fails.
+bool RunConstantRingBenchmark(std::ostream& output);
@@ -0,0 +1,80 @@
+#include "CpuFeatures.h"
+
+#if defined(CPU_X86) && defined(_MSC_VER)
+#include <intrin.h>
+#elif defined(CPU_X86)
+#include <cpuid.h>
+#endif
+
+namespace
+{
+#if defined(CPU_X86)
+	void Cpuid(int registers[4], int leaf, int subleaf)
+	{
+#if defined(_MSC_VER)
+		__cpuidex(registers, leaf, subleaf);
+#else
+		unsigned int eax, ebx, ecx, edx;
+		__cpuid_count(leaf, subleaf, eax, ebx, ecx, edx);
+		registers[0] = (int)eax;
+		registers[1] = (int)ebx;
+		registers[2] = (int)ecx;
+		registers[3] = (int)edx;
+#endif
+	}
+
+	unsigned long long ReadXcr0()
+	{
+#if defined(_MSC_VER)
+		return _xgetbv(0);
+#else
+		unsigned int eax, edx;
+		__asm__ volatile("xgetbv" : "=a"(eax), "=d"(edx) : "c"(0));
+		return ((unsigned long long)edx << 32) | eax;
+#endif
+	}
+
+	CpuFeatures Detect()
+	{
+		CpuFeatures features;
+
+		int registers[4];
+		Cpuid(registers, 0, 0);
+		int maxLeaf = registers[0];
+		if (maxLeaf < 1)
+			return features;
+
+		Cpuid(registers, 1, 0);
+		features.sse2 = (registers[3] & (1 << 26)) != 0;
+		features.ssse3 = (registers[2] & (1 << 9)) != 0;
+		features.sse41 = (registers[2] & (1 << 19)) != 0;
+		features.fma = (registers[2] & (1 << 12)) != 0;
+
+		// AVX needs the OS to save the YMM registers on context switches as well.
+		bool osxsave = (registers[2] & (1 << 27)) != 0;
+		bool avxSupported = (registers[2] & (1 << 28)) != 0;
+		bool ymmEnabled = osxsave && (ReadXcr0() & 0x6) == 0x6;
+		features.avx = avxSupported && ymmEnabled;
+		features.fma = features.fma && features.avx;
+
+		if (maxLeaf >= 7)
+		{
+			Cpuid(registers, 7, 0);
+			features.avx2 = features.avx && (registers[1] & (1 << 5)) != 0;
+		}
+
+		return features;
+	}
+#else
+	CpuFeatures Detect()
+	{
+		return CpuFeatures();
+	}
+#endif
+}
+
+const CpuFeatures& CpuFeatures::Get()
+{
+	static const CpuFeatures features = Detect();
+	return features;
+}
@@ -0,0 +1,34 @@
+#pragma once
+
+// Instruction set extensions of the processor the engine is running on, detected once with cpuid.
+// Vectorized code paths check these at runtime and fall back to scalar code when an extension is missing.
+// Off x86, or with MATH_NO_INTRINSICS, CPU_X86 is left undefined: the x86 paths are not compiled and every feature
+// reads false.
+#if !defined(MATH_NO_INTRINSICS) && (defined(_M_X64) || defined(_M_IX86) || defined(__x86_64__) || defined(__i386__))
+#define CPU_X86
+#endif
+
+struct CpuFeatures
+{
+	bool sse2 = false;
+	bool ssse3 = false;
+	bool sse41 = false;
+	bool avx = false;
+	bool avx2 = false;
+	bool fma = false;
+
+	static const CpuFeatures& Get();
+};
+
+// Functions using intrinsics beyond the compiler's baseline are tagged so GCC and Clang emit them; MSVC needs no tag.
+// TARGET_AVX2 leaves FMA out: the AVX2 paths are picked on features.avx2 alone, and FMA would also let the compiler
+// contract their floating point maths, so they would no longer match their scalar references bit for bit.
+#if !defined(CPU_X86) || (defined(_MSC_VER) && !defined(__clang__))
+#define TARGET_SSSE3
+#define TARGET_SSE41
+#define TARGET_AVX2
+#else
+#define TARGET_SSSE3 __attribute__((target("ssse3")))
+#define TARGET_SSE41 __attribute__((target("sse4.1")))
+#define TARGET_AVX2 __attribute__((target("avx2")))
+#endif
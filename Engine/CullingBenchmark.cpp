@@ -0,0 +1,67 @@
+#include "CullingBenchmark.h"
+#include "FrustumCuller.h"
+#include "JobSystem.h"
+
+#include <math.h>
+#include <random>
+
+namespace
+{
+	const uint BOUND_COUNTS[] = { 10000u, 100000u, 1000000u };
+	const float WORLD_SIZE = 1000.0f;	// Bounds are scattered over a cube this wide around the camera.
+	const uint REPETITIONS = 10u;
+
+	template <typename Cull>
+	double Measure(Cull cull)
+	{
+		double total = 0.0;
+		for (uint i = 0u; i < REPETITIONS; ++i)
+			total += cull();
+		return total / REPETITIONS;
+	}
+}
+
+bool RunCullingBenchmark(std::ostream& output)
+{
+	uint threadCount = JobSystem::GetDefault().GetThreadCount();
+
+	// A camera at the origin looking down +z, with the engine's field of view and depth range.
+	Math::Matrix4 view = Math::LookAtLH(Math::Float3(0.0f, 0.0f, 0.0f), Math::Float3(0.0f, 0.0f, 1.0f), Math::Float3(0.0f, 1.0f, 0.0f));
+	Math::Matrix4 projection = Math::PerspectiveFovLH(Math::PI / 4.0f, 16.0f / 9.0f, 0.3f, WORLD_SIZE * 0.5f);
+	Frustum frustum(Math::Multiply(view, projection));
+
+	output << std::format("Frustum culling, {} kernel, average of {} runs", FrustumCuller::GetKernelName(), REPETITIONS) << std::endl;
+
+	bool allMatch = true;
+	std::mt19937 random(1u);
+	std::uniform_real_distribution<float> position(-WORLD_SIZE * 0.5f, WORLD_SIZE * 0.5f);
+	std::uniform_real_distribution<float> size(0.5f, 5.0f);
+
+	for (uint boundCount : BOUND_COUNTS)
+	{
+		FrustumCuller culler;
+		culler.Reserve(boundCount);
+		for (uint i = 0u; i < boundCount; ++i)
+		{
+			Bounds bounds;
+			bounds.center = Math::Float3(position(random), position(random), position(random));
+			bounds.extents = Math::Float3(size(random), size(random), size(random));
+			bounds.radius = sqrtf(bounds.extents.x * bounds.extents.x + bounds.extents.y * bounds.extents.y + bounds.extents.z * bounds.extents.z);
+			culler.Add(bounds);
+		}
+
+		std::vector<uint> reference, single, parallel;
+		double scalarMilliseconds = Measure([&] { culler.CullScalar(frustum, reference); return culler.GetStats().cullMilliseconds; });
+		double singleMilliseconds = Measure([&] { culler.Cull(frustum, single, 1u); return culler.GetStats().cullMilliseconds; });
+		double parallelMilliseconds = Measure([&] { culler.Cull(frustum, parallel, threadCount); return culler.GetStats().cullMilliseconds; });
+
+		bool match = single == reference && parallel == reference;
+		allMatch = allMatch && match;
+
+		output << std::format("{:>8} bounds, {:>7} visible: scalar {:8.3f} ms, vector {:8.3f} ms, {} threads {:8.3f} ms ({:.2f} ns/bound){}",
+			boundCount, reference.size(), scalarMilliseconds, singleMilliseconds, threadCount, parallelMilliseconds,
+			parallelMilliseconds * 1000000.0 / boundCount, match ? "" : " MISMATCH") << std::endl;
+	}
+
+	return allMatch;
+}
@@ -0,0 +1,9 @@
+#pragma once
+
+#include <ostream>
+#include "Common.h"
+
+// Culls 10k to 1M random bounds with the scalar reference, the dispatched kernel on one thread and the dispatched
+// kernel on every hardware thread, checks that all three agree and reports their times. Run with
+// "Engine.exe -benchmark-culling". Returns false if the kernels disagree.
+bool RunCullingBenchmark(std::ostream& output);
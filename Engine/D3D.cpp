@@ -1,7 +1,8 @@
 #include "D3D.h"
-
-#define _USE_MATH_DEFINES
-#include <math.h>
+#include "DeferredContext.h"
+#include "JobSystem.h"
+#include "RenderState.h"
+#include <d3dcompiler.h>
 
 D3D::D3D(const InitParams& initParams)
 {
@@ -17,6 +18,12 @@ D3D::D3D(const InitParams& initParams)
 	InitDepthStencilView();
 	InitRasterState();
 	InitViewport(initParams);
+
+	// Route the draw bindings through a cache that skips the ones already in place.
+	_stateCache = std::make_unique<StateCache>(_deviceContext.get());
+	_gpuTimer = std::make_unique<D3DGpuTimer>(_device.get(), _deviceContext.get());
+
+	InitRecorders();
 }
 
 void D3D::InitVideoCardInfo(const InitParams& initParams, uint& numerator, uint& denominator)
@@ -194,19 +201,20 @@ void D3D::InitDepthStencilBuffer(const InitParams& initParams)
 		throw D3DError("Failed to create texture");
 }
 
-void D3D::InitDepthStencilState()
+D3D11_DEPTH_STENCIL_DESC D3D::DescribeDepthStencilState()
 {
-	HRESULT result;
-
 	// Initialize the description of the stencil state.
 	D3D11_DEPTH_STENCIL_DESC depthStencilDesc;
 	ZeroMemory(&depthStencilDesc, sizeof(depthStencilDesc));
 
-	// Set up the description of the stencil state.
-	depthStencilDesc.DepthEnable = true;
-	depthStencilDesc.DepthWriteMask = D3D11_DEPTH_WRITE_MASK_ALL;
-	depthStencilDesc.DepthFunc = D3D11_COMPARISON_LESS;
+	// Set up the description of the depth state. D3D11_COMPARISON_FUNC starts at NEVER = 1 and follows the same order
+	// as the rasterizer enum.
+	SoftwareRasterizer::DepthState depthState = RenderState::DescribeDepthState();
+	depthStencilDesc.DepthEnable = depthState.depthEnable;
+	depthStencilDesc.DepthWriteMask = depthState.depthWrite ? D3D11_DEPTH_WRITE_MASK_ALL : D3D11_DEPTH_WRITE_MASK_ZERO;
+	depthStencilDesc.DepthFunc = (D3D11_COMPARISON_FUNC)(D3D11_COMPARISON_NEVER + (int)depthState.depthFunc);
 
+	// The stencil part is not used by any shader, and the software rasterizer has none.
 	depthStencilDesc.StencilEnable = true;
 	depthStencilDesc.StencilReadMask = 0xFF;
 	depthStencilDesc.StencilWriteMask = 0xFF;
@@ -223,8 +231,15 @@ void D3D::InitDepthStencilState()
 	depthStencilDesc.BackFace.StencilPassOp = D3D11_STENCIL_OP_KEEP;
 	depthStencilDesc.BackFace.StencilFunc = D3D11_COMPARISON_ALWAYS;
 
+	return depthStencilDesc;
+}
+
+void D3D::InitDepthStencilState()
+{
+	D3D11_DEPTH_STENCIL_DESC depthStencilDesc = DescribeDepthStencilState();
+
 	// Create the depth stencil state.
-	result = _device->CreateDepthStencilState(&depthStencilDesc, &_depthStencilState);
+	HRESULT result = _device->CreateDepthStencilState(&depthStencilDesc, &_depthStencilState);
 	if (FAILED(result))
 		throw D3DError("Failed to create depth stencil state");
 
@@ -253,27 +268,34 @@ void D3D::InitDepthStencilView()
 	_deviceContext->OMSetRenderTargets(1, renderTargetViewArray, _depthStencilView.get());
 }
 
-void D3D::InitRasterState()
+D3D11_RASTERIZER_DESC D3D::DescribeRasterState()
 {
-	HRESULT result;
-
 	// Setup the raster description which will determine how and what polygons will be drawn.
 	D3D11_RASTERIZER_DESC rasterDesc;
 	ZeroMemory(&rasterDesc, sizeof(rasterDesc));
 
+	// D3D11_CULL_MODE starts at NONE = 1 and follows the same order as the rasterizer enum.
+	SoftwareRasterizer::RasterState rasterState = RenderState::DescribeRasterState();
 	rasterDesc.AntialiasedLineEnable = false;
-	rasterDesc.CullMode = D3D11_CULL_BACK;
+	rasterDesc.CullMode = (D3D11_CULL_MODE)(D3D11_CULL_NONE + (int)rasterState.cullMode);
 	rasterDesc.DepthBias = 0;
 	rasterDesc.DepthBiasClamp = 0.0f;
-	rasterDesc.DepthClipEnable = true;
+	rasterDesc.DepthClipEnable = rasterState.depthClipEnable;
 	rasterDesc.FillMode = D3D11_FILL_SOLID;
-	rasterDesc.FrontCounterClockwise = false;
+	rasterDesc.FrontCounterClockwise = rasterState.frontCounterClockwise;
 	rasterDesc.MultisampleEnable = false;
 	rasterDesc.ScissorEnable = false;
 	rasterDesc.SlopeScaledDepthBias = 0.0f;
 
+	return rasterDesc;
+}
+
+void D3D::InitRasterState()
+{
+	D3D11_RASTERIZER_DESC rasterDesc = DescribeRasterState();
+
 	// Create the rasterizer state from the description we just filled out.
-	result = _device->CreateRasterizerState(&rasterDesc, &_rasterState);
+	HRESULT result = _device->CreateRasterizerState(&rasterDesc, &_rasterState);
 	if (FAILED(result))
 		throw D3DError("Failed to create rasterizer state");
 
@@ -281,34 +303,76 @@ void D3D::InitRasterState()
 	_deviceContext->RSSetState(_rasterState.get());
 }
 
-void D3D::InitViewport(const InitParams& initParams)
+D3D11_VIEWPORT D3D::DescribeViewport(const InitParams& initParams)
 {
-	float screenWidth = (float)initParams.screenWidth;
-	float screenHeight = (float)initParams.screenHeight;
-
 	// Setup the viewport for rendering.
-	_viewport.Width = screenWidth;
-	_viewport.Height = screenHeight;
-	_viewport.MinDepth = 0.0f;
-	_viewport.MaxDepth = 1.0f;
-	_viewport.TopLeftX = 0.0f;
-	_viewport.TopLeftY = 0.0f;
+	SoftwareRasterizer::Viewport rendererViewport = RenderState::DescribeViewport(initParams.screenWidth, initParams.screenHeight);
+	D3D11_VIEWPORT viewport;
+	viewport.Width = rendererViewport.width;
+	viewport.Height = rendererViewport.height;
+	viewport.MinDepth = rendererViewport.minDepth;
+	viewport.MaxDepth = rendererViewport.maxDepth;
+	viewport.TopLeftX = rendererViewport.topLeftX;
+	viewport.TopLeftY = rendererViewport.topLeftY;
+
+	return viewport;
+}
+
+bool D3D::CompileShader(const ShaderCache::Request& request, std::vector<uchar>& bytecode, std::string& error)
+{
+	WCHAR filename[MAX_PATH];
+	std::mbstowcs(filename, request.filename, MAX_PATH);
+
+	// Compile the shader, resolving includes next to the file, which is also where the cache looks for them.
+	ReleasePtr<ID3D10Blob> shaderBuffer;
+	ReleasePtr<ID3D10Blob> errorMessage;
+	HRESULT result = D3DCompileFromFile(filename, nullptr, D3D_COMPILE_STANDARD_FILE_INCLUDE, request.entryPoint, request.profile,
+		request.flags, 0, &shaderBuffer, &errorMessage);
+	if (FAILED(result))
+	{
+		// If the shader failed to compile it should have writen something to the error message.
+		if (errorMessage)
+			error = std::format("Error compiling shader\n{}", (const char*)errorMessage->GetBufferPointer());
+		// If there was nothing in the error message then it simply could not find the shader file itself.
+		else
+			error = std::format("Missing shader file {}", request.filename);
+		return false;
+	}
+
+	const uchar* data = (const uchar*)shaderBuffer->GetBufferPointer();
+	bytecode.assign(data, data + shaderBuffer->GetBufferSize());
+	return true;
+}
+
+void D3D::InitViewport(const InitParams& initParams)
+{
+	_viewport = DescribeViewport(initParams);
 
 	// Create the viewport.
 	_deviceContext->RSSetViewports(1, &_viewport);
 
-	// Setup the projection matrix.
-	float fieldOfView = (float)M_PI / 4.0f;
-	float screenAspect = screenWidth / screenHeight;
-
-	// Create the projection matrix for 3D rendering.
-	_projectionMatrix = DirectX::XMMatrixPerspectiveFovLH(fieldOfView, screenAspect, initParams.screenNear, initParams.screenFar);
+	_projectionMatrix = RenderState::CreateProjectionMatrix(initParams.screenWidth, initParams.screenHeight, initParams.screenNear, initParams.screenFar);
 
 	// Initialize the world matrix to the identity matrix.
-	_worldMatrix = DirectX::XMMatrixIdentity();
+	_worldMatrix = Math::Identity();
 
-	// Create an orthographic projection matrix for 2D rendering.
-	_orthoMatrix = DirectX::XMMatrixOrthographicLH(screenWidth, screenHeight, initParams.screenNear, initParams.screenFar);
+	_orthoMatrix = RenderState::CreateOrthoMatrix(initParams.screenWidth, initParams.screenHeight, initParams.screenNear, initParams.screenFar);
+}
+
+void D3D::InitRecorders()
+{
+	// Binding constant buffers by offset needs Direct3D 11.1; older runtimes leave the pointer null.
+	_deviceContext->QueryInterface(__uuidof(ID3D11DeviceContext1), (void**)&_deviceContext1);
+
+	// Only record in parallel when the driver builds command lists itself.
+	D3D11_FEATURE_DATA_THREADING threading = {};
+	HRESULT result = _device->CheckFeatureSupport(D3D11_FEATURE_THREADING, &threading, sizeof(threading));
+	if (FAILED(result) || !threading.DriverCommandLists)
+		return;
+
+	uint recorderCount = JobSystem::GetDefault().GetThreadCount();
+	for (uint i = 0u; i < recorderCount; ++i)
+		_recorders.push_back(std::make_unique<DeferredContext>(*this, _device.get()));
 }
 
 D3D::~D3D()
@@ -330,6 +394,9 @@ void D3D::BeginScene(float red, float green, float blue, float alpha)
 
 	// Clear the depth buffer.
 	_deviceContext->ClearDepthStencilView(_depthStencilView.get(), D3D11_CLEAR_DEPTH, 1.0f, 0);
+
+	// Start the frame without assumptions about what is bound.
+	_stateCache->BeginFrame();
 }
 
 
@@ -348,6 +415,11 @@ void D3D::EndScene()
 	}
 }
 
+D3DContext* D3D::GetD3DContext()
+{
+	return this;
+}
+
 ID3D11Device* D3D::GetDevice()
 {
 	return _device.get();
@@ -358,17 +430,97 @@ ID3D11DeviceContext* D3D::GetDeviceContext()
 	return _deviceContext.get();
 }
 
-void D3D::GetProjectionMatrix(DirectX::XMMATRIX& projectionMatrix)
+ID3D11DeviceContext1* D3D::GetDeviceContext1()
+{
+	return _deviceContext1.get();
+}
+
+StateCache* D3D::GetStateCache()
+{
+	return _stateCache.get();
+}
+
+GpuTimer* D3D::GetGpuTimer()
+{
+	return _gpuTimer.get();
+}
+
+void D3D::SetMesh(const MeshBuffers& mesh)
+{
+	// Set the vertex buffer to active in the input assembler so it can be rendered.
+	_stateCache->SetVertexBuffer(0u, mesh.vertexBuffer, mesh.vertexStride);
+
+	// Set the index buffer to active in the input assembler so it can be rendered.
+	_stateCache->SetIndexBuffer(mesh.indexBuffer, DXGI_FORMAT_R32_UINT);
+
+	// Set the type of primitive that should be rendered from this vertex buffer, in this case triangles.
+	_stateCache->SetPrimitiveTopology(D3D11_PRIMITIVE_TOPOLOGY_TRIANGLELIST);
+}
+
+void D3D::SetTransforms(const Math::Matrix4&, const Math::Matrix4&, const Math::Matrix4&, const Math::Float2&)
+{
+	// On the GPU the transforms live in the constant buffers owned by the shader programs, which upload them themselves.
+}
+
+void D3D::SetTexture(uint slot, const TextureBinding& texture)
+{
+	// Set shader texture resource in the pixel shader.
+	_stateCache->SetShaderResource(StateCache::Stage::Pixel, slot, texture.view);
+}
+
+void D3D::DrawIndexed(uint indexCount, uint startIndex, int baseVertex)
+{
+	_deviceContext->DrawIndexed(indexCount, startIndex, baseVertex);
+}
+
+void D3D::SetInstances(const InstanceBuffers& instances)
+{
+	// Set the instance buffer as the second vertex stream, next to the mesh's vertices.
+	_stateCache->SetVertexBuffer(InstanceBuffers::INPUT_SLOT, instances.buffer, sizeof(InstanceData));
+}
+
+void D3D::DrawIndexedInstanced(uint indexCount, uint instanceCount, uint startIndex, int baseVertex, uint startInstance)
+{
+	_deviceContext->DrawIndexedInstanced(indexCount, instanceCount, startIndex, baseVertex, startInstance);
+}
+
+uint D3D::GetRecorderCount()
+{
+	return (uint)_recorders.size();
+}
+
+CommandRecorder* D3D::GetRecorder(uint index)
+{
+	return index < _recorders.size() ? _recorders[index].get() : nullptr;
+}
+
+void D3D::Execute(CommandRecorder& recorder)
+{
+	// Every recorder of this backend is one of its deferred contexts.
+	DeferredContext& deferredContext = static_cast<DeferredContext&>(recorder);
+	ReleasePtr<ID3D11CommandList> commandList = deferredContext.TakeCommandList();
+	if (!commandList)
+		return;
+
+	// Replay without saving the immediate context's state, which is cheaper, then put back the output and forget
+	// the bindings the replay cleared. The recording's binds count as this frame's.
+	_deviceContext->ExecuteCommandList(commandList.get(), FALSE);
+	BindOutput(_deviceContext.get());
+	_stateCache->Invalidate();
+	_stateCache->AddStats(deferredContext.GetStateCache()->GetStats());
+}
+
+void D3D::GetProjectionMatrix(Math::Matrix4& projectionMatrix)
 {
 	projectionMatrix = _projectionMatrix;
 }
 
-void D3D::GetWorldMatrix(DirectX::XMMATRIX& worldMatrix)
+void D3D::GetWorldMatrix(Math::Matrix4& worldMatrix)
 {
 	worldMatrix = _worldMatrix;
 }
 
-void D3D::GetOrthoMatrix(DirectX::XMMATRIX& orthoMatrix)
+void D3D::GetOrthoMatrix(Math::Matrix4& orthoMatrix)
 {
 	orthoMatrix = _orthoMatrix;
 }
@@ -390,3 +542,12 @@ void D3D::ResetViewport()
 	// Set the viewport.
 	_deviceContext->RSSetViewports(1, &_viewport);
 }
+
+void D3D::BindOutput(ID3D11DeviceContext* deviceContext)
+{
+	ID3D11RenderTargetView* renderTargetViewArray[1]{ _renderTargetView.get() };
+	deviceContext->OMSetRenderTargets(1, renderTargetViewArray, _depthStencilView.get());
+	deviceContext->OMSetDepthStencilState(_depthStencilState.get(), 1);
+	deviceContext->RSSetState(_rasterState.get());
+	deviceContext->RSSetViewports(1, &_viewport);
+}
@@ -5,12 +5,20 @@
 #pragma comment(lib, "d3dcompiler.lib")
 
 #pragma warning(push, 0)
-#include <d3d11.h>
+#include <d3d11_1.h>
 #include <directxmath.h>
 #pragma warning(pop)
 
 #include "Common.h"
+#include "D3DContext.h"
+#include "EngineMath.h"
 #include "ReleasePtr.h"
+#include "RenderBackend.h"
+#include "D3DGpuTimer.h"
+#include "ShaderCache.h"
+#include "StateCache.h"
+
+class DeferredContext;
 
 class D3DError : public std::runtime_error
 {
@@ -19,7 +27,7 @@ public:
 	D3DError(const char* message) : std::runtime_error(message) {}
 };
 
-class D3D
+class D3D : public RenderBackend, public D3DContext
 {
 public:
 
@@ -37,21 +45,53 @@ public:
 	D3D(const InitParams& initParams);
     ~D3D();
 
-    void BeginScene(float red, float green, float blue, float alpha);
-    void EndScene();
+    void BeginScene(float red, float green, float blue, float alpha) override;
+    void EndScene() override;
+
+    D3DContext* GetD3DContext() override;
+    GpuTimer* GetGpuTimer() override;
+
+    ID3D11Device* GetDevice() override;
+    ID3D11DeviceContext* GetDeviceContext() override;
+    ID3D11DeviceContext1* GetDeviceContext1() override;
+    StateCache* GetStateCache() override;
+
+    void GetProjectionMatrix(Math::Matrix4&) override;
+    void GetWorldMatrix(Math::Matrix4&) override;
+    void GetOrthoMatrix(Math::Matrix4&) override;
 
-    ID3D11Device* GetDevice();
-    ID3D11DeviceContext* GetDeviceContext();
+    void SetMesh(const MeshBuffers& mesh) override;
+    void SetTransforms(const Math::Matrix4& worldMatrix, const Math::Matrix4& viewMatrix, const Math::Matrix4& projectionMatrix,
+        const Math::Float2& textureOffset) override;
+    void SetTexture(uint slot, const TextureBinding& texture) override;
+    void DrawIndexed(uint indexCount, uint startIndex, int baseVertex) override;
+    void SetInstances(const InstanceBuffers& instances) override;
+    void DrawIndexedInstanced(uint indexCount, uint instanceCount, uint startIndex, int baseVertex, uint startInstance) override;
 
-    void GetProjectionMatrix(DirectX::XMMATRIX&);
-    void GetWorldMatrix(DirectX::XMMATRIX&);
-    void GetOrthoMatrix(DirectX::XMMATRIX&);
+    // One deferred context per job system thread, when the driver records command lists natively. Without native
+    // support the runtime emulates command lists at a cost that outweighs recording in parallel, so there are none.
+    uint GetRecorderCount() override;
+    CommandRecorder* GetRecorder(uint index) override;
+    void Execute(CommandRecorder& recorder) override;
+
+    // RenderState's pipeline state as Direct3D describes it, so every backend renders with the same depth test, culling
+    // and viewport.
+    static D3D11_DEPTH_STENCIL_DESC DescribeDepthStencilState();
+    static D3D11_RASTERIZER_DESC DescribeRasterState();
+    static D3D11_VIEWPORT DescribeViewport(const InitParams& initParams);
+
+    // ShaderCache compiler that runs D3DCompileFromFile.
+    static bool CompileShader(const ShaderCache::Request& request, std::vector<uchar>& bytecode, std::string& error);
 
     const std::string& GetVideoCardInfo() const;
 
     void SetBackBufferRenderTarget();
     void ResetViewport();
 
+    // Binds the back buffer, depth buffer, viewport, depth stencil state and raster state to a context. Deferred
+    // contexts start every command list without them, and executing one clears them from the immediate context.
+    void BindOutput(ID3D11DeviceContext* deviceContext);
+
 private:
 
 	void InitVideoCardInfo(const InitParams& initParams, uint& numerator, uint& denominator);
@@ -62,6 +102,7 @@ private:
 	void InitDepthStencilView();
     void InitRasterState();
     void InitViewport(const InitParams& initParams);
+    void InitRecorders();
 
     bool _vsyncEnabled = false;
     int _videoCardMemory = 0;
@@ -69,14 +110,18 @@ private:
     ReleasePtr<IDXGISwapChain> _swapChain;
     ReleasePtr<ID3D11Device> _device;
     ReleasePtr<ID3D11DeviceContext> _deviceContext;
+    ReleasePtr<ID3D11DeviceContext1> _deviceContext1;
+    std::unique_ptr<StateCache> _stateCache;
+    std::unique_ptr<D3DGpuTimer> _gpuTimer;
+    std::vector<std::unique_ptr<DeferredContext>> _recorders;
     ReleasePtr<ID3D11RenderTargetView> _renderTargetView;
     ReleasePtr<ID3D11Texture2D> _depthStencilBuffer;
     ReleasePtr<ID3D11DepthStencilState> _depthStencilState;
     ReleasePtr<ID3D11DepthStencilView> _depthStencilView;
     ReleasePtr<ID3D11RasterizerState> _rasterState;
-    DirectX::XMMATRIX _projectionMatrix;
-    DirectX::XMMATRIX _worldMatrix;
-    DirectX::XMMATRIX _orthoMatrix;
+    Math::Matrix4 _projectionMatrix;
+    Math::Matrix4 _worldMatrix;
+    Math::Matrix4 _orthoMatrix;
     D3D11_VIEWPORT _viewport;
 };
 
@@ -0,0 +1,56 @@
+#pragma once
+
+#include "Common.h"
+#include "RenderBackend.h"
+
+class StateCache;
+
+// Forward declared like in RenderBackend.h, so classes that create GPU resources when there is a device build without
+// the Windows SDK too. Code that calls into Direct3D includes D3D.h.
+struct ID3D11Device;
+struct ID3D11DeviceContext;
+struct ID3D11DeviceContext1;
+
+// The Direct3D side of a render backend: the device and the context it draws on. D3D and its deferred contexts
+// implement it, and RenderBackend::GetD3DContext hands it to the code that creates and binds GPU resources, so the
+// backend interface itself needs no Direct3D headers.
+class D3DContext
+{
+public:
+
+	virtual ~D3DContext() = default;
+
+	virtual ID3D11Device* GetDevice() = 0;
+	virtual ID3D11DeviceContext* GetDeviceContext() = 0;
+
+	// The Direct3D 11.1 interface of the device context, which binds constant buffers by offset. Null before 11.1.
+	virtual ID3D11DeviceContext1* GetDeviceContext1() = 0;
+
+	// Binds through a shadow copy of the device context that drops redundant bindings.
+	virtual StateCache* GetStateCache() = 0;
+};
+
+// The Direct3D objects of a backend, or null for backends that draw without Direct3D.
+inline ID3D11Device* GetDevice(RenderBackend& renderer)
+{
+	D3DContext* context = renderer.GetD3DContext();
+	return context ? context->GetDevice() : nullptr;
+}
+
+inline ID3D11DeviceContext* GetDeviceContext(RenderBackend& renderer)
+{
+	D3DContext* context = renderer.GetD3DContext();
+	return context ? context->GetDeviceContext() : nullptr;
+}
+
+inline ID3D11DeviceContext1* GetDeviceContext1(RenderBackend& renderer)
+{
+	D3DContext* context = renderer.GetD3DContext();
+	return context ? context->GetDeviceContext1() : nullptr;
+}
+
+inline StateCache* GetStateCache(RenderBackend& renderer)
+{
+	D3DContext* context = renderer.GetD3DContext();
+	return context ? context->GetStateCache() : nullptr;
+}
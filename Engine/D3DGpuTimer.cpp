@@ -0,0 +1,73 @@
+#include "D3DGpuTimer.h"
+#include "D3D.h"
+
+D3DGpuTimer::D3DGpuTimer(ID3D11Device* device, ID3D11DeviceContext* deviceContext)
+	: _device(device)
+	, _deviceContext(deviceContext)
+{
+}
+
+void D3DGpuTimer::CreateQueries(uint disjointCount, uint timestampCount)
+{
+	D3D11_QUERY_DESC desc = {};
+
+	desc.Query = D3D11_QUERY_TIMESTAMP_DISJOINT;
+	_disjointQueries.clear();
+	_disjointQueries.resize(disjointCount);
+	for (ReleasePtr<ID3D11Query>& query : _disjointQueries)
+	{
+		if (FAILED(_device->CreateQuery(&desc, &query)))
+			throw D3DError("Failed to create a timestamp disjoint query");
+	}
+
+	desc.Query = D3D11_QUERY_TIMESTAMP;
+	_timestampQueries.clear();
+	_timestampQueries.resize(timestampCount);
+	for (ReleasePtr<ID3D11Query>& query : _timestampQueries)
+	{
+		if (FAILED(_device->CreateQuery(&desc, &query)))
+			throw D3DError("Failed to create a timestamp query");
+	}
+}
+
+void D3DGpuTimer::BeginDisjoint(uint query)
+{
+	_deviceContext->Begin(_disjointQueries[query].get());
+}
+
+void D3DGpuTimer::EndDisjoint(uint query)
+{
+	_deviceContext->End(_disjointQueries[query].get());
+}
+
+void D3DGpuTimer::Timestamp(uint query)
+{
+	// Timestamp queries have no Begin; End records the time.
+	_deviceContext->End(_timestampQueries[query].get());
+}
+
+void D3DGpuTimer::Flush()
+{
+	_deviceContext->Flush();
+}
+
+bool D3DGpuTimer::GetDisjoint(uint query, Disjoint& result)
+{
+	D3D11_QUERY_DATA_TIMESTAMP_DISJOINT data;
+	if (_deviceContext->GetData(_disjointQueries[query].get(), &data, sizeof(data), D3D11_ASYNC_GETDATA_DONOTFLUSH) != S_OK)
+		return false;
+
+	result.frequency = data.Frequency;
+	result.disjoint = data.Disjoint != FALSE;
+	return true;
+}
+
+bool D3DGpuTimer::GetTimestamp(uint query, uint64_t& ticks)
+{
+	UINT64 data;
+	if (_deviceContext->GetData(_timestampQueries[query].get(), &data, sizeof(data), D3D11_ASYNC_GETDATA_DONOTFLUSH) != S_OK)
+		return false;
+
+	ticks = data;
+	return true;
+}
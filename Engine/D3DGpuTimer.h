@@ -0,0 +1,34 @@
+#pragma once
+
+#include <d3d11.h>
+
+#include "Common.h"
+#include "GpuTimer.h"
+#include "ReleasePtr.h"
+
+// GPU timestamps on a Direct3D 11 immediate context. Results are read without flushing, since every frame's Present
+// flushes anyway; GpuTimer::Flush is there for when a result is wanted sooner.
+class D3DGpuTimer : public GpuTimer
+{
+public:
+
+	D3DGpuTimer(ID3D11Device* device, ID3D11DeviceContext* deviceContext);
+
+	// Throws D3DError if the device cannot create the queries.
+	void CreateQueries(uint disjointCount, uint timestampCount) override;
+
+	void BeginDisjoint(uint query) override;
+	void EndDisjoint(uint query) override;
+	void Timestamp(uint query) override;
+	void Flush() override;
+
+	bool GetDisjoint(uint query, Disjoint& result) override;
+	bool GetTimestamp(uint query, uint64_t& ticks) override;
+
+private:
+
+	ID3D11Device* _device;
+	ID3D11DeviceContext* _deviceContext;
+	std::vector<ReleasePtr<ID3D11Query>> _disjointQueries;
+	std::vector<ReleasePtr<ID3D11Query>> _timestampQueries;
+};
@@ -0,0 +1,389 @@
+#include "DdsFile.h"
+
+#include <algorithm>
+#include <string.h>
+
+namespace
+{
+	const uint MAGIC = 0x20534444u; // "DDS "
+	const size_t HEADER_SIZE = 124u;
+	const size_t DX10_HEADER_SIZE = 20u;
+
+	// Header flags.
+	const uint DDSD_CAPS = 0x1u;
+	const uint DDSD_HEIGHT = 0x2u;
+	const uint DDSD_WIDTH = 0x4u;
+	const uint DDSD_PITCH = 0x8u;
+	const uint DDSD_PIXELFORMAT = 0x1000u;
+	const uint DDSD_MIPMAPCOUNT = 0x20000u;
+	const uint DDSD_LINEARSIZE = 0x80000u;
+	const uint DDSD_DEPTH = 0x800000u;
+
+	// Pixel format flags.
+	const uint DDPF_ALPHAPIXELS = 0x1u;
+	const uint DDPF_FOURCC = 0x4u;
+	const uint DDPF_RGB = 0x40u;
+
+	// Capability flags.
+	const uint DDSCAPS_COMPLEX = 0x8u;
+	const uint DDSCAPS_TEXTURE = 0x1000u;
+	const uint DDSCAPS_MIPMAP = 0x400000u;
+	const uint DDSCAPS2_CUBEMAP = 0x200u;
+	const uint DDSCAPS2_VOLUME = 0x200000u;
+
+	// DX10 header values.
+	const uint DIMENSION_TEXTURE2D = 3u;
+	const uint MISC_TEXTURECUBE = 0x4u;
+
+	// Offsets of the fields used here, relative to the start of the header after the magic number.
+	const size_t OFFSET_FLAGS = 4u;
+	const size_t OFFSET_HEIGHT = 8u;
+	const size_t OFFSET_WIDTH = 12u;
+	const size_t OFFSET_PITCH = 16u;
+	const size_t OFFSET_MIPMAPCOUNT = 24u;
+	const size_t OFFSET_PIXELFORMAT = 72u;
+	const size_t OFFSET_PIXELFORMAT_FLAGS = 76u;
+	const size_t OFFSET_FOURCC = 80u;
+	const size_t OFFSET_BITCOUNT = 84u;
+	const size_t OFFSET_RED_MASK = 88u;
+	const size_t OFFSET_GREEN_MASK = 92u;
+	const size_t OFFSET_BLUE_MASK = 96u;
+	const size_t OFFSET_ALPHA_MASK = 100u;
+	const size_t OFFSET_CAPS = 104u;
+	const size_t OFFSET_CAPS2 = 108u;
+
+	constexpr uint MakeFourCC(char a, char b, char c, char d)
+	{
+		return (uint)(uchar)a | ((uint)(uchar)b << 8) | ((uint)(uchar)c << 16) | ((uint)(uchar)d << 24);
+	}
+
+	uint ReadUint32(const uchar* data)
+	{
+		return (uint)data[0] | ((uint)data[1] << 8) | ((uint)data[2] << 16) | ((uint)data[3] << 24);
+	}
+
+	void WriteUint32(uchar* data, uint value)
+	{
+		for (uint i = 0u; i < 4u; ++i)
+			data[i] = (uchar)(value >> (i * 8u));
+	}
+
+	DdsFile::Format GetFourCCFormat(uint fourCC)
+	{
+		switch (fourCC)
+		{
+		case MakeFourCC('D', 'X', 'T', '1'): return DdsFile::Format::BC1;
+		case MakeFourCC('D', 'X', 'T', '2'):
+		case MakeFourCC('D', 'X', 'T', '3'): return DdsFile::Format::BC2;
+		case MakeFourCC('D', 'X', 'T', '4'):
+		case MakeFourCC('D', 'X', 'T', '5'): return DdsFile::Format::BC3;
+		case MakeFourCC('A', 'T', 'I', '1'):
+		case MakeFourCC('B', 'C', '4', 'U'): return DdsFile::Format::BC4;
+		case MakeFourCC('A', 'T', 'I', '2'):
+		case MakeFourCC('B', 'C', '5', 'U'): return DdsFile::Format::BC5;
+		default: return DdsFile::Format::Unknown;
+		}
+	}
+
+	// Legacy uncompressed formats are described by bit masks; only the 32-bit byte orders Direct3D can sample are accepted.
+	DdsFile::Format GetMaskFormat(uint bitCount, uint redMask, uint greenMask, uint blueMask, uint alphaMask)
+	{
+		if (bitCount != 32u || greenMask != 0x0000FF00u)
+			return DdsFile::Format::Unknown;
+		if (redMask == 0x000000FFu && blueMask == 0x00FF0000u)
+			return DdsFile::Format::R8G8B8A8;
+		if (redMask == 0x00FF0000u && blueMask == 0x000000FFu)
+			return alphaMask == 0xFF000000u ? DdsFile::Format::B8G8R8A8 : DdsFile::Format::B8G8R8X8;
+		return DdsFile::Format::Unknown;
+	}
+
+	bool IsKnownFormat(uint format)
+	{
+		switch ((DdsFile::Format)format)
+		{
+		case DdsFile::Format::R8G8B8A8:
+		case DdsFile::Format::R8G8B8A8Srgb:
+		case DdsFile::Format::BC1:
+		case DdsFile::Format::BC1Srgb:
+		case DdsFile::Format::BC2:
+		case DdsFile::Format::BC2Srgb:
+		case DdsFile::Format::BC3:
+		case DdsFile::Format::BC3Srgb:
+		case DdsFile::Format::BC4:
+		case DdsFile::Format::BC5:
+		case DdsFile::Format::B8G8R8A8:
+		case DdsFile::Format::B8G8R8X8:
+		case DdsFile::Format::B8G8R8A8Srgb:
+		case DdsFile::Format::BC7:
+		case DdsFile::Format::BC7Srgb:
+			return true;
+		default:
+			return false;
+		}
+	}
+}
+
+DdsFile::DdsFile(const char* filename)
+{
+	_isValid = Read(filename);
+}
+
+DdsFile::DdsFile(const uchar* data, size_t size)
+	: _external(data)
+{
+	_isValid = Parse(data, size);
+}
+
+DdsFile::DdsFile(Format format, uint width, uint height)
+	: _format(format)
+	, _width(width)
+	, _height(height)
+{
+	_isValid = IsKnownFormat((uint)format) && width > 0u && height > 0u;
+}
+
+bool DdsFile::Read(const char* filename)
+{
+	// Read the whole file; DDS textures are uploaded in one piece anyway.
+	std::ifstream file(filename, std::ios::binary | std::ios::ate);
+	if (!file)
+		return false;
+
+	std::streamoff fileSize = file.tellg();
+	if (fileSize < (std::streamoff)(4u + HEADER_SIZE))
+		return false;
+	file.seekg(0);
+
+	_data.resize((size_t)fileSize);
+	if (!file.read((char*)_data.data(), fileSize))
+		return false;
+
+	return Parse(_data.data(), _data.size());
+}
+
+bool DdsFile::Parse(const uchar* contents, size_t size)
+{
+	if (size < 4u + HEADER_SIZE || ReadUint32(contents) != MAGIC)
+		return false;
+
+	const uchar* header = contents + 4u;
+	if (ReadUint32(header) != HEADER_SIZE || ReadUint32(header + OFFSET_PIXELFORMAT) != 32u)
+		return false;
+
+	uint flags = ReadUint32(header + OFFSET_FLAGS);
+	_width = ReadUint32(header + OFFSET_WIDTH);
+	_height = ReadUint32(header + OFFSET_HEIGHT);
+	uint levelCount = (flags & DDSD_MIPMAPCOUNT) ? std::max(1u, ReadUint32(header + OFFSET_MIPMAPCOUNT)) : 1u;
+	uint caps2 = ReadUint32(header + OFFSET_CAPS2);
+	if (_width == 0u || _height == 0u || (flags & DDSD_DEPTH) || (caps2 & (DDSCAPS2_CUBEMAP | DDSCAPS2_VOLUME)))
+		return false;
+
+	size_t dataOffset = 4u + HEADER_SIZE;
+	uint pixelFormatFlags = ReadUint32(header + OFFSET_PIXELFORMAT_FLAGS);
+	uint fourCC = ReadUint32(header + OFFSET_FOURCC);
+
+	if ((pixelFormatFlags & DDPF_FOURCC) && fourCC == MakeFourCC('D', 'X', '1', '0'))
+	{
+		// The DX10 extension names the DXGI format directly.
+		if (size < dataOffset + DX10_HEADER_SIZE)
+			return false;
+
+		const uchar* extension = contents + dataOffset;
+		uint format = ReadUint32(extension);
+		uint dimension = ReadUint32(extension + 4u);
+		uint miscFlags = ReadUint32(extension + 8u);
+		uint arraySize = ReadUint32(extension + 12u);
+		if (!IsKnownFormat(format) || dimension != DIMENSION_TEXTURE2D || (miscFlags & MISC_TEXTURECUBE) || arraySize > 1u)
+			return false;
+
+		_format = (Format)format;
+		dataOffset += DX10_HEADER_SIZE;
+	}
+	else if (pixelFormatFlags & DDPF_FOURCC)
+	{
+		_format = GetFourCCFormat(fourCC);
+	}
+	else if (pixelFormatFlags & DDPF_RGB)
+	{
+		uint alphaMask = (pixelFormatFlags & DDPF_ALPHAPIXELS) ? ReadUint32(header + OFFSET_ALPHA_MASK) : 0u;
+		_format = GetMaskFormat(ReadUint32(header + OFFSET_BITCOUNT), ReadUint32(header + OFFSET_RED_MASK),
+			ReadUint32(header + OFFSET_GREEN_MASK), ReadUint32(header + OFFSET_BLUE_MASK), alphaMask);
+	}
+	if (_format == Format::Unknown)
+		return false;
+
+	// Levels follow each other without padding; a chain never goes below 1x1.
+	levelCount = std::min(levelCount, 32u);
+	size_t dataSize = 0u;
+	for (uint level = 0u; level < levelCount; ++level)
+	{
+		uint levelWidth = std::max(1u, _width >> level);
+		uint levelHeight = std::max(1u, _height >> level);
+		_levelOffsets.push_back(dataSize);
+		dataSize += GetLevelSize(_format, levelWidth, levelHeight);
+		if (levelWidth == 1u && levelHeight == 1u)
+			break;
+	}
+	if (size < dataOffset + dataSize)
+		return false;
+
+	_levelsOffset = dataOffset;
+	_levelsSize = dataSize;
+	return true;
+}
+
+bool DdsFile::IsValid() const
+{
+	return _isValid;
+}
+
+DdsFile::Format DdsFile::GetFormat() const
+{
+	return _format;
+}
+
+uint DdsFile::GetWidth() const
+{
+	return _width;
+}
+
+uint DdsFile::GetHeight() const
+{
+	return _height;
+}
+
+uint DdsFile::GetLevelCount() const
+{
+	return (uint)_levelOffsets.size();
+}
+
+DdsFile::Level DdsFile::GetLevel(uint level) const
+{
+	Level result;
+	result.width = std::max(1u, _width >> level);
+	result.height = std::max(1u, _height >> level);
+	result.rowPitch = GetRowPitch(_format, result.width);
+	result.data = (_external ? _external : _data.data()) + _levelsOffset + _levelOffsets[level];
+	return result;
+}
+
+void DdsFile::AddLevel(const uchar* data)
+{
+	uint level = GetLevelCount();
+	size_t size = GetLevelSize(_format, std::max(1u, _width >> level), std::max(1u, _height >> level));
+
+	_levelOffsets.push_back(_levelsSize);
+	_data.insert(_data.end(), data, data + size);
+	_levelsSize += size;
+}
+
+bool DdsFile::Save(const char* filename) const
+{
+	if (!_isValid || _levelOffsets.empty())
+		return false;
+
+	uchar header[4u + HEADER_SIZE + DX10_HEADER_SIZE] = {};
+	uchar* fields = header + 4u;
+	WriteUint32(header, MAGIC);
+
+	uint levelCount = GetLevelCount();
+	bool compressed = IsBlockCompressed(_format);
+	uint flags = DDSD_CAPS | DDSD_HEIGHT | DDSD_WIDTH | DDSD_PIXELFORMAT | (compressed ? DDSD_LINEARSIZE : DDSD_PITCH);
+	if (levelCount > 1u)
+		flags |= DDSD_MIPMAPCOUNT;
+
+	WriteUint32(fields, HEADER_SIZE);
+	WriteUint32(fields + OFFSET_FLAGS, flags);
+	WriteUint32(fields + OFFSET_HEIGHT, _height);
+	WriteUint32(fields + OFFSET_WIDTH, _width);
+	WriteUint32(fields + OFFSET_PITCH, compressed ? (uint)GetLevelSize(_format, _width, _height) : GetRowPitch(_format, _width));
+	WriteUint32(fields + OFFSET_MIPMAPCOUNT, levelCount);
+	WriteUint32(fields + OFFSET_PIXELFORMAT, 32u);
+	WriteUint32(fields + OFFSET_CAPS, DDSCAPS_TEXTURE | (levelCount > 1u ? DDSCAPS_COMPLEX | DDSCAPS_MIPMAP : 0u));
+
+	// Formats every reader understands get a legacy header; the rest need the DX10 extension.
+	size_t headerSize = 4u + HEADER_SIZE;
+	switch (_format)
+	{
+	case Format::BC1:
+		WriteUint32(fields + OFFSET_PIXELFORMAT_FLAGS, DDPF_FOURCC);
+		WriteUint32(fields + OFFSET_FOURCC, MakeFourCC('D', 'X', 'T', '1'));
+		break;
+	case Format::BC2:
+		WriteUint32(fields + OFFSET_PIXELFORMAT_FLAGS, DDPF_FOURCC);
+		WriteUint32(fields + OFFSET_FOURCC, MakeFourCC('D', 'X', 'T', '3'));
+		break;
+	case Format::BC3:
+		WriteUint32(fields + OFFSET_PIXELFORMAT_FLAGS, DDPF_FOURCC);
+		WriteUint32(fields + OFFSET_FOURCC, MakeFourCC('D', 'X', 'T', '5'));
+		break;
+	case Format::R8G8B8A8:
+	case Format::B8G8R8A8:
+	{
+		bool rgba = _format == Format::R8G8B8A8;
+		WriteUint32(fields + OFFSET_PIXELFORMAT_FLAGS, DDPF_RGB | DDPF_ALPHAPIXELS);
+		WriteUint32(fields + OFFSET_BITCOUNT, 32u);
+		WriteUint32(fields + OFFSET_RED_MASK, rgba ? 0x000000FFu : 0x00FF0000u);
+		WriteUint32(fields + OFFSET_GREEN_MASK, 0x0000FF00u);
+		WriteUint32(fields + OFFSET_BLUE_MASK, rgba ? 0x00FF0000u : 0x000000FFu);
+		WriteUint32(fields + OFFSET_ALPHA_MASK, 0xFF000000u);
+		break;
+	}
+	default:
+	{
+		WriteUint32(fields + OFFSET_PIXELFORMAT_FLAGS, DDPF_FOURCC);
+		WriteUint32(fields + OFFSET_FOURCC, MakeFourCC('D', 'X', '1', '0'));
+
+		uchar* extension = header + headerSize;
+		WriteUint32(extension, (uint)_format);
+		WriteUint32(extension + 4u, DIMENSION_TEXTURE2D);
+		WriteUint32(extension + 12u, 1u);
+		headerSize += DX10_HEADER_SIZE;
+		break;
+	}
+	}
+
+	std::ofstream file(filename, std::ios::binary);
+	if (!file)
+		return false;
+
+	file.write((const char*)header, (std::streamsize)headerSize);
+	file.write((const char*)(_external ? _external : _data.data()) + _levelsOffset, (std::streamsize)_levelsSize);
+	return (bool)file;
+}
+
+bool DdsFile::IsBlockCompressed(Format format)
+{
+	switch (format)
+	{
+	case Format::BC1:
+	case Format::BC1Srgb:
+	case Format::BC2:
+	case Format::BC2Srgb:
+	case Format::BC3:
+	case Format::BC3Srgb:
+	case Format::BC4:
+	case Format::BC5:
+	case Format::BC7:
+	case Format::BC7Srgb:
+		return true;
+	default:
+		return false;
+	}
+}
+
+uint DdsFile::GetRowPitch(Format format, uint width)
+{
+	if (!IsBlockCompressed(format))
+		return width * 4u;
+
+	// BC1 and BC4 blocks take 8 bytes, the others 16.
+	bool smallBlocks = format == Format::BC1 || format == Format::BC1Srgb || format == Format::BC4;
+	return std::max(1u, (width + 3u) / 4u) * (smallBlocks ? 8u : 16u);
+}
+
+size_t DdsFile::GetLevelSize(Format format, uint width, uint height)
+{
+	uint rows = IsBlockCompressed(format) ? std::max(1u, (height + 3u) / 4u) : height;
+	return (size_t)GetRowPitch(format, width) * rows;
+}
@@ -0,0 +1,79 @@
+#pragma once
+
+#include "Common.h"
+
+// Reader and writer for DDS files holding a single 2D texture with its mip chain, so pre-compressed assets can be
+// uploaded without decoding. Both the legacy header (FourCC and bit mask formats) and the DX10 extension are read;
+// cube maps, volumes and arrays are rejected. Like TargaDecoder it has no Direct3D dependency.
+class DdsFile
+{
+public:
+
+	// Values match DXGI_FORMAT, so they can be handed to Direct3D directly.
+	enum class Format : uint
+	{
+		Unknown = 0u,
+		R8G8B8A8 = 28u,
+		R8G8B8A8Srgb = 29u,
+		BC1 = 71u,
+		BC1Srgb = 72u,
+		BC2 = 74u,
+		BC2Srgb = 75u,
+		BC3 = 77u,
+		BC3Srgb = 78u,
+		BC4 = 80u,
+		BC5 = 83u,
+		B8G8R8A8 = 87u,
+		B8G8R8X8 = 88u,
+		B8G8R8A8Srgb = 91u,
+		BC7 = 98u,
+		BC7Srgb = 99u
+	};
+
+	struct Level
+	{
+		uint width = 0u;
+		uint height = 0u;
+		uint rowPitch = 0u;	// Bytes per row of pixels, or per row of blocks for compressed formats.
+		const uchar* data = nullptr;
+	};
+
+	// Reads the file. Check IsValid before using the levels.
+	DdsFile(const char* filename);
+
+	// Parses a whole DDS file held in memory without copying it; the levels point into data, which must outlive this object.
+	DdsFile(const uchar* data, size_t size);
+
+	// Creates an empty image; fill it with AddLevel from the top level down and write it with Save.
+	DdsFile(Format format, uint width, uint height);
+
+	bool IsValid() const;
+	Format GetFormat() const;
+	uint GetWidth() const;
+	uint GetHeight() const;
+	uint GetLevelCount() const;
+	Level GetLevel(uint level) const;
+
+	// Appends the next mip level, which must hold GetLevelSize bytes for that level's dimensions.
+	void AddLevel(const uchar* data);
+	bool Save(const char* filename) const;
+
+	static bool IsBlockCompressed(Format format);
+	static uint GetRowPitch(Format format, uint width);
+	static size_t GetLevelSize(Format format, uint width, uint height);
+
+private:
+
+	bool Read(const char* filename);
+	bool Parse(const uchar* contents, size_t size);
+
+	Format _format = Format::Unknown;
+	uint _width = 0u;
+	uint _height = 0u;
+	std::vector<uchar> _data; // Owned bytes: the file read from disk, or the levels added with AddLevel.
+	const uchar* _external = nullptr; // File contents owned by the caller, used instead of _data.
+	size_t _levelsOffset = 0u; // Offset of the first level in the contents.
+	size_t _levelsSize = 0u;
+	std::vector<size_t> _levelOffsets;
+	bool _isValid = false;
+};
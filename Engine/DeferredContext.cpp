@@ -0,0 +1,140 @@
+#include "DeferredContext.h"
+#include "D3D.h"
+
+DeferredContext::DeferredContext(D3D& owner, ID3D11Device* device)
+	: _owner(owner)
+	, _device(device)
+{
+	HRESULT result = device->CreateDeferredContext(0, &_deviceContext);
+	if (FAILED(result))
+		throw D3DError("Failed to create a deferred context");
+
+	// Binding constant buffers by offset needs the Direct3D 11.1 interface, as on the immediate context. Without it the
+	// pointer stays null.
+	_deviceContext->QueryInterface(__uuidof(ID3D11DeviceContext1), (void**)&_deviceContext1);
+
+	_stateCache = std::make_unique<StateCache>(_deviceContext.get());
+}
+
+void DeferredContext::Begin()
+{
+	// A deferred context starts every command list with nothing bound, so bind the frame's output and forget the rest.
+	_stateCache->BeginFrame();
+	_owner.BindOutput(_deviceContext.get());
+}
+
+void DeferredContext::Finish()
+{
+	// Do not carry this list's bindings into the next one; Begin binds what every list needs.
+	HRESULT result = _deviceContext->FinishCommandList(FALSE, &_commandList);
+	if (FAILED(result))
+		throw D3DError("Failed to finish a command list");
+}
+
+ReleasePtr<ID3D11CommandList> DeferredContext::TakeCommandList()
+{
+	return std::move(_commandList);
+}
+
+void DeferredContext::BeginScene(float, float, float, float)
+{
+	// The owner clears the buffers; a recording only draws into them.
+}
+
+void DeferredContext::EndScene()
+{
+	// The owner presents.
+}
+
+D3DContext* DeferredContext::GetD3DContext()
+{
+	return this;
+}
+
+ID3D11Device* DeferredContext::GetDevice()
+{
+	return _device;
+}
+
+ID3D11DeviceContext* DeferredContext::GetDeviceContext()
+{
+	return _deviceContext.get();
+}
+
+ID3D11DeviceContext1* DeferredContext::GetDeviceContext1()
+{
+	return _deviceContext1.get();
+}
+
+StateCache* DeferredContext::GetStateCache()
+{
+	return _stateCache.get();
+}
+
+GpuTimer* DeferredContext::GetGpuTimer()
+{
+	return nullptr;
+}
+
+void DeferredContext::GetProjectionMatrix(Math::Matrix4& projectionMatrix)
+{
+	_owner.GetProjectionMatrix(projectionMatrix);
+}
+
+void DeferredContext::GetWorldMatrix(Math::Matrix4& worldMatrix)
+{
+	_owner.GetWorldMatrix(worldMatrix);
+}
+
+void DeferredContext::GetOrthoMatrix(Math::Matrix4& orthoMatrix)
+{
+	_owner.GetOrthoMatrix(orthoMatrix);
+}
+
+void DeferredContext::SetMesh(const MeshBuffers& mesh)
+{
+	// Set the vertex and index buffers and the triangle topology, as D3D::SetMesh does.
+	_stateCache->SetVertexBuffer(0u, mesh.vertexBuffer, mesh.vertexStride);
+	_stateCache->SetIndexBuffer(mesh.indexBuffer, DXGI_FORMAT_R32_UINT);
+	_stateCache->SetPrimitiveTopology(D3D11_PRIMITIVE_TOPOLOGY_TRIANGLELIST);
+}
+
+void DeferredContext::SetTransforms(const Math::Matrix4&, const Math::Matrix4&, const Math::Matrix4&, const Math::Float2&)
+{
+	// The transforms live in constant buffers, as on the immediate context.
+}
+
+void DeferredContext::SetTexture(uint slot, const TextureBinding& texture)
+{
+	_stateCache->SetShaderResource(StateCache::Stage::Pixel, slot, texture.view);
+}
+
+void DeferredContext::DrawIndexed(uint indexCount, uint startIndex, int baseVertex)
+{
+	_deviceContext->DrawIndexed(indexCount, startIndex, baseVertex);
+}
+
+void DeferredContext::SetInstances(const InstanceBuffers& instances)
+{
+	_stateCache->SetVertexBuffer(InstanceBuffers::INPUT_SLOT, instances.buffer, sizeof(InstanceData));
+}
+
+void DeferredContext::DrawIndexedInstanced(uint indexCount, uint instanceCount, uint startIndex, int baseVertex, uint startInstance)
+{
+	_deviceContext->DrawIndexedInstanced(indexCount, instanceCount, startIndex, baseVertex, startInstance);
+}
+
+uint DeferredContext::GetRecorderCount()
+{
+	return 0u;
+}
+
+CommandRecorder* DeferredContext::GetRecorder(uint)
+{
+	return nullptr;
+}
+
+void DeferredContext::Execute(CommandRecorder&)
+{
+	// Recorders do not nest.
+}
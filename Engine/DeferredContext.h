@@ -0,0 +1,66 @@
+#pragma once
+
+#pragma warning(push, 0)
+#include <d3d11_1.h>
+#pragma warning(pop)
+
+#include "Common.h"
+#include "D3DContext.h"
+#include "ReleasePtr.h"
+#include "RenderBackend.h"
+#include "StateCache.h"
+
+class D3D;
+
+// Records draws into a command list on a Direct3D deferred context, for D3D to replay on the immediate context with
+// ExecuteCommandList. Binds go through a StateCache of its own, like the immediate context's. Matrices and the device
+// come from the owning D3D; the draw calls are the same as D3D's, only made on the deferred context.
+class DeferredContext : public CommandRecorder, public D3DContext
+{
+public:
+
+	// Throws D3DError if the device cannot create a deferred context.
+	DeferredContext(D3D& owner, ID3D11Device* device);
+
+	void Begin() override;
+	void Finish() override;
+
+	// Hands over the command list of the last Finish.
+	ReleasePtr<ID3D11CommandList> TakeCommandList();
+
+	void BeginScene(float red, float green, float blue, float alpha) override;
+	void EndScene() override;
+
+	D3DContext* GetD3DContext() override;
+	GpuTimer* GetGpuTimer() override;
+
+	ID3D11Device* GetDevice() override;
+	ID3D11DeviceContext* GetDeviceContext() override;
+	ID3D11DeviceContext1* GetDeviceContext1() override;
+	StateCache* GetStateCache() override;
+
+	void GetProjectionMatrix(Math::Matrix4&) override;
+	void GetWorldMatrix(Math::Matrix4&) override;
+	void GetOrthoMatrix(Math::Matrix4&) override;
+
+	void SetMesh(const MeshBuffers& mesh) override;
+	void SetTransforms(const Math::Matrix4& worldMatrix, const Math::Matrix4& viewMatrix, const Math::Matrix4& projectionMatrix,
+		const Math::Float2& textureOffset) override;
+	void SetTexture(uint slot, const TextureBinding& texture) override;
+	void DrawIndexed(uint indexCount, uint startIndex, int baseVertex) override;
+	void SetInstances(const InstanceBuffers& instances) override;
+	void DrawIndexedInstanced(uint indexCount, uint instanceCount, uint startIndex, int baseVertex, uint startInstance) override;
+
+	uint GetRecorderCount() override;
+	CommandRecorder* GetRecorder(uint index) override;
+	void Execute(CommandRecorder& recorder) override;
+
+private:
+
+	D3D& _owner;
+	ID3D11Device* _device = nullptr;
+	ReleasePtr<ID3D11DeviceContext> _deviceContext;
+	ReleasePtr<ID3D11DeviceContext1> _deviceContext1;
+	std::unique_ptr<StateCache> _stateCache;
+	ReleasePtr<ID3D11CommandList> _commandList;
+};
@@ -0,0 +1,308 @@
+#include "DrawList.h"
+#include "ConstantBufferRing.h"
+#include "InstanceBuffer.h"
+#include "JobSystem.h"
+#include "Material.h"
+#include "Model.h"
+#include "Profiler.h"
+
+#include <bit>
+#include <chrono>
+
+namespace
+{
+	// Draws are keyed in batches of this size; shorter lists are keyed on one thread.
+	const uint KEYS_PER_TASK = 16384u;
+
+	inline uint64_t Field(uint value, uint bits)
+	{
+		return value & ((1u << bits) - 1u);
+	}
+
+	// The layer, program, material and mesh fields of a sort key, without the depth.
+	inline uint64_t GetState(uint64_t key)
+	{
+		const uint stateBits = DrawList::PROGRAM_BITS + DrawList::MATERIAL_BITS + DrawList::MESH_BITS;
+		uint64_t layer = key >> (64u - DrawList::LAYER_BITS);
+		if (layer == (uint64_t)DrawList::Layer::Translucent)
+			return layer << stateBits | (key & ((1ull << stateBits) - 1u));
+		return key >> DrawList::DEPTH_BITS;
+	}
+}
+
+uint64_t DrawList::MakeSortKey(Layer layer, uint programId, uint materialId, uint meshId, float viewDepth)
+{
+	// Positive floats order like their bit patterns, so the top bits below the sign are a depth with no range to pick.
+	uint depth = std::bit_cast<uint>(viewDepth > 0.0f ? viewDepth : 0.0f) >> (31u - DEPTH_BITS);
+
+	uint64_t state = Field(programId, PROGRAM_BITS) << (MATERIAL_BITS + MESH_BITS) | Field(materialId, MATERIAL_BITS) << MESH_BITS | Field(meshId, MESH_BITS);
+	uint64_t key = Field((uint)layer, LAYER_BITS) << (64u - LAYER_BITS);
+	if (layer == Layer::Translucent)
+		return key | Field(~depth, DEPTH_BITS) << (PROGRAM_BITS + MATERIAL_BITS + MESH_BITS) | state;
+	return key | state << DEPTH_BITS | depth;
+}
+
+void DrawList::GatherBatches(const std::vector<RadixSort::Entry>& order, std::vector<Batch>& batches)
+{
+	batches.clear();
+	for (uint i = 0u; i < (uint)order.size(); ++i)
+	{
+		if (batches.empty() || GetState(order[i].key) != GetState(order[i - 1u].key))
+			batches.push_back({ i, 0u });
+		batches.back().count++;
+	}
+}
+
+void DrawList::Add(Material& material, Model& model, const Math::Matrix4& worldMatrix, Layer layer, const Math::Float2& textureOffset)
+{
+	Item item;
+	item.layer = layer;
+	item.material = &material;
+	item.model = &model;
+	item.worldMatrix = worldMatrix;
+	item.textureOffset = textureOffset;
+	_items.push_back(item);
+}
+
+void DrawList::Clear()
+{
+	_items.clear();
+	_order.clear();
+}
+
+void DrawList::Execute(RenderBackend& renderer, ConstantBufferRing& constants, InstanceBuffer& instances, const PerFrameConstants& frame,
+	const Math::Matrix4& viewMatrix, const Math::Matrix4& projectionMatrix)
+{
+	PROFILE_SCOPE("DrawList::Execute");
+	_stats = Stats();
+
+	// Key every draw by its state and its depth along the view direction, and put them in key order.
+	auto sortStart = std::chrono::steady_clock::now();
+	const uint itemCount = (uint)_items.size();
+	_order.resize(itemCount);
+	JobSystem::GetDefault().ParallelFor((itemCount + KEYS_PER_TASK - 1u) / KEYS_PER_TASK, 0u, [&](uint task)
+	{
+		uint end = itemCount - task * KEYS_PER_TASK > KEYS_PER_TASK ? (task + 1u) * KEYS_PER_TASK : itemCount;
+		for (uint i = task * KEYS_PER_TASK; i < end; ++i)
+		{
+			const Item& item = _items[i];
+			const float* position = item.worldMatrix.m[3];
+			float depth = Math::TransformPoint(Math::Float3(position[0], position[1], position[2]), viewMatrix).z;
+			_order[i].key = MakeSortKey(item.layer, item.material->GetProgram().GetId(), item.material->GetId(), item.model->GetId(), depth);
+			_order[i].value = i;
+		}
+	});
+	_stats.sortPasses = RadixSort::Sort(_order, _sortScratch);
+	_stats.sortMilliseconds = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - sortStart).count();
+
+	// Find the runs of draws that can be drawn as instances of one draw. Ids wrap around in the keys, so the run is
+	// only instanced if its draws really share the material and model.
+	GatherBatches(_order, _batches);
+	auto isInstanced = [this](const Batch& batch)
+	{
+		const Item& first = _items[_order[batch.first].value];
+		if (batch.count < MIN_INSTANCES || !first.material->GetInstancedProgram())
+			return false;
+
+		for (uint i = batch.first + 1u; i < batch.first + batch.count; ++i)
+		{
+			const Item& item = _items[_order[i].value];
+			if (item.material != first.material || item.model != first.model)
+				return false;
+		}
+		return true;
+	};
+
+	// Write every constant block and instance the draws need up front, so the ring and the instance buffer are each
+	// mapped once for the whole list.
+	Pass pass;
+	pass.viewMatrix = viewMatrix;
+	pass.projectionMatrix = projectionMatrix;
+
+	PerViewConstants view;
+	view.view = Math::Transpose(viewMatrix);
+	view.projection = Math::Transpose(projectionMatrix);
+	view.viewProjection = Math::Transpose(Math::Multiply(viewMatrix, projectionMatrix));
+
+	pass.frameConstants = constants.Write(&frame, sizeof(frame));
+	pass.viewConstants = constants.Write(&view, sizeof(view));
+	bool staged = pass.frameConstants.staged || pass.viewConstants.staged;
+
+	_instances.clear();
+	_firstInstances.resize(_batches.size());
+	uint drawCalls = 0u;
+	for (uint b = 0u; b < (uint)_batches.size(); ++b)
+	{
+		const Batch& batch = _batches[b];
+		_firstInstances[b] = isInstanced(batch) ? (uint)_instances.size() : NOT_INSTANCED;
+		drawCalls += _firstInstances[b] != NOT_INSTANCED ? 1u : batch.count;
+
+		for (uint i = batch.first; i < batch.first + batch.count; ++i)
+		{
+			Item& item = _items[_order[i].value];
+			if (_firstInstances[b] != NOT_INSTANCED)
+			{
+				_instances.push_back({ item.worldMatrix, item.textureOffset });
+				continue;
+			}
+
+			PerObjectConstants object;
+			object.world = Math::Transpose(item.worldMatrix);
+			object.textureOffset = item.textureOffset;
+			item.objectConstants = constants.Write(&object, sizeof(object));
+			staged = staged || item.objectConstants.staged;
+		}
+	}
+
+	// Draws may bind the ring from any thread, which they can only do once it is unmapped.
+	constants.Flush();
+	if (!_instances.empty())
+		instances.Upload(_instances);
+
+	// Record on the renderer's recorders when there are enough draw calls to share out. Staged constant blocks are
+	// uploaded as they are bound, which only the renderer itself can do.
+	auto recordStart = std::chrono::steady_clock::now();
+	uint recorderCount = staged ? 0u : renderer.GetRecorderCount();
+	uint chunkCount = drawCalls / MIN_DRAW_CALLS_PER_RECORDER < recorderCount ? drawCalls / MIN_DRAW_CALLS_PER_RECORDER : recorderCount;
+	if (chunkCount <= 1u)
+	{
+		Record(renderer, constants, instances, pass, 0u, (uint)_batches.size(), _stats);
+	}
+	else
+	{
+		// Split the batches into chunks of about the same number of draw calls, and upload the programs' own
+		// constants here, so recording only reads the programs.
+		_chunkEnds.clear();
+		uint chunkDrawCalls = 0u;
+		ShaderProgram* program = nullptr;
+		for (uint b = 0u; b < (uint)_batches.size(); ++b)
+		{
+			const Item& first = _items[_order[_batches[b].first].value];
+			bool instanced = _firstInstances[b] != NOT_INSTANCED;
+			ShaderProgram* batchProgram = instanced ? first.material->GetInstancedProgram() : &first.material->GetProgram();
+			if (batchProgram != program)
+			{
+				program = batchProgram;
+				program->UploadConstants(renderer);
+			}
+
+			chunkDrawCalls += instanced ? 1u : _batches[b].count;
+			if (chunkDrawCalls * chunkCount >= drawCalls * ((uint)_chunkEnds.size() + 1u))
+				_chunkEnds.push_back(b + 1u);
+		}
+
+		chunkCount = (uint)_chunkEnds.size();
+		std::vector<Stats> chunkStats(chunkCount);
+		JobSystem::GetDefault().ParallelFor(chunkCount, chunkCount, [&](uint chunk)
+		{
+			CommandRecorder& recorder = *renderer.GetRecorder(chunk);
+			recorder.Begin();
+			Record(recorder, constants, instances, pass, chunk > 0u ? _chunkEnds[chunk - 1u] : 0u, _chunkEnds[chunk], chunkStats[chunk]);
+			recorder.Finish();
+		});
+
+		// Replay the chunks in order, so the draws keep their sorted order.
+		for (uint chunk = 0u; chunk < chunkCount; ++chunk)
+		{
+			renderer.Execute(*renderer.GetRecorder(chunk));
+
+			const Stats& part = chunkStats[chunk];
+			_stats.draws += part.draws;
+			_stats.drawCalls += part.drawCalls;
+			_stats.instancedDrawCalls += part.instancedDrawCalls;
+			_stats.programChanges += part.programChanges;
+			_stats.materialChanges += part.materialChanges;
+			_stats.meshChanges += part.meshChanges;
+		}
+		_stats.recorders = chunkCount;
+	}
+	_stats.recordMilliseconds = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - recordStart).count();
+}
+
+void DrawList::Record(RenderBackend& renderer, ConstantBufferRing& constants, InstanceBuffer& instances, const Pass& pass, uint firstBatch,
+	uint endBatch, Stats& stats)
+{
+	const Math::Matrix4& viewMatrix = pass.viewMatrix;
+	const Math::Matrix4& projectionMatrix = pass.projectionMatrix;
+	if (!_instances.empty())
+		renderer.SetInstances(instances.GetBuffers());
+
+	ShaderProgram* program = nullptr;
+	Material* material = nullptr;
+	Model* model = nullptr;
+	ShaderProgram::BufferSlots objectSlots;
+
+	auto bind = [&](ShaderProgram& itemProgram, const Item& item)
+	{
+		// Bind the program and point it at this list's frame and view constants.
+		if (&itemProgram != program)
+		{
+			program = &itemProgram;
+			program->Bind(renderer);
+
+			ShaderProgram::BufferSlots frameSlots = program->FindSharedBuffer(PER_FRAME_BUFFER);
+			ShaderProgram::BufferSlots viewSlots = program->FindSharedBuffer(PER_VIEW_BUFFER);
+			constants.Bind(renderer, frameSlots.vsSlot, frameSlots.psSlot, pass.frameConstants);
+			constants.Bind(renderer, viewSlots.vsSlot, viewSlots.psSlot, pass.viewConstants);
+			objectSlots = program->FindSharedBuffer(PER_OBJECT_BUFFER);
+			stats.programChanges++;
+		}
+
+		// Set the material's textures.
+		if (item.material != material)
+		{
+			material = item.material;
+			material->Bind(renderer);
+			stats.materialChanges++;
+		}
+
+		// Put the model vertex and index buffers on the graphics pipeline.
+		if (item.model != model)
+		{
+			model = item.model;
+			model->Render(renderer);
+			stats.meshChanges++;
+		}
+	};
+
+	for (uint b = firstBatch; b < endBatch; ++b)
+	{
+		const Batch& batch = _batches[b];
+		if (_firstInstances[b] != NOT_INSTANCED)
+		{
+			// Draw the whole run at once. CPU backends take the view and projection from here and each instance's
+			// world matrix from the instance buffer.
+			const Item& first = _items[_order[batch.first].value];
+			bind(*first.material->GetInstancedProgram(), first);
+			renderer.SetTransforms(Math::Identity(), viewMatrix, projectionMatrix, Math::Float2(0.0f, 0.0f));
+			program->UploadConstants(renderer);
+
+			renderer.DrawIndexedInstanced((uint)model->GetIndexCount(), batch.count, 0u, 0, _firstInstances[b]);
+			stats.draws += batch.count;
+			stats.drawCalls++;
+			stats.instancedDrawCalls++;
+			continue;
+		}
+
+		for (uint i = batch.first; i < batch.first + batch.count; ++i)
+		{
+			const Item& item = _items[_order[i].value];
+			bind(item.material->GetProgram(), item);
+
+			// Point the program at the object's constants and draw it. CPU backends take the untransposed matrices and the
+			// texture offset directly.
+			renderer.SetTransforms(item.worldMatrix, viewMatrix, projectionMatrix, item.textureOffset);
+			constants.Bind(renderer, objectSlots.vsSlot, objectSlots.psSlot, item.objectConstants);
+			program->UploadConstants(renderer);
+
+			renderer.DrawIndexed((uint)model->GetIndexCount(), 0u, 0);
+			stats.draws++;
+			stats.drawCalls++;
+		}
+	}
+}
+
+const DrawList::Stats& DrawList::GetStats() const
+{
+	return _stats;
+}
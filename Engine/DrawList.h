@@ -0,0 +1,136 @@
+#pragma once
+
+#include "Common.h"
+#include "ConstantAllocation.h"
+#include "EngineMath.h"
+#include "RadixSort.h"
+#include "RenderBackend.h"
+#include "ShaderConstants.h"
+
+class ConstantBufferRing;
+class InstanceBuffer;
+class Material;
+class Model;
+
+// Collects a frame's draws and issues them grouped by program, material and model, so a scene with many objects
+// binds each program, each material's textures and each mesh once per group rather than once per object.
+//
+// Every draw gets a 64-bit sort key packed from its layer, program, material, mesh and view depth (see MakeSortKey),
+// and the keys are ordered with RadixSort, split between threads for long lists. Whatever the sort leaves repeated
+// at the edges of the groups is dropped by the backend's StateCache.
+//
+// Sorting leaves the draws of one mesh with one material next to each other. Each such run becomes a single instanced
+// draw when the material has an instanced program: the draws' world matrices and texture offsets go to the instance
+// buffer instead of the constant ring, and the run costs one DrawIndexedInstanced.
+//
+// The shared constant buffers from ShaderConstants.h are written into the constant ring before the first draw:
+// the per-frame and per-view blocks once per list, a per-object block for every draw. Draws then only bind
+// offsets into the ring.
+//
+// Long lists are recorded in parallel when the backend has command recorders (Direct3D deferred contexts): the
+// batches are split into chunks of about the same number of draw calls, each chunk is recorded on its own recorder by
+// the job system, and the chunks are replayed on the backend in order. Without recorders, or when the ring had to
+// stage a block, the list is recorded on the backend itself.
+class DrawList
+{
+public:
+
+	// Layers are drawn in this order, whatever their draws' state.
+	enum class Layer : uint
+	{
+		Opaque,			// Grouped by state, front to back within a group so the depth test rejects hidden pixels early.
+		Translucent,	// Back to front so blending composes correctly, grouped by state only at equal depth.
+		Overlay			// Grouped by state like Opaque, after everything else.
+	};
+
+	// A run of consecutive draws in sorted order with the same layer, program, material and mesh.
+	struct Batch
+	{
+		uint first = 0u;	// Position in sorted order.
+		uint count = 0u;
+	};
+
+	struct Stats
+	{
+		uint draws = 0u;
+		uint drawCalls = 0u;
+		uint instancedDrawCalls = 0u;
+		uint programChanges = 0u;
+		uint materialChanges = 0u;
+		uint meshChanges = 0u;
+		uint sortPasses = 0u;
+		uint recorders = 0u;			// Recorders the draws were split between, 0 if recorded on the backend itself.
+		double sortMilliseconds = 0.0;
+		double recordMilliseconds = 0.0;	// Binding and drawing, recording and replaying included.
+	};
+
+	// Bits of each field of a sort key, most significant first: layer, then program, material, mesh and depth for
+	// Opaque and Overlay, or depth, program, material and mesh for Translucent.
+	static const uint LAYER_BITS = 4u;
+	static const uint PROGRAM_BITS = 10u;
+	static const uint MATERIAL_BITS = 14u;
+	static const uint MESH_BITS = 12u;
+	static const uint DEPTH_BITS = 24u;
+
+	// Shorter batches are drawn one draw at a time.
+	static const uint MIN_INSTANCES = 2u;
+
+	// Fewer draw calls than this per recorder are not worth a command list; the list is split between fewer recorders.
+	static const uint MIN_DRAW_CALLS_PER_RECORDER = 256u;
+
+	// Packs a sort key. Ids are wrapped to their field, which can only split a group, never merge two, since Execute
+	// compares the objects themselves before binding. Depth is the view space distance; only its ordering is kept.
+	static uint64_t MakeSortKey(Layer layer, uint programId, uint materialId, uint meshId, float viewDepth);
+
+	// Splits draws in sorted order into batches of consecutive draws whose keys share everything but depth.
+	static void GatherBatches(const std::vector<RadixSort::Entry>& order, std::vector<Batch>& batches);
+
+	// The material and model must stay alive until Execute. The texture offset is added to the mesh's texture coordinates.
+	void Add(Material& material, Model& model, const Math::Matrix4& worldMatrix, Layer layer = Layer::Opaque,
+		const Math::Float2& textureOffset = Math::Float2(0.0f, 0.0f));
+	void Clear();
+
+	// Sorts and draws everything added since the last Clear.
+	void Execute(RenderBackend& renderer, ConstantBufferRing& constants, InstanceBuffer& instances, const PerFrameConstants& frame,
+		const Math::Matrix4& viewMatrix, const Math::Matrix4& projectionMatrix);
+
+	// Counts for the last Execute.
+	const Stats& GetStats() const;
+
+private:
+
+	struct Item
+	{
+		Layer layer;
+		Material* material;
+		Model* model;
+		Math::Matrix4 worldMatrix;
+		Math::Float2 textureOffset;
+		ConstantAllocation objectConstants;
+	};
+
+	// What every draw of one Execute shares.
+	struct Pass
+	{
+		ConstantAllocation frameConstants;
+		ConstantAllocation viewConstants;
+		Math::Matrix4 viewMatrix;
+		Math::Matrix4 projectionMatrix;
+	};
+
+	static const uint NOT_INSTANCED = ~0u;
+
+	// Binds and draws batches [firstBatch, endBatch) on renderer, whose state is assumed unknown, counting into stats.
+	// Only reads the list, so several chunks can be recorded at once.
+	void Record(RenderBackend& renderer, ConstantBufferRing& constants, InstanceBuffer& instances, const Pass& pass, uint firstBatch,
+		uint endBatch, Stats& stats);
+
+	std::vector<Item> _items;
+	std::vector<RadixSort::Entry> _order; // Sort keys and the item each belongs to, in drawing order after sorting.
+	std::vector<RadixSort::Entry> _sortScratch;
+	std::vector<Batch> _batches;
+	std::vector<uint> _firstInstances; // Per batch, its first instance in _instances, or NOT_INSTANCED.
+	std::vector<InstanceData> _instances;
+	std::vector<uint> _chunkEnds; // Per recorder, the batch after the last one it records.
+	Stats _stats;
+};
@@ -0,0 +1,206 @@
+#include "DrawListBenchmark.h"
+#include "DrawList.h"
+#include "JobSystem.h"
+
+#include <algorithm>
+#include <chrono>
+#include <random>
+
+namespace
+{
+	const uint DRAW_COUNTS[] = { 10000u, 50000u, 100000u, 500000u };
+	const uint PROGRAM_COUNT = 8u;
+	const uint MATERIAL_COUNT = 256u;	// Each uses one program and one texture.
+	const uint TEXTURE_COUNT = 64u;		// Shared between materials, as atlases and common textures are.
+	const uint MESH_COUNT = 64u;
+	const float TRANSLUCENT_SHARE = 0.1f;
+	const float MAX_DEPTH = 1000.0f;
+	const uint REPETITIONS = 10u;
+
+	struct Draw
+	{
+		DrawList::Layer layer;
+		uint material;
+		uint mesh;
+		float depth;
+	};
+
+	uint GetProgram(uint material)
+	{
+		return material % PROGRAM_COUNT;
+	}
+
+	uint GetTexture(uint material)
+	{
+		return material % TEXTURE_COUNT;
+	}
+
+	double MillisecondsSince(std::chrono::steady_clock::time_point start)
+	{
+		return std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+	}
+
+	template <typename Sort>
+	double Measure(const std::vector<RadixSort::Entry>& keys, std::vector<RadixSort::Entry>& sorted, Sort sort)
+	{
+		double total = 0.0;
+		for (uint i = 0u; i < REPETITIONS; ++i)
+		{
+			sorted = keys;
+			auto start = std::chrono::steady_clock::now();
+			sort(sorted);
+			total += MillisecondsSince(start);
+		}
+		return total / REPETITIONS;
+	}
+
+	// Program, material and mesh changes drawing in the given order takes, as DrawList::Execute counts them, and the
+	// texture bindings among the material changes that rebind the texture already bound.
+	void CountChanges(const std::vector<Draw>& draws, const std::vector<RadixSort::Entry>& order, uint& changes, uint& redundantTextures)
+	{
+		uint program = ~0u, material = ~0u, mesh = ~0u, texture = ~0u;
+		changes = 0u;
+		redundantTextures = 0u;
+		for (const RadixSort::Entry& entry : order)
+		{
+			const Draw& draw = draws[entry.value];
+			if (GetProgram(draw.material) != program)
+			{
+				program = GetProgram(draw.material);
+				changes++;
+			}
+			if (draw.material != material)
+			{
+				material = draw.material;
+				changes++;
+				if (GetTexture(material) == texture)
+					redundantTextures++;
+				texture = GetTexture(material);
+			}
+			if (draw.mesh != mesh)
+			{
+				mesh = draw.mesh;
+				changes++;
+			}
+		}
+	}
+
+	// Checks that the batches cover the sorted draws in order, that every batch shares layer, material and mesh, and
+	// that no two neighbouring batches do, so none could have been merged.
+	bool CheckBatches(const std::vector<Draw>& draws, const std::vector<RadixSort::Entry>& order, const std::vector<DrawList::Batch>& batches)
+	{
+		auto sameState = [&](uint a, uint b)
+		{
+			const Draw& first = draws[order[a].value];
+			const Draw& second = draws[order[b].value];
+			return first.layer == second.layer && first.material == second.material && first.mesh == second.mesh;
+		};
+
+		uint next = 0u;
+		for (const DrawList::Batch& batch : batches)
+		{
+			if (batch.first != next || batch.count == 0u)
+				return false;
+			if (next > 0u && sameState(next - 1u, next))
+				return false;
+			for (uint i = batch.first + 1u; i < batch.first + batch.count; ++i)
+			{
+				if (!sameState(batch.first, i))
+					return false;
+			}
+			next += batch.count;
+		}
+		return next == order.size();
+	}
+}
+
+bool RunDrawListBenchmark(std::ostream& output)
+{
+	uint threadCount = JobSystem::GetDefault().GetThreadCount();
+
+	output << std::format("Draw sorting, {} programs, {} materials, {} meshes, average of {} runs", PROGRAM_COUNT, MATERIAL_COUNT, MESH_COUNT,
+		REPETITIONS) << std::endl;
+
+	bool allMatch = true;
+	std::mt19937 random(1u);
+	std::uniform_int_distribution<uint> material(0u, MATERIAL_COUNT - 1u);
+	std::uniform_int_distribution<uint> mesh(0u, MESH_COUNT - 1u);
+	std::uniform_real_distribution<float> depth(0.3f, MAX_DEPTH);
+	std::uniform_real_distribution<float> unit(0.0f, 1.0f);
+
+	for (uint drawCount : DRAW_COUNTS)
+	{
+		std::vector<Draw> draws(drawCount);
+		for (Draw& draw : draws)
+		{
+			draw.layer = unit(random) < TRANSLUCENT_SHARE ? DrawList::Layer::Translucent : DrawList::Layer::Opaque;
+			draw.material = material(random);
+			draw.mesh = mesh(random);
+			draw.depth = depth(random);
+		}
+
+		// Pack the keys as Execute does.
+		std::vector<RadixSort::Entry> keys(drawCount);
+		auto keyStart = std::chrono::steady_clock::now();
+		for (uint i = 0u; i < drawCount; ++i)
+		{
+			const Draw& draw = draws[i];
+			keys[i].key = DrawList::MakeSortKey(draw.layer, GetProgram(draw.material), draw.material, draw.mesh, draw.depth);
+			keys[i].value = i;
+		}
+		double keyMilliseconds = MillisecondsSince(keyStart);
+
+		// The values start out in increasing order, so a stable sort by key matches a sort by key and then value.
+		std::vector<RadixSort::Entry> reference, single, parallel, scratch;
+		uint passes = 0u;
+		double referenceMilliseconds = Measure(keys, reference, [](std::vector<RadixSort::Entry>& entries)
+		{
+			std::sort(entries.begin(), entries.end(), [](const RadixSort::Entry& a, const RadixSort::Entry& b)
+			{
+				return a.key != b.key ? a.key < b.key : a.value < b.value;
+			});
+		});
+		double singleMilliseconds = Measure(keys, single, [&](std::vector<RadixSort::Entry>& entries) { passes = RadixSort::Sort(entries, scratch, 1u); });
+		double parallelMilliseconds = Measure(keys, parallel, [&](std::vector<RadixSort::Entry>& entries) { RadixSort::Sort(entries, scratch, threadCount); });
+
+		auto sameOrder = [&](const std::vector<RadixSort::Entry>& sorted)
+		{
+			return std::equal(sorted.begin(), sorted.end(), reference.begin(), reference.end(), [](const RadixSort::Entry& a, const RadixSort::Entry& b)
+			{
+				return a.key == b.key && a.value == b.value;
+			});
+		};
+		bool match = sameOrder(single) && sameOrder(parallel);
+		allMatch = allMatch && match;
+
+		// Gather the sorted draws into batches, and count the draw calls they take when every batch long enough is instanced.
+		std::vector<DrawList::Batch> batches;
+		auto batchStart = std::chrono::steady_clock::now();
+		DrawList::GatherBatches(reference, batches);
+		double batchMilliseconds = MillisecondsSince(batchStart);
+
+		bool batchesMatch = CheckBatches(draws, reference, batches);
+		allMatch = allMatch && batchesMatch;
+
+		uint drawCalls = 0u, instancedDrawCalls = 0u;
+		for (const DrawList::Batch& batch : batches)
+		{
+			bool instanced = batch.count >= DrawList::MIN_INSTANCES;
+			drawCalls += instanced ? 1u : batch.count;
+			instancedDrawCalls += instanced ? 1u : 0u;
+		}
+
+		uint submittedChanges, sortedChanges, submittedRedundant, sortedRedundant;
+		CountChanges(draws, keys, submittedChanges, submittedRedundant);
+		CountChanges(draws, reference, sortedChanges, sortedRedundant);
+
+		output << std::format("{:>7} draws: keys {:6.3f} ms, std::sort {:7.3f} ms, radix {:7.3f} ms, {} threads {:7.3f} ms ({} passes){}", drawCount,
+			keyMilliseconds, referenceMilliseconds, singleMilliseconds, threadCount, parallelMilliseconds, passes, match ? "" : " MISMATCH") << std::endl;
+		output << std::format("         state changes: {} in submission order, {} sorted; redundant texture bindings: {} and {}",
+			submittedChanges, sortedChanges, submittedRedundant, sortedRedundant) << std::endl;
+		output << std::format("         batching: {} batches in {:.3f} ms, {} draw calls of which {} instanced{}", batches.size(), batchMilliseconds,
+			drawCalls, instancedDrawCalls, batchesMatch ? "" : " WRONG BATCHES") << std::endl;
+	}
+
+	return allMatch;
+}
@@ -0,0 +1,12 @@
+#pragma once
+
+#include <ostream>
+#include "Common.h"
+
+// Sorts 10k to 500k random draws the way DrawList does: packs their sort keys, orders them with std::sort, with
+// RadixSort on one thread and with RadixSort on every hardware thread, checks that all three agree and reports their
+// times. Also counts the program, material and mesh changes in submission order against sorted order, and the
+// texture bindings the state cache drops, and gathers the sorted draws into instancing batches, checking that every
+// batch shares its state and no two neighbours could be merged. Run with "Engine.exe -benchmark-draw-list". Returns
+// false if the sorts disagree or a batch is wrong.
+bool RunDrawListBenchmark(std::ostream& output);
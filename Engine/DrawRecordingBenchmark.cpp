@@ -0,0 +1,193 @@
+#include "DrawRecordingBenchmark.h"
+#include "ConstantBufferRing.h"
+#include "DrawList.h"
+#include "InstanceBuffer.h"
+#include "JobSystem.h"
+#include "Material.h"
+#include "Model.h"
+#include "RecordingBackend.h"
+#include "ShaderCache.h"
+
+#include <chrono>
+#include <random>
+#include <string.h>
+
+namespace
+{
+	const uint DRAW_COUNTS[] = { 1000u, 10000u, 100000u };
+	const uint RECORDER_COUNTS[] = { 0u, 1u, 2u, 4u, 8u, 16u };
+	const uint PROGRAM_COUNT = 4u;
+	const uint MATERIAL_COUNT = 64u;	// Every other one has an instanced program.
+	const uint TEXTURE_COUNT = 16u;
+	const uint MESH_COUNT = 16u;
+	const uint REPETITIONS = 10u;
+
+	// What one object was drawn with, as the backend saw it.
+	struct Drawn
+	{
+		const void* mesh = nullptr;
+		const void* texture = nullptr;
+		Math::Matrix4 worldMatrix;
+		Math::Float2 textureOffset = Math::Float2(0.0f, 0.0f);
+		uint indexCount = 0u;
+
+		bool operator==(const Drawn& other) const
+		{
+			return mesh == other.mesh && texture == other.texture && indexCount == other.indexCount &&
+				memcmp(&worldMatrix, &other.worldMatrix, sizeof(worldMatrix)) == 0 &&
+				textureOffset.x == other.textureOffset.x && textureOffset.y == other.textureOffset.y;
+		}
+	};
+
+	// Plays the commands back through the state they bind and lists every object drawn, instances one by one. Returns
+	// false if a draw reads instances past the bound ones.
+	bool Replay(const std::vector<RecordingBackend::Command>& commands, std::vector<Drawn>& drawn)
+	{
+		using Type = RecordingBackend::Command::Type;
+
+		drawn.clear();
+		Drawn state;
+		const InstanceData* instances = nullptr;
+		uint instanceCount = 0u;
+		for (const RecordingBackend::Command& command : commands)
+		{
+			switch (command.type)
+			{
+			case Type::Reset:
+				state = Drawn();
+				instances = nullptr;
+				instanceCount = 0u;
+				break;
+			case Type::SetMesh:
+				state.mesh = command.mesh;
+				break;
+			case Type::SetTransforms:
+				state.worldMatrix = command.worldMatrix;
+				state.textureOffset = command.textureOffset;
+				break;
+			case Type::SetTexture:
+				if (command.slot == 0u)
+					state.texture = command.texture;
+				break;
+			case Type::SetInstances:
+				instances = command.instances;
+				instanceCount = command.instanceCount;
+				break;
+			case Type::DrawIndexed:
+				state.indexCount = command.indexCount;
+				drawn.push_back(state);
+				break;
+			case Type::DrawIndexedInstanced:
+				if (!instances || command.startInstance + command.instanceCount > instanceCount)
+					return false;
+
+				state.indexCount = command.indexCount;
+				for (uint i = 0u; i < command.instanceCount; ++i)
+				{
+					Drawn instance = state;
+					instance.worldMatrix = instances[command.startInstance + i].world;
+					instance.textureOffset = instances[command.startInstance + i].textureOffset;
+					drawn.push_back(instance);
+				}
+				break;
+			}
+		}
+		return true;
+	}
+}
+
+bool RunDrawRecordingBenchmark(std::ostream& output)
+{
+	JobSystem& jobs = JobSystem::GetDefault();
+	output << std::format("Draw recording on {} job system threads, average of {} runs", jobs.GetThreadCount(), REPETITIONS) << std::endl;
+
+	// The device-less backend skips every GPU resource, so the programs never reach the compiler.
+	RecordingBackend resources(0u);
+	ShaderCache shaderCache("", [](const ShaderCache::Request&, std::vector<uchar>&, std::string& error)
+	{
+		error = "No device to compile for";
+		return false;
+	});
+
+	ShaderProgram::Desc programDesc;
+	programDesc.vertexFormat = &Model::GetVertexFormat();
+	ShaderProgram::Desc instancedProgramDesc = programDesc;
+	instancedProgramDesc.instanceFormat = &InstanceBuffer::GetFormat();
+
+	std::vector<std::shared_ptr<ShaderProgram>> programs, instancedPrograms;
+	for (uint i = 0u; i < PROGRAM_COUNT; ++i)
+	{
+		programs.push_back(std::make_shared<ShaderProgram>(resources, shaderCache, programDesc));
+		instancedPrograms.push_back(std::make_shared<ShaderProgram>(resources, shaderCache, instancedProgramDesc));
+	}
+
+	std::vector<std::shared_ptr<Texture>> textures;
+	for (uint i = 0u; i < TEXTURE_COUNT; ++i)
+		textures.push_back(std::make_shared<Texture>(nullptr));
+
+	std::vector<std::unique_ptr<Material>> materials;
+	for (uint i = 0u; i < MATERIAL_COUNT; ++i)
+	{
+		materials.push_back(std::make_unique<Material>(programs[i % PROGRAM_COUNT]));
+		materials.back()->SetTexture(0u, textures[i % TEXTURE_COUNT]);
+		if (i % 2u == 0u)
+			materials.back()->SetInstancedProgram(instancedPrograms[i % PROGRAM_COUNT]);
+	}
+
+	std::vector<std::unique_ptr<Model>> models;
+	for (uint i = 0u; i < MESH_COUNT; ++i)
+		models.push_back(std::make_unique<Model>(resources));
+
+	bool allMatch = true;
+	std::mt19937 random(1u);
+	std::uniform_real_distribution<float> position(-500.0f, 500.0f);
+	Math::Matrix4 viewMatrix = Math::LookAtLH(Math::Float3(0.0f, 0.0f, -600.0f), Math::Float3(0.0f, 0.0f, 0.0f), Math::Float3(0.0f, 1.0f, 0.0f));
+	Math::Matrix4 projectionMatrix = Math::PerspectiveFovLH(Math::PI / 4.0f, 16.0f / 9.0f, 0.3f, 2000.0f);
+	PerFrameConstants frame;
+
+	for (uint drawCount : DRAW_COUNTS)
+	{
+		DrawList drawList;
+		for (uint i = 0u; i < drawCount; ++i)
+		{
+			Material& material = *materials[random() % MATERIAL_COUNT];
+			Model& model = *models[random() % MESH_COUNT];
+			drawList.Add(material, model, Math::Translation(position(random), position(random), position(random)));
+		}
+
+		std::vector<Drawn> reference;
+		std::string line = std::format("{:>7} draws:", drawCount);
+		for (uint recorderCount : RECORDER_COUNTS)
+		{
+			RecordingBackend renderer(recorderCount);
+			ConstantBufferRing constants(renderer);
+			InstanceBuffer instances(renderer);
+
+			double recordMilliseconds = 0.0;
+			for (uint i = 0u; i < REPETITIONS; ++i)
+			{
+				renderer.BeginScene(0.0f, 0.0f, 0.0f, 1.0f);
+				constants.BeginFrame();
+				drawList.Execute(renderer, constants, instances, frame, viewMatrix, projectionMatrix);
+				constants.EndFrame();
+				renderer.EndScene();
+				recordMilliseconds += drawList.GetStats().recordMilliseconds;
+			}
+
+			// Check the last run against the recording made on the backend itself.
+			std::vector<Drawn> drawn;
+			bool match = Replay(renderer.GetCommands(), drawn) && drawn.size() == drawCount && renderer.GetErrorCount() == 0u;
+			if (recorderCount == 0u)
+				reference = drawn;
+			else
+				match = match && drawn == reference;
+			allMatch = allMatch && match;
+
+			line += std::format("  {} recorders: {:.3f} ms on {}{}", recorderCount, recordMilliseconds / REPETITIONS, drawList.GetStats().recorders,
+				match ? "" : " MISMATCH");
+		}
+		output << line << std::endl;
+	}
+
+	return allMatch;
+}
@@ -0,0 +1,12 @@
+#pragma once
+
+#include <ostream>
+#include "Common.h"
+
+// Draws 1k to 100k random draws through DrawList on RecordingBackend, on the backend itself and split between 1 to 16
+// recorders on the job system, the way D3D splits them between deferred contexts. Replays each command stream,
+// forgetting every binding where a recording starts and ends, and checks that every recorder count draws the same
+// meshes with the same textures and transforms in the same order as the serial recording, and that no recorder was
+// used from the wrong thread. Reports the recording times. Run with "Engine.exe -benchmark-recording". Returns false if
+// a recording differs or a recorder was misused.
+bool RunDrawRecordingBenchmark(std::ostream& output);
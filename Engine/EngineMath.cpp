@@ -0,0 +1,492 @@
+#include "EngineMath.h"
+
+#if !defined(MATH_NO_INTRINSICS) && (defined(_M_X64) || defined(_M_IX86) || defined(__x86_64__) || defined(__i386__))
+#define MATH_SSE
+#include <immintrin.h>
+#include "CpuFeatures.h"
+#elif !defined(MATH_NO_INTRINSICS) && (defined(_M_ARM64) || defined(__ARM_NEON))
+#define MATH_NEON
+#include <arm_neon.h>
+#endif
+
+namespace Math
+{
+	namespace
+	{
+		const float ONE_DIV_TWO_PI = 0.159154943f;
+
+		using TransformPointsKernel = void (*)(const Matrix4& m, const Float3* points, Float4* results, size_t count);
+		using MultiplyMatricesKernel = void (*)(const Matrix4* a, const Matrix4* b, Matrix4* results, size_t count);
+
+		// Every path pairs the products as DirectXMath's SSE code does: a row of a product is (x * b0 + z * b2) +
+		// (y * b1 + w * b3), a transformed point ((z * m2 + m3) + y * m1) + x * m0.
+		void MultiplyScalar(const Matrix4& a, const Matrix4& b, Matrix4& result)
+		{
+			// Work on a copy, so result may be a or b.
+			Matrix4 product;
+			for (uint i = 0u; i < 4u; ++i)
+			{
+				const float* row = a.m[i];
+				for (uint j = 0u; j < 4u; ++j)
+					product.m[i][j] = (row[0] * b.m[0][j] + row[2] * b.m[2][j]) + (row[1] * b.m[1][j] + row[3] * b.m[3][j]);
+			}
+			result = product;
+		}
+
+		Float4 TransformPointScalar(const Float3& p, const Matrix4& m)
+		{
+			float result[4];
+			for (uint j = 0u; j < 4u; ++j)
+				result[j] = ((p.z * m.m[2][j] + m.m[3][j]) + p.y * m.m[1][j]) + p.x * m.m[0][j];
+			return Float4(result[0], result[1], result[2], result[3]);
+		}
+
+#if defined(MATH_SSE)
+		inline __m128 MultiplyRowSse(__m128 row, const __m128 b[4])
+		{
+			__m128 x = _mm_shuffle_ps(row, row, _MM_SHUFFLE(0, 0, 0, 0));
+			__m128 y = _mm_shuffle_ps(row, row, _MM_SHUFFLE(1, 1, 1, 1));
+			__m128 z = _mm_shuffle_ps(row, row, _MM_SHUFFLE(2, 2, 2, 2));
+			__m128 w = _mm_shuffle_ps(row, row, _MM_SHUFFLE(3, 3, 3, 3));
+			return _mm_add_ps(_mm_add_ps(_mm_mul_ps(x, b[0]), _mm_mul_ps(z, b[2])), _mm_add_ps(_mm_mul_ps(y, b[1]), _mm_mul_ps(w, b[3])));
+		}
+
+		// SSE2 is part of x64, so these need no target tag.
+		void MultiplySse2(const Matrix4& a, const Matrix4& b, Matrix4& result)
+		{
+			// Load both before storing anything, so result may be a or b.
+			const __m128 rows[4] = { _mm_loadu_ps(b.m[0]), _mm_loadu_ps(b.m[1]), _mm_loadu_ps(b.m[2]), _mm_loadu_ps(b.m[3]) };
+			__m128 row0 = MultiplyRowSse(_mm_loadu_ps(a.m[0]), rows);
+			__m128 row1 = MultiplyRowSse(_mm_loadu_ps(a.m[1]), rows);
+			__m128 row2 = MultiplyRowSse(_mm_loadu_ps(a.m[2]), rows);
+			__m128 row3 = MultiplyRowSse(_mm_loadu_ps(a.m[3]), rows);
+			_mm_storeu_ps(result.m[0], row0);
+			_mm_storeu_ps(result.m[1], row1);
+			_mm_storeu_ps(result.m[2], row2);
+			_mm_storeu_ps(result.m[3], row3);
+		}
+
+		inline __m128 TransformPointSse(const Float3& p, const __m128 m[4])
+		{
+			__m128 result = _mm_add_ps(_mm_mul_ps(_mm_set1_ps(p.z), m[2]), m[3]);
+			result = _mm_add_ps(result, _mm_mul_ps(_mm_set1_ps(p.y), m[1]));
+			return _mm_add_ps(result, _mm_mul_ps(_mm_set1_ps(p.x), m[0]));
+		}
+
+		void TransformPointsSse2(const Matrix4& m, const Float3* points, Float4* results, size_t count)
+		{
+			const __m128 rows[4] = { _mm_loadu_ps(m.m[0]), _mm_loadu_ps(m.m[1]), _mm_loadu_ps(m.m[2]), _mm_loadu_ps(m.m[3]) };
+			for (size_t i = 0u; i < count; ++i)
+				_mm_storeu_ps(&results[i].x, TransformPointSse(points[i], rows));
+		}
+
+		void MultiplyMatricesSse2(const Matrix4* a, const Matrix4* b, Matrix4* results, size_t count)
+		{
+			for (size_t i = 0u; i < count; ++i)
+				MultiplySse2(a[i], b[i], results[i]);
+		}
+
+		// Two points per instruction, one in each 128-bit lane, with the matrix rows repeated in both.
+		TARGET_AVX2 void TransformPointsAvx2(const Matrix4& m, const Float3* points, Float4* results, size_t count)
+		{
+			const __m256 row0 = _mm256_broadcast_ps((const __m128*)m.m[0]);
+			const __m256 row1 = _mm256_broadcast_ps((const __m128*)m.m[1]);
+			const __m256 row2 = _mm256_broadcast_ps((const __m128*)m.m[2]);
+			const __m256 row3 = _mm256_broadcast_ps((const __m128*)m.m[3]);
+
+			size_t i = 0u;
+			for (; i + 2u <= count; i += 2u)
+			{
+				const Float3& first = points[i];
+				const Float3& second = points[i + 1u];
+				__m256 x = _mm256_set_m128(_mm_set1_ps(second.x), _mm_set1_ps(first.x));
+				__m256 y = _mm256_set_m128(_mm_set1_ps(second.y), _mm_set1_ps(first.y));
+				__m256 z = _mm256_set_m128(_mm_set1_ps(second.z), _mm_set1_ps(first.z));
+
+				__m256 result = _mm256_add_ps(_mm256_mul_ps(z, row2), row3);
+				result = _mm256_add_ps(result, _mm256_mul_ps(y, row1));
+				result = _mm256_add_ps(result, _mm256_mul_ps(x, row0));
+				_mm256_storeu_ps(&results[i].x, result);
+			}
+
+			if (i < count)
+				TransformPointsSse2(m, points + i, results + i, count - i);
+		}
+
+		// Two rows of a per instruction, splatting each row's components within its own lane.
+		TARGET_AVX2 void MultiplyMatricesAvx2(const Matrix4* a, const Matrix4* b, Matrix4* results, size_t count)
+		{
+			for (size_t i = 0u; i < count; ++i)
+			{
+				const __m256 b0 = _mm256_broadcast_ps((const __m128*)b[i].m[0]);
+				const __m256 b1 = _mm256_broadcast_ps((const __m128*)b[i].m[1]);
+				const __m256 b2 = _mm256_broadcast_ps((const __m128*)b[i].m[2]);
+				const __m256 b3 = _mm256_broadcast_ps((const __m128*)b[i].m[3]);
+				__m256 rows[2] = { _mm256_loadu_ps(a[i].m[0]), _mm256_loadu_ps(a[i].m[2]) };
+
+				for (__m256& row : rows)
+				{
+					__m256 x = _mm256_permute_ps(row, _MM_SHUFFLE(0, 0, 0, 0));
+					__m256 y = _mm256_permute_ps(row, _MM_SHUFFLE(1, 1, 1, 1));
+					__m256 z = _mm256_permute_ps(row, _MM_SHUFFLE(2, 2, 2, 2));
+					__m256 w = _mm256_permute_ps(row, _MM_SHUFFLE(3, 3, 3, 3));
+					row = _mm256_add_ps(_mm256_add_ps(_mm256_mul_ps(x, b0), _mm256_mul_ps(z, b2)), _mm256_add_ps(_mm256_mul_ps(y, b1), _mm256_mul_ps(w, b3)));
+				}
+
+				_mm256_storeu_ps(results[i].m[0], rows[0]);
+				_mm256_storeu_ps(results[i].m[2], rows[1]);
+			}
+		}
+#elif defined(MATH_NEON)
+		inline float32x4_t MultiplyRowNeon(float32x4_t row, const float32x4_t b[4])
+		{
+			float32x2_t low = vget_low_f32(row);
+			float32x2_t high = vget_high_f32(row);
+			float32x4_t xz = vaddq_f32(vmulq_lane_f32(b[0], low, 0), vmulq_lane_f32(b[2], high, 0));
+			float32x4_t yw = vaddq_f32(vmulq_lane_f32(b[1], low, 1), vmulq_lane_f32(b[3], high, 1));
+			return vaddq_f32(xz, yw);
+		}
+
+		void MultiplyNeon(const Matrix4& a, const Matrix4& b, Matrix4& result)
+		{
+			// Load both before storing anything, so result may be a or b.
+			const float32x4_t rows[4] = { vld1q_f32(b.m[0]), vld1q_f32(b.m[1]), vld1q_f32(b.m[2]), vld1q_f32(b.m[3]) };
+			float32x4_t row0 = MultiplyRowNeon(vld1q_f32(a.m[0]), rows);
+			float32x4_t row1 = MultiplyRowNeon(vld1q_f32(a.m[1]), rows);
+			float32x4_t row2 = MultiplyRowNeon(vld1q_f32(a.m[2]), rows);
+			float32x4_t row3 = MultiplyRowNeon(vld1q_f32(a.m[3]), rows);
+			vst1q_f32(result.m[0], row0);
+			vst1q_f32(result.m[1], row1);
+			vst1q_f32(result.m[2], row2);
+			vst1q_f32(result.m[3], row3);
+		}
+
+		inline float32x4_t TransformPointNeon(const Float3& p, const float32x4_t m[4])
+		{
+			float32x4_t result = vaddq_f32(vmulq_n_f32(m[2], p.z), m[3]);
+			result = vaddq_f32(result, vmulq_n_f32(m[1], p.y));
+			return vaddq_f32(result, vmulq_n_f32(m[0], p.x));
+		}
+
+		void TransformPointsNeon(const Matrix4& m, const Float3* points, Float4* results, size_t count)
+		{
+			const float32x4_t rows[4] = { vld1q_f32(m.m[0]), vld1q_f32(m.m[1]), vld1q_f32(m.m[2]), vld1q_f32(m.m[3]) };
+			for (size_t i = 0u; i < count; ++i)
+				vst1q_f32(&results[i].x, TransformPointNeon(points[i], rows));
+		}
+
+		void MultiplyMatricesNeon(const Matrix4* a, const Matrix4* b, Matrix4* results, size_t count)
+		{
+			for (size_t i = 0u; i < count; ++i)
+				MultiplyNeon(a[i], b[i], results[i]);
+		}
+#endif
+
+		struct Kernels
+		{
+			TransformPointsKernel transformPoints;
+			MultiplyMatricesKernel multiplyMatrices;
+			const char* name;
+		};
+
+		const Kernels& GetKernels()
+		{
+			static const Kernels kernels = []
+			{
+#if defined(MATH_SSE)
+				const CpuFeatures& features = CpuFeatures::Get();
+				if (features.avx2)
+					return Kernels{ TransformPointsAvx2, MultiplyMatricesAvx2, "avx2" };
+				if (features.sse2)
+					return Kernels{ TransformPointsSse2, MultiplyMatricesSse2, "sse2" };
+#elif defined(MATH_NEON)
+				return Kernels{ TransformPointsNeon, MultiplyMatricesNeon, "neon" };
+#endif
+				return Kernels{ TransformPointsScalar, MultiplyMatricesScalar, "scalar" };
+			}();
+			return kernels;
+		}
+	}
+
+	void SinCos(float angle, float& sine, float& cosine)
+	{
+		// Map the angle to y in [-pi, pi], angle = 2 * pi * quotient + y.
+		float quotient = ONE_DIV_TWO_PI * angle;
+		if (angle >= 0.0f)
+			quotient = (float)(int)(quotient + 0.5f);
+		else
+			quotient = (float)(int)(quotient - 0.5f);
+		float y = angle - TWO_PI * quotient;
+
+		// Map y to [-pi/2, pi/2] with sin(y) = sin(angle), flipping the cosine to match.
+		float sign = 1.0f;
+		if (y > PI_DIV_2)
+		{
+			y = PI - y;
+			sign = -1.0f;
+		}
+		else if (y < -PI_DIV_2)
+		{
+			y = -PI - y;
+			sign = -1.0f;
+		}
+
+		float y2 = y * y;
+		sine = (((((-2.3889859e-08f * y2 + 2.7525562e-06f) * y2 - 0.00019840874f) * y2 + 0.0083333310f) * y2 - 0.16666667f) * y2 + 1.0f) * y;
+		float p = ((((-2.6051615e-07f * y2 + 2.4760495e-05f) * y2 - 0.0013888378f) * y2 + 0.041666638f) * y2 - 0.5f) * y2 + 1.0f;
+		cosine = sign * p;
+	}
+
+	Quaternion RotationAxis(const Float3& axis, float angle)
+	{
+		Float3 normal = Normalize(axis);
+		float sine, cosine;
+		SinCos(0.5f * angle, sine, cosine);
+		return Quaternion(normal.x * sine, normal.y * sine, normal.z * sine, cosine);
+	}
+
+	Quaternion Multiply(const Quaternion& a, const Quaternion& b)
+	{
+		// The Hamilton product b * a, summed term by term in DirectXMath's order.
+		return Quaternion(
+			((b.w * a.x + b.x * a.w) + b.y * a.z) - b.z * a.y,
+			((b.w * a.y - b.x * a.z) + b.y * a.w) + b.z * a.x,
+			((b.w * a.z + b.x * a.y) - b.y * a.x) + b.z * a.w,
+			((b.w * a.w - b.x * a.x) - b.y * a.y) - b.z * a.z);
+	}
+
+	Quaternion Conjugate(const Quaternion& q)
+	{
+		return Quaternion(-q.x, -q.y, -q.z, q.w);
+	}
+
+	Quaternion Normalize(const Quaternion& q)
+	{
+		float length = sqrtf((q.x * q.x + q.z * q.z) + (q.y * q.y + q.w * q.w));
+		if (length == 0.0f)
+			return Quaternion(0.0f, 0.0f, 0.0f, 0.0f);
+		return Quaternion(q.x / length, q.y / length, q.z / length, q.w / length);
+	}
+
+	Float3 Rotate(const Float3& v, const Quaternion& q)
+	{
+		Quaternion rotated = Multiply(Multiply(Conjugate(q), Quaternion(v.x, v.y, v.z, 0.0f)), q);
+		return Float3(rotated.x, rotated.y, rotated.z);
+	}
+
+	Matrix4 Identity()
+	{
+		return Matrix4();
+	}
+
+	Matrix4 Translation(float x, float y, float z)
+	{
+		Matrix4 result;
+		result.m[3][0] = x;
+		result.m[3][1] = y;
+		result.m[3][2] = z;
+		return result;
+	}
+
+	Matrix4 Scaling(float x, float y, float z)
+	{
+		Matrix4 result;
+		result.m[0][0] = x;
+		result.m[1][1] = y;
+		result.m[2][2] = z;
+		return result;
+	}
+
+	Matrix4 Rotation(const Quaternion& q)
+	{
+		float x2 = q.x + q.x;
+		float y2 = q.y + q.y;
+		float z2 = q.z + q.z;
+		float xx = q.x * x2;
+		float yy = q.y * y2;
+		float zz = q.z * z2;
+		float xy = q.x * y2;
+		float xz = q.x * z2;
+		float yz = q.y * z2;
+		float wx = q.w * x2;
+		float wy = q.w * y2;
+		float wz = q.w * z2;
+
+		Matrix4 result;
+		result.m[0][0] = (1.0f - yy) - zz;
+		result.m[0][1] = xy + wz;
+		result.m[0][2] = xz - wy;
+		result.m[1][0] = xy - wz;
+		result.m[1][1] = (1.0f - xx) - zz;
+		result.m[1][2] = yz + wx;
+		result.m[2][0] = xz + wy;
+		result.m[2][1] = yz - wx;
+		result.m[2][2] = (1.0f - xx) - yy;
+		return result;
+	}
+
+	Matrix4 Transpose(const Matrix4& m)
+	{
+		Matrix4 result;
+		for (uint i = 0u; i < 4u; ++i)
+		{
+			for (uint j = 0u; j < 4u; ++j)
+				result.m[i][j] = m.m[j][i];
+		}
+		return result;
+	}
+
+	Matrix4 Inverse(const Matrix4& m)
+	{
+		// Cofactors from the 2x2 determinants of the top two rows and of the bottom two.
+		const auto& a = m.m;
+		float s0 = a[0][0] * a[1][1] - a[1][0] * a[0][1];
+		float s1 = a[0][0] * a[1][2] - a[1][0] * a[0][2];
+		float s2 = a[0][0] * a[1][3] - a[1][0] * a[0][3];
+		float s3 = a[0][1] * a[1][2] - a[1][1] * a[0][2];
+		float s4 = a[0][1] * a[1][3] - a[1][1] * a[0][3];
+		float s5 = a[0][2] * a[1][3] - a[1][2] * a[0][3];
+		float c5 = a[2][2] * a[3][3] - a[3][2] * a[2][3];
+		float c4 = a[2][1] * a[3][3] - a[3][1] * a[2][3];
+		float c3 = a[2][1] * a[3][2] - a[3][1] * a[2][2];
+		float c2 = a[2][0] * a[3][3] - a[3][0] * a[2][3];
+		float c1 = a[2][0] * a[3][2] - a[3][0] * a[2][2];
+		float c0 = a[2][0] * a[3][1] - a[3][0] * a[2][1];
+
+		float inverseDeterminant = 1.0f / (s0 * c5 - s1 * c4 + s2 * c3 + s3 * c2 - s4 * c1 + s5 * c0);
+
+		Matrix4 result;
+		result.m[0][0] = (a[1][1] * c5 - a[1][2] * c4 + a[1][3] * c3) * inverseDeterminant;
+		result.m[0][1] = (-a[0][1] * c5 + a[0][2] * c4 - a[0][3] * c3) * inverseDeterminant;
+		result.m[0][2] = (a[3][1] * s5 - a[3][2] * s4 + a[3][3] * s3) * inverseDeterminant;
+		result.m[0][3] = (-a[2][1] * s5 + a[2][2] * s4 - a[2][3] * s3) * inverseDeterminant;
+		result.m[1][0] = (-a[1][0] * c5 + a[1][2] * c2 - a[1][3] * c1) * inverseDeterminant;
+		result.m[1][1] = (a[0][0] * c5 - a[0][2] * c2 + a[0][3] * c1) * inverseDeterminant;
+		result.m[1][2] = (-a[3][0] * s5 + a[3][2] * s2 - a[3][3] * s1) * inverseDeterminant;
+		result.m[1][3] = (a[2][0] * s5 - a[2][2] * s2 + a[2][3] * s1) * inverseDeterminant;
+		result.m[2][0] = (a[1][0] * c4 - a[1][1] * c2 + a[1][3] * c0) * inverseDeterminant;
+		result.m[2][1] = (-a[0][0] * c4 + a[0][1] * c2 - a[0][3] * c0) * inverseDeterminant;
+		result.m[2][2] = (a[3][0] * s4 - a[3][1] * s2 + a[3][3] * s0) * inverseDeterminant;
+		result.m[2][3] = (-a[2][0] * s4 + a[2][1] * s2 - a[2][3] * s0) * inverseDeterminant;
+		result.m[3][0] = (-a[1][0] * c3 + a[1][1] * c1 - a[1][2] * c0) * inverseDeterminant;
+		result.m[3][1] = (a[0][0] * c3 - a[0][1] * c1 + a[0][2] * c0) * inverseDeterminant;
+		result.m[3][2] = (-a[3][0] * s3 + a[3][1] * s1 - a[3][2] * s0) * inverseDeterminant;
+		result.m[3][3] = (a[2][0] * s3 - a[2][1] * s1 + a[2][2] * s0) * inverseDeterminant;
+		return result;
+	}
+
+	Matrix4 Multiply(const Matrix4& a, const Matrix4& b)
+	{
+		Matrix4 result;
+#if defined(MATH_SSE)
+		MultiplySse2(a, b, result);
+#elif defined(MATH_NEON)
+		MultiplyNeon(a, b, result);
+#else
+		MultiplyScalar(a, b, result);
+#endif
+		return result;
+	}
+
+	Float4 TransformPoint(const Float3& p, const Matrix4& m)
+	{
+#if defined(MATH_SSE)
+		const __m128 rows[4] = { _mm_loadu_ps(m.m[0]), _mm_loadu_ps(m.m[1]), _mm_loadu_ps(m.m[2]), _mm_loadu_ps(m.m[3]) };
+		Float4 result;
+		_mm_storeu_ps(&result.x, TransformPointSse(p, rows));
+		return result;
+#elif defined(MATH_NEON)
+		const float32x4_t rows[4] = { vld1q_f32(m.m[0]), vld1q_f32(m.m[1]), vld1q_f32(m.m[2]), vld1q_f32(m.m[3]) };
+		Float4 result;
+		vst1q_f32(&result.x, TransformPointNeon(p, rows));
+		return result;
+#else
+		return TransformPointScalar(p, m);
+#endif
+	}
+
+	Matrix4 LookAtLH(const Float3& eye, const Float3& focus, const Float3& up)
+	{
+		return LookToLH(eye, focus - eye, up);
+	}
+
+	Matrix4 LookToLH(const Float3& eye, const Float3& direction, const Float3& up)
+	{
+		// The camera's axes, as rows of its rotation; the translation moves the eye to the origin.
+		Float3 zAxis = Normalize(direction);
+		Float3 xAxis = Normalize(Cross(up, zAxis));
+		Float3 yAxis = Cross(zAxis, xAxis);
+		Float3 negatedEye = -eye;
+
+		Matrix4 result;
+		result.m[0][0] = xAxis.x;
+		result.m[0][1] = yAxis.x;
+		result.m[0][2] = zAxis.x;
+		result.m[1][0] = xAxis.y;
+		result.m[1][1] = yAxis.y;
+		result.m[1][2] = zAxis.y;
+		result.m[2][0] = xAxis.z;
+		result.m[2][1] = yAxis.z;
+		result.m[2][2] = zAxis.z;
+		result.m[3][0] = Dot(xAxis, negatedEye);
+		result.m[3][1] = Dot(yAxis, negatedEye);
+		result.m[3][2] = Dot(zAxis, negatedEye);
+		return result;
+	}
+
+	Matrix4 PerspectiveFovLH(float fovY, float aspectRatio, float nearZ, float farZ)
+	{
+		float sine, cosine;
+		SinCos(0.5f * fovY, sine, cosine);
+		float height = cosine / sine;
+		float range = farZ / (farZ - nearZ);
+
+		Matrix4 result;
+		result.m[0][0] = height / aspectRatio;
+		result.m[1][1] = height;
+		result.m[2][2] = range;
+		result.m[2][3] = 1.0f;
+		result.m[3][2] = -range * nearZ;
+		result.m[3][3] = 0.0f;
+		return result;
+	}
+
+	Matrix4 OrthographicLH(float width, float height, float nearZ, float farZ)
+	{
+		float range = 1.0f / (farZ - nearZ);
+
+		Matrix4 result;
+		result.m[0][0] = 2.0f / width;
+		result.m[1][1] = 2.0f / height;
+		result.m[2][2] = range;
+		result.m[3][2] = -range * nearZ;
+		return result;
+	}
+
+	void TransformPoints(const Matrix4& m, const Float3* points, Float4* results, size_t count)
+	{
+		GetKernels().transformPoints(m, points, results, count);
+	}
+
+	void TransformPointsScalar(const Matrix4& m, const Float3* points, Float4* results, size_t count)
+	{
+		for (size_t i = 0u; i < count; ++i)
+			results[i] = TransformPointScalar(points[i], m);
+	}
+
+	void MultiplyMatrices(const Matrix4* a, const Matrix4* b, Matrix4* results, size_t count)
+	{
+		GetKernels().multiplyMatrices(a, b, results, count);
+	}
+
+	void MultiplyMatricesScalar(const Matrix4* a, const Matrix4* b, Matrix4* results, size_t count)
+	{
+		for (size_t i = 0u; i < count; ++i)
+			MultiplyScalar(a[i], b[i], results[i]);
+	}
+
+	const char* GetKernelName()
+	{
+		return GetKernels().name;
+	}
+}
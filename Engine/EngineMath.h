@@ -0,0 +1,179 @@
+#pragma once
+
+#include <math.h>
+#include "Common.h"
+
+// The engine's vector, quaternion and matrix math, with no Windows SDK dependency.
+//
+// Conventions are DirectXMath's, so values pass between the two by copying (see MathDirectX.h): matrices are row-major
+// and transform row vectors (v * M), and the view and projection builders are left-handed, with Direct3D's 0 to 1
+// depth range. The functions also do DirectXMath's operations in DirectXMath's order, with its SSE code path's
+// rounding, so a matrix built here has the same bits as one built with DirectXMath.
+//
+// - Multiply and TransformPoint use SSE2 on x86 and x64, NEON on ARM and plain floats elsewhere, picked when
+//   compiling; define MATH_NO_INTRINSICS to force plain floats. The rest works on single floats, which vectors would
+//   not speed up.
+// - The batched kernels, TransformPoints and MultiplyMatrices, use AVX2 or SSE2 picked at runtime from CpuFeatures on
+//   x86, NEON on ARM and plain floats elsewhere. Their scalar references are kept for comparison.
+//
+// Every path multiplies and adds separately and in the same order, so they all give the same bits. Compilers that
+// fuse a multiply and an add on their own (GCC and Clang targeting FMA hardware, such as ARM64) must be told not to,
+// with -ffp-contract=off.
+namespace Math
+{
+	const float PI = 3.141592654f;
+	const float PI_DIV_2 = 1.570796327f;
+	const float TWO_PI = 6.283185307f;
+
+	struct Float2
+	{
+		float x = 0.0f;
+		float y = 0.0f;
+
+		Float2() = default;
+		Float2(float x, float y) : x(x), y(y) {}
+	};
+
+	struct Float3
+	{
+		float x = 0.0f;
+		float y = 0.0f;
+		float z = 0.0f;
+
+		Float3() = default;
+		Float3(float x, float y, float z) : x(x), y(y), z(z) {}
+	};
+
+	struct alignas(16) Float4
+	{
+		float x = 0.0f;
+		float y = 0.0f;
+		float z = 0.0f;
+		float w = 0.0f;
+
+		Float4() = default;
+		Float4(float x, float y, float z, float w) : x(x), y(y), z(z), w(w) {}
+	};
+
+	// A rotation, as a unit quaternion (x, y, z) * sin(angle / 2) + w * cos(angle / 2).
+	struct alignas(16) Quaternion
+	{
+		float x = 0.0f;
+		float y = 0.0f;
+		float z = 0.0f;
+		float w = 1.0f;
+
+		Quaternion() = default;
+		Quaternion(float x, float y, float z, float w) : x(x), y(y), z(z), w(w) {}
+	};
+
+	// Laid out as DirectX::XMFLOAT4X4: m[row][column], the translation in row 3.
+	struct alignas(16) Matrix4
+	{
+		float m[4][4] =
+		{
+			{ 1.0f, 0.0f, 0.0f, 0.0f },
+			{ 0.0f, 1.0f, 0.0f, 0.0f },
+			{ 0.0f, 0.0f, 1.0f, 0.0f },
+			{ 0.0f, 0.0f, 0.0f, 1.0f }
+		};
+	};
+
+	inline Float3 operator+(const Float3& a, const Float3& b)
+	{
+		return Float3(a.x + b.x, a.y + b.y, a.z + b.z);
+	}
+
+	inline Float3 operator-(const Float3& a, const Float3& b)
+	{
+		return Float3(a.x - b.x, a.y - b.y, a.z - b.z);
+	}
+
+	inline Float3 operator-(const Float3& a)
+	{
+		return Float3(-a.x, -a.y, -a.z);
+	}
+
+	inline Float3 operator*(const Float3& a, float scale)
+	{
+		return Float3(a.x * scale, a.y * scale, a.z * scale);
+	}
+
+	inline bool operator==(const Float3& a, const Float3& b)
+	{
+		return a.x == b.x && a.y == b.y && a.z == b.z;
+	}
+
+	inline float Dot(const Float3& a, const Float3& b)
+	{
+		return (a.x * b.x + a.y * b.y) + a.z * b.z;
+	}
+
+	inline Float3 Cross(const Float3& a, const Float3& b)
+	{
+		return Float3(a.y * b.z - a.z * b.y, a.z * b.x - a.x * b.z, a.x * b.y - a.y * b.x);
+	}
+
+	inline float Length(const Float3& a)
+	{
+		return sqrtf(Dot(a, a));
+	}
+
+	// Zero for a zero vector. Divides by the length rather than multiplying by its reciprocal, as DirectXMath's SSE path does.
+	inline Float3 Normalize(const Float3& a)
+	{
+		float length = Length(a);
+		if (length == 0.0f)
+			return Float3();
+		return Float3(a.x / length, a.y / length, a.z / length);
+	}
+
+	// DirectXMath's XMScalarSinCos: an 11-degree minimax polynomial for the sine and a 10-degree one for the cosine,
+	// after reducing the angle to [-pi/2, pi/2].
+	void SinCos(float angle, float& sine, float& cosine);
+
+	// Rotation by angle radians about an axis, which need not be unit length.
+	Quaternion RotationAxis(const Float3& axis, float angle);
+
+	// Rotation by a, then by b, as XMQuaternionMultiply(a, b).
+	Quaternion Multiply(const Quaternion& a, const Quaternion& b);
+
+	Quaternion Conjugate(const Quaternion& q);
+	Quaternion Normalize(const Quaternion& q);
+	Float3 Rotate(const Float3& v, const Quaternion& q);
+
+	Matrix4 Identity();
+	Matrix4 Translation(float x, float y, float z);
+	Matrix4 Scaling(float x, float y, float z);
+	Matrix4 Rotation(const Quaternion& q);
+	Matrix4 Transpose(const Matrix4& m);
+
+	// The inverse of an invertible matrix. The one exception to matching DirectXMath's bits: it takes its cofactors in
+	// another order than XMMatrixInverse, so the two agree only to rounding. It is used for picking, not for drawing.
+	Matrix4 Inverse(const Matrix4& m);
+
+	// Transforming by the result transforms by a, then by b.
+	Matrix4 Multiply(const Matrix4& a, const Matrix4& b);
+
+	// (p, 1) * m, without dividing by w.
+	Float4 TransformPoint(const Float3& p, const Matrix4& m);
+
+	// View matrices of a camera at eye looking at focus, or along direction; up need not be perpendicular to the view.
+	Matrix4 LookAtLH(const Float3& eye, const Float3& focus, const Float3& up);
+	Matrix4 LookToLH(const Float3& eye, const Float3& direction, const Float3& up);
+
+	// Projections onto Direct3D's clip space, depth 0 at nearZ and 1 at farZ. fovY is the vertical field of view in radians.
+	Matrix4 PerspectiveFovLH(float fovY, float aspectRatio, float nearZ, float farZ);
+	Matrix4 OrthographicLH(float width, float height, float nearZ, float farZ);
+
+	// results[i] = (points[i], 1) * m, as TransformPoint.
+	void TransformPoints(const Matrix4& m, const Float3* points, Float4* results, size_t count);
+	void TransformPointsScalar(const Matrix4& m, const Float3* points, Float4* results, size_t count);
+
+	// results[i] = a[i] * b[i], as Multiply. results may be a or b.
+	void MultiplyMatrices(const Matrix4* a, const Matrix4* b, Matrix4* results, size_t count);
+	void MultiplyMatricesScalar(const Matrix4* a, const Matrix4* b, Matrix4* results, size_t count);
+
+	// Name of the instruction set the batched kernels use ("avx2", "sse2", "neon" or "scalar").
+	const char* GetKernelName();
+}
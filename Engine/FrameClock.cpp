@@ -0,0 +1,54 @@
+#include "FrameClock.h"
+
+#include <chrono>
+
+#ifdef _WIN32
+#define WIN32_LEAN_AND_MEAN
+#define NOMINMAX
+#include <windows.h>
+
+// Windows 10 1803 and later; older SDKs do not define it.
+#ifndef CREATE_WAITABLE_TIMER_HIGH_RESOLUTION
+#define CREATE_WAITABLE_TIMER_HIGH_RESOLUTION 0x00000002
+#endif
+#else
+#include <thread>
+#endif
+
+SystemClock::SystemClock()
+{
+#ifdef _WIN32
+	// Fall back to an ordinary timer, which fires on the system timer's tick, where the high resolution one is missing.
+	_timer = CreateWaitableTimerExW(nullptr, nullptr, CREATE_WAITABLE_TIMER_HIGH_RESOLUTION, TIMER_ALL_ACCESS);
+	if (!_timer)
+		_timer = CreateWaitableTimerExW(nullptr, nullptr, 0u, TIMER_ALL_ACCESS);
+#endif
+}
+
+SystemClock::~SystemClock()
+{
+#ifdef _WIN32
+	if (_timer)
+		CloseHandle(_timer);
+#endif
+}
+
+uint64_t SystemClock::Now()
+{
+	return (uint64_t)std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+void SystemClock::Sleep(uint64_t nanoseconds)
+{
+#ifdef _WIN32
+	// A negative due time is relative, in 100 ns units.
+	LARGE_INTEGER dueTime;
+	dueTime.QuadPart = -(LONGLONG)((nanoseconds + 99u) / 100u);
+	if (_timer && SetWaitableTimerEx(_timer, &dueTime, 0, nullptr, nullptr, nullptr, 0u))
+		WaitForSingleObject(_timer, INFINITE);
+	else
+		::Sleep((DWORD)((nanoseconds + 999999u) / 1000000u));
+#else
+	std::this_thread::sleep_for(std::chrono::nanoseconds(nanoseconds));
+#endif
+}
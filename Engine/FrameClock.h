@@ -0,0 +1,37 @@
+#pragma once
+
+#include "Common.h"
+
+// The time source FrameLoop paces frames with, so a simulated clock can stand in for the real one.
+class FrameClock
+{
+public:
+
+	virtual ~FrameClock() = default;
+
+	// Nanoseconds from an arbitrary origin, never going backwards.
+	virtual uint64_t Now() = 0;
+
+	// Blocks for at least about nanoseconds. It may return later, by as much as the OS timer's granularity.
+	virtual void Sleep(uint64_t nanoseconds) = 0;
+};
+
+// The steady clock, sleeping on a high resolution waitable timer where Windows has one. Older Windows sleep to the
+// system timer's tick, 15.6 ms by default; FrameLoop learns that and spins instead.
+class SystemClock : public FrameClock
+{
+public:
+
+	SystemClock();
+	~SystemClock() override;
+
+	SystemClock(const SystemClock&) = delete;
+	SystemClock& operator=(const SystemClock&) = delete;
+
+	uint64_t Now() override;
+	void Sleep(uint64_t nanoseconds) override;
+
+private:
+
+	void* _timer = nullptr;	// Windows waitable timer handle.
+};
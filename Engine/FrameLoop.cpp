@@ -0,0 +1,204 @@
+#include "FrameLoop.h"
+#include "Profiler.h"
+
+#include <algorithm>
+#include <math.h>
+
+void FrameTimeHistogram::Add(uint64_t nanoseconds)
+{
+	uint64_t bucket = nanoseconds / (BUCKET_MICROSECONDS * 1000u);
+	_buckets[bucket < BUCKET_COUNT ? (uint)bucket : BUCKET_COUNT - 1u]++;
+	_count++;
+	_sum += nanoseconds;
+	if (nanoseconds > _max)
+		_max = nanoseconds;
+}
+
+void FrameTimeHistogram::Reset()
+{
+	std::fill(_buckets.begin(), _buckets.end(), 0u);
+	_count = 0u;
+	_sum = 0u;
+	_max = 0u;
+}
+
+uint64_t FrameTimeHistogram::GetCount() const
+{
+	return _count;
+}
+
+double FrameTimeHistogram::GetAverageMilliseconds() const
+{
+	return _count > 0u ? (double)_sum / _count / 1e6 : 0.0;
+}
+
+double FrameTimeHistogram::GetMaxMilliseconds() const
+{
+	return (double)_max / 1e6;
+}
+
+double FrameTimeHistogram::GetPercentileMilliseconds(double fraction) const
+{
+	if (_count == 0u)
+		return 0.0;
+
+	// The first bucket by which the running count reaches the fraction; no bucket edge is more than the longest time.
+	uint64_t target = (uint64_t)ceil(fraction * _count);
+	uint64_t count = 0u;
+	for (uint bucket = 0u; bucket < BUCKET_COUNT - 1u; ++bucket)
+	{
+		count += _buckets[bucket];
+		if (count >= target && count > 0u)
+		{
+			double edge = (bucket + 1u) * BUCKET_MICROSECONDS / 1000.0;
+			return edge < GetMaxMilliseconds() ? edge : GetMaxMilliseconds();
+		}
+	}
+	return GetMaxMilliseconds();
+}
+
+const std::vector<uint64_t>& FrameTimeHistogram::GetBuckets() const
+{
+	return _buckets;
+}
+
+FrameLoop::FrameLoop(FrameClock& clock, const Desc& desc)
+	: _clock(clock)
+	, _desc(desc)
+	, _stepNanoseconds((uint64_t)(1e9 / desc.updateRate + 0.5))
+{
+	SetFrameRateLimit(desc.frameRateLimit);
+}
+
+FrameLoop::Frame FrameLoop::BeginFrame()
+{
+	uint64_t now = _clock.Now();
+
+	Frame frame;
+	frame.stepSeconds = (float)(_stepNanoseconds / 1e9);
+	if (_started)
+	{
+		uint64_t elapsed = now - _frameStart;
+		_frameTimes.Add(elapsed);
+		frame.frameSeconds = elapsed / 1e9;
+		_accumulator += elapsed;
+	}
+	else
+	{
+		_started = true;
+	}
+	_frameStart = now;
+
+	// The frame is due a period after the last one's deadline, so how late waits return does not add up.
+	if (_periodNanoseconds > 0u)
+		_deadline = _deadline > 0u ? _deadline + _periodNanoseconds : now + _periodNanoseconds;
+
+	// Run the whole steps the accumulated time holds, dropping the time of those past the limit.
+	uint64_t steps = _accumulator / _stepNanoseconds;
+	if (steps > _desc.maxStepsPerFrame)
+	{
+		_stats.droppedSteps += steps - _desc.maxStepsPerFrame;
+		_accumulator -= (steps - _desc.maxStepsPerFrame) * _stepNanoseconds;
+		steps = _desc.maxStepsPerFrame;
+	}
+	_accumulator -= steps * _stepNanoseconds;
+	_stepCount += steps;
+
+	frame.steps = (uint)steps;
+	frame.interpolation = (float)((double)_accumulator / _stepNanoseconds);
+	frame.time = _stepCount * (_stepNanoseconds / 1e9);
+	_stats.frames++;
+	_stats.steps += steps;
+	return frame;
+}
+
+void FrameLoop::EndFrame()
+{
+	uint64_t now = _clock.Now();
+	_workTimes.Add(now - _frameStart);
+	if (_periodNanoseconds == 0u)
+		return;
+
+	// Past the deadline, the next frame's period counts from now.
+	if (now >= _deadline)
+	{
+		_stats.lateFrames++;
+		_deadline = now;
+		return;
+	}
+
+	PROFILE_SCOPE("Frame pacing");
+	Wait(_deadline);
+}
+
+void FrameLoop::Wait(uint64_t deadline)
+{
+	// Sleep while a sleep, and how late it may return, still fit before the deadline.
+	uint64_t start = _clock.Now();
+	uint64_t now = start;
+	while (now < deadline && (double)(deadline - now) > _desc.sleepQuantum + GetSleepMarginMilliseconds() * 1e6)
+	{
+		_clock.Sleep(_desc.sleepQuantum);
+		uint64_t woken = _clock.Now();
+
+		// Follow the timer as it changes, weighing the last 64 sleeps or so.
+		double oversleep = woken - now > _desc.sleepQuantum ? (double)(woken - now - _desc.sleepQuantum) : 0.0;
+		_sleepCount++;
+		double weight = _sleepCount < 64u ? 1.0 / _sleepCount : 1.0 / 64.0;
+		double difference = oversleep - _oversleepMean;
+		_oversleepMean += weight * difference;
+		_oversleepVariance = (1.0 - weight) * (_oversleepVariance + weight * difference * difference);
+		now = woken;
+	}
+	_stats.sleepMilliseconds += (now - start) / 1e6;
+
+	// Spin for the rest.
+	uint64_t spinStart = now;
+	while (now < deadline)
+		now = _clock.Now();
+	_stats.spinMilliseconds += (now - spinStart) / 1e6;
+	_waitErrors.Add(now - deadline);
+}
+
+void FrameLoop::SetFrameRateLimit(double framesPerSecond)
+{
+	_desc.frameRateLimit = framesPerSecond;
+	_periodNanoseconds = framesPerSecond > 0.0 ? (uint64_t)(1e9 / framesPerSecond + 0.5) : 0u;
+	_deadline = 0u;
+}
+
+const FrameTimeHistogram& FrameLoop::GetFrameTimes() const
+{
+	return _frameTimes;
+}
+
+const FrameTimeHistogram& FrameLoop::GetWorkTimes() const
+{
+	return _workTimes;
+}
+
+const FrameTimeHistogram& FrameLoop::GetWaitErrors() const
+{
+	return _waitErrors;
+}
+
+const FrameLoop::Stats& FrameLoop::GetStats() const
+{
+	return _stats;
+}
+
+double FrameLoop::GetSleepMarginMilliseconds() const
+{
+	// Until a sleep has been measured, expect one to take twice as long as it asks.
+	if (_sleepCount == 0u)
+		return _desc.sleepQuantum / 1e6;
+	return (_oversleepMean + 2.0 * sqrt(_oversleepVariance)) / 1e6;
+}
+
+void FrameLoop::ResetStats()
+{
+	_frameTimes.Reset();
+	_workTimes.Reset();
+	_waitErrors.Reset();
+	_stats = Stats();
+}
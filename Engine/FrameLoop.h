@@ -0,0 +1,131 @@
+#pragma once
+
+#include "Common.h"
+#include "FrameClock.h"
+
+// Counts frame times in buckets of BUCKET_MICROSECONDS. Times past the last bucket are counted in it.
+class FrameTimeHistogram
+{
+public:
+
+	static const uint BUCKET_MICROSECONDS = 100u;
+	static const uint BUCKET_COUNT = 500u;	// Up to 50 ms.
+
+	void Add(uint64_t nanoseconds);
+	void Reset();
+
+	uint64_t GetCount() const;
+	double GetAverageMilliseconds() const;
+	double GetMaxMilliseconds() const;
+
+	// The time fraction of the times are at most, to the upper edge of its bucket; in the last bucket, the longest time.
+	double GetPercentileMilliseconds(double fraction) const;
+
+	const std::vector<uint64_t>& GetBuckets() const;
+
+private:
+
+	std::vector<uint64_t> _buckets = std::vector<uint64_t>(BUCKET_COUNT);
+	uint64_t _count = 0u;
+	uint64_t _sum = 0u;
+	uint64_t _max = 0u;
+};
+
+// Runs the simulation in fixed steps, however long frames take, and paces frames to a frame rate limit.
+//
+// - BeginFrame adds the time since the last frame to an accumulator and says how many whole steps it holds; the rest
+//   carries over. The frame draws the state that far between the last two steps, so motion stays smooth when frames
+//   and steps do not line up. A frame holding more than maxStepsPerFrame steps drops the excess time instead of
+//   running them, so a slow frame cannot make the next one slower still.
+// - EndFrame waits for the next frame's deadline, one period after the last. It sleeps while a sleep is sure to end
+//   before the deadline and spins on the clock for the rest. How late sleeps return is measured as they are made,
+//   so a coarse OS timer leads to more spinning rather than to missed deadlines. A frame that ends past its deadline
+//   starts a new schedule from there instead of hurrying the frames after it.
+//
+// Everything runs on the calling thread, on the given clock.
+class FrameLoop
+{
+public:
+
+	struct Desc
+	{
+		double updateRate = 60.0;				// Simulation steps per second.
+		double frameRateLimit = 0.0;			// Frames per second EndFrame waits down to; 0 for no limit.
+		uint maxStepsPerFrame = 8u;				// Steps a frame runs at most.
+		uint64_t sleepQuantum = 1000000u;		// Nanoseconds a single sleep asks for.
+	};
+
+	// What a frame is to do: run steps steps of stepSeconds, then draw interpolation of the way from the state before
+	// the last step to the state after it.
+	struct Frame
+	{
+		uint steps = 0u;
+		float stepSeconds = 0.0f;
+		float interpolation = 0.0f;		// In [0, 1).
+		double time = 0.0;				// Simulated seconds once the steps have run.
+		double frameSeconds = 0.0;		// Since the last frame began; 0 for the first.
+	};
+
+	struct Stats
+	{
+		uint64_t frames = 0u;
+		uint64_t steps = 0u;
+		uint64_t droppedSteps = 0u;			// Steps' worth of time thrown away past maxStepsPerFrame.
+		uint64_t lateFrames = 0u;			// Frames that ended past their deadline and did not wait.
+		double sleepMilliseconds = 0.0;		// Spent waiting in sleeps, and spinning.
+		double spinMilliseconds = 0.0;
+	};
+
+	FrameLoop(FrameClock& clock, const Desc& desc);
+
+	FrameLoop(const FrameLoop&) = delete;
+	FrameLoop& operator=(const FrameLoop&) = delete;
+
+	// Starts a frame. Call before the frame's simulation steps.
+	Frame BeginFrame();
+
+	// Ends the frame once it has been drawn, waiting for the frame rate limit.
+	void EndFrame();
+
+	// Frames per second EndFrame waits down to from the next frame; 0 for no limit.
+	void SetFrameRateLimit(double framesPerSecond);
+
+	// From one BeginFrame to the next; from BeginFrame to EndFrame, before waiting; and how long after the deadline
+	// the waits returned.
+	const FrameTimeHistogram& GetFrameTimes() const;
+	const FrameTimeHistogram& GetWorkTimes() const;
+	const FrameTimeHistogram& GetWaitErrors() const;
+
+	const Stats& GetStats() const;
+
+	// How late a sleep is expected to return, in milliseconds; waits spin for this long before their deadline.
+	double GetSleepMarginMilliseconds() const;
+
+	// Clears the histograms and stats, leaving the simulation and the sleep measurements as they are.
+	void ResetStats();
+
+private:
+
+	void Wait(uint64_t deadline);
+
+	FrameClock& _clock;
+	Desc _desc;
+	uint64_t _stepNanoseconds;
+	uint64_t _periodNanoseconds = 0u;	// 0 without a frame rate limit.
+
+	bool _started = false;
+	uint64_t _frameStart = 0u;
+	uint64_t _deadline = 0u;		// Of the frame begun last.
+	uint64_t _accumulator = 0u;		// Time not yet simulated, less than a step after each BeginFrame.
+	uint64_t _stepCount = 0u;
+
+	// Running mean and variance of how much longer than asked sleeps take, in nanoseconds.
+	double _oversleepMean = 0.0;
+	double _oversleepVariance = 0.0;
+	uint64_t _sleepCount = 0u;
+
+	FrameTimeHistogram _frameTimes;
+	FrameTimeHistogram _workTimes;
+	FrameTimeHistogram _waitErrors;
+	Stats _stats;
+};
@@ -0,0 +1,266 @@
+#include "FrameLoopBenchmark.h"
+#include "FrameLoop.h"
+
+#include <chrono>
+#include <math.h>
+#include <random>
+
+namespace
+{
+	const uint RANDOM_SEED = 1234u;
+	const double UPDATE_RATE = 60.0;
+	const double FRAME_RATE_LIMIT = 120.0;
+	const double SIMULATED_SECONDS = 10.0;
+	const uint DETERMINISM_STEP = 500u;			// Step after which runs at different frame rates are compared.
+	const uint64_t CLOCK_READ_NANOSECONDS = 20u;	// Simulated time each read of the clock takes, so spins end.
+	const uint64_t COARSE_TIMER_NANOSECONDS = 15625000u;
+	const double RATE_TOLERANCE = 0.005;			// Of the limit's period, for the average frame time.
+	const double WAIT_ERROR_LIMIT_MILLISECONDS = 0.2;	// For the 99th percentile of how late waits return.
+	const double REAL_RATE_LIMIT = 240.0;
+	const uint REAL_FRAMES = 480u;
+	const double REAL_RATE_TOLERANCE = 0.02;
+	const double REAL_WORK_MILLISECONDS = 1.0;
+
+	// Time passes only when the frame does work, when a sleep is made, and a little on each read. Sleeps return
+	// rounded up to the timer's tick, when it has one, and then up to a random jitter later.
+	class SimulatedClock : public FrameClock
+	{
+	public:
+
+		SimulatedClock(uint64_t timerTick, uint64_t sleepJitter)
+			: _timerTick(timerTick)
+			, _sleepJitter(sleepJitter)
+			, _random(RANDOM_SEED)
+		{
+		}
+
+		uint64_t Now() override
+		{
+			_now += CLOCK_READ_NANOSECONDS;
+			return _now;
+		}
+
+		void Sleep(uint64_t nanoseconds) override
+		{
+			uint64_t wake = _now + nanoseconds;
+			if (_timerTick > 0u)
+				wake = (wake + _timerTick - 1u) / _timerTick * _timerTick;
+			if (_sleepJitter > 0u)
+				wake += std::uniform_int_distribution<uint64_t>(0u, _sleepJitter)(_random);
+			_now = wake;
+		}
+
+		void Advance(uint64_t nanoseconds)
+		{
+			_now += nanoseconds;
+		}
+
+	private:
+
+		uint64_t _now = 1000000000u;
+		uint64_t _timerTick;
+		uint64_t _sleepJitter;
+		std::mt19937 _random;
+	};
+
+	// A damped spring, whose state depends on the step it is advanced with.
+	struct Spring
+	{
+		double position = 1.0;
+		double velocity = 0.0;
+
+		void Step(double seconds)
+		{
+			velocity += (-40.0 * position - 0.5 * velocity) * seconds;
+			position += velocity * seconds;
+		}
+	};
+
+	struct StepRun
+	{
+		bool match = true;
+		double worstTimeError = 0.0;		// Milliseconds between the interpolated simulation time and the clock's.
+		uint maxSteps = 0u;
+		Spring spring;						// After DETERMINISM_STEP steps.
+		FrameLoop::Stats stats;
+	};
+
+	// Runs SIMULATED_SECONDS of frames without a limit, each taking from minWork to maxWork milliseconds.
+	StepRun RunSteps(double minWork, double maxWork)
+	{
+		SimulatedClock clock(0u, 0u);
+		FrameLoop::Desc desc;
+		desc.updateRate = UPDATE_RATE;
+		FrameLoop loop(clock, desc);
+		std::mt19937 random(RANDOM_SEED);
+		std::uniform_real_distribution<double> work(minWork, maxWork);
+
+		StepRun run;
+		Spring spring;
+		uint stepCount = 0u;
+		uint64_t start = 0u;
+		for (double seconds = 0.0; seconds < SIMULATED_SECONDS; )
+		{
+			FrameLoop::Frame frame = loop.BeginFrame();
+			uint64_t now = clock.Now();
+			if (start == 0u)
+				start = now;
+			for (uint step = 0u; step < frame.steps; ++step)
+			{
+				spring.Step(frame.stepSeconds);
+				if (++stepCount == DETERMINISM_STEP)
+					run.spring = spring;
+			}
+			run.maxSteps = frame.steps > run.maxSteps ? frame.steps : run.maxSteps;
+
+			// The state drawn is interpolation of a step past the simulated time, which with the time dropped is the clock's.
+			double drawn = frame.time + frame.interpolation * (double)frame.stepSeconds;
+			double elapsed = (now - start) / 1e9 - loop.GetStats().droppedSteps / UPDATE_RATE;
+			double error = fabs(drawn - elapsed) * 1000.0;
+			run.worstTimeError = error > run.worstTimeError ? error : run.worstTimeError;
+
+			uint64_t frameWork = (uint64_t)(work(random) * 1e6);
+			clock.Advance(frameWork);
+			loop.EndFrame();
+			seconds += frameWork / 1e9;
+		}
+
+		run.stats = loop.GetStats();
+		run.match = run.stats.steps == stepCount && run.worstTimeError < 0.01;
+		return run;
+	}
+
+	struct LimitRun
+	{
+		FrameLoop::Stats stats;
+		double averageMilliseconds = 0.0;
+		double p50Milliseconds = 0.0;
+		double p99Milliseconds = 0.0;
+		double maxMilliseconds = 0.0;
+		double waitErrorMilliseconds = 0.0;	// 99th percentile.
+		double sleepMarginMilliseconds = 0.0;
+		uint64_t frameTimeCount = 0u;
+	};
+
+	// Runs frames that call work, limited to frameRateLimit.
+	template<typename Clock, typename Work>
+	LimitRun RunLimited(Clock& clock, double frameRateLimit, uint frames, Work work)
+	{
+		FrameLoop::Desc desc;
+		desc.updateRate = UPDATE_RATE;
+		desc.frameRateLimit = frameRateLimit;
+		FrameLoop loop(clock, desc);
+		for (uint frame = 0u; frame < frames; ++frame)
+		{
+			loop.BeginFrame();
+			work();
+			loop.EndFrame();
+		}
+
+		LimitRun run;
+		run.stats = loop.GetStats();
+		const FrameTimeHistogram& frameTimes = loop.GetFrameTimes();
+		run.averageMilliseconds = frameTimes.GetAverageMilliseconds();
+		run.p50Milliseconds = frameTimes.GetPercentileMilliseconds(0.5);
+		run.p99Milliseconds = frameTimes.GetPercentileMilliseconds(0.99);
+		run.maxMilliseconds = frameTimes.GetMaxMilliseconds();
+		run.waitErrorMilliseconds = loop.GetWaitErrors().GetPercentileMilliseconds(0.99);
+		run.sleepMarginMilliseconds = loop.GetSleepMarginMilliseconds();
+		run.frameTimeCount = frameTimes.GetCount();
+		return run;
+	}
+
+	void WriteLimitRun(std::ostream& output, const char* name, const LimitRun& run, bool match)
+	{
+		double waited = run.stats.sleepMilliseconds + run.stats.spinMilliseconds;
+		output << std::format("{:<28} frame time average {:.3f} ms, p50 {:.1f} ms, p99 {:.1f} ms, max {:.3f} ms, {} late frames",
+			name, run.averageMilliseconds, run.p50Milliseconds, run.p99Milliseconds, run.maxMilliseconds, run.stats.lateFrames) << std::endl;
+		output << std::format("{:<28} waits {:.3f} ms late at p99, {:.0f}% of waiting slept, sleep margin {:.3f} ms: {}", "",
+			run.waitErrorMilliseconds, waited > 0.0 ? run.stats.sleepMilliseconds * 100.0 / waited : 0.0, run.sleepMarginMilliseconds,
+			match ? "OK" : "MISMATCH") << std::endl;
+	}
+}
+
+bool RunFrameLoopBenchmark(std::ostream& output)
+{
+	bool allMatch = true;
+	output << std::format("{:.0f} simulation steps per second; {:.0f} s of frames per run without a limit", UPDATE_RATE, SIMULATED_SECONDS) << std::endl;
+
+	// Fixed steps whatever the frame times, and the same simulation from them.
+	StepRun varying = RunSteps(2.0, 40.0);
+	StepRun steady = RunSteps(7.0, 7.0);
+	bool sameState = varying.stats.steps >= DETERMINISM_STEP && steady.stats.steps >= DETERMINISM_STEP && varying.spring.position == steady.spring.position && varying.spring.velocity == steady.spring.velocity;
+	bool stepMatch = varying.match && steady.match && sameState && varying.stats.droppedSteps == 0u && varying.maxSteps <= 3u;
+	allMatch = allMatch && stepMatch;
+	output << std::format("Frames of 2 to 40 ms: {} frames, {} steps, at most {} a frame, drawn time within {:.6f} ms of the clock",
+		varying.stats.frames, varying.stats.steps, varying.maxSteps, varying.worstTimeError) << std::endl;
+	output << std::format("Frames of 7 ms: {} frames, {} steps, drawn time within {:.6f} ms; same state after {} steps: {}",
+		steady.stats.frames, steady.stats.steps, steady.worstTimeError, DETERMINISM_STEP, stepMatch ? "OK" : "MISMATCH") << std::endl;
+
+	// Frames slower than the most steps a frame runs drop the rest of their time.
+	StepRun slow = RunSteps(250.0, 250.0);
+	FrameLoop::Desc defaults;
+	bool slowMatch = slow.match && slow.maxSteps == defaults.maxStepsPerFrame && slow.stats.droppedSteps > 0u;
+	allMatch = allMatch && slowMatch;
+	output << std::format("Frames of 250 ms: at most {} steps a frame, {} steps dropped: {}", slow.maxSteps, slow.stats.droppedSteps,
+		slowMatch ? "OK" : "MISMATCH") << std::endl;
+
+	// The limiter on a fine timer, a 15.6 ms one and with frames longer than its period.
+	const double period = 1000.0 / FRAME_RATE_LIMIT;
+	const uint frames = (uint)(SIMULATED_SECONDS * FRAME_RATE_LIMIT);
+	output << std::format("Limited to {:.0f} frames per second, {:.3f} ms, for {} frames:", FRAME_RATE_LIMIT, period, frames) << std::endl;
+	struct Limit
+	{
+		const char* name;
+		uint64_t timerTick;
+		uint64_t sleepJitter;
+		double workMilliseconds;
+	};
+	const Limit limits[] =
+	{
+		{ "Fine timer, 3 ms frames", 0u, 200000u, 3.0 },
+		{ "15.6 ms timer, 3 ms frames", COARSE_TIMER_NANOSECONDS, 0u, 3.0 },
+		{ "Fine timer, 10 ms frames", 0u, 200000u, 10.0 },
+	};
+	for (const Limit& limit : limits)
+	{
+		SimulatedClock clock(limit.timerTick, limit.sleepJitter);
+		std::mt19937 random(RANDOM_SEED);
+		std::uniform_real_distribution<double> work(limit.workMilliseconds * 0.9, limit.workMilliseconds * 1.1);
+		LimitRun run = RunLimited(clock, FRAME_RATE_LIMIT, frames, [&]() { clock.Advance((uint64_t)(work(random) * 1e6)); });
+
+		// Frames within the period keep to it, sleeping on a fine timer; longer ones run back to back without waiting.
+		bool match = run.frameTimeCount == frames - 1u;
+		if (limit.workMilliseconds * 1.1 < period)
+		{
+			match = match && fabs(run.averageMilliseconds - period) < period * RATE_TOLERANCE && run.waitErrorMilliseconds <= WAIT_ERROR_LIMIT_MILLISECONDS;
+			match = match && run.stats.lateFrames <= (limit.timerTick > 0u ? 2u : 0u);
+			if (limit.timerTick == 0u)
+				match = match && run.stats.sleepMilliseconds > run.stats.spinMilliseconds;
+		}
+		else
+		{
+			match = match && run.stats.lateFrames == frames && run.stats.sleepMilliseconds + run.stats.spinMilliseconds == 0.0 &&
+				fabs(run.averageMilliseconds - limit.workMilliseconds) < limit.workMilliseconds * 0.02;
+		}
+		allMatch = allMatch && match;
+		WriteLimitRun(output, limit.name, run, match);
+	}
+
+	// The real clock, where the OS decides how late sleeps return.
+	SystemClock systemClock;
+	auto spin = [&]()
+	{
+		auto start = std::chrono::steady_clock::now();
+		while (std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count() < REAL_WORK_MILLISECONDS)
+		{
+		}
+	};
+	LimitRun real = RunLimited(systemClock, REAL_RATE_LIMIT, REAL_FRAMES, spin);
+	double realPeriod = 1000.0 / REAL_RATE_LIMIT;
+	bool realMatch = fabs(real.averageMilliseconds - realPeriod) < realPeriod * REAL_RATE_TOLERANCE;
+	allMatch = allMatch && realMatch;
+	WriteLimitRun(output, std::format("System clock, {:.0f} per second", REAL_RATE_LIMIT).c_str(), real, realMatch);
+
+	return allMatch;
+}
@@ -0,0 +1,13 @@
+#pragma once
+
+#include <ostream>
+#include "Common.h"
+
+// Runs FrameLoop on a simulated clock, where frames take exactly as long as they are given and sleeps return late by
+// a chosen amount, then briefly on the real one. Checks that the steps run cover the time passed, that a frame's time
+// plus its interpolation tracks the clock, that a simulation reaches the same state after the same steps whatever the
+// frame times, that slow frames run no more than the most steps a frame allows, and that the limiter holds the frame
+// rate with both a fine and a 15.6 ms sleep timer, without missing deadlines once it has measured the timer. Reports
+// the frame time percentiles and how much of the waiting was slept rather than spun.
+// Run with "Engine.exe -benchmark-frame-loop". Returns false if any check fails.
+bool RunFrameLoopBenchmark(std::ostream& output);
@@ -0,0 +1,53 @@
+#include "Frustum.h"
+
+#include <algorithm>
+#include <math.h>
+
+Frustum::Frustum(const Math::Matrix4& viewProjection)
+{
+	const auto& m = viewProjection.m;
+
+	// A row vector p lands at clip = p * M, so each clip coordinate is p dotted with a column of M. The frustum is
+	// -w <= x <= w, -w <= y <= w and 0 <= z <= w, which gives one plane per inequality.
+	Math::Float4 x(m[0][0], m[1][0], m[2][0], m[3][0]);
+	Math::Float4 y(m[0][1], m[1][1], m[2][1], m[3][1]);
+	Math::Float4 z(m[0][2], m[1][2], m[2][2], m[3][2]);
+	Math::Float4 w(m[0][3], m[1][3], m[2][3], m[3][3]);
+
+	auto add = [](const Math::Float4& a, const Math::Float4& b) { return Math::Float4(a.x + b.x, a.y + b.y, a.z + b.z, a.w + b.w); };
+	auto subtract = [](const Math::Float4& a, const Math::Float4& b) { return Math::Float4(a.x - b.x, a.y - b.y, a.z - b.z, a.w - b.w); };
+
+	_planes[LEFT] = add(w, x);
+	_planes[RIGHT] = subtract(w, x);
+	_planes[BOTTOM] = add(w, y);
+	_planes[TOP] = subtract(w, y);
+	_planes[NEAR_PLANE] = z;
+	_planes[FAR_PLANE] = subtract(w, z);
+
+	// Normalize so distances are in world units and can be compared against radii and extents.
+	for (Math::Float4& plane : _planes)
+	{
+		float length = sqrtf(plane.x * plane.x + plane.y * plane.y + plane.z * plane.z);
+		if (length > 0.0f)
+			plane = Math::Float4(plane.x / length, plane.y / length, plane.z / length, plane.w / length);
+	}
+}
+
+const Math::Float4& Frustum::GetPlane(uint plane) const
+{
+	return _planes[plane];
+}
+
+bool Frustum::Intersects(const Bounds& bounds) const
+{
+	for (const Math::Float4& plane : _planes)
+	{
+		// The box reaches towards the plane by its extents projected onto the normal, the sphere by its radius.
+		// Whichever reaches less is still a valid bound, since the object lies inside both.
+		float distance = plane.x * bounds.center.x + plane.y * bounds.center.y + plane.z * bounds.center.z + plane.w;
+		float boxReach = fabsf(plane.x) * bounds.extents.x + fabsf(plane.y) * bounds.extents.y + fabsf(plane.z) * bounds.extents.z;
+		if (distance + std::min(boxReach, bounds.radius) < 0.0f)
+			return false;
+	}
+	return true;
+}
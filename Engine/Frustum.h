@@ -0,0 +1,37 @@
+#pragma once
+
+#include "Bounds.h"
+#include "Common.h"
+#include "EngineMath.h"
+
+// The six planes of a view frustum, extracted from a combined view and projection matrix. Planes are normalized and
+// face inwards, so a point is inside when its distance to every plane is non-negative.
+class Frustum
+{
+public:
+
+	enum Plane
+	{
+		LEFT,
+		RIGHT,
+		BOTTOM,
+		TOP,
+		NEAR_PLANE,
+		FAR_PLANE,
+		PLANE_COUNT
+	};
+
+	// viewProjection maps row vectors to clip space with Direct3D's 0 to 1 depth range, as Camera::GetViewMatrix
+	// multiplied by RenderBackend::GetProjectionMatrix does.
+	explicit Frustum(const Math::Matrix4& viewProjection);
+
+	// The plane as (normal, distance): a point p is inside when dot(normal, p) + distance >= 0.
+	const Math::Float4& GetPlane(uint plane) const;
+
+	// False only if the bounds are certainly outside.
+	bool Intersects(const Bounds& bounds) const;
+
+private:
+
+	Math::Float4 _planes[PLANE_COUNT];
+};
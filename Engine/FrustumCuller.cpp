@@ -0,0 +1,277 @@
+#include "FrustumCuller.h"
+#include "CpuFeatures.h"
+#include "JobSystem.h"
+
+#include <algorithm>
+#include <chrono>
+#include <math.h>
+#include <string.h>
+
+#if defined(CPU_X86)
+#include <immintrin.h>
+#endif
+
+namespace
+{
+	// Bounds are handed to threads in batches of this size, a multiple of every kernel's width; smaller sets are culled on one thread.
+	const uint BOUNDS_PER_TASK = 16384u;
+
+	struct PackedBounds
+	{
+		const float* centerX;
+		const float* centerY;
+		const float* centerZ;
+		const float* extentX;
+		const float* extentY;
+		const float* extentZ;
+		const float* radius;
+	};
+
+	// Writes the indices of the visible bounds in [begin, end) to visible and returns how many there are.
+	// begin is a multiple of the kernel's width; the arrays are padded so whole packets can be read past end.
+	using CullKernel = uint (*)(const PackedBounds& bounds, const Frustum& frustum, uint begin, uint end, uint* visible);
+
+	uint CullBoundsScalar(const PackedBounds& bounds, const Frustum& frustum, uint begin, uint end, uint* visible)
+	{
+		uint visibleCount = 0u;
+		for (uint i = begin; i < end; ++i)
+		{
+			Bounds single;
+			single.center = Math::Float3(bounds.centerX[i], bounds.centerY[i], bounds.centerZ[i]);
+			single.extents = Math::Float3(bounds.extentX[i], bounds.extentY[i], bounds.extentZ[i]);
+			single.radius = bounds.radius[i];
+			if (frustum.Intersects(single))
+				visible[visibleCount++] = i;
+		}
+		return visibleCount;
+	}
+
+#if defined(CPU_X86)
+	// Appends the lanes set in mask, skipping padding past end.
+	inline uint AppendVisible(uint mask, uint first, uint end, uint* visible, uint visibleCount)
+	{
+		while (mask != 0u)
+		{
+			uint lane = 0u;
+			while ((mask & (1u << lane)) == 0u)
+				lane++;
+			mask &= mask - 1u;
+
+			if (first + lane < end)
+				visible[visibleCount++] = first + lane;
+		}
+		return visibleCount;
+	}
+
+	// SSE2 is part of x64, so this kernel needs no target tag.
+	uint CullBoundsSse2(const PackedBounds& bounds, const Frustum& frustum, uint begin, uint end, uint* visible)
+	{
+		const __m128 signMask = _mm_set1_ps(-0.0f);
+		const __m128 zero = _mm_setzero_ps();
+
+		uint visibleCount = 0u;
+		for (uint i = begin; i < end; i += 4u)
+		{
+			__m128 centerX = _mm_loadu_ps(bounds.centerX + i);
+			__m128 centerY = _mm_loadu_ps(bounds.centerY + i);
+			__m128 centerZ = _mm_loadu_ps(bounds.centerZ + i);
+			__m128 extentX = _mm_loadu_ps(bounds.extentX + i);
+			__m128 extentY = _mm_loadu_ps(bounds.extentY + i);
+			__m128 extentZ = _mm_loadu_ps(bounds.extentZ + i);
+			__m128 radius = _mm_loadu_ps(bounds.radius + i);
+
+			// A bound is outside once it is fully behind any plane. The sums are ordered as in Frustum::Intersects, without
+			// fused multiply-adds, so every kernel agrees with the scalar reference to the bit.
+			__m128 outside = _mm_setzero_ps();
+			for (uint p = 0u; p < Frustum::PLANE_COUNT; ++p)
+			{
+				const Math::Float4& plane = frustum.GetPlane(p);
+				__m128 normalX = _mm_set1_ps(plane.x);
+				__m128 normalY = _mm_set1_ps(plane.y);
+				__m128 normalZ = _mm_set1_ps(plane.z);
+
+				__m128 distance = _mm_add_ps(_mm_add_ps(_mm_add_ps(_mm_mul_ps(normalX, centerX), _mm_mul_ps(normalY, centerY)),
+					_mm_mul_ps(normalZ, centerZ)), _mm_set1_ps(plane.w));
+				__m128 boxReach = _mm_add_ps(_mm_add_ps(_mm_mul_ps(_mm_andnot_ps(signMask, normalX), extentX),
+					_mm_mul_ps(_mm_andnot_ps(signMask, normalY), extentY)), _mm_mul_ps(_mm_andnot_ps(signMask, normalZ), extentZ));
+
+				__m128 reach = _mm_min_ps(boxReach, radius);
+				outside = _mm_or_ps(outside, _mm_cmplt_ps(_mm_add_ps(distance, reach), zero));
+			}
+
+			uint mask = ~(uint)_mm_movemask_ps(outside) & 0xFu;
+			visibleCount = AppendVisible(mask, i, end, visible, visibleCount);
+		}
+		return visibleCount;
+	}
+
+	TARGET_AVX2 uint CullBoundsAvx2(const PackedBounds& bounds, const Frustum& frustum, uint begin, uint end, uint* visible)
+	{
+		const __m256 signMask = _mm256_set1_ps(-0.0f);
+		const __m256 zero = _mm256_setzero_ps();
+
+		uint visibleCount = 0u;
+		for (uint i = begin; i < end; i += 8u)
+		{
+			__m256 centerX = _mm256_loadu_ps(bounds.centerX + i);
+			__m256 centerY = _mm256_loadu_ps(bounds.centerY + i);
+			__m256 centerZ = _mm256_loadu_ps(bounds.centerZ + i);
+			__m256 extentX = _mm256_loadu_ps(bounds.extentX + i);
+			__m256 extentY = _mm256_loadu_ps(bounds.extentY + i);
+			__m256 extentZ = _mm256_loadu_ps(bounds.extentZ + i);
+			__m256 radius = _mm256_loadu_ps(bounds.radius + i);
+
+			__m256 outside = _mm256_setzero_ps();
+			for (uint p = 0u; p < Frustum::PLANE_COUNT; ++p)
+			{
+				const Math::Float4& plane = frustum.GetPlane(p);
+				__m256 normalX = _mm256_set1_ps(plane.x);
+				__m256 normalY = _mm256_set1_ps(plane.y);
+				__m256 normalZ = _mm256_set1_ps(plane.z);
+
+				__m256 distance = _mm256_add_ps(_mm256_add_ps(_mm256_add_ps(_mm256_mul_ps(normalX, centerX), _mm256_mul_ps(normalY, centerY)),
+					_mm256_mul_ps(normalZ, centerZ)), _mm256_set1_ps(plane.w));
+				__m256 boxReach = _mm256_add_ps(_mm256_add_ps(_mm256_mul_ps(_mm256_andnot_ps(signMask, normalX), extentX),
+					_mm256_mul_ps(_mm256_andnot_ps(signMask, normalY), extentY)), _mm256_mul_ps(_mm256_andnot_ps(signMask, normalZ), extentZ));
+
+				__m256 reach = _mm256_min_ps(boxReach, radius);
+				outside = _mm256_or_ps(outside, _mm256_cmp_ps(_mm256_add_ps(distance, reach), zero, _CMP_LT_OQ));
+			}
+
+			uint mask = ~(uint)_mm256_movemask_ps(outside) & 0xFFu;
+			visibleCount = AppendVisible(mask, i, end, visible, visibleCount);
+		}
+		return visibleCount;
+	}
+#endif
+
+	struct Kernels
+	{
+		CullKernel cull;
+		const char* name;
+	};
+
+	const Kernels& GetKernels()
+	{
+		static const Kernels kernels = []
+		{
+#if defined(CPU_X86)
+			const CpuFeatures& features = CpuFeatures::Get();
+			if (features.avx2)
+				return Kernels{ CullBoundsAvx2, "avx2" };
+			if (features.sse2)
+				return Kernels{ CullBoundsSse2, "sse2" };
+#endif
+			return Kernels{ CullBoundsScalar, "scalar" };
+		}();
+		return kernels;
+	}
+}
+
+void FrustumCuller::Clear()
+{
+	_centerX.clear();
+	_centerY.clear();
+	_centerZ.clear();
+	_extentX.clear();
+	_extentY.clear();
+	_extentZ.clear();
+	_radius.clear();
+	_count = 0u;
+}
+
+void FrustumCuller::Reserve(uint count)
+{
+	size_t padded = (count + PACKET_SIZE - 1u) / PACKET_SIZE * PACKET_SIZE;
+	for (std::vector<float>* component : { &_centerX, &_centerY, &_centerZ, &_extentX, &_extentY, &_extentZ, &_radius })
+		component->reserve(padded);
+}
+
+uint FrustumCuller::Add(const Bounds& bounds)
+{
+	// Grow by a whole packet at a time, so the kernels can always read full packets.
+	if (_count % PACKET_SIZE == 0u)
+	{
+		for (std::vector<float>* component : { &_centerX, &_centerY, &_centerZ, &_extentX, &_extentY, &_extentZ, &_radius })
+			component->resize(_count + PACKET_SIZE, 0.0f);
+	}
+
+	uint index = _count++;
+	Set(index, bounds);
+	return index;
+}
+
+void FrustumCuller::Set(uint index, const Bounds& bounds)
+{
+	_centerX[index] = bounds.center.x;
+	_centerY[index] = bounds.center.y;
+	_centerZ[index] = bounds.center.z;
+	_extentX[index] = bounds.extents.x;
+	_extentY[index] = bounds.extents.y;
+	_extentZ[index] = bounds.extents.z;
+	_radius[index] = bounds.radius;
+}
+
+uint FrustumCuller::GetCount() const
+{
+	return _count;
+}
+
+void FrustumCuller::Cull(const Frustum& frustum, std::vector<uint>& visible, uint threadCount)
+{
+	auto start = std::chrono::steady_clock::now();
+
+	PackedBounds bounds{ _centerX.data(), _centerY.data(), _centerZ.data(), _extentX.data(), _extentY.data(), _extentZ.data(), _radius.data() };
+	CullKernel cull = GetKernels().cull;
+
+	if (threadCount == 0u)
+		threadCount = JobSystem::GetDefault().GetThreadCount();
+
+	// Every task writes its visible indices at the start of its own range, and the ranges are closed up afterwards.
+	visible.resize(_count);
+	uint taskCount = (_count + BOUNDS_PER_TASK - 1u) / BOUNDS_PER_TASK;
+	std::vector<uint> taskVisible(taskCount);
+	JobSystem::GetDefault().ParallelFor(taskCount, threadCount, [&](uint task)
+	{
+		uint begin = task * BOUNDS_PER_TASK;
+		uint end = std::min(_count, begin + BOUNDS_PER_TASK);
+		taskVisible[task] = cull(bounds, frustum, begin, end, visible.data() + begin);
+	});
+
+	uint visibleCount = 0u;
+	for (uint task = 0u; task < taskCount; ++task)
+	{
+		uint* taskStart = visible.data() + task * BOUNDS_PER_TASK;
+		if (taskStart != visible.data() + visibleCount)
+			memmove(visible.data() + visibleCount, taskStart, taskVisible[task] * sizeof(uint));
+		visibleCount += taskVisible[task];
+	}
+	visible.resize(visibleCount);
+
+	_stats.tested = _count;
+	_stats.visible = visibleCount;
+	_stats.cullMilliseconds = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+}
+
+void FrustumCuller::CullScalar(const Frustum& frustum, std::vector<uint>& visible)
+{
+	auto start = std::chrono::steady_clock::now();
+
+	PackedBounds bounds{ _centerX.data(), _centerY.data(), _centerZ.data(), _extentX.data(), _extentY.data(), _extentZ.data(), _radius.data() };
+	visible.resize(_count);
+	visible.resize(CullBoundsScalar(bounds, frustum, 0u, _count, visible.data()));
+
+	_stats.tested = _count;
+	_stats.visible = (uint)visible.size();
+	_stats.cullMilliseconds = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+}
+
+const FrustumCuller::Stats& FrustumCuller::GetStats() const
+{
+	return _stats;
+}
+
+const char* FrustumCuller::GetKernelName()
+{
+	return GetKernels().name;
+}
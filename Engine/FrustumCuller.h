@@ -0,0 +1,56 @@
+#pragma once
+
+#include "Bounds.h"
+#include "Common.h"
+#include "Frustum.h"
+
+// Culls many bounds against a frustum at once. The bounds are packed as structure of arrays (centre, extents and
+// radius components in separate arrays, padded to a multiple of 8) so the kernel tests 4 bounds per SSE instruction
+// or 8 per AVX2 instruction against each plane, picked at runtime from CpuFeatures. Large sets are split between
+// threads.
+//
+// The culler has no Direct3D dependency.
+class FrustumCuller
+{
+public:
+
+	struct Stats
+	{
+		uint tested = 0u;
+		uint visible = 0u;
+		double cullMilliseconds = 0.0;
+	};
+
+	void Clear();
+	void Reserve(uint count);
+
+	// Adds bounds and returns their index, which Cull reports for the visible ones.
+	uint Add(const Bounds& bounds);
+	void Set(uint index, const Bounds& bounds);
+	uint GetCount() const;
+
+	// Fills visible with the indices of the bounds that intersect the frustum, in increasing order.
+	// threadCount 0 uses every thread of the job system.
+	void Cull(const Frustum& frustum, std::vector<uint>& visible, uint threadCount = 0u);
+
+	// Scalar reference of Cull on one thread, used when the vector paths are unavailable and for comparing results.
+	void CullScalar(const Frustum& frustum, std::vector<uint>& visible);
+
+	// Counts for the last Cull.
+	const Stats& GetStats() const;
+
+	// Name of the instruction set the dispatched kernel uses ("avx2", "sse2" or "scalar").
+	static const char* GetKernelName();
+
+private:
+
+	// Lanes every array is padded to, the width of the widest kernel.
+	static const uint PACKET_SIZE = 8u;
+
+	std::vector<float> _centerX, _centerY, _centerZ;
+	std::vector<float> _extentX, _extentY, _extentZ;
+	std::vector<float> _radius;
+	uint _count = 0u;
+
+	Stats _stats;
+};
@@ -0,0 +1,228 @@
+#include "GpuProfiler.h"
+
+GpuProfiler::GpuProfiler(GpuTimer* timer, uint frameCount, Clock* clock)
+	: _timer(timer)
+	, _clock(clock)
+	, _frames(frameCount)
+{
+	if (!_timer)
+		return;
+
+	// One disjoint query per frame of the ring, the frames' timestamps, and the calibration timestamp after them.
+	_timer->CreateQueries(frameCount, frameCount * TIMESTAMPS_PER_FRAME + 1u);
+	_track = Profiler::Get().AddTrack("GPU");
+}
+
+void GpuProfiler::BeginFrame()
+{
+	// A frame left open ends here.
+	EndFrame();
+
+	if (_timer)
+		Resolve();
+
+	uint64_t number = _frameNumber++;
+	if (!_timer)
+		return;
+
+	// Calibrate once the GPU has run every frame in flight, so the calibration timestamp is not queued behind them.
+	if (_calibration == Calibration::Due)
+	{
+		for (const Frame& frame : _frames)
+		{
+			if (frame.pending)
+			{
+				_stats.skipped++;
+				return;
+			}
+		}
+
+		_timer->Timestamp((uint)_frames.size() * TIMESTAMPS_PER_FRAME);
+		_timer->Flush();
+		_calibrationCpuTicks = GetCpuTicks();
+		_calibration = Calibration::Pending;
+	}
+
+	// Skip the frame rather than reuse queries whose results have not been read.
+	uint slot = (uint)(number % _frames.size());
+	Frame& frame = _frames[slot];
+	if (frame.pending)
+	{
+		_stats.skipped++;
+		return;
+	}
+
+	frame.number = number;
+	frame.pending = true;
+	frame.timestampCount = 0u;
+	frame.scopes.clear();
+	_timer->BeginDisjoint(slot);
+	IssueTimestamp(frame, slot);
+	_timing = true;
+	_openScopes = 0u;
+}
+
+uint GpuProfiler::BeginScope(const char* name)
+{
+	if (!_timing)
+		return INVALID;
+
+	uint slot = (uint)((_frameNumber - 1u) % _frames.size());
+	Frame& frame = _frames[slot];
+	if (frame.scopes.size() == MAX_SCOPES)
+	{
+		_stats.droppedScopes++;
+		return INVALID;
+	}
+
+	// The frame is at depth 0, so its scopes start at 1.
+	Scope scope;
+	scope.name = name;
+	scope.depth = ++_openScopes;
+	scope.beginQuery = IssueTimestamp(frame, slot);
+	scope.endQuery = INVALID;
+	frame.scopes.push_back(scope);
+	return (uint)frame.scopes.size() - 1u;
+}
+
+void GpuProfiler::EndScope(uint scope)
+{
+	if (!_timing || scope == INVALID)
+		return;
+
+	uint slot = (uint)((_frameNumber - 1u) % _frames.size());
+	Frame& frame = _frames[slot];
+	if (frame.scopes[scope].endQuery != INVALID)
+		return;
+
+	frame.scopes[scope].endQuery = IssueTimestamp(frame, slot);
+	_openScopes--;
+}
+
+void GpuProfiler::EndFrame()
+{
+	if (!_timing)
+		return;
+
+	// Close what is still open, innermost first.
+	uint slot = (uint)((_frameNumber - 1u) % _frames.size());
+	Frame& frame = _frames[slot];
+	for (uint scope = (uint)frame.scopes.size(); scope-- > 0u; )
+		EndScope(scope);
+
+	frame.endQuery = IssueTimestamp(frame, slot);
+	_timer->EndDisjoint(slot);
+	_timing = false;
+}
+
+uint GpuProfiler::IssueTimestamp(Frame& frame, uint slot)
+{
+	uint query = frame.timestampCount++;
+	_timer->Timestamp(slot * TIMESTAMPS_PER_FRAME + query);
+	return query;
+}
+
+uint64_t GpuProfiler::GetCpuTicks() const
+{
+	return _clock ? _clock->GetTicks() : Profiler::GetTicks();
+}
+
+double GpuProfiler::GetCpuTicksPerNanosecond() const
+{
+	return _clock ? _clock->GetTicksPerNanosecond() : Profiler::Get().GetTicksPerNanosecond();
+}
+
+void GpuProfiler::Resolve()
+{
+	// Frames issued after the calibration need its result first.
+	if (_calibration == Calibration::Pending)
+	{
+		if (!_timer->GetTimestamp((uint)_frames.size() * TIMESTAMPS_PER_FRAME, _calibrationGpuTicks))
+			return;
+		_calibration = Calibration::Done;
+		_stats.calibrations++;
+	}
+
+	// Read the frames in the order they were issued, up to the first the GPU has not finished.
+	for (;;)
+	{
+		Frame* oldest = nullptr;
+		uint oldestSlot = 0u;
+		for (uint slot = 0u; slot < (uint)_frames.size(); ++slot)
+		{
+			if (_frames[slot].pending && (!oldest || _frames[slot].number < oldest->number))
+			{
+				oldest = &_frames[slot];
+				oldestSlot = slot;
+			}
+		}
+
+		if (!oldest || !ResolveFrame(*oldest, oldestSlot))
+			return;
+	}
+}
+
+bool GpuProfiler::ResolveFrame(Frame& frame, uint slot)
+{
+	GpuTimer::Disjoint disjoint;
+	if (!_timer->GetDisjoint(slot, disjoint))
+		return false;
+
+	_ticks.resize(frame.timestampCount);
+	for (uint query = 0u; query < frame.timestampCount; ++query)
+	{
+		if (!_timer->GetTimestamp(slot * TIMESTAMPS_PER_FRAME + query, _ticks[query]))
+			return false;
+	}
+	frame.pending = false;
+
+	// The clock changed speed during the frame; the calibration may no longer hold either.
+	if (disjoint.disjoint || disjoint.frequency == 0u)
+	{
+		_stats.disjoint++;
+		_calibration = Calibration::Due;
+		return true;
+	}
+
+	// GPU ticks count from the calibration timestamp, at the frequency of the frame, into CPU ticks.
+	double cpuTicksPerGpuTick = GetCpuTicksPerNanosecond() * 1e9 / (double)disjoint.frequency;
+	auto toCpuTicks = [&](uint64_t gpuTicks)
+	{
+		return _calibrationCpuTicks + (uint64_t)(int64_t)((double)(int64_t)(gpuTicks - _calibrationGpuTicks) * cpuTicksPerGpuTick);
+	};
+
+	Profiler& profiler = Profiler::Get();
+	_lastFrame.clear();
+	_lastFrame.push_back({ "GPU frame", 0u, toCpuTicks(_ticks[0]), toCpuTicks(_ticks[frame.endQuery]) });
+	for (const Scope& scope : frame.scopes)
+		_lastFrame.push_back({ scope.name, scope.depth, toCpuTicks(_ticks[scope.beginQuery]), toCpuTicks(_ticks[scope.endQuery]) });
+	for (const Timing& timing : _lastFrame)
+		profiler.Record(_track, timing.name, timing.start, timing.end, timing.depth);
+	if (_frameCallback)
+		_frameCallback(frame.number, _lastFrame);
+
+	_lastFrameNumber = frame.number;
+	_stats.resolved++;
+	_stats.latency = (uint)(_frameNumber - frame.number);
+	return true;
+}
+
+uint64_t GpuProfiler::GetLastFrameNumber() const
+{
+	return _lastFrameNumber;
+}
+
+const std::vector<GpuProfiler::Timing>& GpuProfiler::GetLastFrame() const
+{
+	return _lastFrame;
+}
+
+void GpuProfiler::SetFrameCallback(FrameCallback callback)
+{
+	_frameCallback = std::move(callback);
+}
+
+const GpuProfiler::Stats& GpuProfiler::GetStats() const
+{
+	return _stats;
+}
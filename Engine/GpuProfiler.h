@@ -0,0 +1,169 @@
+#pragma once
+
+#include <functional>
+
+#include "Common.h"
+#include "GpuTimer.h"
+#include "Profiler.h"
+
+// Times the GPU's work in scopes with timestamp queries and adds the scopes to the "GPU" track of the Profiler, in
+// its CPU time, so a trace shows each frame's GPU work against the CPU work that submitted it.
+//
+// - Every frame gets its own set of queries, in a ring of frames. BeginFrame reads the results of the frames the GPU
+//   has finished, oldest first, and stops at the first that is not ready, so reading never waits on the GPU. A frame
+//   whose set is still in use when the ring comes round to it is not timed.
+// - A disjoint query around each frame gives the timestamp frequency. Frames where it changed are thrown away.
+// - GPU timestamps are moved to CPU time by a calibration: a timestamp issued and flushed while the GPU is idle is
+//   paired with the CPU time it was flushed at. It is made before the first frame, and again after a disjoint frame,
+//   once the frames in flight have been read; frames are not timed meanwhile.
+//
+// Everything is a no-op without a timer. Call from the thread that owns the device context.
+class GpuProfiler
+{
+public:
+
+	// The CPU clock GPU time is moved onto: Profiler::GetTicks at the profiler's measured rate unless another is given,
+	// so a simulated clock can stand in for it, as FrameClock does for FrameLoop.
+	class Clock
+	{
+	public:
+
+		virtual ~Clock() = default;
+
+		virtual uint64_t GetTicks() = 0;
+		virtual double GetTicksPerNanosecond() = 0;
+	};
+
+	static const uint INVALID = ~0u;
+	static const uint DEFAULT_FRAME_COUNT = 5u;	// Direct3D queues up to three frames, so five are read long before reuse.
+	static const uint MAX_SCOPES = 32u;			// Per frame; scopes past it are not timed.
+
+	// A scope of a resolved frame, in ticks of Profiler::GetTicks. The frame itself comes first, at depth 0.
+	struct Timing
+	{
+		const char* name;
+		uint depth;
+		uint64_t start;
+		uint64_t end;
+	};
+
+	struct Stats
+	{
+		uint64_t resolved = 0u;		// Frames read and added to the profiler.
+		uint64_t skipped = 0u;		// Frames not timed: the ring was full, or a calibration was due.
+		uint64_t disjoint = 0u;		// Frames thrown away.
+		uint64_t calibrations = 0u;
+		uint64_t droppedScopes = 0u;	// Scopes past MAX_SCOPES.
+		uint latency = 0u;			// Frames between issuing the last resolved frame and reading it.
+	};
+
+	// Called for every frame read, oldest first, with the frame's number and its scopes.
+	using FrameCallback = std::function<void(uint64_t frameNumber, const std::vector<Timing>& timings)>;
+
+	// frameCount frames of queries are in flight at most. The clock, if given, must outlive the profiler.
+	explicit GpuProfiler(GpuTimer* timer, uint frameCount = DEFAULT_FRAME_COUNT, Clock* clock = nullptr);
+
+	GpuProfiler(const GpuProfiler&) = delete;
+	GpuProfiler& operator=(const GpuProfiler&) = delete;
+
+	// Reads the frames the GPU has finished and starts timing a new one. Call before the frame's first command.
+	void BeginFrame();
+
+	// Starts a scope enclosed by the scopes open now. Returns INVALID when it is not timed.
+	uint BeginScope(const char* name);
+	void EndScope(uint scope);
+
+	// Stops timing the frame, ending any scope left open. Call after the frame's last command, before Present.
+	void EndFrame();
+
+	// The last frame read, numbered from 0 by BeginFrame, and its scopes; UINT64_MAX and empty before the first.
+	// BeginFrame may read several frames at once; SetFrameCallback sees each of them.
+	uint64_t GetLastFrameNumber() const;
+	const std::vector<Timing>& GetLastFrame() const;
+
+	void SetFrameCallback(FrameCallback callback);
+
+	const Stats& GetStats() const;
+
+private:
+
+	struct Scope
+	{
+		const char* name;
+		uint depth;
+		uint beginQuery;
+		uint endQuery;
+	};
+
+	// The queries of one frame: the disjoint query of its slot and TIMESTAMPS_PER_FRAME timestamps from its slot's first.
+	struct Frame
+	{
+		uint64_t number = 0u;
+		bool pending = false;	// Issued and not read yet.
+		uint timestampCount = 0u;
+		uint endQuery = 0u;		// Of the frame's end; its start is the first.
+		std::vector<Scope> scopes;
+	};
+
+	// The frame's start and end, and the start and end of every scope.
+	static const uint TIMESTAMPS_PER_FRAME = 2u + 2u * MAX_SCOPES;
+
+	void Resolve();
+	bool ResolveFrame(Frame& frame, uint slot);
+	uint IssueTimestamp(Frame& frame, uint slot);
+	uint64_t GetCpuTicks() const;
+	double GetCpuTicksPerNanosecond() const;
+
+	GpuTimer* _timer;
+	Clock* _clock;
+	FrameCallback _frameCallback;
+	std::vector<Frame> _frames;
+	uint _track = 0u;
+	uint64_t _frameNumber = 0u;	// Of the next BeginFrame.
+	bool _timing = false;			// Between BeginFrame and EndFrame of a frame being timed.
+	uint _openScopes = 0u;
+
+	// The calibration query is the last timestamp query, after the frames'.
+	enum class Calibration
+	{
+		Due,		// Made once no frame is in flight.
+		Pending,	// Issued, waiting for its result.
+		Done
+	};
+	Calibration _calibration = Calibration::Due;
+	uint64_t _calibrationCpuTicks = 0u;
+	uint64_t _calibrationGpuTicks = 0u;
+	std::vector<uint64_t> _ticks;	// Scratch space of ResolveFrame.
+
+	uint64_t _lastFrameNumber = UINT64_MAX;
+	std::vector<Timing> _lastFrame;
+	Stats _stats;
+};
+
+// Times the GPU commands issued from its construction to its destruction.
+class GpuProfileScope
+{
+public:
+
+	GpuProfileScope(GpuProfiler& profiler, const char* name)
+		: _profiler(profiler)
+		, _scope(profiler.BeginScope(name))
+	{
+	}
+
+	~GpuProfileScope()
+	{
+		_profiler.EndScope(_scope);
+	}
+
+	GpuProfileScope(const GpuProfileScope&) = delete;
+	GpuProfileScope& operator=(const GpuProfileScope&) = delete;
+
+private:
+
+	GpuProfiler& _profiler;
+	uint _scope;
+};
+
+// Times the GPU commands issued in the rest of the enclosing block under name, a string literal.
+#define PROFILE_GPU_SCOPE(profiler, name) GpuProfileScope PROFILE_CONCATENATE(gpuProfileScope, __LINE__)(profiler, name)
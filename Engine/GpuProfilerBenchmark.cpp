@@ -0,0 +1,375 @@
+#include "GpuProfilerBenchmark.h"
+#include "GpuProfiler.h"
+#include "Profiler.h"
+
+#include <chrono>
+#include <cmath>
+
+namespace
+{
+	const uint64_t GPU_FREQUENCY = 25000000u;		// Unlike the CPU's counter, as on real GPUs.
+	const uint64_t GPU_ORIGIN = 123456789000u;
+	const uint64_t CLOCK_JUMP = GPU_FREQUENCY;		// A second, after the disjoint frame.
+	const uint QUEUED_FRAMES = 3u;					// Frames Present lets the CPU get ahead of the GPU.
+	const uint FRAMES = 200u;
+	const double CLEAR_MICROSECONDS = 20.0;
+	const double ALIGNMENT_TOLERANCE_MICROSECONDS = 5.0;
+	const uint64_t CPU_ORIGIN = 1000000000000u;
+	const double CPU_TICKS_PER_NANOSECOND = 3.0;	// A 3 GHz time stamp counter.
+	const uint NO_FRAME = ~0u;
+
+	struct Phase
+	{
+		const char* name;
+		double drawMicroseconds;	// GPU work of each frame's draws.
+		double cpuMicroseconds;		// CPU time of each frame.
+		uint ringFrames;
+		uint disjointFrame;
+	};
+
+	const Phase PHASES[] =
+	{
+		{ "GPU mostly idle", 100.0, 300.0, GpuProfiler::DEFAULT_FRAME_COUNT, NO_FRAME },
+		{ "GPU bound", 600.0, 100.0, GpuProfiler::DEFAULT_FRAME_COUNT, NO_FRAME },
+		{ "GPU bound, 2 frame ring", 600.0, 100.0, 2u, NO_FRAME },
+		{ "Disjoint frame", 100.0, 300.0, GpuProfiler::DEFAULT_FRAME_COUNT, FRAMES / 4u },
+	};
+
+	// The CPU's time stamp counter, which only moves when told to, so the runs do not depend on how the benchmark's
+	// thread is scheduled.
+	class SimulatedClock : public GpuProfiler::Clock
+	{
+	public:
+
+		uint64_t GetTicks() override
+		{
+			return _ticks;
+		}
+
+		double GetTicksPerNanosecond() override
+		{
+			return CPU_TICKS_PER_NANOSECOND;
+		}
+
+		void Advance(uint64_t ticks)
+		{
+			_ticks += ticks;
+		}
+
+		void AdvanceMicroseconds(double microseconds)
+		{
+			_ticks += (uint64_t)(microseconds * CPU_TICKS_PER_NANOSECOND * 1000.0);
+		}
+
+	private:
+
+		uint64_t _ticks = CPU_ORIGIN;
+	};
+
+	// A GPU that runs its commands in order once they are submitted, taking only the time Work gives them. Its clock
+	// is the simulated CPU clock at GPU_FREQUENCY from GPU_ORIGIN, and a result arrives once the CPU's clock has passed
+	// the time the GPU reached its query at. Counts queries issued again before their result was read, and results read
+	// from queries never issued, as errors.
+	class SimulatedGpuTimer : public GpuTimer
+	{
+	public:
+
+		explicit SimulatedGpuTimer(SimulatedClock& clock)
+			: _clock(clock)
+			, _cpuOrigin(clock.GetTicks())
+			, _cpuTicksPerGpuTick(clock.GetTicksPerNanosecond() * 1e9 / GPU_FREQUENCY)
+		{
+		}
+
+		void CreateQueries(uint disjointCount, uint timestampCount) override
+		{
+			_disjointQueries.assign(disjointCount, Query());
+			_timestampQueries.assign(timestampCount, Query());
+		}
+
+		void BeginDisjoint(uint query) override
+		{
+			Issue(_disjointQueries[query]);
+		}
+
+		void EndDisjoint(uint query) override
+		{
+			_disjointQueries[query].gpuTicks = Reach();
+			_disjointQueries[query].disjoint = _markDisjoint;
+
+			// The clock jumps once the disjoint frame is over, so an old calibration would be a second out.
+			if (_markDisjoint)
+			{
+				_gpuOrigin += CLOCK_JUMP;
+				_cursor += CLOCK_JUMP;
+				_markDisjoint = false;
+			}
+		}
+
+		void Timestamp(uint query) override
+		{
+			Query& timestamp = _timestampQueries[query];
+			Issue(timestamp);
+			timestamp.gpuTicks = Reach();
+
+			// The last query is the calibration's, which belongs to no frame.
+			if (query + 1u < (uint)_timestampQueries.size())
+				_frameTruth.push_back(ToCpuTicks(timestamp.gpuTicks));
+		}
+
+		void Flush() override
+		{
+		}
+
+		bool GetDisjoint(uint query, Disjoint& result) override
+		{
+			if (!Read(_disjointQueries[query]))
+				return false;
+			result.frequency = GPU_FREQUENCY;
+			result.disjoint = _disjointQueries[query].disjoint;
+			return true;
+		}
+
+		bool GetTimestamp(uint query, uint64_t& ticks) override
+		{
+			if (!Read(_timestampQueries[query]))
+				return false;
+			ticks = _timestampQueries[query].gpuTicks;
+			return true;
+		}
+
+		// The commands issued since the last query take this long, from the time the GPU reached it.
+		void Work(double microseconds)
+		{
+			_cursor += (uint64_t)(microseconds * GPU_FREQUENCY / 1e6);
+		}
+
+		// The current frame's disjoint query reports its timestamps as disjoint.
+		void MarkDisjoint()
+		{
+			_markDisjoint = true;
+		}
+
+		// Ends a frame, waiting while the GPU is more than QUEUED_FRAMES frames behind.
+		void Present()
+		{
+			_frameEnds.push_back(_cursor);
+			if (_frameEnds.size() > QUEUED_FRAMES)
+			{
+				uint64_t wait = _frameEnds[_frameEnds.size() - 1u - QUEUED_FRAMES];
+				if (Now() < wait)
+					_clock.Advance(ToCpuTicks(wait) - _clock.GetTicks());
+				while (Now() < wait)
+					_clock.Advance(1u);
+			}
+		}
+
+		// CPU times, in simulated clock ticks, the GPU reached the timestamps issued since the last call at.
+		std::vector<uint64_t> TakeFrameTruth()
+		{
+			return std::move(_frameTruth);
+		}
+
+		uint GetErrorCount() const
+		{
+			return _errorCount;
+		}
+
+	private:
+
+		struct Query
+		{
+			bool issued = false;
+			bool read = false;
+			bool disjoint = false;
+			uint64_t gpuTicks = 0u;
+		};
+
+		uint64_t Now() const
+		{
+			return _gpuOrigin + (uint64_t)((_clock.GetTicks() - _cpuOrigin) / _cpuTicksPerGpuTick);
+		}
+
+		uint64_t ToCpuTicks(uint64_t gpuTicks) const
+		{
+			return _cpuOrigin + (uint64_t)((gpuTicks - _gpuOrigin) * _cpuTicksPerGpuTick);
+		}
+
+		// The GPU reaches a command once it has run the ones before it and the command has been submitted.
+		uint64_t Reach()
+		{
+			uint64_t now = Now();
+			if (_cursor < now)
+				_cursor = now;
+			return _cursor;
+		}
+
+		void Issue(Query& query)
+		{
+			if (query.issued && !query.read)
+				_errorCount++;
+			query.issued = true;
+			query.read = false;
+		}
+
+		bool Read(Query& query)
+		{
+			if (!query.issued)
+			{
+				_errorCount++;
+				return false;
+			}
+			if (Now() < query.gpuTicks)
+				return false;
+			query.read = true;
+			return true;
+		}
+
+		SimulatedClock& _clock;
+		uint64_t _cpuOrigin;
+		double _cpuTicksPerGpuTick;
+		uint64_t _gpuOrigin = GPU_ORIGIN;
+		uint64_t _cursor = 0u;	// Time the GPU finishes the commands issued so far.
+		bool _markDisjoint = false;
+		std::vector<Query> _disjointQueries;
+		std::vector<Query> _timestampQueries;
+		std::vector<uint64_t> _frameTruth;
+		std::vector<uint64_t> _frameEnds;
+		uint _errorCount = 0u;
+	};
+
+	double MillisecondsSince(std::chrono::steady_clock::time_point start)
+	{
+		return std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+	}
+
+	double TicksToMicroseconds(double ticks)
+	{
+		return ticks / (CPU_TICKS_PER_NANOSECOND * 1000.0);
+	}
+
+	// Index in stats of the scope named name under the scope named parent, or a root for nullptr; INVALID if none.
+	uint FindScope(const std::vector<Profiler::ScopeStats>& stats, const char* name, const char* parent)
+	{
+		for (uint i = 0u; i < (uint)stats.size(); ++i)
+		{
+			if (stats[i].name != name)
+				continue;
+			if (parent ? stats[i].parent != Profiler::INVALID && stats[stats[i].parent].name == parent : stats[i].parent == Profiler::INVALID)
+				return i;
+		}
+		return Profiler::INVALID;
+	}
+}
+
+bool RunGpuProfilerBenchmark(std::ostream& output)
+{
+	Profiler& profiler = Profiler::Get();
+	bool allMatch = true;
+
+	output << std::format("{} frames per run on a simulated GPU at {} MHz, {} frames queued at most, {:.0f} us of clearing per frame",
+		FRAMES, GPU_FREQUENCY / 1000000u, QUEUED_FRAMES, CLEAR_MICROSECONDS) << std::endl;
+
+	for (const Phase& phase : PHASES)
+	{
+		profiler.Reset();
+		SimulatedClock clock;
+		SimulatedGpuTimer timer(clock);
+		GpuProfiler gpuProfiler(&timer, phase.ringFrames, &clock);
+
+		// Compare every frame read with the times the GPU really reached its timestamps at. BeginFrame reads several
+		// frames at once when the GPU finished more than one since the last.
+		std::vector<std::vector<uint64_t>> truth;
+		double worstAlignment = 0.0, worstDuration = 0.0;
+		uint checkedFrames = 0u;
+		bool shapeMatch = true;
+		gpuProfiler.SetFrameCallback([&](uint64_t frameNumber, const std::vector<GpuProfiler::Timing>& timings)
+		{
+			checkedFrames++;
+			const std::vector<uint64_t>* expected = frameNumber < truth.size() ? &truth[frameNumber] : nullptr;
+			if (!expected || timings.size() != 3u || expected->size() != 6u || timings[1].depth != 1u || timings[2].depth != 1u)
+			{
+				shapeMatch = false;
+				return;
+			}
+
+			const uint64_t expectedTicks[3][2] = { { (*expected)[0], (*expected)[5] }, { (*expected)[1], (*expected)[2] }, { (*expected)[3], (*expected)[4] } };
+			for (uint i = 0u; i < 3u; ++i)
+			{
+				for (uint end = 0u; end < 2u; ++end)
+				{
+					uint64_t ticks = end ? timings[i].end : timings[i].start;
+					double error = TicksToMicroseconds(ticks > expectedTicks[i][end] ? (double)(ticks - expectedTicks[i][end]) : (double)(expectedTicks[i][end] - ticks));
+					worstAlignment = error > worstAlignment ? error : worstAlignment;
+				}
+			}
+			double clearError = std::fabs(TicksToMicroseconds((double)(timings[1].end - timings[1].start)) - CLEAR_MICROSECONDS);
+			double drawError = std::fabs(TicksToMicroseconds((double)(timings[2].end - timings[2].start)) - phase.drawMicroseconds);
+			worstDuration = clearError > worstDuration ? clearError : worstDuration;
+			worstDuration = drawError > worstDuration ? drawError : worstDuration;
+		});
+
+		double worstRead = 0.0;
+		for (uint frame = 0u; frame < FRAMES; ++frame)
+		{
+			// Only reported: the simulated GPU never makes BeginFrame wait, so the time is the machine's.
+			auto readStart = std::chrono::steady_clock::now();
+			gpuProfiler.BeginFrame();
+			double readMilliseconds = MillisecondsSince(readStart);
+			worstRead = readMilliseconds > worstRead ? readMilliseconds : worstRead;
+
+			{
+				PROFILE_GPU_SCOPE(gpuProfiler, "Clear");
+				timer.Work(CLEAR_MICROSECONDS);
+			}
+			{
+				PROFILE_GPU_SCOPE(gpuProfiler, "Draws");
+				timer.Work(phase.drawMicroseconds);
+			}
+			if (frame == phase.disjointFrame)
+				timer.MarkDisjoint();
+			gpuProfiler.EndFrame();
+			truth.push_back(timer.TakeFrameTruth());
+
+			clock.AdvanceMicroseconds(phase.cpuMicroseconds);
+			timer.Present();
+			profiler.EndFrame();
+		}
+
+		// Every frame is read, skipped or dropped, but for those still in flight.
+		const GpuProfiler::Stats& stats = gpuProfiler.GetStats();
+		bool ringMatch = timer.GetErrorCount() == 0u && stats.resolved + stats.skipped + stats.disjoint + phase.ringFrames >= FRAMES &&
+			checkedFrames == stats.resolved;
+		if (phase.ringFrames < QUEUED_FRAMES + 1u)
+			ringMatch = ringMatch && stats.skipped > 0u && stats.resolved > 0u;
+		else if (phase.disjointFrame == NO_FRAME)
+			ringMatch = ringMatch && stats.skipped == 0u;
+		if (phase.disjointFrame != NO_FRAME)
+			ringMatch = ringMatch && stats.disjoint == 1u && stats.calibrations == 2u;
+		else
+			ringMatch = ringMatch && stats.disjoint == 0u && stats.calibrations == 1u;
+		bool timeMatch = shapeMatch && worstAlignment < ALIGNMENT_TOLERANCE_MICROSECONDS && worstDuration < ALIGNMENT_TOLERANCE_MICROSECONDS;
+
+		// The frames read reached the profiler's GPU track as a frame enclosing its scopes. A profiler frame holds as
+		// many GPU frames as BeginFrame read, so the draws are compared per call, and the profiler turns the simulated
+		// ticks into time at the rate it measured for the real counter.
+		std::vector<Profiler::ScopeStats> scopes = profiler.GetStats();
+		uint draws = FindScope(scopes, "Draws", "GPU frame");
+		bool trackMatch = FindScope(scopes, "GPU frame", nullptr) != Profiler::INVALID && FindScope(scopes, "Clear", "GPU frame") != Profiler::INVALID &&
+			draws != Profiler::INVALID && scopes[draws].thread == "GPU" && scopes[draws].calls > 0.0;
+		if (trackMatch)
+		{
+			double drawMicroseconds = scopes[draws].averageMilliseconds / scopes[draws].calls * 1000.0 * profiler.GetTicksPerNanosecond() / CPU_TICKS_PER_NANOSECOND;
+			trackMatch = std::fabs(drawMicroseconds - phase.drawMicroseconds) < ALIGNMENT_TOLERANCE_MICROSECONDS;
+		}
+
+		allMatch = allMatch && ringMatch && timeMatch && trackMatch;
+		output << std::format("{:<24} {:>3} frames read {} frames late, {:>3} skipped, {} disjoint, {} calibrations, worst read {:.3f} ms: {}",
+			phase.name, stats.resolved, stats.latency, stats.skipped, stats.disjoint, stats.calibrations, worstRead, ringMatch ? "OK" : "MISMATCH") << std::endl;
+		output << std::format("{:<24} alignment within {:.3f} us, durations within {:.3f} us, profiler track: {}", "", worstAlignment,
+			worstDuration, timeMatch && trackMatch ? "OK" : "MISMATCH") << std::endl;
+	}
+
+	profiler.Reset();
+	return allMatch;
+}
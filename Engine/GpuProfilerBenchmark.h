@@ -0,0 +1,14 @@
+#pragma once
+
+#include <ostream>
+#include "Common.h"
+
+// Runs GpuProfiler on a GPU simulated on the CPU's clock, so it needs no GPU. The simulated GPU runs each frame's work
+// in order after it is submitted, with its own clock frequency and origin, and Present holds the CPU back once three
+// frames are queued, like Direct3D. Frames are run with the GPU mostly idle, with the GPU the bottleneck, with a query
+// ring too short for the frames queued, and with a frame whose timestamps are disjoint and a clock that jumps after it.
+// Checks that every frame read is aligned with the CPU time the GPU really ran it at, that scopes last as long as the
+// work in them, that the ring skips frames instead of reusing queries not read yet or waiting for them, that the
+// disjoint frame is dropped and the clock calibrated again, and that the scopes reach the profiler's GPU track.
+// Run with "Engine.exe -benchmark-gpu-profiler". Returns false if any check fails.
+bool RunGpuProfilerBenchmark(std::ostream& output);
@@ -0,0 +1,38 @@
+#pragma once
+
+#include "Common.h"
+
+// Timestamp queries of a GPU, as Direct3D 11 has them. GpuProfiler drives them; D3DGpuTimer implements them with
+// D3D11_QUERY_TIMESTAMP and D3D11_QUERY_TIMESTAMP_DISJOINT queries.
+//
+// Queries are issued into the command stream and their results arrive once the GPU has run past them. Reading a
+// result never waits: a result that has not arrived reads as false.
+class GpuTimer
+{
+public:
+
+	// Result of a disjoint query: the timestamp frequency over the queries it encloses, and whether the frequency
+	// changed among them, which makes their timestamps meaningless.
+	struct Disjoint
+	{
+		uint64_t frequency = 0u;
+		bool disjoint = true;
+	};
+
+	virtual ~GpuTimer() = default;
+
+	// Creates disjointCount disjoint queries and timestampCount timestamp queries, replacing any made before.
+	virtual void CreateQueries(uint disjointCount, uint timestampCount) = 0;
+
+	virtual void BeginDisjoint(uint query) = 0;
+	virtual void EndDisjoint(uint query) = 0;
+
+	// Records the GPU's clock once it reaches this point of the command stream.
+	virtual void Timestamp(uint query) = 0;
+
+	// Sends the commands issued so far to the GPU.
+	virtual void Flush() = 0;
+
+	virtual bool GetDisjoint(uint query, Disjoint& result) = 0;
+	virtual bool GetTimestamp(uint query, uint64_t& ticks) = 0;
+};
@@ -0,0 +1,60 @@
+#include "Heightmap.h"
+#include "TargaDecoder.h"
+
+Heightmap::Heightmap(const char* filename)
+{
+	TargaDecoder decoder(filename);
+	Decode(decoder);
+}
+
+Heightmap::Heightmap(const uchar* data, size_t size)
+{
+	TargaDecoder decoder(data, size);
+	Decode(decoder);
+}
+
+Heightmap::Heightmap(uint width, uint height, std::vector<float> samples)
+{
+	if (samples.size() != (size_t)width * height || samples.empty())
+		return;
+
+	_width = width;
+	_height = height;
+	_samples = std::move(samples);
+}
+
+void Heightmap::Decode(TargaDecoder& decoder)
+{
+	if (!decoder.IsValid() || decoder.GetWidth() == 0u || decoder.GetHeight() == 0u)
+		return;
+
+	// The decoder only writes RGBA8; greyscale images come out with the grey level in every colour channel.
+	std::vector<uint32_t> pixels((size_t)decoder.GetWidth() * decoder.GetHeight());
+	if (!decoder.Decode((uchar*)pixels.data()))
+		return;
+
+	_width = decoder.GetWidth();
+	_height = decoder.GetHeight();
+	_samples.resize(pixels.size());
+	for (uint row = 0u; row < _height; ++row)
+	{
+		const uint32_t* source = &pixels[(size_t)(_height - 1u - row) * _width];
+		for (uint column = 0u; column < _width; ++column)
+			_samples[(size_t)row * _width + column] = (source[column] & 0xffu) / 255.0f;
+	}
+}
+
+bool Heightmap::IsValid() const
+{
+	return !_samples.empty();
+}
+
+uint Heightmap::GetWidth() const
+{
+	return _width;
+}
+
+uint Heightmap::GetHeight() const
+{
+	return _height;
+}
@@ -0,0 +1,42 @@
+#pragma once
+
+#include "Common.h"
+
+class TargaDecoder;
+
+// Terrain heights on a regular grid of samples, 0 to 1, row by row. Read from a TGA through TargaDecoder: greyscale
+// images give their grey level, colour images their red channel. Row 0 is the bottom of the image, so with rows along
+// z the terrain seen from above looks like the image. Has no Direct3D dependency.
+class Heightmap
+{
+public:
+
+	// Decodes a TGA file. Check IsValid.
+	explicit Heightmap(const char* filename);
+
+	// Decodes a whole TGA file held in memory, such as an AssetArchive entry.
+	Heightmap(const uchar* data, size_t size);
+
+	// Takes width * height samples, row by row.
+	Heightmap(uint width, uint height, std::vector<float> samples);
+
+	bool IsValid() const;
+	uint GetWidth() const;
+	uint GetHeight() const;
+
+	// The sample at column x and row z, clamped to the edges of the map.
+	float GetSample(int x, int z) const
+	{
+		x = x < 0 ? 0 : (x >= (int)_width ? (int)_width - 1 : x);
+		z = z < 0 ? 0 : (z >= (int)_height ? (int)_height - 1 : z);
+		return _samples[(size_t)z * _width + x];
+	}
+
+private:
+
+	void Decode(TargaDecoder& decoder);
+
+	uint _width = 0u;
+	uint _height = 0u;
+	std::vector<float> _samples;
+};
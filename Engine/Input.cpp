@@ -26,3 +26,22 @@ bool Input::IsKeyDown(unsigned int key)
 	// Return what state the key is in (pressed/not pressed).
 	return m_keys[key];
 }
+
+void Input::MouseClick(int x, int y)
+{
+	// Keep only the latest click; the application takes it once per frame.
+	m_clicked = true;
+	m_clickX = x;
+	m_clickY = y;
+}
+
+bool Input::TakeClick(int& x, int& y)
+{
+	if (!m_clicked)
+		return false;
+
+	x = m_clickX;
+	y = m_clickY;
+	m_clicked = false;
+	return true;
+}
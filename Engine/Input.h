@@ -14,7 +14,16 @@ public:
 
 	bool IsKeyDown(unsigned int);
 
+	// Records a left click at a window position in pixels.
+	void MouseClick(int, int);
+
+	// Returns the position of the last click not yet taken, if there is one.
+	bool TakeClick(int&, int&);
+
 private:
 	
 	bool m_keys[256];
+	bool m_clicked = false;
+	int m_clickX = 0;
+	int m_clickY = 0;
 };
@@ -0,0 +1,93 @@
+#include "InstanceBuffer.h"
+#include "D3DContext.h"
+
+#include <stddef.h>
+#include <string.h>
+
+#ifdef _WIN32
+#include "D3D.h"
+#endif
+
+namespace
+{
+	// Instances the buffer holds when first created.
+	const uint MIN_CAPACITY = 256u;
+}
+
+InstanceBuffer::InstanceBuffer(RenderBackend& renderer)
+	: _device(GetDevice(renderer))
+	, _deviceContext(GetDeviceContext(renderer))
+{
+}
+
+InstanceBuffer::~InstanceBuffer() = default;
+
+const std::vector<VertexElement>& InstanceBuffer::GetFormat()
+{
+	static const std::vector<VertexElement> instanceFormat =
+	{
+		{ "WORLD", 0u, VertexFormat::Float4, (uint)offsetof(InstanceData, world) },
+		{ "WORLD", 1u, VertexFormat::Float4, (uint)offsetof(InstanceData, world) + 16u },
+		{ "WORLD", 2u, VertexFormat::Float4, (uint)offsetof(InstanceData, world) + 32u },
+		{ "WORLD", 3u, VertexFormat::Float4, (uint)offsetof(InstanceData, world) + 48u },
+		{ "TEXCOORD", 1u, VertexFormat::Float2, (uint)offsetof(InstanceData, textureOffset) }
+	};
+	return instanceFormat;
+}
+
+void InstanceBuffer::Upload(const std::vector<InstanceData>& instances)
+{
+	_buffers.instances = instances.data();
+	_buffers.instanceCount = (uint)instances.size();
+	if (!_device || instances.empty())
+		return;
+
+#ifdef _WIN32
+
+	// Grow the buffer to the next power of two that holds every instance.
+	if (instances.size() > _capacity)
+	{
+		uint capacity = _capacity > 0u ? _capacity : MIN_CAPACITY;
+		while (capacity < instances.size())
+			capacity *= 2u;
+
+		// Setup the description of the dynamic instance buffer.
+		D3D11_BUFFER_DESC bufferDesc;
+		bufferDesc.Usage = D3D11_USAGE_DYNAMIC;
+		bufferDesc.ByteWidth = capacity * sizeof(InstanceData);
+		bufferDesc.BindFlags = D3D11_BIND_VERTEX_BUFFER;
+		bufferDesc.CPUAccessFlags = D3D11_CPU_ACCESS_WRITE;
+		bufferDesc.MiscFlags = 0;
+		bufferDesc.StructureByteStride = 0;
+
+		ReleasePtr<ID3D11Buffer> buffer;
+		HRESULT result = _device->CreateBuffer(&bufferDesc, nullptr, &buffer);
+		if (FAILED(result))
+			throw D3DError("Failed to create the instance buffer");
+
+		_buffer = std::move(buffer);
+		_capacity = capacity;
+		_buffers.buffer = _buffer.get();
+	}
+
+	// Lock the instance buffer so it can be written to.
+	D3D11_MAPPED_SUBRESOURCE mappedResource;
+	HRESULT result = _deviceContext->Map(_buffer.get(), 0, D3D11_MAP_WRITE_DISCARD, 0, &mappedResource);
+	if (FAILED(result))
+		throw D3DError("Failed to map the instance buffer");
+
+	// Copy the instances in and unlock the buffer.
+	memcpy(mappedResource.pData, instances.data(), instances.size() * sizeof(InstanceData));
+	_deviceContext->Unmap(_buffer.get(), 0);
+#endif
+}
+
+const InstanceBuffers& InstanceBuffer::GetBuffers() const
+{
+	return _buffers;
+}
+
+uint InstanceBuffer::GetCapacity() const
+{
+	return _capacity;
+}
@@ -0,0 +1,45 @@
+#pragma once
+
+#include "Common.h"
+#include "ReleasePtr.h"
+#include "RenderBackend.h"
+
+struct ID3D11Device;
+struct ID3D11DeviceContext;
+
+// The per-instance data of a list's instanced draws, in one dynamic vertex buffer. DrawList uploads every batch's
+// instances at once before drawing, and each batch draws from its own start instance. The upload maps with
+// WRITE_DISCARD, so a buffer the GPU is still reading from is renamed by the driver instead of waited for. The buffer
+// grows to the largest upload seen.
+//
+// Backends without a device get no buffer and read the instances from the uploaded array.
+class InstanceBuffer
+{
+public:
+
+	InstanceBuffer(RenderBackend& renderer);
+	~InstanceBuffer();
+
+	InstanceBuffer(const InstanceBuffer&) = delete;
+	InstanceBuffer& operator=(const InstanceBuffer&) = delete;
+
+	// Layout of InstanceData, which instanced shader programs match their per-instance inputs against.
+	static const std::vector<VertexElement>& GetFormat();
+
+	// Replaces the buffer's contents. The array must stay alive and unchanged until the draws reading it have been
+	// issued. Throws D3DError if the buffer cannot be grown or mapped.
+	void Upload(const std::vector<InstanceData>& instances);
+
+	// What to pass to RenderBackend::SetInstances.
+	const InstanceBuffers& GetBuffers() const;
+
+	uint GetCapacity() const;
+
+private:
+
+	ID3D11Device* _device = nullptr;
+	ID3D11DeviceContext* _deviceContext = nullptr;
+	ReleasePtr<ID3D11Buffer> _buffer;
+	uint _capacity = 0u;
+	InstanceBuffers _buffers;
+};
@@ -0,0 +1,394 @@
+#include "JobSystem.h"
+#include "Profiler.h"
+
+#include <algorithm>
+
+namespace
+{
+	// The system a worker thread belongs to and its deque. Other threads, the main thread included, leave it empty.
+	thread_local const JobSystem* currentSystem = nullptr;
+	thread_local int currentDeque = -1;
+}
+
+// A fixed-size Chase-Lev deque (Chase and Lev, "Dynamic Circular Work-Stealing Deque", with the memory orders of
+// Lê et al., "Correct and Efficient Work-Stealing for Weak Memory Models"). The owner pushes and pops at the bottom,
+// any thread steals from the top; the two sides only race for the last task, and a compare-exchange on top settles
+// that. A full deque refuses the task and the caller queues it elsewhere, so the deque never has to grow.
+class JobSystem::Deque
+{
+public:
+
+	static const int64_t CAPACITY = 4096;
+
+	// Owner only.
+	bool Push(Task* task)
+	{
+		int64_t bottom = _bottom.load(std::memory_order_relaxed);
+		int64_t top = _top.load(std::memory_order_acquire);
+		if (bottom - top >= CAPACITY)
+			return false;
+
+		_tasks[bottom % CAPACITY].store(task, std::memory_order_relaxed);
+		std::atomic_thread_fence(std::memory_order_release);
+		_bottom.store(bottom + 1, std::memory_order_relaxed);
+		return true;
+	}
+
+	// Owner only. Takes the newest task.
+	Task* Pop()
+	{
+		int64_t bottom = _bottom.load(std::memory_order_relaxed) - 1;
+		_bottom.store(bottom, std::memory_order_relaxed);
+		std::atomic_thread_fence(std::memory_order_seq_cst);
+		int64_t top = _top.load(std::memory_order_relaxed);
+
+		if (top > bottom)
+		{
+			// Empty.
+			_bottom.store(bottom + 1, std::memory_order_relaxed);
+			return nullptr;
+		}
+
+		Task* task = _tasks[bottom % CAPACITY].load(std::memory_order_relaxed);
+		if (top == bottom)
+		{
+			// The last task; a thief may be taking it too.
+			if (!_top.compare_exchange_strong(top, top + 1, std::memory_order_seq_cst, std::memory_order_relaxed))
+				task = nullptr;
+			_bottom.store(bottom + 1, std::memory_order_relaxed);
+		}
+		return task;
+	}
+
+	// Any thread. Takes the oldest task.
+	Task* Steal()
+	{
+		int64_t top = _top.load(std::memory_order_acquire);
+		std::atomic_thread_fence(std::memory_order_seq_cst);
+		int64_t bottom = _bottom.load(std::memory_order_acquire);
+		if (top >= bottom)
+			return nullptr;
+
+		Task* task = _tasks[top % CAPACITY].load(std::memory_order_relaxed);
+		if (!_top.compare_exchange_strong(top, top + 1, std::memory_order_seq_cst, std::memory_order_relaxed))
+			return nullptr;
+		return task;
+	}
+
+private:
+
+	// On separate cache lines, so thieves moving top do not slow down the owner working on bottom.
+	alignas(64) std::atomic<int64_t> _top = 0;
+	alignas(64) std::atomic<int64_t> _bottom = 0;
+	alignas(64) std::atomic<Task*> _tasks[CAPACITY] = {};
+};
+
+bool JobSystem::Counter::IsDone() const
+{
+	return _pending.load(std::memory_order_acquire) == 0u;
+}
+
+JobSystem::JobSystem(uint workerCount)
+	: _mainThread(std::this_thread::get_id())
+{
+	// Keep at least one worker, so background jobs progress even when the main thread never waits.
+	if (workerCount == 0u)
+		workerCount = std::max(2u, std::thread::hardware_concurrency()) - 1u;
+
+	// Name the threads in the profiler's trace. Creating the profiler here also keeps it alive until the workers stop.
+	Profiler::Get().SetThreadName("Main");
+
+	for (uint i = 0u; i <= workerCount; ++i)
+		_deques.push_back(std::make_unique<Deque>());
+	for (uint i = 1u; i <= workerCount; ++i)
+		_workers.emplace_back(&JobSystem::WorkerLoop, this, i);
+}
+
+JobSystem::~JobSystem()
+{
+	// Workers run until they find nothing left to take.
+	{
+		std::lock_guard<std::mutex> lock(_wakeMutex);
+		_stopping = true;
+	}
+	_wake.notify_all();
+	for (std::thread& worker : _workers)
+		worker.join();
+
+	// Run what the workers could not: main thread jobs, and jobs queued while they were stopping.
+	while (Task* task = TakeMainThreadTask())
+		Execute(task);
+	while (Task* task = Take(0, true))
+		Execute(task);
+}
+
+JobSystem& JobSystem::GetDefault()
+{
+	static JobSystem system;
+	return system;
+}
+
+uint JobSystem::GetThreadCount() const
+{
+	return (uint)_deques.size();
+}
+
+bool JobSystem::IsMainThread() const
+{
+	return std::this_thread::get_id() == _mainThread;
+}
+
+void JobSystem::Run(Job job, Counter* counter)
+{
+	if (counter)
+		counter->_pending++;
+	Push(new Task{ std::move(job), counter });
+}
+
+void JobSystem::RunAfter(Counter& dependency, Job job, Counter* counter)
+{
+	if (counter)
+		counter->_pending++;
+	Task* task = new Task{ std::move(job), counter };
+
+	// Finish empties the continuations under the same lock once the count reaches zero, so the task is either held back
+	// here and queued by the last job of the group, or the group is already done.
+	{
+		std::lock_guard<std::mutex> lock(dependency._mutex);
+		if (dependency._pending.load() != 0u)
+		{
+			dependency._continuations.push_back(task);
+			return;
+		}
+	}
+	Push(task);
+}
+
+void JobSystem::RunInBackground(Job job, Counter* counter)
+{
+	if (counter)
+		counter->_pending++;
+
+	{
+		std::lock_guard<std::mutex> lock(_sharedMutex);
+		_background.push_back(new Task{ std::move(job), counter });
+	}
+	Wake();
+}
+
+void JobSystem::RunOnMainThread(Job job, Counter* counter)
+{
+	if (counter)
+		counter->_pending++;
+
+	std::lock_guard<std::mutex> lock(_mainMutex);
+	_mainThreadTasks.push_back(new Task{ std::move(job), counter });
+}
+
+void JobSystem::Wait(Counter& counter)
+{
+	const bool mainThread = IsMainThread();
+	const int dequeIndex = GetDequeIndex();
+	while (!counter.IsDone())
+	{
+		Task* task = mainThread ? TakeMainThreadTask() : nullptr;
+		if (!task)
+			task = Take(dequeIndex);
+
+		if (task)
+			Execute(task);
+		else
+			std::this_thread::yield();
+	}
+
+	// The last job may still be in Finish, queueing continuations; the counter must not go away under it.
+	std::lock_guard<std::mutex> lock(counter._mutex);
+}
+
+void JobSystem::RunMainThreadJobs()
+{
+	// Jobs queued by these jobs wait for the next call, so a job that queues itself cannot hold up the frame.
+	size_t count = 0u;
+	{
+		std::lock_guard<std::mutex> lock(_mainMutex);
+		count = _mainThreadTasks.size();
+	}
+
+	for (size_t i = 0u; i < count; ++i)
+	{
+		if (Task* task = TakeMainThreadTask())
+			Execute(task);
+	}
+}
+
+void JobSystem::ParallelFor(uint taskCount, uint threadCount, const std::function<void(uint task)>& function)
+{
+	if (threadCount == 0u)
+		threadCount = GetThreadCount();
+	threadCount = std::min(threadCount, taskCount);
+	if (threadCount <= 1u)
+	{
+		for (uint task = 0u; task < taskCount; ++task)
+			function(task);
+		return;
+	}
+
+	std::atomic<uint> nextTask = 0u;
+	auto worker = [&]
+	{
+		for (uint task = nextTask++; task < taskCount; task = nextTask++)
+			function(task);
+	};
+
+	// One job per extra thread; the calling thread works too, and then helps with whatever else is queued.
+	Counter counter;
+	for (uint i = 1u; i < threadCount; ++i)
+		Run(worker, &counter);
+	worker();
+	Wait(counter);
+}
+
+JobSystem::Stats JobSystem::GetStats() const
+{
+	Stats stats;
+	stats.jobs = _jobCount.load();
+	stats.steals = _stealCount.load();
+	return stats;
+}
+
+int JobSystem::GetDequeIndex() const
+{
+	if (currentSystem == this)
+		return currentDeque;
+	if (IsMainThread())
+		return 0;
+	return -1;
+}
+
+void JobSystem::Push(Task* task)
+{
+	const int dequeIndex = GetDequeIndex();
+	if (dequeIndex < 0 || !_deques[dequeIndex]->Push(task))
+	{
+		std::lock_guard<std::mutex> lock(_sharedMutex);
+		_shared.push_back(task);
+	}
+	Wake();
+}
+
+void JobSystem::Wake()
+{
+	// A worker about to sleep counts itself in _sleeping before checking _queued, so either it sees this job or this
+	// sees it. Taking the lock makes sure it is waiting by the time it is notified.
+	_queued++;
+	if (_sleeping.load() != 0u)
+	{
+		{
+			std::lock_guard<std::mutex> lock(_wakeMutex);
+		}
+		_wake.notify_one();
+	}
+}
+
+JobSystem::Task* JobSystem::Take(int dequeIndex, bool background)
+{
+	Task* task = nullptr;
+	if (dequeIndex >= 0)
+		task = _deques[dequeIndex]->Pop();
+
+	if (!task)
+	{
+		std::lock_guard<std::mutex> lock(_sharedMutex);
+		if (!_shared.empty())
+		{
+			task = _shared.front();
+			_shared.pop_front();
+		}
+	}
+
+	// Steal from the others, starting after this thread's own deque so thieves spread out.
+	const uint dequeCount = (uint)_deques.size();
+	for (uint i = 1u; !task && i <= dequeCount; ++i)
+	{
+		uint victim = (uint)(dequeIndex + (int)i) % dequeCount;
+		if ((int)victim == dequeIndex)
+			continue;
+
+		task = _deques[victim]->Steal();
+		if (task)
+			_stealCount++;
+	}
+
+	if (!task && background)
+	{
+		std::lock_guard<std::mutex> lock(_sharedMutex);
+		if (!_background.empty())
+		{
+			task = _background.front();
+			_background.pop_front();
+		}
+	}
+
+	if (task)
+		_queued--;
+	return task;
+}
+
+JobSystem::Task* JobSystem::TakeMainThreadTask()
+{
+	std::lock_guard<std::mutex> lock(_mainMutex);
+	if (_mainThreadTasks.empty())
+		return nullptr;
+
+	Task* task = _mainThreadTasks.front();
+	_mainThreadTasks.pop_front();
+	return task;
+}
+
+void JobSystem::Execute(Task* task)
+{
+	task->function();
+	Finish(task->counter);
+	delete task;
+	_jobCount++;
+}
+
+void JobSystem::Finish(Counter* counter)
+{
+	if (!counter)
+		return;
+
+	std::vector<Task*> continuations;
+	{
+		std::lock_guard<std::mutex> lock(counter->_mutex);
+		if (--counter->_pending == 0u)
+			continuations.swap(counter->_continuations);
+	}
+
+	for (Task* task : continuations)
+		Push(task);
+}
+
+void JobSystem::WorkerLoop(uint index)
+{
+	currentSystem = this;
+	currentDeque = (int)index;
+	Profiler::Get().SetThreadName(std::format("Worker {}", index));
+
+	for (;;)
+	{
+		if (Task* task = Take((int)index, true))
+		{
+			Execute(task);
+			continue;
+		}
+
+		std::unique_lock<std::mutex> lock(_wakeMutex);
+		if (_stopping)
+			return;
+
+		_sleeping++;
+		_wake.wait(lock, [this] { return _queued.load() != 0u || _stopping; });
+		_sleeping--;
+	}
+}
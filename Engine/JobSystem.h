@@ -0,0 +1,144 @@
+#pragma once
+
+#include <atomic>
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include "Common.h"
+
+// Runs jobs on a fixed set of worker threads, so per-frame work (transform updates, culling, draw sorting) and
+// background work (texture decoding) share the cores instead of each starting threads of its own.
+//
+// - Every worker, and the main thread, owns a Chase-Lev work-stealing deque. A thread pushes and pops jobs at the
+//   bottom of its own deque without locks; idle threads steal from the top of the others. Threads outside the system
+//   queue their jobs in a shared locked queue.
+// - A Counter tracks a group of jobs. Wait runs other jobs until the group is done, so waiting never idles a thread,
+//   and RunAfter starts a job once a group is done, to build dependency chains without waiting at all.
+// - Jobs queued with RunInBackground only run on workers, when they have nothing else to do. Long jobs like asset
+//   decoding go there, so they never end up inside a frame's Wait on the main thread.
+// - Jobs queued with RunOnMainThread only run on the main thread, the one that created the system, in Wait or
+//   RunMainThreadJobs. Work on the Direct3D immediate context, which is not thread safe, goes there.
+// - ParallelFor shares tasks out between up to threadCount threads, the calling thread included.
+//
+// Idle workers sleep until a job is queued.
+class JobSystem
+{
+	struct Task;
+
+public:
+
+	using Job = std::function<void()>;
+
+	// Number of unfinished jobs of a group. It must outlive the jobs counted on it.
+	class Counter
+	{
+	public:
+
+		Counter() = default;
+		Counter(const Counter&) = delete;
+		Counter& operator=(const Counter&) = delete;
+
+		bool IsDone() const;
+
+	private:
+
+		friend class JobSystem;
+
+		std::atomic<uint> _pending = 0u;
+		std::mutex _mutex;					// Held while finishing a job, and while adding continuations.
+		std::vector<Task*> _continuations;	// Jobs RunAfter holds back until the group is done.
+	};
+
+	struct Stats
+	{
+		uint64_t jobs = 0u;		// Jobs run since the system was created.
+		uint64_t steals = 0u;	// Of those, jobs taken from another thread's deque.
+	};
+
+	// workerCount 0 starts one worker per hardware thread besides the calling thread, which becomes the main thread.
+	explicit JobSystem(uint workerCount = 0u);
+
+	// Runs every queued job, then stops the workers.
+	~JobSystem();
+
+	JobSystem(const JobSystem&) = delete;
+	JobSystem& operator=(const JobSystem&) = delete;
+
+	// The system the engine's parallel code runs on. The first thread to call it is its main thread, so WinMain calls
+	// it before anything else.
+	static JobSystem& GetDefault();
+
+	// Workers plus the main thread.
+	uint GetThreadCount() const;
+	bool IsMainThread() const;
+
+	// Queues a job. The counter, if given, counts it until it has finished.
+	void Run(Job job, Counter* counter = nullptr);
+
+	// Queues a job once every job counted on dependency has finished.
+	void RunAfter(Counter& dependency, Job job, Counter* counter = nullptr);
+
+	// Queues a job for the workers only, behind every other job.
+	void RunInBackground(Job job, Counter* counter = nullptr);
+
+	// Queues a job for the main thread.
+	void RunOnMainThread(Job job, Counter* counter = nullptr);
+
+	// Runs queued jobs until every job counted on the counter has finished. On the main thread this includes main
+	// thread jobs.
+	void Wait(Counter& counter);
+
+	// Runs the main thread jobs queued so far. Call from the main thread once a frame.
+	void RunMainThreadJobs();
+
+	// Calls function for every task in [0, taskCount) on up to threadCount threads, the calling one included, and
+	// returns once all have finished. Threads take the next task as they finish one, so uneven tasks balance out.
+	// threadCount 0 uses every thread of the system.
+	void ParallelFor(uint taskCount, uint threadCount, const std::function<void(uint task)>& function);
+
+	Stats GetStats() const;
+
+private:
+
+	struct Task
+	{
+		Job function;
+		Counter* counter = nullptr;
+	};
+
+	class Deque;
+
+	// Index of the calling thread's deque, or -1 for threads outside the system.
+	int GetDequeIndex() const;
+
+	void Push(Task* task);
+	void Wake();
+	Task* Take(int dequeIndex, bool background = false);
+	Task* TakeMainThreadTask();
+	void Execute(Task* task);
+	void Finish(Counter* counter);
+	void WorkerLoop(uint index);
+
+	std::thread::id _mainThread;
+	std::vector<std::unique_ptr<Deque>> _deques; // Index 0 belongs to the main thread, the rest to the workers.
+	std::vector<std::thread> _workers;
+
+	// Jobs queued by threads outside the system, background jobs, and jobs for the main thread.
+	std::mutex _sharedMutex;
+	std::deque<Task*> _shared;
+	std::deque<Task*> _background;
+	std::mutex _mainMutex;
+	std::deque<Task*> _mainThreadTasks;
+
+	// Jobs queued and not yet taken, and the sleeping workers a new job has to wake.
+	std::atomic<uint> _queued = 0u;
+	std::atomic<uint> _sleeping = 0u;
+	std::mutex _wakeMutex;
+	std::condition_variable _wake;
+	bool _stopping = false;
+
+	std::atomic<uint64_t> _jobCount = 0u;
+	std::atomic<uint64_t> _stealCount = 0u;
+};
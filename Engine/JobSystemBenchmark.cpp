@@ -0,0 +1,230 @@
+#include "JobSystemBenchmark.h"
+#include "JobSystem.h"
+#include "Scene.h"
+#include "FrustumCuller.h"
+#include "RadixSort.h"
+#include "MipGenerator.h"
+#include "BlockCompressor.h"
+
+#include <atomic>
+#include <chrono>
+#include <random>
+
+namespace
+{
+	const uint SCENE_NODES = 1000000u;
+	const uint CULL_BOUNDS = 1000000u;
+	const uint SORT_KEYS = 2000000u;
+	const uint MIP_SIZE = 2048u;
+	const uint COMPRESS_SIZE = 512u;
+	const uint REPETITIONS = 5u;
+
+	const uint EMPTY_JOBS = 100000u;
+	const uint NESTED_CHILDREN = 100u;	// Children each job of the nested fan-out starts and waits for.
+	const uint CHAIN_LENGTH = 10000u;
+
+	double MillisecondsSince(std::chrono::steady_clock::time_point start)
+	{
+		return std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+	}
+
+	// Thread counts to measure: powers of two up to, and always including, every thread of the system.
+	std::vector<uint> GetThreadCounts()
+	{
+		uint maxThreads = JobSystem::GetDefault().GetThreadCount();
+		std::vector<uint> threadCounts;
+		for (uint threadCount = 1u; threadCount < maxThreads; threadCount *= 2u)
+			threadCounts.push_back(threadCount);
+		threadCounts.push_back(maxThreads);
+		return threadCounts;
+	}
+
+	// Runs run(threadCount, result) REPETITIONS times for every thread count and prints the average times and speedups
+	// on one line. Returns false if any thread count leaves a different result than one thread.
+	template <typename Result, typename Run>
+	bool MeasureScaling(std::ostream& output, const char* name, const std::vector<uint>& threadCounts, Run run)
+	{
+		Result reference;
+		double baseline = 0.0;
+		bool match = true;
+		std::string line = std::format("{:<30}", name);
+		for (uint threadCount : threadCounts)
+		{
+			Result result;
+			auto start = std::chrono::steady_clock::now();
+			for (uint i = 0u; i < REPETITIONS; ++i)
+				run(threadCount, result);
+			double milliseconds = MillisecondsSince(start) / REPETITIONS;
+
+			if (threadCount == threadCounts.front())
+			{
+				reference = std::move(result);
+				baseline = milliseconds;
+			}
+			else
+			{
+				match = match && result == reference;
+			}
+			line += std::format(" {:8.3f} ms ({:4.2f}x)", milliseconds, baseline / milliseconds);
+		}
+
+		output << line << (match ? "" : " MISMATCH") << std::endl;
+		return match;
+	}
+
+	// Nanoseconds per job of run(), which runs jobCount empty jobs.
+	template <typename Run>
+	double MeasureJobs(uint jobCount, Run run)
+	{
+		auto start = std::chrono::steady_clock::now();
+		for (uint i = 0u; i < REPETITIONS; ++i)
+			run();
+		return MillisecondsSince(start) * 1000000.0 / ((double)REPETITIONS * jobCount);
+	}
+}
+
+bool RunJobSystemBenchmark(std::ostream& output)
+{
+	JobSystem& jobs = JobSystem::GetDefault();
+	std::vector<uint> threadCounts = GetThreadCounts();
+
+	std::string header = std::format("Job system scaling, average of {} runs, threads:", REPETITIONS);
+	for (uint threadCount : threadCounts)
+		header += std::format(" {}", threadCount);
+	output << header << std::endl;
+
+	bool allMatch = true;
+	std::mt19937 random(1u);
+
+	// A flat scene where moving the root dirties every node, the worst case of a frame's transform update.
+	Scene scene;
+	scene.Reserve(SCENE_NODES);
+	Scene::Node root = scene.Create(Scene::INVALID_NODE, Math::Identity());
+	for (uint i = 1u; i < SCENE_NODES; ++i)
+		scene.Create(root, Math::Translation((float)(i % 1000u), 0.0f, (float)(i / 1000u)));
+	allMatch = MeasureScaling<std::vector<float>>(output, "Scene update (1M nodes)", threadCounts, [&](uint threadCount, std::vector<float>& result)
+	{
+		scene.SetLocalMatrix(root, Math::Rotation(Math::RotationAxis(Math::Float3(0.0f, 1.0f, 0.0f), 0.5f)));
+		scene.Update(threadCount);
+
+		result.clear();
+		for (Scene::Node node = 0u; node < SCENE_NODES; node += 997u)
+		{
+			Math::Matrix4 world = scene.GetWorldMatrix(node);
+			result.insert(result.end(), &world.m[0][0], &world.m[0][0] + 16);
+		}
+	}) && allMatch;
+
+	// Bounds scattered around a camera looking down +z.
+	FrustumCuller culler;
+	culler.Reserve(CULL_BOUNDS);
+	std::uniform_real_distribution<float> position(-500.0f, 500.0f);
+	for (uint i = 0u; i < CULL_BOUNDS; ++i)
+	{
+		Bounds bounds;
+		bounds.center = Math::Float3(position(random), position(random), position(random));
+		bounds.extents = Math::Float3(1.0f, 1.0f, 1.0f);
+		bounds.radius = 1.7320508f;
+		culler.Add(bounds);
+	}
+	Math::Matrix4 view = Math::LookAtLH(Math::Float3(0.0f, 0.0f, 0.0f), Math::Float3(0.0f, 0.0f, 1.0f), Math::Float3(0.0f, 1.0f, 0.0f));
+	Frustum frustum(Math::Multiply(view, Math::PerspectiveFovLH(Math::PI / 4.0f, 16.0f / 9.0f, 0.3f, 500.0f)));
+	allMatch = MeasureScaling<std::vector<uint>>(output, "Frustum culling (1M bounds)", threadCounts, [&](uint threadCount, std::vector<uint>& result)
+	{
+		culler.Cull(frustum, result, threadCount);
+	}) && allMatch;
+
+	// Random keys, so every pass of the sort moves entries.
+	std::vector<RadixSort::Entry> keys(SORT_KEYS);
+	for (uint i = 0u; i < SORT_KEYS; ++i)
+		keys[i] = RadixSort::Entry{ (uint64_t)random() << 32 | random(), i };
+	std::vector<RadixSort::Entry> entries, scratch;
+	allMatch = MeasureScaling<std::vector<uint>>(output, "Radix sort (2M keys)", threadCounts, [&](uint threadCount, std::vector<uint>& result)
+	{
+		entries = keys;
+		RadixSort::Sort(entries, scratch, threadCount);
+
+		result.resize(entries.size());
+		for (size_t i = 0u; i < entries.size(); ++i)
+			result[i] = entries[i].value;
+	}) && allMatch;
+
+	// Noise, the slowest image to filter and compress well.
+	std::vector<uchar> pixels((size_t)MIP_SIZE * MIP_SIZE * 4u);
+	for (uchar& value : pixels)
+		value = (uchar)random();
+
+	allMatch = MeasureScaling<std::vector<uchar>>(output, "Mip generation (2048x2048)", threadCounts, [&](uint threadCount, std::vector<uchar>& result)
+	{
+		MipGenerator::Options options;
+		options.filter = MipGenerator::Filter::Kaiser;
+		options.threadCount = threadCount;
+
+		result.clear();
+		for (const MipGenerator::Level& level : MipGenerator::Generate(pixels.data(), MIP_SIZE, MIP_SIZE, options))
+			result.insert(result.end(), level.pixels.begin(), level.pixels.end());
+	}) && allMatch;
+
+	allMatch = MeasureScaling<std::vector<uchar>>(output, "BC7 compression (512x512)", threadCounts, [&](uint threadCount, std::vector<uchar>& result)
+	{
+		BlockCompressor::Options options;
+		options.format = BlockCompressor::Format::BC7;
+		options.threadCount = threadCount;
+		result = BlockCompressor::Compress(pixels.data(), COMPRESS_SIZE, COMPRESS_SIZE, options);
+	}) && allMatch;
+
+	// What the system costs per job, with nothing in the jobs to hide it.
+	JobSystem::Stats before = jobs.GetStats();
+	double fanOut = MeasureJobs(EMPTY_JOBS, [&]
+	{
+		JobSystem::Counter counter;
+		for (uint i = 0u; i < EMPTY_JOBS; ++i)
+			jobs.Run([] {}, &counter);
+		jobs.Wait(counter);
+	});
+
+	double nested = MeasureJobs(EMPTY_JOBS, [&]
+	{
+		JobSystem::Counter counter;
+		for (uint i = 0u; i < EMPTY_JOBS / NESTED_CHILDREN; ++i)
+		{
+			jobs.Run([&]
+			{
+				JobSystem::Counter children;
+				for (uint child = 1u; child < NESTED_CHILDREN; ++child)
+					jobs.Run([] {}, &children);
+				jobs.Wait(children);
+			}, &counter);
+		}
+		jobs.Wait(counter);
+	});
+
+	// Every link waits for the one before it, so the chain has to run in order however many threads pick it up.
+	std::atomic<bool> chainInOrder = true;
+	double chain = MeasureJobs(CHAIN_LENGTH, [&]
+	{
+		std::vector<JobSystem::Counter> links(CHAIN_LENGTH);
+		std::atomic<uint> nextLink = 0u;
+		auto link = [&](uint index)
+		{
+			return [&, index]
+			{
+				if (nextLink++ != index)
+					chainInOrder = false;
+			};
+		};
+
+		jobs.Run(link(0u), &links[0]);
+		for (uint i = 1u; i < CHAIN_LENGTH; ++i)
+			jobs.RunAfter(links[i - 1u], link(i), &links[i]);
+		jobs.Wait(links[CHAIN_LENGTH - 1u]);
+	});
+	allMatch = allMatch && chainInOrder;
+
+	JobSystem::Stats after = jobs.GetStats();
+	output << std::format("Empty jobs on {} threads: fan-out {:.0f} ns/job, nested fan-outs {:.0f} ns/job, dependency chain {:.0f} ns/job{}",
+		jobs.GetThreadCount(), fanOut, nested, chain, chainInOrder ? "" : " OUT OF ORDER") << std::endl;
+	output << std::format("{} jobs run, {} stolen from another thread", after.jobs - before.jobs, after.steals - before.steals) << std::endl;
+
+	return allMatch;
+}
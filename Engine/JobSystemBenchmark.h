@@ -0,0 +1,11 @@
+#pragma once
+
+#include <ostream>
+#include "Common.h"
+
+// Runs the engine's parallel work on 1 to every thread of the job system: a 1M node scene update, culling 1M bounds,
+// radix sorting 2M keys, mip generation and BC7 compression. Reports each time and its speedup over one thread, and
+// checks that every thread count gives the same result. Also times empty jobs run as a fan-out, nested fan-outs and a
+// dependency chain, which is what the system itself costs per job. Run with "Engine.exe -benchmark-jobs". Returns false
+// if a result differs between thread counts or the chain ran out of order.
+bool RunJobSystemBenchmark(std::ostream& output);
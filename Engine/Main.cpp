@@ -1,9 +1,320 @@
+#ifdef _WIN32
 #include "System.h"
+#endif
+#include "AssetArchive.h"
+#include "SceneBenchmark.h"
+#include "CullingBenchmark.h"
+#include "BvhBenchmark.h"
+#include "DrawListBenchmark.h"
+#include "DrawRecordingBenchmark.h"
+#include "AssetLoadBenchmark.h"
+#include "CompressionBenchmark.h"
+#include "ConstantRingBenchmark.h"
+#include "FrameLoopBenchmark.h"
+#include "GpuProfilerBenchmark.h"
+#include "JobSystemBenchmark.h"
+#include "MathBenchmark.h"
+#include "MeshBenchmark.h"
+#include "MeshOptimizerBenchmark.h"
+#include "OcclusionBenchmark.h"
+#include "PixelBenchmark.h"
+#include "ProfilerBenchmark.h"
+#include "ShaderCacheCheck.h"
+#include "SoftwareRendererCheck.h"
+#include "TerrainBenchmark.h"
+#include "TextureCheck.h"
+#include "Texture.h"
+#include "DdsFile.h"
+#include "MeshImporter.h"
+#include "MeshFile.h"
+#include "MeshOptimizer.h"
+#include "JobSystem.h"
 
+#include <chrono>
+#include <sstream>
+
+namespace
+{
+	// Builds an asset archive at destination from the loose files under source.
+	void PackAssets(const std::string& source, const std::string& destination)
+	{
+		if (!AssetArchive::Pack(source.c_str(), destination.c_str()))
+			throw std::runtime_error(std::format("Failed to pack {} into {}", source, destination));
+	}
+
+	// Imports the OBJ or glTF model source, reorders it for the vertex cache and overdraw, and writes it as a cooked
+	// mesh to destination. Returns how much the reordering saves.
+	std::string CookMesh(const std::string& source, const std::string& destination)
+	{
+		MeshData mesh;
+		std::string error;
+		if (!MeshImporter::Import(source.c_str(), mesh, error))
+			throw std::runtime_error(error);
+
+		MeshOptimizer::Options options;
+		MeshOptimizer::VertexCacheStats before = MeshOptimizer::AnalyzeVertexCache(mesh.indices, mesh.vertices.size(), options.cacheSize);
+		double fetchBefore = MeshOptimizer::AnalyzeVertexFetch(mesh.indices, mesh.vertices.size(), sizeof(MeshData::Vertex));
+		MeshOptimizer::Optimize(mesh, options);
+		MeshOptimizer::VertexCacheStats after = MeshOptimizer::AnalyzeVertexCache(mesh.indices, mesh.vertices.size(), options.cacheSize);
+		double fetchAfter = MeshOptimizer::AnalyzeVertexFetch(mesh.indices, mesh.vertices.size(), sizeof(MeshData::Vertex));
+		if (!MeshFile::Save(mesh, destination.c_str()))
+			throw std::runtime_error(std::format("Failed to write the mesh {}", destination));
+
+		return std::format("{}: {} triangles, {} vertices\nACMR {:.3f} -> {:.3f}\nATVR {:.3f} -> {:.3f}\nOverfetch {:.2f} -> {:.2f}", destination,
+			mesh.indices.size() / 3u, mesh.vertices.size(), before.acmr, after.acmr, before.atvr, after.atvr, fetchBefore, fetchAfter);
+	}
+
+	// Decodes the TGA image source, builds its mip chain, compresses every level to BC7, and writes it as a DDS file to
+	// destination, which loads without the encoding TEXTURE_COMPRESSION would do at runtime. Returns what was written.
+	std::string CookTexture(const std::string& source, const std::string& destination)
+	{
+		auto start = std::chrono::steady_clock::now();
+		Texture::Image image;
+		if (!Texture::Decode(source.c_str(), Texture::Compression::BC7, nullptr, true, image))
+			throw std::runtime_error(std::format("Failed to load the texture {}", source));
+		double milliseconds = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+
+		DdsFile dds(image.format, image.width, image.height);
+		for (const DdsFile::Level& level : image.levels)
+			dds.AddLevel(level.data);
+		if (!dds.Save(destination.c_str()))
+			throw std::runtime_error(std::format("Failed to write the texture {}", destination));
+
+		return std::format("{}: {}x{}, {} levels of {}, {:.1f} KB encoded in {:.1f} ms", destination, image.width, image.height,
+			image.levels.size(), image.format == DdsFile::Format::BC7 ? "BC7" : "RGBA8", image.byteSize / 1024.0, milliseconds);
+	}
+}
+
+#ifdef _WIN32
 int WINAPI WinMain(HINSTANCE hInstance, HINSTANCE hPrevInstance, PSTR pScmdline, int iCmdshow)
 {
 	try
 	{
+		// Start the job system here, so this thread becomes its main thread.
+		JobSystem::GetDefault();
+
+		// "-pack <directory> <archive>" builds an asset archive instead of starting the engine.
+		std::istringstream arguments(pScmdline ? pScmdline : "");
+		std::string command, source, destination;
+		arguments >> command >> source >> destination;
+		if (command == "-pack")
+		{
+			if (source.empty())
+				source = ASSET_DIRECTORY;
+			if (destination.empty())
+				destination = ASSET_ARCHIVE;
+
+			PackAssets(source, destination);
+			return 0;
+		}
+
+		// "-cook-mesh <model> <mesh>" imports an OBJ or glTF model, reorders it for the vertex cache and overdraw, and
+		// writes it as a cooked mesh for MODEL_MESH, showing how much the reordering saves.
+		if (command == "-cook-mesh")
+		{
+			std::string report = CookMesh(source, destination);
+			MessageBoxA(nullptr, report.c_str(), "Cooked mesh", MB_OK);
+			return 0;
+		}
+
+		// "-cook-texture <image> <dds>" compresses a TGA image and its mips to BC7 and writes them as a DDS file for
+		// MODEL_TEXTURE, so the encoder too slow for load time runs once, offline.
+		if (command == "-cook-texture")
+		{
+			std::string report = CookTexture(source, destination);
+			MessageBoxA(nullptr, report.c_str(), "Cooked texture", MB_OK);
+			return 0;
+		}
+
+		// "-benchmark-scene" times scene updates and shows the results instead of starting the engine.
+		if (command == "-benchmark-scene")
+		{
+			std::ostringstream results;
+			RunSceneBenchmark(results);
+			MessageBoxA(nullptr, results.str().c_str(), "Scene benchmark", MB_OK);
+			return 0;
+		}
+
+		// "-benchmark-culling" times and cross-checks the frustum culling kernels.
+		if (command == "-benchmark-culling")
+		{
+			std::ostringstream results;
+			bool match = RunCullingBenchmark(results);
+			MessageBoxA(nullptr, results.str().c_str(), "Culling benchmark", MB_OK);
+			return match ? 0 : 1;
+		}
+
+		// "-benchmark-bvh" compares the bounding volume hierarchy with brute force culling and ray casts.
+		if (command == "-benchmark-bvh")
+		{
+			std::ostringstream results;
+			bool match = RunBvhBenchmark(results);
+			MessageBoxA(nullptr, results.str().c_str(), "Bounding volume hierarchy benchmark", MB_OK);
+			return match ? 0 : 1;
+		}
+
+		// "-benchmark-draw-list" times draw sorting and counts the state changes it saves.
+		if (command == "-benchmark-draw-list")
+		{
+			std::ostringstream results;
+			bool match = RunDrawListBenchmark(results);
+			MessageBoxA(nullptr, results.str().c_str(), "Draw list benchmark", MB_OK);
+			return match ? 0 : 1;
+		}
+
+		// "-benchmark-recording" checks draws recorded on several threads against draws recorded on one.
+		if (command == "-benchmark-recording")
+		{
+			std::ostringstream results;
+			bool match = RunDrawRecordingBenchmark(results);
+			MessageBoxA(nullptr, results.str().c_str(), "Draw recording benchmark", MB_OK);
+			return match ? 0 : 1;
+		}
+
+		// "-benchmark-math" times the batched math kernels and checks the math library against DirectXMath.
+		if (command == "-benchmark-math")
+		{
+			std::ostringstream results;
+			bool match = RunMathBenchmark(results);
+			MessageBoxA(nullptr, results.str().c_str(), "Math benchmark", MB_OK);
+			return match ? 0 : 1;
+		}
+
+		// "-benchmark-meshes" compares loading meshes from OBJ and glTF with loading them cooked.
+		if (command == "-benchmark-meshes")
+		{
+			std::ostringstream results;
+			bool match = RunMeshBenchmark(results);
+			MessageBoxA(nullptr, results.str().c_str(), "Mesh benchmark", MB_OK);
+			return match ? 0 : 1;
+		}
+
+		// "-benchmark-mesh-optimizer" measures what reordering meshes saves the vertex cache and in overdraw.
+		if (command == "-benchmark-mesh-optimizer")
+		{
+			std::ostringstream results;
+			bool match = RunMeshOptimizerBenchmark(results);
+			MessageBoxA(nullptr, results.str().c_str(), "Mesh optimizer benchmark", MB_OK);
+			return match ? 0 : 1;
+		}
+
+		// "-benchmark-occlusion" measures software occlusion culling against what a full resolution render sees.
+		if (command == "-benchmark-occlusion")
+		{
+			std::ostringstream results;
+			bool match = RunOcclusionBenchmark(results);
+			MessageBoxA(nullptr, results.str().c_str(), "Occlusion culling benchmark", MB_OK);
+			return match ? 0 : 1;
+		}
+
+		// "-benchmark-terrain" measures terrain LOD selection and streaming, and checks the chunks it chooses.
+		if (command == "-benchmark-terrain")
+		{
+			std::ostringstream results;
+			bool match = RunTerrainBenchmark(results);
+			MessageBoxA(nullptr, results.str().c_str(), "Terrain benchmark", MB_OK);
+			return match ? 0 : 1;
+		}
+
+		// "-benchmark-profiler" measures what a profiler marker costs and checks the call tree and trace it records.
+		if (command == "-benchmark-profiler")
+		{
+			std::ostringstream results;
+			bool match = RunProfilerBenchmark(results);
+			MessageBoxA(nullptr, results.str().c_str(), "Profiler benchmark", MB_OK);
+			return match ? 0 : 1;
+		}
+
+		// "-benchmark-frame-loop" checks fixed steps, interpolation and the frame rate limiter on a simulated clock.
+		if (command == "-benchmark-frame-loop")
+		{
+			std::ostringstream results;
+			bool match = RunFrameLoopBenchmark(results);
+			MessageBoxA(nullptr, results.str().c_str(), "Frame loop benchmark", MB_OK);
+			return match ? 0 : 1;
+		}
+
+		// "-benchmark-gpu-profiler" checks GPU timing on a simulated GPU: the query ring, and alignment with CPU time.
+		if (command == "-benchmark-gpu-profiler")
+		{
+			std::ostringstream results;
+			bool match = RunGpuProfilerBenchmark(results);
+			MessageBoxA(nullptr, results.str().c_str(), "GPU profiler benchmark", MB_OK);
+			return match ? 0 : 1;
+		}
+
+		// "-benchmark-jobs" measures how the engine's parallel work scales with the number of threads.
+		if (command == "-benchmark-jobs")
+		{
+			std::ostringstream results;
+			bool match = RunJobSystemBenchmark(results);
+			MessageBoxA(nullptr, results.str().c_str(), "Job system benchmark", MB_OK);
+			return match ? 0 : 1;
+		}
+
+		// "-benchmark-pixels" times the TGA flip and swizzle kernels against the old loop and checks them against the scalar one.
+		if (command == "-benchmark-pixels")
+		{
+			std::ostringstream results;
+			bool match = RunPixelBenchmark(results);
+			MessageBoxA(nullptr, results.str().c_str(), "Pixel conversion benchmark", MB_OK);
+			return match ? 0 : 1;
+		}
+
+		// "-check-textures" decodes TGA variants built in memory against their pixels, rejects damaged files and checks the mip generator.
+		if (command == "-check-textures")
+		{
+			std::ostringstream results;
+			bool match = RunTextureCheck(results);
+			MessageBoxA(nullptr, results.str().c_str(), "Texture check", MB_OK);
+			return match ? 0 : 1;
+		}
+
+		// "-benchmark-compression" measures the quality and speed of the BC1, BC3 and BC7 encoders on the shipped textures and a gradient.
+		if (command == "-benchmark-compression")
+		{
+			std::ostringstream results;
+			bool match = RunCompressionBenchmark(ASSET_DIRECTORY, results);
+			MessageBoxA(nullptr, results.str().c_str(), "Compression benchmark", MB_OK);
+			return match ? 0 : 1;
+		}
+
+		// "-benchmark-assets" times cold and warm loads of the asset set from the loose files and from a packed archive.
+		if (command == "-benchmark-assets")
+		{
+			std::ostringstream results;
+			bool match = RunAssetLoadBenchmark(ASSET_DIRECTORY, results);
+			MessageBoxA(nullptr, results.str().c_str(), "Asset load benchmark", MB_OK);
+			return match ? 0 : 1;
+		}
+
+		// "-check-shader-cache" runs the shader cache against a stub compiler through edits and damaged cache files.
+		if (command == "-check-shader-cache")
+		{
+			std::ostringstream results;
+			bool match = RunShaderCacheCheck(results);
+			MessageBoxA(nullptr, results.str().c_str(), "Shader cache check", MB_OK);
+			return match ? 0 : 1;
+		}
+
+		// "-benchmark-constant-ring" checks RingAllocator against a reference model and compares ring offsets with discard-per-draw.
+		if (command == "-benchmark-constant-ring")
+		{
+			std::ostringstream results;
+			bool match = RunConstantRingBenchmark(results);
+			MessageBoxA(nullptr, results.str().c_str(), "Constant ring benchmark", MB_OK);
+			return match ? 0 : 1;
+		}
+
+		// "-check-software-renderer" draws a frame with the software renderer, without a window, and checks its pixels.
+		if (command == "-check-software-renderer")
+		{
+			std::ostringstream results;
+			bool match = RunSoftwareRendererCheck(results);
+			MessageBoxA(nullptr, results.str().c_str(), "Software renderer check", MB_OK);
+			return match ? 0 : 1;
+		}
+
 		System System;
 
 		System.Run();
@@ -15,4 +326,111 @@ int WINAPI WinMain(HINSTANCE hInstance, HINSTANCE hPrevInstance, PSTR pScmdline,
 		MessageBoxA(nullptr, e.what(), "Error", MB_OK);
 		return 1;
 	}
-}
\ No newline at end of file
+}
+#else
+namespace
+{
+	// The modes that need neither a window nor Direct3D, which are all the engine has without Windows.
+	struct HeadlessMode
+	{
+		const char* command;
+		bool (*run)(std::ostream& output);
+	};
+
+	const HeadlessMode HEADLESS_MODES[] =
+	{
+		{ "-benchmark-scene", [](std::ostream& output) { RunSceneBenchmark(output); return true; } },
+		{ "-benchmark-culling", RunCullingBenchmark },
+		{ "-benchmark-bvh", RunBvhBenchmark },
+		{ "-benchmark-draw-list", RunDrawListBenchmark },
+		{ "-benchmark-recording", RunDrawRecordingBenchmark },
+		{ "-benchmark-math", RunMathBenchmark },
+		{ "-benchmark-meshes", RunMeshBenchmark },
+		{ "-benchmark-mesh-optimizer", RunMeshOptimizerBenchmark },
+		{ "-benchmark-occlusion", RunOcclusionBenchmark },
+		{ "-benchmark-terrain", RunTerrainBenchmark },
+		{ "-benchmark-profiler", RunProfilerBenchmark },
+		{ "-benchmark-frame-loop", RunFrameLoopBenchmark },
+		{ "-benchmark-gpu-profiler", RunGpuProfilerBenchmark },
+		{ "-benchmark-jobs", RunJobSystemBenchmark },
+		{ "-benchmark-pixels", RunPixelBenchmark },
+		{ "-check-textures", RunTextureCheck },
+		{ "-check-shader-cache", RunShaderCacheCheck },
+		{ "-benchmark-constant-ring", RunConstantRingBenchmark },
+		{ "-check-software-renderer", RunSoftwareRendererCheck },
+	};
+
+	// Modes that read the loose asset files. ASSET_DIRECTORY is one of the Windows application's settings, so here the
+	// directory comes from the command line.
+	struct HeadlessAssetMode
+	{
+		const char* command;
+		bool (*run)(const char* assetDirectory, std::ostream& output);
+	};
+
+	const HeadlessAssetMode HEADLESS_ASSET_MODES[] =
+	{
+		{ "-benchmark-compression", RunCompressionBenchmark },
+		{ "-benchmark-assets", RunAssetLoadBenchmark },
+	};
+
+	// Tools that write a file made from another, without the Windows application's default paths to fall back on.
+	struct HeadlessTool
+	{
+		const char* command;
+		const char* arguments;
+		void (*run)(const std::string& source, const std::string& destination, std::ostream& output);
+	};
+
+	const HeadlessTool HEADLESS_TOOLS[] =
+	{
+		{ "-pack", "<directory> <archive>", [](const std::string& source, const std::string& destination, std::ostream&) { PackAssets(source, destination); } },
+		{ "-cook-mesh", "<model> <mesh>", [](const std::string& source, const std::string& destination, std::ostream& output) { output << CookMesh(source, destination) << std::endl; } },
+		{ "-cook-texture", "<image> <dds>", [](const std::string& source, const std::string& destination, std::ostream& output) { output << CookTexture(source, destination) << std::endl; } },
+	};
+}
+
+// Without Windows the engine runs one of its headless modes from the command line and prints what it finds.
+int main(int argc, char* argv[])
+{
+	try
+	{
+		// Start the job system here, so this thread becomes its main thread.
+		JobSystem::GetDefault();
+
+		std::string command = argc > 1 ? argv[1] : "";
+		for (const HeadlessMode& mode : HEADLESS_MODES)
+		{
+			if (command == mode.command)
+				return mode.run(std::cout) ? 0 : 1;
+		}
+		for (const HeadlessAssetMode& mode : HEADLESS_ASSET_MODES)
+		{
+			if (command == mode.command && argc > 2)
+				return mode.run(argv[2], std::cout) ? 0 : 1;
+		}
+		for (const HeadlessTool& tool : HEADLESS_TOOLS)
+		{
+			if (command == tool.command && argc > 3)
+			{
+				tool.run(argv[2], argv[3], std::cout);
+				return 0;
+			}
+		}
+
+		std::cerr << "Usage: Engine <mode>, where the mode is one of:" << std::endl;
+		for (const HeadlessMode& mode : HEADLESS_MODES)
+			std::cerr << std::format("  {}", mode.command) << std::endl;
+		for (const HeadlessAssetMode& mode : HEADLESS_ASSET_MODES)
+			std::cerr << std::format("  {} <asset directory>", mode.command) << std::endl;
+		for (const HeadlessTool& tool : HEADLESS_TOOLS)
+			std::cerr << std::format("  {} {}", tool.command, tool.arguments) << std::endl;
+		return 1;
+	}
+	catch (const std::exception& e)
+	{
+		std::cerr << e.what() << std::endl;
+		return 1;
+	}
+}
+#endif
\ No newline at end of file
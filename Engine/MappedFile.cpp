@@ -0,0 +1,78 @@
+#include "MappedFile.h"
+
+#ifdef _WIN32
+#define WIN32_LEAN_AND_MEAN
+#define NOMINMAX
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+MappedFile::MappedFile(const char* filename)
+{
+#ifdef _WIN32
+	HANDLE file = CreateFileA(filename, GENERIC_READ, FILE_SHARE_READ, nullptr, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, nullptr);
+	if (file == INVALID_HANDLE_VALUE)
+		return;
+
+	LARGE_INTEGER fileSize;
+	HANDLE mapping = nullptr;
+	if (GetFileSizeEx(file, &fileSize) && fileSize.QuadPart > 0)
+		mapping = CreateFileMappingA(file, nullptr, PAGE_READONLY, 0u, 0u, nullptr);
+
+	// The view keeps the file open, so both handles can be closed straight away.
+	if (mapping)
+	{
+		_view = (const uchar*)MapViewOfFile(mapping, FILE_MAP_READ, 0u, 0u, 0u);
+		_size = _view ? (size_t)fileSize.QuadPart : 0u;
+		CloseHandle(mapping);
+	}
+	CloseHandle(file);
+#else
+	int file = open(filename, O_RDONLY);
+	if (file < 0)
+		return;
+
+	struct stat status;
+	if (fstat(file, &status) == 0 && status.st_size > 0)
+	{
+		void* view = mmap(nullptr, (size_t)status.st_size, PROT_READ, MAP_PRIVATE, file, 0);
+		if (view != MAP_FAILED)
+		{
+			_view = (const uchar*)view;
+			_size = (size_t)status.st_size;
+		}
+	}
+	close(file);
+#endif
+}
+
+MappedFile::~MappedFile()
+{
+	if (!_view)
+		return;
+
+#ifdef _WIN32
+	UnmapViewOfFile(_view);
+#else
+	munmap((void*)_view, _size);
+#endif
+}
+
+bool MappedFile::IsValid() const
+{
+	return _view != nullptr;
+}
+
+const uchar* MappedFile::GetData() const
+{
+	return _view;
+}
+
+size_t MappedFile::GetSize() const
+{
+	return _size;
+}
@@ -0,0 +1,26 @@
+#pragma once
+
+#include "Common.h"
+
+// Read-only memory mapping of a whole file. The pages are only read from disk when first touched, and the
+// OS file cache is shared between runs, so opening a large file costs next to nothing.
+class MappedFile
+{
+public:
+
+	// Maps the file. Check IsValid; a missing or empty file leaves the mapping empty.
+	MappedFile(const char* filename);
+	~MappedFile();
+
+	MappedFile(const MappedFile&) = delete;
+	MappedFile& operator=(const MappedFile&) = delete;
+
+	bool IsValid() const;
+	const uchar* GetData() const;
+	size_t GetSize() const;
+
+private:
+
+	const uchar* _view = nullptr;
+	size_t _size = 0u;
+};
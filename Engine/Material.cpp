@@ -0,0 +1,53 @@
+#include "Material.h"
+
+#include <atomic>
+
+namespace
+{
+	std::atomic<uint> nextMaterialId = 1u;
+}
+
+Material::Material(std::shared_ptr<ShaderProgram> program)
+	: _id(nextMaterialId++)
+	, _program(std::move(program))
+{
+}
+
+void Material::SetTexture(uint slot, std::shared_ptr<Texture> texture)
+{
+	if (slot == ShaderProgram::INVALID_SLOT)
+		return;
+
+	if (_textures.size() <= slot)
+		_textures.resize(slot + 1u);
+	_textures[slot] = std::move(texture);
+}
+
+void Material::SetInstancedProgram(std::shared_ptr<ShaderProgram> program)
+{
+	_instancedProgram = std::move(program);
+}
+
+ShaderProgram& Material::GetProgram()
+{
+	return *_program;
+}
+
+ShaderProgram* Material::GetInstancedProgram()
+{
+	return _instancedProgram.get();
+}
+
+uint Material::GetId() const
+{
+	return _id;
+}
+
+void Material::Bind(RenderBackend& renderer)
+{
+	for (uint slot = 0u; slot < _textures.size(); ++slot)
+	{
+		if (_textures[slot])
+			renderer.SetTexture(slot, _textures[slot]->GetBinding());
+	}
+}
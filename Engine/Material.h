@@ -0,0 +1,38 @@
+#pragma once
+
+#include "Common.h"
+#include "RenderBackend.h"
+#include "ShaderProgram.h"
+#include "Texture.h"
+
+// What a surface looks like: the shader program that draws it and the textures bound to the program's slots.
+// Materials are shared between any number of models; DrawList sorts draws by program and material id to bind each once.
+class Material
+{
+public:
+
+	Material(std::shared_ptr<ShaderProgram> program);
+
+	// Binds the texture to a pixel shader slot, found with ShaderProgram::FindTexture.
+	void SetTexture(uint slot, std::shared_ptr<Texture> texture);
+
+	// Program for drawing many copies of a model at once, reading each copy's world matrix and texture offset from the
+	// instance stream. Without one, DrawList draws every copy on its own.
+	void SetInstancedProgram(std::shared_ptr<ShaderProgram> program);
+
+	ShaderProgram& GetProgram();
+	ShaderProgram* GetInstancedProgram();
+
+	// Unique per material, so draws can be sorted to bind each material once.
+	uint GetId() const;
+
+	// Binds the textures. The program is bound separately, since consecutive materials often share it.
+	void Bind(RenderBackend& renderer);
+
+private:
+
+	uint _id = 0u;
+	std::shared_ptr<ShaderProgram> _program;
+	std::shared_ptr<ShaderProgram> _instancedProgram;
+	std::vector<std::shared_ptr<Texture>> _textures; // Indexed by slot; empty slots are left as they are.
+};
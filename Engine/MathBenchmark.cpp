@@ -0,0 +1,232 @@
+#include "MathBenchmark.h"
+#include "EngineMath.h"
+
+#include <algorithm>
+#include <bit>
+#include <chrono>
+#include <random>
+#include <string.h>
+
+#if __has_include(<directxmath.h>)
+#include "MathDirectX.h"
+#define MATH_BENCHMARK_DIRECTXMATH
+#endif
+
+namespace
+{
+	const uint COUNTS[] = { 1000u, 100000u, 1000000u };
+	const uint REPETITIONS = 10u;
+	const uint COMPARISONS = 100000u;	// Random inputs each function is compared with DirectXMath on.
+
+	template <typename Run>
+	double Measure(Run run)
+	{
+		double total = 0.0;
+		for (uint i = 0u; i < REPETITIONS; ++i)
+		{
+			auto start = std::chrono::steady_clock::now();
+			run();
+			total += std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+		}
+		return total / REPETITIONS;
+	}
+
+#if defined(MATH_BENCHMARK_DIRECTXMATH)
+	using namespace DirectX;
+
+	// Floats between a and b, 0 when they have the same bits or are both zero.
+	uint64_t UlpDistance(float a, float b)
+	{
+		// Map the floats to integers that keep their order, negative ones below positive ones.
+		auto ordered = [](float value)
+		{
+			int64_t bits = std::bit_cast<int32_t>(value);
+			return bits < 0 ? (int64_t)INT32_MIN - bits : bits;
+		};
+		int64_t distance = ordered(a) - ordered(b);
+		return (uint64_t)(distance < 0 ? -distance : distance);
+	}
+
+	uint64_t UlpDistance(const float* a, const float* b, uint count)
+	{
+		uint64_t largest = 0u;
+		for (uint i = 0u; i < count; ++i)
+			largest = std::max(largest, UlpDistance(a[i], b[i]));
+		return largest;
+	}
+
+	uint64_t UlpDistance(const Math::Matrix4& a, const XMMATRIX& b)
+	{
+		Math::Matrix4 converted = Math::FromXMMATRIX(b);
+		return UlpDistance(&a.m[0][0], &converted.m[0][0], 16u);
+	}
+
+	uint64_t UlpDistance(const Math::Float4& a, XMVECTOR b)
+	{
+		XMFLOAT4 stored;
+		XMStoreFloat4(&stored, b);
+		return UlpDistance(&a.x, &stored.x, 4u);
+	}
+
+	XMVECTOR Load(const Math::Float3& v)
+	{
+		return XMVectorSet(v.x, v.y, v.z, 0.0f);
+	}
+
+	XMVECTOR Load(const Math::Quaternion& q)
+	{
+		return XMVectorSet(q.x, q.y, q.z, q.w);
+	}
+
+	// Compares every function with its DirectXMath counterpart on random inputs. Returns false if any differs.
+	bool CompareWithDirectXMath(std::ostream& output, std::mt19937& random)
+	{
+		std::uniform_real_distribution<float> coordinate(-100.0f, 100.0f);
+		std::uniform_real_distribution<float> angle(-10.0f, 10.0f);
+		std::uniform_real_distribution<float> unit(0.01f, 1.0f);
+		auto randomFloat3 = [&] { return Math::Float3(coordinate(random), coordinate(random), coordinate(random)); };
+		auto randomMatrix = [&]
+		{
+			Math::Matrix4 m;
+			for (auto& row : m.m)
+			{
+				for (float& value : row)
+					value = coordinate(random);
+			}
+			return m;
+		};
+
+		struct Comparison
+		{
+			const char* name;
+			uint64_t largest = 0u;
+		};
+		Comparison comparisons[] = { { "SinCos" }, { "LookAtLH" }, { "PerspectiveFovLH" }, { "OrthographicLH" }, { "Multiply" },
+			{ "TransformPoint" }, { "RotationAxis" }, { "Multiply (quaternion)" }, { "Normalize (quaternion)" }, { "Rotation" }, { "Rotate" } };
+
+		for (uint i = 0u; i < COMPARISONS; ++i)
+		{
+			uint c = 0u;
+			auto record = [&](uint64_t distance)
+			{
+				comparisons[c].largest = std::max(comparisons[c].largest, distance);
+				c++;
+			};
+
+			float radians = angle(random);
+			float sine, cosine, xmSine, xmCosine;
+			Math::SinCos(radians, sine, cosine);
+			XMScalarSinCos(&xmSine, &xmCosine, radians);
+			record(std::max(UlpDistance(sine, xmSine), UlpDistance(cosine, xmCosine)));
+
+			Math::Float3 eye = randomFloat3(), focus = randomFloat3(), up = randomFloat3();
+			record(UlpDistance(Math::LookAtLH(eye, focus, up),
+				XMMatrixLookAtLH(Load(eye), Load(focus), Load(up))));
+
+			float fov = unit(random) * 3.0f, aspect = unit(random) * 3.0f, nearZ = unit(random), farZ = nearZ + unit(random) * 1000.0f;
+			record(UlpDistance(Math::PerspectiveFovLH(fov, aspect, nearZ, farZ),
+				XMMatrixPerspectiveFovLH(fov, aspect, nearZ, farZ)));
+
+			float width = unit(random) * 4096.0f, height = unit(random) * 4096.0f;
+			record(UlpDistance(Math::OrthographicLH(width, height, nearZ, farZ),
+				XMMatrixOrthographicLH(width, height, nearZ, farZ)));
+
+			Math::Matrix4 a = randomMatrix(), b = randomMatrix();
+			record(UlpDistance(Math::Multiply(a, b),
+				XMMatrixMultiply(Math::ToXMMATRIX(a), Math::ToXMMATRIX(b))));
+
+			Math::Float3 point = randomFloat3();
+			record(UlpDistance(Math::TransformPoint(point, a),
+				XMVector3Transform(Load(point), Math::ToXMMATRIX(a))));
+
+			Math::Float3 axis = randomFloat3();
+			Math::Quaternion q = Math::RotationAxis(axis, radians);
+			record(UlpDistance(Math::Float4(q.x, q.y, q.z, q.w),
+				XMQuaternionRotationAxis(Load(axis), radians)));
+
+			Math::Quaternion r = Math::RotationAxis(randomFloat3(), angle(random));
+			Math::Quaternion product = Math::Multiply(q, r);
+			record(UlpDistance(Math::Float4(product.x, product.y, product.z, product.w),
+				XMQuaternionMultiply(Load(q), Load(r))));
+
+			Math::Quaternion unnormalized(coordinate(random), coordinate(random), coordinate(random), coordinate(random));
+			Math::Quaternion normalized = Math::Normalize(unnormalized);
+			record(UlpDistance(Math::Float4(normalized.x, normalized.y, normalized.z, normalized.w),
+				XMQuaternionNormalize(Load(unnormalized))));
+
+			record(UlpDistance(Math::Rotation(q), XMMatrixRotationQuaternion(Load(q))));
+
+			Math::Float3 rotated = Math::Rotate(point, q);
+			record(UlpDistance(Math::Float4(rotated.x, rotated.y, rotated.z, 0.0f),
+				XMVectorSetW(XMVector3Rotate(Load(point), Load(q)), 0.0f)));
+		}
+
+		bool allMatch = true;
+		std::string line = std::format("Largest difference from DirectXMath over {} random inputs, in units in the last place:", COMPARISONS);
+		for (const Comparison& comparison : comparisons)
+		{
+			line += std::format(" {} {},", comparison.name, comparison.largest);
+			allMatch = allMatch && comparison.largest == 0u;
+		}
+		line.pop_back();
+		output << line << std::endl;
+		return allMatch;
+	}
+#endif
+}
+
+bool RunMathBenchmark(std::ostream& output)
+{
+	output << std::format("Batched math kernels, {} against scalar, average of {} runs", Math::GetKernelName(), REPETITIONS) << std::endl;
+
+	bool allMatch = true;
+	std::mt19937 random(1u);
+	std::uniform_real_distribution<float> coordinate(-100.0f, 100.0f);
+
+	for (uint count : COUNTS)
+	{
+		std::vector<Math::Float3> points(count);
+		for (Math::Float3& point : points)
+			point = Math::Float3(coordinate(random), coordinate(random), coordinate(random));
+
+		std::vector<Math::Matrix4> a(count), b(count);
+		for (uint i = 0u; i < count; ++i)
+		{
+			a[i] = Math::Multiply(Math::Rotation(Math::RotationAxis(points[i], coordinate(random))), Math::Translation(coordinate(random), 0.0f, 1.0f));
+			b[i] = Math::Multiply(Math::Scaling(2.0f, 3.0f, 4.0f), Math::Translation(0.0f, coordinate(random), coordinate(random)));
+		}
+		Math::Matrix4 viewProjection = Math::Multiply(Math::LookAtLH(Math::Float3(0.0f, 0.0f, -200.0f), Math::Float3(), Math::Float3(0.0f, 1.0f, 0.0f)),
+			Math::PerspectiveFovLH(Math::PI / 4.0f, 16.0f / 9.0f, 0.3f, 1000.0f));
+
+		std::vector<Math::Float4> transformed(count), transformedScalar(count);
+		std::vector<Math::Matrix4> products(count), productsScalar(count);
+		double transformScalar = Measure([&] { Math::TransformPointsScalar(viewProjection, points.data(), transformedScalar.data(), count); });
+		double transformKernel = Measure([&] { Math::TransformPoints(viewProjection, points.data(), transformed.data(), count); });
+		double multiplyScalar = Measure([&] { Math::MultiplyMatricesScalar(a.data(), b.data(), productsScalar.data(), count); });
+		double multiplyKernel = Measure([&] { Math::MultiplyMatrices(a.data(), b.data(), products.data(), count); });
+
+		// The single operations must agree with the kernels too.
+		bool transformsMatch = memcmp(transformed.data(), transformedScalar.data(), count * sizeof(Math::Float4)) == 0;
+		bool productsMatch = memcmp(products.data(), productsScalar.data(), count * sizeof(Math::Matrix4)) == 0;
+		for (uint i = 0u; i < count; i += 997u)
+		{
+			Math::Float4 single = Math::TransformPoint(points[i], viewProjection);
+			Math::Matrix4 product = Math::Multiply(a[i], b[i]);
+			transformsMatch = transformsMatch && memcmp(&single, &transformedScalar[i], sizeof(single)) == 0;
+			productsMatch = productsMatch && memcmp(&product, &productsScalar[i], sizeof(product)) == 0;
+		}
+		allMatch = allMatch && transformsMatch && productsMatch;
+
+		output << std::format("{:>8} points: transform {:8.3f} ms scalar, {:8.3f} ms ({:.2f}x){}; multiply {:8.3f} ms scalar, {:8.3f} ms ({:.2f}x){}",
+			count, transformScalar, transformKernel, transformScalar / transformKernel, transformsMatch ? "" : " MISMATCH",
+			multiplyScalar, multiplyKernel, multiplyScalar / multiplyKernel, productsMatch ? "" : " MISMATCH") << std::endl;
+	}
+
+#if defined(MATH_BENCHMARK_DIRECTXMATH)
+	allMatch = CompareWithDirectXMath(output, random) && allMatch;
+#else
+	output << "DirectXMath is not available; skipped the comparison with it" << std::endl;
+#endif
+
+	return allMatch;
+}
@@ -0,0 +1,11 @@
+#pragma once
+
+#include <ostream>
+#include "Common.h"
+
+// Times the batched math kernels, transforming 1k to 1M points and multiplying as many matrices, against their scalar
+// references, and checks that both give the same bits. Where DirectXMath is available, also builds random view,
+// projection, rotation and product matrices with the engine's math and with DirectXMath and reports the largest
+// difference in units in the last place. Run with "Engine.exe -benchmark-math". Returns false if a kernel differs from
+// its reference or a result differs from DirectXMath's.
+bool RunMathBenchmark(std::ostream& output);
@@ -0,0 +1,27 @@
+#pragma once
+
+#include <directxmath.h>
+#include <string.h>
+#include "EngineMath.h"
+
+// Conversions between the engine's math types and DirectXMath's, for code that still meets DirectXMath, such as the math
+// benchmark checking the library against it. Everything else uses Math:: alone. The layouts match, so the values are
+// copied bit for bit.
+namespace Math
+{
+	inline DirectX::XMMATRIX ToXMMATRIX(const Matrix4& matrix)
+	{
+		DirectX::XMFLOAT4X4 stored;
+		memcpy(stored.m, matrix.m, sizeof(stored.m));
+		return DirectX::XMLoadFloat4x4(&stored);
+	}
+
+	inline Matrix4 FromXMMATRIX(const DirectX::XMMATRIX& matrix)
+	{
+		DirectX::XMFLOAT4X4 stored;
+		DirectX::XMStoreFloat4x4(&stored, matrix);
+		Matrix4 result;
+		memcpy(result.m, stored.m, sizeof(result.m));
+		return result;
+	}
+}
@@ -0,0 +1,356 @@
+#include "MeshBenchmark.h"
+#include "EngineMath.h"
+#include "MeshFile.h"
+#include "MeshImporter.h"
+
+#include <chrono>
+#include <filesystem>
+#include <math.h>
+#include <string.h>
+
+namespace
+{
+	struct TorusSize
+	{
+		uint segments;	// Around the ring. Powers of two, so texture coordinates and their complements are exact.
+		uint sides;		// Around the tube.
+	};
+
+	const TorusSize TORUS_SIZES[] = { { 256u, 128u }, { 1024u, 512u } };
+	const uint LOAD_RUNS = 3u;
+
+	double MillisecondsSince(std::chrono::steady_clock::time_point start)
+	{
+		return std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+	}
+
+	// A mesh as the files hold it: right-handed, counter-clockwise, texture coordinates from the top left.
+	struct SourceMesh
+	{
+		std::vector<float> positions;
+		std::vector<float> texcoords;
+		std::vector<uint> indices;
+
+		size_t GetVertexCount() const
+		{
+			return positions.size() / 3u;
+		}
+	};
+
+	SourceMesh MakeTorus(const TorusSize& size)
+	{
+		const float ringRadius = 3.0f;
+		const float tubeRadius = 1.0f;
+
+		SourceMesh torus;
+		for (uint side = 0u; side <= size.sides; ++side)
+		{
+			for (uint segment = 0u; segment <= size.segments; ++segment)
+			{
+				float u = (float)segment / size.segments;
+				float v = (float)side / size.sides;
+				float ringAngle = u * Math::TWO_PI;
+				float tubeAngle = v * Math::TWO_PI;
+				float distance = ringRadius + tubeRadius * cosf(tubeAngle);
+				torus.positions.insert(torus.positions.end(), { distance * cosf(ringAngle), tubeRadius * sinf(tubeAngle), distance * sinf(ringAngle) });
+				torus.texcoords.insert(torus.texcoords.end(), { u, v });
+			}
+		}
+
+		const uint row = size.segments + 1u;
+		for (uint side = 0u; side < size.sides; ++side)
+		{
+			for (uint segment = 0u; segment < size.segments; ++segment)
+			{
+				uint corner = side * row + segment;
+				torus.indices.insert(torus.indices.end(), { corner, corner + 1u, corner + row + 1u, corner, corner + row + 1u, corner + row });
+			}
+		}
+		return torus;
+	}
+
+	struct Error
+	{
+		float position = 0.0f;
+		float texcoord = 0.0f;
+		bool sameTriangles = true;
+	};
+
+	// Compares the triangles of an imported mesh with the source, corner by corner, after the importers' change to
+	// left-handed, clockwise triangles. offset is added to the source positions first.
+	Error CompareTriangles(const MeshData& mesh, const SourceMesh& source, const Math::Float3& offset)
+	{
+		Error error;
+		if (mesh.indices.size() != source.indices.size())
+		{
+			error.sameTriangles = false;
+			return error;
+		}
+
+		const uint reversedCorner[3] = { 0u, 2u, 1u };
+		for (size_t i = 0u; i < mesh.indices.size(); ++i)
+		{
+			if (mesh.indices[i] >= mesh.vertices.size())
+			{
+				error.sameTriangles = false;
+				return error;
+			}
+
+			const MeshData::Vertex& vertex = mesh.vertices[mesh.indices[i]];
+			uint expected = source.indices[i - i % 3u + reversedCorner[i % 3u]];
+			float position[3] = { source.positions[expected * 3u] + offset.x, source.positions[expected * 3u + 1u] + offset.y,
+				-(source.positions[expected * 3u + 2u] + offset.z) };
+			for (uint axis = 0u; axis < 3u; ++axis)
+				error.position = fmaxf(error.position, fabsf(vertex.position[axis] - position[axis]));
+			for (uint axis = 0u; axis < 2u; ++axis)
+				error.texcoord = fmaxf(error.texcoord, fabsf(vertex.texcoord[axis] - source.texcoords[expected * 2u + axis]));
+		}
+		return error;
+	}
+
+	bool WriteFile(const std::filesystem::path& path, const void* data, size_t size)
+	{
+		std::ofstream file(path, std::ios::binary);
+		file.write((const char*)data, (std::streamsize)size);
+		return (bool)file;
+	}
+
+	// OBJ counts texture coordinates up from the bottom left, so v is flipped on the way out.
+	bool WriteObj(const SourceMesh& source, const std::filesystem::path& path)
+	{
+		std::string text;
+		for (size_t i = 0u; i < source.GetVertexCount(); ++i)
+			text += std::format("v {} {} {}\n", source.positions[i * 3u], source.positions[i * 3u + 1u], source.positions[i * 3u + 2u]);
+		for (size_t i = 0u; i < source.GetVertexCount(); ++i)
+			text += std::format("vt {} {}\n", source.texcoords[i * 2u], 1.0f - source.texcoords[i * 2u + 1u]);
+		for (size_t i = 0u; i < source.indices.size(); i += 3u)
+		{
+			uint a = source.indices[i] + 1u, b = source.indices[i + 1u] + 1u, c = source.indices[i + 2u] + 1u;
+			text += std::format("f {}/{} {}/{} {}/{}\n", a, a, b, b, c, c);
+		}
+		return WriteFile(path, text.data(), text.size());
+	}
+
+	void Append(std::vector<uchar>& bytes, const void* data, size_t size)
+	{
+		bytes.insert(bytes.end(), (const uchar*)data, (const uchar*)data + size);
+	}
+
+	// The binary buffer of a glTF file: positions, texture coordinates, then indices when there are any.
+	std::vector<uchar> MakeGltfBuffer(const SourceMesh& source, bool indexed)
+	{
+		std::vector<uchar> buffer;
+		Append(buffer, source.positions.data(), source.positions.size() * sizeof(float));
+		Append(buffer, source.texcoords.data(), source.texcoords.size() * sizeof(float));
+		if (indexed)
+			Append(buffer, source.indices.data(), source.indices.size() * sizeof(uint));
+		return buffer;
+	}
+
+	// JSON for one mesh read from buffer 0, laid out as MakeGltfBuffer does, under the given nodes.
+	std::string MakeGltfJson(const SourceMesh& source, bool indexed, const std::string& bufferUri, const std::string& nodes)
+	{
+		size_t vertexCount = source.GetVertexCount();
+		size_t positionBytes = source.positions.size() * sizeof(float);
+		size_t texcoordBytes = source.texcoords.size() * sizeof(float);
+		size_t indexBytes = indexed ? source.indices.size() * sizeof(uint) : 0u;
+
+		std::string json = "{\"asset\":{\"version\":\"2.0\"},\"scene\":0,\"scenes\":[{\"nodes\":[0]}]," + nodes + ",";
+		json += std::format("\"meshes\":[{{\"primitives\":[{{\"attributes\":{{\"POSITION\":0,\"TEXCOORD_0\":1}}{}}}]}}],", indexed ? ",\"indices\":2" : "");
+		json += std::format("\"buffers\":[{{{}\"byteLength\":{}}}],", bufferUri, positionBytes + texcoordBytes + indexBytes);
+		json += std::format("\"bufferViews\":[{{\"buffer\":0,\"byteLength\":{}}},{{\"buffer\":0,\"byteOffset\":{},\"byteLength\":{}}}", positionBytes,
+			positionBytes, texcoordBytes);
+		if (indexed)
+			json += std::format(",{{\"buffer\":0,\"byteOffset\":{},\"byteLength\":{}}}", positionBytes + texcoordBytes, indexBytes);
+		json += std::format("],\"accessors\":[{{\"bufferView\":0,\"componentType\":5126,\"count\":{},\"type\":\"VEC3\"}},"
+			"{{\"bufferView\":1,\"componentType\":5126,\"count\":{},\"type\":\"VEC2\"}}", vertexCount, vertexCount);
+		if (indexed)
+			json += std::format(",{{\"bufferView\":2,\"componentType\":5125,\"count\":{},\"type\":\"SCALAR\"}}", source.indices.size());
+		return json + "]}";
+	}
+
+	std::vector<uchar> MakeGlb(const SourceMesh& source)
+	{
+		std::string json = MakeGltfJson(source, true, "", "\"nodes\":[{\"mesh\":0}]");
+		std::vector<uchar> buffer = MakeGltfBuffer(source, true);
+		json.resize((json.size() + 3u) / 4u * 4u, ' ');
+		buffer.resize((buffer.size() + 3u) / 4u * 4u, 0u);
+
+		const uint32_t header[3] = { 0x46546C67u, 2u, (uint32_t)(12u + 8u + json.size() + 8u + buffer.size()) };
+		const uint32_t jsonChunk[2] = { (uint32_t)json.size(), 0x4E4F534Au };
+		const uint32_t binaryChunk[2] = { (uint32_t)buffer.size(), 0x004E4942u };
+
+		std::vector<uchar> glb;
+		Append(glb, header, sizeof(header));
+		Append(glb, jsonChunk, sizeof(jsonChunk));
+		Append(glb, json.data(), json.size());
+		Append(glb, binaryChunk, sizeof(binaryChunk));
+		Append(glb, buffer.data(), buffer.size());
+		return glb;
+	}
+
+	std::string EncodeBase64(const std::vector<uchar>& bytes)
+	{
+		const char* digits = "ABCDEFGHIJKLMNOPQRSTUVWXYZabcdefghijklmnopqrstuvwxyz0123456789+/";
+		std::string text;
+		for (size_t i = 0u; i < bytes.size(); i += 3u)
+		{
+			uint32_t bits = (uint32_t)bytes[i] << 16;
+			if (i + 1u < bytes.size())
+				bits |= (uint32_t)bytes[i + 1u] << 8;
+			if (i + 2u < bytes.size())
+				bits |= bytes[i + 2u];
+
+			text += digits[bits >> 18];
+			text += digits[(bits >> 12) & 63u];
+			text += i + 1u < bytes.size() ? digits[(bits >> 6) & 63u] : '=';
+			text += i + 2u < bytes.size() ? digits[bits & 63u] : '=';
+		}
+		return text;
+	}
+
+	// The torus as an unindexed triangle soup in a .gltf with a data URI, under a parent node that moves it.
+	std::string MakeGltfSoup(const SourceMesh& source, SourceMesh& soup, const Math::Float3& offset)
+	{
+		for (uint index : source.indices)
+		{
+			soup.positions.insert(soup.positions.end(), source.positions.begin() + index * 3u, source.positions.begin() + index * 3u + 3u);
+			soup.texcoords.insert(soup.texcoords.end(), source.texcoords.begin() + index * 2u, source.texcoords.begin() + index * 2u + 2u);
+			soup.indices.push_back((uint)soup.indices.size());
+		}
+
+		std::string uri = "\"uri\":\"data:application/octet-stream;base64," + EncodeBase64(MakeGltfBuffer(soup, false)) + "\",";
+		std::string nodes = std::format("\"nodes\":[{{\"children\":[1],\"translation\":[{},{},{}]}},{{\"mesh\":0}}]", offset.x, offset.y, offset.z);
+		return MakeGltfJson(soup, false, uri, nodes);
+	}
+
+	template <typename Load>
+	double TimeLoads(Load load, bool& loaded)
+	{
+		double milliseconds = 0.0;
+		for (uint run = 0u; run < LOAD_RUNS; ++run)
+		{
+			auto start = std::chrono::steady_clock::now();
+			loaded = load() && loaded;
+			milliseconds += MillisecondsSince(start);
+		}
+		return milliseconds / LOAD_RUNS;
+	}
+
+	double Megabytes(const std::filesystem::path& path)
+	{
+		std::error_code error;
+		return std::filesystem::file_size(path, error) / (1024.0 * 1024.0);
+	}
+}
+
+bool RunMeshBenchmark(std::ostream& output)
+{
+	namespace fs = std::filesystem;
+
+	bool allMatch = true;
+	std::error_code error;
+	fs::path directory = fs::temp_directory_path(error) / "mesh-benchmark";
+	fs::create_directories(directory, error);
+
+	output << std::format("Mesh loading from a warm file cache, average of {} loads", LOAD_RUNS) << std::endl;
+
+	const Math::Float3 noOffset;
+	for (const TorusSize& size : TORUS_SIZES)
+	{
+		SourceMesh torus = MakeTorus(size);
+		fs::path objPath = directory / "torus.obj";
+		fs::path glbPath = directory / "torus.glb";
+		fs::path cookedPath = directory / "torus.mesh";
+
+		std::vector<uchar> glb = MakeGlb(torus);
+		if (!WriteObj(torus, objPath) || !WriteFile(glbPath, glb.data(), glb.size()))
+		{
+			output << std::format("Could not write the meshes to {}", directory.string()) << std::endl;
+			return false;
+		}
+
+		// Import both text and binary files, then cook the binary import.
+		MeshData fromObj, fromGlb, fromCooked;
+		std::string importError;
+		bool loaded = true;
+		double objMilliseconds = TimeLoads([&] { return MeshImporter::Import(objPath.string().c_str(), fromObj, importError); }, loaded);
+		double glbMilliseconds = TimeLoads([&] { return MeshImporter::Import(glbPath.string().c_str(), fromGlb, importError); }, loaded);
+
+		auto cookStart = std::chrono::steady_clock::now();
+		loaded = MeshFile::Save(fromGlb, cookedPath.string().c_str()) && loaded;
+		double cookMilliseconds = MillisecondsSince(cookStart);
+
+		uint indexSize = 0u;
+		double cookedMilliseconds = TimeLoads([&]
+		{
+			MeshFile cooked(cookedPath.string().c_str());
+			indexSize = cooked.GetIndexSize();
+			return cooked.IsValid() && cooked.Decode(fromCooked);
+		}, loaded);
+
+		if (!loaded)
+			output << std::format("Loading failed: {}", importError) << std::endl;
+
+		// Imports are exact and weld the corners back to the grid's vertices; the cooked mesh is within half a step.
+		size_t vertexCount = torus.GetVertexCount();
+		Error objError = CompareTriangles(fromObj, torus, noOffset);
+		Error glbError = CompareTriangles(fromGlb, torus, noOffset);
+		Error cookedError = CompareTriangles(fromCooked, torus, noOffset);
+		float positionStep = 8.0f / 65535.0f;	// The torus is 8 wide and 8 deep.
+		float texcoordStep = 1.0f / 65535.0f;
+		bool match = loaded && objError.sameTriangles && glbError.sameTriangles && cookedError.sameTriangles &&
+			objError.position == 0.0f && objError.texcoord == 0.0f && glbError.position == 0.0f && glbError.texcoord == 0.0f &&
+			fromObj.vertices.size() == vertexCount && fromGlb.vertices.size() == vertexCount && fromCooked.vertices.size() == vertexCount &&
+			cookedError.position <= positionStep * 0.5f * 1.01f && cookedError.texcoord <= texcoordStep * 0.5f * 1.01f;
+		allMatch = allMatch && match;
+
+		output << std::format("{:>8} triangles, {} vertices{}", torus.indices.size() / 3u, vertexCount, match ? "" : " MISMATCH") << std::endl;
+		output << std::format("          obj    {:7.1f} MB {:9.2f} ms", Megabytes(objPath), objMilliseconds) << std::endl;
+		output << std::format("          glb    {:7.1f} MB {:9.2f} ms ({:.1f}x faster than obj)", Megabytes(glbPath), glbMilliseconds,
+			objMilliseconds / glbMilliseconds) << std::endl;
+		output << std::format("          cooked {:7.1f} MB {:9.2f} ms ({:.1f}x faster than obj, {:.1f}x than glb), {}-bit indices, cooked in {:.2f} ms",
+			Megabytes(cookedPath), cookedMilliseconds, objMilliseconds / cookedMilliseconds, glbMilliseconds / cookedMilliseconds, indexSize * 8u,
+			cookMilliseconds) << std::endl;
+		output << std::format("          cooked error: {:.2f} position steps, {:.2f} texture coordinate steps", cookedError.position / positionStep,
+			cookedError.texcoord / texcoordStep) << std::endl;
+	}
+
+	// A .gltf triangle soup with an embedded buffer, moved by a parent node, welds back to the indexed torus.
+	SourceMesh torus = MakeTorus(TORUS_SIZES[0]), soup;
+	const Math::Float3 offset(1.0f, 2.0f, 3.0f);
+	std::string gltf = MakeGltfSoup(torus, soup, offset);
+	MeshData fromSoup;
+	std::string importError;
+	bool soupLoaded = MeshImporter::ImportGltf((const uchar*)gltf.data(), gltf.size(), directory.string().c_str(), fromSoup, importError);
+	Error soupError = CompareTriangles(fromSoup, torus, offset);
+	bool soupMatch = soupLoaded && soupError.sameTriangles && soupError.position == 0.0f && soupError.texcoord == 0.0f &&
+		fromSoup.vertices.size() == torus.GetVertexCount();
+	allMatch = allMatch && soupMatch;
+	output << std::format("gltf soup: {} corners welded to {} vertices{}", soup.indices.size(), fromSoup.vertices.size(),
+		soupMatch ? "" : std::format(" MISMATCH {}", importError)) << std::endl;
+
+	// Every truncation of the files has to fail cleanly rather than read past the end.
+	std::vector<uchar> glb = MakeGlb(torus);
+	std::vector<uchar> cooked = MeshFile::Cook(fromSoup);
+	uint accepted = 0u;
+	for (size_t length = 0u; length < glb.size(); length += 97u)
+	{
+		std::vector<uchar> truncated(glb.begin(), glb.begin() + length);
+		MeshData mesh;
+		accepted += MeshImporter::ImportGltf(truncated.data(), truncated.size(), directory.string().c_str(), mesh, importError) ? 1u : 0u;
+	}
+	for (size_t length = 0u; length < cooked.size(); length += 97u)
+	{
+		std::vector<uchar> truncated(cooked.begin(), cooked.begin() + length);
+		MeshFile mesh(truncated.data(), truncated.size());
+		accepted += mesh.IsValid() ? 1u : 0u;
+	}
+	allMatch = allMatch && accepted == 0u;
+	output << std::format("truncated files: {} accepted{}", accepted, accepted == 0u ? "" : " MISMATCH") << std::endl;
+
+	fs::remove_all(directory, error);
+	if (!allMatch)
+		output << "MISMATCH between the loaded meshes and the source" << std::endl;
+	return allMatch;
+}
@@ -0,0 +1,11 @@
+#pragma once
+
+#include <ostream>
+#include "Common.h"
+
+// Times loading the same torus, 65k and 1M triangles, from OBJ text, binary glTF and a cooked MeshFile, written
+// to the temporary directory first so every load reads from a warm file cache. Checks that the imports give the
+// triangles that were written, that the cooked mesh is within half a quantization step of them, that welding a .gltf
+// triangle soup with a node hierarchy gives the indexed mesh back, and that truncated files fail to load.
+// Run with "Engine.exe -benchmark-meshes". Returns false if any check fails.
+bool RunMeshBenchmark(std::ostream& output);
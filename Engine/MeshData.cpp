@@ -0,0 +1,102 @@
+#include "MeshData.h"
+
+#include <string.h>
+
+namespace
+{
+	const uint EMPTY_SLOT = 0xFFFFFFFFu;
+
+	// Hashes the bytes four at a time, then mixes the result with MurmurHash3's finalizer so the low bits the table
+	// is indexed with depend on every byte.
+	uint64_t HashBytes(const uchar* data, size_t size)
+	{
+		uint64_t hash = 0x9E3779B97F4A7C15ull ^ size;
+		size_t i = 0u;
+		for (; i + 4u <= size; i += 4u)
+		{
+			uint32_t word;
+			memcpy(&word, data + i, sizeof(word));
+			hash = (hash ^ word) * 0x100000001B3ull;
+			hash ^= hash >> 29;
+		}
+		for (; i < size; ++i)
+			hash = (hash ^ data[i]) * 0x100000001B3ull;
+
+		hash ^= hash >> 33;
+		hash *= 0xFF51AFD7ED558CCDull;
+		hash ^= hash >> 33;
+		hash *= 0xC4CEB9FE1A85EC53ull;
+		hash ^= hash >> 33;
+		return hash;
+	}
+}
+
+size_t MeshData::Weld()
+{
+	std::vector<uint> remap;
+	size_t uniqueCount = BuildWeldRemap((const uchar*)vertices.data(), vertices.size(), sizeof(Vertex), remap);
+
+	// Unique vertices are numbered in order, so each one moves down to the slot its number names.
+	size_t kept = 0u;
+	for (size_t i = 0u; i < vertices.size(); ++i)
+	{
+		if (remap[i] == kept)
+			vertices[kept++] = vertices[i];
+	}
+	size_t removed = vertices.size() - uniqueCount;
+	vertices.resize(uniqueCount);
+
+	for (uint& index : indices)
+		index = remap[index];
+	return removed;
+}
+
+size_t MeshData::BuildWeldRemap(const uchar* vertices, size_t count, size_t stride, std::vector<uint>& remap)
+{
+	// Open addressing with linear probing, kept at most half full. Each slot holds the first vertex of its kind.
+	size_t tableSize = 16u;
+	while (tableSize < count * 2u)
+		tableSize *= 2u;
+	const size_t mask = tableSize - 1u;
+	std::vector<uint> table(tableSize, EMPTY_SLOT);
+
+	remap.resize(count);
+	size_t uniqueCount = 0u;
+	for (size_t i = 0u; i < count; ++i)
+	{
+		const uchar* vertex = vertices + i * stride;
+		for (size_t slot = (size_t)HashBytes(vertex, stride) & mask; ; slot = (slot + 1u) & mask)
+		{
+			uint first = table[slot];
+			if (first == EMPTY_SLOT)
+			{
+				table[slot] = (uint)i;
+				remap[i] = (uint)uniqueCount++;
+				break;
+			}
+			if (memcmp(vertices + first * stride, vertex, stride) == 0)
+			{
+				remap[i] = remap[first];
+				break;
+			}
+		}
+	}
+	return uniqueCount;
+}
+
+void MeshData::AppendGridIndices(std::vector<uint>& indices, uint columns, uint rows, uint firstVertex)
+{
+	const uint verticesPerRow = columns + 1u;
+	indices.reserve(indices.size() + (size_t)columns * rows * 6u);
+	for (uint row = 0u; row < rows; ++row)
+	{
+		for (uint column = 0u; column < columns; ++column)
+		{
+			uint topLeft = firstVertex + row * verticesPerRow + column;
+			uint topRight = topLeft + 1u;
+			uint bottomLeft = topLeft + verticesPerRow;
+			uint bottomRight = bottomLeft + 1u;
+			indices.insert(indices.end(), { topLeft, bottomLeft, topRight, topRight, bottomLeft, bottomRight });
+		}
+	}
+}
@@ -0,0 +1,31 @@
+#pragma once
+
+#include "Common.h"
+
+// Indexed triangle list in the engine's vertex layout, as imported from a model file or decoded from a cooked mesh,
+// before a Model uploads it. Positions are left-handed like the rest of the engine and triangles are clockwise seen
+// from the front, which Direct3D treats as front facing by default. Has no Direct3D dependency.
+struct MeshData
+{
+	// Same layout as Model::VertexType.
+	struct Vertex
+	{
+		float position[3];
+		float texcoord[2];	// Origin at the top left of the texture, as Direct3D samples it.
+	};
+
+	std::vector<Vertex> vertices;
+	std::vector<uint> indices;	// Three per triangle.
+
+	// Merges vertices with identical bytes and points the indices at the one kept. Vertices keep their first-use
+	// order. Returns the number of vertices removed.
+	size_t Weld();
+
+	// The hashing behind Weld, for vertices of any layout: fills remap with the new index of each of the count vertices
+	// stride bytes apart and returns how many are unique. The first vertex of each kind keeps its order among them.
+	static size_t BuildWeldRemap(const uchar* vertices, size_t count, size_t stride, std::vector<uint>& remap);
+
+	// Appends two triangles for every cell of a grid of (columns + 1) by (rows + 1) vertices stored row by row from
+	// firstVertex. Clockwise with columns running right and rows running up, as Model's grid and terrain chunks lie.
+	static void AppendGridIndices(std::vector<uint>& indices, uint columns, uint rows, uint firstVertex = 0u);
+};
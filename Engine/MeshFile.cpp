@@ -0,0 +1,207 @@
+#include "MeshFile.h"
+
+#include <string.h>
+
+namespace
+{
+	const char MAGIC[4] = { 'M', 'E', 'S', 'H' };
+	const uint32_t VERSION = 1u;
+	const float QUANTIZATION_STEPS = 65535.0f;
+
+	size_t AlignUp(size_t value, size_t alignment)
+	{
+		return (value + alignment - 1u) / alignment * alignment;
+	}
+
+	// Nearest step above min, clamped to 16 bits.
+	ushort Quantize(float value, float min, float step)
+	{
+		if (step == 0.0f)
+			return 0u;
+
+		float steps = (value - min) / step + 0.5f;
+		if (steps <= 0.0f)
+			return 0u;
+		if (steps >= QUANTIZATION_STEPS)
+			return (ushort)QUANTIZATION_STEPS;
+		return (ushort)steps;
+	}
+}
+
+MeshFile::MeshFile(const char* filename)
+	: _file(std::make_unique<MappedFile>(filename))
+{
+	if (_file->IsValid())
+		_isValid = Parse(_file->GetData(), _file->GetSize());
+}
+
+MeshFile::MeshFile(const uchar* data, size_t size)
+{
+	_isValid = Parse(data, size);
+}
+
+bool MeshFile::Parse(const uchar* data, size_t size)
+{
+	// Mappings and archive payloads start on a page, which keeps every array aligned.
+	if (size < sizeof(Header) || (uintptr_t)data % alignof(uint32_t) != 0u)
+		return false;
+
+	const Header* header = (const Header*)data;
+	if (memcmp(header->magic, MAGIC, sizeof(MAGIC)) != 0 || header->version != VERSION)
+		return false;
+	if ((header->indexSize != 2u && header->indexSize != 4u) || header->indexCount % 3u != 0u)
+		return false;
+
+	// Both arrays have to lie inside the file before anything is decoded.
+	size_t indicesOffset = AlignUp(sizeof(Header) + (size_t)header->vertexCount * sizeof(QuantizedVertex), alignof(uint32_t));
+	if (indicesOffset > size || (size - indicesOffset) / header->indexSize < header->indexCount)
+		return false;
+
+	_header = header;
+	_vertices = (const QuantizedVertex*)(data + sizeof(Header));
+	_indices = data + indicesOffset;
+	return true;
+}
+
+bool MeshFile::IsValid() const
+{
+	return _isValid;
+}
+
+uint MeshFile::GetVertexCount() const
+{
+	return _isValid ? _header->vertexCount : 0u;
+}
+
+uint MeshFile::GetIndexCount() const
+{
+	return _isValid ? _header->indexCount : 0u;
+}
+
+uint MeshFile::GetIndexSize() const
+{
+	return _isValid ? _header->indexSize : 0u;
+}
+
+bool MeshFile::Decode(MeshData& mesh) const
+{
+	if (!_isValid)
+		return false;
+
+	const Header& header = *_header;
+	mesh.vertices.resize(header.vertexCount);
+	for (uint i = 0u; i < header.vertexCount; ++i)
+	{
+		const QuantizedVertex& quantized = _vertices[i];
+		MeshData::Vertex& vertex = mesh.vertices[i];
+		vertex.position[0] = header.positionMin[0] + quantized.position[0] * header.positionStep[0];
+		vertex.position[1] = header.positionMin[1] + quantized.position[1] * header.positionStep[1];
+		vertex.position[2] = header.positionMin[2] + quantized.position[2] * header.positionStep[2];
+		vertex.texcoord[0] = header.texcoordMin[0] + quantized.texcoord[0] * header.texcoordStep[0];
+		vertex.texcoord[1] = header.texcoordMin[1] + quantized.texcoord[1] * header.texcoordStep[1];
+	}
+
+	// Widen the indices, keeping the largest to check them all at once.
+	mesh.indices.resize(header.indexCount);
+	uint largest = 0u;
+	if (header.indexSize == 2u)
+	{
+		const ushort* indices = (const ushort*)_indices;
+		for (uint i = 0u; i < header.indexCount; ++i)
+		{
+			mesh.indices[i] = indices[i];
+			largest = indices[i] > largest ? indices[i] : largest;
+		}
+	}
+	else
+	{
+		memcpy(mesh.indices.data(), _indices, (size_t)header.indexCount * sizeof(uint));
+		for (uint index : mesh.indices)
+			largest = index > largest ? index : largest;
+	}
+	return header.indexCount == 0u || largest < header.vertexCount;
+}
+
+std::vector<uchar> MeshFile::Cook(const MeshData& mesh)
+{
+	Header header;
+	memcpy(header.magic, MAGIC, sizeof(MAGIC));
+	header.version = VERSION;
+	header.indexCount = (uint32_t)mesh.indices.size();
+	header.reserved = 0u;
+
+	// Find the range of every attribute, and the step that spreads it over 16 bits.
+	float positionMax[3] = {}, texcoordMax[2] = {};
+	for (uint axis = 0u; axis < 3u; ++axis)
+		header.positionMin[axis] = positionMax[axis] = mesh.vertices.empty() ? 0.0f : mesh.vertices[0].position[axis];
+	for (uint axis = 0u; axis < 2u; ++axis)
+		header.texcoordMin[axis] = texcoordMax[axis] = mesh.vertices.empty() ? 0.0f : mesh.vertices[0].texcoord[axis];
+
+	for (const MeshData::Vertex& vertex : mesh.vertices)
+	{
+		for (uint axis = 0u; axis < 3u; ++axis)
+		{
+			header.positionMin[axis] = vertex.position[axis] < header.positionMin[axis] ? vertex.position[axis] : header.positionMin[axis];
+			positionMax[axis] = vertex.position[axis] > positionMax[axis] ? vertex.position[axis] : positionMax[axis];
+		}
+		for (uint axis = 0u; axis < 2u; ++axis)
+		{
+			header.texcoordMin[axis] = vertex.texcoord[axis] < header.texcoordMin[axis] ? vertex.texcoord[axis] : header.texcoordMin[axis];
+			texcoordMax[axis] = vertex.texcoord[axis] > texcoordMax[axis] ? vertex.texcoord[axis] : texcoordMax[axis];
+		}
+	}
+	for (uint axis = 0u; axis < 3u; ++axis)
+		header.positionStep[axis] = (positionMax[axis] - header.positionMin[axis]) / QUANTIZATION_STEPS;
+	for (uint axis = 0u; axis < 2u; ++axis)
+		header.texcoordStep[axis] = (texcoordMax[axis] - header.texcoordMin[axis]) / QUANTIZATION_STEPS;
+
+	std::vector<QuantizedVertex> vertices(mesh.vertices.size());
+	for (size_t i = 0u; i < mesh.vertices.size(); ++i)
+	{
+		for (uint axis = 0u; axis < 3u; ++axis)
+			vertices[i].position[axis] = Quantize(mesh.vertices[i].position[axis], header.positionMin[axis], header.positionStep[axis]);
+		for (uint axis = 0u; axis < 2u; ++axis)
+			vertices[i].texcoord[axis] = Quantize(mesh.vertices[i].texcoord[axis], header.texcoordMin[axis], header.texcoordStep[axis]);
+	}
+
+	// Vertices that were only a fraction of a step apart are now the same; keep one of each.
+	std::vector<uint> remap;
+	size_t uniqueCount = MeshData::BuildWeldRemap((const uchar*)vertices.data(), vertices.size(), sizeof(QuantizedVertex), remap);
+	size_t kept = 0u;
+	for (size_t i = 0u; i < vertices.size(); ++i)
+	{
+		if (remap[i] == kept)
+			vertices[kept++] = vertices[i];
+	}
+	vertices.resize(uniqueCount);
+	header.vertexCount = (uint32_t)uniqueCount;
+	header.indexSize = uniqueCount <= 65536u ? 2u : 4u;
+
+	// Header, vertices, then the indices on a 4-byte boundary.
+	size_t indicesOffset = AlignUp(sizeof(Header) + vertices.size() * sizeof(QuantizedVertex), alignof(uint32_t));
+	std::vector<uchar> cooked(indicesOffset + mesh.indices.size() * header.indexSize, 0u);
+	memcpy(cooked.data(), &header, sizeof(header));
+	memcpy(cooked.data() + sizeof(Header), vertices.data(), vertices.size() * sizeof(QuantizedVertex));
+	for (size_t i = 0u; i < mesh.indices.size(); ++i)
+	{
+		uint index = remap[mesh.indices[i]];
+		if (header.indexSize == 2u)
+		{
+			ushort narrow = (ushort)index;
+			memcpy(cooked.data() + indicesOffset + i * 2u, &narrow, sizeof(narrow));
+		}
+		else
+		{
+			memcpy(cooked.data() + indicesOffset + i * 4u, &index, sizeof(index));
+		}
+	}
+	return cooked;
+}
+
+bool MeshFile::Save(const MeshData& mesh, const char* filename)
+{
+	std::vector<uchar> cooked = Cook(mesh);
+	std::ofstream output(filename, std::ios::binary);
+	output.write((const char*)cooked.data(), (std::streamsize)cooked.size());
+	return (bool)output;
+}
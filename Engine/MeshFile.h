@@ -0,0 +1,68 @@
+#pragma once
+
+#include "Common.h"
+#include "MappedFile.h"
+#include "MeshData.h"
+
+// Compact binary mesh, cooked from an imported MeshData so models load without parsing text. Positions and texture
+// coordinates are quantized to 16 bits over their range, so a vertex takes 10 bytes instead of 20, and indices take
+// 16 bits when every vertex can be reached with them. Vertices quantization makes identical are welded while cooking.
+//
+// The file is memory-mapped, or read straight from a mapped AssetArchive, and decoded with one pass over each array.
+// Like DdsFile it has no Direct3D dependency.
+class MeshFile
+{
+public:
+
+	// Maps the file. Check IsValid before decoding.
+	MeshFile(const char* filename);
+
+	// Parses a cooked mesh held in memory without copying it. The data must outlive this object.
+	MeshFile(const uchar* data, size_t size);
+
+	MeshFile(const MeshFile&) = delete;
+	MeshFile& operator=(const MeshFile&) = delete;
+
+	bool IsValid() const;
+	uint GetVertexCount() const;
+	uint GetIndexCount() const;
+	uint GetIndexSize() const;	// 2 or 4 bytes.
+
+	// Dequantizes the vertices and widens the indices into mesh. Returns false if an index is past the vertices.
+	bool Decode(MeshData& mesh) const;
+
+	// Quantizes, welds and lays out mesh in the cooked format.
+	static std::vector<uchar> Cook(const MeshData& mesh);
+	static bool Save(const MeshData& mesh, const char* filename);
+
+private:
+
+	struct Header
+	{
+		char magic[4];
+		uint32_t version;
+		uint32_t vertexCount;
+		uint32_t indexCount;
+		uint32_t indexSize;
+		uint32_t reserved;
+		float positionMin[3];
+		float positionStep[3];	// Size of one quantization step along each axis; 0 when every position is the same.
+		float texcoordMin[2];
+		float texcoordStep[2];
+	};
+
+	// Position x, y and z, then texture coordinates u and v, each in steps above the minimum.
+	struct QuantizedVertex
+	{
+		ushort position[3];
+		ushort texcoord[2];
+	};
+
+	bool Parse(const uchar* data, size_t size);
+
+	std::unique_ptr<MappedFile> _file;
+	const Header* _header = nullptr;
+	const QuantizedVertex* _vertices = nullptr;
+	const uchar* _indices = nullptr;
+	bool _isValid = false;
+};
@@ -0,0 +1,1070 @@
+#include "MeshImporter.h"
+#include "EngineMath.h"
+#include "MappedFile.h"
+
+#include <charconv>
+#include <ctype.h>
+#include <filesystem>
+#include <math.h>
+#include <string.h>
+
+namespace
+{
+	struct Float2
+	{
+		float u = 0.0f;
+		float v = 0.0f;
+	};
+
+	// Sets the message of a failed import, for returning straight away.
+	bool Fail(std::string& error, std::string message)
+	{
+		error = std::move(message);
+		return false;
+	}
+
+	// Turns -0 into 0, so welding, which compares bytes, does not keep both.
+	float Canonical(float value)
+	{
+		return value == 0.0f ? 0.0f : value;
+	}
+
+	// Mirrors a right-handed position along z into the engine's left-handed space.
+	MeshData::Vertex MakeVertex(float x, float y, float z, float u, float v)
+	{
+		MeshData::Vertex vertex;
+		vertex.position[0] = Canonical(x);
+		vertex.position[1] = Canonical(y);
+		vertex.position[2] = Canonical(-z);
+		vertex.texcoord[0] = Canonical(u);
+		vertex.texcoord[1] = Canonical(v);
+		return vertex;
+	}
+
+	bool IsSpace(char c)
+	{
+		return c == ' ' || c == '\t' || c == '\r';
+	}
+
+	const char* SkipSpaces(const char* cursor, const char* end)
+	{
+		while (cursor < end && IsSpace(*cursor))
+			++cursor;
+		return cursor;
+	}
+
+	bool ParseFloat(const char*& cursor, const char* end, float& value)
+	{
+		// from_chars does not take the leading plus sign some exporters write.
+		cursor = SkipSpaces(cursor, end);
+		if (cursor < end && *cursor == '+')
+			++cursor;
+
+		// Values too small for a float read as 0 rather than failing the import.
+		value = 0.0f;
+		std::from_chars_result result = std::from_chars(cursor, end, value);
+		if (result.ec == std::errc::invalid_argument)
+			return false;
+		cursor = result.ptr;
+		return true;
+	}
+
+	bool ParseInteger(const char*& cursor, const char* end, long long& value)
+	{
+		std::from_chars_result result = std::from_chars(cursor, end, value);
+		if (result.ec != std::errc())
+			return false;
+		cursor = result.ptr;
+		return true;
+	}
+
+	// OBJ indices count from 1, or back from the last element so far when negative.
+	bool ResolveObjIndex(long long index, size_t count, uint& resolved)
+	{
+		if (index > 0 && (unsigned long long)index <= count)
+		{
+			resolved = (uint)(index - 1);
+			return true;
+		}
+		if (index < 0 && (unsigned long long)-index <= count)
+		{
+			resolved = (uint)((long long)count + index);
+			return true;
+		}
+		return false;
+	}
+
+	// Parses one face corner, "v", "v/vt", "v//vn" or "v/vt/vn". The normal is not kept.
+	bool ParseCorner(const char*& cursor, const char* end, long long& position, long long& texcoord)
+	{
+		texcoord = 0;
+		if (!ParseInteger(cursor, end, position))
+			return false;
+		if (cursor == end || *cursor != '/')
+			return true;
+
+		++cursor;
+		if (cursor < end && *cursor != '/' && !ParseInteger(cursor, end, texcoord))
+			return false;
+		if (cursor == end || *cursor != '/')
+			return true;
+
+		++cursor;
+		long long normal;
+		return ParseInteger(cursor, end, normal);
+	}
+
+	struct JsonValue
+	{
+		enum class Type
+		{
+			Null,
+			Boolean,
+			Number,
+			String,
+			Array,
+			Object
+		};
+
+		Type type = Type::Null;
+		bool boolean = false;
+		double number = 0.0;
+		std::string string;
+		std::vector<JsonValue> elements;	// Array elements, or object member values.
+		std::vector<std::string> names;		// Object member names, one per element.
+
+		// Member of an object, or null when it has no member of that name or is not an object.
+		const JsonValue* Find(const char* name) const
+		{
+			for (size_t i = 0u; i < names.size(); ++i)
+			{
+				if (names[i] == name)
+					return &elements[i];
+			}
+			return nullptr;
+		}
+
+		// Element of an array, or null when out of range or not an array.
+		const JsonValue* At(long long index) const
+		{
+			if (type != Type::Array || index < 0 || (unsigned long long)index >= elements.size())
+				return nullptr;
+			return &elements[(size_t)index];
+		}
+	};
+
+	// Recursive descent parser for JSON (RFC 8259), for glTF's JSON. Strings are stored as UTF-8.
+	class JsonParser
+	{
+	public:
+
+		JsonParser(const char* text, size_t size)
+			: _cursor(text)
+			, _end(text + size)
+		{
+			// Skip a UTF-8 byte order mark.
+			if (size >= 3u && memcmp(text, "\xEF\xBB\xBF", 3u) == 0)
+				_cursor += 3;
+		}
+
+		bool Parse(JsonValue& value)
+		{
+			if (!ParseValue(value, 0u))
+				return false;
+			SkipWhitespace();
+			return _cursor == _end;
+		}
+
+	private:
+
+		// Deeper documents are rejected rather than risking the stack.
+		static const uint MAX_DEPTH = 128u;
+
+		void SkipWhitespace()
+		{
+			while (_cursor < _end && (*_cursor == ' ' || *_cursor == '\t' || *_cursor == '\n' || *_cursor == '\r'))
+				++_cursor;
+		}
+
+		bool ParseLiteral(const char* literal)
+		{
+			size_t length = strlen(literal);
+			if ((size_t)(_end - _cursor) < length || memcmp(_cursor, literal, length) != 0)
+				return false;
+			_cursor += length;
+			return true;
+		}
+
+		bool ParseValue(JsonValue& value, uint depth)
+		{
+			SkipWhitespace();
+			if (_cursor == _end || depth > MAX_DEPTH)
+				return false;
+
+			switch (*_cursor)
+			{
+			case '{':
+				value.type = JsonValue::Type::Object;
+				return ParseMembers(value, depth);
+			case '[':
+				value.type = JsonValue::Type::Array;
+				return ParseElements(value, depth);
+			case '"':
+				value.type = JsonValue::Type::String;
+				return ParseString(value.string);
+			case 't':
+				value.type = JsonValue::Type::Boolean;
+				value.boolean = true;
+				return ParseLiteral("true");
+			case 'f':
+				value.type = JsonValue::Type::Boolean;
+				return ParseLiteral("false");
+			case 'n':
+				return ParseLiteral("null");
+			default:
+			{
+				value.type = JsonValue::Type::Number;
+				std::from_chars_result result = std::from_chars(_cursor, _end, value.number);
+				if (result.ec != std::errc())
+					return false;
+				_cursor = result.ptr;
+				return true;
+			}
+			}
+		}
+
+		bool ParseMembers(JsonValue& value, uint depth)
+		{
+			++_cursor;
+			SkipWhitespace();
+			if (_cursor < _end && *_cursor == '}')
+			{
+				++_cursor;
+				return true;
+			}
+
+			for (;;)
+			{
+				SkipWhitespace();
+				value.names.emplace_back();
+				if (_cursor == _end || *_cursor != '"' || !ParseString(value.names.back()))
+					return false;
+
+				SkipWhitespace();
+				if (_cursor == _end || *_cursor++ != ':')
+					return false;
+
+				value.elements.emplace_back();
+				if (!ParseValue(value.elements.back(), depth + 1u))
+					return false;
+
+				SkipWhitespace();
+				if (_cursor == _end)
+					return false;
+				char next = *_cursor++;
+				if (next == '}')
+					return true;
+				if (next != ',')
+					return false;
+			}
+		}
+
+		bool ParseElements(JsonValue& value, uint depth)
+		{
+			++_cursor;
+			SkipWhitespace();
+			if (_cursor < _end && *_cursor == ']')
+			{
+				++_cursor;
+				return true;
+			}
+
+			for (;;)
+			{
+				value.elements.emplace_back();
+				if (!ParseValue(value.elements.back(), depth + 1u))
+					return false;
+
+				SkipWhitespace();
+				if (_cursor == _end)
+					return false;
+				char next = *_cursor++;
+				if (next == ']')
+					return true;
+				if (next != ',')
+					return false;
+			}
+		}
+
+		bool ParseHex4(uint& codePoint)
+		{
+			if (_end - _cursor < 4)
+				return false;
+			std::from_chars_result result = std::from_chars(_cursor, _cursor + 4, codePoint, 16);
+			if (result.ec != std::errc() || result.ptr != _cursor + 4)
+				return false;
+			_cursor += 4;
+			return true;
+		}
+
+		static void AppendUtf8(std::string& string, uint codePoint)
+		{
+			if (codePoint < 0x80u)
+			{
+				string += (char)codePoint;
+			}
+			else if (codePoint < 0x800u)
+			{
+				string += (char)(0xC0u | (codePoint >> 6));
+				string += (char)(0x80u | (codePoint & 0x3Fu));
+			}
+			else if (codePoint < 0x10000u)
+			{
+				string += (char)(0xE0u | (codePoint >> 12));
+				string += (char)(0x80u | ((codePoint >> 6) & 0x3Fu));
+				string += (char)(0x80u | (codePoint & 0x3Fu));
+			}
+			else
+			{
+				string += (char)(0xF0u | (codePoint >> 18));
+				string += (char)(0x80u | ((codePoint >> 12) & 0x3Fu));
+				string += (char)(0x80u | ((codePoint >> 6) & 0x3Fu));
+				string += (char)(0x80u | (codePoint & 0x3Fu));
+			}
+		}
+
+		bool ParseString(std::string& string)
+		{
+			++_cursor;
+			while (_cursor < _end)
+			{
+				char c = *_cursor++;
+				if (c == '"')
+					return true;
+				if ((uchar)c < 0x20u)
+					return false;
+				if (c != '\\')
+				{
+					string += c;
+					continue;
+				}
+
+				if (_cursor == _end)
+					return false;
+				switch (*_cursor++)
+				{
+				case '"': string += '"'; break;
+				case '\\': string += '\\'; break;
+				case '/': string += '/'; break;
+				case 'b': string += '\b'; break;
+				case 'f': string += '\f'; break;
+				case 'n': string += '\n'; break;
+				case 'r': string += '\r'; break;
+				case 't': string += '\t'; break;
+				case 'u':
+				{
+					uint codePoint;
+					if (!ParseHex4(codePoint))
+						return false;
+
+					// Characters outside the basic plane come as a pair of surrogates.
+					if (codePoint >= 0xD800u && codePoint < 0xDC00u && _end - _cursor >= 6 && _cursor[0] == '\\' && _cursor[1] == 'u')
+					{
+						_cursor += 2;
+						uint low;
+						if (!ParseHex4(low) || low < 0xDC00u || low >= 0xE000u)
+							return false;
+						codePoint = 0x10000u + ((codePoint - 0xD800u) << 10) + (low - 0xDC00u);
+					}
+					AppendUtf8(string, codePoint);
+					break;
+				}
+				default:
+					return false;
+				}
+			}
+			return false;
+		}
+
+		const char* _cursor;
+		const char* _end;
+	};
+
+	double GetNumber(const JsonValue& object, const char* name, double fallback)
+	{
+		const JsonValue* value = object.Find(name);
+		return value && value->type == JsonValue::Type::Number ? value->number : fallback;
+	}
+
+	// A count, offset or size: fallback when missing, -1 when negative, fractional or past what a double holds exactly.
+	long long GetInteger(const JsonValue& object, const char* name, long long fallback)
+	{
+		const JsonValue* value = object.Find(name);
+		if (!value || value->type != JsonValue::Type::Number)
+			return fallback;
+		if (!(value->number >= 0.0 && value->number < 9007199254740992.0) || value->number != floor(value->number))
+			return -1;
+		return (long long)value->number;
+	}
+
+	// An index into one of the document's arrays, or -1 when missing or invalid.
+	long long GetIndex(const JsonValue& object, const char* name)
+	{
+		return GetInteger(object, name, -1);
+	}
+
+	bool DecodeBase64(const char* text, size_t size, std::vector<uchar>& bytes)
+	{
+		uint32_t bits = 0u;
+		uint bitCount = 0u;
+		for (size_t i = 0u; i < size && text[i] != '='; ++i)
+		{
+			char c = text[i];
+			uint value;
+			if (c >= 'A' && c <= 'Z')
+				value = (uint)(c - 'A');
+			else if (c >= 'a' && c <= 'z')
+				value = (uint)(c - 'a') + 26u;
+			else if (c >= '0' && c <= '9')
+				value = (uint)(c - '0') + 52u;
+			else if (c == '+')
+				value = 62u;
+			else if (c == '/')
+				value = 63u;
+			else
+				return false;
+
+			bits = (bits << 6) | value;
+			bitCount += 6u;
+			if (bitCount >= 8u)
+			{
+				bitCount -= 8u;
+				bytes.push_back((uchar)(bits >> bitCount));
+			}
+		}
+		return true;
+	}
+
+	// URIs of buffer files are relative references, with reserved characters such as spaces percent-encoded.
+	std::string DecodeUri(const std::string& uri)
+	{
+		std::string decoded;
+		for (size_t i = 0u; i < uri.size(); ++i)
+		{
+			uint value = 0u;
+			if (uri[i] == '%' && i + 2u < uri.size() && std::from_chars(uri.data() + i + 1u, uri.data() + i + 3u, value, 16).ptr == uri.data() + i + 3u)
+			{
+				decoded += (char)value;
+				i += 2u;
+			}
+			else
+			{
+				decoded += uri[i];
+			}
+		}
+		return decoded;
+	}
+
+	uint32_t ReadUint32(const uchar* data)
+	{
+		uint32_t value;
+		memcpy(&value, data, sizeof(value));
+		return value;
+	}
+
+	struct GltfBuffer
+	{
+		const uchar* data = nullptr;
+		size_t size = 0u;
+		std::vector<uchar> storage;	// Holds the bytes unless they are the .glb's binary chunk.
+	};
+
+	struct GltfDocument
+	{
+		JsonValue root;
+		std::vector<GltfBuffer> buffers;
+	};
+
+	// Where the elements of an accessor are.
+	struct AccessorView
+	{
+		const uchar* data = nullptr;
+		size_t count = 0u;
+		size_t stride = 0u;
+		uint componentType = 0u;
+		uint componentSize = 0u;
+		bool normalized = false;
+	};
+
+	const uint COMPONENT_BYTE = 5120u;
+	const uint COMPONENT_UNSIGNED_BYTE = 5121u;
+	const uint COMPONENT_SHORT = 5122u;
+	const uint COMPONENT_UNSIGNED_SHORT = 5123u;
+	const uint COMPONENT_UNSIGNED_INT = 5125u;
+	const uint COMPONENT_FLOAT = 5126u;
+	const long long MODE_TRIANGLES = 4;
+
+	uint GetComponentSize(uint componentType)
+	{
+		switch (componentType)
+		{
+		case COMPONENT_BYTE:
+		case COMPONENT_UNSIGNED_BYTE:
+			return 1u;
+		case COMPONENT_SHORT:
+		case COMPONENT_UNSIGNED_SHORT:
+			return 2u;
+		case COMPONENT_UNSIGNED_INT:
+		case COMPONENT_FLOAT:
+			return 4u;
+		default:
+			return 0u;
+		}
+	}
+
+	uint GetComponentCount(const std::string& type)
+	{
+		if (type == "SCALAR")
+			return 1u;
+		if (type == "VEC2")
+			return 2u;
+		if (type == "VEC3")
+			return 3u;
+		if (type == "VEC4" || type == "MAT2")
+			return 4u;
+		if (type == "MAT3")
+			return 9u;
+		if (type == "MAT4")
+			return 16u;
+		return 0u;
+	}
+
+	// Finds an accessor's elements and checks that they have the expected number of components and lie in their buffer.
+	bool GetAccessorView(const GltfDocument& document, long long index, uint components, AccessorView& view, std::string& error)
+	{
+		const JsonValue* accessors = document.root.Find("accessors");
+		const JsonValue* accessor = accessors ? accessors->At(index) : nullptr;
+		if (!accessor)
+			return Fail(error, std::format("Accessor {} does not exist", index));
+		if (accessor->Find("sparse"))
+			return Fail(error, std::format("Accessor {} is sparse, which is not supported", index));
+
+		const JsonValue* type = accessor->Find("type");
+		if (!type || GetComponentCount(type->string) != components)
+			return Fail(error, std::format("Accessor {} does not have {} components", index, components));
+
+		view.componentType = (uint)GetIndex(*accessor, "componentType");
+		view.componentSize = GetComponentSize(view.componentType);
+		if (view.componentSize == 0u)
+			return Fail(error, std::format("Accessor {} has an unknown component type", index));
+
+		const JsonValue* normalized = accessor->Find("normalized");
+		view.normalized = normalized && normalized->boolean;
+		long long count = GetIndex(*accessor, "count");
+		if (count < 0)
+			return Fail(error, std::format("Accessor {} has no count", index));
+		view.count = (size_t)count;
+
+		// Accessors without a buffer view are zeros for sparse accessors to fill in.
+		long long bufferViewIndex = GetIndex(*accessor, "bufferView");
+		if (bufferViewIndex < 0)
+			return Fail(error, std::format("Accessor {} has no buffer view", index));
+
+		const JsonValue* bufferViews = document.root.Find("bufferViews");
+		const JsonValue* bufferView = bufferViews ? bufferViews->At(bufferViewIndex) : nullptr;
+		long long bufferIndex = bufferView ? GetIndex(*bufferView, "buffer") : -1;
+		if (bufferIndex < 0 || (size_t)bufferIndex >= document.buffers.size())
+			return Fail(error, std::format("Accessor {} has no buffer", index));
+
+		// Every element has to lie inside the view, and the view inside its buffer.
+		const GltfBuffer& buffer = document.buffers[(size_t)bufferIndex];
+		long long viewOffset = GetInteger(*bufferView, "byteOffset", 0);
+		long long viewLength = GetInteger(*bufferView, "byteLength", -1);
+		long long accessorOffset = GetInteger(*accessor, "byteOffset", 0);
+		long long elementSize = (long long)components * view.componentSize;
+		long long stride = GetInteger(*bufferView, "byteStride", elementSize);
+		if (viewOffset < 0 || viewLength < 0 || (uint64_t)viewOffset > buffer.size || (uint64_t)viewLength > buffer.size - viewOffset ||
+			stride < elementSize || stride > 252)
+			return Fail(error, std::format("Buffer view {} lies outside its buffer", bufferViewIndex));
+		if (accessorOffset < 0 || accessorOffset > viewLength || (view.count > 0u && ((uint64_t)viewLength - accessorOffset < (uint64_t)elementSize ||
+			(uint64_t)(view.count - 1u) > ((uint64_t)viewLength - accessorOffset - elementSize) / (uint64_t)stride)))
+			return Fail(error, std::format("Accessor {} lies outside its buffer view", index));
+		view.stride = (size_t)stride;
+
+		view.data = buffer.data + viewOffset + accessorOffset;
+		return true;
+	}
+
+	// Reads one component as a float; normalized integers map to 0 to 1, or -1 to 1 when signed.
+	float ReadComponent(const uchar* data, const AccessorView& view)
+	{
+		switch (view.componentType)
+		{
+		case COMPONENT_BYTE:
+		{
+			float value = (float)*(const int8_t*)data;
+			return view.normalized ? (value < -127.0f ? -1.0f : value / 127.0f) : value;
+		}
+		case COMPONENT_UNSIGNED_BYTE:
+			return view.normalized ? *data / 255.0f : (float)*data;
+		case COMPONENT_SHORT:
+		{
+			int16_t value;
+			memcpy(&value, data, sizeof(value));
+			return view.normalized ? (value < -32767 ? -1.0f : value / 32767.0f) : (float)value;
+		}
+		case COMPONENT_UNSIGNED_SHORT:
+		{
+			uint16_t value;
+			memcpy(&value, data, sizeof(value));
+			return view.normalized ? value / 65535.0f : (float)value;
+		}
+		case COMPONENT_UNSIGNED_INT:
+			return (float)ReadUint32(data);
+		default:
+		{
+			float value;
+			memcpy(&value, data, sizeof(value));
+			return value;
+		}
+		}
+	}
+
+	bool ReadFloats(const GltfDocument& document, long long index, uint components, std::vector<float>& values, std::string& error)
+	{
+		AccessorView view;
+		if (!GetAccessorView(document, index, components, view, error))
+			return false;
+
+		values.resize(view.count * components);
+		for (size_t i = 0u; i < view.count; ++i)
+		{
+			for (uint component = 0u; component < components; ++component)
+				values[i * components + component] = ReadComponent(view.data + i * view.stride + component * view.componentSize, view);
+		}
+		return true;
+	}
+
+	bool ReadIndices(const GltfDocument& document, long long index, std::vector<uint>& indices, std::string& error)
+	{
+		AccessorView view;
+		if (!GetAccessorView(document, index, 1u, view, error))
+			return false;
+		if (view.componentType != COMPONENT_UNSIGNED_BYTE && view.componentType != COMPONENT_UNSIGNED_SHORT && view.componentType != COMPONENT_UNSIGNED_INT)
+			return Fail(error, std::format("Index accessor {} is not unsigned integers", index));
+
+		indices.resize(view.count);
+		for (size_t i = 0u; i < view.count; ++i)
+		{
+			const uchar* data = view.data + i * view.stride;
+			if (view.componentType == COMPONENT_UNSIGNED_BYTE)
+				indices[i] = *data;
+			else if (view.componentType == COMPONENT_UNSIGNED_SHORT)
+				indices[i] = (uint)data[0] | ((uint)data[1] << 8);
+			else
+				indices[i] = ReadUint32(data);
+		}
+		return true;
+	}
+
+	// Appends one primitive's triangles, transformed by world. Points and lines have no triangles and are skipped.
+	bool ImportPrimitive(const GltfDocument& document, const JsonValue& primitive, const Math::Matrix4& world, MeshData& mesh, std::string& error)
+	{
+		if (GetNumber(primitive, "mode", (double)MODE_TRIANGLES) != (double)MODE_TRIANGLES)
+			return true;
+
+		const JsonValue* attributes = primitive.Find("attributes");
+		long long positionIndex = attributes ? GetIndex(*attributes, "POSITION") : -1;
+		if (positionIndex < 0)
+			return Fail(error, "A primitive has no positions");
+
+		std::vector<float> positions, texcoords;
+		if (!ReadFloats(document, positionIndex, 3u, positions, error))
+			return false;
+		size_t vertexCount = positions.size() / 3u;
+
+		long long texcoordIndex = GetIndex(*attributes, "TEXCOORD_0");
+		if (texcoordIndex >= 0 && !ReadFloats(document, texcoordIndex, 2u, texcoords, error))
+			return false;
+		if (texcoordIndex >= 0 && texcoords.size() / 2u != vertexCount)
+			return Fail(error, "A primitive has a different number of positions and texture coordinates");
+
+		// Without indices, the vertices are the triangles' corners in order.
+		std::vector<uint> indices;
+		long long indicesIndex = GetIndex(primitive, "indices");
+		if (indicesIndex >= 0)
+		{
+			if (!ReadIndices(document, indicesIndex, indices, error))
+				return false;
+		}
+		else
+		{
+			indices.resize(vertexCount);
+			for (size_t i = 0u; i < vertexCount; ++i)
+				indices[i] = (uint)i;
+		}
+		if (indices.size() % 3u != 0u)
+			return Fail(error, "A primitive's triangle list is incomplete");
+
+		size_t baseVertex = mesh.vertices.size();
+		for (size_t i = 0u; i < vertexCount; ++i)
+		{
+			Math::Float4 position = Math::TransformPoint(Math::Float3(positions[i * 3u], positions[i * 3u + 1u], positions[i * 3u + 2u]), world);
+			float u = texcoords.empty() ? 0.0f : texcoords[i * 2u];
+			float v = texcoords.empty() ? 0.0f : texcoords[i * 2u + 1u];
+			mesh.vertices.push_back(MakeVertex(position.x, position.y, position.z, u, v));
+		}
+
+		// Mirroring into left-handed space reverses the winding, unless the node's transform already mirrors it.
+		const float (*m)[4] = world.m;
+		float determinant = m[0][0] * (m[1][1] * m[2][2] - m[1][2] * m[2][1]) - m[0][1] * (m[1][0] * m[2][2] - m[1][2] * m[2][0])
+			+ m[0][2] * (m[1][0] * m[2][1] - m[1][1] * m[2][0]);
+		bool reverse = determinant >= 0.0f;
+		for (size_t i = 0u; i < indices.size(); i += 3u)
+		{
+			if (indices[i] >= vertexCount || indices[i + 1u] >= vertexCount || indices[i + 2u] >= vertexCount)
+				return Fail(error, "A primitive has an index past its vertices");
+
+			mesh.indices.push_back((uint)baseVertex + indices[i]);
+			mesh.indices.push_back((uint)baseVertex + indices[reverse ? i + 2u : i + 1u]);
+			mesh.indices.push_back((uint)baseVertex + indices[reverse ? i + 1u : i + 2u]);
+		}
+		return true;
+	}
+
+	bool ImportMesh(const GltfDocument& document, long long index, const Math::Matrix4& world, MeshData& mesh, std::string& error)
+	{
+		const JsonValue* meshes = document.root.Find("meshes");
+		const JsonValue* gltfMesh = meshes ? meshes->At(index) : nullptr;
+		const JsonValue* primitives = gltfMesh ? gltfMesh->Find("primitives") : nullptr;
+		if (!primitives)
+			return Fail(error, std::format("Mesh {} does not exist", index));
+
+		for (const JsonValue& primitive : primitives->elements)
+		{
+			if (!ImportPrimitive(document, primitive, world, mesh, error))
+				return false;
+		}
+		return true;
+	}
+
+	// A node's transform relative to its parent: its matrix, or its scale, then rotation, then translation.
+	Math::Matrix4 GetNodeMatrix(const JsonValue& node)
+	{
+		Math::Matrix4 matrix;
+
+		// glTF stores column-major matrices that transform column vectors, which is the same sixteen numbers as the
+		// row-major matrix for row vectors the engine uses.
+		const JsonValue* values = node.Find("matrix");
+		if (values && values->elements.size() == 16u)
+		{
+			for (uint i = 0u; i < 16u; ++i)
+				matrix.m[i / 4u][i % 4u] = (float)values->elements[i].number;
+			return matrix;
+		}
+
+		const JsonValue* scale = node.Find("scale");
+		if (scale && scale->elements.size() == 3u)
+			matrix = Math::Scaling((float)scale->elements[0].number, (float)scale->elements[1].number, (float)scale->elements[2].number);
+
+		const JsonValue* rotation = node.Find("rotation");
+		if (rotation && rotation->elements.size() == 4u)
+		{
+			Math::Quaternion q((float)rotation->elements[0].number, (float)rotation->elements[1].number, (float)rotation->elements[2].number,
+				(float)rotation->elements[3].number);
+			matrix = Math::Multiply(matrix, Math::Rotation(Math::Normalize(q)));
+		}
+
+		const JsonValue* translation = node.Find("translation");
+		if (translation && translation->elements.size() == 3u)
+		{
+			matrix = Math::Multiply(matrix, Math::Translation((float)translation->elements[0].number, (float)translation->elements[1].number,
+				(float)translation->elements[2].number));
+		}
+		return matrix;
+	}
+
+	// Imports the meshes of a node and its descendants. depth guards against a hierarchy that loops back on itself.
+	bool ImportNode(const GltfDocument& document, long long index, const Math::Matrix4& parentWorld, size_t depth, MeshData& mesh, std::string& error)
+	{
+		const JsonValue* nodes = document.root.Find("nodes");
+		const JsonValue* node = nodes ? nodes->At(index) : nullptr;
+		if (!node)
+			return Fail(error, std::format("Node {} does not exist", index));
+		if (depth > nodes->elements.size())
+			return Fail(error, "The node hierarchy has a cycle");
+
+		Math::Matrix4 world = Math::Multiply(GetNodeMatrix(*node), parentWorld);
+		long long meshIndex = GetIndex(*node, "mesh");
+		if (meshIndex >= 0 && !ImportMesh(document, meshIndex, world, mesh, error))
+			return false;
+
+		const JsonValue* children = node->Find("children");
+		if (children)
+		{
+			for (const JsonValue& child : children->elements)
+			{
+				if (child.type != JsonValue::Type::Number)
+					return Fail(error, "A node has an invalid child");
+				if (!ImportNode(document, (long long)child.number, world, depth + 1u, mesh, error))
+					return false;
+			}
+		}
+		return true;
+	}
+
+	// Fills in every buffer's bytes: the .glb's binary chunk, a base64 data URI or a file next to the model.
+	bool LoadBuffers(GltfDocument& document, const uchar* binaryChunk, size_t binaryChunkSize, const char* directory, std::string& error)
+	{
+		const JsonValue* buffers = document.root.Find("buffers");
+		if (!buffers)
+			return true;
+
+		document.buffers.resize(buffers->elements.size());
+		for (size_t i = 0u; i < buffers->elements.size(); ++i)
+		{
+			const JsonValue& description = buffers->elements[i];
+			GltfBuffer& buffer = document.buffers[i];
+			long long byteLength = GetInteger(description, "byteLength", -1);
+			if (byteLength < 0)
+				return Fail(error, std::format("Buffer {} has no byteLength", i));
+
+			const JsonValue* uri = description.Find("uri");
+			if (!uri)
+			{
+				if (i != 0u || !binaryChunk)
+					return Fail(error, std::format("Buffer {} has no data", i));
+				buffer.data = binaryChunk;
+				buffer.size = binaryChunkSize;
+			}
+			else if (uri->string.starts_with("data:"))
+			{
+				size_t comma = uri->string.find(',');
+				if (comma == std::string::npos || uri->string.rfind(";base64", comma) == std::string::npos ||
+					!DecodeBase64(uri->string.data() + comma + 1u, uri->string.size() - comma - 1u, buffer.storage))
+					return Fail(error, std::format("Buffer {} has a data URI that is not base64", i));
+			}
+			else
+			{
+				std::filesystem::path path = std::filesystem::path(directory) / DecodeUri(uri->string);
+				std::error_code fileError;
+				std::ifstream file(path, std::ios::binary);
+				if (std::filesystem::file_size(path, fileError) < (uint64_t)byteLength || fileError)
+					return Fail(error, std::format("Could not read buffer {} from {}", i, path.string()));
+				buffer.storage.resize((size_t)byteLength);
+				if (!file.read((char*)buffer.storage.data(), (std::streamsize)byteLength))
+					return Fail(error, std::format("Could not read buffer {} from {}", i, path.string()));
+			}
+
+			if (!buffer.data)
+			{
+				buffer.data = buffer.storage.data();
+				buffer.size = buffer.storage.size();
+			}
+			if (buffer.size < (uint64_t)byteLength)
+				return Fail(error, std::format("Buffer {} is shorter than its byteLength", i));
+			buffer.size = (size_t)byteLength;
+		}
+		return true;
+	}
+}
+
+bool MeshImporter::Import(const char* filename, MeshData& mesh, std::string& error)
+{
+	MappedFile file(filename);
+	if (!file.IsValid())
+		return Fail(error, std::format("Could not read {}", filename));
+
+	std::filesystem::path path(filename);
+	std::string extension = path.extension().string();
+	for (char& c : extension)
+		c = (char)tolower((uchar)c);
+
+	bool imported;
+	if (extension == ".obj")
+		imported = ImportObj((const char*)file.GetData(), file.GetSize(), mesh, error);
+	else if (extension == ".gltf" || extension == ".glb")
+		imported = ImportGltf(file.GetData(), file.GetSize(), path.parent_path().string().c_str(), mesh, error);
+	else
+		return Fail(error, std::format("{} is not an OBJ or glTF file", filename));
+
+	if (!imported)
+		error = std::format("{}: {}", filename, error);
+	return imported;
+}
+
+bool MeshImporter::ImportObj(const char* text, size_t size, MeshData& mesh, std::string& error)
+{
+	std::vector<Math::Float3> positions;
+	std::vector<Float2> texcoords;
+	mesh = MeshData();
+
+	const char* end = text + size;
+	size_t lineNumber = 0u;
+	for (const char* line = text; line < end; )
+	{
+		const char* lineEnd = (const char*)memchr(line, '\n', (size_t)(end - line));
+		if (!lineEnd)
+			lineEnd = end;
+		++lineNumber;
+
+		const char* cursor = SkipSpaces(line, lineEnd);
+		const char* keyword = cursor;
+		while (cursor < lineEnd && !IsSpace(*cursor))
+			++cursor;
+		size_t keywordLength = (size_t)(cursor - keyword);
+
+		if (keywordLength == 1u && keyword[0] == 'v')
+		{
+			Math::Float3 position;
+			if (!ParseFloat(cursor, lineEnd, position.x) || !ParseFloat(cursor, lineEnd, position.y) || !ParseFloat(cursor, lineEnd, position.z))
+				return Fail(error, std::format("Line {}: a position needs three numbers", lineNumber));
+			positions.push_back(position);
+		}
+		else if (keywordLength == 2u && keyword[0] == 'v' && keyword[1] == 't')
+		{
+			// The third coordinate of 3D texture coordinates is ignored, as is anything after the first two.
+			Float2 texcoord;
+			if (!ParseFloat(cursor, lineEnd, texcoord.u))
+				return Fail(error, std::format("Line {}: texture coordinates need a number", lineNumber));
+			const char* next = SkipSpaces(cursor, lineEnd);
+			if (next < lineEnd && *next != '#' && !ParseFloat(cursor, lineEnd, texcoord.v))
+				return Fail(error, std::format("Line {}: texture coordinates are not numbers", lineNumber));
+			texcoords.push_back(texcoord);
+		}
+		else if (keywordLength == 1u && keyword[0] == 'f')
+		{
+			// Every corner gets its own vertex; welding merges the ones that share a position and texture coordinates.
+			size_t firstVertex = mesh.vertices.size();
+			for (;;)
+			{
+				cursor = SkipSpaces(cursor, lineEnd);
+				if (cursor == lineEnd || *cursor == '#')
+					break;
+
+				long long positionIndex, texcoordIndex;
+				uint position, texcoord = 0u;
+				if (!ParseCorner(cursor, lineEnd, positionIndex, texcoordIndex) || (cursor < lineEnd && !IsSpace(*cursor)))
+					return Fail(error, std::format("Line {}: a face corner is not v, v/vt, v//vn or v/vt/vn", lineNumber));
+				if (!ResolveObjIndex(positionIndex, positions.size(), position) || (texcoordIndex != 0 && !ResolveObjIndex(texcoordIndex, texcoords.size(), texcoord)))
+					return Fail(error, std::format("Line {}: a face refers to a vertex that does not exist", lineNumber));
+
+				const Math::Float3& p = positions[position];
+				Float2 t = texcoordIndex != 0 ? texcoords[texcoord] : Float2();
+				mesh.vertices.push_back(MakeVertex(p.x, p.y, p.z, t.u, 1.0f - t.v));
+			}
+
+			size_t cornerCount = mesh.vertices.size() - firstVertex;
+			if (cornerCount < 3u)
+				return Fail(error, std::format("Line {}: a face needs at least three corners", lineNumber));
+
+			// Split the polygon into a fan, reversing each triangle to turn counter-clockwise into clockwise.
+			for (size_t corner = 1u; corner + 1u < cornerCount; ++corner)
+			{
+				mesh.indices.push_back((uint)firstVertex);
+				mesh.indices.push_back((uint)(firstVertex + corner + 1u));
+				mesh.indices.push_back((uint)(firstVertex + corner));
+			}
+		}
+
+		line = lineEnd + 1;
+	}
+
+	mesh.Weld();
+	return true;
+}
+
+bool MeshImporter::ImportGltf(const uchar* data, size_t size, const char* directory, MeshData& mesh, std::string& error)
+{
+	mesh = MeshData();
+
+	// A .glb is a 12-byte header followed by chunks, the JSON first and then usually the first buffer's bytes.
+	// Anything else is taken to be .gltf JSON text.
+	const char* json = (const char*)data;
+	size_t jsonSize = size;
+	const uchar* binaryChunk = nullptr;
+	size_t binaryChunkSize = 0u;
+	if (size >= 12u && memcmp(data, "glTF", 4u) == 0)
+	{
+		if (ReadUint32(data + 4) != 2u)
+			return Fail(error, "Only version 2 of binary glTF is supported");
+
+		size_t length = ReadUint32(data + 8);
+		if (length > size)
+			return Fail(error, "The file is truncated");
+
+		json = nullptr;
+		for (size_t offset = 12u; offset + 8u <= length; )
+		{
+			size_t chunkLength = ReadUint32(data + offset);
+			uint32_t chunkType = ReadUint32(data + offset + 4u);
+			if (chunkLength > length - offset - 8u)
+				return Fail(error, "A chunk is truncated");
+
+			const uchar* chunk = data + offset + 8u;
+			if (chunkType == 0x4E4F534Au && !json)
+			{
+				json = (const char*)chunk;
+				jsonSize = chunkLength;
+			}
+			else if (chunkType == 0x004E4942u && !binaryChunk)
+			{
+				binaryChunk = chunk;
+				binaryChunkSize = chunkLength;
+			}
+			offset += 8u + chunkLength;
+		}
+		if (!json)
+			return Fail(error, "The file has no JSON chunk");
+	}
+
+	GltfDocument document;
+	if (!JsonParser(json, jsonSize).Parse(document.root) || document.root.type != JsonValue::Type::Object)
+		return Fail(error, "The JSON is malformed");
+
+	const JsonValue* asset = document.root.Find("asset");
+	const JsonValue* version = asset ? asset->Find("version") : nullptr;
+	if (!version || !version->string.starts_with("2."))
+		return Fail(error, "Only glTF 2.0 is supported");
+
+	// Extensions the file cannot be read without, such as Draco compression or quantized attributes, are not supported.
+	const JsonValue* required = document.root.Find("extensionsRequired");
+	if (required && !required->elements.empty())
+		return Fail(error, std::format("The file requires the unsupported extension {}", required->elements[0].string));
+
+	if (!LoadBuffers(document, binaryChunk, binaryChunkSize, directory, error))
+		return false;
+
+	// Flatten the default scene, or the first one. A file without scenes is a library of meshes, imported as they are.
+	const JsonValue* scenes = document.root.Find("scenes");
+	if (scenes && !scenes->elements.empty())
+	{
+		long long sceneIndex = GetIndex(document.root, "scene");
+		const JsonValue* scene = scenes->At(sceneIndex >= 0 ? sceneIndex : 0);
+		if (!scene)
+			return Fail(error, std::format("Scene {} does not exist", sceneIndex));
+
+		const JsonValue* roots = scene->Find("nodes");
+		if (roots)
+		{
+			for (const JsonValue& root : roots->elements)
+			{
+				if (root.type != JsonValue::Type::Number)
+					return Fail(error, "A scene has an invalid node");
+				if (!ImportNode(document, (long long)root.number, Math::Identity(), 0u, mesh, error))
+					return false;
+			}
+		}
+	}
+	else if (const JsonValue* meshes = document.root.Find("meshes"))
+	{
+		for (size_t i = 0u; i < meshes->elements.size(); ++i)
+		{
+			if (!ImportMesh(document, (long long)i, Math::Identity(), mesh, error))
+				return false;
+		}
+	}
+
+	mesh.Weld();
+	return true;
+}
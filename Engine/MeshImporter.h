@@ -0,0 +1,28 @@
+#pragma once
+
+#include "Common.h"
+#include "MeshData.h"
+
+// Imports triangle meshes from Wavefront OBJ and glTF 2.0 files, the .gltf JSON form with its buffers in .bin files
+// or data URIs as well as binary .glb files. Only positions and the first set of texture coordinates are kept, which is
+// all Model::VertexType holds; polygons are split into triangle fans.
+//
+// Both formats are right-handed with counter-clockwise front faces, so positions are mirrored along z and triangles
+// reversed to match the engine. OBJ texture coordinates start at the bottom left and are flipped; glTF ones already
+// start at the top left. glTF node transforms are applied, so the mesh is the file's default scene flattened.
+//
+// Corners that end up with identical vertices are welded with MeshData::Weld. Every import fails with a message
+// instead of throwing, so asset tools can report bad files and carry on.
+class MeshImporter
+{
+public:
+
+	// Imports a .obj, .gltf or .glb file, picked by its extension.
+	static bool Import(const char* filename, MeshData& mesh, std::string& error);
+
+	// Imports OBJ text of size bytes.
+	static bool ImportObj(const char* text, size_t size, MeshData& mesh, std::string& error);
+
+	// Imports a .gltf or .glb file held in memory. Buffers stored in their own files are read from directory.
+	static bool ImportGltf(const uchar* data, size_t size, const char* directory, MeshData& mesh, std::string& error);
+};
@@ -0,0 +1,472 @@
+#include "MeshOptimizer.h"
+
+#include <algorithm>
+#include <math.h>
+
+namespace
+{
+	const uint NO_VERTEX = ~0u;
+	const size_t FETCH_CACHE_LINE = 64u;
+	const size_t FETCH_CACHE_LINES = 256u;
+
+	// FIFO post-transform cache: a vertex is still cached while fewer than cacheSize other vertices have missed since
+	// it did, so one stamp per vertex replaces the queue.
+	class FifoCache
+	{
+	public:
+		FifoCache(size_t vertexCount, uint cacheSize)
+			: _stamps(vertexCount, 0u), _cacheSize(cacheSize)
+		{
+		}
+
+		// Returns how many of the triangle's vertices had to be transformed.
+		uint Access(const uint* triangle)
+		{
+			uint misses = 0u;
+			for (uint corner = 0u; corner < 3u; ++corner)
+			{
+				uint& stamp = _stamps[triangle[corner]];
+				if (stamp == 0u || _misses - stamp >= _cacheSize)
+				{
+					stamp = ++_misses;
+					++misses;
+				}
+			}
+			return misses;
+		}
+
+		// Ages every vertex out, as if the triangles that follow were drawn on their own.
+		void Flush()
+		{
+			_misses += _cacheSize;
+		}
+
+	private:
+		std::vector<uint> _stamps;
+		uint _misses = 0u;
+		uint _cacheSize;
+	};
+
+	struct Cluster
+	{
+		size_t start;
+		size_t end;
+		float sortKey;
+	};
+
+	// The triangles around each vertex, packed into one array.
+	struct VertexTriangles
+	{
+		std::vector<uint> offsets;		// Vertex v's triangles are triangles[offsets[v]] up to triangles[offsets[v + 1]].
+		std::vector<uint> triangles;
+
+		VertexTriangles(const std::vector<uint>& indices, size_t vertexCount)
+			: offsets(vertexCount + 1u, 0u), triangles(indices.size() / 3u * 3u)
+		{
+			for (size_t i = 0u; i < triangles.size(); ++i)
+				++offsets[indices[i] + 1u];
+			for (size_t vertex = 0u; vertex < vertexCount; ++vertex)
+				offsets[vertex + 1u] += offsets[vertex];
+
+			std::vector<uint> cursors(offsets.begin(), offsets.end() - 1);
+			for (size_t i = 0u; i < triangles.size(); ++i)
+				triangles[cursors[indices[i]]++] = (uint)(i / 3u);
+		}
+	};
+
+	// Numbers the used vertices breadth first, starting each connected piece at the first of seeds in it, or at its
+	// first vertex in input order. Returns the vertex each piece numbered last, which is at its edge.
+	std::vector<uint> NumberBreadthFirst(const std::vector<uint>& indices, const VertexTriangles& around, const std::vector<uint>& seeds, std::vector<uint>& order)
+	{
+		size_t vertexCount = around.offsets.size() - 1u;
+		order.assign(vertexCount, NO_VERTEX);
+		std::vector<uint> queue, lasts;
+		queue.reserve(vertexCount);
+		size_t seed = 0u, scan = 0u;
+		for (;;)
+		{
+			uint start = NO_VERTEX;
+			for (; start == NO_VERTEX && seed < seeds.size(); ++seed)
+			{
+				if (order[seeds[seed]] == NO_VERTEX)
+					start = seeds[seed];
+			}
+			for (; start == NO_VERTEX && scan < vertexCount; ++scan)
+			{
+				if (order[scan] == NO_VERTEX && around.offsets[scan] != around.offsets[scan + 1u])
+					start = (uint)scan;
+			}
+			if (start == NO_VERTEX)
+				return lasts;
+
+			order[start] = (uint)queue.size();
+			queue.push_back(start);
+			for (size_t head = queue.size() - 1u; head < queue.size(); ++head)
+			{
+				uint vertex = queue[head];
+				for (uint i = around.offsets[vertex]; i < around.offsets[vertex + 1u]; ++i)
+				{
+					for (uint corner = 0u; corner < 3u; ++corner)
+					{
+						uint neighbour = indices[around.triangles[i] * 3u + corner];
+						if (order[neighbour] == NO_VERTEX)
+						{
+							order[neighbour] = (uint)queue.size();
+							queue.push_back(neighbour);
+						}
+					}
+				}
+			}
+			lasts.push_back(queue.back());
+		}
+	}
+
+	double AnalyzeVertexFetch(const MeshData& mesh)
+	{
+		return MeshOptimizer::AnalyzeVertexFetch(mesh.indices, mesh.vertices.size(), sizeof(MeshData::Vertex));
+	}
+}
+
+void MeshOptimizer::Optimize(MeshData& mesh, const Options& options)
+{
+	MeshData input = mesh;
+	double fetchLimit = ::AnalyzeVertexFetch(input) + options.fetchTolerance;
+
+	OptimizeVertexCacheInBands(mesh.indices, mesh.vertices.size(), options.cacheSize, options.bandVertices);
+
+	// Sorting the clusters takes them away from the bands next to them, which may cost more fetches than it saves pixels.
+	MeshData sorted = mesh;
+	OptimizeOverdraw(sorted.indices, sorted.vertices, options.cacheSize, options.overdrawThreshold);
+	OptimizeVertexFetch(sorted);
+	if (::AnalyzeVertexFetch(sorted) <= fetchLimit)
+		mesh = std::move(sorted);
+	else
+		OptimizeVertexFetch(mesh);
+
+	if (::AnalyzeVertexFetch(mesh) > fetchLimit)
+		mesh = std::move(input);
+}
+
+void MeshOptimizer::OptimizeVertexCache(std::vector<uint>& indices, size_t vertexCount, uint cacheSize)
+{
+	size_t triangleCount = indices.size() / 3u;
+	if (triangleCount == 0u)
+		return;
+
+	// List the triangles around each vertex, packed into one array; the counts become each vertex's live triangles.
+	std::vector<uint> liveCounts(vertexCount, 0u), offsets(vertexCount + 1u, 0u), adjacency(triangleCount * 3u);
+	for (size_t i = 0u; i < triangleCount * 3u; ++i)
+		++liveCounts[indices[i]];
+	for (size_t vertex = 0u; vertex < vertexCount; ++vertex)
+		offsets[vertex + 1u] = offsets[vertex] + liveCounts[vertex];
+
+	std::vector<uint> cursors(offsets.begin(), offsets.end() - 1);
+	for (size_t i = 0u; i < triangleCount * 3u; ++i)
+		adjacency[cursors[indices[i]]++] = (uint)(i / 3u);
+
+	// Timestamps start old enough that every vertex misses the first time it is used.
+	std::vector<uint> timestamps(vertexCount, 0u), deadEnds, candidates, result;
+	std::vector<uchar> emitted(triangleCount, 0u);
+	deadEnds.reserve(triangleCount * 3u);
+	result.reserve(triangleCount * 3u);
+	uint time = cacheSize + 1u;
+	size_t scan = 0u;
+
+	uint fanning = NO_VERTEX;
+	while (scan < vertexCount && liveCounts[scan] == 0u)
+		++scan;
+	if (scan < vertexCount)
+		fanning = (uint)scan;
+
+	while (fanning != NO_VERTEX)
+	{
+		// Emit every triangle left around the fanning vertex, noting the vertices it brings in.
+		candidates.clear();
+		for (uint i = offsets[fanning]; i < offsets[fanning + 1u]; ++i)
+		{
+			uint triangle = adjacency[i];
+			if (emitted[triangle])
+				continue;
+
+			for (uint corner = 0u; corner < 3u; ++corner)
+			{
+				uint vertex = indices[triangle * 3u + corner];
+				result.push_back(vertex);
+				deadEnds.push_back(vertex);
+				candidates.push_back(vertex);
+				--liveCounts[vertex];
+				if (time - timestamps[vertex] > cacheSize)
+					timestamps[vertex] = time++;
+			}
+			emitted[triangle] = 1u;
+		}
+
+		// Move to the candidate that entered the cache longest ago but will still be in it once its own fan is done.
+		uint next = NO_VERTEX;
+		int bestPriority = -1;
+		for (uint vertex : candidates)
+		{
+			if (liveCounts[vertex] == 0u)
+				continue;
+
+			int priority = 0;
+			if (time - timestamps[vertex] + 2u * liveCounts[vertex] <= cacheSize)
+				priority = (int)(time - timestamps[vertex]);
+			if (priority > bestPriority)
+			{
+				next = vertex;
+				bestPriority = priority;
+			}
+		}
+
+		// At a dead end, go back to the most recently used vertex with triangles left, then to any in input order.
+		while (next == NO_VERTEX && !deadEnds.empty())
+		{
+			uint vertex = deadEnds.back();
+			deadEnds.pop_back();
+			if (liveCounts[vertex] != 0u)
+				next = vertex;
+		}
+		while (next == NO_VERTEX && scan < vertexCount)
+		{
+			if (liveCounts[scan] != 0u)
+				next = (uint)scan;
+			else
+				++scan;
+		}
+		fanning = next;
+	}
+
+	// A trailing partial triangle is left where it was.
+	std::copy(result.begin(), result.end(), indices.begin());
+}
+
+void MeshOptimizer::OptimizeVertexCacheInBands(std::vector<uint>& indices, size_t vertexCount, uint cacheSize, uint bandVertices)
+{
+	size_t triangleCount = indices.size() / 3u;
+	if (triangleCount == 0u)
+		return;
+
+	// A first search finds a vertex at the edge of every piece, so the second one sweeps across it in narrow fronts.
+	VertexTriangles around(indices, vertexCount);
+	std::vector<uint> order;
+	std::vector<uint> edges = NumberBreadthFirst(indices, around, {}, order);
+	NumberBreadthFirst(indices, around, edges, order);
+
+	std::vector<uint> lastCorners(triangleCount), triangles(triangleCount);
+	for (size_t triangle = 0u; triangle < triangleCount; ++triangle)
+	{
+		const uint* corners = &indices[triangle * 3u];
+		lastCorners[triangle] = std::max(std::max(order[corners[0]], order[corners[1]]), order[corners[2]]);
+		triangles[triangle] = (uint)triangle;
+	}
+	std::stable_sort(triangles.begin(), triangles.end(), [&](uint a, uint b) { return lastCorners[a] < lastCorners[b]; });
+
+	// Cut that order into bands, numbering each band's vertices from zero so Tipsify only sees the band.
+	std::vector<uint> bandNumbers(vertexCount, NO_VERTEX), bandMembers, bandIndices, result;
+	result.reserve(triangleCount * 3u);
+	auto orderBand = [&]()
+	{
+		OptimizeVertexCache(bandIndices, bandMembers.size(), cacheSize);
+		for (uint index : bandIndices)
+			result.push_back(bandMembers[index]);
+		for (uint vertex : bandMembers)
+			bandNumbers[vertex] = NO_VERTEX;
+		bandMembers.clear();
+		bandIndices.clear();
+	};
+	for (uint triangle : triangles)
+	{
+		const uint* corners = &indices[triangle * 3u];
+		size_t added = (bandNumbers[corners[0]] == NO_VERTEX) + (bandNumbers[corners[1]] == NO_VERTEX) + (bandNumbers[corners[2]] == NO_VERTEX);
+		if (!bandIndices.empty() && bandMembers.size() + added > bandVertices)
+			orderBand();
+
+		for (uint corner = 0u; corner < 3u; ++corner)
+		{
+			uint& number = bandNumbers[corners[corner]];
+			if (number == NO_VERTEX)
+			{
+				number = (uint)bandMembers.size();
+				bandMembers.push_back(corners[corner]);
+			}
+			bandIndices.push_back(number);
+		}
+	}
+	orderBand();
+
+	// A trailing partial triangle is left where it was.
+	std::copy(result.begin(), result.end(), indices.begin());
+}
+
+void MeshOptimizer::OptimizeOverdraw(std::vector<uint>& indices, const std::vector<MeshData::Vertex>& vertices, uint cacheSize, float threshold)
+{
+	size_t triangleCount = indices.size() / 3u;
+	if (triangleCount == 0u)
+		return;
+
+	// Where a triangle misses all three vertices, the cache was of no use to it: a free place to cut the order.
+	FifoCache cache(vertices.size(), cacheSize);
+	std::vector<size_t> hardStarts;
+	for (size_t triangle = 0u; triangle < triangleCount; ++triangle)
+	{
+		if (cache.Access(&indices[triangle * 3u]) == 3u)
+			hardStarts.push_back(triangle);
+	}
+	hardStarts.push_back(triangleCount);
+
+	// Cut each of those again wherever the triangles so far, drawn alone, would miss little more than the whole run.
+	std::vector<Cluster> clusters;
+	for (size_t run = 0u; run + 1u < hardStarts.size(); ++run)
+	{
+		size_t start = hardStarts[run], end = hardStarts[run + 1u];
+		uint runMisses = 0u;
+		cache.Flush();
+		for (size_t triangle = start; triangle < end; ++triangle)
+			runMisses += cache.Access(&indices[triangle * 3u]);
+		float limit = threshold * runMisses / (float)(end - start);
+
+		uint misses = 0u;
+		cache.Flush();
+		clusters.push_back({ start, end, 0.0f });
+		for (size_t triangle = start; triangle < end; ++triangle)
+		{
+			misses += cache.Access(&indices[triangle * 3u]);
+			if (triangle + 1u < end && misses <= limit * (triangle + 1u - clusters.back().start))
+			{
+				clusters.back().end = triangle + 1u;
+				clusters.push_back({ triangle + 1u, end, 0.0f });
+				misses = 0u;
+				cache.Flush();
+			}
+		}
+	}
+
+	// Sum every cluster's area-weighted centroid and normal; the normals are twice the areas since fronts are clockwise.
+	std::vector<float> centroids(clusters.size() * 3u), normals(clusters.size() * 3u), areas(clusters.size());
+	float meshCentroid[3] = {}, meshArea = 0.0f;
+	for (size_t i = 0u; i < clusters.size(); ++i)
+	{
+		float* centroid = &centroids[i * 3u];
+		float* normal = &normals[i * 3u];
+		centroid[0] = centroid[1] = centroid[2] = normal[0] = normal[1] = normal[2] = areas[i] = 0.0f;
+		for (size_t triangle = clusters[i].start; triangle < clusters[i].end; ++triangle)
+		{
+			const float* a = vertices[indices[triangle * 3u + 0u]].position;
+			const float* b = vertices[indices[triangle * 3u + 1u]].position;
+			const float* c = vertices[indices[triangle * 3u + 2u]].position;
+			float ab[3] = { b[0] - a[0], b[1] - a[1], b[2] - a[2] };
+			float ac[3] = { c[0] - a[0], c[1] - a[1], c[2] - a[2] };
+			float cross[3] = { ab[1] * ac[2] - ab[2] * ac[1], ab[2] * ac[0] - ab[0] * ac[2], ab[0] * ac[1] - ab[1] * ac[0] };
+			float area = sqrtf(cross[0] * cross[0] + cross[1] * cross[1] + cross[2] * cross[2]);
+			for (uint axis = 0u; axis < 3u; ++axis)
+			{
+				centroid[axis] += (a[axis] + b[axis] + c[axis]) * area;
+				normal[axis] += cross[axis];
+			}
+			areas[i] += area;
+		}
+		for (uint axis = 0u; axis < 3u; ++axis)
+			meshCentroid[axis] += centroid[axis];
+		meshArea += areas[i];
+	}
+	for (uint axis = 0u; axis < 3u; ++axis)
+		meshCentroid[axis] = meshArea > 0.0f ? meshCentroid[axis] / (3.0f * meshArea) : 0.0f;
+
+	// Clusters far out along their own normal are on the outside of the mesh, and hide the ones further in.
+	for (size_t i = 0u; i < clusters.size(); ++i)
+	{
+		const float* normal = &normals[i * 3u];
+		float length = sqrtf(normal[0] * normal[0] + normal[1] * normal[1] + normal[2] * normal[2]);
+		if (areas[i] <= 0.0f || length <= 0.0f)
+			continue;
+
+		float key = 0.0f;
+		for (uint axis = 0u; axis < 3u; ++axis)
+			key += (centroids[i * 3u + axis] / (3.0f * areas[i]) - meshCentroid[axis]) * normal[axis];
+		clusters[i].sortKey = key / length;
+	}
+	std::stable_sort(clusters.begin(), clusters.end(), [](const Cluster& a, const Cluster& b) { return a.sortKey > b.sortKey; });
+
+	std::vector<uint> result;
+	result.reserve(triangleCount * 3u);
+	for (const Cluster& cluster : clusters)
+		result.insert(result.end(), indices.begin() + cluster.start * 3u, indices.begin() + cluster.end * 3u);
+	std::copy(result.begin(), result.end(), indices.begin());
+}
+
+void MeshOptimizer::OptimizeVertexFetch(MeshData& mesh)
+{
+	// Number the vertices as the indices reach them.
+	MeshData renumbered;
+	std::vector<uint> remap(mesh.vertices.size(), NO_VERTEX);
+	renumbered.vertices.reserve(mesh.vertices.size());
+	renumbered.indices.reserve(mesh.indices.size());
+	for (uint index : mesh.indices)
+	{
+		if (remap[index] == NO_VERTEX)
+		{
+			remap[index] = (uint)renumbered.vertices.size();
+			renumbered.vertices.push_back(mesh.vertices[index]);
+		}
+		renumbered.indices.push_back(remap[index]);
+	}
+
+	// First use is no better when the triangles come back to vertices after the cache has lost them.
+	if (::AnalyzeVertexFetch(renumbered) <= ::AnalyzeVertexFetch(mesh))
+		mesh = std::move(renumbered);
+}
+
+MeshOptimizer::VertexCacheStats MeshOptimizer::AnalyzeVertexCache(const std::vector<uint>& indices, size_t vertexCount, uint cacheSize)
+{
+	VertexCacheStats stats;
+	size_t triangleCount = indices.size() / 3u;
+	if (triangleCount == 0u)
+		return stats;
+
+	FifoCache cache(vertexCount, cacheSize);
+	size_t misses = 0u;
+	for (size_t triangle = 0u; triangle < triangleCount; ++triangle)
+		misses += cache.Access(&indices[triangle * 3u]);
+
+	std::vector<uchar> used(vertexCount, 0u);
+	size_t usedCount = 0u;
+	for (size_t i = 0u; i < triangleCount * 3u; ++i)
+	{
+		usedCount += used[indices[i]] == 0u;
+		used[indices[i]] = 1u;
+	}
+
+	stats.acmr = (double)misses / triangleCount;
+	stats.atvr = (double)misses / usedCount;
+	return stats;
+}
+
+double MeshOptimizer::AnalyzeVertexFetch(const std::vector<uint>& indices, size_t vertexCount, size_t vertexSize)
+{
+	if (indices.empty() || vertexSize == 0u)
+		return 0.0;
+
+	// Each line of memory can only go in one slot; a slot remembers which line it holds, plus one so zero is empty.
+	std::vector<size_t> slots(FETCH_CACHE_LINES, 0u);
+	std::vector<uchar> used(vertexCount, 0u);
+	size_t bytesFetched = 0u, usedCount = 0u;
+	for (uint index : indices)
+	{
+		usedCount += used[index] == 0u;
+		used[index] = 1u;
+
+		size_t first = index * vertexSize / FETCH_CACHE_LINE;
+		size_t last = (index * vertexSize + vertexSize - 1u) / FETCH_CACHE_LINE;
+		for (size_t line = first; line <= last; ++line)
+		{
+			size_t& slot = slots[line % FETCH_CACHE_LINES];
+			if (slot != line + 1u)
+			{
+				slot = line + 1u;
+				bytesFetched += FETCH_CACHE_LINE;
+			}
+		}
+	}
+	return (double)bytesFetched / (usedCount * vertexSize);
+}
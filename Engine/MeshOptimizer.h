@@ -0,0 +1,60 @@
+#pragma once
+
+#include "Common.h"
+#include "MeshData.h"
+
+// Reorders a mesh's triangles and vertices so the GPU runs the vertex shader, shades pixels and fetches vertices fewer
+// times, run by "Engine.exe -cook-mesh" before a mesh is written. The passes follow Sander, Nehab and Barczak, "Fast
+// Triangle Reordering for Vertex Locality and Reduced Overdraw" (2007): Tipsify orders triangles for a FIFO
+// post-transform cache, then clusters of its output are ordered so triangles likely to hide others are drawn first,
+// then vertices are renumbered in the order the triangles use them. Tipsify runs on bands of the mesh small enough
+// for the vertex fetch cache, and a pass that would fetch more than the input did is left out. Triangles keep their
+// corners and winding, so the mesh draws the same image. The analysis functions simulate the caches, so the gains can
+// be measured without a GPU.
+class MeshOptimizer
+{
+public:
+
+	struct Options
+	{
+		uint cacheSize = 16u;				// Entries of the post-transform cache Tipsify plans for.
+		float overdrawThreshold = 1.05f;	// How much worse than Tipsify's ACMR each cluster may become to be split into smaller ones.
+		uint bandVertices = 512u;			// Vertices each band Tipsify orders may use; 10 KB of MeshData's, within the fetch cache.
+		double fetchTolerance = 0.01;		// How much more AnalyzeVertexFetch may rate the optimized mesh than the input.
+	};
+
+	struct VertexCacheStats
+	{
+		double acmr = 0.0;	// Average cache miss ratio, vertex shader runs per triangle: 3 at worst, near 0.5 for large closed meshes.
+		double atvr = 0.0;	// Average transformed vertex ratio, vertex shader runs per vertex used: 1 at best.
+	};
+
+	// OptimizeVertexCacheInBands, OptimizeOverdraw and OptimizeVertexFetch, in order. The overdraw pass is kept only if
+	// AnalyzeVertexFetch still rates the mesh within fetchTolerance of the input; if the result is not, the input is left
+	// as it was.
+	static void Optimize(MeshData& mesh, const Options& options);
+
+	// Tipsify: fans out around one vertex at a time, moving next to the vertex that entered the cache longest ago but
+	// will still be in it after its remaining triangles, or back to a recently used vertex at a dead end. Linear time.
+	static void OptimizeVertexCache(std::vector<uint>& indices, size_t vertexCount, uint cacheSize);
+
+	// Tipsify on bands of the mesh that use at most bandVertices vertices each. The vertices are numbered breadth first
+	// from one at the mesh's edge (Cuthill-McKee), and the triangles taken in the order their last corner is reached, so
+	// a band shares vertices only with the bands just before and after it, which are still in the fetch cache.
+	static void OptimizeVertexCacheInBands(std::vector<uint>& indices, size_t vertexCount, uint cacheSize, uint bandVertices);
+
+	// Splits the triangles into clusters where the cache starts cold, and again wherever a cluster's own ACMR is within
+	// threshold of the whole one's, then draws the clusters facing out from the mesh's centre first.
+	static void OptimizeOverdraw(std::vector<uint>& indices, const std::vector<MeshData::Vertex>& vertices, uint cacheSize, float threshold);
+
+	// Renumbers the vertices in the order the indices first use them, dropping any that are never used, unless
+	// AnalyzeVertexFetch rates the order they are in better.
+	static void OptimizeVertexFetch(MeshData& mesh);
+
+	// Replays the indices through a FIFO cache of cacheSize vertices.
+	static VertexCacheStats AnalyzeVertexCache(const std::vector<uint>& indices, size_t vertexCount, uint cacheSize);
+
+	// Replays the vertex reads through a 16 KB direct-mapped cache of 64-byte lines, a stand-in for the GPU's vertex
+	// fetch cache. Returns the bytes read from memory over the bytes of the vertices used: 1 at best.
+	static double AnalyzeVertexFetch(const std::vector<uint>& indices, size_t vertexCount, size_t vertexSize);
+};
@@ -0,0 +1,235 @@
+#include "MeshOptimizerBenchmark.h"
+#include "EngineMath.h"
+#include "MeshOptimizer.h"
+#include "SoftwareRasterizer.h"
+
+#include <algorithm>
+#include <array>
+#include <chrono>
+#include <math.h>
+#include <random>
+#include <string.h>
+
+namespace
+{
+	const uint CACHE_SIZE = 16u;
+	const uint VIEW_SIZE = 512u;
+	const uint RANDOM_SEED = 20070u;
+
+	double MillisecondsSince(std::chrono::steady_clock::time_point start)
+	{
+		return std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+	}
+
+	// A flat grid of quads in the xz plane, row by row as Model builds its own.
+	MeshData MakeGrid(uint size)
+	{
+		MeshData grid;
+		for (uint z = 0u; z <= size; ++z)
+		{
+			for (uint x = 0u; x <= size; ++x)
+			{
+				float u = (float)x / size, v = (float)z / size;
+				grid.vertices.push_back({ { u * 8.0f - 4.0f, 0.0f, v * 8.0f - 4.0f }, { u, v } });
+			}
+		}
+
+		const uint row = size + 1u;
+		for (uint z = 0u; z < size; ++z)
+		{
+			for (uint x = 0u; x < size; ++x)
+			{
+				uint corner = z * row + x;
+				grid.indices.insert(grid.indices.end(), { corner, corner + row, corner + 1u, corner + 1u, corner + row, corner + row + 1u });
+			}
+		}
+		return grid;
+	}
+
+	// The torus the mesh benchmark imports, already left-handed and clockwise.
+	MeshData MakeTorus(uint segments, uint sides)
+	{
+		const float ringRadius = 3.0f;
+		const float tubeRadius = 1.0f;
+
+		MeshData torus;
+		for (uint side = 0u; side <= sides; ++side)
+		{
+			for (uint segment = 0u; segment <= segments; ++segment)
+			{
+				float u = (float)segment / segments;
+				float v = (float)side / sides;
+				float ringAngle = u * Math::TWO_PI;
+				float tubeAngle = v * Math::TWO_PI;
+				float distance = ringRadius + tubeRadius * cosf(tubeAngle);
+				torus.vertices.push_back({ { distance * cosf(ringAngle), tubeRadius * sinf(tubeAngle), -distance * sinf(ringAngle) }, { u, v } });
+			}
+		}
+
+		const uint row = segments + 1u;
+		for (uint side = 0u; side < sides; ++side)
+		{
+			for (uint segment = 0u; segment < segments; ++segment)
+			{
+				uint corner = side * row + segment;
+				torus.indices.insert(torus.indices.end(), { corner, corner + row + 1u, corner + 1u, corner, corner + row, corner + row + 1u });
+			}
+		}
+		return torus;
+	}
+
+	// Shuffles the triangles and renumbers the vertices at random, keeping each triangle's corners in order.
+	MeshData Shuffle(const MeshData& mesh)
+	{
+		std::mt19937 random(RANDOM_SEED);
+		std::vector<uint> triangles(mesh.indices.size() / 3u), vertices(mesh.vertices.size());
+		for (uint i = 0u; i < triangles.size(); ++i)
+			triangles[i] = i;
+		for (uint i = 0u; i < vertices.size(); ++i)
+			vertices[i] = i;
+		std::shuffle(triangles.begin(), triangles.end(), random);
+		std::shuffle(vertices.begin(), vertices.end(), random);
+
+		MeshData shuffled;
+		shuffled.vertices.resize(mesh.vertices.size());
+		for (size_t i = 0u; i < vertices.size(); ++i)
+			shuffled.vertices[vertices[i]] = mesh.vertices[i];
+		for (uint triangle : triangles)
+		{
+			for (uint corner = 0u; corner < 3u; ++corner)
+				shuffled.indices.push_back(vertices[mesh.indices[triangle * 3u + corner]]);
+		}
+		return shuffled;
+	}
+
+	// Every triangle's corners, as sorted lists of values, so meshes can be compared whatever their order.
+	std::vector<std::array<float, 15>> ListTriangles(const MeshData& mesh)
+	{
+		std::vector<std::array<float, 15>> triangles(mesh.indices.size() / 3u);
+		for (size_t i = 0u; i < triangles.size(); ++i)
+		{
+			for (uint corner = 0u; corner < 3u; ++corner)
+			{
+				const MeshData::Vertex& vertex = mesh.vertices[mesh.indices[i * 3u + corner]];
+				memcpy(&triangles[i][corner * 5u], vertex.position, sizeof(vertex.position));
+				memcpy(&triangles[i][corner * 5u + 3u], vertex.texcoord, sizeof(vertex.texcoord));
+			}
+		}
+		std::sort(triangles.begin(), triangles.end());
+		return triangles;
+	}
+
+	struct Overdraw
+	{
+		double ratio = 0.0;				// Pixels shaded over pixels covered, over all views.
+		std::vector<float> depth;		// Every view's depth buffer, one after the other.
+	};
+
+	// Draws the mesh from eight directions around the y axis, alternately a little above and below the xz plane, where the
+	// torus hides parts of itself. A white texture leaves only the depth test to decide what shades.
+	Overdraw MeasureOverdraw(SoftwareRasterizer& rasterizer, const MeshData& mesh)
+	{
+		const uchar white[4] = { 255u, 255u, 255u, 255u };
+		SoftwareRasterizer::TextureView texture;
+		texture.pixels = white;
+		texture.width = texture.height = 1u;
+		rasterizer.SetTexture(texture);
+
+		SoftwareRasterizer::VertexStream stream;
+		stream.data = mesh.vertices.data();
+		stream.stride = sizeof(MeshData::Vertex);
+		stream.positionOffset = offsetof(MeshData::Vertex, position);
+		stream.texcoordOffset = offsetof(MeshData::Vertex, texcoord);
+		stream.vertexCount = (uint)mesh.vertices.size();
+		rasterizer.SetVertexStream(stream);
+		rasterizer.SetIndexBuffer(mesh.indices.data(), (uint)mesh.indices.size());
+
+		SoftwareRasterizer::Matrix world, view, projection;
+		Math::Matrix4 identity = Math::Identity();
+		Math::Matrix4 perspective = Math::PerspectiveFovLH(Math::PI / 3.0f, 1.0f, 1.0f, 100.0f);
+		memcpy(world.m, identity.m, sizeof(world.m));
+		memcpy(projection.m, perspective.m, sizeof(projection.m));
+
+		Overdraw overdraw;
+		uint64_t shaded = 0u, covered = 0u;
+		for (uint direction = 0u; direction < 8u; ++direction)
+		{
+			float angle = direction * Math::TWO_PI / 8.0f;
+			Math::Float3 eye(12.0f * cosf(angle), (direction & 1u) ? 1.5f : -1.5f, 12.0f * sinf(angle));
+			Math::Matrix4 lookAt = Math::LookAtLH(eye, Math::Float3(), Math::Float3(0.0f, 1.0f, 0.0f));
+			memcpy(view.m, lookAt.m, sizeof(view.m));
+			rasterizer.SetTransforms(world, view, projection);
+
+			rasterizer.ResetStats();
+			rasterizer.Clear(0.0f, 0.0f, 0.0f, 1.0f, 1.0f);
+			rasterizer.DrawIndexed((uint)mesh.indices.size(), 0u, 0);
+			rasterizer.Flush();
+
+			shaded += rasterizer.GetStats().pixelsShaded;
+			const std::vector<float>& depth = rasterizer.GetDepthBuffer();
+			for (float value : depth)
+				covered += value < 1.0f;
+			overdraw.depth.insert(overdraw.depth.end(), depth.begin(), depth.end());
+		}
+		overdraw.ratio = covered == 0u ? 0.0 : (double)shaded / covered;
+		return overdraw;
+	}
+}
+
+bool RunMeshOptimizerBenchmark(std::ostream& output)
+{
+	struct TestMesh
+	{
+		const char* name;
+		MeshData mesh;
+		bool mustShadeLess;
+	};
+
+	MeshData torus = MakeTorus(512u, 256u);
+	TestMesh meshes[] =
+	{
+		{ "Grid 256x256", MakeGrid(256u), false },
+		{ "Torus 512x256", torus, false },
+		{ "Shuffled torus", Shuffle(torus), true },
+	};
+
+	SoftwareRasterizer rasterizer(VIEW_SIZE, VIEW_SIZE);
+	SoftwareRasterizer::Viewport viewport;
+	viewport.width = viewport.height = (float)VIEW_SIZE;
+	rasterizer.SetViewport(viewport);
+
+	MeshOptimizer::Options options;
+	options.cacheSize = CACHE_SIZE;
+
+	bool allMatch = true;
+	output << std::format("Mesh optimization for a {}-entry FIFO vertex cache, overdraw from 8 views at {}x{}", CACHE_SIZE, VIEW_SIZE, VIEW_SIZE) << std::endl;
+	for (TestMesh& test : meshes)
+	{
+		MeshData& mesh = test.mesh;
+		MeshOptimizer::VertexCacheStats cacheBefore = MeshOptimizer::AnalyzeVertexCache(mesh.indices, mesh.vertices.size(), CACHE_SIZE);
+		double fetchBefore = MeshOptimizer::AnalyzeVertexFetch(mesh.indices, mesh.vertices.size(), sizeof(MeshData::Vertex));
+		Overdraw overdrawBefore = MeasureOverdraw(rasterizer, mesh);
+		std::vector<std::array<float, 15>> trianglesBefore = ListTriangles(mesh);
+
+		auto start = std::chrono::steady_clock::now();
+		MeshOptimizer::Optimize(mesh, options);
+		double milliseconds = MillisecondsSince(start);
+
+		MeshOptimizer::VertexCacheStats cacheAfter = MeshOptimizer::AnalyzeVertexCache(mesh.indices, mesh.vertices.size(), CACHE_SIZE);
+		double fetchAfter = MeshOptimizer::AnalyzeVertexFetch(mesh.indices, mesh.vertices.size(), sizeof(MeshData::Vertex));
+		Overdraw overdrawAfter = MeasureOverdraw(rasterizer, mesh);
+
+		// The same triangles draw the same nearest surface in any order; only how much is shaded behind it may change.
+		bool match = ListTriangles(mesh) == trianglesBefore && overdrawAfter.depth == overdrawBefore.depth &&
+			cacheAfter.acmr < cacheBefore.acmr && fetchAfter <= fetchBefore + options.fetchTolerance &&
+			(!test.mustShadeLess || overdrawAfter.ratio < overdrawBefore.ratio);
+		allMatch = allMatch && match;
+
+		output << std::format("{}: {} triangles, {} vertices, optimized in {:.1f} ms {}", test.name, mesh.indices.size() / 3u,
+			mesh.vertices.size(), milliseconds, match ? "OK" : "MISMATCH") << std::endl;
+		output << std::format("  ACMR {:.3f} -> {:.3f}, ATVR {:.3f} -> {:.3f}, overfetch {:.2f} -> {:.2f}, overdraw {:.3f} -> {:.3f}",
+			cacheBefore.acmr, cacheAfter.acmr, cacheBefore.atvr, cacheAfter.atvr, fetchBefore, fetchAfter,
+			overdrawBefore.ratio, overdrawAfter.ratio) << std::endl;
+	}
+	return allMatch;
+}
@@ -0,0 +1,11 @@
+#pragma once
+
+#include <ostream>
+#include "Common.h"
+
+// Optimizes a grid and a torus in row order, and the same torus with its triangles and vertices shuffled as an exporter
+// might leave them, and reports the vertex cache's ACMR and ATVR, vertex fetch overfetch and, drawn with the software
+// rasterizer from eight directions, overdraw before and after. Checks that every mesh keeps its triangles and draws the
+// same depth, that the vertex cache misses less, and that the shuffled torus shades fewer hidden pixels.
+// Run with "Engine.exe -benchmark-mesh-optimizer". Returns false if any check fails.
+bool RunMeshOptimizerBenchmark(std::ostream& output);
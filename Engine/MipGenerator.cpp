@@ -0,0 +1,354 @@
+#include "MipGenerator.h"
+#include "CpuFeatures.h"
+#include "JobSystem.h"
+
+#include <algorithm>
+#include <cmath>
+#include <functional>
+
+#if defined(CPU_X86)
+#include <emmintrin.h>
+#endif
+
+namespace
+{
+	const float PI = 3.14159265358979f;
+
+	// Kaiser filter support in destination pixels and window shape.
+	const float KAISER_RADIUS = 3.0f;
+	const float KAISER_ALPHA = 4.0f;
+
+	// Rows are handed to threads in batches of this size; smaller levels are filtered on one thread.
+	const uint ROWS_PER_TASK = 16u;
+
+	struct Float4
+	{
+		float values[4];
+	};
+
+	// One destination sample along an axis: the first source texel and the weights of the consecutive texels it covers.
+	struct Contribution
+	{
+		int first = 0;
+		std::vector<float> weights;
+	};
+
+	float SrgbToLinear(float value)
+	{
+		return value <= 0.04045f ? value / 12.92f : std::pow((value + 0.055f) / 1.055f, 2.4f);
+	}
+
+	float LinearToSrgb(float value)
+	{
+		return value <= 0.0031308f ? value * 12.92f : 1.055f * std::pow(value, 1.0f / 2.4f) - 0.055f;
+	}
+
+	// Lookup tables for the sRGB transfer function in both directions.
+	struct ConversionTables
+	{
+		float toLinear[256];
+		float toFloat[256];
+		uchar fromLinear[65536];
+
+		ConversionTables()
+		{
+			for (uint i = 0u; i < 256u; ++i)
+			{
+				toLinear[i] = SrgbToLinear(i / 255.0f);
+				toFloat[i] = i / 255.0f;
+			}
+			for (uint i = 0u; i < 65536u; ++i)
+				fromLinear[i] = (uchar)(LinearToSrgb(i / 65535.0f) * 255.0f + 0.5f);
+		}
+	};
+
+	const ConversionTables& GetTables()
+	{
+		static const ConversionTables tables;
+		return tables;
+	}
+
+	float BesselI0(float x)
+	{
+		// Power series of the zeroth order modified Bessel function; converges quickly for the window range used here.
+		float sum = 1.0f;
+		float term = 1.0f;
+		float halfX = x * 0.5f;
+		for (int k = 1; k < 32; ++k)
+		{
+			term *= (halfX / k) * (halfX / k);
+			sum += term;
+			if (term < sum * 1e-7f)
+				break;
+		}
+		return sum;
+	}
+
+	float Sinc(float x)
+	{
+		if (std::fabs(x) < 1e-6f)
+			return 1.0f;
+		return std::sin(PI * x) / (PI * x);
+	}
+
+	float KaiserWeight(float distance)
+	{
+		float ratio = distance / KAISER_RADIUS;
+		if (ratio <= -1.0f || ratio >= 1.0f)
+			return 0.0f;
+		return Sinc(distance) * BesselI0(KAISER_ALPHA * std::sqrt(1.0f - ratio * ratio)) / BesselI0(KAISER_ALPHA);
+	}
+
+	int Address(int index, int size, bool wrap)
+	{
+		if (wrap)
+		{
+			int m = index % size;
+			return m < 0 ? m + size : m;
+		}
+		return std::clamp(index, 0, size - 1);
+	}
+
+	// Precompute, for every destination sample of one axis, which source texels contribute and by how much.
+	std::vector<Contribution> ComputeContributions(uint sourceSize, uint destinationSize, MipGenerator::Filter filter)
+	{
+		std::vector<Contribution> contributions(destinationSize);
+		float scale = (float)sourceSize / (float)destinationSize;
+
+		for (uint i = 0u; i < destinationSize; ++i)
+		{
+			Contribution& contribution = contributions[i];
+			float center = (i + 0.5f) * scale;
+
+			if (filter == MipGenerator::Filter::Box)
+			{
+				// Overlap of each source texel with the destination texel footprint.
+				float begin = center - scale * 0.5f;
+				float end = center + scale * 0.5f;
+				contribution.first = (int)std::floor(begin);
+				for (int texel = contribution.first; (float)texel < end; ++texel)
+				{
+					float overlap = std::min(end, texel + 1.0f) - std::max(begin, (float)texel);
+					contribution.weights.push_back(std::max(0.0f, overlap));
+				}
+			}
+			else
+			{
+				// The kernel is stretched by the scale so it always removes frequencies above the destination Nyquist rate.
+				float support = KAISER_RADIUS * scale;
+				contribution.first = (int)std::floor(center - support);
+				int last = (int)std::ceil(center + support);
+				for (int texel = contribution.first; texel <= last; ++texel)
+					contribution.weights.push_back(KaiserWeight(((texel + 0.5f) - center) / scale));
+			}
+
+			float sum = 0.0f;
+			for (float weight : contribution.weights)
+				sum += weight;
+			for (float& weight : contribution.weights)
+				weight /= sum;
+		}
+
+		return contributions;
+	}
+
+	void ParallelRows(uint rowCount, uint threadCount, const std::function<void(uint, uint)>& function)
+	{
+		uint taskCount = (rowCount + ROWS_PER_TASK - 1u) / ROWS_PER_TASK;
+		threadCount = std::min(threadCount, taskCount);
+		if (threadCount <= 1u)
+		{
+			function(0u, rowCount);
+			return;
+		}
+
+		JobSystem::GetDefault().ParallelFor(taskCount, threadCount, [&](uint task)
+		{
+			function(task * ROWS_PER_TASK, std::min(rowCount, (task + 1u) * ROWS_PER_TASK));
+		});
+	}
+
+	// Source image of one resampling pass: either the RGBA8 top level or the float result of the previous pass.
+	struct SourceImage
+	{
+		const uchar* bytes = nullptr;
+		const Float4* floats = nullptr;
+		uint width = 0u;
+		uint height = 0u;
+		bool srgb = true;
+
+		// Returns row y as linear floats, converting into scratch when the source is RGBA8.
+		const Float4* GetRow(uint y, std::vector<Float4>& scratch) const
+		{
+			if (floats)
+				return floats + (size_t)y * width;
+
+			const ConversionTables& tables = GetTables();
+			const float* colorTable = srgb ? tables.toLinear : tables.toFloat;
+
+			scratch.resize(width);
+			const uchar* row = bytes + (size_t)y * width * 4u;
+			for (uint x = 0u; x < width; ++x)
+			{
+				const uchar* pixel = row + x * 4u;
+				scratch[x] = Float4{ { colorTable[pixel[0]], colorTable[pixel[1]], colorTable[pixel[2]], tables.toFloat[pixel[3]] } };
+			}
+			return scratch.data();
+		}
+	};
+
+	// sum += weight * value on every channel, multiplying and adding separately so SSE and plain floats agree.
+	inline void MultiplyAdd(Float4& sum, float weight, const Float4& value)
+	{
+#if defined(CPU_X86)
+		_mm_storeu_ps(sum.values, _mm_add_ps(_mm_loadu_ps(sum.values), _mm_mul_ps(_mm_set1_ps(weight), _mm_loadu_ps(value.values))));
+#else
+		for (uint channel = 0u; channel < 4u; ++channel)
+			sum.values[channel] += weight * value.values[channel];
+#endif
+	}
+
+	void FilterRowHorizontally(const Float4* sourceRow, uint sourceWidth, const std::vector<Contribution>& horizontal, bool wrap, Float4* destinationRow)
+	{
+		for (size_t x = 0u; x < horizontal.size(); ++x)
+		{
+			const Contribution& contribution = horizontal[x];
+			Float4 sum = {};
+			for (size_t tap = 0u; tap < contribution.weights.size(); ++tap)
+			{
+				int texel = Address(contribution.first + (int)tap, (int)sourceWidth, wrap);
+				MultiplyAdd(sum, contribution.weights[tap], sourceRow[texel]);
+			}
+			destinationRow[x] = sum;
+		}
+	}
+
+	// Resample with separable filters. Each batch of destination rows filters the source rows it needs horizontally
+	// into a small local buffer and then filters that buffer vertically, so no full-size intermediate image is needed.
+	void Resample(const SourceImage& source, std::vector<Float4>& destination, uint destinationWidth, uint destinationHeight,
+		const MipGenerator::Options& options, uint threadCount)
+	{
+		std::vector<Contribution> horizontal = ComputeContributions(source.width, destinationWidth, options.filter);
+		std::vector<Contribution> vertical = ComputeContributions(source.height, destinationHeight, options.filter);
+
+		destination.resize((size_t)destinationWidth * destinationHeight);
+		ParallelRows(destinationHeight, threadCount, [&](uint rowBegin, uint rowEnd)
+		{
+			// Unwrapped range of source rows touched by this batch.
+			int firstRow = vertical[rowBegin].first;
+			int lastRow = vertical[rowEnd - 1u].first + (int)vertical[rowEnd - 1u].weights.size();
+			uint rowCount = (uint)(lastRow - firstRow);
+
+			std::vector<Float4> scratch;
+			std::vector<Float4> filtered((size_t)rowCount * destinationWidth);
+			for (uint i = 0u; i < rowCount; ++i)
+			{
+				uint sourceRow = (uint)Address(firstRow + (int)i, (int)source.height, options.wrap);
+				FilterRowHorizontally(source.GetRow(sourceRow, scratch), source.width, horizontal, options.wrap, filtered.data() + (size_t)i * destinationWidth);
+			}
+
+			for (uint y = rowBegin; y < rowEnd; ++y)
+			{
+				const Contribution& contribution = vertical[y];
+				Float4* destinationRow = destination.data() + (size_t)y * destinationWidth;
+
+				// Accumulate whole rows at a time so the inner loop streams through memory.
+				for (uint x = 0u; x < destinationWidth; ++x)
+					destinationRow[x] = Float4{};
+
+				for (size_t tap = 0u; tap < contribution.weights.size(); ++tap)
+				{
+					const Float4* filteredRow = filtered.data() + (size_t)(contribution.first + (int)tap - firstRow) * destinationWidth;
+					float weight = contribution.weights[tap];
+					for (uint x = 0u; x < destinationWidth; ++x)
+						MultiplyAdd(destinationRow[x], weight, filteredRow[x]);
+				}
+			}
+		});
+	}
+
+	void ConvertToBytes(const std::vector<Float4>& input, bool srgb, std::vector<uchar>& pixels)
+	{
+		const ConversionTables& tables = GetTables();
+
+		pixels.resize(input.size() * 4u);
+		for (size_t i = 0u; i < input.size(); ++i)
+		{
+			// Kaiser filtering can overshoot slightly, so clamp before quantizing.
+			float clamped[4];
+#if defined(CPU_X86)
+			_mm_storeu_ps(clamped, _mm_min_ps(_mm_max_ps(_mm_loadu_ps(input[i].values), _mm_setzero_ps()), _mm_set1_ps(1.0f)));
+#else
+			for (uint channel = 0u; channel < 4u; ++channel)
+			{
+				float value = input[i].values[channel] > 0.0f ? input[i].values[channel] : 0.0f;
+				clamped[channel] = value < 1.0f ? value : 1.0f;
+			}
+#endif
+
+			uchar* pixel = pixels.data() + i * 4u;
+			for (uint channel = 0u; channel < 3u; ++channel)
+			{
+				pixel[channel] = srgb ? tables.fromLinear[(uint)(clamped[channel] * 65535.0f + 0.5f)] : (uchar)(clamped[channel] * 255.0f + 0.5f);
+			}
+			pixel[3] = (uchar)(clamped[3] * 255.0f + 0.5f);
+		}
+	}
+}
+
+uint MipGenerator::GetLevelCount(uint width, uint height)
+{
+	uint levels = 1u;
+	uint size = std::max(width, height);
+	while (size > 1u)
+	{
+		size /= 2u;
+		levels++;
+	}
+	return levels;
+}
+
+std::vector<MipGenerator::Level> MipGenerator::Generate(const uchar* pixels, uint width, uint height, const Options& options)
+{
+	std::vector<Level> levels;
+	if (!pixels || width == 0u || height == 0u)
+		return levels;
+
+	uint threadCount = options.threadCount;
+	if (threadCount == 0u)
+		threadCount = JobSystem::GetDefault().GetThreadCount();
+
+	// Level 1 is filtered straight from the RGBA8 top level. Every further level is filtered from the float result of
+	// the previous one, so colors are quantized only once per level and no float copy of the top level is made.
+	SourceImage source;
+	source.bytes = pixels;
+	source.width = width;
+	source.height = height;
+	source.srgb = options.srgb;
+
+	std::vector<Float4> previous;
+	std::vector<Float4> current;
+
+	uint levelCount = GetLevelCount(width, height);
+	for (uint level = 1u; level < levelCount; ++level)
+	{
+		uint nextWidth = std::max(1u, source.width / 2u);
+		uint nextHeight = std::max(1u, source.height / 2u);
+
+		Resample(source, current, nextWidth, nextHeight, options, threadCount);
+
+		Level output;
+		output.width = nextWidth;
+		output.height = nextHeight;
+		ConvertToBytes(current, options.srgb, output.pixels);
+		levels.push_back(std::move(output));
+
+		std::swap(previous, current);
+		source.bytes = nullptr;
+		source.floats = previous.data();
+		source.width = nextWidth;
+		source.height = nextHeight;
+	}
+
+	return levels;
+}
@@ -0,0 +1,39 @@
+#pragma once
+
+#include "Common.h"
+
+// Builds the mip chain of an RGBA8 image on the CPU, so textures can be created immutable with every level filled in
+// instead of relying on ID3D11DeviceContext::GenerateMips. Color channels can be filtered in linear light (sRGB-correct)
+// while alpha is always filtered as-is. Rows of each level are filtered in parallel.
+// The generator has no Direct3D dependency and runs on any platform.
+class MipGenerator
+{
+public:
+
+	enum class Filter
+	{
+		Box,	// Area average of the source pixels under each destination pixel.
+		Kaiser	// Kaiser-windowed sinc, sharper than the box filter with little ringing.
+	};
+
+	struct Options
+	{
+		Filter filter = Filter::Box;
+		bool srgb = true;		// Treat RGB as sRGB encoded and filter in linear space.
+		bool wrap = true;		// Wrap at the borders like the texture sampler; otherwise clamp.
+		uint threadCount = 0u;	// 0 uses every thread of the job system.
+	};
+
+	struct Level
+	{
+		uint width = 0u;
+		uint height = 0u;
+		std::vector<uchar> pixels;
+	};
+
+	// Number of levels in a full chain down to 1x1, including the top level.
+	static uint GetLevelCount(uint width, uint height);
+
+	// Generates levels 1 to GetLevelCount() - 1 from the top level. The top level itself is not copied.
+	static std::vector<Level> Generate(const uchar* pixels, uint width, uint height, const Options& options);
+};
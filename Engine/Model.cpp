@@ -1,24 +1,48 @@
 #include "Model.h"
-#include "D3D.h"
+#include "D3DContext.h"
 #include "Common.h"
 
+#include <atomic>
+#include <stddef.h>
+#include <string.h>
+
+#ifdef _WIN32
+#include "D3D.h"
+#endif
 
-struct VertexType
+namespace
 {
-	DirectX::XMFLOAT3 position;
-	DirectX::XMFLOAT2 texture;
-};
+	std::atomic<uint> nextModelId = 1u;
 
-Model::Model(ID3D11Device* device, ID3D11DeviceContext* deviceContext, const char* textureFilename)
+	static_assert(sizeof(MeshData::Vertex) == sizeof(Model::VertexType) && offsetof(MeshData::Vertex, position) == offsetof(Model::VertexType, position)
+		&& offsetof(MeshData::Vertex, texcoord) == offsetof(Model::VertexType, texture), "MeshData vertices are copied into the vertex buffer as they are");
+}
+
+Model::Model(RenderBackend& renderer)
+	: _id(nextModelId++)
 {
-	InitializeBuffers(device, deviceContext, textureFilename);
-	LoadTexture(device, deviceContext, textureFilename);
+	InitializeGrid();
+	InitializeBuffers(GetDevice(renderer));
 }
 
-void Model::Render(ID3D11DeviceContext* deviceContext)
+Model::Model(RenderBackend& renderer, const MeshData& mesh)
+	: _id(nextModelId++)
+{
+	_vertexCount = (int)mesh.vertices.size();
+	_indexCount = (int)mesh.indices.size();
+	_vertices.resize(mesh.vertices.size());
+	memcpy((void*)_vertices.data(), mesh.vertices.data(), mesh.vertices.size() * sizeof(VertexType));
+	_indices = mesh.indices;
+
+	InitializeBuffers(GetDevice(renderer));
+}
+
+Model::~Model() = default;
+
+void Model::Render(RenderBackend& renderer)
 {
 	// Put the vertex and index buffers on the graphics pipeline to prepare them for drawing.
-	RenderBuffers(deviceContext);
+	RenderBuffers(renderer);
 }
 
 int Model::GetIndexCount()
@@ -26,10 +50,38 @@ int Model::GetIndexCount()
 	return _indexCount;
 }
 
-void Model::InitializeBuffers(ID3D11Device* device, ID3D11DeviceContext* deviceContext, const char* textureFilename)
+uint Model::GetId() const
 {
-	HRESULT result;
+	return _id;
+}
+
+const Bounds& Model::GetBounds() const
+{
+	return _bounds;
+}
+
+const std::vector<Model::VertexType>& Model::GetVertices() const
+{
+	return _vertices;
+}
+
+const std::vector<uint>& Model::GetIndices() const
+{
+	return _indices;
+}
+
+const std::vector<VertexElement>& Model::GetVertexFormat()
+{
+	static const std::vector<VertexElement> vertexFormat =
+	{
+		{ "POSITION", 0u, VertexFormat::Float3, (uint)offsetof(VertexType, position) },
+		{ "TEXCOORD", 0u, VertexFormat::Float2, (uint)offsetof(VertexType, texture) }
+	};
+	return vertexFormat;
+}
 
+void Model::InitializeGrid()
+{
 	const int GRID_SIZE = 10;
 	const int VERTICES_PER_ROW = GRID_SIZE + 1;
 	const int VERTICES_PER_COLUMN = GRID_SIZE + 1;
@@ -37,14 +89,8 @@ void Model::InitializeBuffers(ID3D11Device* device, ID3D11DeviceContext* deviceC
 	// Set the number of vertices in the vertex array.
 	_vertexCount = VERTICES_PER_ROW * VERTICES_PER_COLUMN;
 
-	// Set the number of indices in the index array.
-	_indexCount = GRID_SIZE * GRID_SIZE * 6;
-
 	// Create the vertex array.
-	std::vector<VertexType> vertices(_vertexCount);
-
-	// Create the index array.
-	std::vector<uint> indices(_indexCount);
+	_vertices.resize(_vertexCount);
 
 	// Initialize vertex array
 	for (int row = 0; row < VERTICES_PER_COLUMN; ++row)
@@ -53,30 +99,28 @@ void Model::InitializeBuffers(ID3D11Device* device, ID3D11DeviceContext* deviceC
 		{
 			int index = row * VERTICES_PER_ROW + col;
 			
-			vertices[index].position = DirectX::XMFLOAT3((float)col, (float)row, 0.0f);
-			vertices[index].texture = DirectX::XMFLOAT2((float)col / GRID_SIZE, (float)row / GRID_SIZE);
+			_vertices[index].position = Math::Float3((float)col, (float)row, 0.0f);
+			_vertices[index].texture = Math::Float2((float)col / GRID_SIZE, (float)row / GRID_SIZE);
 		}
 	}
 
 	// Initialize index array
-	int index = 0;
-	for (int row = 0; row < GRID_SIZE; ++row)
-	{
-		for (int col = 0; col < GRID_SIZE; ++col)
-		{
-			int topLeft = row * VERTICES_PER_ROW + col;
-			int topRight = topLeft + 1;
-			int bottomLeft = topLeft + VERTICES_PER_ROW;
-			int bottomRight = bottomLeft + 1;
-
-			indices[index++] = topLeft;
-			indices[index++] = bottomLeft;
-			indices[index++] = topRight;
-			indices[index++] = topRight;
-			indices[index++] = bottomLeft;
-			indices[index++] = bottomRight;
-		}
-	}
+	_indices.clear();
+	MeshData::AppendGridIndices(_indices, GRID_SIZE, GRID_SIZE);
+	_indexCount = (int)_indices.size();
+}
+
+void Model::InitializeBuffers(ID3D11Device* device)
+{
+	// Bound the vertices for culling.
+	_bounds = _vertices.empty() ? Bounds() : Bounds::FromPoints(&_vertices[0].position, _vertices.size(), sizeof(VertexType));
+
+	// Backends without a device draw straight from the arrays.
+	if (!device)
+		return;
+
+#ifdef _WIN32
+	HRESULT result;
 
 	// Set up the description of the static vertex buffer.
 	D3D11_BUFFER_DESC vertexBufferDesc;
@@ -89,7 +133,7 @@ void Model::InitializeBuffers(ID3D11Device* device, ID3D11DeviceContext* deviceC
 
 	// Give the subresource structure a pointer to the vertex data.
 	D3D11_SUBRESOURCE_DATA vertexData;
-	vertexData.pSysMem = vertices.data();
+	vertexData.pSysMem = _vertices.data();
 	vertexData.SysMemPitch = 0;
 	vertexData.SysMemSlicePitch = 0;
 
@@ -109,7 +153,7 @@ void Model::InitializeBuffers(ID3D11Device* device, ID3D11DeviceContext* deviceC
 
 	// Give the subresource structure a pointer to the index data.
 	D3D11_SUBRESOURCE_DATA indexData;
-	indexData.pSysMem = indices.data();
+	indexData.pSysMem = _indices.data();
 	indexData.SysMemPitch = 0;
 	indexData.SysMemSlicePitch = 0;
 
@@ -117,36 +161,22 @@ void Model::InitializeBuffers(ID3D11Device* device, ID3D11DeviceContext* deviceC
 	result = device->CreateBuffer(&indexBufferDesc, &indexData, &_indexBuffer);
 	if (FAILED(result))
 		throw D3DError("Failed to create an index buffer");
+#endif
 }
 
-ID3D11ShaderResourceView* Model::GetTexture()
-{
-	return _texture->GetTexture();
-}
-
-bool Model::LoadTexture(ID3D11Device* device, ID3D11DeviceContext* deviceContext, const char* filename)
-{
-	// Create and initialize the texture object.
-	_texture = std::make_unique<Texture>(device, deviceContext, filename);
-
-	return _texture->IsValid();
-}
-
-void Model::RenderBuffers(ID3D11DeviceContext* deviceContext)
+void Model::RenderBuffers(RenderBackend& renderer)
 {
-	uint stride;
-	uint offset;
-
-	// Set vertex buffer stride and offset.
-	stride = sizeof(VertexType);
-	offset = 0;
-
-	// Set the vertex buffer to active in the input assembler so it can be rendered.
-	deviceContext->IASetVertexBuffers(0, 1, &_vertexBuffer, &stride, &offset);
-
-	// Set the index buffer to active in the input assembler so it can be rendered.
-	deviceContext->IASetIndexBuffer(_indexBuffer.get(), DXGI_FORMAT_R32_UINT, 0);
-
-	// Set the type of primitive that should be rendered from this vertex buffer, in this case triangles.
-	deviceContext->IASetPrimitiveTopology(D3D11_PRIMITIVE_TOPOLOGY_TRIANGLELIST);
+	MeshBuffers mesh;
+	mesh.vertexBuffer = _vertexBuffer.get();
+	mesh.indexBuffer = _indexBuffer.get();
+	mesh.vertices = _vertices.data();
+	mesh.indices = _indices.data();
+	mesh.vertexStride = sizeof(VertexType);
+	mesh.positionOffset = offsetof(VertexType, position);
+	mesh.texcoordOffset = offsetof(VertexType, texture);
+	mesh.vertexCount = (uint)_vertexCount;
+	mesh.indexCount = (uint)_indexCount;
+
+	// Set the vertex and index buffers active so they can be rendered.
+	renderer.SetMesh(mesh);
 }
@@ -1,32 +1,58 @@
 #pragma once
 
-#include <d3d11.h>
-#include <directxmath.h>
+#include "Bounds.h"
+#include "EngineMath.h"
+#include "MeshData.h"
 #include "ReleasePtr.h"
-#include "Texture.h"
+#include "RenderBackend.h"
+
+struct ID3D11Device;
 
 class Model
 {
 public:
 
-	Model(ID3D11Device* device, ID3D11DeviceContext* deviceContext, const char* textureFilename);
+	struct VertexType
+	{
+		Math::Float3 position;
+		Math::Float2 texture;
+	};
+
+	// Geometry only; how the model looks is up to the Material it is drawn with. Without a mesh the model is a
+	// 10 by 10 grid of quads.
+	Model(RenderBackend& renderer);
+	Model(RenderBackend& renderer, const MeshData& mesh);
+	~Model();
 
-	void Render(ID3D11DeviceContext* deviceContext);
+	void Render(RenderBackend& renderer);
 
 	int GetIndexCount();
 
-	ID3D11ShaderResourceView* GetTexture();
+	// Unique per model, so draws can be sorted to bind each mesh once.
+	uint GetId() const;
 
-private:
+	// Bounds of the vertices in model space.
+	const Bounds& GetBounds() const;
 
-	void InitializeBuffers(ID3D11Device* device, ID3D11DeviceContext* deviceContext, const char* textureFilename);
-	void RenderBuffers(ID3D11DeviceContext* deviceContext);
+	// CPU copies of the vertex and index buffers.
+	const std::vector<VertexType>& GetVertices() const;
+	const std::vector<uint>& GetIndices() const;
+
+	// Layout of VertexType, which shader programs match their vertex inputs against.
+	static const std::vector<VertexElement>& GetVertexFormat();
+
+private:
 
-	bool LoadTexture(ID3D11Device*, ID3D11DeviceContext*, const char* filename);
+	void InitializeGrid();
+	void InitializeBuffers(ID3D11Device* device);
+	void RenderBuffers(RenderBackend& renderer);
 
+	uint _id = 0u;
 	ReleasePtr<ID3D11Buffer> _vertexBuffer;
 	ReleasePtr<ID3D11Buffer> _indexBuffer;
+	std::vector<VertexType> _vertices; // CPU copies of the buffers, read by backends that rasterize on the CPU.
+	std::vector<uint> _indices;
 	int _vertexCount = 0;
 	int _indexCount = 0;
-	std::unique_ptr<Texture> _texture;
+	Bounds _bounds;
 };
\ No newline at end of file
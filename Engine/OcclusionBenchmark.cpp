@@ -0,0 +1,295 @@
+#include "OcclusionBenchmark.h"
+#include "Frustum.h"
+#include "MeshData.h"
+#include "OcclusionCuller.h"
+#include "SoftwareRasterizer.h"
+
+#include <algorithm>
+#include <chrono>
+#include <math.h>
+#include <random>
+#include <string.h>
+
+namespace
+{
+	const uint BLOCKS = 12u;				// Buildings along each side of the city.
+	const float BLOCK_SIZE = 24.0f;
+	const float BUILDING_SIZE = 16.0f;		// The rest of each block is street.
+	const float MIN_HEIGHT = 8.0f;
+	const float MAX_HEIGHT = 40.0f;
+	const uint OBJECT_COUNT = 20000u;
+	const float MIN_OBJECT_SIZE = 0.5f;
+	const float MAX_OBJECT_SIZE = 2.0f;
+	const uint CULL_WIDTH = 320u;
+	const uint CULL_HEIGHT = 180u;
+	const uint TRUTH_WIDTH = 1280u;
+	const uint TRUTH_HEIGHT = 720u;
+	const float FIELD_OF_VIEW = Math::PI / 4.0f;
+	const float NEAR_PLANE = 0.3f;
+	const float FAR_PLANE = 1000.0f;
+	const uint REPETITIONS = 20u;
+	const uint RANDOM_SEED = 7u;
+	const uint32_t BUILDING_COLOR = 0xFFFFFFFFu;
+	const float DEPTH_TOLERANCE = 1e-4f;
+
+	struct View
+	{
+		const char* name;
+		Math::Float3 eye;
+		Math::Float3 direction;
+	};
+
+	const View VIEWS[] =
+	{
+		{ "Down a street", Math::Float3(-72.0f, 1.8f, -140.0f), Math::Float3(0.0f, 0.0f, 1.0f) },
+		{ "Along a cross street", Math::Float3(-140.0f, 1.8f, 24.0f), Math::Float3(1.0f, 0.0f, 0.0f) },
+		{ "Diagonally from a crossing", Math::Float3(0.0f, 1.8f, 0.0f), Math::Float3(1.0f, 0.0f, 1.0f) },
+		{ "From a corner of the city", Math::Float3(-150.0f, 1.8f, -150.0f), Math::Float3(1.0f, 0.0f, 1.0f) },
+		{ "Over the roofs", Math::Float3(-150.0f, 50.0f, -150.0f), Math::Float3(1.0f, -0.35f, 1.0f) },
+		{ "From above", Math::Float3(0.0f, 150.0f, -60.0f), Math::Float3(0.0f, -1.0f, 0.5f) },
+	};
+
+	struct City
+	{
+		MeshData box;	// Unit cube standing on the ground: x and z from -0.5 to 0.5, y from 0 to 1.
+		OcclusionCuller::Mesh occluder;
+		std::vector<Math::Matrix4> buildings;
+		std::vector<Math::Matrix4> objects;
+		std::vector<Bounds> objectBounds;
+		std::vector<uint32_t> objectColors;	// Object i is drawn in colour i + 1, so the truth render says who is visible.
+	};
+
+	// Faces clockwise seen from outside: for each normal, corners go bottom left, top left, top right, bottom right as
+	// seen by a viewer looking at the face.
+	MeshData MakeBox()
+	{
+		const Math::Float3 normals[6] =
+		{
+			Math::Float3(1.0f, 0.0f, 0.0f), Math::Float3(-1.0f, 0.0f, 0.0f), Math::Float3(0.0f, 1.0f, 0.0f),
+			Math::Float3(0.0f, -1.0f, 0.0f), Math::Float3(0.0f, 0.0f, 1.0f), Math::Float3(0.0f, 0.0f, -1.0f),
+		};
+		const float corners[4][2] = { { -1.0f, -1.0f }, { -1.0f, 1.0f }, { 1.0f, 1.0f }, { 1.0f, -1.0f } };
+
+		MeshData box;
+		for (const Math::Float3& normal : normals)
+		{
+			Math::Float3 up = normal.y != 0.0f ? Math::Float3(0.0f, 0.0f, 1.0f) : Math::Float3(0.0f, 1.0f, 0.0f);
+			Math::Float3 right = Math::Cross(up, -normal);
+			Math::Float3 center = Math::Float3(0.0f, 0.5f, 0.0f) + normal * 0.5f;
+
+			uint first = (uint)box.vertices.size();
+			for (const float* corner : corners)
+			{
+				Math::Float3 position = center + right * (corner[0] * 0.5f) + up * (corner[1] * 0.5f);
+				box.vertices.push_back(MeshData::Vertex{ { position.x, position.y, position.z }, { 0.0f, 0.0f } });
+			}
+			for (uint index : { 0u, 1u, 2u, 0u, 2u, 3u })
+				box.indices.push_back(first + index);
+		}
+		return box;
+	}
+
+	// A grid of buildings of random heights, with objects scattered over the ground and put on the roofs of the
+	// buildings they land in.
+	City MakeCity()
+	{
+		std::mt19937 random(RANDOM_SEED);
+		std::uniform_real_distribution<float> height(MIN_HEIGHT, MAX_HEIGHT);
+		const float half = BLOCKS * BLOCK_SIZE * 0.5f;
+		std::uniform_real_distribution<float> position(-half, half);
+		std::uniform_real_distribution<float> size(MIN_OBJECT_SIZE, MAX_OBJECT_SIZE);
+
+		City city;
+		city.box = MakeBox();
+		city.occluder = OcclusionCuller::Mesh(city.box.vertices.data(), (uint)city.box.vertices.size(), sizeof(MeshData::Vertex),
+			city.box.indices.data(), (uint)city.box.indices.size());
+
+		std::vector<float> heights(BLOCKS * BLOCKS);
+		for (uint z = 0u; z < BLOCKS; ++z)
+		{
+			for (uint x = 0u; x < BLOCKS; ++x)
+			{
+				heights[z * BLOCKS + x] = height(random);
+				city.buildings.push_back(Math::Multiply(Math::Scaling(BUILDING_SIZE, heights[z * BLOCKS + x], BUILDING_SIZE),
+					Math::Translation(-half + (x + 0.5f) * BLOCK_SIZE, 0.0f, -half + (z + 0.5f) * BLOCK_SIZE)));
+			}
+		}
+
+		for (uint i = 0u; i < OBJECT_COUNT; ++i)
+		{
+			float x = position(random), z = position(random), scale = size(random);
+			uint blockX = std::min((uint)((x + half) / BLOCK_SIZE), BLOCKS - 1u);
+			uint blockZ = std::min((uint)((z + half) / BLOCK_SIZE), BLOCKS - 1u);
+			float localX = x + half - (blockX + 0.5f) * BLOCK_SIZE, localZ = z + half - (blockZ + 0.5f) * BLOCK_SIZE;
+			bool onRoof = fabsf(localX) < BUILDING_SIZE * 0.5f && fabsf(localZ) < BUILDING_SIZE * 0.5f;
+			float base = onRoof ? heights[blockZ * BLOCKS + blockX] : 0.0f;
+
+			city.objects.push_back(Math::Multiply(Math::Scaling(scale, scale, scale), Math::Translation(x, base, z)));
+			Bounds bounds;
+			bounds.center = Math::Float3(x, base + scale * 0.5f, z);
+			bounds.extents = Math::Float3(scale * 0.5f, scale * 0.5f, scale * 0.5f);
+			bounds.radius = scale * 0.5f * sqrtf(3.0f);
+			city.objectBounds.push_back(bounds);
+			city.objectColors.push_back((i + 1u) | 0xFF000000u);
+		}
+		return city;
+	}
+
+	SoftwareRasterizer::Matrix ToRasterizer(const Math::Matrix4& matrix)
+	{
+		SoftwareRasterizer::Matrix result;
+		memcpy(result.m, matrix.m, sizeof(result.m));
+		return result;
+	}
+
+	// Draws the buildings, and the objects given, with every object in its own colour.
+	void DrawCity(SoftwareRasterizer& rasterizer, const City& city, const std::vector<uint>& objects, const Math::Matrix4& view,
+		const Math::Matrix4& projection)
+	{
+		SoftwareRasterizer::Viewport viewport;
+		viewport.width = (float)rasterizer.GetWidth();
+		viewport.height = (float)rasterizer.GetHeight();
+		rasterizer.SetViewport(viewport);
+
+		SoftwareRasterizer::VertexStream stream;
+		stream.data = city.box.vertices.data();
+		stream.stride = sizeof(MeshData::Vertex);
+		stream.positionOffset = offsetof(MeshData::Vertex, position);
+		stream.texcoordOffset = offsetof(MeshData::Vertex, texcoord);
+		stream.vertexCount = (uint)city.box.vertices.size();
+		rasterizer.SetVertexStream(stream);
+		rasterizer.SetIndexBuffer(city.box.indices.data(), (uint)city.box.indices.size());
+		rasterizer.Clear(0.0f, 0.0f, 0.0f, 0.0f, 1.0f);
+
+		SoftwareRasterizer::Matrix rasterizerView = ToRasterizer(view), rasterizerProjection = ToRasterizer(projection);
+		auto draw = [&](const Math::Matrix4& world, const uint32_t* color)
+		{
+			SoftwareRasterizer::TextureView texture;
+			texture.pixels = (const uchar*)color;
+			texture.width = texture.height = 1u;
+			rasterizer.SetTexture(texture);
+			rasterizer.SetTransforms(ToRasterizer(world), rasterizerView, rasterizerProjection);
+			rasterizer.DrawIndexed((uint)city.box.indices.size(), 0u, 0);
+		};
+
+		for (const Math::Matrix4& building : city.buildings)
+			draw(building, &BUILDING_COLOR);
+		for (uint object : objects)
+			draw(city.objects[object], &city.objectColors[object]);
+		rasterizer.Flush();
+	}
+
+	// Rasterizes the buildings into the culler's pyramid.
+	void RenderOccluders(OcclusionCuller& culler, const City& city, const Math::Matrix4& viewProjection)
+	{
+		culler.BeginFrame(viewProjection);
+		for (const Math::Matrix4& building : city.buildings)
+			culler.AddOccluder(city.occluder, building);
+		culler.Render();
+		culler.Wait();
+	}
+}
+
+bool RunOcclusionBenchmark(std::ostream& output)
+{
+	City city = MakeCity();
+	OcclusionCuller culler(CULL_WIDTH, CULL_HEIGHT);
+	SoftwareRasterizer truth(TRUTH_WIDTH, TRUTH_HEIGHT);
+	SoftwareRasterizer reference(CULL_WIDTH, CULL_HEIGHT);
+	Math::Matrix4 projection = Math::PerspectiveFovLH(FIELD_OF_VIEW, (float)CULL_WIDTH / CULL_HEIGHT, NEAR_PLANE, FAR_PLANE);
+
+	output << std::format("Occlusion culling of {} objects behind {} buildings: {}x{} depth buffer, {} levels, {} kernel, average of {} runs",
+		OBJECT_COUNT, city.buildings.size(), CULL_WIDTH, CULL_HEIGHT, culler.GetLevelCount(), OcclusionCuller::GetKernelName(), REPETITIONS) << std::endl;
+	output << std::format("Visibility from {}x{} renders of every object in the frustum", TRUTH_WIDTH, TRUTH_HEIGHT) << std::endl;
+
+	bool allMatch = true;
+	uint totalInFrustum = 0u, totalHidden = 0u, totalCulled = 0u, totalWrong = 0u;
+	for (const View& view : VIEWS)
+	{
+		Math::Matrix4 lookTo = Math::LookToLH(view.eye, view.direction, Math::Float3(0.0f, 1.0f, 0.0f));
+		Math::Matrix4 viewProjection = Math::Multiply(lookTo, projection);
+
+		// Frustum culling first, as the engine does; occlusion culling only sees what it leaves.
+		Frustum frustum(viewProjection);
+		std::vector<uint> inFrustum;
+		for (uint i = 0u; i < OBJECT_COUNT; ++i)
+		{
+			if (frustum.Intersects(city.objectBounds[i]))
+				inFrustum.push_back(i);
+		}
+
+		// Time rasterizing the occluders and testing the objects.
+		double renderMilliseconds = 0.0, testMilliseconds = 0.0;
+		std::vector<uint> remaining;
+		for (uint repetition = 0u; repetition < REPETITIONS; ++repetition)
+		{
+			RenderOccluders(culler, city, viewProjection);
+			remaining = inFrustum;
+			culler.Cull(city.objectBounds, remaining);
+			renderMilliseconds += culler.GetStats().renderMilliseconds;
+			testMilliseconds += culler.GetStats().testMilliseconds;
+		}
+		const OcclusionCuller::Stats& stats = culler.GetStats();
+
+		// The scalar kernel must write the same depth as the vector ones.
+		std::vector<float> depth = culler.GetDepthBuffer();
+		culler.SetScalar(true);
+		RenderOccluders(culler, city, viewProjection);
+		culler.SetScalar(false);
+		bool kernelsMatch = depth == culler.GetDepthBuffer();
+
+		// Compare the occluder depth with SoftwareRasterizer's at the same resolution. Pixels on edges may go either way,
+		// as it snaps vertices to fixed point and gives pixels on shared edges to one triangle only.
+		DrawCity(reference, city, {}, lookTo, projection);
+		uint differing = 0u, covered = 0u;
+		for (uint y = 0u; y < CULL_HEIGHT; ++y)
+		{
+			for (uint x = 0u; x < CULL_WIDTH; ++x)
+			{
+				float expected = reference.GetDepthBuffer()[y * CULL_WIDTH + x], actual = depth[y * culler.GetPitch() + x];
+				covered += expected < 1.0f;
+				differing += (expected < 1.0f) != (actual < 1.0f) || fabsf(expected - actual) > DEPTH_TOLERANCE;
+			}
+		}
+		bool depthMatches = differing * 100u <= covered;
+
+		// Find what is really visible, and check nothing visible was culled.
+		DrawCity(truth, city, inFrustum, lookTo, projection);
+		std::vector<uchar> visible(OBJECT_COUNT, 0u);
+		for (uint32_t color : truth.GetColorBuffer())
+		{
+			uint32_t id = color & 0xFFFFFFu;
+			if (id != 0u && color != BUILDING_COLOR)
+				visible[id - 1u] = 1u;
+		}
+		std::vector<uchar> kept(OBJECT_COUNT, 0u);
+		for (uint object : remaining)
+			kept[object] = 1u;
+
+		uint visibleCount = 0u, wrong = 0u;
+		for (uint object : inFrustum)
+		{
+			visibleCount += visible[object];
+			wrong += visible[object] && !kept[object];
+		}
+		uint hidden = (uint)inFrustum.size() - visibleCount, culled = (uint)(inFrustum.size() - remaining.size());
+
+		bool match = kernelsMatch && depthMatches && wrong == 0u;
+		allMatch = allMatch && match;
+		totalInFrustum += (uint)inFrustum.size();
+		totalHidden += hidden;
+		totalCulled += culled;
+		totalWrong += wrong;
+
+		output << std::format("{}: {} objects in the frustum, {} visible; culled {} of the {} hidden ({:.1f}%), {} visible ones culled{}",
+			view.name, inFrustum.size(), visibleCount, culled, hidden, hidden ? 100.0 * culled / hidden : 100.0, wrong, match ? "" : " MISMATCH") << std::endl;
+		output << std::format("  {} of {} occluder triangles rasterized in {:.3f} ms, {} objects tested in {:.3f} ms; depth {} the scalar kernel's, "
+			"differs from SoftwareRasterizer's on {} of {} covered pixels", stats.trianglesRasterized, stats.triangles,
+			renderMilliseconds / REPETITIONS, stats.tested, testMilliseconds / REPETITIONS, kernelsMatch ? "matches" : "DIFFERS FROM",
+			differing, covered) << std::endl;
+	}
+
+	output << std::format("All views: {} objects in the frustum, {} of them hidden, {} culled ({:.1f}%), {} visible ones culled",
+		totalInFrustum, totalHidden, totalCulled, totalHidden ? 100.0 * totalCulled / totalHidden : 100.0, totalWrong) << std::endl;
+	return allMatch;
+}
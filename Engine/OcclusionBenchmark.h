@@ -0,0 +1,13 @@
+#pragma once
+
+#include <ostream>
+#include "Common.h"
+
+// Measures software occlusion culling in a city of box buildings with small objects scattered through its streets and
+// over its roofs, seen from street level. The buildings are the occluders; objects left by frustum culling are tested
+// against the pyramid. Each view reports the objects culled, the hidden objects missed and the time spent, against the
+// objects actually visible in a full resolution render by SoftwareRasterizer. Checks that no visible object is culled,
+// that the vector kernels write the same depth as the scalar one, and that the occluder depth agrees with
+// SoftwareRasterizer's at the culler's resolution.
+// Run with "Engine.exe -benchmark-occlusion". Returns false if any check fails.
+bool RunOcclusionBenchmark(std::ostream& output);
@@ -0,0 +1,493 @@
+#include "OcclusionCuller.h"
+#include "CpuFeatures.h"
+#include "Profiler.h"
+
+#include <algorithm>
+#include <chrono>
+#include <math.h>
+#include <string.h>
+
+#if defined(CPU_X86)
+#include <immintrin.h>
+#endif
+
+namespace
+{
+	// Lanes every row of the depth buffer is padded to, the width of the widest kernel.
+	const uint PACKET_SIZE = 8u;
+
+	// Items Cull hands to each thread.
+	const uint ITEMS_PER_TASK = 1024u;
+
+	// Texels the rectangle of a bounds may span along each axis on the level Test reads.
+	const int TEST_TEXELS = 4;
+
+	// Lowers depth to the triangle's in rows [minY, maxY] of the buffer, wherever a pixel centre is inside the triangle.
+	using RasterizeKernel = void (*)(const OcclusionCuller::Triangle& triangle, float* depth, uint pitch, int minY, int maxY);
+
+	// Every kernel evaluates the planes at a pixel centre as x * a + (y * b + c), multiplying and adding separately in
+	// that order, so they all write the same bits.
+	void RasterizeScalar(const OcclusionCuller::Triangle& triangle, float* depth, uint pitch, int minY, int maxY)
+	{
+		for (int y = minY; y <= maxY; ++y)
+		{
+			float centerY = (float)y + 0.5f;
+			float row0 = triangle.edgeY[0] * centerY + triangle.edgeC[0];
+			float row1 = triangle.edgeY[1] * centerY + triangle.edgeC[1];
+			float row2 = triangle.edgeY[2] * centerY + triangle.edgeC[2];
+			float rowDepth = triangle.depthY * centerY + triangle.depthC;
+
+			float* line = depth + (size_t)y * pitch;
+			for (int x = triangle.minX; x <= triangle.maxX; ++x)
+			{
+				float centerX = (float)x + 0.5f;
+				if (triangle.edgeX[0] * centerX + row0 >= 0.0f && triangle.edgeX[1] * centerX + row1 >= 0.0f &&
+					triangle.edgeX[2] * centerX + row2 >= 0.0f)
+				{
+					float z = triangle.depthX * centerX + rowDepth;
+					if (z < line[x])
+						line[x] = z;
+				}
+			}
+		}
+	}
+
+#if defined(CPU_X86)
+	// SSE2 is part of x64, so this kernel needs no target tag.
+	void RasterizeSse2(const OcclusionCuller::Triangle& triangle, float* depth, uint pitch, int minY, int maxY)
+	{
+		const __m128 laneOffsets = _mm_setr_ps(0.5f, 1.5f, 2.5f, 3.5f);
+		const __m128 zero = _mm_setzero_ps();
+		const __m128 edgeX0 = _mm_set1_ps(triangle.edgeX[0]);
+		const __m128 edgeX1 = _mm_set1_ps(triangle.edgeX[1]);
+		const __m128 edgeX2 = _mm_set1_ps(triangle.edgeX[2]);
+		const __m128 depthX = _mm_set1_ps(triangle.depthX);
+
+		// Whole packets from the one holding minX; lanes outside [minX, maxX] are masked off.
+		const int firstX = triangle.minX & ~3;
+		const __m128 minCenterX = _mm_set1_ps((float)triangle.minX + 0.5f);
+		const __m128 maxCenterX = _mm_set1_ps((float)triangle.maxX + 0.5f);
+
+		for (int y = minY; y <= maxY; ++y)
+		{
+			float centerY = (float)y + 0.5f;
+			__m128 row0 = _mm_set1_ps(triangle.edgeY[0] * centerY + triangle.edgeC[0]);
+			__m128 row1 = _mm_set1_ps(triangle.edgeY[1] * centerY + triangle.edgeC[1]);
+			__m128 row2 = _mm_set1_ps(triangle.edgeY[2] * centerY + triangle.edgeC[2]);
+			__m128 rowDepth = _mm_set1_ps(triangle.depthY * centerY + triangle.depthC);
+
+			float* line = depth + (size_t)y * pitch;
+			for (int x = firstX; x <= triangle.maxX; x += 4)
+			{
+				__m128 centerX = _mm_add_ps(_mm_set1_ps((float)x), laneOffsets);
+				__m128 inside = _mm_and_ps(_mm_cmpge_ps(centerX, minCenterX), _mm_cmple_ps(centerX, maxCenterX));
+				inside = _mm_and_ps(inside, _mm_cmpge_ps(_mm_add_ps(_mm_mul_ps(edgeX0, centerX), row0), zero));
+				inside = _mm_and_ps(inside, _mm_cmpge_ps(_mm_add_ps(_mm_mul_ps(edgeX1, centerX), row1), zero));
+				inside = _mm_and_ps(inside, _mm_cmpge_ps(_mm_add_ps(_mm_mul_ps(edgeX2, centerX), row2), zero));
+				if (_mm_movemask_ps(inside) == 0)
+					continue;
+
+				__m128 z = _mm_add_ps(_mm_mul_ps(depthX, centerX), rowDepth);
+				__m128 old = _mm_loadu_ps(line + x);
+				__m128 nearer = _mm_and_ps(inside, _mm_cmplt_ps(z, old));
+				_mm_storeu_ps(line + x, _mm_or_ps(_mm_and_ps(nearer, z), _mm_andnot_ps(nearer, old)));
+			}
+		}
+	}
+
+	TARGET_AVX2 void RasterizeAvx2(const OcclusionCuller::Triangle& triangle, float* depth, uint pitch, int minY, int maxY)
+	{
+		const __m256 laneOffsets = _mm256_setr_ps(0.5f, 1.5f, 2.5f, 3.5f, 4.5f, 5.5f, 6.5f, 7.5f);
+		const __m256 zero = _mm256_setzero_ps();
+		const __m256 edgeX0 = _mm256_set1_ps(triangle.edgeX[0]);
+		const __m256 edgeX1 = _mm256_set1_ps(triangle.edgeX[1]);
+		const __m256 edgeX2 = _mm256_set1_ps(triangle.edgeX[2]);
+		const __m256 depthX = _mm256_set1_ps(triangle.depthX);
+
+		const int firstX = triangle.minX & ~7;
+		const __m256 minCenterX = _mm256_set1_ps((float)triangle.minX + 0.5f);
+		const __m256 maxCenterX = _mm256_set1_ps((float)triangle.maxX + 0.5f);
+
+		for (int y = minY; y <= maxY; ++y)
+		{
+			float centerY = (float)y + 0.5f;
+			__m256 row0 = _mm256_set1_ps(triangle.edgeY[0] * centerY + triangle.edgeC[0]);
+			__m256 row1 = _mm256_set1_ps(triangle.edgeY[1] * centerY + triangle.edgeC[1]);
+			__m256 row2 = _mm256_set1_ps(triangle.edgeY[2] * centerY + triangle.edgeC[2]);
+			__m256 rowDepth = _mm256_set1_ps(triangle.depthY * centerY + triangle.depthC);
+
+			float* line = depth + (size_t)y * pitch;
+			for (int x = firstX; x <= triangle.maxX; x += 8)
+			{
+				__m256 centerX = _mm256_add_ps(_mm256_set1_ps((float)x), laneOffsets);
+				__m256 inside = _mm256_and_ps(_mm256_cmp_ps(centerX, minCenterX, _CMP_GE_OQ), _mm256_cmp_ps(centerX, maxCenterX, _CMP_LE_OQ));
+				inside = _mm256_and_ps(inside, _mm256_cmp_ps(_mm256_add_ps(_mm256_mul_ps(edgeX0, centerX), row0), zero, _CMP_GE_OQ));
+				inside = _mm256_and_ps(inside, _mm256_cmp_ps(_mm256_add_ps(_mm256_mul_ps(edgeX1, centerX), row1), zero, _CMP_GE_OQ));
+				inside = _mm256_and_ps(inside, _mm256_cmp_ps(_mm256_add_ps(_mm256_mul_ps(edgeX2, centerX), row2), zero, _CMP_GE_OQ));
+				if (_mm256_movemask_ps(inside) == 0)
+					continue;
+
+				__m256 z = _mm256_add_ps(_mm256_mul_ps(depthX, centerX), rowDepth);
+				__m256 old = _mm256_loadu_ps(line + x);
+				__m256 nearer = _mm256_and_ps(inside, _mm256_cmp_ps(z, old, _CMP_LT_OQ));
+				_mm256_storeu_ps(line + x, _mm256_blendv_ps(old, z, nearer));
+			}
+		}
+	}
+#endif
+
+	struct Kernels
+	{
+		RasterizeKernel rasterize;
+		const char* name;
+	};
+
+	const Kernels& GetKernels()
+	{
+		static const Kernels kernels = []
+		{
+#if defined(CPU_X86)
+			const CpuFeatures& features = CpuFeatures::Get();
+			if (features.avx2)
+				return Kernels{ RasterizeAvx2, "avx2" };
+			if (features.sse2)
+				return Kernels{ RasterizeSse2, "sse2" };
+#endif
+			return Kernels{ RasterizeScalar, "scalar" };
+		}();
+		return kernels;
+	}
+
+	// The point where the edge from a to b crosses the near plane, z = 0.
+	Math::Float4 ClipNear(const Math::Float4& a, const Math::Float4& b)
+	{
+		float t = a.z / (a.z - b.z);
+		return Math::Float4(a.x + (b.x - a.x) * t, a.y + (b.y - a.y) * t, 0.0f, a.w + (b.w - a.w) * t);
+	}
+}
+
+OcclusionCuller::Mesh::Mesh(const void* vertices, uint vertexCount, uint stride, const uint* triangleIndices, uint indexCount)
+	: positions(vertexCount)
+	, indices(triangleIndices, triangleIndices + indexCount)
+{
+	const uchar* vertex = (const uchar*)vertices;
+	for (uint i = 0u; i < vertexCount; ++i, vertex += stride)
+		memcpy(&positions[i], vertex, sizeof(Math::Float3));
+}
+
+OcclusionCuller::OcclusionCuller(uint width, uint height)
+	: _width(width)
+	, _height(height)
+	, _pitch((width + PACKET_SIZE - 1u) / PACKET_SIZE * PACKET_SIZE)
+{
+	// Allocate every level of the pyramid up front; rows of the depth buffer are padded so kernels store whole packets.
+	uint levelWidth = width, levelHeight = height;
+	for (;;)
+	{
+		uint pitch = _levels.empty() ? _pitch : levelWidth;
+		_levels.push_back(Level{ levelWidth, levelHeight, pitch, std::vector<float>((size_t)pitch * levelHeight, 1.0f) });
+		if (levelWidth == 1u && levelHeight == 1u)
+			break;
+		levelWidth = (levelWidth + 1u) / 2u;
+		levelHeight = (levelHeight + 1u) / 2u;
+	}
+}
+
+OcclusionCuller::~OcclusionCuller()
+{
+	Wait();
+}
+
+void OcclusionCuller::BeginFrame(const Math::Matrix4& viewProjection)
+{
+	_viewProjection = viewProjection;
+	_occluders.clear();
+}
+
+void OcclusionCuller::AddOccluder(const Mesh& mesh, const Math::Matrix4& world)
+{
+	_occluders.push_back(Occluder{ &mesh, Math::Multiply(world, _viewProjection) });
+}
+
+void OcclusionCuller::Render()
+{
+	JobSystem::GetDefault().Run([this] { RenderOccluders(); }, &_rendering);
+}
+
+void OcclusionCuller::Wait()
+{
+	JobSystem::GetDefault().Wait(_rendering);
+}
+
+void OcclusionCuller::RenderOccluders()
+{
+	PROFILE_SCOPE("OcclusionCuller::RenderOccluders");
+	auto start = std::chrono::steady_clock::now();
+	JobSystem& jobs = JobSystem::GetDefault();
+
+	// Transform and set up every occluder's triangles, one occluder per task.
+	const uint occluderCount = (uint)_occluders.size();
+	if (_triangles.size() < occluderCount)
+	{
+		_clipPositions.resize(occluderCount);
+		_triangles.resize(occluderCount);
+	}
+	jobs.ParallelFor(occluderCount, 0u, [&](uint i)
+	{
+		SetupTriangles(_occluders[i], _clipPositions[i], _triangles[i]);
+	});
+
+	// Clear and rasterize bands of rows, each band drawing the part of every triangle that overlaps it.
+	RasterizeKernel rasterize = _scalar ? RasterizeScalar : GetKernels().rasterize;
+	Level& buffer = _levels[0];
+	const uint bandCount = (_height + BAND_HEIGHT - 1u) / BAND_HEIGHT;
+	jobs.ParallelFor(bandCount, 0u, [&](uint band)
+	{
+		int minY = (int)(band * BAND_HEIGHT);
+		int maxY = (int)std::min(_height, (band + 1u) * BAND_HEIGHT) - 1;
+		std::fill(buffer.depth.begin() + (size_t)minY * _pitch, buffer.depth.begin() + (size_t)(maxY + 1) * _pitch, 1.0f);
+
+		for (uint i = 0u; i < occluderCount; ++i)
+		{
+			for (const Triangle& triangle : _triangles[i])
+			{
+				if (triangle.maxY >= minY && triangle.minY <= maxY)
+					rasterize(triangle, buffer.depth.data(), _pitch, std::max(minY, triangle.minY), std::min(maxY, triangle.maxY));
+			}
+		}
+	});
+
+	BuildPyramid();
+
+	_stats.occluders = occluderCount;
+	_stats.triangles = 0u;
+	_stats.trianglesRasterized = 0u;
+	for (uint i = 0u; i < occluderCount; ++i)
+	{
+		_stats.triangles += (uint)_occluders[i].mesh->indices.size() / 3u;
+		_stats.trianglesRasterized += (uint)_triangles[i].size();
+	}
+	_stats.renderMilliseconds = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+}
+
+void OcclusionCuller::SetupTriangles(const Occluder& occluder, std::vector<Math::Float4>& clip, std::vector<Triangle>& triangles) const
+{
+	const Mesh& mesh = *occluder.mesh;
+	clip.resize(mesh.positions.size());
+	Math::TransformPoints(occluder.worldViewProjection, mesh.positions.data(), clip.data(), clip.size());
+
+	triangles.clear();
+	for (size_t i = 0u; i + 2u < mesh.indices.size(); i += 3u)
+	{
+		const Math::Float4& v0 = clip[mesh.indices[i]];
+		const Math::Float4& v1 = clip[mesh.indices[i + 1u]];
+		const Math::Float4& v2 = clip[mesh.indices[i + 2u]];
+
+		// Skip triangles entirely outside one side of the frustum.
+		if ((v0.x > v0.w && v1.x > v1.w && v2.x > v2.w) || (v0.x < -v0.w && v1.x < -v1.w && v2.x < -v2.w) ||
+			(v0.y > v0.w && v1.y > v1.w && v2.y > v2.w) || (v0.y < -v0.w && v1.y < -v1.w && v2.y < -v2.w) ||
+			(v0.z > v0.w && v1.z > v1.w && v2.z > v2.w) || (v0.z < 0.0f && v1.z < 0.0f && v2.z < 0.0f))
+			continue;
+
+		if (v0.z >= 0.0f && v1.z >= 0.0f && v2.z >= 0.0f)
+		{
+			SetupTriangle(v0, v1, v2, triangles);
+			continue;
+		}
+
+		// Cut off the part in front of the near plane, leaving a triangle or a quad in the same winding.
+		const Math::Float4* input[3] = { &v0, &v1, &v2 };
+		Math::Float4 polygon[4];
+		uint count = 0u;
+		for (uint j = 0u; j < 3u; ++j)
+		{
+			const Math::Float4& a = *input[j];
+			const Math::Float4& b = *input[(j + 1u) % 3u];
+			if (a.z >= 0.0f)
+				polygon[count++] = a;
+			if ((a.z >= 0.0f) != (b.z >= 0.0f))
+				polygon[count++] = ClipNear(a, b);
+		}
+		for (uint j = 2u; j < count; ++j)
+			SetupTriangle(polygon[0], polygon[j - 1u], polygon[j], triangles);
+	}
+}
+
+void OcclusionCuller::SetupTriangle(const Math::Float4& v0, const Math::Float4& v1, const Math::Float4& v2, std::vector<Triangle>& triangles) const
+{
+	// Viewport transform, y pointing down like the Direct3D render target.
+	const Math::Float4* vertices[3] = { &v0, &v1, &v2 };
+	float x[3], y[3], z[3];
+	for (uint i = 0u; i < 3u; ++i)
+	{
+		float invW = 1.0f / vertices[i]->w;
+		x[i] = (vertices[i]->x * invW * 0.5f + 0.5f) * _width;
+		y[i] = (0.5f - vertices[i]->y * invW * 0.5f) * _height;
+		z[i] = vertices[i]->z * invW;
+	}
+
+	// With y pointing down a positive area means the vertices appear clockwise on screen, the front faces.
+	float area = (x[1] - x[0]) * (y[2] - y[0]) - (x[2] - x[0]) * (y[1] - y[0]);
+	if (!(area > 0.0f))
+		return;
+
+	// Pixels whose centres lie within the triangle's bounding box.
+	Triangle triangle;
+	triangle.minX = std::max(0, (int)ceilf(std::min({ x[0], x[1], x[2] }) - 0.5f));
+	triangle.minY = std::max(0, (int)ceilf(std::min({ y[0], y[1], y[2] }) - 0.5f));
+	triangle.maxX = std::min((int)_width - 1, (int)floorf(std::max({ x[0], x[1], x[2] }) - 0.5f));
+	triangle.maxY = std::min((int)_height - 1, (int)floorf(std::max({ y[0], y[1], y[2] }) - 0.5f));
+	if (triangle.minX > triangle.maxX || triangle.minY > triangle.maxY)
+		return;
+
+	// Edge i runs from vertex i to the next and is positive towards the vertex opposite it.
+	for (uint i = 0u; i < 3u; ++i)
+	{
+		uint j = (i + 1u) % 3u;
+		triangle.edgeX[i] = y[i] - y[j];
+		triangle.edgeY[i] = x[j] - x[i];
+		triangle.edgeC[i] = -(triangle.edgeX[i] * x[i] + triangle.edgeY[i] * y[i]);
+	}
+
+	// Depth is linear in screen space; each vertex is weighted by the edge opposite it over the area.
+	float invArea = 1.0f / area;
+	triangle.depthX = (triangle.edgeX[1] * z[0] + triangle.edgeX[2] * z[1] + triangle.edgeX[0] * z[2]) * invArea;
+	triangle.depthY = (triangle.edgeY[1] * z[0] + triangle.edgeY[2] * z[1] + triangle.edgeY[0] * z[2]) * invArea;
+	triangle.depthC = z[0] - triangle.depthX * x[0] - triangle.depthY * y[0];
+	triangles.push_back(triangle);
+}
+
+void OcclusionCuller::BuildPyramid()
+{
+	// Each texel keeps the farthest of the up to four texels below it; odd edges repeat their last texel.
+	for (size_t level = 1u; level < _levels.size(); ++level)
+	{
+		const Level& source = _levels[level - 1u];
+		Level& target = _levels[level];
+		for (uint y = 0u; y < target.height; ++y)
+		{
+			const float* row0 = source.depth.data() + (size_t)(2u * y) * source.pitch;
+			const float* row1 = source.depth.data() + (size_t)std::min(2u * y + 1u, source.height - 1u) * source.pitch;
+			float* output = target.depth.data() + (size_t)y * target.pitch;
+			for (uint x = 0u; x < target.width; ++x)
+			{
+				uint x0 = 2u * x, x1 = std::min(2u * x + 1u, source.width - 1u);
+				output[x] = std::max(std::max(row0[x0], row0[x1]), std::max(row1[x0], row1[x1]));
+			}
+		}
+	}
+}
+
+bool OcclusionCuller::Test(const Bounds& bounds) const
+{
+	// Project the corners of the box. A box reaching in front of the near plane is never hidden.
+	float minX = INFINITY, minY = INFINITY, maxX = -INFINITY, maxY = -INFINITY, minZ = INFINITY;
+	for (uint corner = 0u; corner < 8u; ++corner)
+	{
+		Math::Float3 point(bounds.center.x + (corner & 1u ? bounds.extents.x : -bounds.extents.x),
+			bounds.center.y + (corner & 2u ? bounds.extents.y : -bounds.extents.y),
+			bounds.center.z + (corner & 4u ? bounds.extents.z : -bounds.extents.z));
+		Math::Float4 clip = Math::TransformPoint(point, _viewProjection);
+		if (clip.z < 0.0f || clip.w <= 0.0f)
+			return true;
+
+		float invW = 1.0f / clip.w;
+		float x = (clip.x * invW * 0.5f + 0.5f) * _width;
+		float y = (0.5f - clip.y * invW * 0.5f) * _height;
+		minX = std::min(minX, x);
+		maxX = std::max(maxX, x);
+		minY = std::min(minY, y);
+		maxY = std::max(maxY, y);
+		minZ = std::min(minZ, clip.z * invW);
+	}
+
+	// The pixels the rectangle touches, grown by one for occluder edges that cover a pixel centre but not the pixel.
+	// Boxes off the screen are left to frustum culling.
+	int x0 = std::max(0, (int)floorf(minX) - 1);
+	int y0 = std::max(0, (int)floorf(minY) - 1);
+	int x1 = std::min((int)_width - 1, (int)floorf(maxX) + 1);
+	int y1 = std::min((int)_height - 1, (int)floorf(maxY) + 1);
+	if (x0 > x1 || y0 > y1)
+		return true;
+
+	// Read the finest level where the rectangle spans a few texels.
+	uint level = 0u;
+	while (level + 1u < _levels.size() && ((x1 >> level) - (x0 >> level) >= TEST_TEXELS || (y1 >> level) - (y0 >> level) >= TEST_TEXELS))
+		level++;
+
+	const Level& texels = _levels[level];
+	float farthest = 0.0f;
+	for (int y = y0 >> level; y <= (y1 >> level); ++y)
+	{
+		const float* row = texels.depth.data() + (size_t)y * texels.pitch;
+		for (int x = x0 >> level; x <= (x1 >> level); ++x)
+			farthest = std::max(farthest, row[x]);
+	}
+	return minZ <= farthest;
+}
+
+void OcclusionCuller::Cull(const std::vector<Bounds>& bounds, std::vector<uint>& items, uint threadCount)
+{
+	auto start = std::chrono::steady_clock::now();
+
+	const uint count = (uint)items.size();
+	_visible.resize(count);
+	JobSystem::GetDefault().ParallelFor((count + ITEMS_PER_TASK - 1u) / ITEMS_PER_TASK, threadCount, [&](uint task)
+	{
+		uint end = std::min(count, (task + 1u) * ITEMS_PER_TASK);
+		for (uint i = task * ITEMS_PER_TASK; i < end; ++i)
+			_visible[i] = Test(bounds[items[i]]) ? 1u : 0u;
+	});
+
+	uint visibleCount = 0u;
+	for (uint i = 0u; i < count; ++i)
+	{
+		if (_visible[i])
+			items[visibleCount++] = items[i];
+	}
+	items.resize(visibleCount);
+
+	_stats.tested = count;
+	_stats.occluded = count - visibleCount;
+	_stats.testMilliseconds = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+}
+
+uint OcclusionCuller::GetWidth() const
+{
+	return _width;
+}
+
+uint OcclusionCuller::GetHeight() const
+{
+	return _height;
+}
+
+uint OcclusionCuller::GetLevelCount() const
+{
+	return (uint)_levels.size();
+}
+
+const std::vector<float>& OcclusionCuller::GetDepthBuffer() const
+{
+	return _levels[0].depth;
+}
+
+uint OcclusionCuller::GetPitch() const
+{
+	return _pitch;
+}
+
+const OcclusionCuller::Stats& OcclusionCuller::GetStats() const
+{
+	return _stats;
+}
+
+const char* OcclusionCuller::GetKernelName()
+{
+	return GetKernels().name;
+}
+
+void OcclusionCuller::SetScalar(bool scalar)
+{
+	_scalar = scalar;
+}
@@ -0,0 +1,144 @@
+#pragma once
+
+#include "Bounds.h"
+#include "Common.h"
+#include "EngineMath.h"
+#include "JobSystem.h"
+
+// Software occlusion culling. Occluder meshes are rasterized on the CPU into a small depth buffer, which is reduced to
+// a hierarchical Z pyramid that bounds are tested against before their objects are submitted.
+//
+// - Render transforms the occluders with Math::TransformPoints, clips them against the near plane, culls back faces
+//   and rasterizes bands of rows in parallel, keeping the nearest depth of every pixel. The kernels evaluate edge
+//   functions for 8 pixels per AVX2 instruction or 4 per SSE2 instruction, picked at runtime from CpuFeatures.
+// - Every texel of the pyramid holds the farthest depth of the four below it, so nothing in its area is nearer. Bounds
+//   are hidden when the nearest corner of their box is farther than every texel covering the box on screen, read on
+//   the level where that rectangle spans a few texels.
+// - Coverage is sampled at pixel centres, like Direct3D. Test grows each rectangle by a pixel so edges of occluders
+//   that cover a pixel centre but not the whole pixel hide nothing; only gaps between occluders narrower than a pixel
+//   of the buffer can still close.
+// - Render queues the work as jobs and returns, so it runs while the caller moves bounds, frustum culls or waits on
+//   the GPU. Wait before testing.
+//
+// Depth follows Direct3D's 0 to 1 range, 0 nearest. The culler has no Direct3D dependency.
+class OcclusionCuller
+{
+public:
+
+	// Occluder geometry: positions in model space and clockwise triangles, the engine's front faces.
+	struct Mesh
+	{
+		std::vector<Math::Float3> positions;
+		std::vector<uint> indices;
+
+		Mesh() = default;
+
+		// Copies the positions of count vertices stride bytes apart, each starting with three floats.
+		Mesh(const void* vertices, uint vertexCount, uint stride, const uint* triangleIndices, uint indexCount);
+	};
+
+	// Screen space triangle ready for rasterization: edge functions and depth as planes over the pixel centres.
+	struct Triangle
+	{
+		float edgeX[3], edgeY[3], edgeC[3];	// Inside where edgeX * x + edgeY * y + edgeC >= 0 for all three.
+		float depthX, depthY, depthC;
+		int minX, minY, maxX, maxY;			// Pixel bounds, clipped to the buffer.
+	};
+
+	struct Stats
+	{
+		uint occluders = 0u;
+		uint triangles = 0u;			// Occluder triangles submitted.
+		uint trianglesRasterized = 0u;	// Of those, left after clipping and back face and frustum culling.
+		uint tested = 0u;
+		uint occluded = 0u;
+		double renderMilliseconds = 0.0;	// Rasterizing and building the pyramid, on the jobs.
+		double testMilliseconds = 0.0;
+	};
+
+	// width and height of the depth buffer; the pyramid halves them down to one texel.
+	OcclusionCuller(uint width = 320u, uint height = 180u);
+
+	// Waits for Render.
+	~OcclusionCuller();
+
+	OcclusionCuller(const OcclusionCuller&) = delete;
+	OcclusionCuller& operator=(const OcclusionCuller&) = delete;
+
+	// Starts a frame seen through viewProjection, as Camera::GetViewMatrix times the projection, and drops the
+	// occluders of the last one.
+	void BeginFrame(const Math::Matrix4& viewProjection);
+
+	// The mesh must stay alive until Wait.
+	void AddOccluder(const Mesh& mesh, const Math::Matrix4& world);
+
+	// Queues rasterizing the occluders and building the pyramid on the job system, and returns at once.
+	void Render();
+
+	// Waits for the jobs Render queued.
+	void Wait();
+
+	// False only if the bounds are certainly hidden behind the occluders. Call after Wait; may run on several threads.
+	bool Test(const Bounds& bounds) const;
+
+	// Removes the hidden items from items, keeping the order of the rest. bounds is indexed by item.
+	// threadCount 0 uses every thread of the job system.
+	void Cull(const std::vector<Bounds>& bounds, std::vector<uint>& items, uint threadCount = 0u);
+
+	uint GetWidth() const;
+	uint GetHeight() const;
+	uint GetLevelCount() const;
+
+	// Nearest depth of every pixel of the buffer, row by row from the top, GetPitch floats apart.
+	const std::vector<float>& GetDepthBuffer() const;
+	uint GetPitch() const;
+
+	const Stats& GetStats() const;
+
+	// Name of the instruction set the dispatched kernel uses ("avx2", "sse2" or "scalar").
+	static const char* GetKernelName();
+
+	// Rasterizes with the scalar kernel from now on, for comparing results.
+	void SetScalar(bool scalar);
+
+private:
+
+	// Rows rasterized by one task.
+	static const uint BAND_HEIGHT = 16u;
+
+	struct Occluder
+	{
+		const Mesh* mesh;
+		Math::Matrix4 worldViewProjection;
+	};
+
+	void RenderOccluders();
+	void SetupTriangles(const Occluder& occluder, std::vector<Math::Float4>& clip, std::vector<Triangle>& triangles) const;
+	void SetupTriangle(const Math::Float4& v0, const Math::Float4& v1, const Math::Float4& v2, std::vector<Triangle>& triangles) const;
+	void BuildPyramid();
+
+	uint _width = 0u;
+	uint _height = 0u;
+	uint _pitch = 0u;	// Row length of the depth buffer, padded to the widest kernel.
+	Math::Matrix4 _viewProjection;
+	std::vector<Occluder> _occluders;
+	bool _scalar = false;
+
+	// Level 0 is the depth buffer; every level after it is half the size, rounded up, down to one texel.
+	struct Level
+	{
+		uint width;
+		uint height;
+		uint pitch;
+		std::vector<float> depth;
+	};
+	std::vector<Level> _levels;
+
+	// Scratch space of Render, per occluder.
+	std::vector<std::vector<Math::Float4>> _clipPositions;
+	std::vector<std::vector<Triangle>> _triangles;
+	std::vector<uchar> _visible;	// Scratch space of Cull.
+
+	JobSystem::Counter _rendering;
+	Stats _stats;
+};
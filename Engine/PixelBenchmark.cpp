@@ -0,0 +1,147 @@
+#include "PixelBenchmark.h"
+#include "PixelConvert.h"
+
+#include <chrono>
+#include <random>
+#include <string.h>
+
+namespace
+{
+	const uint SIZES[] = { 512u, 2048u, 8192u };
+	const size_t BYTES_PER_SIZE = 512u << 20;	// Processed per measurement, in repetitions of the image.
+	const uint MIN_REPETITIONS = 3u;
+	const uint RANDOM_SEED = 1234u;
+
+	// Widths and heights that leave every kernel a row tail, and a middle row that swaps with itself.
+	const uint ODD_SIZES[][2] = { { 1u, 1u }, { 3u, 5u }, { 7u, 2u }, { 15u, 9u }, { 37u, 19u }, { 517u, 333u } };
+	const uint MAX_RUN = 67u;	// Longest pixel run BgraToRgba is compared on, from every start offset up to 3.
+
+	const PixelConvert::Kernel KERNELS[] = { PixelConvert::Kernel::Ssse3, PixelConvert::Kernel::Avx2 };
+	const char* const KERNEL_NAMES[] = { "ssse3", "avx2" };
+
+	// The loop Texture::LoadTarga32Bit used before PixelConvert: byte by byte from the bottom-up BGRA image into a
+	// second, top-down RGBA one.
+	void FlipBgraToRgbaOld(const uchar* targaImage, uchar* targaData, uint width, uint height)
+	{
+		size_t index = 0u;
+		size_t k = (size_t)width * height * 4u - (size_t)width * 4u;
+		for (uint j = 0u; j < height; j++)
+		{
+			for (uint i = 0u; i < width; i++)
+			{
+				targaData[index + 0] = targaImage[k + 2];
+				targaData[index + 1] = targaImage[k + 1];
+				targaData[index + 2] = targaImage[k + 0];
+				targaData[index + 3] = targaImage[k + 3];
+				k += 4u;
+				index += 4u;
+			}
+			k -= (size_t)width * 8u;
+		}
+	}
+
+	std::vector<uchar> RandomPixels(uint width, uint height, std::mt19937& random)
+	{
+		std::vector<uchar> pixels((size_t)width * height * 4u);
+		for (uchar& byte : pixels)
+			byte = (uchar)random();
+		return pixels;
+	}
+
+	// Average MB/s of repetitions of run over an image of bytes.
+	template <typename Run>
+	double Measure(size_t bytes, Run run)
+	{
+		uint repetitions = (uint)(BYTES_PER_SIZE / bytes);
+		repetitions = repetitions > MIN_REPETITIONS ? repetitions : MIN_REPETITIONS;
+		auto start = std::chrono::steady_clock::now();
+		for (uint i = 0u; i < repetitions; ++i)
+			run();
+		double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+		return (double)bytes * repetitions / seconds / 1e6;
+	}
+
+	// Whether the old loop and every supported kernel flip an image of width by height like the scalar reference.
+	bool CompareFlips(const std::vector<uchar>& source, uint width, uint height, std::vector<uchar>& reference, std::vector<uchar>& work)
+	{
+		reference = source;
+		PixelConvert::FlipBgraToRgbaScalar(reference.data(), width, height);
+
+		work.resize(source.size());
+		FlipBgraToRgbaOld(source.data(), work.data(), width, height);
+		bool match = memcmp(work.data(), reference.data(), source.size()) == 0;
+		for (PixelConvert::Kernel kernel : KERNELS)
+		{
+			if (!PixelConvert::IsSupported(kernel))
+				continue;
+			work = source;
+			PixelConvert::FlipBgraToRgba(work.data(), width, height, kernel);
+			match = match && memcmp(work.data(), reference.data(), source.size()) == 0;
+		}
+		return match;
+	}
+}
+
+bool RunPixelBenchmark(std::ostream& output)
+{
+	bool allMatch = true;
+	std::mt19937 random(RANDOM_SEED);
+	std::vector<uchar> reference, work;
+
+	output << std::format("Dispatched kernel: {}", PixelConvert::GetKernelName()) << std::endl;
+
+	// Every kernel against the scalar reference on sizes that exercise the row tails.
+	bool oddMatch = true;
+	for (const uint* size : ODD_SIZES)
+	{
+		std::vector<uchar> source = RandomPixels(size[0], size[1], random);
+		oddMatch = CompareFlips(source, size[0], size[1], reference, work) && oddMatch;
+	}
+
+	// BgraToRgba on runs of every length, from unaligned starts.
+	std::vector<uchar> run = RandomPixels(MAX_RUN + 3u, 1u, random);
+	for (uint offset = 0u; offset < 4u; ++offset)
+	{
+		for (uint length = 0u; length + offset <= MAX_RUN + 3u; ++length)
+		{
+			const uchar* source = run.data() + offset * 4u;
+			std::vector<uchar> expected(length * 4u), converted(length * 4u);
+			PixelConvert::BgraToRgba(source, expected.data(), length, PixelConvert::Kernel::Scalar);
+			for (PixelConvert::Kernel kernel : KERNELS)
+			{
+				if (!PixelConvert::IsSupported(kernel))
+					continue;
+				PixelConvert::BgraToRgba(source, converted.data(), length, kernel);
+				oddMatch = oddMatch && memcmp(converted.data(), expected.data(), length * 4u) == 0;
+			}
+		}
+	}
+	allMatch = allMatch && oddMatch;
+	output << std::format("Odd sizes and swizzle runs match the scalar reference: {}", oddMatch ? "OK" : "MISMATCH") << std::endl;
+
+	for (uint size : SIZES)
+	{
+		std::vector<uchar> source = RandomPixels(size, size, random);
+		bool match = CompareFlips(source, size, size, reference, work);
+		allMatch = allMatch && match;
+
+		// The old loop writes a second image; the kernels flip in place, so repetitions flip back and forth.
+		size_t bytes = source.size();
+		double old = Measure(bytes, [&]() { FlipBgraToRgbaOld(source.data(), work.data(), size, size); });
+		double scalar = Measure(bytes, [&]() { PixelConvert::FlipBgraToRgbaScalar(work.data(), size, size); });
+		std::string line = std::format("{}x{}: old loop {:.0f} MB/s, scalar {:.0f} MB/s", size, size, old, scalar);
+		for (uint i = 0u; i < sizeof(KERNELS) / sizeof(KERNELS[0]); ++i)
+		{
+			if (!PixelConvert::IsSupported(KERNELS[i]))
+			{
+				line += std::format(", {} unsupported", KERNEL_NAMES[i]);
+				continue;
+			}
+			double speed = Measure(bytes, [&]() { PixelConvert::FlipBgraToRgba(work.data(), size, size, KERNELS[i]); });
+			line += std::format(", {} {:.0f} MB/s ({:.1f}x the old loop)", KERNEL_NAMES[i], speed, speed / old);
+		}
+		output << line << std::format(": {}", match ? "OK" : "MISMATCH") << std::endl;
+	}
+
+	return allMatch;
+}
@@ -0,0 +1,10 @@
+#pragma once
+
+#include <ostream>
+#include "Common.h"
+
+// Times the TGA flip and swizzle on 512, 2048 and 8192 pixel square images with the byte by byte loop it replaced
+// and with each PixelConvert kernel the processor supports, in MB/s. Checks that the old loop, and every SSSE3 and
+// AVX2 kernel, give the same bytes as FlipBgraToRgbaScalar, also on odd sizes that end rows in each kernel's tail.
+// Run with "Engine.exe -benchmark-pixels". Returns false if any result differs.
+bool RunPixelBenchmark(std::ostream& output);
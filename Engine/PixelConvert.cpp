@@ -0,0 +1,212 @@
+#include "PixelConvert.h"
+#include "CpuFeatures.h"
+
+#include <string.h>
+
+#if defined(CPU_X86)
+#include <immintrin.h>
+#endif
+
+namespace
+{
+	// Swaps bytes 0 and 2 of every 32-bit pixel: BGRA <-> RGBA.
+	inline uint32_t SwapRedBlue(uint32_t pixel)
+	{
+		return (pixel & 0xFF00FF00u) | ((pixel >> 16) & 0x000000FFu) | ((pixel & 0x000000FFu) << 16);
+	}
+
+	// Swizzles rowA into rowB and rowB into rowA. rowA and rowB may be the same row.
+	using SwapRowsKernel = void (*)(uchar* rowA, uchar* rowB, size_t pixelCount);
+	using ConvertKernel = void (*)(const uchar* source, uchar* destination, size_t pixelCount);
+
+	void SwapRowsScalar(uchar* rowA, uchar* rowB, size_t pixelCount)
+	{
+		for (size_t i = 0; i < pixelCount; ++i)
+		{
+			uint32_t a, b;
+			memcpy(&a, rowA + i * 4u, 4u);
+			memcpy(&b, rowB + i * 4u, 4u);
+			a = SwapRedBlue(a);
+			b = SwapRedBlue(b);
+			memcpy(rowA + i * 4u, &b, 4u);
+			memcpy(rowB + i * 4u, &a, 4u);
+		}
+	}
+
+	void ConvertScalar(const uchar* source, uchar* destination, size_t pixelCount)
+	{
+		for (size_t i = 0; i < pixelCount; ++i)
+		{
+			uint32_t pixel;
+			memcpy(&pixel, source + i * 4u, 4u);
+			pixel = SwapRedBlue(pixel);
+			memcpy(destination + i * 4u, &pixel, 4u);
+		}
+	}
+
+#if defined(CPU_X86)
+	TARGET_SSSE3 void SwapRowsSsse3(uchar* rowA, uchar* rowB, size_t pixelCount)
+	{
+		const __m128i mask = _mm_setr_epi8(2, 1, 0, 3, 6, 5, 4, 7, 10, 9, 8, 11, 14, 13, 12, 15);
+
+		size_t i = 0;
+		for (; i + 4u <= pixelCount; i += 4u)
+		{
+			__m128i a = _mm_loadu_si128((const __m128i*)(rowA + i * 4u));
+			__m128i b = _mm_loadu_si128((const __m128i*)(rowB + i * 4u));
+			_mm_storeu_si128((__m128i*)(rowA + i * 4u), _mm_shuffle_epi8(b, mask));
+			_mm_storeu_si128((__m128i*)(rowB + i * 4u), _mm_shuffle_epi8(a, mask));
+		}
+
+		SwapRowsScalar(rowA + i * 4u, rowB + i * 4u, pixelCount - i);
+	}
+
+	TARGET_SSSE3 void ConvertSsse3(const uchar* source, uchar* destination, size_t pixelCount)
+	{
+		const __m128i mask = _mm_setr_epi8(2, 1, 0, 3, 6, 5, 4, 7, 10, 9, 8, 11, 14, 13, 12, 15);
+
+		size_t i = 0;
+		for (; i + 4u <= pixelCount; i += 4u)
+		{
+			__m128i pixels = _mm_loadu_si128((const __m128i*)(source + i * 4u));
+			_mm_storeu_si128((__m128i*)(destination + i * 4u), _mm_shuffle_epi8(pixels, mask));
+		}
+
+		ConvertScalar(source + i * 4u, destination + i * 4u, pixelCount - i);
+	}
+
+	TARGET_AVX2 void SwapRowsAvx2(uchar* rowA, uchar* rowB, size_t pixelCount)
+	{
+		// vpshufb shuffles within each 128-bit lane, so the mask is the SSSE3 one repeated.
+		const __m256i mask = _mm256_setr_epi8(2, 1, 0, 3, 6, 5, 4, 7, 10, 9, 8, 11, 14, 13, 12, 15,
+			2, 1, 0, 3, 6, 5, 4, 7, 10, 9, 8, 11, 14, 13, 12, 15);
+
+		size_t i = 0;
+		for (; i + 16u <= pixelCount; i += 16u)
+		{
+			__m256i a0 = _mm256_loadu_si256((const __m256i*)(rowA + i * 4u));
+			__m256i a1 = _mm256_loadu_si256((const __m256i*)(rowA + i * 4u + 32u));
+			__m256i b0 = _mm256_loadu_si256((const __m256i*)(rowB + i * 4u));
+			__m256i b1 = _mm256_loadu_si256((const __m256i*)(rowB + i * 4u + 32u));
+			_mm256_storeu_si256((__m256i*)(rowA + i * 4u), _mm256_shuffle_epi8(b0, mask));
+			_mm256_storeu_si256((__m256i*)(rowA + i * 4u + 32u), _mm256_shuffle_epi8(b1, mask));
+			_mm256_storeu_si256((__m256i*)(rowB + i * 4u), _mm256_shuffle_epi8(a0, mask));
+			_mm256_storeu_si256((__m256i*)(rowB + i * 4u + 32u), _mm256_shuffle_epi8(a1, mask));
+		}
+		for (; i + 8u <= pixelCount; i += 8u)
+		{
+			__m256i a = _mm256_loadu_si256((const __m256i*)(rowA + i * 4u));
+			__m256i b = _mm256_loadu_si256((const __m256i*)(rowB + i * 4u));
+			_mm256_storeu_si256((__m256i*)(rowA + i * 4u), _mm256_shuffle_epi8(b, mask));
+			_mm256_storeu_si256((__m256i*)(rowB + i * 4u), _mm256_shuffle_epi8(a, mask));
+		}
+
+		SwapRowsScalar(rowA + i * 4u, rowB + i * 4u, pixelCount - i);
+	}
+
+	TARGET_AVX2 void ConvertAvx2(const uchar* source, uchar* destination, size_t pixelCount)
+	{
+		const __m256i mask = _mm256_setr_epi8(2, 1, 0, 3, 6, 5, 4, 7, 10, 9, 8, 11, 14, 13, 12, 15,
+			2, 1, 0, 3, 6, 5, 4, 7, 10, 9, 8, 11, 14, 13, 12, 15);
+
+		size_t i = 0;
+		for (; i + 8u <= pixelCount; i += 8u)
+		{
+			__m256i pixels = _mm256_loadu_si256((const __m256i*)(source + i * 4u));
+			_mm256_storeu_si256((__m256i*)(destination + i * 4u), _mm256_shuffle_epi8(pixels, mask));
+		}
+
+		ConvertScalar(source + i * 4u, destination + i * 4u, pixelCount - i);
+	}
+#endif
+
+	struct Kernels
+	{
+		SwapRowsKernel swapRows;
+		ConvertKernel convert;
+		const char* name;
+	};
+
+	// Indexed by PixelConvert::Kernel.
+	const Kernels KERNELS[] =
+	{
+		{ SwapRowsScalar, ConvertScalar, "scalar" },
+#if defined(CPU_X86)
+		{ SwapRowsSsse3, ConvertSsse3, "ssse3" },
+		{ SwapRowsAvx2, ConvertAvx2, "avx2" },
+#else
+		// Never supported off x86; the scalar kernels keep the table indexed by Kernel.
+		{ SwapRowsScalar, ConvertScalar, "scalar" },
+		{ SwapRowsScalar, ConvertScalar, "scalar" },
+#endif
+	};
+
+	const Kernels& GetKernels()
+	{
+		static const Kernels& kernels = []() -> const Kernels&
+		{
+			if (PixelConvert::IsSupported(PixelConvert::Kernel::Avx2))
+				return KERNELS[(uint)PixelConvert::Kernel::Avx2];
+			if (PixelConvert::IsSupported(PixelConvert::Kernel::Ssse3))
+				return KERNELS[(uint)PixelConvert::Kernel::Ssse3];
+			return KERNELS[(uint)PixelConvert::Kernel::Scalar];
+		}();
+		return kernels;
+	}
+
+	void FlipRows(uchar* pixels, uint width, uint height, SwapRowsKernel swapRows)
+	{
+		size_t rowPitch = (size_t)width * 4u;
+
+		// Walk from the outer rows inwards, swapping each pair while swizzling. The middle row of an odd image swaps with itself.
+		for (uint top = 0u; top < (height + 1u) / 2u; ++top)
+		{
+			uint bottom = height - 1u - top;
+			swapRows(pixels + top * rowPitch, pixels + bottom * rowPitch, width);
+		}
+	}
+}
+
+void PixelConvert::FlipBgraToRgba(uchar* pixels, uint width, uint height)
+{
+	FlipRows(pixels, width, height, GetKernels().swapRows);
+}
+
+void PixelConvert::BgraToRgba(const uchar* source, uchar* destination, size_t pixelCount)
+{
+	GetKernels().convert(source, destination, pixelCount);
+}
+
+void PixelConvert::FlipBgraToRgbaScalar(uchar* pixels, uint width, uint height)
+{
+	FlipRows(pixels, width, height, SwapRowsScalar);
+}
+
+const char* PixelConvert::GetKernelName()
+{
+	return GetKernels().name;
+}
+
+bool PixelConvert::IsSupported(Kernel kernel)
+{
+	const CpuFeatures& features = CpuFeatures::Get();
+	switch (kernel)
+	{
+	case Kernel::Avx2:
+		return features.avx2;
+	case Kernel::Ssse3:
+		return features.ssse3;
+	default:
+		return true;
+	}
+}
+
+void PixelConvert::FlipBgraToRgba(uchar* pixels, uint width, uint height, Kernel kernel)
+{
+	FlipRows(pixels, width, height, KERNELS[(uint)kernel].swapRows);
+}
+
+void PixelConvert::BgraToRgba(const uchar* source, uchar* destination, size_t pixelCount, Kernel kernel)
+{
+	KERNELS[(uint)kernel].convert(source, destination, pixelCount);
+}
@@ -0,0 +1,37 @@
+#pragma once
+
+#include "Common.h"
+
+// Pixel format conversion kernels used by the image loaders.
+// Each kernel has a scalar version and SSSE3 / AVX2 versions picked at runtime from CpuFeatures.
+class PixelConvert
+{
+public:
+
+	// Convert a bottom-up BGRA8 image (the TGA default) into a top-down RGBA8 image in place, swizzling and flipping in one pass.
+	static void FlipBgraToRgba(uchar* pixels, uint width, uint height);
+
+	// Swizzle a run of BGRA8 pixels into RGBA8. Source and destination may be the same buffer.
+	static void BgraToRgba(const uchar* source, uchar* destination, size_t pixelCount);
+
+	// Scalar reference of FlipBgraToRgba, used when the vector paths are unavailable and for comparing results.
+	static void FlipBgraToRgbaScalar(uchar* pixels, uint width, uint height);
+
+	// Name of the instruction set the dispatched kernels use ("avx2", "ssse3" or "scalar").
+	static const char* GetKernelName();
+
+	// The instruction sets the kernels come in, for running and comparing each of them.
+	enum class Kernel
+	{
+		Scalar,
+		Ssse3,
+		Avx2
+	};
+
+	// Whether this processor can run kernel. Scalar always can.
+	static bool IsSupported(Kernel kernel);
+
+	// FlipBgraToRgba and BgraToRgba with kernel instead of the dispatched one. kernel must be supported.
+	static void FlipBgraToRgba(uchar* pixels, uint width, uint height, Kernel kernel);
+	static void BgraToRgba(const uchar* source, uchar* destination, size_t pixelCount, Kernel kernel);
+};
@@ -0,0 +1,355 @@
+#include "Profiler.h"
+
+#include <algorithm>
+
+namespace
+{
+	// Spin until the clocks have run this long before comparing them, so reading them costs little of the ratio.
+	const std::chrono::microseconds MIN_CALIBRATION_TIME(1000);
+
+	// Names as JSON string contents.
+	std::string EscapeJson(const std::string& text)
+	{
+		std::string escaped;
+		for (char c : text)
+		{
+			if (c == '"' || c == '\\')
+			{
+				escaped += '\\';
+				escaped += c;
+			}
+			else if ((uchar)c < 0x20u)
+			{
+				escaped += std::format("\\u{:04x}", (uint)(uchar)c);
+			}
+			else
+			{
+				escaped += c;
+			}
+		}
+		return escaped;
+	}
+}
+
+Profiler& Profiler::Get()
+{
+	static Profiler profiler;
+	return profiler;
+}
+
+Profiler::Profiler()
+	: _startTicks(GetTicks())
+	, _startTime(std::chrono::steady_clock::now())
+{
+}
+
+void Profiler::SetThreadName(const std::string& name)
+{
+	ThreadBuffer* buffer = GetThreadBuffer();
+	std::lock_guard<std::mutex> lock(_threadsMutex);
+	buffer->name = name;
+}
+
+uint Profiler::AddTrack(const std::string& name)
+{
+	std::lock_guard<std::mutex> lock(_threadsMutex);
+	for (const std::unique_ptr<ThreadBuffer>& buffer : _threads)
+	{
+		if (buffer->isTrack && buffer->name == name)
+			return buffer->index;
+	}
+
+	auto buffer = std::make_unique<ThreadBuffer>();
+	buffer->index = (uint)_threads.size();
+	buffer->name = name;
+	buffer->isTrack = true;
+	_threads.push_back(std::move(buffer));
+	return _threads.back()->index;
+}
+
+void Profiler::Record(uint track, const char* name, uint64_t start, uint64_t end, uint depth)
+{
+	ThreadBuffer* buffer;
+	{
+		std::lock_guard<std::mutex> lock(_threadsMutex);
+		buffer = _threads[track].get();
+	}
+	Push(*buffer, { name, start, end, depth });
+}
+
+Profiler::ThreadBuffer* Profiler::RegisterThread()
+{
+	std::lock_guard<std::mutex> lock(_threadsMutex);
+	auto buffer = std::make_unique<ThreadBuffer>();
+	buffer->index = (uint)_threads.size();
+	buffer->name = std::format("Thread {}", buffer->index);
+	_threadBuffer = buffer.get();
+	_threads.push_back(std::move(buffer));
+	return _threadBuffer;
+}
+
+void Profiler::Calibrate()
+{
+	auto elapsed = std::chrono::steady_clock::now() - _startTime;
+	while (elapsed < MIN_CALIBRATION_TIME)
+		elapsed = std::chrono::steady_clock::now() - _startTime;
+
+	uint64_t ticks = GetTicks() - _startTicks;
+	_ticksPerNanosecond = (double)ticks / (double)std::chrono::duration_cast<std::chrono::nanoseconds>(elapsed).count();
+}
+
+void Profiler::EndFrame()
+{
+	Calibrate();
+
+	// Take every thread's events, nesting them into the call tree.
+	std::vector<TraceEvent> trace;
+	{
+		std::lock_guard<std::mutex> lock(_threadsMutex);
+		for (const std::unique_ptr<ThreadBuffer>& buffer : _threads)
+			Gather(*buffer, _scratch, trace);
+	}
+
+	// Add the frame's totals to the rolling window of every scope that ran.
+	double ticksPerMillisecond = _ticksPerNanosecond * 1000000.0;
+	for (Node& node : _nodes)
+	{
+		if (node.frameCalls == 0u)
+			continue;
+
+		node.lastMilliseconds = node.frameTicks / ticksPerMillisecond;
+		if (node.milliseconds.size() < HISTORY_FRAMES)
+		{
+			node.milliseconds.push_back(node.lastMilliseconds);
+			node.calls.push_back(node.frameCalls);
+		}
+		else
+		{
+			node.milliseconds[node.next] = node.lastMilliseconds;
+			node.calls[node.next] = node.frameCalls;
+		}
+		node.next = (node.next + 1u) % HISTORY_FRAMES;
+		node.frameTicks = 0u;
+		node.frameCalls = 0u;
+	}
+
+	_trace.push_back(std::move(trace));
+	if (_trace.size() > TRACE_FRAMES)
+		_trace.pop_front();
+	_frameCount++;
+}
+
+void Profiler::Gather(ThreadBuffer& buffer, std::vector<Event>& events, std::vector<TraceEvent>& trace)
+{
+	// Copy the new events out and hand their slots back to the thread.
+	uint64_t write = buffer.write.load(std::memory_order_acquire);
+	uint64_t read = buffer.read.load(std::memory_order_relaxed);
+	events.swap(buffer.waiting);
+	buffer.waiting.clear();
+	for (; read < write; ++read)
+		events.push_back(buffer.events[read % RING_CAPACITY]);
+	buffer.read.store(write, std::memory_order_release);
+
+	uint64_t dropped = buffer.dropped.load(std::memory_order_relaxed);
+	_dropped += dropped - buffer.droppedTaken;
+	buffer.droppedTaken = dropped;
+
+	// A thread's scopes nest, so in order of start, enclosing scopes first, each event's parent is the latest one
+	// that has not ended before it starts.
+	std::sort(events.begin(), events.end(), [](const Event& a, const Event& b)
+	{
+		if (a.start != b.start)
+			return a.start < b.start;
+		return a.end != b.end ? a.end > b.end : a.depth < b.depth;
+	});
+
+	struct Open
+	{
+		uint64_t end;
+		uint node;
+	};
+	std::vector<Open> open;
+	uint64_t lastRootStart = 0u;
+	for (const Event& event : events)
+	{
+		while (!open.empty() && open.back().end <= event.start)
+			open.pop_back();
+
+		// The scope enclosing this one is still running; keep it until that has been recorded.
+		if (event.depth > open.size())
+		{
+			buffer.waiting.push_back(event);
+			continue;
+		}
+		open.resize(event.depth);
+
+		uint parent = open.empty() ? INVALID : open.back().node;
+		uint node = FindNode(parent, event.name, buffer.index);
+		_nodes[node].frameTicks += event.end - event.start;
+		_nodes[node].frameCalls++;
+		open.push_back({ event.end, node });
+		trace.push_back({ event.name, event.start, event.end, buffer.index });
+
+		if (event.depth == 0u && event.start > lastRootStart)
+			lastRootStart = event.start;
+	}
+
+	// A waiting event whose thread has started a new outermost scope since it ended lost its enclosing scope.
+	size_t waiting = buffer.waiting.size();
+	std::erase_if(buffer.waiting, [lastRootStart](const Event& event) { return event.end <= lastRootStart; });
+	_dropped += waiting - buffer.waiting.size();
+
+	events.clear();
+}
+
+uint Profiler::FindNode(uint parent, const char* name, uint thread)
+{
+	auto found = _nodeIndex.find({ parent, std::string_view(name) });
+	if (found != _nodeIndex.end())
+		return found->second;
+
+	uint index = (uint)_nodes.size();
+	Node node;
+	node.name = name;
+	node.parent = parent;
+	node.depth = parent == INVALID ? 0u : _nodes[parent].depth + 1u;
+	node.thread = thread;
+	_nodes.push_back(std::move(node));
+	_nodeIndex[{ parent, std::string_view(name) }] = index;
+
+	if (parent == INVALID)
+		_roots.push_back(index);
+	else
+		_nodes[parent].children.push_back(index);
+	return index;
+}
+
+void Profiler::Reset()
+{
+	// Drop whatever the threads have recorded, as if it had been gathered.
+	{
+		std::lock_guard<std::mutex> lock(_threadsMutex);
+		for (const std::unique_ptr<ThreadBuffer>& buffer : _threads)
+		{
+			buffer->read.store(buffer->write.load(std::memory_order_acquire), std::memory_order_release);
+			buffer->droppedTaken = buffer->dropped.load(std::memory_order_relaxed);
+			buffer->waiting.clear();
+		}
+	}
+
+	_nodes.clear();
+	_roots.clear();
+	_nodeIndex.clear();
+	_trace.clear();
+	_frameCount = 0u;
+	_dropped = 0u;
+}
+
+std::vector<Profiler::ScopeStats> Profiler::GetStats() const
+{
+	std::vector<ScopeStats> stats;
+	for (uint root : _roots)
+		AddStats(root, stats, INVALID);
+	return stats;
+}
+
+void Profiler::AddStats(uint index, std::vector<ScopeStats>& stats, uint parent) const
+{
+	const Node& node = _nodes[index];
+	ScopeStats scope;
+	scope.name = node.name;
+	{
+		std::lock_guard<std::mutex> lock(_threadsMutex);
+		scope.thread = _threads[node.thread]->name;
+	}
+	scope.parent = parent;
+	scope.depth = node.depth;
+
+	// Nodes only exist once they have run, so the window has at least one frame.
+	std::vector<double> milliseconds = node.milliseconds;
+	std::sort(milliseconds.begin(), milliseconds.end());
+	uint callSum = 0u;
+	for (uint calls : node.calls)
+		callSum += calls;
+	double sum = 0.0;
+	for (double value : milliseconds)
+		sum += value;
+
+	scope.frames = (uint)milliseconds.size();
+	scope.calls = (double)callSum / scope.frames;
+	scope.lastMilliseconds = node.lastMilliseconds;
+	scope.minMilliseconds = milliseconds.front();
+	scope.averageMilliseconds = sum / scope.frames;
+	scope.p99Milliseconds = milliseconds[(milliseconds.size() * 99u + 99u) / 100u - 1u];
+
+	uint self = (uint)stats.size();
+	stats.push_back(std::move(scope));
+	for (uint child : node.children)
+		AddStats(child, stats, self);
+}
+
+void Profiler::WriteSummary(std::ostream& output) const
+{
+	WriteSummary(GetStats(), output);
+}
+
+void Profiler::WriteSummary(const std::vector<ScopeStats>& stats, std::ostream& output)
+{
+	output << std::format("{:<48} {:>7} {:>7} {:>9} {:>9} {:>9}", "Scope (ms per frame)", "frames", "calls", "min", "average", "p99") << std::endl;
+	for (const ScopeStats& scope : stats)
+	{
+		std::string name = std::string(scope.depth * 2u, ' ') + scope.name;
+		if (scope.parent == INVALID)
+			name += std::format(" [{}]", scope.thread);
+		output << std::format("{:<48} {:>7} {:>7.1f} {:>9.3f} {:>9.3f} {:>9.3f}", name, scope.frames, scope.calls,
+			scope.minMilliseconds, scope.averageMilliseconds, scope.p99Milliseconds) << std::endl;
+	}
+}
+
+bool Profiler::WriteChromeTrace(const char* filename) const
+{
+	std::ofstream file(filename, std::ios::binary);
+	if (!file)
+		return false;
+
+	// Name the threads, then write every scope as a complete event, in microseconds since the profiler started.
+	file << "{\"traceEvents\":[";
+	const char* separator = "\n";
+	{
+		std::lock_guard<std::mutex> lock(_threadsMutex);
+		for (const std::unique_ptr<ThreadBuffer>& buffer : _threads)
+		{
+			file << separator << std::format("{{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":0,\"tid\":{},\"args\":{{\"name\":\"{}\"}}}}",
+				buffer->index, EscapeJson(buffer->name));
+			separator = ",\n";
+		}
+	}
+
+	double ticksPerMicrosecond = _ticksPerNanosecond * 1000.0;
+	for (const std::vector<TraceEvent>& frame : _trace)
+	{
+		for (const TraceEvent& event : frame)
+		{
+			file << separator << std::format("{{\"name\":\"{}\",\"cat\":\"cpu\",\"ph\":\"X\",\"pid\":0,\"tid\":{},\"ts\":{:.3f},\"dur\":{:.3f}}}",
+				EscapeJson(event.name), event.thread, (event.start - _startTicks) / ticksPerMicrosecond, (event.end - event.start) / ticksPerMicrosecond);
+		}
+	}
+
+	file << "\n],\"displayTimeUnit\":\"ms\"}\n";
+	return file.good();
+}
+
+uint64_t Profiler::GetFrameCount() const
+{
+	return _frameCount;
+}
+
+uint64_t Profiler::GetDroppedCount() const
+{
+	return _dropped;
+}
+
+double Profiler::GetTicksPerNanosecond() const
+{
+	return _ticksPerNanosecond;
+}
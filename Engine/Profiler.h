@@ -0,0 +1,259 @@
+#pragma once
+
+#include <atomic>
+#include <chrono>
+#include <deque>
+#include <mutex>
+#include <ostream>
+#include <string_view>
+#include "Common.h"
+
+#if defined(_MSC_VER) && (defined(_M_X64) || defined(_M_IX86))
+#include <intrin.h>
+#elif defined(__x86_64__) || defined(__i386__)
+#include <x86intrin.h>
+#endif
+
+// Hierarchical CPU profiler. PROFILE_SCOPE marks a block of code; the profiler keeps the time every marked block took,
+// on every thread, as a call tree.
+//
+// - A marker reads the time stamp counter when it starts and when it ends, and pushes one event into a ring buffer
+//   owned by its thread. Only that thread writes to the ring and only EndFrame reads from it, so recording takes no
+//   locks and no shared cache lines. Events that find the ring full are dropped and counted.
+// - EndFrame, called on the main thread once a frame, takes the events every thread recorded since the last frame,
+//   nests them by their times into a call tree, and adds every scope's time to a rolling window of frames for its
+//   minimum, average and 99th percentile. Events that finished before the scope enclosing them wait for it.
+// - Tracks hold events timed by something other than a thread of the engine, such as the GPU, recorded with Record in
+//   ticks of GetTicks. They are gathered, summarized and traced like threads.
+// - The events of the last frames are kept for WriteChromeTrace, which writes them in the Chrome trace event format,
+//   opened by chrome://tracing and ui.perfetto.dev.
+//
+// Timestamps are converted to nanoseconds against std::chrono::steady_clock, so the time stamp counter must be
+// invariant, which it is on every processor the engine runs on.
+class Profiler
+{
+public:
+
+	// Time spent in one scope of the call tree, over the frames in the rolling window that it ran in.
+	struct ScopeStats
+	{
+		std::string name;
+		std::string thread;		// Thread it first ran on.
+		uint parent = INVALID;	// Index into the stats of the enclosing scope, INVALID for a root.
+		uint depth = 0u;
+		uint frames = 0u;		// Frames of the window it ran in.
+		double calls = 0.0;		// Average calls in those frames.
+		double lastMilliseconds = 0.0;	// Total time of the last frame it ran in.
+		double minMilliseconds = 0.0;
+		double averageMilliseconds = 0.0;
+		double p99Milliseconds = 0.0;
+	};
+
+	static const uint INVALID = ~0u;
+
+	// Frames the stats are taken over, and frames of events kept for the trace.
+	static const uint HISTORY_FRAMES = 600u;
+	static const uint TRACE_FRAMES = 300u;
+
+	// Events a thread can record between two EndFrame calls.
+	static const uint RING_CAPACITY = 8192u;
+
+	struct Event
+	{
+		const char* name;
+		uint64_t start;	// Time stamp counter ticks.
+		uint64_t end;
+		uint depth;		// Scopes open on the thread when it started.
+	};
+
+	// The profiler every marker records into.
+	static Profiler& Get();
+
+	Profiler(const Profiler&) = delete;
+	Profiler& operator=(const Profiler&) = delete;
+
+	// Current time stamp counter, in ticks of GetTicksPerNanosecond.
+	static uint64_t GetTicks();
+
+	// Names the calling thread in the summary and the trace.
+	void SetThreadName(const std::string& name);
+
+	// The track of that name, added the first time.
+	uint AddTrack(const std::string& name);
+
+	// Records a scope of a track, depth scopes deep. Only one thread may record on a track.
+	void Record(uint track, const char* name, uint64_t start, uint64_t end, uint depth);
+
+	// Gathers the events of every thread into the stats and the trace. Call once a frame, on one thread, outside any
+	// scope of that thread.
+	void EndFrame();
+
+	// Forgets every scope, frame and dropped event so far. Events recorded since the last EndFrame are dropped too.
+	void Reset();
+
+	// Every scope of the call tree, each followed by the scopes it encloses, in the order they first ran.
+	std::vector<ScopeStats> GetStats() const;
+
+	// Writes GetStats as an indented table.
+	void WriteSummary(std::ostream& output) const;
+
+	// Writes stats taken earlier with GetStats, so the table can be formatted and written on another thread.
+	static void WriteSummary(const std::vector<ScopeStats>& stats, std::ostream& output);
+
+	// Writes the events of the last TRACE_FRAMES frames as a Chrome trace. Returns false if the file cannot be written.
+	bool WriteChromeTrace(const char* filename) const;
+
+	uint64_t GetFrameCount() const;
+
+	// Events lost to full rings, or to scopes whose enclosing scope was lost.
+	uint64_t GetDroppedCount() const;
+
+	// Measured against steady_clock since the profiler was created.
+	double GetTicksPerNanosecond() const;
+
+private:
+
+	// Events recorded by one thread, written by it and read by EndFrame. The indices only grow; an event lives at its
+	// index modulo the capacity.
+	struct ThreadBuffer
+	{
+		alignas(64) std::atomic<uint64_t> write = 0u;
+		std::atomic<uint64_t> dropped = 0u;
+		uint depth = 0u;	// Scopes open on the thread.
+		alignas(64) std::atomic<uint64_t> read = 0u;
+		Event events[RING_CAPACITY];
+
+		// Used by EndFrame only.
+		std::string name;
+		uint index = 0u;
+		bool isTrack = false;
+		uint64_t droppedTaken = 0u;	// Of dropped, those already counted.
+		std::vector<Event> waiting;	// Events whose enclosing scope has not been taken yet.
+	};
+
+	struct Node
+	{
+		const char* name;
+		uint parent;
+		uint depth;
+		uint thread;
+		std::vector<uint> children;
+
+		// Totals of the frame being gathered.
+		uint64_t frameTicks = 0u;
+		uint frameCalls = 0u;
+
+		// Rolling window of the frames it ran in.
+		std::vector<double> milliseconds;
+		std::vector<uint> calls;
+		uint next = 0u;
+		double lastMilliseconds = 0.0;
+	};
+
+	struct TraceEvent
+	{
+		const char* name;
+		uint64_t start;
+		uint64_t end;
+		uint thread;
+	};
+
+	friend class ProfileScope;
+
+	Profiler();
+
+	static ThreadBuffer* GetThreadBuffer();
+	static void Push(ThreadBuffer& buffer, const Event& event);
+	ThreadBuffer* RegisterThread();
+	void Gather(ThreadBuffer& buffer, std::vector<Event>& events, std::vector<TraceEvent>& trace);
+	uint FindNode(uint parent, const char* name, uint thread);
+	void Calibrate();
+	void AddStats(uint node, std::vector<ScopeStats>& stats, uint parent) const;
+
+	static inline thread_local ThreadBuffer* _threadBuffer = nullptr;
+
+	// Every thread that has recorded, in the order they started recording. Buffers live as long as the profiler.
+	mutable std::mutex _threadsMutex;
+	std::vector<std::unique_ptr<ThreadBuffer>> _threads;
+
+	// The call tree: roots, then children, keyed by parent and name.
+	std::vector<Node> _nodes;
+	std::vector<uint> _roots;
+	std::map<std::pair<uint, std::string_view>, uint> _nodeIndex;
+
+	std::deque<std::vector<TraceEvent>> _trace;
+	std::vector<Event> _scratch;
+	uint64_t _frameCount = 0u;
+	uint64_t _dropped = 0u;
+
+	uint64_t _startTicks = 0u;
+	std::chrono::steady_clock::time_point _startTime;
+	double _ticksPerNanosecond = 1.0;
+};
+
+// Records the time from its construction to its destruction as a scope of the calling thread.
+class ProfileScope
+{
+public:
+
+	// name must outlive the profiler, as literals do.
+	explicit ProfileScope(const char* name)
+		: _buffer(Profiler::GetThreadBuffer())
+	{
+		_event.name = name;
+		_event.depth = _buffer->depth++;
+		_event.start = Profiler::GetTicks();
+	}
+
+	~ProfileScope()
+	{
+		_event.end = Profiler::GetTicks();
+		_buffer->depth--;
+		Profiler::Push(*_buffer, _event);
+	}
+
+	ProfileScope(const ProfileScope&) = delete;
+	ProfileScope& operator=(const ProfileScope&) = delete;
+
+private:
+
+	Profiler::ThreadBuffer* _buffer;
+	Profiler::Event _event;
+};
+
+#define PROFILE_CONCATENATE_(a, b) a##b
+#define PROFILE_CONCATENATE(a, b) PROFILE_CONCATENATE_(a, b)
+
+// Profiles the rest of the enclosing block under name, a string literal.
+#define PROFILE_SCOPE(name) ProfileScope PROFILE_CONCATENATE(profileScope, __LINE__)(name)
+
+inline uint64_t Profiler::GetTicks()
+{
+#if defined(_M_X64) || defined(_M_IX86) || defined(__x86_64__) || defined(__i386__)
+	return __rdtsc();
+#else
+	return (uint64_t)std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now().time_since_epoch()).count();
+#endif
+}
+
+inline Profiler::ThreadBuffer* Profiler::GetThreadBuffer()
+{
+	ThreadBuffer* buffer = _threadBuffer;
+	if (!buffer)
+		buffer = Get().RegisterThread();
+	return buffer;
+}
+
+inline void Profiler::Push(ThreadBuffer& buffer, const Event& event)
+{
+	// Only this thread moves write, so it can be read relaxed; read is moved by EndFrame once it has copied events out.
+	uint64_t write = buffer.write.load(std::memory_order_relaxed);
+	if (write - buffer.read.load(std::memory_order_acquire) >= RING_CAPACITY)
+	{
+		buffer.dropped.store(buffer.dropped.load(std::memory_order_relaxed) + 1u, std::memory_order_relaxed);
+		return;
+	}
+
+	buffer.events[write % RING_CAPACITY] = event;
+	buffer.write.store(write + 1u, std::memory_order_release);
+}
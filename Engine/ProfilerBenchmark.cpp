@@ -0,0 +1,270 @@
+#include "ProfilerBenchmark.h"
+#include "Profiler.h"
+#include "JobSystem.h"
+
+#include <atomic>
+#include <chrono>
+#include <filesystem>
+#include <sstream>
+#include <thread>
+
+namespace
+{
+	const uint MARKER_BATCH = 2048u;	// Markers recorded by one thread between two EndFrame calls, well inside a ring.
+	const uint MARKER_BATCHES = 256u;
+	const uint NESTING = 4u;
+	const double MARKER_BUDGET_NANOSECONDS = 50.0;
+
+	const uint CHECK_FRAMES = 100u;
+	const uint STEPS = 3u;
+	const std::chrono::microseconds STEP_TIME(20);
+	const std::chrono::microseconds RENDER_TIME(50);
+	const std::chrono::microseconds TASK_TIME(20);
+	const uint EXTRA_EVENTS = 100u;	// Recorded past a full ring.
+
+	double MillisecondsSince(std::chrono::steady_clock::time_point start)
+	{
+		return std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+	}
+
+	void Spin(std::chrono::microseconds duration)
+	{
+		auto start = std::chrono::steady_clock::now();
+		while (std::chrono::steady_clock::now() - start < duration)
+		{
+		}
+	}
+
+	// Records MARKER_BATCH markers, side by side or NESTING deep, and returns the milliseconds they took.
+	double RecordMarkers(bool nested)
+	{
+		auto start = std::chrono::steady_clock::now();
+		if (nested)
+		{
+			for (uint i = 0u; i < MARKER_BATCH / NESTING; ++i)
+			{
+				PROFILE_SCOPE("Marker 0");
+				{
+					PROFILE_SCOPE("Marker 1");
+					{
+						PROFILE_SCOPE("Marker 2");
+						{
+							PROFILE_SCOPE("Marker 3");
+						}
+					}
+				}
+			}
+		}
+		else
+		{
+			for (uint i = 0u; i < MARKER_BATCH; ++i)
+			{
+				PROFILE_SCOPE("Marker");
+			}
+		}
+		return MillisecondsSince(start);
+	}
+
+	// Nanoseconds per marker on each of threadCount threads recording at once. Gathering the events is not counted.
+	double MeasureMarkers(uint threadCount, bool nested)
+	{
+		Profiler& profiler = Profiler::Get();
+		profiler.Reset();
+
+		double milliseconds = 0.0;
+		uint batches = 0u;
+		std::vector<double> taskMilliseconds(threadCount);
+		for (uint batch = 0u; batch < MARKER_BATCHES; ++batch)
+		{
+			JobSystem::GetDefault().ParallelFor(threadCount, threadCount, [&](uint task)
+			{
+				taskMilliseconds[task] = RecordMarkers(nested);
+			});
+			for (double value : taskMilliseconds)
+				milliseconds += value;
+			batches += threadCount;
+			profiler.EndFrame();
+		}
+
+		return milliseconds * 1000000.0 / ((double)batches * MARKER_BATCH);
+	}
+
+	// Index in stats of the scope named name under the scope named parent, or a root for nullptr; INVALID if none.
+	uint FindScope(const std::vector<Profiler::ScopeStats>& stats, const char* name, const char* parent)
+	{
+		for (uint i = 0u; i < (uint)stats.size(); ++i)
+		{
+			if (stats[i].name != name)
+				continue;
+			if (parent ? stats[i].parent != Profiler::INVALID && stats[stats[i].parent].name == parent : stats[i].parent == Profiler::INVALID)
+				return i;
+		}
+		return Profiler::INVALID;
+	}
+
+	// Every call of the scope named name, wherever it ran.
+	double CountCalls(const std::vector<Profiler::ScopeStats>& stats, const char* name)
+	{
+		double calls = 0.0;
+		for (const Profiler::ScopeStats& scope : stats)
+		{
+			if (scope.name == name)
+				calls += scope.calls * scope.frames;
+		}
+		return calls;
+	}
+
+	// The window's minimum, average and 99th percentile of a scope are in order and no shorter than it spun for.
+	bool CheckTimes(const Profiler::ScopeStats& scope, std::chrono::microseconds spin)
+	{
+		double spinMilliseconds = std::chrono::duration<double, std::milli>(spin).count();
+		return scope.minMilliseconds >= spinMilliseconds * 0.99 && scope.minMilliseconds <= scope.averageMilliseconds &&
+			scope.averageMilliseconds <= scope.p99Milliseconds;
+	}
+
+	size_t CountOccurrences(const std::string& text, const std::string& pattern)
+	{
+		size_t count = 0u;
+		for (size_t position = text.find(pattern); position != std::string::npos; position = text.find(pattern, position + pattern.size()))
+			count++;
+		return count;
+	}
+}
+
+bool RunProfilerBenchmark(std::ostream& output)
+{
+	namespace fs = std::filesystem;
+
+	Profiler& profiler = Profiler::Get();
+	JobSystem& jobs = JobSystem::GetDefault();
+	uint threadCount = jobs.GetThreadCount();
+	bool allMatch = true;
+
+	// Marker cost, with every thread writing to its own ring at once in the second pair.
+	output << std::format("Marker cost over {} batches of {} markers", MARKER_BATCHES, MARKER_BATCH) << std::endl;
+	for (uint threads : { 1u, threadCount })
+	{
+		for (bool nested : { false, true })
+		{
+			double nanoseconds = MeasureMarkers(threads, nested);
+			bool fast = nanoseconds < MARKER_BUDGET_NANOSECONDS && profiler.GetDroppedCount() == 0u;
+			allMatch = allMatch && fast;
+			output << std::format("{:>2} threads, {:<12} {:6.1f} ns per marker {}", threads, nested ? "nested:" : "side by side:",
+				nanoseconds, fast ? "OK" : "TOO SLOW") << std::endl;
+		}
+	}
+	output << std::format("Time stamp counter at {:.3f} GHz", profiler.GetTicksPerNanosecond()) << std::endl;
+
+	// Frames of a known shape: a frame with an update of a few steps, a render, and tasks on every thread.
+	profiler.Reset();
+	auto start = std::chrono::steady_clock::now();
+	for (uint frame = 0u; frame < CHECK_FRAMES; ++frame)
+	{
+		{
+			PROFILE_SCOPE("Frame");
+			{
+				PROFILE_SCOPE("Update");
+				for (uint step = 0u; step < STEPS; ++step)
+				{
+					PROFILE_SCOPE("Step");
+					Spin(STEP_TIME);
+				}
+			}
+			{
+				PROFILE_SCOPE("Render");
+				Spin(RENDER_TIME);
+			}
+			jobs.ParallelFor(threadCount, threadCount, [](uint)
+			{
+				PROFILE_SCOPE("Task");
+				Spin(TASK_TIME);
+			});
+		}
+		profiler.EndFrame();
+	}
+	double frameMilliseconds = MillisecondsSince(start) / CHECK_FRAMES;
+
+	// A scope on a thread of its own that encloses an EndFrame, with a scope inside it that ended before.
+	std::atomic<uint> stage = 0u;
+	std::thread loader([&stage]()
+	{
+		Profiler::Get().SetThreadName("Loader");
+		{
+			PROFILE_SCOPE("Load");
+			{
+				PROFILE_SCOPE("Decode");
+				Spin(TASK_TIME);
+			}
+			stage = 1u;
+			while (stage != 2u)
+				std::this_thread::yield();
+		}
+	});
+	while (stage != 1u)
+		std::this_thread::yield();
+	profiler.EndFrame();
+	stage = 2u;
+	loader.join();
+	profiler.EndFrame();
+
+	std::vector<Profiler::ScopeStats> stats = profiler.GetStats();
+	uint frameScope = FindScope(stats, "Frame", nullptr);
+	uint update = FindScope(stats, "Update", "Frame");
+	uint step = FindScope(stats, "Step", "Update");
+	uint render = FindScope(stats, "Render", "Frame");
+	uint load = FindScope(stats, "Load", nullptr);
+	uint decode = FindScope(stats, "Decode", "Load");
+	bool treeMatch = frameScope != Profiler::INVALID && update != Profiler::INVALID && step != Profiler::INVALID &&
+		render != Profiler::INVALID && load != Profiler::INVALID && decode != Profiler::INVALID &&
+		stats[step].depth == 2u && FindScope(stats, "Decode", nullptr) == Profiler::INVALID;
+	bool countMatch = treeMatch && stats[frameScope].frames == CHECK_FRAMES && stats[step].frames == CHECK_FRAMES &&
+		stats[step].calls == (double)STEPS && stats[render].calls == 1.0 && CountCalls(stats, "Task") == (double)threadCount * CHECK_FRAMES &&
+		stats[decode].frames == 1u && stats[load].thread == "Loader";
+	bool timeMatch = treeMatch && CheckTimes(stats[step], STEP_TIME * STEPS) && CheckTimes(stats[render], RENDER_TIME) &&
+		CheckTimes(stats[frameScope], STEP_TIME * STEPS + RENDER_TIME) && stats[frameScope].averageMilliseconds <= frameMilliseconds;
+	bool dropMatch = profiler.GetDroppedCount() == 0u;
+	allMatch = allMatch && treeMatch && countMatch && timeMatch && dropMatch;
+
+	output << std::format("{} frames of {} steps, a render and {} tasks, {:.3f} ms each:", CHECK_FRAMES, STEPS, threadCount, frameMilliseconds) << std::endl;
+	std::ostringstream summary;
+	profiler.WriteSummary(summary);
+	output << summary.str();
+	output << std::format("Call tree: {}, calls: {}, times: {}, no events dropped: {}", treeMatch ? "OK" : "MISMATCH",
+		countMatch ? "OK" : "MISMATCH", timeMatch ? "OK" : "MISMATCH", dropMatch ? "OK" : "MISMATCH") << std::endl;
+
+	// The trace holds every event of the frames, and names every thread that recorded.
+	std::error_code error;
+	fs::path tracePath = fs::temp_directory_path(error) / "profiler-benchmark.json";
+	std::string trace;
+	if (profiler.WriteChromeTrace(tracePath.string().c_str()))
+	{
+		std::ifstream file(tracePath, std::ios::binary);
+		trace.assign(std::istreambuf_iterator<char>(file), std::istreambuf_iterator<char>());
+	}
+	fs::remove(tracePath, error);
+	size_t expectedEvents = (size_t)CHECK_FRAMES * (3u + STEPS + threadCount) + 2u;
+	size_t traceEvents = CountOccurrences(trace, "\"ph\":\"X\"");
+	bool traceMatch = trace.starts_with("{\"traceEvents\":[") && trace.ends_with("}\n") && traceEvents == expectedEvents &&
+		CountOccurrences(trace, "\"name\":\"Loader\"") == 1u;
+	allMatch = allMatch && traceMatch;
+	output << std::format("Chrome trace: {} bytes, {} events of {}: {}", trace.size(), traceEvents, expectedEvents,
+		traceMatch ? "OK" : "MISMATCH") << std::endl;
+
+	// Events past a full ring are counted as dropped rather than overwriting ones not yet gathered.
+	profiler.Reset();
+	for (uint i = 0u; i < Profiler::RING_CAPACITY + EXTRA_EVENTS; ++i)
+	{
+		PROFILE_SCOPE("Overflow");
+	}
+	profiler.EndFrame();
+	stats = profiler.GetStats();
+	uint overflow = FindScope(stats, "Overflow", nullptr);
+	bool overflowMatch = profiler.GetDroppedCount() == EXTRA_EVENTS && overflow != Profiler::INVALID &&
+		stats[overflow].calls == (double)Profiler::RING_CAPACITY;
+	allMatch = allMatch && overflowMatch;
+	output << std::format("Full ring: {} events dropped of {}: {}", profiler.GetDroppedCount(), Profiler::RING_CAPACITY + EXTRA_EVENTS,
+		overflowMatch ? "OK" : "MISMATCH") << std::endl;
+
+	profiler.Reset();
+	return allMatch;
+}
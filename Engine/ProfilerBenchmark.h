@@ -0,0 +1,11 @@
+#pragma once
+
+#include <ostream>
+#include "Common.h"
+
+// Measures what a profiler marker costs, on one thread and on every thread of the job system at once, with markers
+// nested and side by side. Then profiles frames of a known shape and checks the call tree it builds: the nesting and
+// call counts of every scope, the minimum, average and 99th percentile against the time each scope spun for, scopes
+// that end on another thread across an EndFrame, events dropped by a full ring, and the events in the Chrome trace.
+// Run with "Engine.exe -benchmark-profiler". Returns false if any check fails or a marker costs 50 ns or more.
+bool RunProfilerBenchmark(std::ostream& output);
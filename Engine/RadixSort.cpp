@@ -0,0 +1,139 @@
+#include "RadixSort.h"
+#include "JobSystem.h"
+
+#include <algorithm>
+#include <array>
+
+namespace
+{
+	const uint DIGIT_BITS = 8u;
+	const uint DIGIT_COUNT = 64u / DIGIT_BITS;
+	const uint BUCKET_COUNT = 1u << DIGIT_BITS;
+
+	// Each slice has at least this many entries; smaller arrays are sorted on one thread.
+	const size_t ENTRIES_PER_SLICE = 65536u;
+
+	using Entry = RadixSort::Entry;
+	using Histogram = std::array<uint, BUCKET_COUNT>;
+
+	inline uint GetDigit(uint64_t key, uint digit)
+	{
+		return (uint)(key >> (digit * DIGIT_BITS)) & (BUCKET_COUNT - 1u);
+	}
+
+	uint SortSerial(std::vector<Entry>& entries, std::vector<Entry>& scratch)
+	{
+		const size_t count = entries.size();
+
+		// Count every digit in one read of the keys.
+		std::vector<Histogram> counts(DIGIT_COUNT);
+		for (const Entry& entry : entries)
+		{
+			for (uint digit = 0u; digit < DIGIT_COUNT; ++digit)
+				counts[digit][GetDigit(entry.key, digit)]++;
+		}
+
+		Entry* source = entries.data();
+		Entry* destination = scratch.data();
+		uint passes = 0u;
+		for (uint digit = 0u; digit < DIGIT_COUNT; ++digit)
+		{
+			// Every key has the same byte here, so the pass would leave the order as it is.
+			Histogram& offsets = counts[digit];
+			if (offsets[GetDigit(source[0].key, digit)] == count)
+				continue;
+
+			// Turn the counts into the position of the first entry of each bucket.
+			uint offset = 0u;
+			for (uint& bucket : offsets)
+			{
+				uint bucketCount = bucket;
+				bucket = offset;
+				offset += bucketCount;
+			}
+
+			for (size_t i = 0u; i < count; ++i)
+				destination[offsets[GetDigit(source[i].key, digit)]++] = source[i];
+
+			std::swap(source, destination);
+			passes++;
+		}
+
+		// An odd number of passes leaves the sorted entries in the scratch array.
+		if (passes % 2u == 1u)
+			entries.swap(scratch);
+		return passes;
+	}
+
+	uint SortParallel(std::vector<Entry>& entries, std::vector<Entry>& scratch, uint sliceCount)
+	{
+		const size_t count = entries.size();
+		JobSystem& jobs = JobSystem::GetDefault();
+		std::vector<Histogram> counts(sliceCount);
+		std::vector<Histogram> offsets(sliceCount);
+
+		Entry* source = entries.data();
+		Entry* destination = scratch.data();
+		uint passes = 0u;
+		for (uint digit = 0u; digit < DIGIT_COUNT; ++digit)
+		{
+			// Count the digit in every slice.
+			jobs.ParallelFor(sliceCount, sliceCount, [&](uint slice)
+			{
+				Histogram& own = counts[slice];
+				own.fill(0u);
+				for (size_t i = count * slice / sliceCount, end = count * (slice + 1u) / sliceCount; i < end; ++i)
+					own[GetDigit(source[i].key, digit)]++;
+			});
+
+			// A slice's entries of a bucket go after every entry of the lower buckets and after the entries of the same
+			// bucket in the slices before it.
+			bool skip = false;
+			uint total = 0u;
+			for (uint bucket = 0u; bucket < BUCKET_COUNT; ++bucket)
+			{
+				uint bucketStart = total;
+				for (uint slice = 0u; slice < sliceCount; ++slice)
+				{
+					offsets[slice][bucket] = total;
+					total += counts[slice][bucket];
+				}
+				skip = skip || total - bucketStart == count;
+			}
+
+			// Every key has the same byte here, so the pass would leave the order as it is.
+			if (skip)
+				continue;
+
+			jobs.ParallelFor(sliceCount, sliceCount, [&](uint slice)
+			{
+				Histogram& own = offsets[slice];
+				for (size_t i = count * slice / sliceCount, end = count * (slice + 1u) / sliceCount; i < end; ++i)
+					destination[own[GetDigit(source[i].key, digit)]++] = source[i];
+			});
+
+			std::swap(source, destination);
+			passes++;
+		}
+
+		// An odd number of passes leaves the sorted entries in the scratch array.
+		if (passes % 2u == 1u)
+			entries.swap(scratch);
+		return passes;
+	}
+}
+
+uint RadixSort::Sort(std::vector<Entry>& entries, std::vector<Entry>& scratch, uint threadCount)
+{
+	scratch.resize(entries.size());
+	if (entries.size() <= 1u)
+		return 0u;
+
+	if (threadCount == 0u)
+		threadCount = JobSystem::GetDefault().GetThreadCount();
+	threadCount = (uint)std::min<size_t>(threadCount, entries.size() / ENTRIES_PER_SLICE);
+
+	if (threadCount <= 1u)
+		return SortSerial(entries, scratch);
+	return SortParallel(entries, scratch, threadCount);
+}
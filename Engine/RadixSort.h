@@ -0,0 +1,25 @@
+#pragma once
+
+#include "Common.h"
+
+// Least significant digit radix sort of 64-bit keys, each carrying a 32-bit value (usually the index of what the key
+// was made from). Keys are sorted a byte at a time in up to 8 passes; a pass is skipped when every key has the same
+// byte there, which is common for keys packed from a few small fields. The sort is stable.
+//
+// Large arrays are split into slices sorted on the JobSystem: every pass counts each slice in parallel, then scatters
+// each slice after the slices before it, so the jobs never write to the same place and the order of equal keys is kept.
+class RadixSort
+{
+public:
+
+	struct Entry
+	{
+		uint64_t key;
+		uint value;
+	};
+
+	// Sorts the entries by key. scratch is resized to match and may be kept between calls so no memory is allocated;
+	// the two vectors may be swapped. threadCount 0 uses every thread of the job system. Returns the number of passes
+	// that moved entries.
+	static uint Sort(std::vector<Entry>& entries, std::vector<Entry>& scratch, uint threadCount = 0u);
+};
@@ -0,0 +1,52 @@
+#include "Ray.h"
+
+#include <math.h>
+
+Ray Ray::FromScreen(float x, float y, float screenWidth, float screenHeight, const Math::Matrix4& viewMatrix, const Math::Matrix4& projectionMatrix)
+{
+	// Take the pixel back to clip space on the near and far planes, then through the inverse view projection.
+	float clipX = x / screenWidth * 2.0f - 1.0f;
+	float clipY = 1.0f - y / screenHeight * 2.0f;
+
+	Math::Matrix4 inverse = Math::Inverse(Math::Multiply(viewMatrix, projectionMatrix));
+	Math::Float4 nearPoint = Math::TransformPoint(Math::Float3(clipX, clipY, 0.0f), inverse);
+	Math::Float4 farPoint = Math::TransformPoint(Math::Float3(clipX, clipY, 1.0f), inverse);
+
+	Ray ray;
+	ray.origin = Math::Float3(nearPoint.x / nearPoint.w, nearPoint.y / nearPoint.w, nearPoint.z / nearPoint.w);
+	ray.direction = Math::Normalize(Math::Float3(farPoint.x / farPoint.w, farPoint.y / farPoint.w, farPoint.z / farPoint.w) - ray.origin);
+	return ray;
+}
+
+bool Ray::Intersects(const Bounds& bounds, float& distance) const
+{
+	// Slab test: clip the ray against the pair of planes of each axis. Dividing by a zero direction gives infinities,
+	// which the comparisons handle.
+	const float origins[3] = { origin.x, origin.y, origin.z };
+	const float directions[3] = { direction.x, direction.y, direction.z };
+	const float centers[3] = { bounds.center.x, bounds.center.y, bounds.center.z };
+	const float extents[3] = { bounds.extents.x, bounds.extents.y, bounds.extents.z };
+
+	float enterDistance = 0.0f;
+	float exitDistance = INFINITY;
+	for (uint axis = 0u; axis < 3u; ++axis)
+	{
+		float inverse = 1.0f / directions[axis];
+		float nearDistance = (centers[axis] - extents[axis] - origins[axis]) * inverse;
+		float farDistance = (centers[axis] + extents[axis] - origins[axis]) * inverse;
+		if (nearDistance > farDistance)
+		{
+			float swap = nearDistance;
+			nearDistance = farDistance;
+			farDistance = swap;
+		}
+
+		enterDistance = nearDistance > enterDistance ? nearDistance : enterDistance;
+		exitDistance = farDistance < exitDistance ? farDistance : exitDistance;
+		if (enterDistance > exitDistance)
+			return false;
+	}
+
+	distance = enterDistance;
+	return true;
+}
@@ -0,0 +1,20 @@
+#pragma once
+
+#include "Bounds.h"
+#include "Common.h"
+#include "EngineMath.h"
+
+// A half-line for picking and ray casts.
+struct Ray
+{
+	Math::Float3 origin = { 0.0f, 0.0f, 0.0f };
+	Math::Float3 direction = { 0.0f, 0.0f, 1.0f };	// Unit length.
+
+	// The ray through a pixel of the screen, from the near plane into the scene. x and y are in pixels from the
+	// top left corner.
+	static Ray FromScreen(float x, float y, float screenWidth, float screenHeight, const Math::Matrix4& viewMatrix,
+		const Math::Matrix4& projectionMatrix);
+
+	// Distance along the ray to where it enters the box of the bounds, 0 if it starts inside. False if it misses.
+	bool Intersects(const Bounds& bounds, float& distance) const;
+};
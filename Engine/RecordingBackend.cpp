@@ -0,0 +1,288 @@
+#include "RecordingBackend.h"
+
+namespace
+{
+	using Command = RecordingBackend::Command;
+
+	Command MeshCommand(const MeshBuffers& mesh)
+	{
+		Command command;
+		command.type = Command::Type::SetMesh;
+		command.mesh = mesh.vertices;
+		return command;
+	}
+
+	Command TransformsCommand(const Math::Matrix4& worldMatrix, const Math::Float2& textureOffset)
+	{
+		Command command;
+		command.type = Command::Type::SetTransforms;
+		command.worldMatrix = worldMatrix;
+		command.textureOffset = textureOffset;
+		return command;
+	}
+
+	Command TextureCommand(uint slot, const TextureBinding& texture)
+	{
+		Command command;
+		command.type = Command::Type::SetTexture;
+		command.slot = slot;
+		command.texture = texture.view ? (const void*)texture.view : texture.pixels;
+		return command;
+	}
+
+	Command InstancesCommand(const InstanceBuffers& instances)
+	{
+		Command command;
+		command.type = Command::Type::SetInstances;
+		command.instances = instances.instances;
+		command.instanceCount = instances.instanceCount;
+		return command;
+	}
+
+	Command DrawCommand(uint indexCount)
+	{
+		Command command;
+		command.type = Command::Type::DrawIndexed;
+		command.indexCount = indexCount;
+		return command;
+	}
+
+	Command DrawInstancedCommand(uint indexCount, uint instanceCount, uint startInstance)
+	{
+		Command command;
+		command.type = Command::Type::DrawIndexedInstanced;
+		command.indexCount = indexCount;
+		command.instanceCount = instanceCount;
+		command.startInstance = startInstance;
+		return command;
+	}
+}
+
+// Keeps its commands until the owner's Execute moves them over.
+class RecordingBackend::Recorder : public CommandRecorder
+{
+public:
+
+	explicit Recorder(RecordingBackend& owner)
+		: _owner(owner)
+	{
+	}
+
+	void Begin() override
+	{
+		if (_recording.exchange(true))
+			_owner._errorCount++;
+
+		_thread = std::this_thread::get_id();
+		_commands.clear();
+	}
+
+	void Finish() override
+	{
+		if (!_recording.exchange(false) || std::this_thread::get_id() != _thread)
+			_owner._errorCount++;
+	}
+
+	// Called by the owner once the recording is finished.
+	std::vector<Command>& GetCommands()
+	{
+		if (_recording.load())
+			_owner._errorCount++;
+		return _commands;
+	}
+
+	void BeginScene(float, float, float, float) override
+	{
+	}
+
+	void EndScene() override
+	{
+	}
+
+	D3DContext* GetD3DContext() override
+	{
+		return nullptr;
+	}
+
+	GpuTimer* GetGpuTimer() override
+	{
+		return nullptr;
+	}
+
+	void GetProjectionMatrix(Math::Matrix4& projectionMatrix) override
+	{
+		_owner.GetProjectionMatrix(projectionMatrix);
+	}
+
+	void GetWorldMatrix(Math::Matrix4& worldMatrix) override
+	{
+		_owner.GetWorldMatrix(worldMatrix);
+	}
+
+	void GetOrthoMatrix(Math::Matrix4& orthoMatrix) override
+	{
+		_owner.GetOrthoMatrix(orthoMatrix);
+	}
+
+	void SetMesh(const MeshBuffers& mesh) override
+	{
+		Record(MeshCommand(mesh));
+	}
+
+	void SetTransforms(const Math::Matrix4& worldMatrix, const Math::Matrix4&, const Math::Matrix4&, const Math::Float2& textureOffset) override
+	{
+		Record(TransformsCommand(worldMatrix, textureOffset));
+	}
+
+	void SetTexture(uint slot, const TextureBinding& texture) override
+	{
+		Record(TextureCommand(slot, texture));
+	}
+
+	void DrawIndexed(uint indexCount, uint, int) override
+	{
+		Record(DrawCommand(indexCount));
+	}
+
+	void SetInstances(const InstanceBuffers& instances) override
+	{
+		Record(InstancesCommand(instances));
+	}
+
+	void DrawIndexedInstanced(uint indexCount, uint instanceCount, uint, int, uint startInstance) override
+	{
+		Record(DrawInstancedCommand(indexCount, instanceCount, startInstance));
+	}
+
+	uint GetRecorderCount() override
+	{
+		return 0u;
+	}
+
+	CommandRecorder* GetRecorder(uint) override
+	{
+		return nullptr;
+	}
+
+	void Execute(CommandRecorder&) override
+	{
+		// Recorders do not nest.
+		_owner._errorCount++;
+	}
+
+private:
+
+	// Only the thread that began the recording may add to it.
+	void Record(const Command& command)
+	{
+		if (!_recording.load() || std::this_thread::get_id() != _thread)
+			_owner._errorCount++;
+		_commands.push_back(command);
+	}
+
+	RecordingBackend& _owner;
+	std::vector<Command> _commands;
+	std::atomic<bool> _recording = false;
+	std::thread::id _thread;
+};
+
+RecordingBackend::RecordingBackend(uint recorderCount)
+{
+	for (uint i = 0u; i < recorderCount; ++i)
+		_recorders.push_back(std::make_unique<Recorder>(*this));
+}
+
+RecordingBackend::~RecordingBackend() = default;
+
+void RecordingBackend::BeginScene(float, float, float, float)
+{
+	_commands.clear();
+}
+
+void RecordingBackend::EndScene()
+{
+}
+
+D3DContext* RecordingBackend::GetD3DContext()
+{
+	return nullptr;
+}
+
+GpuTimer* RecordingBackend::GetGpuTimer()
+{
+	return nullptr;
+}
+
+void RecordingBackend::GetProjectionMatrix(Math::Matrix4& projectionMatrix)
+{
+	projectionMatrix = Math::Identity();
+}
+
+void RecordingBackend::GetWorldMatrix(Math::Matrix4& worldMatrix)
+{
+	worldMatrix = Math::Identity();
+}
+
+void RecordingBackend::GetOrthoMatrix(Math::Matrix4& orthoMatrix)
+{
+	orthoMatrix = Math::Identity();
+}
+
+void RecordingBackend::SetMesh(const MeshBuffers& mesh)
+{
+	_commands.push_back(MeshCommand(mesh));
+}
+
+void RecordingBackend::SetTransforms(const Math::Matrix4& worldMatrix, const Math::Matrix4&, const Math::Matrix4&, const Math::Float2& textureOffset)
+{
+	_commands.push_back(TransformsCommand(worldMatrix, textureOffset));
+}
+
+void RecordingBackend::SetTexture(uint slot, const TextureBinding& texture)
+{
+	_commands.push_back(TextureCommand(slot, texture));
+}
+
+void RecordingBackend::DrawIndexed(uint indexCount, uint, int)
+{
+	_commands.push_back(DrawCommand(indexCount));
+}
+
+void RecordingBackend::SetInstances(const InstanceBuffers& instances)
+{
+	_commands.push_back(InstancesCommand(instances));
+}
+
+void RecordingBackend::DrawIndexedInstanced(uint indexCount, uint instanceCount, uint, int, uint startInstance)
+{
+	_commands.push_back(DrawInstancedCommand(indexCount, instanceCount, startInstance));
+}
+
+uint RecordingBackend::GetRecorderCount()
+{
+	return (uint)_recorders.size();
+}
+
+CommandRecorder* RecordingBackend::GetRecorder(uint index)
+{
+	return index < _recorders.size() ? _recorders[index].get() : nullptr;
+}
+
+void RecordingBackend::Execute(CommandRecorder& recorder)
+{
+	// Every recording starts from nothing bound, and leaves nothing bound behind it.
+	std::vector<Command>& commands = static_cast<Recorder&>(recorder).GetCommands();
+	_commands.push_back(Command());
+	_commands.insert(_commands.end(), commands.begin(), commands.end());
+	_commands.push_back(Command());
+}
+
+const std::vector<RecordingBackend::Command>& RecordingBackend::GetCommands() const
+{
+	return _commands;
+}
+
+uint RecordingBackend::GetErrorCount() const
+{
+	return _errorCount.load();
+}
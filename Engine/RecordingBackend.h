@@ -0,0 +1,86 @@
+#pragma once
+
+#include <atomic>
+#include <thread>
+#include "Common.h"
+#include "RenderBackend.h"
+
+// Render backend without a device that keeps a list of the commands it is given instead of drawing them. Its recorders
+// stand in for Direct3D deferred contexts: each keeps its own list, and Execute appends it to the backend's list after
+// a Reset command, which marks where the real backends forget every binding. Replaying the list checks what a frame
+// drew, draw by draw, on machines without a GPU.
+//
+// Recorders also check how they are used: a command from another thread than the one that called Begin, a Begin of a
+// recording already in progress or an Execute of an unfinished one counts as an error.
+class RecordingBackend : public RenderBackend
+{
+public:
+
+	struct Command
+	{
+		enum class Type
+		{
+			Reset,
+			SetMesh,
+			SetTransforms,
+			SetTexture,
+			SetInstances,
+			DrawIndexed,
+			DrawIndexedInstanced
+		};
+
+		Type type = Type::Reset;
+		const void* mesh = nullptr;				// SetMesh: the mesh's vertices, which tell meshes apart.
+		const void* texture = nullptr;			// SetTexture: the texture's view or pixels, which tell textures apart.
+		const InstanceData* instances = nullptr;	// SetInstances.
+		Math::Matrix4 worldMatrix;				// SetTransforms.
+		Math::Float2 textureOffset;				// SetTransforms.
+		uint slot = 0u;							// SetTexture.
+		uint indexCount = 0u;					// Draws.
+		uint instanceCount = 0u;				// DrawIndexedInstanced, and SetInstances.
+		uint startInstance = 0u;				// DrawIndexedInstanced.
+	};
+
+	// recorderCount 0 records everything on the backend itself, like a driver without command lists.
+	explicit RecordingBackend(uint recorderCount);
+	~RecordingBackend() override;
+
+	RecordingBackend(const RecordingBackend&) = delete;
+	RecordingBackend& operator=(const RecordingBackend&) = delete;
+
+	void BeginScene(float red, float green, float blue, float alpha) override;
+	void EndScene() override;
+
+	D3DContext* GetD3DContext() override;
+	GpuTimer* GetGpuTimer() override;
+
+	void GetProjectionMatrix(Math::Matrix4&) override;
+	void GetWorldMatrix(Math::Matrix4&) override;
+	void GetOrthoMatrix(Math::Matrix4&) override;
+
+	void SetMesh(const MeshBuffers& mesh) override;
+	void SetTransforms(const Math::Matrix4& worldMatrix, const Math::Matrix4& viewMatrix, const Math::Matrix4& projectionMatrix,
+		const Math::Float2& textureOffset) override;
+	void SetTexture(uint slot, const TextureBinding& texture) override;
+	void DrawIndexed(uint indexCount, uint startIndex, int baseVertex) override;
+	void SetInstances(const InstanceBuffers& instances) override;
+	void DrawIndexedInstanced(uint indexCount, uint instanceCount, uint startIndex, int baseVertex, uint startInstance) override;
+
+	uint GetRecorderCount() override;
+	CommandRecorder* GetRecorder(uint index) override;
+	void Execute(CommandRecorder& recorder) override;
+
+	// Commands since BeginScene, the recorders' ones included where they were executed.
+	const std::vector<Command>& GetCommands() const;
+
+	// Misuses of the recorders since the backend was created.
+	uint GetErrorCount() const;
+
+private:
+
+	class Recorder;
+
+	std::vector<Command> _commands;
+	std::vector<std::unique_ptr<Recorder>> _recorders;
+	std::atomic<uint> _errorCount = 0u;
+};
@@ -1,5 +1,7 @@
 #pragma once
 
+#include <memory>
+
 // This is a smart pointer that will automatically call the Release method on the object it is holding when it goes out of scope.
 template <typename T>
 struct ReleasePtr
@@ -14,10 +16,10 @@ struct ReleasePtr
 	}
 	ReleasePtr& operator=(ReleasePtr&& other) noexcept
 	{
-		if (this != &other)
+		// operator& is overloaded to hand out the raw pointer slot, so take the real address.
+		if (this != std::addressof(other))
 		{
-			if (_ptr)
-				_ptr->Release();
+			Release();
 
 			_ptr = other._ptr;
 			other._ptr = nullptr;
@@ -27,8 +29,7 @@ struct ReleasePtr
 
 	~ReleasePtr()
 	{
-		if (_ptr)
-			_ptr->Release();
+		Release();
 	}
 
 	T* operator->()
@@ -58,5 +59,15 @@ struct ReleasePtr
 
 private:
 
+	// Without Windows there are no COM objects to hold: the Direct3D types are only forward declared there, and nothing
+	// can create one, so the pointer is always null.
+	void Release()
+	{
+#ifdef _WIN32
+		if (_ptr)
+			_ptr->Release();
+#endif
+	}
+
 	T* _ptr = nullptr;
 };
\ No newline at end of file
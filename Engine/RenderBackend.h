@@ -0,0 +1,135 @@
+#pragma once
+
+#include "Common.h"
+#include "EngineMath.h"
+
+class CommandRecorder;
+class D3DContext;
+class GpuTimer;
+
+// Direct3D resources are only carried here, never looked into, so the interface needs no Windows SDK headers.
+struct ID3D11Buffer;
+struct ID3D11ShaderResourceView;
+
+// Geometry bound for the next draw. The Direct3D backend uses the GPU buffers, CPU backends read the vertex and index arrays directly.
+struct MeshBuffers
+{
+	ID3D11Buffer* vertexBuffer = nullptr;
+	ID3D11Buffer* indexBuffer = nullptr;
+	const void* vertices = nullptr;
+	const uint* indices = nullptr;
+	uint vertexStride = 0u;
+	uint positionOffset = 0u;
+	uint texcoordOffset = 0u;
+	uint vertexCount = 0u;
+	uint indexCount = 0u;
+};
+
+// Per-instance attributes of an instanced draw, read by the instanced vertex shaders from a second vertex stream.
+struct InstanceData
+{
+	Math::Matrix4 world;	// Not transposed: the shader rebuilds the matrix from its rows, WORLD0 to WORLD3.
+	Math::Float2 textureOffset;
+};
+
+// Instances bound for the next instanced draws. The Direct3D backend uses the GPU buffer, CPU backends read the array directly.
+struct InstanceBuffers
+{
+	// Vertex input slot of the instance stream; the mesh's vertices are in slot 0.
+	static const uint INPUT_SLOT = 1u;
+
+	ID3D11Buffer* buffer = nullptr;
+	const InstanceData* instances = nullptr;
+	uint instanceCount = 0u;
+};
+
+// Texture bound for the next draws. The Direct3D backends use the shader resource view, CPU backends sample the RGBA8
+// pixels directly.
+struct TextureBinding
+{
+	ID3D11ShaderResourceView* view = nullptr;
+	const uchar* pixels = nullptr;
+	uint width = 0u;
+	uint height = 0u;
+};
+
+// Type of a vertex attribute; ShaderProgram turns it into the DXGI format of the input layout.
+enum class VertexFormat
+{
+	Unknown,
+	Float2,
+	Float3,
+	Float4
+};
+
+// One attribute of a vertex, described by its semantic. Shader programs build their input layouts by matching
+// the inputs their vertex shader reads against these.
+struct VertexElement
+{
+	const char* semantic = nullptr;
+	uint semanticIndex = 0u;
+	VertexFormat format = VertexFormat::Unknown;
+	uint offset = 0u;
+};
+
+// Interface every renderer implements. Application, Model and the shaders only talk to the backend through it,
+// so the same frame can be drawn by Direct3D or by the software rasterizer on machines without a GPU.
+class RenderBackend
+{
+public:
+
+	virtual ~RenderBackend() = default;
+
+	virtual void BeginScene(float red, float green, float blue, float alpha) = 0;
+	virtual void EndScene() = 0;
+
+	// The Direct3D device and context the backend draws with. Backends that do not drive a GPU return null, and
+	// callers skip their GPU resource setup.
+	virtual D3DContext* GetD3DContext() = 0;
+
+	// Timestamp queries on the device context, for GpuProfiler. Null without a device, and on recorders.
+	virtual GpuTimer* GetGpuTimer() = 0;
+
+	virtual void GetProjectionMatrix(Math::Matrix4&) = 0;
+	virtual void GetWorldMatrix(Math::Matrix4&) = 0;
+	virtual void GetOrthoMatrix(Math::Matrix4&) = 0;
+
+	virtual void SetMesh(const MeshBuffers& mesh) = 0;
+
+	// The next draws' matrices and the offset added to their texture coordinates. The Direct3D backends take them from
+	// the object's constant buffer instead; CPU backends apply them here.
+	virtual void SetTransforms(const Math::Matrix4& worldMatrix, const Math::Matrix4& viewMatrix, const Math::Matrix4& projectionMatrix,
+		const Math::Float2& textureOffset) = 0;
+
+	virtual void SetTexture(uint slot, const TextureBinding& texture) = 0;
+	virtual void DrawIndexed(uint indexCount, uint startIndex, int baseVertex) = 0;
+
+	// Draws instanceCount copies of the mesh, instance i with the bound instance data at startInstance + i in place of
+	// the world matrix and texture offset given to SetTransforms.
+	virtual void SetInstances(const InstanceBuffers& instances) = 0;
+	virtual void DrawIndexedInstanced(uint indexCount, uint instanceCount, uint startIndex, int baseVertex, uint startInstance) = 0;
+
+	// Recorders for recording draws on several threads at once, each on its own. 0 when the backend can only draw on
+	// the thread that owns it; GetRecorder returns null past the count.
+	virtual uint GetRecorderCount() = 0;
+	virtual CommandRecorder* GetRecorder(uint index) = 0;
+
+	// Replays what a recorder recorded between its Begin and Finish. Call on the thread that owns the backend, in the
+	// order the recordings have to be drawn. Leaves nothing bound, as if the frame had just begun.
+	virtual void Execute(CommandRecorder& recorder) = 0;
+};
+
+// A backend that records draws for the backend it belongs to instead of drawing them, so a frame's draws can be
+// recorded on several threads and replayed in order. A recording starts with the owner's render target, viewport and
+// fixed states and nothing else bound, so it has to bind everything its draws use. Recorders have no recorders of
+// their own and ignore BeginScene and EndScene.
+class CommandRecorder : public RenderBackend
+{
+public:
+
+	// Starts a recording. Call on the thread that records.
+	virtual void Begin() = 0;
+
+	// Ends the recording, ready for the owner's Execute.
+	virtual void Finish() = 0;
+};
@@ -0,0 +1,48 @@
+#include "RenderState.h"
+
+SoftwareRasterizer::DepthState RenderState::DescribeDepthState()
+{
+	SoftwareRasterizer::DepthState depthState;
+	depthState.depthEnable = true;
+	depthState.depthWrite = true;
+	depthState.depthFunc = SoftwareRasterizer::ComparisonFunc::Less;
+	return depthState;
+}
+
+SoftwareRasterizer::RasterState RenderState::DescribeRasterState()
+{
+	// Only solid fill is used.
+	SoftwareRasterizer::RasterState rasterState;
+	rasterState.cullMode = SoftwareRasterizer::CullMode::Back;
+	rasterState.frontCounterClockwise = false;
+	rasterState.depthClipEnable = true;
+	return rasterState;
+}
+
+SoftwareRasterizer::Viewport RenderState::DescribeViewport(uint screenWidth, uint screenHeight)
+{
+	SoftwareRasterizer::Viewport viewport;
+	viewport.topLeftX = 0.0f;
+	viewport.topLeftY = 0.0f;
+	viewport.width = (float)screenWidth;
+	viewport.height = (float)screenHeight;
+	viewport.minDepth = 0.0f;
+	viewport.maxDepth = 1.0f;
+	return viewport;
+}
+
+Math::Matrix4 RenderState::CreateProjectionMatrix(uint screenWidth, uint screenHeight, float screenNear, float screenFar)
+{
+	// Setup the projection matrix.
+	float fieldOfView = Math::PI / 4.0f;
+	float screenAspect = (float)screenWidth / (float)screenHeight;
+
+	// Create the projection matrix for 3D rendering.
+	return Math::PerspectiveFovLH(fieldOfView, screenAspect, screenNear, screenFar);
+}
+
+Math::Matrix4 RenderState::CreateOrthoMatrix(uint screenWidth, uint screenHeight, float screenNear, float screenFar)
+{
+	// Create an orthographic projection matrix for 2D rendering.
+	return Math::OrthographicLH((float)screenWidth, (float)screenHeight, screenNear, screenFar);
+}
@@ -0,0 +1,19 @@
+#pragma once
+
+#include "Common.h"
+#include "EngineMath.h"
+#include "SoftwareRasterizer.h"
+
+// The fixed pipeline state every backend draws with, so Direct3D and the software rasterizer produce the same frame:
+// depth tested with LESS and written, clockwise front faces with back faces culled, depth clipping, one viewport over
+// the whole screen and a 45 degree perspective projection. It is described with the software rasterizer's types,
+// which need no Windows SDK; D3D translates them into its state objects.
+namespace RenderState
+{
+	SoftwareRasterizer::DepthState DescribeDepthState();
+	SoftwareRasterizer::RasterState DescribeRasterState();
+	SoftwareRasterizer::Viewport DescribeViewport(uint screenWidth, uint screenHeight);
+
+	Math::Matrix4 CreateProjectionMatrix(uint screenWidth, uint screenHeight, float screenNear, float screenFar);
+	Math::Matrix4 CreateOrthoMatrix(uint screenWidth, uint screenHeight, float screenNear, float screenFar);
+}
@@ -0,0 +1,121 @@
+#include "RingAllocator.h"
+
+RingAllocator::RingAllocator(size_t capacity, size_t alignment)
+	: _capacity(capacity / alignment * alignment)
+	, _alignment(alignment)
+{
+}
+
+uint64_t RingAllocator::BeginFrame()
+{
+	_frame++;
+	_frameSize = 0u;
+	_stats.allocatedThisFrame = 0u;
+	_stats.allocationsThisFrame = 0u;
+	_stats.failedThisFrame = 0u;
+	return _frame;
+}
+
+void RingAllocator::EndFrame()
+{
+	// A frame that allocated nothing has nothing to release, so it is not tracked.
+	if (_frameSize > 0u)
+		_inFlight.push_back({ _frame, _head, _frameSize });
+
+	_frameSize = 0u;
+	_stats.framesInFlight = (uint)_inFlight.size();
+}
+
+void RingAllocator::Retire(uint64_t frame)
+{
+	while (!_inFlight.empty() && _inFlight.front().number <= frame)
+	{
+		const Frame& retired = _inFlight.front();
+		_tail = retired.end;
+		_stats.used -= retired.size;
+		_inFlight.pop_front();
+	}
+
+	// Once nothing is in use, start again from the beginning so the next frames do not have to wrap.
+	if (_stats.used == 0u)
+		_head = _tail = 0u;
+
+	_stats.framesInFlight = (uint)_inFlight.size();
+}
+
+void RingAllocator::Reset()
+{
+	_inFlight.clear();
+	_head = _tail = 0u;
+	_frameSize = 0u;
+	_stats.used = 0u;
+	_stats.framesInFlight = 0u;
+}
+
+size_t RingAllocator::Allocate(size_t size)
+{
+	size_t aligned = (size + _alignment - 1u) & ~(_alignment - 1u);
+	if (aligned == 0u)
+		aligned = _alignment;
+
+	// With the ring empty the head and tail sit at the start. Otherwise the free space either runs from the head to
+	// the end and then from the start to the tail, or, once the head has wrapped, lies between the head and the tail.
+	size_t offset = INVALID_OFFSET;
+	size_t reserved = aligned;
+	if (_stats.used == 0u)
+	{
+		if (aligned <= _capacity)
+			offset = 0u;
+	}
+	else if (_head > _tail)
+	{
+		if (_capacity - _head >= aligned)
+		{
+			offset = _head;
+		}
+		else if (_tail >= aligned)
+		{
+			// Skip the rest of the ring; the padding stays reserved until this frame is retired.
+			offset = 0u;
+			reserved += _capacity - _head;
+			_stats.wraps++;
+		}
+	}
+	else if (_tail - _head >= aligned)
+	{
+		offset = _head;
+	}
+
+	if (offset == INVALID_OFFSET)
+	{
+		_stats.failedThisFrame++;
+		return INVALID_OFFSET;
+	}
+
+	_head = offset + aligned;
+	_frameSize += reserved;
+	_stats.used += reserved;
+	_stats.allocatedThisFrame += aligned;
+	_stats.allocationsThisFrame++;
+	return offset;
+}
+
+size_t RingAllocator::GetCapacity() const
+{
+	return _capacity;
+}
+
+size_t RingAllocator::GetAlignment() const
+{
+	return _alignment;
+}
+
+uint64_t RingAllocator::GetCurrentFrame() const
+{
+	return _frame;
+}
+
+const RingAllocator::Stats& RingAllocator::GetStats() const
+{
+	return _stats;
+}
@@ -0,0 +1,68 @@
+#pragma once
+
+#include <deque>
+#include "Common.h"
+
+// Hands out aligned ranges of a fixed-size ring, frame by frame, for data the GPU reads a frame or two later.
+// Everything allocated during a frame stays reserved until the caller retires that frame, normally once a fence
+// issued after the frame's draws has signalled, so memory the GPU may still be reading is never handed out again.
+// Allocation never blocks: when the ring is full it fails, and the caller decides whether to wait or fall back.
+//
+// The allocator only does the bookkeeping; it has no Direct3D dependency. ConstantBufferRing maps it onto a buffer.
+class RingAllocator
+{
+public:
+
+	static const size_t INVALID_OFFSET = ~(size_t)0;
+
+	struct Stats
+	{
+		size_t used = 0u;					// Bytes reserved by frames that have not been retired, including padding lost to wrapping.
+		size_t allocatedThisFrame = 0u;
+		uint allocationsThisFrame = 0u;
+		uint failedThisFrame = 0u;
+		uint wraps = 0u;
+		uint framesInFlight = 0u;
+	};
+
+	// The capacity is rounded down to a multiple of the alignment, which must be a power of two.
+	RingAllocator(size_t capacity, size_t alignment);
+
+	// Starts a frame and returns its number, counting from 1. Allocations made before the first BeginFrame belong to frame 0.
+	uint64_t BeginFrame();
+
+	// Closes the current frame; its allocations are released by Retire.
+	void EndFrame();
+
+	// Releases every frame up to and including this one. Frames that have not ended yet are kept.
+	void Retire(uint64_t frame);
+
+	// Forgets every allocation, for when the memory behind the ring has been replaced as a whole.
+	void Reset();
+
+	// Returns the aligned offset of a range of size bytes, or INVALID_OFFSET if the ring has no room left.
+	size_t Allocate(size_t size);
+
+	size_t GetCapacity() const;
+	size_t GetAlignment() const;
+	uint64_t GetCurrentFrame() const;
+	const Stats& GetStats() const;
+
+private:
+
+	struct Frame
+	{
+		uint64_t number;
+		size_t end;		// Head of the ring when the frame ended.
+		size_t size;	// Bytes the frame reserved, including wrap padding.
+	};
+
+	size_t _capacity = 0u;
+	size_t _alignment = 0u;
+	size_t _head = 0u;	// Where the next allocation starts.
+	size_t _tail = 0u;	// Start of the oldest range still in use.
+	size_t _frameSize = 0u;
+	uint64_t _frame = 0u;
+	std::deque<Frame> _inFlight; // Ended but not retired, oldest first.
+	Stats _stats;
+};
@@ -0,0 +1,202 @@
+#include "Scene.h"
+#include "JobSystem.h"
+
+#include <algorithm>
+#include <chrono>
+#include <functional>
+
+namespace
+{
+	// Nodes are handed to threads in batches of this size; smaller depths are updated on one thread.
+	const uint NODES_PER_TASK = 4096u;
+
+	void ParallelNodes(uint nodeCount, uint threadCount, const std::function<void(uint, uint)>& function)
+	{
+		uint taskCount = (nodeCount + NODES_PER_TASK - 1u) / NODES_PER_TASK;
+		threadCount = std::min(threadCount, taskCount);
+		if (threadCount <= 1u)
+		{
+			function(0u, nodeCount);
+			return;
+		}
+
+		JobSystem::GetDefault().ParallelFor(taskCount, threadCount, [&](uint task)
+		{
+			function(task * NODES_PER_TASK, std::min(nodeCount, (task + 1u) * NODES_PER_TASK));
+		});
+	}
+}
+
+Scene::Node Scene::Create(Node parent, const Math::Matrix4& localMatrix)
+{
+	Node node = (Node)_parents.size();
+	_parents.push_back(parent);
+	_depths.push_back(parent == INVALID_NODE ? 0u : _depths[parent] + 1u);
+
+	_localMatrices.push_back(localMatrix);
+	_worldMatrices.push_back(localMatrix);
+
+	_dirty.push_back(1u);
+	_dirtyCount++;
+	return node;
+}
+
+void Scene::Reserve(uint nodeCount)
+{
+	_parents.reserve(nodeCount);
+	_depths.reserve(nodeCount);
+	_localMatrices.reserve(nodeCount);
+	_worldMatrices.reserve(nodeCount);
+	_dirty.reserve(nodeCount);
+}
+
+void Scene::Clear()
+{
+	_parents.clear();
+	_depths.clear();
+	_localMatrices.clear();
+	_worldMatrices.clear();
+	_dirty.clear();
+	_dirtyCount = 0u;
+}
+
+void Scene::SetLocalMatrix(Node node, const Math::Matrix4& localMatrix)
+{
+	_localMatrices[node] = localMatrix;
+	if (!_dirty[node])
+	{
+		_dirty[node] = 1u;
+		_dirtyCount++;
+	}
+}
+
+Math::Matrix4 Scene::GetLocalMatrix(Node node) const
+{
+	return _localMatrices[node];
+}
+
+Math::Matrix4 Scene::GetWorldMatrix(Node node) const
+{
+	return _worldMatrices[node];
+}
+
+Scene::Node Scene::GetParent(Node node) const
+{
+	return _parents[node];
+}
+
+uint Scene::GetNodeCount() const
+{
+	return (uint)_parents.size();
+}
+
+void Scene::Update(uint threadCount)
+{
+	auto start = std::chrono::steady_clock::now();
+	_stats = Stats();
+	_stats.nodes = GetNodeCount();
+
+	if (_dirtyCount > 0u)
+	{
+		if (threadCount == 0u)
+			threadCount = JobSystem::GetDefault().GetThreadCount();
+
+		// Below a task's worth of nodes the threads cost more than they save.
+		if (threadCount == 1u || GetNodeCount() < NODES_PER_TASK * 2u)
+			UpdateSerial();
+		else
+			UpdateByLevel(threadCount);
+
+		_dirtyCount = 0u;
+	}
+
+	_stats.updateMilliseconds = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+}
+
+void Scene::UpdateSerial()
+{
+	// Parents come first, so a parent's flag and world matrix are final by the time its children are reached.
+	uint nodeCount = GetNodeCount();
+	for (Node node = 0u; node < nodeCount; ++node)
+	{
+		Node parent = _parents[node];
+		if (parent != INVALID_NODE && _dirty[parent])
+			_dirty[node] = 1u;
+		if (!_dirty[node])
+			continue;
+
+		Math::Matrix4 world = _localMatrices[node];
+		if (parent != INVALID_NODE)
+			world = Math::Multiply(world, _worldMatrices[parent]);
+		_worldMatrices[node] = world;
+		_stats.updatedNodes++;
+	}
+
+	std::fill(_dirty.begin(), _dirty.end(), (uchar)0u);
+}
+
+void Scene::UpdateByLevel(uint threadCount)
+{
+	uint nodeCount = GetNodeCount();
+
+	// Spread the flags down the hierarchy and count the dirty nodes of every depth.
+	_levelStarts.clear();
+	for (Node node = 0u; node < nodeCount; ++node)
+	{
+		Node parent = _parents[node];
+		if (parent != INVALID_NODE && _dirty[parent])
+			_dirty[node] = 1u;
+		if (!_dirty[node])
+			continue;
+
+		uint depth = _depths[node];
+		if (depth + 2u > _levelStarts.size())
+			_levelStarts.resize(depth + 2u, 0u);
+		_levelStarts[depth + 1u]++;
+	}
+
+	// Turn the counts into the start of each depth and sort the dirty nodes into place, keeping them in index order
+	// within a depth so every thread walks memory forwards.
+	for (size_t level = 1u; level < _levelStarts.size(); ++level)
+		_levelStarts[level] += _levelStarts[level - 1u];
+
+	uint dirtyNodeCount = _levelStarts.empty() ? 0u : _levelStarts.back();
+	_levelNodes.resize(dirtyNodeCount);
+	std::vector<uint> next(_levelStarts.begin(), _levelStarts.end());
+	for (Node node = 0u; node < nodeCount; ++node)
+	{
+		if (_dirty[node])
+			_levelNodes[next[_depths[node]]++] = node;
+	}
+
+	// Every parent is one depth up and already done, so the nodes of one depth can be updated in any order.
+	for (size_t level = 0u; level + 1u < _levelStarts.size(); ++level)
+	{
+		uint levelStart = _levelStarts[level];
+		uint levelSize = _levelStarts[level + 1u] - levelStart;
+		if (levelSize > NODES_PER_TASK)
+			_stats.parallelLevels++;
+
+		ParallelNodes(levelSize, threadCount, [&](uint begin, uint end)
+		{
+			for (uint i = levelStart + begin; i < levelStart + end; ++i)
+			{
+				Node node = _levelNodes[i];
+				Node parent = _parents[node];
+
+				Math::Matrix4 world = _localMatrices[node];
+				if (parent != INVALID_NODE)
+					world = Math::Multiply(world, _worldMatrices[parent]);
+				_worldMatrices[node] = world;
+			}
+		});
+	}
+
+	_stats.updatedNodes = dirtyNodeCount;
+	std::fill(_dirty.begin(), _dirty.end(), (uchar)0u);
+}
+
+const Scene::Stats& Scene::GetStats() const
+{
+	return _stats;
+}
@@ -0,0 +1,69 @@
+#pragma once
+
+#include "Common.h"
+#include "EngineMath.h"
+
+// Transform hierarchy for many objects. Nodes are stored as structure of arrays (parents, depths, local and world
+// matrices and dirty flags in separate arrays) indexed by node, and a node's parent always comes before it, so the
+// world matrices can be brought up to date in one forward pass without recursion.
+//
+// Setting a local matrix only marks the node dirty; Update recomputes the world matrices of the dirty nodes and
+// everything below them, and leaves the rest of the scene untouched. With more than one thread, dirty nodes are
+// grouped by depth and each large enough depth is split between the threads, since nodes of the same depth never
+// depend on each other.
+//
+// The scene has no Direct3D dependency. Not thread-safe.
+class Scene
+{
+public:
+
+	using Node = uint;
+	static const Node INVALID_NODE = ~0u;
+
+	struct Stats
+	{
+		uint nodes = 0u;
+		uint updatedNodes = 0u;		// World matrices recomputed by the last Update.
+		uint parallelLevels = 0u;	// Depths of the hierarchy the last Update split between threads.
+		double updateMilliseconds = 0.0;
+	};
+
+	// Creates a node under parent, or a root for INVALID_NODE. Its world matrix is valid after the next Update.
+	Node Create(Node parent, const Math::Matrix4& localMatrix);
+
+	void Reserve(uint nodeCount);
+	void Clear();
+
+	void SetLocalMatrix(Node node, const Math::Matrix4& localMatrix);
+	Math::Matrix4 GetLocalMatrix(Node node) const;
+
+	// The world matrix as of the last Update.
+	Math::Matrix4 GetWorldMatrix(Node node) const;
+
+	Node GetParent(Node node) const;
+	uint GetNodeCount() const;
+
+	// Recomputes the world matrices of the dirty subtrees. threadCount 0 uses every thread of the job system.
+	void Update(uint threadCount = 0u);
+
+	// Counts for the last Update.
+	const Stats& GetStats() const;
+
+private:
+
+	void UpdateSerial();
+	void UpdateByLevel(uint threadCount);
+
+	std::vector<Node> _parents;
+	std::vector<uint> _depths;
+	std::vector<Math::Matrix4> _localMatrices;
+	std::vector<Math::Matrix4> _worldMatrices;
+	std::vector<uchar> _dirty;
+	uint _dirtyCount = 0u;
+
+	// Scratch space of UpdateByLevel: the dirty nodes sorted by depth, and where each depth starts.
+	std::vector<Node> _levelNodes;
+	std::vector<uint> _levelStarts;
+
+	Stats _stats;
+};
@@ -0,0 +1,91 @@
+#include "SceneBenchmark.h"
+#include "Scene.h"
+#include "JobSystem.h"
+
+namespace
+{
+	const uint NODE_COUNTS[] = { 10000u, 100000u, 1000000u };
+	const uint DEEP_CHAIN_LENGTH = 64u;		// Depth of every chain in the deep hierarchy.
+	const uint PARTIAL_DIRTY_STRIDE = 100u;	// Every this many nodes is moved in the partial update.
+	const uint REPETITIONS = 10u;
+
+	// One root with every other node directly below it, like a level full of props.
+	void BuildFlat(Scene& scene, uint nodeCount)
+	{
+		Scene::Node root = scene.Create(Scene::INVALID_NODE, Math::Identity());
+		for (uint i = 1u; i < nodeCount; ++i)
+			scene.Create(root, Math::Translation((float)(i % 1000u), 0.0f, (float)(i / 1000u)));
+	}
+
+	// Chains of DEEP_CHAIN_LENGTH nodes under one root, like skeletons. Chains are created one depth at a time,
+	// so siblings sit next to each other in memory.
+	void BuildDeep(Scene& scene, uint nodeCount)
+	{
+		Scene::Node root = scene.Create(Scene::INVALID_NODE, Math::Identity());
+		uint chainCount = (nodeCount - 1u) / DEEP_CHAIN_LENGTH;
+		std::vector<Scene::Node> tips(chainCount, root);
+		for (uint depth = 0u; depth < DEEP_CHAIN_LENGTH; ++depth)
+		{
+			for (Scene::Node& tip : tips)
+				tip = scene.Create(tip, Math::Multiply(Math::Rotation(Math::RotationAxis(Math::Float3(0.0f, 0.0f, 1.0f), 0.01f)), Math::Translation(0.0f, 1.0f, 0.0f)));
+		}
+		while (scene.GetNodeCount() < nodeCount)
+			scene.Create(root, Math::Identity());
+	}
+
+	// Average milliseconds of Update after dirty() has marked some nodes.
+	template <typename Dirty>
+	double Measure(Scene& scene, uint threadCount, Dirty dirty)
+	{
+		double total = 0.0;
+		for (uint i = 0u; i < REPETITIONS; ++i)
+		{
+			dirty(scene, i);
+			scene.Update(threadCount);
+			total += scene.GetStats().updateMilliseconds;
+		}
+		return total / REPETITIONS;
+	}
+}
+
+void RunSceneBenchmark(std::ostream& output)
+{
+	uint threadCount = JobSystem::GetDefault().GetThreadCount();
+
+	output << std::format("Scene update, average of {} runs, 1 and {} threads", REPETITIONS, threadCount) << std::endl;
+
+	for (bool deep : { false, true })
+	{
+		for (uint nodeCount : NODE_COUNTS)
+		{
+			Scene scene;
+			scene.Reserve(nodeCount);
+			if (deep)
+				BuildDeep(scene, nodeCount);
+			else
+				BuildFlat(scene, nodeCount);
+			scene.Update(1u);
+
+			// Moving the root dirties everything; moving scattered nodes dirties only their subtrees.
+			auto moveRoot = [](Scene& scene, uint i)
+			{
+				scene.SetLocalMatrix(0u, Math::Translation((float)i, 0.0f, 0.0f));
+			};
+			auto moveScattered = [](Scene& scene, uint i)
+			{
+				for (Scene::Node node = 1u + i; node < scene.GetNodeCount(); node += PARTIAL_DIRTY_STRIDE)
+					scene.SetLocalMatrix(node, scene.GetLocalMatrix(node));
+			};
+
+			double allSerial = Measure(scene, 1u, moveRoot);
+			double allParallel = Measure(scene, threadCount, moveRoot);
+			double partialSerial = Measure(scene, 1u, moveScattered);
+			uint partialUpdated = scene.GetStats().updatedNodes;
+			double partialParallel = Measure(scene, threadCount, moveScattered);
+
+			output << std::format("{:>4} {:>8} nodes: all dirty {:8.3f} ms / {:8.3f} ms ({:.1f} ns/node), {:>7} dirty {:8.3f} ms / {:8.3f} ms",
+				deep ? "deep" : "flat", nodeCount, allSerial, allParallel, allSerial * 1000000.0 / nodeCount, partialUpdated,
+				partialSerial, partialParallel) << std::endl;
+		}
+	}
+}
@@ -0,0 +1,8 @@
+#pragma once
+
+#include <ostream>
+#include "Common.h"
+
+// Measures Scene::Update on flat and deep hierarchies of 10k to 1M nodes, on one thread and on every hardware
+// thread, with the whole scene dirty and with a few scattered nodes dirty. Run with "Engine.exe -benchmark-scene".
+void RunSceneBenchmark(std::ostream& output);
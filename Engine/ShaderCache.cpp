@@ -0,0 +1,344 @@
+#include "ShaderCache.h"
+#include "AssetArchive.h"
+#include "Profiler.h"
+
+#include <algorithm>
+#include <filesystem>
+#include <iterator>
+#include <string.h>
+
+namespace
+{
+	const char MAGIC[4] = { 'S', 'H', 'D', 'C' };
+	const uint32_t VERSION = 1u;
+
+	uint64_t AlignUp(uint64_t value, uint64_t alignment)
+	{
+		return (value + alignment - 1u) / alignment * alignment;
+	}
+
+	double MillisecondsSince(std::chrono::steady_clock::time_point start)
+	{
+		return std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+	}
+
+	// Reads the name out of an #include "name" or #include <name> line.
+	bool ParseInclude(const std::string& text, size_t position, size_t end, std::string& name)
+	{
+		auto skipSpaces = [&]() { while (position < end && (text[position] == ' ' || text[position] == '\t')) position++; };
+
+		skipSpaces();
+		if (position == end || text[position] != '#')
+			return false;
+		position++;
+		skipSpaces();
+		if (text.compare(position, 7u, "include") != 0)
+			return false;
+		position += 7u;
+		skipSpaces();
+		if (position == end || (text[position] != '"' && text[position] != '<'))
+			return false;
+
+		char close = text[position] == '"' ? '"' : '>';
+		size_t nameEnd = text.find(close, position + 1u);
+		if (nameEnd == std::string::npos || nameEnd > end)
+			return false;
+
+		name = text.substr(position + 1u, nameEnd - position - 1u);
+		return true;
+	}
+
+	// Appends the file and, recursively, every file it includes. Includes are resolved next to the including file,
+	// as D3D_COMPILE_STANDARD_FILE_INCLUDE does, and each file is read once.
+	bool AppendSource(const std::filesystem::path& path, std::string& text, std::set<std::filesystem::path>& visited)
+	{
+		if (!visited.insert(path.lexically_normal()).second)
+			return true;
+
+		std::ifstream file(path, std::ios::binary);
+		if (!file)
+			return false;
+
+		std::string contents((std::istreambuf_iterator<char>(file)), std::istreambuf_iterator<char>());
+		text += contents;
+		text += '\0';
+
+		for (size_t lineStart = 0u; lineStart < contents.size(); )
+		{
+			size_t lineEnd = contents.find('\n', lineStart);
+			if (lineEnd == std::string::npos)
+				lineEnd = contents.size();
+
+			// A missing include is left for the compiler to report.
+			std::string name;
+			if (ParseInclude(contents, lineStart, lineEnd, name))
+				AppendSource(path.parent_path() / name, text, visited);
+
+			lineStart = lineEnd + 1u;
+		}
+		return true;
+	}
+
+	void AppendRequest(const ShaderCache::Request& request, std::string& text)
+	{
+		text += request.entryPoint;
+		text += '\0';
+		text += request.profile;
+		text += '\0';
+		text.append((const char*)&request.flags, sizeof(request.flags));
+	}
+}
+
+double ShaderCache::Stats::GetHitRate() const
+{
+	uint total = hits + misses;
+	return total > 0u ? (double)hits / total : 0.0;
+}
+
+ShaderCache::ShaderCache(const char* filename, Compiler compiler)
+	: _filename(filename)
+	, _compiler(std::move(compiler))
+	, _file(std::make_unique<MappedFile>(filename))
+{
+	if (!_file->IsValid() || !ReadTable())
+		_file.reset();
+}
+
+bool ShaderCache::ReadTable()
+{
+	const uchar* data = _file->GetData();
+	size_t size = _file->GetSize();
+	if (size < sizeof(Header))
+		return false;
+
+	const Header* header = (const Header*)data;
+	if (memcmp(header->magic, MAGIC, sizeof(MAGIC)) != 0 || header->version != VERSION)
+		return false;
+
+	// Every entry and blob has to lie inside the file before anything is handed out.
+	uint64_t tableSize = (uint64_t)header->entryCount * sizeof(Entry);
+	if (tableSize > size - sizeof(Header))
+		return false;
+
+	const Entry* entries = (const Entry*)(data + sizeof(Header));
+	for (uint i = 0u; i < header->entryCount; ++i)
+	{
+		const Entry& entry = entries[i];
+		if (entry.offset > size || entry.size > size - entry.offset)
+			return false;
+		if (i > 0u && entries[i - 1u].key >= entry.key)
+			return false;
+	}
+
+	_entries = entries;
+	_entryCount = header->entryCount;
+	return true;
+}
+
+const ShaderCache::Entry* ShaderCache::FindEntry(uint64_t key) const
+{
+	if (!_file)
+		return nullptr;
+
+	const Entry* end = _entries + _entryCount;
+	const Entry* entry = std::lower_bound(_entries, end, key, [](const Entry& entry, uint64_t key) { return entry.key < key; });
+	if (entry == end || entry->key != key)
+		return nullptr;
+
+	return entry;
+}
+
+ShaderCache::Bytecode ShaderCache::Get(const Request& request, std::string& error)
+{
+	PROFILE_SCOPE("ShaderCache::Get");
+	Bytecode bytecode;
+	auto start = std::chrono::steady_clock::now();
+
+	uint64_t key;
+	if (!ComputeKey(request, key, error))
+		return bytecode;
+
+	uint64_t requestHash = HashRequest(request);
+	_usedKeys.insert(key);
+	_usedRequests.insert(requestHash);
+
+	// Look in what was compiled this run first, then in the mapped file.
+	uint32_t compileMicroseconds = 0u;
+	auto compiled = _compiled.find(key);
+	if (compiled != _compiled.end())
+	{
+		bytecode.data = compiled->second.bytecode.data();
+		bytecode.size = compiled->second.bytecode.size();
+		compileMicroseconds = compiled->second.compileMicroseconds;
+	}
+	else if (const Entry* entry = FindEntry(key))
+	{
+		// A damaged blob is treated as a miss and compiled again.
+		const uchar* data = _file->GetData() + entry->offset;
+		if (AssetArchive::Hash(data, (size_t)entry->size) == entry->contentHash)
+		{
+			bytecode.data = data;
+			bytecode.size = (size_t)entry->size;
+			compileMicroseconds = entry->compileMicroseconds;
+		}
+	}
+
+	if (bytecode.data)
+	{
+		_stats.hits++;
+		_stats.savedMilliseconds += compileMicroseconds / 1000.0 - MillisecondsSince(start);
+		return bytecode;
+	}
+
+	// Compile on a miss and keep the result for Save.
+	_stats.misses++;
+	Compiled result;
+	auto compileStart = std::chrono::steady_clock::now();
+	{
+		PROFILE_SCOPE("ShaderCache::Compile");
+		if (!_compiler(request, result.bytecode, error))
+			return bytecode;
+	}
+	if (result.bytecode.empty())
+	{
+		error = std::format("Compiling {} produced no bytecode", request.filename);
+		return bytecode;
+	}
+
+	double compileMilliseconds = MillisecondsSince(compileStart);
+	_stats.compileMilliseconds += compileMilliseconds;
+	result.requestHash = requestHash;
+	result.compileMicroseconds = (uint32_t)(compileMilliseconds * 1000.0);
+
+	Compiled& stored = _compiled[key] = std::move(result);
+	_dirty = true;
+
+	bytecode.data = stored.bytecode.data();
+	bytecode.size = stored.bytecode.size();
+	return bytecode;
+}
+
+bool ShaderCache::Save()
+{
+	if (!_dirty)
+		return true;
+
+	// Copy the mapped entries out first, since the file cannot be replaced while it is mapped.
+	for (uint i = 0u; i < _entryCount && _file; ++i)
+	{
+		const Entry& entry = _entries[i];
+		if (_compiled.count(entry.key) != 0u)
+			continue;
+
+		// Drop blobs that a newer compile of the same request has replaced, and any that were damaged.
+		if (_usedRequests.count(entry.requestHash) != 0u && _usedKeys.count(entry.key) == 0u)
+			continue;
+		const uchar* data = _file->GetData() + entry.offset;
+		if (AssetArchive::Hash(data, (size_t)entry.size) != entry.contentHash)
+			continue;
+
+		Compiled copy;
+		copy.bytecode.assign(data, data + entry.size);
+		copy.requestHash = entry.requestHash;
+		copy.compileMicroseconds = entry.compileMicroseconds;
+		_compiled.emplace(entry.key, std::move(copy));
+	}
+
+	_file.reset();
+	_entries = nullptr;
+	_entryCount = 0u;
+
+	// Lay out the header and table, then give every blob an aligned slot. The map is already sorted by key.
+	Header header;
+	memcpy(header.magic, MAGIC, sizeof(MAGIC));
+	header.version = VERSION;
+	header.entryCount = (uint32_t)_compiled.size();
+	header.reserved = 0u;
+
+	std::vector<Entry> entries;
+	entries.reserve(_compiled.size());
+	uint64_t offset = AlignUp(sizeof(Header) + _compiled.size() * sizeof(Entry), BLOB_ALIGNMENT);
+	for (const auto& [key, compiled] : _compiled)
+	{
+		Entry entry;
+		entry.key = key;
+		entry.requestHash = compiled.requestHash;
+		entry.offset = offset;
+		entry.size = compiled.bytecode.size();
+		entry.contentHash = AssetArchive::Hash(compiled.bytecode.data(), compiled.bytecode.size());
+		entry.compileMicroseconds = compiled.compileMicroseconds;
+		entry.reserved = 0u;
+		entries.push_back(entry);
+		offset = AlignUp(offset + entry.size, BLOB_ALIGNMENT);
+	}
+
+	// Write next to the cache and swap it in, so a crash while saving never leaves a half-written cache behind.
+	std::string temporary = _filename + ".tmp";
+	{
+		std::ofstream output(temporary, std::ios::binary);
+		if (!output)
+			return false;
+
+		output.write((const char*)&header, sizeof(header));
+		output.write((const char*)entries.data(), (std::streamsize)(entries.size() * sizeof(Entry)));
+
+		const char padding[BLOB_ALIGNMENT] = {};
+		uint64_t position = sizeof(Header) + entries.size() * sizeof(Entry);
+		for (const Entry& entry : entries)
+		{
+			output.write(padding, (std::streamsize)(entry.offset - position));
+			const std::vector<uchar>& bytecode = _compiled[entry.key].bytecode;
+			output.write((const char*)bytecode.data(), (std::streamsize)bytecode.size());
+			position = entry.offset + entry.size;
+		}
+		if (!output)
+			return false;
+	}
+
+	std::error_code error;
+	std::filesystem::rename(temporary, _filename, error);
+	if (error)
+		return false;
+
+	_dirty = false;
+	return true;
+}
+
+uint ShaderCache::GetEntryCount() const
+{
+	uint count = _entryCount;
+	for (const auto& [key, compiled] : _compiled)
+	{
+		if (!FindEntry(key))
+			count++;
+	}
+	return count;
+}
+
+const ShaderCache::Stats& ShaderCache::GetStats() const
+{
+	return _stats;
+}
+
+bool ShaderCache::ComputeKey(const Request& request, uint64_t& key, std::string& error)
+{
+	std::string text;
+	std::set<std::filesystem::path> visited;
+	if (!AppendSource(request.filename, text, visited))
+	{
+		error = std::format("Missing shader file {}", request.filename);
+		return false;
+	}
+
+	AppendRequest(request, text);
+	key = AssetArchive::Hash((const uchar*)text.data(), text.size());
+	return true;
+}
+
+uint64_t ShaderCache::HashRequest(const Request& request)
+{
+	std::string text = request.filename;
+	text += '\0';
+	AppendRequest(request, text);
+	return AssetArchive::Hash((const uchar*)text.data(), text.size());
+}
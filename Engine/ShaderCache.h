@@ -0,0 +1,118 @@
+#pragma once
+
+#include <chrono>
+#include <functional>
+#include <set>
+#include "Common.h"
+#include "MappedFile.h"
+
+// Content-addressed cache of compiled shader bytecode, so startup only pays for the compiler when a shader changed.
+//
+// The key hashes the source file together with every file it includes, the entry point, the profile and the compile
+// flags. Editing any of them gives a new key, so a stale blob is never returned. The cache lives in a single file
+// that is memory-mapped on load: a header, a table of entries sorted by key, then the blobs. Hits are handed out as
+// pointers into the mapping; misses run the compiler and are kept in memory until Save writes a new file.
+//
+// The compiler is passed in, so the cache itself has no Direct3D dependency. Not thread-safe.
+class ShaderCache
+{
+public:
+
+	static const uint BLOB_ALIGNMENT = 16u;
+
+	struct Request
+	{
+		const char* filename = nullptr;
+		const char* entryPoint = nullptr;
+		const char* profile = nullptr;
+		uint flags = 0u;
+	};
+
+	struct Bytecode
+	{
+		const uchar* data = nullptr;	// Null when the shader could not be compiled.
+		size_t size = 0u;
+	};
+
+	struct Stats
+	{
+		uint hits = 0u;
+		uint misses = 0u;
+		double compileMilliseconds = 0.0;	// Spent in the compiler on misses.
+		double savedMilliseconds = 0.0;		// What the hits took to compile when they were stored, less the time spent looking them up.
+
+		double GetHitRate() const;
+	};
+
+	// Compiles request.filename. On failure returns false and fills error with the compiler's output.
+	using Compiler = std::function<bool(const Request& request, std::vector<uchar>& bytecode, std::string& error)>;
+
+	// Maps the cache file. A missing, outdated or damaged file is ignored and replaced on the next Save.
+	ShaderCache(const char* filename, Compiler compiler);
+
+	ShaderCache(const ShaderCache&) = delete;
+	ShaderCache& operator=(const ShaderCache&) = delete;
+
+	// Returns the bytecode for the request, compiling it on a miss. On failure the data is null and error holds the reason.
+	// The bytecode stays valid until the next Save, or for as long as the cache lives if it was compiled this run.
+	Bytecode Get(const Request& request, std::string& error);
+
+	// Writes every entry to the cache file if anything was compiled since it was loaded. Entries superseded by a
+	// newer compile of the same request are dropped.
+	bool Save();
+
+	uint GetEntryCount() const;
+	const Stats& GetStats() const;
+
+	// Hashes the request's source text, its includes, the entry point, profile and flags. Returns false if the source cannot be read.
+	static bool ComputeKey(const Request& request, uint64_t& key, std::string& error);
+
+private:
+
+	struct Header
+	{
+		char magic[4];
+		uint32_t version;
+		uint32_t entryCount;
+		uint32_t reserved;
+	};
+
+	struct Entry
+	{
+		uint64_t key;
+		uint64_t requestHash;	// Hash of the file name, entry point, profile and flags, without the source.
+		uint64_t offset;
+		uint64_t size;
+		uint64_t contentHash;
+		uint32_t compileMicroseconds;
+		uint32_t reserved;
+	};
+
+	struct Compiled
+	{
+		std::vector<uchar> bytecode;
+		uint64_t requestHash = 0u;
+		uint32_t compileMicroseconds = 0u;
+	};
+
+	bool ReadTable();
+	const Entry* FindEntry(uint64_t key) const;
+	static uint64_t HashRequest(const Request& request);
+
+	std::string _filename;
+	Compiler _compiler;
+
+	std::unique_ptr<MappedFile> _file;
+	const Entry* _entries = nullptr;
+	uint _entryCount = 0u;
+
+	// Compiled this run, or copied out of the mapping by Save.
+	std::map<uint64_t, Compiled> _compiled;
+	bool _dirty = false;
+
+	// What this run asked for, so Save can drop the entries they replace.
+	std::set<uint64_t> _usedKeys;
+	std::set<uint64_t> _usedRequests;
+
+	Stats _stats;
+};
@@ -0,0 +1,245 @@
+#include "ShaderCacheCheck.h"
+#include "ShaderCache.h"
+
+#include <filesystem>
+#include <random>
+#include <string.h>
+
+namespace
+{
+	const uint RANDOM_SEED = 99u;
+	const uint STUB_FLAGS = 1u;
+	const char* const FAILING_ENTRY_POINT = "Broken";
+
+	// Where ShaderCache keeps its table: a 16-byte header, then 48-byte entries with the blob offset 16 bytes in.
+	const size_t HEADER_SIZE = 16u;
+	const size_t ENTRY_SIZE = 48u;
+	const size_t ENTRY_OFFSET_FIELD = 16u;
+
+	// Stands in for the HLSL compiler. The bytecode is made from the request's key, so a blob built from stale
+	// sources comes back as the wrong bytes, and every call is counted.
+	struct StubCompiler
+	{
+		uint calls = 0u;
+
+		static std::vector<uchar> Expected(const ShaderCache::Request& request)
+		{
+			uint64_t key = 0u;
+			std::string error;
+			if (!ShaderCache::ComputeKey(request, key, error))
+				return std::vector<uchar>();
+
+			std::vector<uchar> bytecode(64u + (size_t)(key % 64u));
+			for (size_t i = 0u; i < bytecode.size(); ++i)
+				bytecode[i] = (uchar)((key >> (i % 8u * 8u)) ^ i);
+			return bytecode;
+		}
+
+		bool Compile(const ShaderCache::Request& request, std::vector<uchar>& bytecode, std::string& error)
+		{
+			calls++;
+			if (strcmp(request.entryPoint, FAILING_ENTRY_POINT) == 0)
+			{
+				error = std::format("{}: stub compiler error", request.filename);
+				return false;
+			}
+			bytecode = Expected(request);
+			return true;
+		}
+	};
+
+	// What one run of the engine saw: it opens the cache, gets every request once and saves.
+	struct Load
+	{
+		bool correct = true;	// Every request returned the bytecode of its current sources.
+		uint hits = 0u;
+		uint misses = 0u;
+		uint compiles = 0u;
+		uint entries = 0u;		// In the cache after the requests, before saving.
+		bool saved = false;
+	};
+
+	Load LoadAll(const std::filesystem::path& cacheFile, const std::vector<ShaderCache::Request>& requests, StubCompiler& stub)
+	{
+		Load load;
+		uint callsBefore = stub.calls;
+		ShaderCache cache(cacheFile.string().c_str(), [&stub](const ShaderCache::Request& request, std::vector<uchar>& bytecode, std::string& error)
+		{
+			return stub.Compile(request, bytecode, error);
+		});
+
+		for (const ShaderCache::Request& request : requests)
+		{
+			std::string error;
+			ShaderCache::Bytecode bytecode = cache.Get(request, error);
+			std::vector<uchar> expected = StubCompiler::Expected(request);
+			load.correct = load.correct && bytecode.data && bytecode.size == expected.size() && memcmp(bytecode.data, expected.data(), expected.size()) == 0;
+		}
+
+		load.hits = cache.GetStats().hits;
+		load.misses = cache.GetStats().misses;
+		load.compiles = stub.calls - callsBefore;
+		load.entries = cache.GetEntryCount();
+		load.saved = cache.Save();
+		return load;
+	}
+
+	bool WriteText(const std::filesystem::path& path, const std::string& text)
+	{
+		std::ofstream file(path, std::ios::binary | std::ios::trunc);
+		file.write(text.data(), (std::streamsize)text.size());
+		return (bool)file;
+	}
+
+	bool WriteBytes(const std::filesystem::path& path, const std::vector<uchar>& bytes, size_t size)
+	{
+		std::ofstream file(path, std::ios::binary | std::ios::trunc);
+		file.write((const char*)bytes.data(), (std::streamsize)size);
+		return (bool)file;
+	}
+
+	std::vector<uchar> ReadBytes(const std::filesystem::path& path)
+	{
+		std::ifstream file(path, std::ios::binary);
+		return std::vector<uchar>((std::istreambuf_iterator<char>(file)), std::istreambuf_iterator<char>());
+	}
+
+	bool Report(std::ostream& output, const char* name, bool match)
+	{
+		output << std::format("{}: {}", name, match ? "OK" : "MISMATCH") << std::endl;
+		return match;
+	}
+}
+
+bool RunShaderCacheCheck(std::ostream& output)
+{
+	namespace fs = std::filesystem;
+
+	std::error_code error;
+	fs::path directory = fs::temp_directory_path(error) / "shader-cache-check";
+	fs::remove_all(directory, error);
+	fs::create_directories(directory / "detail", error);
+
+	// main.hlsl includes common.hlsli, which includes detail/nested.hlsli relative to itself; other.hlsl stands alone.
+	fs::path main = directory / "main.hlsl";
+	fs::path common = directory / "common.hlsli";
+	fs::path nested = directory / "detail" / "nested.hlsli";
+	fs::path other = directory / "other.hlsl";
+	fs::path cacheFile = directory / "shaders.cache";
+	bool written = WriteText(main, "#include \"common.hlsli\"\nfloat4 VertexMain() : SV_Position { return Offset(); }\nfloat4 PixelMain() : SV_Target { return 1; }\n") &&
+		WriteText(common, "  #  include \"detail/nested.hlsli\"\nfloat4 Offset() { return Nested(); }\n") &&
+		WriteText(nested, "float4 Nested() { return 0; }\n") &&
+		WriteText(other, "float4 PixelMain() : SV_Target { return 0.5; }\n");
+	if (!written)
+	{
+		output << std::format("Could not write the shaders to {}", directory.string()) << std::endl;
+		return false;
+	}
+
+	std::string mainName = main.string();
+	std::string otherName = other.string();
+	const std::vector<ShaderCache::Request> requests =
+	{
+		{ mainName.c_str(), "VertexMain", "vs_5_0", STUB_FLAGS },
+		{ mainName.c_str(), "PixelMain", "ps_5_0", STUB_FLAGS },
+		{ otherName.c_str(), "PixelMain", "ps_5_0", STUB_FLAGS },
+	};
+	const uint count = (uint)requests.size();
+
+	bool allMatch = true;
+	StubCompiler stub;
+
+	// A cold cache compiles everything once and writes the file; the next run compiles nothing.
+	Load first = LoadAll(cacheFile, requests, stub);
+	allMatch = Report(output, "First load misses and compiles every shader", first.correct && first.misses == count && first.hits == 0u &&
+		first.compiles == count && first.saved && fs::exists(cacheFile, error)) && allMatch;
+	Load second = LoadAll(cacheFile, requests, stub);
+	allMatch = Report(output, "Second load hits every shader without compiling", second.correct && second.hits == count && second.misses == 0u &&
+		second.compiles == 0u && second.entries == count) && allMatch;
+
+	// Editing a source rebuilds its shaders only, and the save drops the blobs they replace.
+	WriteText(main, "#include \"common.hlsli\"\nfloat4 VertexMain() : SV_Position { return Offset() * 2; }\nfloat4 PixelMain() : SV_Target { return 1; }\n");
+	Load editedSource = LoadAll(cacheFile, requests, stub);
+	Load afterSource = LoadAll(cacheFile, requests, stub);
+	allMatch = Report(output, "Editing the source rebuilds its two shaders and drops the stale blobs", editedSource.correct && editedSource.misses == 2u &&
+		editedSource.hits == 1u && editedSource.compiles == 2u && afterSource.correct && afterSource.hits == count && afterSource.entries == count) && allMatch;
+
+	// So does editing a file two includes down.
+	WriteText(nested, "float4 Nested() { return 0.25; }\n");
+	Load editedInclude = LoadAll(cacheFile, requests, stub);
+	Load afterInclude = LoadAll(cacheFile, requests, stub);
+	allMatch = Report(output, "Editing a nested include rebuilds the shaders that include it", editedInclude.correct && editedInclude.misses == 2u &&
+		editedInclude.hits == 1u && afterInclude.correct && afterInclude.hits == count && afterInclude.entries == count) && allMatch;
+
+	// Other flags or another profile are different shaders.
+	std::vector<ShaderCache::Request> variants = requests;
+	variants[0].flags = STUB_FLAGS | 2u;
+	variants[1].profile = "ps_5_1";
+	Load changedRequest = LoadAll(cacheFile, variants, stub);
+	Load afterRequest = LoadAll(cacheFile, requests, stub);
+	allMatch = Report(output, "Other flags or profile miss, and the original requests still hit", changedRequest.correct && changedRequest.misses == 2u &&
+		changedRequest.hits == 1u && afterRequest.correct && afterRequest.hits == count) && allMatch;
+
+	// Compiler errors and missing files are passed on and nothing is stored.
+	{
+		ShaderCache cache(cacheFile.string().c_str(), [&stub](const ShaderCache::Request& request, std::vector<uchar>& bytecode, std::string& error)
+		{
+			return stub.Compile(request, bytecode, error);
+		});
+		uint entries = cache.GetEntryCount();
+		std::string compileError, missingError;
+		ShaderCache::Bytecode broken = cache.Get({ mainName.c_str(), FAILING_ENTRY_POINT, "ps_5_0", STUB_FLAGS }, compileError);
+		std::string missingName = (directory / "missing.hlsl").string();
+		ShaderCache::Bytecode missing = cache.Get({ missingName.c_str(), "PixelMain", "ps_5_0", STUB_FLAGS }, missingError);
+		allMatch = Report(output, "Compiler errors and missing files return no bytecode and the reason", !broken.data && !missing.data &&
+			compileError.find("stub compiler error") != std::string::npos && missingError.find("missing.hlsl") != std::string::npos &&
+			cache.GetEntryCount() == entries) && allMatch;
+	}
+
+	// Damaged cache files, made from one that holds just the three shaders. Each must still give the right bytecode,
+	// and the save must replace it with a good one.
+	fs::remove(cacheFile, error);
+	LoadAll(cacheFile, requests, stub);
+	std::vector<uchar> good = ReadBytes(cacheFile);
+	auto recovers = [&](const std::vector<uchar>& damaged, size_t size, uint expectedMisses)
+	{
+		WriteBytes(cacheFile, damaged, size);
+		Load load = LoadAll(cacheFile, requests, stub);
+		Load after = LoadAll(cacheFile, requests, stub);
+		return load.correct && load.misses == expectedMisses && load.hits + load.misses == count && load.saved && after.correct && after.hits == count;
+	};
+
+	bool truncations = good.size() > HEADER_SIZE + count * ENTRY_SIZE;
+	for (size_t size = 0u; size < good.size(); ++size)
+		truncations = recovers(good, size, count) && truncations;
+	allMatch = Report(output, std::format("Every truncation of the {} byte cache file recompiles", good.size()).c_str(), truncations) && allMatch;
+
+	// A flipped byte in the last blob fails only that blob's content hash.
+	std::vector<uchar> flipped = good;
+	flipped.back() ^= 0xFFu;
+	allMatch = Report(output, "A damaged blob recompiles only that shader", recovers(flipped, flipped.size(), 1u)) && allMatch;
+
+	std::vector<uchar> badMagic = good;
+	badMagic[0] = 'X';
+	std::vector<uchar> badVersion = good;
+	badVersion[4] ^= 0x80u;
+	std::vector<uchar> tooManyEntries = good;
+	tooManyEntries[8] = 0xFFu;
+	tooManyEntries[9] = 0xFFu;
+	std::vector<uchar> blobPastEnd = good;
+	blobPastEnd[HEADER_SIZE + ENTRY_OFFSET_FIELD + 3u] = 0x7Fu;
+	std::vector<uchar> unsorted = good;
+	std::swap_ranges(unsorted.begin() + HEADER_SIZE, unsorted.begin() + HEADER_SIZE + 8, unsorted.begin() + HEADER_SIZE + ENTRY_SIZE);
+	std::vector<uchar> noise(good.size());
+	std::mt19937 random(RANDOM_SEED);
+	for (uchar& byte : noise)
+		byte = (uchar)random();
+
+	bool headers = recovers(badMagic, badMagic.size(), count) && recovers(badVersion, badVersion.size(), count) &&
+		recovers(tooManyEntries, tooManyEntries.size(), count) && recovers(blobPastEnd, blobPastEnd.size(), count) &&
+		recovers(unsorted, unsorted.size(), count) && recovers(noise, noise.size(), count);
+	allMatch = Report(output, "A bad header, too many entries, a blob past the end, an unsorted table or noise recompile everything", headers) && allMatch;
+
+	fs::remove_all(directory, error);
+	return allMatch;
+}
@@ -0,0 +1,12 @@
+#pragma once
+
+#include <ostream>
+#include "Common.h"
+
+// Runs ShaderCache against a stub compiler on shader files written to a temporary directory. Checks that the first
+// load misses and compiles, that the next one hits from the saved file without compiling, and that changing the
+// source, an include two levels down, the flags or the profile rebuilds only what changed and drops the stale blob.
+// Then damages the cache file every way it can be damaged: every truncation, flipped blob bytes, a bad header, blobs
+// past the end, an unsorted table and random bytes. Each must fall back to compiling the right bytecode and be
+// replaced on the next save. Run with "Engine.exe -check-shader-cache". Returns false if any check fails.
+bool RunShaderCacheCheck(std::ostream& output);
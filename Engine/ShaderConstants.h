@@ -0,0 +1,32 @@
+#pragma once
+
+#include "EngineMath.h"
+
+// CPU copies of the constant buffers in ShaderConstants.hlsli, which every program shares. The draw list writes them
+// into the constant ring rather than each program owning a copy, so the layouts here must match the shader's.
+// Matrices are stored transposed, as HLSL reads them column-major.
+
+const char* const PER_FRAME_BUFFER = "PerFrame";
+const char* const PER_VIEW_BUFFER = "PerView";
+const char* const PER_OBJECT_BUFFER = "PerObject";
+
+struct PerFrameConstants
+{
+	float time = 0.0f;		// Seconds since startup.
+	float frameTime = 0.0f;	// Seconds since the previous frame.
+	float padding[2] = {};
+};
+
+struct PerViewConstants
+{
+	Math::Matrix4 view;
+	Math::Matrix4 projection;
+	Math::Matrix4 viewProjection;
+};
+
+struct PerObjectConstants
+{
+	Math::Matrix4 world;
+	Math::Float2 textureOffset;	// Added to the mesh's texture coordinates.
+	float padding[2] = {};
+};
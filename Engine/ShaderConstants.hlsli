@@ -0,0 +1,23 @@
+// GLOBALS
+// Constant buffers shared by every shader. They are filled once per frame, view and object from the constant ring,
+// so their layouts must match the structs in ShaderConstants.h.
+cbuffer PerFrame : register(b0)
+{
+    float time;
+    float frameTime;
+    float2 perFramePadding;
+};
+
+cbuffer PerView : register(b1)
+{
+    matrix viewMatrix;
+    matrix projectionMatrix;
+    matrix viewProjectionMatrix;
+};
+
+cbuffer PerObject : register(b2)
+{
+    matrix worldMatrix;
+    float2 textureOffset;
+    float2 perObjectPadding;
+};
@@ -0,0 +1,372 @@
+#include "ShaderProgram.h"
+#include "D3DContext.h"
+#include "Profiler.h"
+
+#include <atomic>
+#include <string.h>
+
+#ifdef _WIN32
+#include <d3dcompiler.h>
+#include "D3D.h"
+#include "StateCache.h"
+#endif
+
+namespace
+{
+	std::atomic<uint> nextProgramId = 1u;
+
+#ifdef _WIN32
+	// Size of one of the buffers from ShaderConstants.h as HLSL lays it out, or 0 for a buffer the program owns.
+	uint GetSharedBufferSize(const char* name)
+	{
+		if (strcmp(name, PER_FRAME_BUFFER) == 0)
+			return sizeof(PerFrameConstants);
+		if (strcmp(name, PER_VIEW_BUFFER) == 0)
+			return sizeof(PerViewConstants);
+		if (strcmp(name, PER_OBJECT_BUFFER) == 0)
+			return sizeof(PerObjectConstants);
+		return 0u;
+	}
+
+	DXGI_FORMAT ToDxgiFormat(VertexFormat format)
+	{
+		switch (format)
+		{
+		case VertexFormat::Float2:
+			return DXGI_FORMAT_R32G32_FLOAT;
+		case VertexFormat::Float3:
+			return DXGI_FORMAT_R32G32B32_FLOAT;
+		case VertexFormat::Float4:
+			return DXGI_FORMAT_R32G32B32A32_FLOAT;
+		default:
+			return DXGI_FORMAT_UNKNOWN;
+		}
+	}
+
+	D3D11_SAMPLER_DESC DescribeSampler()
+	{
+		D3D11_SAMPLER_DESC samplerDesc;
+		samplerDesc.Filter = D3D11_FILTER_MIN_MAG_MIP_LINEAR;
+		samplerDesc.AddressU = D3D11_TEXTURE_ADDRESS_WRAP;
+		samplerDesc.AddressV = D3D11_TEXTURE_ADDRESS_WRAP;
+		samplerDesc.AddressW = D3D11_TEXTURE_ADDRESS_WRAP;
+		samplerDesc.MipLODBias = 0.0f;
+		samplerDesc.MaxAnisotropy = 1;
+		samplerDesc.ComparisonFunc = D3D11_COMPARISON_ALWAYS;
+		samplerDesc.BorderColor[0] = 0;
+		samplerDesc.BorderColor[1] = 0;
+		samplerDesc.BorderColor[2] = 0;
+		samplerDesc.BorderColor[3] = 0;
+		samplerDesc.MinLOD = 0;
+		samplerDesc.MaxLOD = D3D11_FLOAT32_MAX;
+		return samplerDesc;
+	}
+#endif
+}
+
+bool ShaderProgram::Constant::IsValid() const
+{
+	return buffer != INVALID_SLOT;
+}
+
+ShaderProgram::ShaderProgram(RenderBackend& renderer, [[maybe_unused]] ShaderCache& shaderCache, [[maybe_unused]] const Desc& desc)
+	: _id(nextProgramId++)
+{
+	PROFILE_SCOPE("ShaderProgram::ShaderProgram");
+
+	// Backends without a device run their own vertex and pixel stages.
+	ID3D11Device* device = GetDevice(renderer);
+	if (!device)
+		return;
+
+#ifdef _WIN32
+	std::string error;
+
+	// Get the vertex shader code, compiling it only if the cache has no bytecode for the current source.
+	ShaderCache::Bytecode vertexShaderBuffer = shaderCache.Get({ desc.vsFilename, desc.vsEntryPoint, "vs_5_0", D3D10_SHADER_ENABLE_STRICTNESS }, error);
+	if (!vertexShaderBuffer.data)
+		throw D3DError(error);
+
+	// Get the pixel shader code.
+	ShaderCache::Bytecode pixelShaderBuffer = shaderCache.Get({ desc.psFilename, desc.psEntryPoint, "ps_5_0", D3D10_SHADER_ENABLE_STRICTNESS }, error);
+	if (!pixelShaderBuffer.data)
+		throw D3DError(error);
+
+	// Create the vertex shader from the buffer.
+	HRESULT result = device->CreateVertexShader(vertexShaderBuffer.data, vertexShaderBuffer.size, nullptr, &_vertexShader);
+	if (FAILED(result))
+		throw D3DError("Failed to create a vertex shader");
+
+	// Create the pixel shader from the buffer.
+	result = device->CreatePixelShader(pixelShaderBuffer.data, pixelShaderBuffer.size, nullptr, &_pixelShader);
+	if (FAILED(result))
+		throw D3DError("Failed to create a pixel shader");
+
+	// Build everything else from what the shaders declare.
+	CreateInputLayout(device, vertexShaderBuffer, *desc.vertexFormat, desc.instanceFormat, desc.vsFilename);
+	Reflect(device, vertexShaderBuffer, Stage::Vertex, desc.vsFilename);
+	Reflect(device, pixelShaderBuffer, Stage::Pixel, desc.psFilename);
+#endif
+}
+
+ShaderProgram::~ShaderProgram() = default;
+
+#ifdef _WIN32
+void ShaderProgram::CreateInputLayout(ID3D11Device* device, const ShaderCache::Bytecode& bytecode, const std::vector<VertexElement>& vertexFormat,
+	const std::vector<VertexElement>* instanceFormat, const char* filename)
+{
+	ReleasePtr<ID3D11ShaderReflection> reflection;
+	HRESULT result = D3DReflect(bytecode.data, bytecode.size, __uuidof(ID3D11ShaderReflection), (void**)&reflection);
+	if (FAILED(result))
+		throw D3DError(std::format("Failed to reflect {}", filename));
+
+	D3D11_SHADER_DESC shaderDesc;
+	reflection->GetDesc(&shaderDesc);
+
+	// Take each input the shader reads from the vertex format. System values such as SV_VertexID come from the pipeline instead.
+	std::vector<D3D11_INPUT_ELEMENT_DESC> polygonLayout;
+	for (uint i = 0u; i < shaderDesc.InputParameters; ++i)
+	{
+		D3D11_SIGNATURE_PARAMETER_DESC parameterDesc;
+		reflection->GetInputParameterDesc(i, &parameterDesc);
+		if (parameterDesc.SystemValueType != D3D_NAME_UNDEFINED)
+			continue;
+
+		// Look in the vertex format first, then in the instance format.
+		const VertexElement* element = nullptr;
+		bool perInstance = false;
+		for (const VertexElement& candidate : vertexFormat)
+		{
+			if (_stricmp(candidate.semantic, parameterDesc.SemanticName) == 0 && candidate.semanticIndex == parameterDesc.SemanticIndex)
+				element = &candidate;
+		}
+		if (!element && instanceFormat)
+		{
+			for (const VertexElement& candidate : *instanceFormat)
+			{
+				if (_stricmp(candidate.semantic, parameterDesc.SemanticName) == 0 && candidate.semanticIndex == parameterDesc.SemanticIndex)
+					element = &candidate;
+			}
+			perInstance = element != nullptr;
+		}
+		if (!element)
+			throw D3DError(std::format("The vertex format has no {}{} for {}", parameterDesc.SemanticName, parameterDesc.SemanticIndex, filename));
+
+		D3D11_INPUT_ELEMENT_DESC elementDesc;
+		elementDesc.SemanticName = element->semantic;
+		elementDesc.SemanticIndex = element->semanticIndex;
+		elementDesc.Format = ToDxgiFormat(element->format);
+		elementDesc.InputSlot = perInstance ? InstanceBuffers::INPUT_SLOT : 0u;
+		elementDesc.AlignedByteOffset = element->offset;
+		elementDesc.InputSlotClass = perInstance ? D3D11_INPUT_PER_INSTANCE_DATA : D3D11_INPUT_PER_VERTEX_DATA;
+		elementDesc.InstanceDataStepRate = perInstance ? 1u : 0u;
+		polygonLayout.push_back(elementDesc);
+	}
+
+	// Create the vertex input layout.
+	result = device->CreateInputLayout(polygonLayout.data(), (uint)polygonLayout.size(), bytecode.data, bytecode.size, &_layout);
+	if (FAILED(result))
+		throw D3DError("Failed to create an input layout");
+}
+
+void ShaderProgram::Reflect(ID3D11Device* device, const ShaderCache::Bytecode& bytecode, Stage stage, const char* filename)
+{
+	ReleasePtr<ID3D11ShaderReflection> reflection;
+	HRESULT result = D3DReflect(bytecode.data, bytecode.size, __uuidof(ID3D11ShaderReflection), (void**)&reflection);
+	if (FAILED(result))
+		throw D3DError(std::format("Failed to reflect {}", filename));
+
+	D3D11_SHADER_DESC shaderDesc;
+	reflection->GetDesc(&shaderDesc);
+
+	for (uint i = 0u; i < shaderDesc.BoundResources; ++i)
+	{
+		D3D11_SHADER_INPUT_BIND_DESC bindDesc;
+		reflection->GetResourceBindingDesc(i, &bindDesc);
+
+		if (bindDesc.Type == D3D_SIT_CBUFFER)
+		{
+			ID3D11ShaderReflectionConstantBuffer* bufferReflection = reflection->GetConstantBufferByName(bindDesc.Name);
+			D3D11_SHADER_BUFFER_DESC bufferDesc;
+			bufferReflection->GetDesc(&bufferDesc);
+
+			// The shared buffers are written by the draw list into the constant ring; only their slots are needed.
+			uint sharedSize = GetSharedBufferSize(bindDesc.Name);
+			if (sharedSize > 0u)
+			{
+				if (bufferDesc.Size != sharedSize)
+					throw D3DError(std::format("The constant buffer {} in {} does not match ShaderConstants.h", bindDesc.Name, filename));
+
+				BufferSlots& slots = _sharedBuffers[bindDesc.Name];
+				(stage == Stage::Vertex ? slots.vsSlot : slots.psSlot) = bindDesc.BindPoint;
+				continue;
+			}
+
+			// A buffer both stages declare under the same name is shared, so its constants are only written once.
+			uint index = 0u;
+			while (index < _constantBuffers.size() && _constantBuffers[index].name != bindDesc.Name)
+				index++;
+			if (index == _constantBuffers.size())
+			{
+				ConstantBuffer& constantBuffer = _constantBuffers.emplace_back();
+				constantBuffer.name = bindDesc.Name;
+				constantBuffer.data.resize(bufferDesc.Size);
+
+				// Setup the description of the dynamic constant buffer.
+				D3D11_BUFFER_DESC constantBufferDesc;
+				constantBufferDesc.Usage = D3D11_USAGE_DYNAMIC;
+				constantBufferDesc.ByteWidth = bufferDesc.Size;
+				constantBufferDesc.BindFlags = D3D11_BIND_CONSTANT_BUFFER;
+				constantBufferDesc.CPUAccessFlags = D3D11_CPU_ACCESS_WRITE;
+				constantBufferDesc.MiscFlags = 0;
+				constantBufferDesc.StructureByteStride = 0;
+
+				result = device->CreateBuffer(&constantBufferDesc, nullptr, &constantBuffer.buffer);
+				if (FAILED(result))
+					throw D3DError(std::format("Failed to create the constant buffer {}", bindDesc.Name));
+
+				for (uint v = 0u; v < bufferDesc.Variables; ++v)
+				{
+					D3D11_SHADER_VARIABLE_DESC variableDesc;
+					bufferReflection->GetVariableByIndex(v)->GetDesc(&variableDesc);
+
+					Variable variable;
+					variable.name = variableDesc.Name;
+					variable.constant.buffer = index;
+					variable.constant.offset = variableDesc.StartOffset;
+					variable.constant.size = variableDesc.Size;
+					_variables.push_back(variable);
+				}
+			}
+			else if (_constantBuffers[index].data.size() != bufferDesc.Size)
+			{
+				throw D3DError(std::format("The constant buffer {} differs between the stages of {}", bindDesc.Name, filename));
+			}
+
+			(stage == Stage::Vertex ? _constantBuffers[index].vsSlot : _constantBuffers[index].psSlot) = bindDesc.BindPoint;
+		}
+		else if (bindDesc.Type == D3D_SIT_SAMPLER)
+		{
+			// Create the texture sampler state.
+			Sampler& sampler = _samplers.emplace_back();
+			D3D11_SAMPLER_DESC samplerDesc = DescribeSampler();
+			result = device->CreateSamplerState(&samplerDesc, &sampler.state);
+			if (FAILED(result))
+				throw D3DError("Failed to create a texture sampler");
+
+			(stage == Stage::Vertex ? sampler.vsSlot : sampler.psSlot) = bindDesc.BindPoint;
+		}
+		else if (bindDesc.Type == D3D_SIT_TEXTURE && stage == Stage::Pixel)
+		{
+			_textures[bindDesc.Name] = bindDesc.BindPoint;
+		}
+	}
+}
+#endif
+
+uint ShaderProgram::GetId() const
+{
+	return _id;
+}
+
+uint ShaderProgram::FindTexture(const char* name) const
+{
+	auto texture = _textures.find(name);
+	return texture != _textures.end() ? texture->second : INVALID_SLOT;
+}
+
+ShaderProgram::BufferSlots ShaderProgram::FindSharedBuffer(const char* name) const
+{
+	auto slots = _sharedBuffers.find(name);
+	return slots != _sharedBuffers.end() ? slots->second : BufferSlots();
+}
+
+ShaderProgram::Constant ShaderProgram::FindConstant(const char* name) const
+{
+	for (const Variable& variable : _variables)
+	{
+		if (variable.name == name)
+			return variable.constant;
+	}
+	return Constant();
+}
+
+void ShaderProgram::SetConstant(const Constant& constant, const void* data, size_t size)
+{
+	if (!constant.IsValid())
+		return;
+
+	if (size > constant.size)
+		size = constant.size;
+
+	ConstantBuffer& constantBuffer = _constantBuffers[constant.buffer];
+	memcpy(constantBuffer.data.data() + constant.offset, data, size);
+	constantBuffer.dirty = true;
+}
+
+void ShaderProgram::SetMatrix(const Constant& constant, const Math::Matrix4& matrix)
+{
+	// Transpose the matrix to prepare it for the shader.
+	Math::Matrix4 transposed = Math::Transpose(matrix);
+	SetConstant(constant, &transposed, sizeof(transposed));
+}
+
+void ShaderProgram::Bind(RenderBackend& renderer)
+{
+	ID3D11DeviceContext* deviceContext = GetDeviceContext(renderer);
+	StateCache* stateCache = GetStateCache(renderer);
+	if (!deviceContext || !stateCache)
+		return;
+
+#ifdef _WIN32
+	// Set the vertex input layout.
+	stateCache->SetInputLayout(_layout.get());
+
+	// Set the vertex and pixel shaders that will be used to render.
+	stateCache->SetVertexShader(_vertexShader.get());
+	stateCache->SetPixelShader(_pixelShader.get());
+
+	// Set the constant buffers and samplers in the slots the shaders declared them in.
+	for (ConstantBuffer& constantBuffer : _constantBuffers)
+	{
+		ID3D11Buffer* buffer = constantBuffer.buffer.get();
+		if (constantBuffer.vsSlot != INVALID_SLOT)
+			deviceContext->VSSetConstantBuffers(constantBuffer.vsSlot, 1, &buffer);
+		if (constantBuffer.psSlot != INVALID_SLOT)
+			deviceContext->PSSetConstantBuffers(constantBuffer.psSlot, 1, &buffer);
+	}
+	for (Sampler& sampler : _samplers)
+	{
+		if (sampler.vsSlot != INVALID_SLOT)
+			stateCache->SetSampler(StateCache::Stage::Vertex, sampler.vsSlot, sampler.state.get());
+		if (sampler.psSlot != INVALID_SLOT)
+			stateCache->SetSampler(StateCache::Stage::Pixel, sampler.psSlot, sampler.state.get());
+	}
+#endif
+}
+
+void ShaderProgram::UploadConstants(RenderBackend& renderer)
+{
+	ID3D11DeviceContext* deviceContext = GetDeviceContext(renderer);
+	if (!deviceContext)
+		return;
+
+#ifdef _WIN32
+	for (ConstantBuffer& constantBuffer : _constantBuffers)
+	{
+		if (!constantBuffer.dirty)
+			continue;
+
+		// Lock the constant buffer so it can be written to.
+		D3D11_MAPPED_SUBRESOURCE mappedResource;
+		HRESULT result = deviceContext->Map(constantBuffer.buffer.get(), 0, D3D11_MAP_WRITE_DISCARD, 0, &mappedResource);
+		if (FAILED(result))
+			throw D3DError(std::format("Failed to map the constant buffer {}", constantBuffer.name));
+
+		// Copy the constants in and unlock the buffer.
+		memcpy(mappedResource.pData, constantBuffer.data.data(), constantBuffer.data.size());
+		deviceContext->Unmap(constantBuffer.buffer.get(), 0);
+		constantBuffer.dirty = false;
+	}
+#endif
+}
@@ -0,0 +1,137 @@
+#pragma once
+
+#include "Common.h"
+#include "EngineMath.h"
+#include "ReleasePtr.h"
+#include "RenderBackend.h"
+#include "ShaderCache.h"
+#include "ShaderConstants.h"
+
+struct ID3D11Device;
+struct ID3D11InputLayout;
+struct ID3D11PixelShader;
+struct ID3D11SamplerState;
+struct ID3D11VertexShader;
+
+// A vertex and pixel shader pair together with everything needed to draw with them. Nothing about the shaders is
+// written by hand: the compiled blobs are reflected to find the vertex inputs, constant buffers, textures and samplers.
+//
+// - The input layout takes each vertex input the shader reads from the mesh's vertex format, matched by semantic.
+//   Inputs the vertex format lacks are taken from the instance format, if the program has one, as per-instance data
+//   in the instance input slot.
+// - Every constant buffer gets a CPU copy sized from reflection; constants are written by name into that copy and
+//   uploaded by UploadConstants only when something changed. The buffers shared by all shaders (ShaderConstants.h)
+//   are the exception: they come from the constant ring, so the program only records their slots.
+// - Every sampler gets a trilinear wrapping sampler state.
+//
+// Backends without a device get an empty program: Bind and UploadConstants do nothing and no constants are found,
+// since those backends run their own fixed vertex and pixel stages.
+class ShaderProgram
+{
+public:
+
+	static const uint INVALID_SLOT = ~0u;
+
+	struct Desc
+	{
+		const char* vsFilename = nullptr;
+		const char* vsEntryPoint = nullptr;
+		const char* psFilename = nullptr;
+		const char* psEntryPoint = nullptr;
+		const std::vector<VertexElement>* vertexFormat = nullptr; // Layout of the meshes drawn with the program.
+		const std::vector<VertexElement>* instanceFormat = nullptr; // Per-instance stream of instanced programs, or null.
+	};
+
+	struct BufferSlots
+	{
+		uint vsSlot = INVALID_SLOT;
+		uint psSlot = INVALID_SLOT;
+	};
+
+	// Where a constant lives, found once by name and then used every draw.
+	struct Constant
+	{
+		uint buffer = INVALID_SLOT;
+		uint offset = 0u;
+		uint size = 0u;
+
+		bool IsValid() const;
+	};
+
+	// Compiles both stages through the cache and reflects them. Throws D3DError if a stage does not compile or the
+	// vertex format lacks an input the vertex shader reads.
+	ShaderProgram(RenderBackend& renderer, ShaderCache& shaderCache, const Desc& desc);
+	~ShaderProgram();
+
+	ShaderProgram(const ShaderProgram&) = delete;
+	ShaderProgram& operator=(const ShaderProgram&) = delete;
+
+	// Unique per program, so draws can be sorted to bind each program once.
+	uint GetId() const;
+
+	// Pixel shader slot of the named texture, or INVALID_SLOT.
+	uint FindTexture(const char* name) const;
+
+	// Slots of one of the shared buffers from ShaderConstants.h; INVALID_SLOT for a stage that does not read it.
+	BufferSlots FindSharedBuffer(const char* name) const;
+
+	Constant FindConstant(const char* name) const;
+
+	// Copies a constant into its buffer's CPU copy. Data larger than the constant is cut off.
+	void SetConstant(const Constant& constant, const void* data, size_t size);
+
+	// Stores the matrix transposed, as HLSL reads constant buffer matrices column-major.
+	void SetMatrix(const Constant& constant, const Math::Matrix4& matrix);
+
+	// Binds the shaders, input layout, constant buffers and samplers. All but the constant buffers go through the
+	// backend's StateCache, so what this program shares with the last one bound is not bound again.
+	void Bind(RenderBackend& renderer);
+
+	// Uploads the constant buffers written since the last upload.
+	void UploadConstants(RenderBackend& renderer);
+
+private:
+
+	struct ConstantBuffer
+	{
+		std::string name;
+		uint vsSlot = INVALID_SLOT;
+		uint psSlot = INVALID_SLOT;
+		std::vector<uchar> data;
+		ReleasePtr<ID3D11Buffer> buffer;
+		bool dirty = true;
+	};
+
+	struct Variable
+	{
+		std::string name;
+		Constant constant;
+	};
+
+	struct Sampler
+	{
+		uint vsSlot = INVALID_SLOT;
+		uint psSlot = INVALID_SLOT;
+		ReleasePtr<ID3D11SamplerState> state;
+	};
+
+	enum class Stage
+	{
+		Vertex,
+		Pixel
+	};
+
+	void Reflect(ID3D11Device* device, const ShaderCache::Bytecode& bytecode, Stage stage, const char* filename);
+	void CreateInputLayout(ID3D11Device* device, const ShaderCache::Bytecode& bytecode, const std::vector<VertexElement>& vertexFormat,
+		const std::vector<VertexElement>* instanceFormat, const char* filename);
+
+	uint _id = 0u;
+	ReleasePtr<ID3D11VertexShader> _vertexShader;
+	ReleasePtr<ID3D11PixelShader> _pixelShader;
+	ReleasePtr<ID3D11InputLayout> _layout;
+	std::vector<ConstantBuffer> _constantBuffers;
+	std::vector<Variable> _variables;
+	std::vector<Sampler> _samplers;
+	std::map<std::string, uint> _textures;
+	std::map<std::string, BufferSlots> _sharedBuffers;
+};
@@ -0,0 +1,582 @@
+#include "SoftwareRasterizer.h"
+#include "JobSystem.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+
+namespace
+{
+	// Screen positions are snapped to 1/256 of a pixel, the same sub-pixel precision Direct3D 11 hardware guarantees.
+	const int32_t SUBPIXEL_BITS = 8;
+	const int32_t SUBPIXEL_ONE = 1 << SUBPIXEL_BITS;
+
+	// Triangles are clipped against a guard band this many times the viewport so fixed point coordinates never overflow.
+	const float GUARD_BAND = 4.0f;
+
+	const uint TRANSFORM_BATCH_SIZE = 1024u;
+	const uint MAX_CLIP_VERTICES = 12u;
+
+	SoftwareRasterizer::Matrix Multiply(const SoftwareRasterizer::Matrix& a, const SoftwareRasterizer::Matrix& b)
+	{
+		SoftwareRasterizer::Matrix result;
+		for (int row = 0; row < 4; ++row)
+		{
+			for (int col = 0; col < 4; ++col)
+			{
+				result.m[row][col] = a.m[row][0] * b.m[0][col] + a.m[row][1] * b.m[1][col] + a.m[row][2] * b.m[2][col] + a.m[row][3] * b.m[3][col];
+			}
+		}
+		return result;
+	}
+
+	bool DepthTest(SoftwareRasterizer::ComparisonFunc func, float source, float destination)
+	{
+		switch (func)
+		{
+		case SoftwareRasterizer::ComparisonFunc::Never: return false;
+		case SoftwareRasterizer::ComparisonFunc::Less: return source < destination;
+		case SoftwareRasterizer::ComparisonFunc::Equal: return source == destination;
+		case SoftwareRasterizer::ComparisonFunc::LessEqual: return source <= destination;
+		case SoftwareRasterizer::ComparisonFunc::Greater: return source > destination;
+		case SoftwareRasterizer::ComparisonFunc::NotEqual: return source != destination;
+		case SoftwareRasterizer::ComparisonFunc::GreaterEqual: return source >= destination;
+		default: return true;
+		}
+	}
+
+	uint32_t PackColor(float red, float green, float blue, float alpha)
+	{
+		auto toByte = [](float value) { return (uint32_t)(std::clamp(value, 0.0f, 1.0f) * 255.0f + 0.5f); };
+
+		// Memory order is R, G, B, A to match DXGI_FORMAT_R8G8B8A8_UNORM.
+		return toByte(red) | (toByte(green) << 8) | (toByte(blue) << 16) | (toByte(alpha) << 24);
+	}
+
+	// Bilinear sample with wrap addressing, matching the D3D11_FILTER_MIN_MAG_MIP_LINEAR / WRAP sampler of the texture shader on the top mip.
+	uint32_t SampleBilinear(const SoftwareRasterizer::TextureView& texture, float u, float v)
+	{
+		if (!texture.pixels || texture.width == 0u || texture.height == 0u)
+			return 0xFFFFFFFFu;
+
+		float x = u * (float)texture.width - 0.5f;
+		float y = v * (float)texture.height - 0.5f;
+		float floorX = std::floor(x);
+		float floorY = std::floor(y);
+		float fracX = x - floorX;
+		float fracY = y - floorY;
+
+		auto wrap = [](int64_t value, uint size) { int64_t m = value % (int64_t)size; return (uint)(m < 0 ? m + size : m); };
+		uint x0 = wrap((int64_t)floorX, texture.width);
+		uint y0 = wrap((int64_t)floorY, texture.height);
+		uint x1 = x0 + 1u == texture.width ? 0u : x0 + 1u;
+		uint y1 = y0 + 1u == texture.height ? 0u : y0 + 1u;
+
+		const uchar* p00 = texture.pixels + ((size_t)y0 * texture.width + x0) * 4u;
+		const uchar* p10 = texture.pixels + ((size_t)y0 * texture.width + x1) * 4u;
+		const uchar* p01 = texture.pixels + ((size_t)y1 * texture.width + x0) * 4u;
+		const uchar* p11 = texture.pixels + ((size_t)y1 * texture.width + x1) * 4u;
+
+		uint32_t result = 0u;
+		for (uint channel = 0u; channel < 4u; ++channel)
+		{
+			float top = p00[channel] + (p10[channel] - p00[channel]) * fracX;
+			float bottom = p01[channel] + (p11[channel] - p01[channel]) * fracX;
+			float value = top + (bottom - top) * fracY;
+			result |= (uint32_t)(value + 0.5f) << (channel * 8u);
+		}
+		return result;
+	}
+}
+
+SoftwareRasterizer::SoftwareRasterizer(uint width, uint height, uint threadCount)
+	: _width(width)
+	, _height(height)
+{
+	if (width == 0u || height == 0u)
+		throw std::runtime_error("Software rasterizer needs a non-empty framebuffer");
+
+	_tilesX = (width + TILE_SIZE - 1u) / TILE_SIZE;
+	_tilesY = (height + TILE_SIZE - 1u) / TILE_SIZE;
+	_tileBins.resize(_tilesX * _tilesY);
+	_color.resize((size_t)width * height);
+	_depth.resize((size_t)width * height);
+
+	_viewport.width = (float)width;
+	_viewport.height = (float)height;
+
+	for (int i = 0; i < 4; ++i)
+		for (int j = 0; j < 4; ++j)
+			_worldViewProjection.m[i][j] = i == j ? 1.0f : 0.0f;
+
+	// The calling thread takes part in every parallel loop, so it counts as one of the threads.
+	_threadCount = threadCount == 0u ? JobSystem::GetDefault().GetThreadCount() : threadCount;
+}
+
+void SoftwareRasterizer::SetDepthState(const DepthState& state)
+{
+	_depthState = state;
+}
+
+void SoftwareRasterizer::SetRasterState(const RasterState& state)
+{
+	_rasterState = state;
+}
+
+void SoftwareRasterizer::SetViewport(const Viewport& viewport)
+{
+	_viewport = viewport;
+}
+
+void SoftwareRasterizer::SetTransforms(const Matrix& world, const Matrix& view, const Matrix& projection)
+{
+	// Same order as texture.vs: position * world * view * projection.
+	_worldViewProjection = Multiply(Multiply(world, view), projection);
+}
+
+void SoftwareRasterizer::SetTextureOffset(float u, float v)
+{
+	_textureOffset[0] = u;
+	_textureOffset[1] = v;
+}
+
+void SoftwareRasterizer::SetTexture(const TextureView& texture)
+{
+	_texture = texture;
+}
+
+void SoftwareRasterizer::SetVertexStream(const VertexStream& stream)
+{
+	_vertexStream = stream;
+}
+
+void SoftwareRasterizer::SetIndexBuffer(const uint* indices, uint indexCount)
+{
+	_indices = indices;
+	_indexCount = indexCount;
+}
+
+void SoftwareRasterizer::Clear(float red, float green, float blue, float alpha, float depth)
+{
+	// Anything binned so far belongs before the clear.
+	Flush();
+
+	uint32_t color = PackColor(red, green, blue, alpha);
+	ParallelFor(_height, [&](uint row)
+	{
+		size_t offset = (size_t)row * _width;
+		std::fill_n(_color.begin() + offset, _width, color);
+		std::fill_n(_depth.begin() + offset, _width, depth);
+	});
+}
+
+void SoftwareRasterizer::DrawIndexed(uint indexCount, uint startIndex, int baseVertex)
+{
+	if (!_indices || !_vertexStream.data || startIndex >= _indexCount)
+		return;
+
+	indexCount = std::min(indexCount, _indexCount - startIndex);
+	indexCount -= indexCount % 3u;
+
+	_stats.drawCalls++;
+
+	// Remember the state the triangles of this draw are rasterized with.
+	_drawStates.push_back(DrawState{ _depthState, _texture });
+
+	TransformVertices();
+
+	const uint* indices = _indices + startIndex;
+	for (uint i = 0u; i < indexCount; i += 3u)
+	{
+		int64_t i0 = (int64_t)indices[i + 0] + baseVertex;
+		int64_t i1 = (int64_t)indices[i + 1] + baseVertex;
+		int64_t i2 = (int64_t)indices[i + 2] + baseVertex;
+
+		_stats.trianglesSubmitted++;
+
+		// Out of range indices read zero in Direct3D; here the triangle is simply dropped.
+		int64_t vertexCount = (int64_t)_clipVertices.size();
+		if (i0 < 0 || i1 < 0 || i2 < 0 || i0 >= vertexCount || i1 >= vertexCount || i2 >= vertexCount)
+			continue;
+
+		ClipAndSetupTriangle(_clipVertices[(size_t)i0], _clipVertices[(size_t)i1], _clipVertices[(size_t)i2]);
+	}
+}
+
+void SoftwareRasterizer::TransformVertices()
+{
+	// The whole vertex stream is transformed once per draw; index buffers reference each vertex several times.
+	uint vertexCount = _vertexStream.vertexCount;
+	_clipVertices.resize(vertexCount);
+
+	const uchar* data = (const uchar*)_vertexStream.data;
+	uint batchCount = (vertexCount + TRANSFORM_BATCH_SIZE - 1u) / TRANSFORM_BATCH_SIZE;
+
+	ParallelFor(batchCount, [&](uint batch)
+	{
+		uint begin = batch * TRANSFORM_BATCH_SIZE;
+		uint end = std::min(begin + TRANSFORM_BATCH_SIZE, vertexCount);
+		const Matrix& m = _worldViewProjection;
+
+		for (uint i = begin; i < end; ++i)
+		{
+			const uchar* vertex = data + (size_t)i * _vertexStream.stride;
+			float position[3];
+			float texcoord[2];
+			std::memcpy(position, vertex + _vertexStream.positionOffset, sizeof(position));
+			std::memcpy(texcoord, vertex + _vertexStream.texcoordOffset, sizeof(texcoord));
+
+			ClipVertex& out = _clipVertices[i];
+			out.x = position[0] * m.m[0][0] + position[1] * m.m[1][0] + position[2] * m.m[2][0] + m.m[3][0];
+			out.y = position[0] * m.m[0][1] + position[1] * m.m[1][1] + position[2] * m.m[2][1] + m.m[3][1];
+			out.z = position[0] * m.m[0][2] + position[1] * m.m[1][2] + position[2] * m.m[2][2] + m.m[3][2];
+			out.w = position[0] * m.m[0][3] + position[1] * m.m[1][3] + position[2] * m.m[2][3] + m.m[3][3];
+			out.u = texcoord[0] + _textureOffset[0];
+			out.v = texcoord[1] + _textureOffset[1];
+		}
+	});
+}
+
+void SoftwareRasterizer::ClipAndSetupTriangle(const ClipVertex& v0, const ClipVertex& v1, const ClipVertex& v2)
+{
+	// Distance of a clip space vertex to each clipping plane; a vertex is inside when the distance is not negative.
+	auto planeDistance = [this](const ClipVertex& v, uint plane) -> float
+	{
+		switch (plane)
+		{
+		case 0: return _rasterState.depthClipEnable ? v.z : v.w - 1e-6f;	// Near plane (0 <= z), or w > 0 when depth clip is disabled.
+		case 1: return _rasterState.depthClipEnable ? v.w - v.z : 1.0f;		// Far plane (z <= w).
+		case 2: return GUARD_BAND * v.w + v.x;
+		case 3: return GUARD_BAND * v.w - v.x;
+		case 4: return GUARD_BAND * v.w + v.y;
+		default: return GUARD_BAND * v.w - v.y;
+		}
+	};
+
+	const ClipVertex* input[3] = { &v0, &v1, &v2 };
+	uint outsideMask = 0u;
+	for (uint plane = 0u; plane < 6u; ++plane)
+	{
+		uint outsideCount = 0u;
+		for (const ClipVertex* v : input)
+			outsideCount += planeDistance(*v, plane) < 0.0f ? 1u : 0u;
+
+		// Trivially reject triangles entirely outside one plane.
+		if (outsideCount == 3u)
+		{
+			_stats.trianglesCulled++;
+			return;
+		}
+		if (outsideCount > 0u)
+			outsideMask |= 1u << plane;
+	}
+
+	if (outsideMask == 0u)
+	{
+		SetupTriangle(v0, v1, v2);
+		return;
+	}
+
+	_stats.trianglesClipped++;
+
+	// Sutherland-Hodgman clipping of the triangle against the planes it crosses.
+	ClipVertex polygonA[MAX_CLIP_VERTICES] = { v0, v1, v2 };
+	ClipVertex polygonB[MAX_CLIP_VERTICES];
+	ClipVertex* source = polygonA;
+	ClipVertex* destination = polygonB;
+	uint count = 3u;
+
+	for (uint plane = 0u; plane < 6u && count >= 3u; ++plane)
+	{
+		if ((outsideMask & (1u << plane)) == 0u)
+			continue;
+
+		uint outCount = 0u;
+		for (uint i = 0u; i < count; ++i)
+		{
+			const ClipVertex& a = source[i];
+			const ClipVertex& b = source[(i + 1u) % count];
+			float da = planeDistance(a, plane);
+			float db = planeDistance(b, plane);
+
+			if (da >= 0.0f)
+				destination[outCount++] = a;
+
+			if ((da >= 0.0f) != (db >= 0.0f) && outCount < MAX_CLIP_VERTICES)
+			{
+				float t = da / (da - db);
+				ClipVertex& v = destination[outCount++];
+				v.x = a.x + (b.x - a.x) * t;
+				v.y = a.y + (b.y - a.y) * t;
+				v.z = a.z + (b.z - a.z) * t;
+				v.w = a.w + (b.w - a.w) * t;
+				v.u = a.u + (b.u - a.u) * t;
+				v.v = a.v + (b.v - a.v) * t;
+			}
+		}
+
+		std::swap(source, destination);
+		count = outCount;
+	}
+
+	// Triangulate the clipped polygon as a fan, which keeps the original winding.
+	for (uint i = 2u; i < count; ++i)
+		SetupTriangle(source[0], source[i - 1u], source[i]);
+}
+
+void SoftwareRasterizer::SetupTriangle(const ClipVertex& v0, const ClipVertex& v1, const ClipVertex& v2)
+{
+	Triangle triangle;
+	const ClipVertex* vertices[3] = { &v0, &v1, &v2 };
+	float depthRange = _viewport.maxDepth - _viewport.minDepth;
+
+	for (int i = 0; i < 3; ++i)
+	{
+		const ClipVertex& v = *vertices[i];
+		float invW = 1.0f / v.w;
+
+		// Viewport transform, y pointing down like the Direct3D render target.
+		float screenX = _viewport.topLeftX + (v.x * invW * 0.5f + 0.5f) * _viewport.width;
+		float screenY = _viewport.topLeftY + (0.5f - v.y * invW * 0.5f) * _viewport.height;
+		float depth = _viewport.minDepth + v.z * invW * depthRange;
+
+		triangle.x[i] = (int32_t)std::lround(screenX * SUBPIXEL_ONE);
+		triangle.y[i] = (int32_t)std::lround(screenY * SUBPIXEL_ONE);
+		triangle.z[i] = std::clamp(depth, std::min(_viewport.minDepth, _viewport.maxDepth), std::max(_viewport.minDepth, _viewport.maxDepth));
+		triangle.invW[i] = invW;
+		triangle.uOverW[i] = v.u * invW;
+		triangle.vOverW[i] = v.v * invW;
+	}
+
+	int64_t area = (int64_t)(triangle.x[1] - triangle.x[0]) * (triangle.y[2] - triangle.y[0]) -
+		(int64_t)(triangle.x[2] - triangle.x[0]) * (triangle.y[1] - triangle.y[0]);
+	if (area == 0)
+	{
+		_stats.trianglesCulled++;
+		return;
+	}
+
+	// With y pointing down a positive area means the vertices appear clockwise on screen.
+	bool clockwise = area > 0;
+	bool frontFacing = _rasterState.frontCounterClockwise ? !clockwise : clockwise;
+	if ((_rasterState.cullMode == CullMode::Back && !frontFacing) || (_rasterState.cullMode == CullMode::Front && frontFacing))
+	{
+		_stats.trianglesCulled++;
+		return;
+	}
+
+	// The rasterizer expects clockwise triangles, so swap two vertices of the visible counter-clockwise ones.
+	if (!clockwise)
+	{
+		std::swap(triangle.x[1], triangle.x[2]);
+		std::swap(triangle.y[1], triangle.y[2]);
+		std::swap(triangle.z[1], triangle.z[2]);
+		std::swap(triangle.invW[1], triangle.invW[2]);
+		std::swap(triangle.uOverW[1], triangle.uOverW[2]);
+		std::swap(triangle.vOverW[1], triangle.vOverW[2]);
+	}
+
+	// Pixel bounding box, clipped to the viewport and the framebuffer.
+	int32_t viewportMinX = std::max(0, (int32_t)std::floor(_viewport.topLeftX));
+	int32_t viewportMinY = std::max(0, (int32_t)std::floor(_viewport.topLeftY));
+	int32_t viewportMaxX = std::min((int32_t)_width - 1, (int32_t)std::ceil(_viewport.topLeftX + _viewport.width) - 1);
+	int32_t viewportMaxY = std::min((int32_t)_height - 1, (int32_t)std::ceil(_viewport.topLeftY + _viewport.height) - 1);
+
+	triangle.minX = std::max(viewportMinX, (std::min({ triangle.x[0], triangle.x[1], triangle.x[2] }) >> SUBPIXEL_BITS));
+	triangle.minY = std::max(viewportMinY, (std::min({ triangle.y[0], triangle.y[1], triangle.y[2] }) >> SUBPIXEL_BITS));
+	triangle.maxX = std::min(viewportMaxX, (std::max({ triangle.x[0], triangle.x[1], triangle.x[2] }) >> SUBPIXEL_BITS));
+	triangle.maxY = std::min(viewportMaxY, (std::max({ triangle.y[0], triangle.y[1], triangle.y[2] }) >> SUBPIXEL_BITS));
+	if (triangle.minX > triangle.maxX || triangle.minY > triangle.maxY)
+	{
+		_stats.trianglesCulled++;
+		return;
+	}
+
+	triangle.drawIndex = (uint)_drawStates.size() - 1u;
+
+	uint triangleIndex = (uint)_triangles.size();
+	_triangles.push_back(triangle);
+	_stats.trianglesBinned++;
+
+	// Bin the triangle into every tile its bounding box touches.
+	uint tileMinX = (uint)triangle.minX / TILE_SIZE;
+	uint tileMinY = (uint)triangle.minY / TILE_SIZE;
+	uint tileMaxX = (uint)triangle.maxX / TILE_SIZE;
+	uint tileMaxY = (uint)triangle.maxY / TILE_SIZE;
+	for (uint tileY = tileMinY; tileY <= tileMaxY; ++tileY)
+	{
+		for (uint tileX = tileMinX; tileX <= tileMaxX; ++tileX)
+		{
+			_tileBins[tileY * _tilesX + tileX].push_back(triangleIndex);
+		}
+	}
+}
+
+void SoftwareRasterizer::Flush()
+{
+	if (_triangles.empty())
+	{
+		_drawStates.clear();
+		return;
+	}
+
+	// Only tiles that received triangles are handed to the workers.
+	std::vector<uint> activeTiles;
+	for (uint i = 0u; i < (uint)_tileBins.size(); ++i)
+	{
+		if (!_tileBins[i].empty())
+			activeTiles.push_back(i);
+	}
+
+	ParallelFor((uint)activeTiles.size(), [&](uint i)
+	{
+		RasterizeTile(activeTiles[i]);
+	});
+
+	for (uint tile : activeTiles)
+		_tileBins[tile].clear();
+	_triangles.clear();
+	_drawStates.clear();
+}
+
+void SoftwareRasterizer::RasterizeTile(uint tileIndex)
+{
+	int32_t tileMinX = (int32_t)((tileIndex % _tilesX) * TILE_SIZE);
+	int32_t tileMinY = (int32_t)((tileIndex / _tilesX) * TILE_SIZE);
+	int32_t tileMaxX = std::min(tileMinX + (int32_t)TILE_SIZE, (int32_t)_width) - 1;
+	int32_t tileMaxY = std::min(tileMinY + (int32_t)TILE_SIZE, (int32_t)_height) - 1;
+
+	uint64_t pixelsShaded = 0u;
+	for (uint triangleIndex : _tileBins[tileIndex])
+		pixelsShaded += RasterizeTriangleInTile(_triangles[triangleIndex], tileMinX, tileMinY, tileMaxX, tileMaxY);
+
+	std::lock_guard<std::mutex> lock(_mutex);
+	_stats.pixelsShaded += pixelsShaded;
+}
+
+uint64_t SoftwareRasterizer::RasterizeTriangleInTile(const Triangle& triangle, int32_t tileMinX, int32_t tileMinY, int32_t tileMaxX, int32_t tileMaxY)
+{
+	int32_t minX = std::max(triangle.minX, tileMinX);
+	int32_t minY = std::max(triangle.minY, tileMinY);
+	int32_t maxX = std::min(triangle.maxX, tileMaxX);
+	int32_t maxY = std::min(triangle.maxY, tileMaxY);
+	if (minX > maxX || minY > maxY)
+		return 0u;
+
+	const DrawState& state = _drawStates[triangle.drawIndex];
+
+	// Edge functions E(p) = a * px + b * py + c for the edges opposite vertex 0, 1 and 2.
+	int64_t a[3], b[3], c[3];
+	for (int edge = 0; edge < 3; ++edge)
+	{
+		int from = (edge + 1) % 3;
+		int to = (edge + 2) % 3;
+		a[edge] = (int64_t)triangle.y[from] - triangle.y[to];
+		b[edge] = (int64_t)triangle.x[to] - triangle.x[from];
+		c[edge] = -(a[edge] * triangle.x[from] + b[edge] * triangle.y[from]);
+
+		// Top-left fill rule: pixels exactly on an edge only belong to top or left edges.
+		bool topEdge = a[edge] == 0 && b[edge] > 0;
+		bool leftEdge = a[edge] > 0;
+		if (!topEdge && !leftEdge)
+			c[edge] -= 1;
+	}
+
+	float area = (float)(a[0] * triangle.x[0] + b[0] * triangle.y[0] + c[0]);
+	float invArea = 1.0f / area;
+
+	// Evaluate at the first pixel center and step in whole pixels.
+	int64_t startX = (int64_t)minX * SUBPIXEL_ONE + SUBPIXEL_ONE / 2;
+	int64_t startY = (int64_t)minY * SUBPIXEL_ONE + SUBPIXEL_ONE / 2;
+	int64_t rowStart[3], stepX[3], stepY[3];
+	for (int edge = 0; edge < 3; ++edge)
+	{
+		rowStart[edge] = a[edge] * startX + b[edge] * startY + c[edge];
+		stepX[edge] = a[edge] * SUBPIXEL_ONE;
+		stepY[edge] = b[edge] * SUBPIXEL_ONE;
+	}
+
+	uint64_t pixelsShaded = 0u;
+	for (int32_t y = minY; y <= maxY; ++y)
+	{
+		int64_t e0 = rowStart[0];
+		int64_t e1 = rowStart[1];
+		int64_t e2 = rowStart[2];
+		size_t offset = (size_t)y * _width + minX;
+
+		for (int32_t x = minX; x <= maxX; ++x, ++offset, e0 += stepX[0], e1 += stepX[1], e2 += stepX[2])
+		{
+			if ((e0 | e1 | e2) < 0)
+				continue;
+
+			float l0 = (float)e0 * invArea;
+			float l1 = (float)e1 * invArea;
+			float l2 = 1.0f - l0 - l1;
+
+			// Depth is affine in screen space.
+			float depth = l0 * triangle.z[0] + l1 * triangle.z[1] + l2 * triangle.z[2];
+			if (state.depth.depthEnable)
+			{
+				if (!DepthTest(state.depth.depthFunc, depth, _depth[offset]))
+					continue;
+				if (state.depth.depthWrite)
+					_depth[offset] = depth;
+			}
+
+			// Texture coordinates are interpolated perspective correctly.
+			float invW = l0 * triangle.invW[0] + l1 * triangle.invW[1] + l2 * triangle.invW[2];
+			float w = 1.0f / invW;
+			float u = (l0 * triangle.uOverW[0] + l1 * triangle.uOverW[1] + l2 * triangle.uOverW[2]) * w;
+			float v = (l0 * triangle.vOverW[0] + l1 * triangle.vOverW[1] + l2 * triangle.vOverW[2]) * w;
+
+			_color[offset] = SampleBilinear(state.texture, u, v);
+			pixelsShaded++;
+		}
+
+		rowStart[0] += stepY[0];
+		rowStart[1] += stepY[1];
+		rowStart[2] += stepY[2];
+	}
+
+	return pixelsShaded;
+}
+
+void SoftwareRasterizer::ParallelFor(uint count, const std::function<void(uint)>& function)
+{
+	JobSystem::GetDefault().ParallelFor(count, _threadCount, function);
+}
+
+uint SoftwareRasterizer::GetWidth() const
+{
+	return _width;
+}
+
+uint SoftwareRasterizer::GetHeight() const
+{
+	return _height;
+}
+
+uint SoftwareRasterizer::GetThreadCount() const
+{
+	return _threadCount;
+}
+
+const std::vector<uint32_t>& SoftwareRasterizer::GetColorBuffer() const
+{
+	return _color;
+}
+
+const std::vector<float>& SoftwareRasterizer::GetDepthBuffer() const
+{
+	return _depth;
+}
+
+const SoftwareRasterizer::Stats& SoftwareRasterizer::GetStats() const
+{
+	return _stats;
+}
+
+void SoftwareRasterizer::ResetStats()
+{
+	_stats = Stats();
+}
@@ -0,0 +1,184 @@
+#pragma once
+
+#include "Common.h"
+
+#include <functional>
+#include <mutex>
+
+// CPU implementation of the fixed textured pipeline (texture.vs / texture.ps) that draws into an in-memory RGBA8 + D32 framebuffer.
+// It has no dependency on Direct3D or the Windows SDK so it can run on headless build machines.
+// Triangles are transformed and binned into screen tiles as they are submitted and the tiles are rasterized in parallel on Flush.
+// Every tile is owned by exactly one worker and processes its triangles in submission order, so the output is deterministic.
+class SoftwareRasterizer
+{
+public:
+
+	// Row-major 4x4 matrix used with row vectors (v * M), the same convention as DirectX::XMMATRIX.
+	struct Matrix
+	{
+		float m[4][4];
+	};
+
+	enum class ComparisonFunc
+	{
+		Never,
+		Less,
+		Equal,
+		LessEqual,
+		Greater,
+		NotEqual,
+		GreaterEqual,
+		Always
+	};
+
+	enum class CullMode
+	{
+		None,
+		Front,
+		Back
+	};
+
+	struct DepthState
+	{
+		bool depthEnable = true;
+		bool depthWrite = true;
+		ComparisonFunc depthFunc = ComparisonFunc::Less;
+	};
+
+	struct RasterState
+	{
+		CullMode cullMode = CullMode::Back;
+		bool frontCounterClockwise = false;
+		bool depthClipEnable = true;
+	};
+
+	struct Viewport
+	{
+		float topLeftX = 0.0f;
+		float topLeftY = 0.0f;
+		float width = 0.0f;
+		float height = 0.0f;
+		float minDepth = 0.0f;
+		float maxDepth = 1.0f;
+	};
+
+	// Tightly packed RGBA8 image sampled with bilinear filtering and wrap addressing. The pixels must outlive the next Flush.
+	struct TextureView
+	{
+		const uchar* pixels = nullptr;
+		uint width = 0u;
+		uint height = 0u;
+	};
+
+	// Vertex stream description. Positions are three floats and texture coordinates two floats at the given byte offsets.
+	struct VertexStream
+	{
+		const void* data = nullptr;
+		uint stride = 0u;
+		uint positionOffset = 0u;
+		uint texcoordOffset = 0u;
+		uint vertexCount = 0u;
+	};
+
+	struct Stats
+	{
+		uint drawCalls = 0u;
+		uint trianglesSubmitted = 0u;
+		uint trianglesCulled = 0u;
+		uint trianglesClipped = 0u;
+		uint trianglesBinned = 0u;
+		uint64_t pixelsShaded = 0u;
+	};
+
+	static const uint TILE_SIZE = 64u;
+
+	SoftwareRasterizer(uint width, uint height, uint threadCount = 0u);
+
+	SoftwareRasterizer(const SoftwareRasterizer&) = delete;
+	SoftwareRasterizer& operator=(const SoftwareRasterizer&) = delete;
+
+	void SetDepthState(const DepthState& state);
+	void SetRasterState(const RasterState& state);
+	void SetViewport(const Viewport& viewport);
+	void SetTransforms(const Matrix& world, const Matrix& view, const Matrix& projection);
+
+	// Added to every vertex's texture coordinates, as texture.vs adds the object's textureOffset.
+	void SetTextureOffset(float u, float v);
+
+	void SetTexture(const TextureView& texture);
+	void SetVertexStream(const VertexStream& stream);
+	void SetIndexBuffer(const uint* indices, uint indexCount);
+
+	void Clear(float red, float green, float blue, float alpha, float depth);
+	void DrawIndexed(uint indexCount, uint startIndex, int baseVertex);
+
+	// Rasterize every triangle binned since the last flush.
+	void Flush();
+
+	uint GetWidth() const;
+	uint GetHeight() const;
+	uint GetThreadCount() const;
+	const std::vector<uint32_t>& GetColorBuffer() const;
+	const std::vector<float>& GetDepthBuffer() const;
+	const Stats& GetStats() const;
+	void ResetStats();
+
+private:
+
+	struct ClipVertex
+	{
+		float x, y, z, w;
+		float u, v;
+	};
+
+	// Triangle after viewport transform, ready for edge-function rasterization.
+	struct Triangle
+	{
+		int32_t x[3], y[3];	// Sub-pixel fixed point screen coordinates.
+		float z[3];			// Viewport depth.
+		float invW[3];
+		float uOverW[3], vOverW[3];
+		int32_t minX, minY, maxX, maxY; // Pixel bounds clipped to the viewport.
+		uint drawIndex;
+	};
+
+	struct DrawState
+	{
+		DepthState depth;
+		TextureView texture;
+	};
+
+	void TransformVertices();
+	void SetupTriangle(const ClipVertex& v0, const ClipVertex& v1, const ClipVertex& v2);
+	void ClipAndSetupTriangle(const ClipVertex& v0, const ClipVertex& v1, const ClipVertex& v2);
+	void RasterizeTile(uint tileIndex);
+	uint64_t RasterizeTriangleInTile(const Triangle& triangle, int32_t tileMinX, int32_t tileMinY, int32_t tileMaxX, int32_t tileMaxY);
+
+	void ParallelFor(uint count, const std::function<void(uint)>& function);
+
+	uint _width = 0u;
+	uint _height = 0u;
+	uint _tilesX = 0u;
+	uint _tilesY = 0u;
+	std::vector<uint32_t> _color;
+	std::vector<float> _depth;
+
+	DepthState _depthState;
+	RasterState _rasterState;
+	Viewport _viewport;
+	Matrix _worldViewProjection = {};
+	float _textureOffset[2] = {};
+	TextureView _texture;
+	VertexStream _vertexStream;
+	const uint* _indices = nullptr;
+	uint _indexCount = 0u;
+
+	std::vector<ClipVertex> _clipVertices;
+	std::vector<Triangle> _triangles;
+	std::vector<DrawState> _drawStates;
+	std::vector<std::vector<uint>> _tileBins;
+	Stats _stats;
+
+	uint _threadCount = 1u;
+	std::mutex _mutex; // Guards the stats tiles add to while they are rasterized in parallel.
+};
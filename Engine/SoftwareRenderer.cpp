@@ -0,0 +1,157 @@
+#include "SoftwareRenderer.h"
+#include "RenderState.h"
+
+#include <string.h>
+
+namespace
+{
+	SoftwareRasterizer::Matrix ToRasterizerMatrix(const Math::Matrix4& matrix)
+	{
+		SoftwareRasterizer::Matrix result;
+		memcpy(result.m, matrix.m, sizeof(result.m));
+		return result;
+	}
+}
+
+SoftwareRenderer::SoftwareRenderer(const InitParams& initParams, uint threadCount)
+	: _present(initParams.present)
+	, _rasterizer(initParams.screenWidth, initParams.screenHeight, threadCount)
+{
+	_rasterizer.SetDepthState(RenderState::DescribeDepthState());
+	_rasterizer.SetRasterState(RenderState::DescribeRasterState());
+	_rasterizer.SetViewport(RenderState::DescribeViewport(initParams.screenWidth, initParams.screenHeight));
+
+	_projectionMatrix = RenderState::CreateProjectionMatrix(initParams.screenWidth, initParams.screenHeight, initParams.screenNear, initParams.screenFar);
+	_worldMatrix = Math::Identity();
+	_orthoMatrix = RenderState::CreateOrthoMatrix(initParams.screenWidth, initParams.screenHeight, initParams.screenNear, initParams.screenFar);
+}
+
+void SoftwareRenderer::BeginScene(float red, float green, float blue, float alpha)
+{
+	// Clear the color and depth buffers.
+	_rasterizer.Clear(red, green, blue, alpha, 1.0f);
+}
+
+void SoftwareRenderer::EndScene()
+{
+	// Rasterize everything binned this frame.
+	_rasterizer.Flush();
+
+	if (_present)
+		_present(_rasterizer.GetColorBuffer(), _rasterizer.GetWidth(), _rasterizer.GetHeight());
+}
+
+D3DContext* SoftwareRenderer::GetD3DContext()
+{
+	return nullptr;
+}
+
+GpuTimer* SoftwareRenderer::GetGpuTimer()
+{
+	return nullptr;
+}
+
+void SoftwareRenderer::GetProjectionMatrix(Math::Matrix4& projectionMatrix)
+{
+	projectionMatrix = _projectionMatrix;
+}
+
+void SoftwareRenderer::GetWorldMatrix(Math::Matrix4& worldMatrix)
+{
+	worldMatrix = _worldMatrix;
+}
+
+void SoftwareRenderer::GetOrthoMatrix(Math::Matrix4& orthoMatrix)
+{
+	orthoMatrix = _orthoMatrix;
+}
+
+void SoftwareRenderer::SetMesh(const MeshBuffers& mesh)
+{
+	SoftwareRasterizer::VertexStream stream;
+	stream.data = mesh.vertices;
+	stream.stride = mesh.vertexStride;
+	stream.positionOffset = mesh.positionOffset;
+	stream.texcoordOffset = mesh.texcoordOffset;
+	stream.vertexCount = mesh.vertexCount;
+
+	_rasterizer.SetVertexStream(stream);
+	_rasterizer.SetIndexBuffer(mesh.indices, mesh.indexCount);
+}
+
+void SoftwareRenderer::SetTransforms(const Math::Matrix4& worldMatrix, const Math::Matrix4& viewMatrix, const Math::Matrix4& projectionMatrix,
+	const Math::Float2& textureOffset)
+{
+	_viewMatrix = ToRasterizerMatrix(viewMatrix);
+	_drawProjectionMatrix = ToRasterizerMatrix(projectionMatrix);
+	_rasterizer.SetTransforms(ToRasterizerMatrix(worldMatrix), _viewMatrix, _drawProjectionMatrix);
+	_rasterizer.SetTextureOffset(textureOffset.x, textureOffset.y);
+}
+
+void SoftwareRenderer::SetTexture(uint slot, const TextureBinding& texture)
+{
+	// The rasterizer samples a single texture, the one in the first slot.
+	if (slot != 0u)
+		return;
+
+	SoftwareRasterizer::TextureView view;
+	view.pixels = texture.pixels;
+	view.width = texture.width;
+	view.height = texture.height;
+
+	_rasterizer.SetTexture(view);
+}
+
+void SoftwareRenderer::DrawIndexed(uint indexCount, uint startIndex, int baseVertex)
+{
+	_rasterizer.DrawIndexed(indexCount, startIndex, baseVertex);
+}
+
+void SoftwareRenderer::SetInstances(const InstanceBuffers& instances)
+{
+	_instances = instances;
+}
+
+void SoftwareRenderer::DrawIndexedInstanced(uint indexCount, uint instanceCount, uint startIndex, int baseVertex, uint startInstance)
+{
+	// The rasterizer has no instance stream, so each instance is drawn on its own with its world matrix and texture
+	// offset, as TextureInstanced.vs reads them.
+	for (uint i = startInstance; i < startInstance + instanceCount && i < _instances.instanceCount; ++i)
+	{
+		const InstanceData& instance = _instances.instances[i];
+		SoftwareRasterizer::Matrix worldMatrix;
+		memcpy(worldMatrix.m, instance.world.m, sizeof(worldMatrix.m));
+		_rasterizer.SetTransforms(worldMatrix, _viewMatrix, _drawProjectionMatrix);
+		_rasterizer.SetTextureOffset(instance.textureOffset.x, instance.textureOffset.y);
+		_rasterizer.DrawIndexed(indexCount, startIndex, baseVertex);
+	}
+}
+
+uint SoftwareRenderer::GetRecorderCount()
+{
+	return 0u;
+}
+
+CommandRecorder* SoftwareRenderer::GetRecorder(uint)
+{
+	return nullptr;
+}
+
+void SoftwareRenderer::Execute(CommandRecorder&)
+{
+}
+
+const std::vector<uint32_t>& SoftwareRenderer::GetColorBuffer() const
+{
+	return _rasterizer.GetColorBuffer();
+}
+
+const std::vector<float>& SoftwareRenderer::GetDepthBuffer() const
+{
+	return _rasterizer.GetDepthBuffer();
+}
+
+SoftwareRasterizer& SoftwareRenderer::GetRasterizer()
+{
+	return _rasterizer;
+}
@@ -0,0 +1,69 @@
+#pragma once
+
+#include <functional>
+#include "Common.h"
+#include "RenderBackend.h"
+#include "SoftwareRasterizer.h"
+
+// Render backend that draws with the multithreaded SoftwareRasterizer instead of a GPU.
+// It uses the same RenderState as D3D, so both produce the same frame. It needs neither Windows nor a window: each
+// finished frame is handed to the present callback when one is given, and otherwise only lives in memory.
+class SoftwareRenderer : public RenderBackend
+{
+public:
+
+	struct InitParams
+	{
+		uint screenWidth;
+		uint screenHeight;
+		float screenNear;
+		float screenFar;
+
+		// Called by EndScene with the RGBA8 color buffer of the finished frame.
+		std::function<void(const std::vector<uint32_t>& color, uint width, uint height)> present;
+	};
+
+	SoftwareRenderer(const InitParams& initParams, uint threadCount = 0u);
+
+	void BeginScene(float red, float green, float blue, float alpha) override;
+	void EndScene() override;
+
+	D3DContext* GetD3DContext() override;
+	GpuTimer* GetGpuTimer() override;
+
+	void GetProjectionMatrix(Math::Matrix4&) override;
+	void GetWorldMatrix(Math::Matrix4&) override;
+	void GetOrthoMatrix(Math::Matrix4&) override;
+
+	void SetMesh(const MeshBuffers& mesh) override;
+	void SetTransforms(const Math::Matrix4& worldMatrix, const Math::Matrix4& viewMatrix, const Math::Matrix4& projectionMatrix,
+		const Math::Float2& textureOffset) override;
+	void SetTexture(uint slot, const TextureBinding& texture) override;
+	void DrawIndexed(uint indexCount, uint startIndex, int baseVertex) override;
+	void SetInstances(const InstanceBuffers& instances) override;
+	void DrawIndexedInstanced(uint indexCount, uint instanceCount, uint startIndex, int baseVertex, uint startInstance) override;
+
+	// The rasterizer already spreads every draw over the job system, and its draw state is not thread safe, so draws
+	// are only recorded on the thread that owns the backend.
+	uint GetRecorderCount() override;
+	CommandRecorder* GetRecorder(uint index) override;
+	void Execute(CommandRecorder& recorder) override;
+
+	// RGBA8 color and D32 depth of the last finished frame.
+	const std::vector<uint32_t>& GetColorBuffer() const;
+	const std::vector<float>& GetDepthBuffer() const;
+	SoftwareRasterizer& GetRasterizer();
+
+private:
+
+	std::function<void(const std::vector<uint32_t>&, uint, uint)> _present;
+	SoftwareRasterizer _rasterizer;
+	Math::Matrix4 _projectionMatrix;
+	Math::Matrix4 _worldMatrix;
+	Math::Matrix4 _orthoMatrix;
+
+	// Transforms of the last SetTransforms, which instanced draws combine with each instance's world matrix.
+	SoftwareRasterizer::Matrix _viewMatrix;
+	SoftwareRasterizer::Matrix _drawProjectionMatrix;
+	InstanceBuffers _instances;
+};
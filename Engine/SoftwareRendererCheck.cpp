@@ -0,0 +1,270 @@
+#include "SoftwareRendererCheck.h"
+#include "SoftwareRenderer.h"
+
+#include <math.h>
+#include <stddef.h>
+#include <stdlib.h>
+
+namespace
+{
+	const uint WIDTH = 128u;
+	const uint HEIGHT = 96u;
+	const float SCREEN_NEAR = 0.1f;
+	const float SCREEN_FAR = 100.0f;
+
+	// Textures are single texels, so every pixel of a quad has its color.
+	const uchar RED[4] = { 255u, 0u, 0u, 255u };
+	const uchar GREEN[4] = { 0u, 255u, 0u, 255u };
+	const uchar BLUE[4] = { 0u, 0u, 255u, 255u };
+	const uchar CLEAR[4] = { 0u, 64u, 128u, 255u };
+
+	// Red on the left half and green on the right, so a texture offset of half its width swaps them. Two texels of each
+	// keep the middle of either half clear of the filter blending across the edge.
+	const uint STRIPES_WIDTH = 4u;
+	const uchar STRIPES[STRIPES_WIDTH * 4u] = { 255u, 0u, 0u, 255u, 255u, 0u, 0u, 255u, 0u, 255u, 0u, 255u, 0u, 255u, 0u, 255u };
+
+	// Colors may differ by one step from rounding in the texture filter.
+	const int COLOR_TOLERANCE = 1;
+	const float DEPTH_TOLERANCE = 1e-5f;
+
+	struct Vertex
+	{
+		Math::Float3 position;
+		Math::Float2 texcoord;
+	};
+
+	// A quad from -1 to 1 in x and y, facing the camera. The first six indices wind it clockwise on screen, which is
+	// the front in RenderState, the last six the other way.
+	const Vertex QUAD_VERTICES[] =
+	{
+		{ Math::Float3(-1.0f, -1.0f, 0.0f), Math::Float2(0.0f, 1.0f) },
+		{ Math::Float3(-1.0f, 1.0f, 0.0f), Math::Float2(0.0f, 0.0f) },
+		{ Math::Float3(1.0f, 1.0f, 0.0f), Math::Float2(1.0f, 0.0f) },
+		{ Math::Float3(1.0f, -1.0f, 0.0f), Math::Float2(1.0f, 1.0f) }
+	};
+	const uint QUAD_INDICES[] = { 0u, 1u, 2u, 0u, 2u, 3u, 0u, 2u, 1u, 0u, 3u, 2u };
+	const uint QUAD_INDEX_COUNT = 6u;
+	const uint REVERSED_START = 6u;
+
+	// Where the scene's quads are, and points in world space that land inside each region on screen. The near quad
+	// covers x / z from -0.375 to 0.125, the far one from -0.125 to 0.375, and both a quarter of the height.
+	const Math::Float3 NEAR_POSITION(-0.5f, 0.0f, 4.0f);
+	const Math::Float3 FAR_POSITION(1.0f, 0.0f, 8.0f);
+	const float FAR_SCALE = 2.0f;
+	const Math::Float3 FRONT_POSITION(0.0f, 0.0f, 2.0f);
+	const float FRONT_SCALE = 0.5f;
+
+	const Math::Float3 OVERLAP_POINT(0.0f, 0.0f, 4.0f);
+	const Math::Float3 NEAR_ONLY_POINT(-1.2f, 0.0f, 4.0f);
+	const Math::Float3 FAR_ONLY_POINT(2.4f, 0.0f, 8.0f);
+	const Math::Float3 BACKGROUND_POINT(0.0f, 2.8f, 8.0f);
+
+	// Three instances in a row; the draw starts at the second.
+	const float INSTANCE_DEPTH = 6.0f;
+	const float INSTANCE_SPACING = 1.5f;
+	const float INSTANCE_SCALE = 0.5f;
+
+	// A quad below the instances for the offset drawn through SetTransforms, and the offset that swaps the stripes.
+	const Math::Float3 OFFSET_POSITION(0.0f, -2.0f, 8.0f);
+	const Math::Float2 HALF_OFFSET(0.5f, 0.0f);
+
+	struct Pixel
+	{
+		uint x = 0u;
+		uint y = 0u;
+	};
+
+	bool ColorNear(uint32_t color, const uchar expected[4])
+	{
+		for (uint channel = 0u; channel < 4u; ++channel)
+		{
+			if (abs((int)((color >> (channel * 8u)) & 0xFFu) - (int)expected[channel]) > COLOR_TOLERANCE)
+				return false;
+		}
+		return true;
+	}
+
+	Math::Matrix4 Place(const Math::Float3& position, float scale)
+	{
+		return Math::Multiply(Math::Scaling(scale, scale, 1.0f), Math::Translation(position.x, position.y, position.z));
+	}
+
+	// The pixel a point in world space lands on, with the camera at the origin looking along z.
+	Pixel ToPixel(const Math::Float3& point, const Math::Matrix4& projectionMatrix)
+	{
+		Math::Float4 clip = Math::TransformPoint(point, projectionMatrix);
+		Pixel pixel;
+		pixel.x = (uint)((clip.x / clip.w * 0.5f + 0.5f) * WIDTH);
+		pixel.y = (uint)((0.5f - clip.y / clip.w * 0.5f) * HEIGHT);
+		return pixel;
+	}
+
+	uint32_t ColorAt(SoftwareRenderer& renderer, const Math::Float3& point, const Math::Matrix4& projectionMatrix)
+	{
+		Pixel pixel = ToPixel(point, projectionMatrix);
+		return renderer.GetColorBuffer()[(size_t)pixel.y * WIDTH + pixel.x];
+	}
+
+	float DepthAt(SoftwareRenderer& renderer, const Math::Float3& point, const Math::Matrix4& projectionMatrix)
+	{
+		Pixel pixel = ToPixel(point, projectionMatrix);
+		return renderer.GetDepthBuffer()[(size_t)pixel.y * WIDTH + pixel.x];
+	}
+
+	TextureBinding Bind(const uchar* pixels, uint width = 1u)
+	{
+		TextureBinding texture;
+		texture.pixels = pixels;
+		texture.width = width;
+		texture.height = 1u;
+		return texture;
+	}
+
+	void SetQuad(RenderBackend& renderer)
+	{
+		MeshBuffers mesh;
+		mesh.vertices = QUAD_VERTICES;
+		mesh.indices = QUAD_INDICES;
+		mesh.vertexStride = sizeof(Vertex);
+		mesh.positionOffset = offsetof(Vertex, position);
+		mesh.texcoordOffset = offsetof(Vertex, texcoord);
+		mesh.vertexCount = (uint)std::size(QUAD_VERTICES);
+		mesh.indexCount = (uint)std::size(QUAD_INDICES);
+		renderer.SetMesh(mesh);
+	}
+
+	void DrawQuad(RenderBackend& renderer, const Math::Matrix4& worldMatrix, const uchar color[4], bool reversed)
+	{
+		Math::Matrix4 projectionMatrix;
+		renderer.GetProjectionMatrix(projectionMatrix);
+		renderer.SetTransforms(worldMatrix, Math::Identity(), projectionMatrix, Math::Float2(0.0f, 0.0f));
+		renderer.SetTexture(0u, Bind(color));
+		renderer.DrawIndexed(QUAD_INDEX_COUNT, reversed ? REVERSED_START : 0u, 0);
+	}
+
+	void BeginFrame(RenderBackend& renderer)
+	{
+		renderer.BeginScene(CLEAR[0] / 255.0f, CLEAR[1] / 255.0f, CLEAR[2] / 255.0f, CLEAR[3] / 255.0f);
+		SetQuad(renderer);
+	}
+
+	// The near quad, then the far one behind it, then a quad in front of both wound the wrong way, or the right way
+	// when frontFacing is set.
+	void DrawScene(RenderBackend& renderer, bool frontFacing)
+	{
+		BeginFrame(renderer);
+		DrawQuad(renderer, Place(NEAR_POSITION, 1.0f), RED, false);
+		DrawQuad(renderer, Place(FAR_POSITION, FAR_SCALE), BLUE, false);
+		DrawQuad(renderer, Place(FRONT_POSITION, FRONT_SCALE), GREEN, !frontFacing);
+		renderer.EndScene();
+	}
+
+	SoftwareRenderer::InitParams DescribeRenderer()
+	{
+		SoftwareRenderer::InitParams initParams;
+		initParams.screenWidth = WIDTH;
+		initParams.screenHeight = HEIGHT;
+		initParams.screenNear = SCREEN_NEAR;
+		initParams.screenFar = SCREEN_FAR;
+		return initParams;
+	}
+
+	bool Report(std::ostream& output, const char* name, bool match)
+	{
+		output << std::format("{}: {}", name, match ? "OK" : "MISMATCH") << std::endl;
+		return match;
+	}
+}
+
+bool RunSoftwareRendererCheck(std::ostream& output)
+{
+	// Count what the present callback is handed.
+	uint presents = 0u;
+	bool presentedFrame = true;
+	SoftwareRenderer* presenting = nullptr;
+	SoftwareRenderer::InitParams initParams = DescribeRenderer();
+	initParams.present = [&](const std::vector<uint32_t>& color, uint width, uint height)
+	{
+		presents++;
+		presentedFrame = presentedFrame && width == WIDTH && height == HEIGHT && &color == &presenting->GetColorBuffer();
+	};
+	SoftwareRenderer renderer(initParams);
+	presenting = &renderer;
+	RenderBackend& backend = renderer;
+	output << std::format("Software renderer at {}x{} on {} threads", WIDTH, HEIGHT, renderer.GetRasterizer().GetThreadCount()) << std::endl;
+
+	bool allMatch = Report(output, "The backend drives no Direct3D device", !backend.GetD3DContext() && !backend.GetGpuTimer());
+
+	Math::Matrix4 projectionMatrix;
+	backend.GetProjectionMatrix(projectionMatrix);
+
+	// The near quad stays in front of the far one drawn after it, and the wrongly wound quad in front is culled.
+	DrawScene(backend, false);
+	allMatch = Report(output, "Clear color where nothing is drawn", ColorNear(renderer.GetColorBuffer()[0], CLEAR) &&
+		ColorNear(ColorAt(renderer, BACKGROUND_POINT, projectionMatrix), CLEAR)) && allMatch;
+	allMatch = Report(output, "Near quad in front of the far quad drawn after it", ColorNear(ColorAt(renderer, OVERLAP_POINT, projectionMatrix), RED) &&
+		ColorNear(ColorAt(renderer, NEAR_ONLY_POINT, projectionMatrix), RED) && ColorNear(ColorAt(renderer, FAR_ONLY_POINT, projectionMatrix), BLUE)) && allMatch;
+
+	// Depth is the projected z over w of each quad's plane, and 1 where the clear left it.
+	Math::Float4 nearClip = Math::TransformPoint(NEAR_ONLY_POINT, projectionMatrix);
+	Math::Float4 farClip = Math::TransformPoint(FAR_ONLY_POINT, projectionMatrix);
+	allMatch = Report(output, "Depth matches the projection", fabsf(DepthAt(renderer, NEAR_ONLY_POINT, projectionMatrix) - nearClip.z / nearClip.w) <= DEPTH_TOLERANCE &&
+		fabsf(DepthAt(renderer, FAR_ONLY_POINT, projectionMatrix) - farClip.z / farClip.w) <= DEPTH_TOLERANCE &&
+		DepthAt(renderer, BACKGROUND_POINT, projectionMatrix) == 1.0f) && allMatch;
+
+	bool culled = ColorNear(ColorAt(renderer, OVERLAP_POINT, projectionMatrix), RED);
+	DrawScene(backend, true);
+	allMatch = Report(output, "A back facing quad is culled and the same quad facing the camera is drawn",
+		culled && ColorNear(ColorAt(renderer, OVERLAP_POINT, projectionMatrix), GREEN)) && allMatch;
+
+	// Instances replace the world matrix, from the start instance on.
+	InstanceData instanceData[3];
+	for (uint i = 0u; i < 3u; ++i)
+		instanceData[i].world = Place(Math::Float3(((float)i - 1.0f) * INSTANCE_SPACING, 0.0f, INSTANCE_DEPTH), INSTANCE_SCALE);
+	InstanceBuffers instances;
+	instances.instances = instanceData;
+	instances.instanceCount = 3u;
+
+	BeginFrame(backend);
+	backend.SetTransforms(Math::Identity(), Math::Identity(), projectionMatrix, Math::Float2(0.0f, 0.0f));
+	backend.SetTexture(0u, Bind(RED));
+	backend.SetInstances(instances);
+	backend.DrawIndexedInstanced(QUAD_INDEX_COUNT, 2u, 0u, 0, 1u);
+	backend.EndScene();
+	allMatch = Report(output, "Instanced draws place each instance by its world matrix",
+		ColorNear(ColorAt(renderer, Math::Float3(-INSTANCE_SPACING, 0.0f, INSTANCE_DEPTH), projectionMatrix), CLEAR) &&
+		ColorNear(ColorAt(renderer, Math::Float3(0.0f, 0.0f, INSTANCE_DEPTH), projectionMatrix), RED) &&
+		ColorNear(ColorAt(renderer, Math::Float3(INSTANCE_SPACING, 0.0f, INSTANCE_DEPTH), projectionMatrix), RED) &&
+		ColorNear(ColorAt(renderer, Math::Float3(INSTANCE_SPACING * 0.5f, 0.0f, INSTANCE_DEPTH), projectionMatrix), CLEAR)) && allMatch;
+
+	// Texture offsets are added to the texture coordinates, per object through SetTransforms and per instance from the
+	// instance data, as texture.vs and textureInstanced.vs do. A quarter of the way across each quad is the middle of
+	// the red half without an offset and of the green half with one.
+	instanceData[1].textureOffset = Math::Float2(0.0f, 0.0f);
+	instanceData[2].textureOffset = HALF_OFFSET;
+
+	BeginFrame(backend);
+	backend.SetTransforms(Place(OFFSET_POSITION, 1.0f), Math::Identity(), projectionMatrix, HALF_OFFSET);
+	backend.SetTexture(0u, Bind(STRIPES, STRIPES_WIDTH));
+	backend.DrawIndexed(QUAD_INDEX_COUNT, 0u, 0);
+	backend.SetTransforms(Math::Identity(), Math::Identity(), projectionMatrix, Math::Float2(0.0f, 0.0f));
+	backend.SetInstances(instances);
+	backend.DrawIndexedInstanced(QUAD_INDEX_COUNT, 2u, 0u, 0, 1u);
+	backend.EndScene();
+	float quarterWidth = 0.5f * INSTANCE_SCALE;
+	allMatch = Report(output, "Texture offsets shift the texture coordinates of objects and instances",
+		ColorNear(ColorAt(renderer, Math::Float3(OFFSET_POSITION.x - 0.5f, OFFSET_POSITION.y, OFFSET_POSITION.z), projectionMatrix), GREEN) &&
+		ColorNear(ColorAt(renderer, Math::Float3(-quarterWidth, 0.0f, INSTANCE_DEPTH), projectionMatrix), RED) &&
+		ColorNear(ColorAt(renderer, Math::Float3(INSTANCE_SPACING - quarterWidth, 0.0f, INSTANCE_DEPTH), projectionMatrix), GREEN)) && allMatch;
+
+	allMatch = Report(output, std::format("The present callback got all {} frames", presents).c_str(), presents == 4u && presentedFrame) && allMatch;
+
+	// Tiles are owned by one worker each, so the frame is the same bit for bit on any number of threads.
+	SoftwareRenderer singleThread(DescribeRenderer(), 1u);
+	DrawScene(singleThread, false);
+	DrawScene(renderer, false);
+	allMatch = Report(output, std::format("One thread draws the same frame as {}", renderer.GetRasterizer().GetThreadCount()).c_str(),
+		singleThread.GetColorBuffer() == renderer.GetColorBuffer() && singleThread.GetDepthBuffer() == renderer.GetDepthBuffer()) && allMatch;
+
+	return allMatch;
+}
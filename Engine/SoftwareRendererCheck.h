@@ -0,0 +1,12 @@
+#pragma once
+
+#include <ostream>
+#include "Common.h"
+
+// Renders frames with SoftwareRenderer through the RenderBackend interface, without a window or Direct3D, and checks
+// the pixels: the clear color where nothing is drawn, a near quad in front of a far one drawn after it, a quad wound
+// the wrong way culled, the depth buffer against the projection, instanced draws placed by their instance data, the
+// same frame from one thread and from every thread, and the present callback handed each finished frame.
+// Run with "Engine.exe -check-software-renderer", or "Engine -check-software-renderer" on systems without Windows.
+// Returns false if any check fails.
+bool RunSoftwareRendererCheck(std::ostream& output);
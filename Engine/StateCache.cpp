@@ -0,0 +1,129 @@
+#include "StateCache.h"
+
+template <class T>
+bool StateCache::Binding<T>::Update(T newValue)
+{
+	if (known && value == newValue)
+		return false;
+
+	value = newValue;
+	known = true;
+	return true;
+}
+
+StateCache::StateCache(ID3D11DeviceContext* deviceContext)
+	: _deviceContext(deviceContext)
+{
+}
+
+void StateCache::BeginFrame()
+{
+	Invalidate();
+	_stats = Stats();
+}
+
+void StateCache::Invalidate()
+{
+	_layout.known = false;
+	for (auto& vertexBuffer : _vertexBuffers)
+		vertexBuffer.known = false;
+	for (auto& vertexStride : _vertexStrides)
+		vertexStride.known = false;
+	_indexBuffer.known = false;
+	_indexFormat.known = false;
+	_topology.known = false;
+	_vertexShader.known = false;
+	_pixelShader.known = false;
+	for (StageBindings& stage : _stages)
+	{
+		for (auto& sampler : stage.samplers)
+			sampler.known = false;
+		for (auto& view : stage.views)
+			view.known = false;
+	}
+}
+
+void StateCache::AddStats(const Stats& stats)
+{
+	_stats.bindsThisFrame += stats.bindsThisFrame;
+	_stats.skippedThisFrame += stats.skippedThisFrame;
+}
+
+void StateCache::SetInputLayout(ID3D11InputLayout* layout)
+{
+	if (Count(_layout.Update(layout)))
+		_deviceContext->IASetInputLayout(layout);
+}
+
+void StateCache::SetVertexBuffer(uint slot, ID3D11Buffer* buffer, uint stride)
+{
+	// Both have to be compared, so neither update may be skipped.
+	if (slot < D3D11_IA_VERTEX_INPUT_RESOURCE_SLOT_COUNT && !Count(_vertexBuffers[slot].Update(buffer) | _vertexStrides[slot].Update(stride)))
+		return;
+
+	uint offset = 0u;
+	_deviceContext->IASetVertexBuffers(slot, 1, &buffer, &stride, &offset);
+}
+
+void StateCache::SetIndexBuffer(ID3D11Buffer* buffer, DXGI_FORMAT format)
+{
+	if (Count(_indexBuffer.Update(buffer) | _indexFormat.Update(format)))
+		_deviceContext->IASetIndexBuffer(buffer, format, 0);
+}
+
+void StateCache::SetPrimitiveTopology(D3D11_PRIMITIVE_TOPOLOGY topology)
+{
+	if (Count(_topology.Update(topology)))
+		_deviceContext->IASetPrimitiveTopology(topology);
+}
+
+void StateCache::SetVertexShader(ID3D11VertexShader* shader)
+{
+	if (Count(_vertexShader.Update(shader)))
+		_deviceContext->VSSetShader(shader, nullptr, 0);
+}
+
+void StateCache::SetPixelShader(ID3D11PixelShader* shader)
+{
+	if (Count(_pixelShader.Update(shader)))
+		_deviceContext->PSSetShader(shader, nullptr, 0);
+}
+
+void StateCache::SetSampler(Stage stage, uint slot, ID3D11SamplerState* sampler)
+{
+	// Slots past the shadow copy are always bound; the runtime rejects them anyway.
+	StageBindings& bindings = _stages[(uint)stage];
+	if (slot < D3D11_COMMONSHADER_SAMPLER_SLOT_COUNT && !Count(bindings.samplers[slot].Update(sampler)))
+		return;
+
+	if (stage == Stage::Vertex)
+		_deviceContext->VSSetSamplers(slot, 1, &sampler);
+	else
+		_deviceContext->PSSetSamplers(slot, 1, &sampler);
+}
+
+void StateCache::SetShaderResource(Stage stage, uint slot, ID3D11ShaderResourceView* view)
+{
+	StageBindings& bindings = _stages[(uint)stage];
+	if (slot < D3D11_COMMONSHADER_INPUT_RESOURCE_SLOT_COUNT && !Count(bindings.views[slot].Update(view)))
+		return;
+
+	if (stage == Stage::Vertex)
+		_deviceContext->VSSetShaderResources(slot, 1, &view);
+	else
+		_deviceContext->PSSetShaderResources(slot, 1, &view);
+}
+
+const StateCache::Stats& StateCache::GetStats() const
+{
+	return _stats;
+}
+
+bool StateCache::Count(bool changed)
+{
+	if (changed)
+		_stats.bindsThisFrame++;
+	else
+		_stats.skippedThisFrame++;
+	return changed;
+}
@@ -0,0 +1,88 @@
+#pragma once
+
+#include <d3d11.h>
+
+#include "Common.h"
+
+// Shadow copy of the input assembler, shader, sampler and shader resource bindings of a device context. Everything
+// bound through the cache is compared with what is already bound, and only bindings that change anything reach the
+// context. Sorted draws still repeat bindings at the edges of their groups (two materials with the same texture, two
+// programs with the same input layout or sampler), and those cost a comparison instead of a runtime call.
+//
+// Objects are compared by pointer. A bound object cannot be destroyed and its address reused, since the context holds
+// a reference to it. Bindings made on the context directly are not seen, so the cache is emptied at the start of
+// every frame with BeginFrame, and with Invalidate whenever something else clears the context's state.
+class StateCache
+{
+public:
+
+	enum class Stage
+	{
+		Vertex,
+		Pixel
+	};
+
+	struct Stats
+	{
+		uint bindsThisFrame = 0u;
+		uint skippedThisFrame = 0u; // Redundant bindings that never reached the context.
+	};
+
+	StateCache(ID3D11DeviceContext* deviceContext);
+
+	// Forgets what is bound and resets the frame's counts.
+	void BeginFrame();
+
+	// Forgets what is bound, keeping the counts.
+	void Invalidate();
+
+	// Adds the counts of another cache, such as one of a deferred context whose commands this context replays.
+	void AddStats(const Stats& stats);
+
+	void SetInputLayout(ID3D11InputLayout* layout);
+	void SetVertexBuffer(uint slot, ID3D11Buffer* buffer, uint stride);
+	void SetIndexBuffer(ID3D11Buffer* buffer, DXGI_FORMAT format);
+	void SetPrimitiveTopology(D3D11_PRIMITIVE_TOPOLOGY topology);
+	void SetVertexShader(ID3D11VertexShader* shader);
+	void SetPixelShader(ID3D11PixelShader* shader);
+	void SetSampler(Stage stage, uint slot, ID3D11SamplerState* sampler);
+	void SetShaderResource(Stage stage, uint slot, ID3D11ShaderResourceView* view);
+
+	const Stats& GetStats() const;
+
+private:
+
+	// One bound value and whether it is known; nothing is known until it has been bound through the cache.
+	template <class T>
+	struct Binding
+	{
+		T value{};
+		bool known = false;
+
+		// Records the value and returns true if it differs from what is bound.
+		bool Update(T newValue);
+	};
+
+	struct StageBindings
+	{
+		Binding<ID3D11SamplerState*> samplers[D3D11_COMMONSHADER_SAMPLER_SLOT_COUNT];
+		Binding<ID3D11ShaderResourceView*> views[D3D11_COMMONSHADER_INPUT_RESOURCE_SLOT_COUNT];
+	};
+
+	// Counts the binding and returns changed.
+	bool Count(bool changed);
+
+	ID3D11DeviceContext* _deviceContext = nullptr;
+
+	Binding<ID3D11InputLayout*> _layout;
+	Binding<ID3D11Buffer*> _vertexBuffers[D3D11_IA_VERTEX_INPUT_RESOURCE_SLOT_COUNT];
+	Binding<uint> _vertexStrides[D3D11_IA_VERTEX_INPUT_RESOURCE_SLOT_COUNT];
+	Binding<ID3D11Buffer*> _indexBuffer;
+	Binding<DXGI_FORMAT> _indexFormat;
+	Binding<D3D11_PRIMITIVE_TOPOLOGY> _topology;
+	Binding<ID3D11VertexShader*> _vertexShader;
+	Binding<ID3D11PixelShader*> _pixelShader;
+	StageBindings _stages[2];
+
+	Stats _stats;
+};
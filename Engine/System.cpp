@@ -24,6 +24,10 @@ System::System()
 
 System::~System()
 {
+	// Keep the last frames for a look in a trace viewer.
+	if (*PROFILE_TRACE && !Profiler::Get().WriteChromeTrace(PROFILE_TRACE))
+		std::cout << std::format("Could not write the profile trace {}", PROFILE_TRACE) << std::endl;
+
 	// Shutdown the window.
 	ShutdownWindows();
 }
@@ -40,11 +44,13 @@ void System::Run()
 	done = false;
 	while (!done)
 	{
-		// Handle the windows messages.
-		if (PeekMessage(&msg, nullptr, 0, 0, PM_REMOVE))
+		// Handle every windows message waiting, since the frame loop now paces frames and one a frame would lag input.
+		while (PeekMessage(&msg, nullptr, 0, 0, PM_REMOVE))
 		{
 			TranslateMessage(&msg);
 			DispatchMessage(&msg);
+			if (msg.message == WM_QUIT)
+				break;
 		}
 
 		// If windows signals to end the application then exit out.
@@ -54,8 +60,9 @@ void System::Run()
 		}
 		else
 		{
-			// Otherwise do the frame processing.
+			// Otherwise do the frame processing, which waits for the frame rate limit.
 			result = Frame();
+			Profiler::Get().EndFrame();
 			if (!result)
 			{
 				done = true;
@@ -66,6 +73,8 @@ void System::Run()
 
 bool System::Frame()
 {
+	PROFILE_SCOPE("System::Frame");
+
 	// Check if the user pressed escape and wants to exit the application.
 	if (_input.IsKeyDown(VK_ESCAPE))
 	{
@@ -96,6 +105,14 @@ LRESULT CALLBACK System::MessageHandler(HWND hwnd, UINT umsg, WPARAM wparam, LPA
 		return 0;
 	}
 
+	// Check if the left mouse button has been pressed in the window.
+	case WM_LBUTTONDOWN:
+	{
+		// The low and high words of lparam hold the signed client position of the cursor.
+		_input.MouseClick((short)LOWORD(lparam), (short)HIWORD(lparam));
+		return 0;
+	}
+
 	// Any other messages send to the default message handler as our application won't make use of them.
 	default:
 	{
@@ -0,0 +1,305 @@
+#include "TargaDecoder.h"
+#include "PixelConvert.h"
+
+#include <algorithm>
+#include <string.h>
+
+namespace
+{
+	const size_t HEADER_SIZE = 18u;
+
+	uint ReadUint16(const uchar* data)
+	{
+		return (uint)data[0] | ((uint)data[1] << 8);
+	}
+
+	uint32_t PackRgba(uint red, uint green, uint blue, uint alpha)
+	{
+		// Memory order is R, G, B, A.
+		return red | (green << 8) | (blue << 16) | (alpha << 24);
+	}
+
+	uint Expand5To8(uint value)
+	{
+		return (value << 3) | (value >> 2);
+	}
+}
+
+TargaDecoder::TargaDecoder(const char* filename)
+	: _file(filename, std::ios::binary)
+{
+	if (!_file)
+		return;
+
+	_chunk.resize(CHUNK_SIZE);
+	_buffer = _chunk.data();
+	_isValid = ReadHeader();
+}
+
+TargaDecoder::TargaDecoder(const uchar* data, size_t size)
+	: _buffer(data)
+	, _chunkSize(size)
+{
+	_isValid = ReadHeader();
+}
+
+bool TargaDecoder::ReadHeader()
+{
+	if (!Ensure(HEADER_SIZE))
+		return false;
+
+	const uchar* header = _buffer + _chunkPosition;
+	uint idLength = header[0];
+	uint colorMapType = header[1];
+	uint imageType = header[2];
+	uint colorMapFirstEntry = ReadUint16(header + 3);
+	uint colorMapLength = ReadUint16(header + 5);
+	uint colorMapEntryBits = header[7];
+	_width = (ushort)ReadUint16(header + 12);
+	_height = (ushort)ReadUint16(header + 14);
+	_pixelBits = header[16];
+	uint descriptor = header[17];
+	_chunkPosition += HEADER_SIZE;
+
+	if (_width == 0u || _height == 0u)
+		return false;
+
+	// Image types 1-3 are uncompressed, 9-11 the same with run length encoding.
+	_rle = imageType >= 9u;
+	switch (imageType & 7u)
+	{
+	case 1u: _kind = PixelKind::Indexed; break;
+	case 2u: _kind = PixelKind::TrueColor; break;
+	case 3u: _kind = PixelKind::Greyscale; break;
+	default: return false;
+	}
+
+	// Bit 4 of the descriptor flips the image horizontally, bit 5 stores it top-down instead of bottom-up.
+	_rightToLeft = (descriptor & 0x10u) != 0u;
+	_topToBottom = (descriptor & 0x20u) != 0u;
+	_hasAlpha = (descriptor & 0x0Fu) != 0u;
+
+	switch (_kind)
+	{
+	case PixelKind::Greyscale:
+		if (_pixelBits != 8u)
+			return false;
+		break;
+	case PixelKind::Indexed:
+		if (colorMapType != 1u || (_pixelBits != 8u && _pixelBits != 16u))
+			return false;
+		break;
+	case PixelKind::TrueColor:
+		if (_pixelBits != 15u && _pixelBits != 16u && _pixelBits != 24u && _pixelBits != 32u)
+			return false;
+		// 32-bit files traditionally carry alpha even when the descriptor does not announce it.
+		if (_pixelBits == 32u)
+			_hasAlpha = true;
+		break;
+	}
+	_pixelBytes = (_pixelBits + 7u) / 8u;
+
+	// Skip the image ID field.
+	while (idLength > 0u)
+	{
+		if (!Ensure(1u))
+			return false;
+		size_t skip = std::min<size_t>(idLength, _chunkSize - _chunkPosition);
+		_chunkPosition += skip;
+		idLength -= (uint)skip;
+	}
+
+	// A color map may be present even on true color images; it must be read past either way.
+	if (colorMapType == 1u)
+	{
+		if (!ReadColorMap(colorMapFirstEntry, colorMapLength, colorMapEntryBits))
+			return false;
+	}
+
+	return true;
+}
+
+bool TargaDecoder::ReadColorMap(uint firstEntry, uint length, uint entryBits)
+{
+	if (entryBits != 15u && entryBits != 16u && entryBits != 24u && entryBits != 32u)
+		return false;
+
+	uint entryBytes = (entryBits + 7u) / 8u;
+
+	// Entries before firstEntry are not stored; indices below it map to transparent black.
+	_palette.assign(firstEntry + length, 0u);
+	for (uint i = 0u; i < length; ++i)
+	{
+		if (!Ensure(entryBytes))
+			return false;
+
+		_palette[firstEntry + i] = ConvertColor(_buffer + _chunkPosition, entryBits);
+		_chunkPosition += entryBytes;
+	}
+
+	return true;
+}
+
+bool TargaDecoder::IsValid() const
+{
+	return _isValid;
+}
+
+ushort TargaDecoder::GetWidth() const
+{
+	return _width;
+}
+
+ushort TargaDecoder::GetHeight() const
+{
+	return _height;
+}
+
+bool TargaDecoder::Ensure(size_t count)
+{
+	if (_chunkSize - _chunkPosition >= count)
+		return true;
+
+	// A file in memory is buffered in full already.
+	if (!_file.is_open())
+		return false;
+
+	// Move the unread tail to the front and fill the rest of the chunk from the file.
+	size_t remaining = _chunkSize - _chunkPosition;
+	memmove(_chunk.data(), _buffer + _chunkPosition, remaining);
+	_chunkPosition = 0u;
+	_chunkSize = remaining;
+
+	_file.read((char*)_chunk.data() + _chunkSize, (std::streamsize)(_chunk.size() - _chunkSize));
+	_chunkSize += (size_t)_file.gcount();
+
+	return _chunkSize >= count;
+}
+
+uint32_t TargaDecoder::ConvertColor(const uchar* source, uint bits) const
+{
+	switch (bits)
+	{
+	case 15u:
+	case 16u:
+	{
+		// A1R5G5B5, little endian.
+		uint value = ReadUint16(source);
+		uint alpha = (bits == 16u && _hasAlpha) ? ((value & 0x8000u) ? 255u : 0u) : 255u;
+		return PackRgba(Expand5To8((value >> 10) & 0x1Fu), Expand5To8((value >> 5) & 0x1Fu), Expand5To8(value & 0x1Fu), alpha);
+	}
+	case 24u:
+		return PackRgba(source[2], source[1], source[0], 255u);
+	default:
+		return PackRgba(source[2], source[1], source[0], source[3]);
+	}
+}
+
+uint32_t TargaDecoder::ReadPixel(const uchar* source) const
+{
+	switch (_kind)
+	{
+	case PixelKind::Greyscale:
+		return PackRgba(source[0], source[0], source[0], 255u);
+	case PixelKind::Indexed:
+	{
+		uint index = _pixelBits == 8u ? source[0] : ReadUint16(source);
+		return index < _palette.size() ? _palette[index] : 0u;
+	}
+	default:
+		return ConvertColor(source, _pixelBits);
+	}
+}
+
+void TargaDecoder::StorePixel(uint32_t* row, uint x, uint32_t pixel) const
+{
+	row[_rightToLeft ? _width - 1u - x : x] = pixel;
+}
+
+bool TargaDecoder::DecodePixels(uint32_t* row, uint x, uint count)
+{
+	while (count > 0u)
+	{
+		if (!Ensure(_pixelBytes))
+			return false;
+
+		uint available = (uint)std::min<size_t>(count, (_chunkSize - _chunkPosition) / _pixelBytes);
+		const uchar* source = _buffer + _chunkPosition;
+
+		if (_kind == PixelKind::TrueColor && _pixelBits == 32u && !_rightToLeft)
+		{
+			// The common case is a straight BGRA to RGBA swizzle of the whole run.
+			PixelConvert::BgraToRgba(source, (uchar*)(row + x), available);
+		}
+		else
+		{
+			for (uint i = 0u; i < available; ++i)
+				StorePixel(row, x + i, ReadPixel(source + i * _pixelBytes));
+		}
+
+		_chunkPosition += (size_t)available * _pixelBytes;
+		x += available;
+		count -= available;
+	}
+
+	return true;
+}
+
+bool TargaDecoder::Decode(uchar* destination)
+{
+	if (!_isValid)
+		return false;
+
+	for (uint sourceRow = 0u; sourceRow < _height; ++sourceRow)
+	{
+		// Bottom-up images fill the destination from the last row.
+		uint destinationRow = _topToBottom ? sourceRow : _height - 1u - sourceRow;
+		uint32_t* row = (uint32_t*)(destination + (size_t)destinationRow * _width * 4u);
+
+		if (!_rle)
+		{
+			if (!DecodePixels(row, 0u, _width))
+				return false;
+			continue;
+		}
+
+		uint x = 0u;
+		while (x < _width)
+		{
+			if (_packetRemaining == 0u)
+			{
+				// Packet header: the high bit marks a run of one repeated pixel, the low seven bits hold the count minus one.
+				if (!Ensure(1u))
+					return false;
+
+				uchar packetHeader = _buffer[_chunkPosition++];
+				_packetIsRun = (packetHeader & 0x80u) != 0u;
+				_packetRemaining = (packetHeader & 0x7Fu) + 1u;
+
+				if (_packetIsRun)
+				{
+					if (!Ensure(_pixelBytes))
+						return false;
+					_runPixel = ReadPixel(_buffer + _chunkPosition);
+					_chunkPosition += _pixelBytes;
+				}
+			}
+
+			uint count = std::min(_packetRemaining, (uint)_width - x);
+			if (_packetIsRun)
+			{
+				for (uint i = 0u; i < count; ++i)
+					StorePixel(row, x + i, _runPixel);
+			}
+			else if (!DecodePixels(row, x, count))
+			{
+				return false;
+			}
+
+			_packetRemaining -= count;
+			x += count;
+		}
+	}
+
+	return true;
+}
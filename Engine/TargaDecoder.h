@@ -0,0 +1,71 @@
+#pragma once
+
+#include "Common.h"
+
+// Streaming TGA decoder. Handles uncompressed and RLE images (types 1/2/3 and 9/10/11) with 8-bit greyscale,
+// 8/16-bit palettized, 15/16-bit, 24-bit and 32-bit pixels, in either origin and horizontal order.
+// The file is read in fixed-size chunks and decoded straight into the caller's top-down RGBA8 buffer,
+// so decoding needs no memory beyond the destination image and one chunk. An image already in memory,
+// such as one in a mapped AssetArchive, is decoded in place without any chunk at all.
+class TargaDecoder
+{
+public:
+
+	static const size_t CHUNK_SIZE = 64u * 1024u;
+
+	// Opens the file and reads the header, image ID and color map. Check IsValid before decoding.
+	TargaDecoder(const char* filename);
+
+	// Decodes a whole TGA file held in memory. The data must outlive the decoder.
+	TargaDecoder(const uchar* data, size_t size);
+
+	bool IsValid() const;
+	ushort GetWidth() const;
+	ushort GetHeight() const;
+
+	// Decode the pixels into destination, which must hold GetWidth() * GetHeight() RGBA8 pixels.
+	// Returns false when the file is truncated or the RLE stream is corrupt.
+	bool Decode(uchar* destination);
+
+private:
+
+	enum class PixelKind
+	{
+		Greyscale,
+		Indexed,
+		TrueColor
+	};
+
+	bool ReadHeader();
+	bool ReadColorMap(uint firstEntry, uint length, uint entryBits);
+
+	// Make sure at least count bytes are buffered, reading the next chunk if needed.
+	bool Ensure(size_t count);
+	uint32_t ReadPixel(const uchar* source) const;
+	uint32_t ConvertColor(const uchar* source, uint bits) const;
+	bool DecodePixels(uint32_t* row, uint x, uint count);
+	void StorePixel(uint32_t* row, uint x, uint32_t pixel) const;
+
+	std::ifstream _file;
+	std::vector<uchar> _chunk;
+	const uchar* _buffer = nullptr; // The chunk, or the whole file when decoding from memory.
+	size_t _chunkPosition = 0u;
+	size_t _chunkSize = 0u;
+
+	PixelKind _kind = PixelKind::TrueColor;
+	bool _rle = false;
+	bool _topToBottom = false;
+	bool _rightToLeft = false;
+	bool _hasAlpha = false;
+	uint _pixelBits = 0u;
+	uint _pixelBytes = 0u;
+	std::vector<uint32_t> _palette;
+	ushort _width = 0u;
+	ushort _height = 0u;
+	bool _isValid = false;
+
+	// RLE packets may continue across rows, so the current packet is kept between rows.
+	uint _packetRemaining = 0u;
+	bool _packetIsRun = false;
+	uint32_t _runPixel = 0u;
+};
@@ -0,0 +1,386 @@
+#include "Terrain.h"
+#include "Model.h"
+
+#include <algorithm>
+#include <chrono>
+#include <float.h>
+#include <math.h>
+
+Terrain::Terrain(RenderBackend& renderer, Heightmap heightmap, const Desc& desc)
+	: _renderer(renderer)
+	, _heightmap(std::move(heightmap))
+	, _desc(desc)
+{
+	auto start = std::chrono::steady_clock::now();
+	const uint width = _heightmap.GetWidth(), height = _heightmap.GetHeight();
+
+	// Find how many levels it takes for one chunk to cover the whole map.
+	uint cells = std::max(std::max(width, height), 2u) - 1u;
+	uint levels = 1u;
+	while ((_desc.chunkCells << (levels - 1u)) < cells)
+		++levels;
+
+	// Lay the quadtree out breadth first, so every parent comes before its children. Children beyond the edge of the
+	// map are kept, empty, so every parent still has four.
+	_nodes.emplace_back();
+	_nodes[0].level = levels - 1u;
+	for (size_t i = 0u; i < _nodes.size(); ++i)
+	{
+		if (_nodes[i].level == 0u || _nodes[i].empty)
+			continue;
+
+		uint half = GetSize(_nodes[i]) / 2u;
+		_nodes[i].firstChild = (uint)_nodes.size();
+		for (uint child = 0u; child < 4u; ++child)
+		{
+			Node node;
+			node.level = _nodes[i].level - 1u;
+			node.x = _nodes[i].x + (child & 1u) * half;
+			node.z = _nodes[i].z + (child >> 1u) * half;
+			node.empty = node.x + 1u >= width || node.z + 1u >= height;
+			_nodes.push_back(std::move(node));
+		}
+	}
+
+	// Measure every chunk against the full map; the chunks are independent, so they are shared out on the job system.
+	std::vector<float> minimumHeights(_nodes.size(), 0.0f), maximumHeights(_nodes.size(), 0.0f);
+	JobSystem::GetDefault().ParallelFor((uint)_nodes.size(), 0u, [&](uint index)
+	{
+		Node& node = _nodes[index];
+		if (node.empty)
+			return;
+
+		node.error = MeasureError(node);
+		uint endX = std::min(node.x + GetSize(node), width - 1u), endZ = std::min(node.z + GetSize(node), height - 1u);
+		float minimum = FLT_MAX, maximum = -FLT_MAX;
+		for (uint z = node.z; z <= endZ; ++z)
+		{
+			for (uint x = node.x; x <= endX; ++x)
+			{
+				float sample = _heightmap.GetSample((int)x, (int)z);
+				minimum = std::min(minimum, sample);
+				maximum = std::max(maximum, sample);
+			}
+		}
+		minimumHeights[index] = minimum * _desc.heightScale;
+		maximumHeights[index] = maximum * _desc.heightScale;
+	});
+
+	// A parent is never closer to the map than its children, so refining always gets closer.
+	for (size_t i = _nodes.size(); i-- > 0u;)
+	{
+		if (_nodes[i].firstChild == NO_NODE)
+			continue;
+		for (uint child = 0u; child < 4u; ++child)
+			_nodes[i].error = std::max(_nodes[i].error, _nodes[_nodes[i].firstChild + child].error);
+	}
+
+	// Neighbours are at most the parent's error away from the map on one side and the chunk's own on the other, so
+	// twice the parent's error reaches any edge next to a chunk one level apart. At least one of the chunk's cells, so
+	// the skirts of flat ground have some height.
+	_nodes[0].skirtDepth = std::max(2.0f * _nodes[0].error, _desc.cellSize * (1u << _nodes[0].level));
+	for (Node& node : _nodes)
+	{
+		if (node.firstChild == NO_NODE)
+			continue;
+		for (uint child = 0u; child < 4u; ++child)
+		{
+			Node& childNode = _nodes[node.firstChild + child];
+			childNode.skirtDepth = std::max(2.0f * node.error, _desc.cellSize * (1u << childNode.level));
+		}
+	}
+
+	for (size_t i = 0u; i < _nodes.size(); ++i)
+	{
+		Node& node = _nodes[i];
+		if (node.empty)
+			continue;
+
+		float endX = (float)std::min(node.x + GetSize(node), std::max(width, 2u) - 1u);
+		float endZ = (float)std::min(node.z + GetSize(node), std::max(height, 2u) - 1u);
+		float bottom = minimumHeights[i] - node.skirtDepth;
+		node.bounds.center = Math::Float3((node.x + endX) * 0.5f * _desc.cellSize, (bottom + maximumHeights[i]) * 0.5f,
+			(node.z + endZ) * 0.5f * _desc.cellSize);
+		node.bounds.extents = Math::Float3((endX - node.x) * 0.5f * _desc.cellSize, (maximumHeights[i] - bottom) * 0.5f,
+			(endZ - node.z) * 0.5f * _desc.cellSize);
+		node.bounds.radius = sqrtf(node.bounds.extents.x * node.bounds.extents.x + node.bounds.extents.y * node.bounds.extents.y +
+			node.bounds.extents.z * node.bounds.extents.z);
+	}
+	_bounds = _nodes[0].bounds;
+
+	// The root is always resident, so there is always something to draw.
+	MeshData rootMesh;
+	BuildChunk(_heightmap, _desc, _nodes[0].x, _nodes[0].z, GetSize(_nodes[0]), _nodes[0].skirtDepth, rootMesh);
+	_nodes[0].model = std::make_unique<Model>(_renderer, rootMesh);
+	_nodes[0].state = State::Resident;
+	_residentCount = 1u;
+
+	_stats.levels = levels;
+	_stats.nodes = (uint)_nodes.size();
+	_stats.resident = _residentCount;
+	_stats.buildMilliseconds = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+}
+
+Terrain::~Terrain()
+{
+	// Jobs that have not started yet skip their chunk.
+	_stopping = true;
+	JobSystem::GetDefault().Wait(_building);
+}
+
+void Terrain::Update(const View& view)
+{
+	++_frame;
+	_stats.loadedThisFrame = 0u;
+	_stats.evictedThisFrame = 0u;
+
+	// Take the meshes the jobs have finished, and upload the oldest within this frame's budget.
+	{
+		std::lock_guard<std::mutex> lock(_loadedMutex);
+		for (Loaded& loaded : _loaded)
+			_uploads.push_back(std::move(loaded));
+		_loaded.clear();
+	}
+	while (!_uploads.empty() && _stats.loadedThisFrame < _desc.uploadsPerFrame)
+	{
+		Node& node = _nodes[_uploads.front().node];
+		node.model = std::make_unique<Model>(_renderer, _uploads.front().mesh);
+		node.state = State::Resident;
+		_uploads.pop_front();
+		_loadingCount--;
+		_residentCount++;
+		_stats.loadedThisFrame++;
+	}
+
+	// Choose the chunks to draw, noting the ones that should have been drawn but are not resident.
+	auto selectStart = std::chrono::steady_clock::now();
+	_visible.clear();
+	_requests.clear();
+	Select(0u, view);
+	_stats.selectMilliseconds = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - selectStart).count();
+
+	// Build the missing chunks coarsest first: until one is resident, nothing beneath it can be drawn either.
+	std::stable_sort(_requests.begin(), _requests.end(), [this](uint a, uint b) { return _nodes[a].level > _nodes[b].level; });
+	for (uint index : _requests)
+	{
+		if (_loadingCount >= _desc.maxLoading)
+			break;
+		if (_nodes[index].state == State::Unloaded)
+			Load(index);
+	}
+
+	// Over budget, release the chunks left unused for longest. Chunks this frame visited stay, even over budget.
+	if (_residentCount > _desc.residentBudget)
+	{
+		_evictable.clear();
+		for (uint i = 1u; i < (uint)_nodes.size(); ++i)
+		{
+			if (_nodes[i].state == State::Resident && _nodes[i].lastUsed != _frame)
+				_evictable.push_back(i);
+		}
+		std::sort(_evictable.begin(), _evictable.end(), [this](uint a, uint b) { return _nodes[a].lastUsed < _nodes[b].lastUsed; });
+
+		for (uint index : _evictable)
+		{
+			if (_residentCount <= _desc.residentBudget)
+				break;
+			_nodes[index].model.reset();
+			_nodes[index].state = State::Unloaded;
+			_residentCount--;
+			_stats.evictedThisFrame++;
+		}
+	}
+
+	const uint trianglesPerChunk = 2u * _desc.chunkCells * _desc.chunkCells + 8u * _desc.chunkCells;
+	_stats.chunks = (uint)_visible.size();
+	_stats.triangles = _stats.chunks * trianglesPerChunk;
+	_stats.missing = (uint)_requests.size();
+	_stats.resident = _residentCount;
+	_stats.loading = _loadingCount;
+}
+
+bool Terrain::IsIdle() const
+{
+	return _loadingCount == 0u && _stats.missing == 0u;
+}
+
+const std::vector<Terrain::Chunk>& Terrain::GetVisibleChunks() const
+{
+	return _visible;
+}
+
+const Bounds& Terrain::GetBounds() const
+{
+	return _bounds;
+}
+
+const Terrain::Desc& Terrain::GetDesc() const
+{
+	return _desc;
+}
+
+const Terrain::Stats& Terrain::GetStats() const
+{
+	return _stats;
+}
+
+void Terrain::BuildChunk(const Heightmap& heightmap, const Desc& desc, uint x, uint z, uint size, float skirtDepth, MeshData& mesh)
+{
+	const uint cells = desc.chunkCells;
+	const uint step = size / cells;
+	const uint row = cells + 1u;
+	const uint lastX = heightmap.GetWidth() > 1u ? heightmap.GetWidth() - 1u : 1u;
+	const uint lastZ = heightmap.GetHeight() > 1u ? heightmap.GetHeight() - 1u : 1u;
+
+	// The grid, row by row along z. Past the edge of the map the vertices stay on the edge. Textures repeat once a
+	// level 0 chunk, whatever the chunk's level.
+	mesh.vertices.clear();
+	mesh.indices.clear();
+	mesh.vertices.reserve(row * row + 4u * row);
+	for (uint r = 0u; r <= cells; ++r)
+	{
+		for (uint c = 0u; c <= cells; ++c)
+		{
+			uint sampleX = std::min(x + c * step, lastX), sampleZ = std::min(z + r * step, lastZ);
+			MeshData::Vertex vertex;
+			vertex.position[0] = sampleX * desc.cellSize;
+			vertex.position[1] = heightmap.GetSample((int)sampleX, (int)sampleZ) * desc.heightScale;
+			vertex.position[2] = sampleZ * desc.cellSize;
+			vertex.texcoord[0] = (float)sampleX / cells;
+			vertex.texcoord[1] = (float)sampleZ / cells;
+			mesh.vertices.push_back(vertex);
+		}
+	}
+	MeshData::AppendGridIndices(mesh.indices, cells, cells);
+
+	// Walk the edges counter-clockwise seen from above, so that every wall of the skirt faces out of the chunk: along
+	// the first row, up the last column, back along the last row and down the first column.
+	auto edgeVertex = [&](uint edge, uint i) -> uint
+	{
+		switch (edge)
+		{
+		case 0u: return i;
+		case 1u: return i * row + cells;
+		case 2u: return cells * row + cells - i;
+		default: return (cells - i) * row;
+		}
+	};
+	for (uint edge = 0u; edge < 4u; ++edge)
+	{
+		uint first = (uint)mesh.vertices.size();
+		for (uint i = 0u; i <= cells; ++i)
+		{
+			MeshData::Vertex vertex = mesh.vertices[edgeVertex(edge, i)];
+			vertex.position[1] -= skirtDepth;
+			mesh.vertices.push_back(vertex);
+		}
+		for (uint i = 0u; i < cells; ++i)
+		{
+			uint top = edgeVertex(edge, i), nextTop = edgeVertex(edge, i + 1u);
+			mesh.indices.insert(mesh.indices.end(), { top, nextTop, first + i, nextTop, first + i + 1u, first + i });
+		}
+	}
+}
+
+uint Terrain::GetSize(const Node& node) const
+{
+	return _desc.chunkCells << node.level;
+}
+
+float Terrain::MeasureError(const Node& node) const
+{
+	if (node.level == 0u)
+		return 0.0f;
+
+	const uint step = 1u << node.level;
+	const uint lastX = _heightmap.GetWidth() - 1u, lastZ = _heightmap.GetHeight() - 1u;
+
+	// Every cell is split along the diagonal from its second row to its second column, as MeshData::AppendGridIndices
+	// splits it; compare each height of the map in the cell with the triangle above it.
+	float error = 0.0f;
+	for (uint cellZ = node.z; cellZ < node.z + GetSize(node) && cellZ < lastZ; cellZ += step)
+	{
+		for (uint cellX = node.x; cellX < node.x + GetSize(node) && cellX < lastX; cellX += step)
+		{
+			float h00 = _heightmap.GetSample((int)cellX, (int)cellZ);
+			float h10 = _heightmap.GetSample((int)(cellX + step), (int)cellZ);
+			float h01 = _heightmap.GetSample((int)cellX, (int)(cellZ + step));
+			float h11 = _heightmap.GetSample((int)(cellX + step), (int)(cellZ + step));
+			for (uint j = 0u; j <= step && cellZ + j <= lastZ; ++j)
+			{
+				for (uint i = 0u; i <= step && cellX + i <= lastX; ++i)
+				{
+					float u = (float)i / step, v = (float)j / step;
+					float surface = u + v <= 1.0f ? h00 + u * (h10 - h00) + v * (h01 - h00) : h11 + (1.0f - u) * (h01 - h11) + (1.0f - v) * (h10 - h11);
+					error = std::max(error, fabsf(_heightmap.GetSample((int)(cellX + i), (int)(cellZ + j)) - surface));
+				}
+			}
+		}
+	}
+	return error * _desc.heightScale;
+}
+
+bool Terrain::Select(uint index, const View& view)
+{
+	Node& node = _nodes[index];
+	if (node.empty || (view.frustum && !view.frustum->Intersects(node.bounds)))
+		return true;
+	node.lastUsed = _frame;
+
+	// Project the error from the nearest point of the chunk's box; from inside it, any error is too much.
+	float dx = std::max(fabsf(view.position.x - node.bounds.center.x) - node.bounds.extents.x, 0.0f);
+	float dy = std::max(fabsf(view.position.y - node.bounds.center.y) - node.bounds.extents.y, 0.0f);
+	float dz = std::max(fabsf(view.position.z - node.bounds.center.z) - node.bounds.extents.z, 0.0f);
+	float distance = sqrtf(dx * dx + dy * dy + dz * dz);
+	float pixelError = distance > 0.0f ? node.error * view.projectionScale / distance : (node.error > 0.0f ? FLT_MAX : 0.0f);
+
+	if (node.firstChild != NO_NODE && pixelError > _desc.maxPixelError)
+	{
+		size_t mark = _visible.size();
+		bool complete = true;
+		for (uint child = 0u; child < 4u; ++child)
+			complete = Select(node.firstChild + child, view) && complete;
+		if (complete)
+			return true;
+
+		// Part of the area is not resident yet: this chunk stands in for all four children until it is.
+		_visible.resize(mark);
+		if (node.state != State::Resident)
+			return false;
+	}
+	else if (node.state != State::Resident)
+	{
+		_requests.push_back(index);
+		return false;
+	}
+
+	Chunk chunk;
+	chunk.model = node.model.get();
+	chunk.level = node.level;
+	chunk.x = node.x;
+	chunk.z = node.z;
+	chunk.size = GetSize(node);
+	chunk.pixelError = pixelError;
+	_visible.push_back(chunk);
+	return true;
+}
+
+void Terrain::Load(uint index)
+{
+	Node& node = _nodes[index];
+	node.state = State::Loading;
+	_loadingCount++;
+
+	uint x = node.x, z = node.z, size = GetSize(node);
+	float skirtDepth = node.skirtDepth;
+	JobSystem::GetDefault().RunInBackground([this, index, x, z, size, skirtDepth]
+	{
+		if (_stopping)
+			return;
+
+		Loaded loaded{ index, MeshData() };
+		BuildChunk(_heightmap, _desc, x, z, size, skirtDepth, loaded.mesh);
+		std::lock_guard<std::mutex> lock(_loadedMutex);
+		_loaded.push_back(std::move(loaded));
+	}, &_building);
+}
@@ -0,0 +1,167 @@
+#pragma once
+
+#include <atomic>
+#include <deque>
+#include <mutex>
+#include "Common.h"
+#include "Bounds.h"
+#include "EngineMath.h"
+#include "Frustum.h"
+#include "Heightmap.h"
+#include "JobSystem.h"
+#include "MeshData.h"
+#include "RenderBackend.h"
+
+class Model;
+
+// Heightmap terrain drawn as a quadtree of chunks. Every chunk is the same grid of chunkCells by chunkCells quads, from
+// MeshData::AppendGridIndices like Model's grid; a chunk at level L samples every 2^L-th height, so the root covers the
+// whole map coarsely and level 0 chunks follow it sample for sample. Terrain space has y up and the map's rows along z,
+// one cellSize apart, starting at the origin. Maps of chunkCells * 2^n + 1 samples a side fill the quadtree exactly;
+// on other maps the chunks over the far edges flatten their last cells onto the edge.
+//
+// - Each chunk knows its geometric error: how far its triangles are from any height of the full map beneath them,
+//   never less than its children's. Update refines a chunk into its four children while that error, projected at the
+//   chunk's distance from the camera, is more than maxPixelError pixels.
+// - Chunks drawn next to chunks of another level leave cracks along their shared edge. Every chunk hangs a skirt from
+//   its edges, a strip of wall reaching twice its parent's error down, which fills them.
+// - Chunk meshes are streamed. Only the root is built up front; Update builds the chunks the selection wants in
+//   background jobs, coarsest first, and hands up to uploadsPerFrame finished ones a frame to the GPU. Until all four
+//   children of a chunk are resident, the chunk itself is drawn. Beyond residentBudget chunks, those unused for the
+//   longest are released.
+//
+// Update and the accessors are for the render thread only.
+class Terrain
+{
+public:
+
+	struct Desc
+	{
+		uint chunkCells = 32u;			// Quads along each side of every chunk. A power of two.
+		float cellSize = 1.0f;			// Distance between neighbouring heights.
+		float heightScale = 64.0f;		// Height of a heightmap sample of 1.
+		float maxPixelError = 2.0f;		// Screen space error above which a chunk is replaced by its children.
+		uint residentBudget = 1024u;	// Chunks kept with a mesh; the least recently used beyond it are released.
+		uint maxLoading = 16u;			// Chunk meshes built by jobs at once.
+		uint uploadsPerFrame = 8u;		// Finished chunk meshes handed to the GPU per Update.
+	};
+
+	// Where the terrain is seen from, in terrain space.
+	struct View
+	{
+		Math::Float3 position;
+		float projectionScale = 1.0f;		// Viewport height over 2 tan(fovY / 2): pixels covered by a unit size at unit distance.
+		const Frustum* frustum = nullptr;	// Chunks outside it are neither drawn nor loaded. Null keeps them all.
+	};
+
+	// A chunk chosen by the last Update.
+	struct Chunk
+	{
+		Model* model = nullptr;
+		uint level = 0u;
+		uint x = 0u;			// Column and row of the heightmap sample at the chunk's corner.
+		uint z = 0u;
+		uint size = 0u;			// Heightmap cells along each side.
+		float pixelError = 0.0f;	// Geometric error projected from the view.
+	};
+
+	struct Stats
+	{
+		uint levels = 0u;
+		uint nodes = 0u;				// Chunks of the quadtree, resident or not.
+		uint chunks = 0u;				// Drawn by the last Update.
+		uint triangles = 0u;			// In those chunks, skirts included.
+		uint missing = 0u;				// Chunks the last Update wanted but drew coarser ones for, as they were not resident.
+		uint resident = 0u;
+		uint loading = 0u;
+		uint loadedThisFrame = 0u;
+		uint evictedThisFrame = 0u;
+		double buildMilliseconds = 0.0;		// Building the quadtree and its errors when the terrain was created.
+		double selectMilliseconds = 0.0;	// Choosing the chunks in the last Update.
+	};
+
+	Terrain(RenderBackend& renderer, Heightmap heightmap, const Desc& desc);
+
+	// Waits for the chunks still being built.
+	~Terrain();
+
+	Terrain(const Terrain&) = delete;
+	Terrain& operator=(const Terrain&) = delete;
+
+	// Uploads finished chunks, chooses the chunks to draw from the view, starts building the ones missing and releases
+	// those over the budget. Call once per frame.
+	void Update(const View& view);
+
+	// True when no chunk is being built or waiting for upload, and the last Update drew every chunk it wanted.
+	bool IsIdle() const;
+
+	const std::vector<Chunk>& GetVisibleChunks() const;
+
+	// Bounds of the whole terrain, skirts included, in terrain space.
+	const Bounds& GetBounds() const;
+	const Desc& GetDesc() const;
+	const Stats& GetStats() const;
+
+	// Builds the mesh of a chunk covering size cells from the heightmap sample (x, z), with its skirt skirtDepth deep.
+	static void BuildChunk(const Heightmap& heightmap, const Desc& desc, uint x, uint z, uint size, float skirtDepth, MeshData& mesh);
+
+private:
+
+	static const uint NO_NODE = ~0u;
+
+	enum class State
+	{
+		Unloaded,
+		Loading,
+		Resident
+	};
+
+	struct Node
+	{
+		uint level = 0u;
+		uint x = 0u;
+		uint z = 0u;
+		uint firstChild = NO_NODE;	// Its four children are consecutive.
+		bool empty = false;			// Entirely beyond the edge of the map.
+		float error = 0.0f;			// Geometric error in terrain units.
+		float skirtDepth = 0.0f;
+		Bounds bounds;
+		State state = State::Unloaded;
+		uint64_t lastUsed = 0u;		// Last frame the selection visited the node.
+		std::unique_ptr<Model> model;
+	};
+
+	struct Loaded
+	{
+		uint node;
+		MeshData mesh;
+	};
+
+	uint GetSize(const Node& node) const;
+	float MeasureError(const Node& node) const;
+	bool Select(uint index, const View& view);
+	void Load(uint index);
+
+	RenderBackend& _renderer;
+	Heightmap _heightmap;
+	Desc _desc;
+	std::vector<Node> _nodes;	// Parents before children; the root first.
+	Bounds _bounds;
+	uint64_t _frame = 0u;
+
+	// Scratch space of Update.
+	std::vector<Chunk> _visible;
+	std::vector<uint> _requests;
+	std::vector<uint> _evictable;
+
+	// Meshes finished by the build jobs, waiting for Update to take them.
+	JobSystem::Counter _building;
+	std::mutex _loadedMutex;
+	std::vector<Loaded> _loaded;
+	std::deque<Loaded> _uploads;	// Render thread only: taken from _loaded, waiting for upload budget.
+	std::atomic<bool> _stopping = false;
+
+	uint _loadingCount = 0u;
+	uint _residentCount = 0u;
+	Stats _stats;
+};
@@ -0,0 +1,214 @@
+#include "TerrainBenchmark.h"
+#include "RecordingBackend.h"
+#include "Terrain.h"
+
+#include <algorithm>
+#include <math.h>
+#include <random>
+#include <thread>
+
+namespace
+{
+	const uint MAP_SIZE = 2049u;
+	const float PIXEL_ERRORS[] = { 1.0f, 2.0f, 4.0f };
+	const uint FRAMES = 600u;
+	const uint SETTLE_UPDATES = 100000u;
+	const uint RESIDENT_BUDGET = 256u;	// Low enough for the flight to release chunks.
+	const float SCREEN_HEIGHT = 1080.0f;
+	const float ASPECT_RATIO = 16.0f / 9.0f;
+	const float FIELD_OF_VIEW = Math::PI / 4.0f;
+	const float CAMERA_ALTITUDE = 30.0f;
+	const uint RANDOM_SEED = 2049u;
+
+	// Octaves of smoothly interpolated random values, each twice as fine and half as high as the one before.
+	Heightmap MakeHeightmap(uint size)
+	{
+		std::mt19937 random(RANDOM_SEED);
+		std::uniform_real_distribution<float> distribution(0.0f, 1.0f);
+		std::vector<float> samples((size_t)size * size, 0.0f);
+		float amplitude = 1.0f, total = 0.0f;
+		for (uint lattice = 4u; lattice < size; lattice *= 2u)
+		{
+			std::vector<float> values((size_t)(lattice + 1u) * (lattice + 1u));
+			for (float& value : values)
+				value = distribution(random);
+
+			for (uint z = 0u; z < size; ++z)
+			{
+				float fz = (float)z * lattice / (size - 1u);
+				uint iz = std::min((uint)fz, lattice - 1u);
+				float tz = fz - iz;
+				tz = tz * tz * (3.0f - 2.0f * tz);
+				for (uint x = 0u; x < size; ++x)
+				{
+					float fx = (float)x * lattice / (size - 1u);
+					uint ix = std::min((uint)fx, lattice - 1u);
+					float tx = fx - ix;
+					tx = tx * tx * (3.0f - 2.0f * tx);
+					const float* row = &values[(size_t)iz * (lattice + 1u) + ix];
+					float bottom = row[0] + (row[1] - row[0]) * tx;
+					float top = row[lattice + 1u] + (row[lattice + 2u] - row[lattice + 1u]) * tx;
+					samples[(size_t)z * size + x] += amplitude * (bottom + (top - bottom) * tz);
+				}
+			}
+			total += amplitude;
+			amplitude *= 0.5f;
+		}
+
+		for (float& sample : samples)
+			sample /= total;
+		return Heightmap(size, size, std::move(samples));
+	}
+
+	// Diagonally across the map, a little above the ground, looking ahead and down.
+	Terrain::View MakeView(const Heightmap& heightmap, const Terrain::Desc& desc, uint frame, Math::Matrix4& viewProjection)
+	{
+		float t = (float)frame / (FRAMES - 1u);
+		float position = (0.1f + 0.8f * t) * (heightmap.GetWidth() - 1u);
+		float ground = heightmap.GetSample((int)position, (int)position) * desc.heightScale;
+
+		Terrain::View view;
+		view.position = Math::Float3(position * desc.cellSize, ground + CAMERA_ALTITUDE, position * desc.cellSize);
+		view.projectionScale = SCREEN_HEIGHT / (2.0f * tanf(FIELD_OF_VIEW * 0.5f));
+
+		Math::Matrix4 lookTo = Math::LookToLH(view.position, Math::Float3(1.0f, -0.3f, 1.0f), Math::Float3(0.0f, 1.0f, 0.0f));
+		viewProjection = Math::Multiply(lookTo, Math::PerspectiveFovLH(FIELD_OF_VIEW, ASPECT_RATIO, 0.3f, 5000.0f));
+		return view;
+	}
+
+	// Updates until every chunk the view wants is resident.
+	bool Settle(Terrain& terrain, const Terrain::View& view)
+	{
+		for (uint i = 0u; i < SETTLE_UPDATES; ++i)
+		{
+			terrain.Update(view);
+			if (terrain.IsIdle())
+				return true;
+			std::this_thread::yield();
+		}
+		return false;
+	}
+
+	// Every cell of the map under exactly one chunk, each chunk within the error it was chosen for unless nothing
+	// finer exists.
+	bool CheckCoverage(const Terrain& terrain, uint mapSize)
+	{
+		const uint cells = mapSize - 1u;
+		std::vector<uchar> covered((size_t)cells * cells, 0u);
+		for (const Terrain::Chunk& chunk : terrain.GetVisibleChunks())
+		{
+			if (chunk.level > 0u && chunk.pixelError > terrain.GetDesc().maxPixelError)
+				return false;
+
+			for (uint z = chunk.z; z < std::min(chunk.z + chunk.size, cells); ++z)
+			{
+				for (uint x = chunk.x; x < std::min(chunk.x + chunk.size, cells); ++x)
+					covered[(size_t)z * cells + x]++;
+			}
+		}
+		return std::all_of(covered.begin(), covered.end(), [](uchar count) { return count == 1u; });
+	}
+
+	// A level 0 chunk has one vertex per height of the map, then the skirt, and the expected triangles.
+	bool CheckChunk(const Heightmap& heightmap, const Terrain::Desc& desc)
+	{
+		const uint cells = desc.chunkCells, x = 5u * cells, z = 9u * cells;
+		MeshData mesh;
+		Terrain::BuildChunk(heightmap, desc, x, z, cells, 1.0f, mesh);
+		if (mesh.vertices.size() != (cells + 1u) * (cells + 5u) || mesh.indices.size() != (2u * cells * cells + 8u * cells) * 3u)
+			return false;
+
+		for (uint r = 0u; r <= cells; ++r)
+		{
+			for (uint c = 0u; c <= cells; ++c)
+			{
+				const MeshData::Vertex& vertex = mesh.vertices[r * (cells + 1u) + c];
+				if (vertex.position[0] != (x + c) * desc.cellSize || vertex.position[2] != (z + r) * desc.cellSize ||
+					vertex.position[1] != heightmap.GetSample((int)(x + c), (int)(z + r)) * desc.heightScale)
+					return false;
+			}
+		}
+		return std::all_of(mesh.indices.begin(), mesh.indices.end(), [&](uint index) { return index < mesh.vertices.size(); });
+	}
+}
+
+bool RunTerrainBenchmark(std::ostream& output)
+{
+	bool allMatch = true;
+	Heightmap heightmap = MakeHeightmap(MAP_SIZE);
+	const uint fullTriangles = 2u * (MAP_SIZE - 1u) * (MAP_SIZE - 1u);
+
+	Terrain::Desc chunkDesc;
+	bool chunkMatch = CheckChunk(heightmap, chunkDesc);
+	allMatch = allMatch && chunkMatch;
+
+	output << std::format("Terrain of {}x{} heights ({} triangles at full resolution), {} frames flying across it at {} pixels high",
+		MAP_SIZE, MAP_SIZE, fullTriangles, FRAMES, (uint)SCREEN_HEIGHT) << std::endl;
+	output << std::format("Level 0 chunk matches the map: {}", chunkMatch ? "OK" : "MISMATCH") << std::endl;
+
+	RecordingBackend renderer(0u);
+	for (float pixelError : PIXEL_ERRORS)
+	{
+		Terrain::Desc desc;
+		desc.maxPixelError = pixelError;
+		desc.residentBudget = RESIDENT_BUDGET;
+		Terrain terrain(renderer, heightmap, desc);
+
+		// Fly across, letting streaming catch up every frame so the counts do not depend on how fast the jobs run. The
+		// first update after each move is the one a frame would make.
+		double selectSum = 0.0, selectWorst = 0.0;
+		uint64_t chunkSum = 0u, triangleSum = 0u;
+		uint loads = 0u, evictions = 0u, worstResident = 0u;
+		bool settled = true;
+		Terrain::View view;
+		for (uint frame = 0u; frame < FRAMES; ++frame)
+		{
+			Math::Matrix4 viewProjection;
+			view = MakeView(heightmap, desc, frame, viewProjection);
+			Frustum frustum(viewProjection);
+			view.frustum = &frustum;
+
+			const Terrain::Stats& stats = terrain.GetStats();
+			for (uint update = 0u; ; ++update)
+			{
+				terrain.Update(view);
+				if (update == 0u)
+				{
+					selectSum += stats.selectMilliseconds;
+					selectWorst = std::max(selectWorst, stats.selectMilliseconds);
+				}
+				loads += stats.loadedThisFrame;
+				evictions += stats.evictedThisFrame;
+				worstResident = std::max(worstResident, stats.resident);
+				if (terrain.IsIdle())
+					break;
+				if (update == SETTLE_UPDATES)
+				{
+					settled = false;
+					break;
+				}
+				std::this_thread::yield();
+			}
+			chunkSum += stats.chunks;
+			triangleSum += stats.triangles;
+		}
+		view.frustum = nullptr;
+
+		// See the whole map from the last position, then check the chunks it ends up with.
+		settled = Settle(terrain, view) && settled;
+		const Terrain::Stats& stats = terrain.GetStats();
+		bool match = settled && CheckCoverage(terrain, MAP_SIZE);
+		allMatch = allMatch && match;
+
+		output << std::format("{} pixel error: {} levels, {} chunks, built in {:.1f} ms", pixelError, stats.levels, stats.nodes,
+			stats.buildMilliseconds) << std::endl;
+		output << std::format("  Flight: selection average {:.3f} ms, worst {:.3f} ms; {:.1f} chunks, {:.0f} triangles per frame ({:.2f}% of the map)",
+			selectSum / FRAMES, selectWorst, (double)chunkSum / FRAMES, (double)triangleSum / FRAMES,
+			100.0 * triangleSum / FRAMES / fullTriangles) << std::endl;
+		output << std::format("  Streaming: {} chunks loaded, {} released, at most {} resident for a budget of {}", loads, evictions,
+			worstResident, desc.residentBudget) << std::endl;
+		output << std::format("  Whole map from the last position: {} chunks, {} triangles, selection {:.3f} ms {}", stats.chunks,
+			stats.triangles, stats.selectMilliseconds, match ? "OK" : "MISMATCH") << std::endl;
+	}
+	return allMatch;
+}
@@ -0,0 +1,12 @@
+#pragma once
+
+#include <ostream>
+#include "Common.h"
+
+// Builds terrain from a fractal 2049x2049 heightmap for screen space errors of 1, 2 and 4 pixels and flies a camera
+// across it for 600 frames, reporting the LOD selection time per frame, the chunks and triangles drawn against the
+// full map's, and the chunks streamed in and released, letting streaming catch up every frame. Runs on a
+// RecordingBackend, so it needs no GPU. Checks that the chunks drawn for the whole map from the last position cover
+// every cell exactly once and meet the error they were chosen for, and that level 0 chunks follow the map exactly.
+// Run with "Engine.exe -benchmark-terrain". Returns false if any check fails.
+bool RunTerrainBenchmark(std::ostream& output);
@@ -1,39 +1,233 @@
 #include "Texture.h"
-#include <stdio.h>
+#include "MipGenerator.h"
+#include "BlockCompressor.h"
+#include "PixelConvert.h"
+#include "Profiler.h"
 
-Texture::Texture(ID3D11Device* device, ID3D11DeviceContext* deviceContext, const char* filename)
+#include <ctype.h>
+#include <string.h>
+
+#ifdef _WIN32
+#include "D3D.h"
+#endif
+
+Texture::Texture(ID3D11Device* device, const char* filename, Compression compression, const AssetArchive* archive)
+{
+	Image image;
+	if (Decode(filename, compression, archive, device != nullptr, image))
+		Upload(device, image);
+}
+
+Texture::Texture(ID3D11Device* device)
+{
+	Image image;
+	image.format = DdsFile::Format::R8G8B8A8;
+	image.width = 1u;
+	image.height = 1u;
+	image.pixels = { 128u, 128u, 128u, 255u };
+	image.levels.push_back(DdsFile::Level{ 1u, 1u, 4u, image.pixels.data() });
+	image.byteSize = 4u;
+
+	Upload(device, image);
+	_isResident = false;
+}
+
+Texture::~Texture() = default;
+
+bool Texture::Decode(const char* filename, Compression compression, const AssetArchive* archive, bool forDevice, Image& image)
+{
+	PROFILE_SCOPE("Texture::Decode");
+
+	// Assets in an archive are decoded straight from its mapping, loose files are read from disk.
+	AssetArchive::Asset asset;
+	if (archive)
+	{
+		asset = archive->Find(filename);
+		if (!asset.data)
+			return false;
+	}
+
+	// DDS files are already in their final format with their mip chain; anything else is read as TGA.
+	std::string name = filename;
+	std::string extension = name.size() >= 4u ? name.substr(name.size() - 4u) : "";
+	for (char& c : extension)
+		c = (char)tolower((uchar)c);
+	bool isDds = extension == ".dds";
+
+	if (isDds)
+	{
+		// A loose file is read into the image, so its levels can be uploaded in place just like from an archive.
+		if (!asset.data)
+		{
+			std::ifstream file(filename, std::ios::binary | std::ios::ate);
+			if (!file)
+				return false;
+
+			std::vector<uchar> contents((size_t)file.tellg());
+			file.seekg(0);
+			if (!file.read((char*)contents.data(), (std::streamsize)contents.size()))
+				return false;
+
+			image.storage.push_back(std::move(contents));
+			asset.data = image.storage.back().data();
+			asset.size = image.storage.back().size();
+		}
+
+		DdsFile dds(asset.data, asset.size);
+		return DecodeDds(dds, forDevice, image);
+	}
+
+	TargaDecoder decoder = asset.data ? TargaDecoder(asset.data, asset.size) : TargaDecoder(filename);
+	return DecodeTarga(decoder, compression, forDevice, image);
+}
+
+bool Texture::DecodeTarga(TargaDecoder& decoder, Compression compression, bool forDevice, Image& image)
 {
-	std::vector<uchar> targaData = LoadTarga32Bit(filename);
-	if (targaData.empty())
-		return;
+	// The decoder has read the header already.
+	if (!decoder.IsValid())
+		return false;
+
+	image.width = decoder.GetWidth();
+	image.height = decoder.GetHeight();
+
+	// Decode the image straight into the buffer that is kept, in top-down RGBA order.
+	std::vector<uchar> targaData((size_t)image.width * image.height * 4u);
+	if (!decoder.Decode(targaData.data()))
+		return false;
+
+	// Without a device the texture is sampled on the CPU, so keep the decoded image.
+	if (!forDevice)
+	{
+		image.pixels = std::move(targaData);
+		return true;
+	}
+
+	// Build the rest of the mip chain on the CPU, filtering the sRGB encoded colors in linear space.
+	MipGenerator::Options mipOptions;
+	mipOptions.filter = MipGenerator::Filter::Box;
+	mipOptions.srgb = true;
+	std::vector<MipGenerator::Level> mips = MipGenerator::Generate(targaData.data(), image.width, image.height, mipOptions);
+
+	// Block compressed textures need a top level made of whole 4x4 blocks; other sizes stay uncompressed.
+	if (image.width % 4u != 0u || image.height % 4u != 0u)
+		compression = Compression::None;
+
+	BlockCompressor::Options compressorOptions;
+	image.format = DdsFile::Format::R8G8B8A8;
+	switch (compression)
+	{
+	case Compression::BC1:
+		compressorOptions.format = BlockCompressor::Format::BC1;
+		image.format = DdsFile::Format::BC1;
+		break;
+	case Compression::BC3:
+		compressorOptions.format = BlockCompressor::Format::BC3;
+		image.format = DdsFile::Format::BC3;
+		break;
+	case Compression::BC7:
+		compressorOptions.format = BlockCompressor::Format::BC7;
+		image.format = DdsFile::Format::BC7;
+		break;
+	default:
+		break;
+	}
+
+	// Compress every level in place of its RGBA8 pixels.
+	if (compression != Compression::None)
+	{
+		targaData = BlockCompressor::Compress(targaData.data(), image.width, image.height, compressorOptions);
+		for (MipGenerator::Level& mip : mips)
+			mip.pixels = BlockCompressor::Compress(mip.pixels.data(), mip.width, mip.height, compressorOptions);
+	}
+
+	// Point every subresource at its level; level 0 is the decoded image itself.
+	image.storage.push_back(std::move(targaData));
+	image.levels.push_back(DdsFile::Level{ image.width, image.height, DdsFile::GetRowPitch(image.format, image.width), image.storage.back().data() });
+	image.byteSize = image.storage.back().size();
+	for (MipGenerator::Level& mip : mips)
+	{
+		image.storage.push_back(std::move(mip.pixels));
+		image.levels.push_back(DdsFile::Level{ mip.width, mip.height, DdsFile::GetRowPitch(image.format, mip.width), image.storage.back().data() });
+		image.byteSize += image.storage.back().size();
+	}
+
+	return true;
+}
+
+bool Texture::DecodeDds(const DdsFile& dds, bool forDevice, Image& image)
+{
+	if (!dds.IsValid())
+		return false;
+
+	image.width = (ushort)dds.GetWidth();
+	image.height = (ushort)dds.GetHeight();
+
+	// Without a device the top level is decoded to RGBA8 for the CPU sampler.
+	if (!forDevice)
+	{
+		image.pixels = DecodeDdsPixels(dds);
+		return !image.pixels.empty();
+	}
+
+	// The file already holds the final format and mip chain, so it is uploaded as it is, from the archive mapping when there is one.
+	image.format = dds.GetFormat();
+	for (uint i = 0u; i < dds.GetLevelCount(); ++i)
+	{
+		DdsFile::Level level = dds.GetLevel(i);
+		image.levels.push_back(level);
+		image.byteSize += DdsFile::GetLevelSize(dds.GetFormat(), level.width, level.height);
+	}
+
+	return true;
+}
+
+bool Texture::Upload(ID3D11Device* device, Image& image)
+{
+	PROFILE_SCOPE("Texture::Upload");
+
+	// Without a device the texture is sampled on the CPU, so keep the decoded image.
+	if (!device)
+	{
+		if (image.pixels.empty())
+			return false;
+
+		_pixels = std::move(image.pixels);
+		_width = image.width;
+		_height = image.height;
+		_isValid = true;
+		_isResident = true;
+		return true;
+	}
+
+#ifdef _WIN32
+	// Point a subresource at every level.
+	std::vector<D3D11_SUBRESOURCE_DATA> levels;
+	for (const DdsFile::Level& level : image.levels)
+		levels.push_back(D3D11_SUBRESOURCE_DATA{ level.data, level.rowPitch, 0u });
 
 	// Initialize the texture description.
 	D3D11_TEXTURE2D_DESC textureDesc;
 	ZeroMemory(&textureDesc, sizeof(textureDesc));
 
-	// Setup the texture description.
-	textureDesc.Width = _width;
-	textureDesc.Height = _height;
-	textureDesc.MipLevels = 0u;
+	// Setup the texture description. The whole chain is known up front, so the texture is immutable and needs no render target binding.
+	textureDesc.Width = image.width;
+	textureDesc.Height = image.height;
+	textureDesc.MipLevels = (uint)image.levels.size();
 	textureDesc.ArraySize = 1u;
-	textureDesc.Format = DXGI_FORMAT_R8G8B8A8_UNORM;
+	textureDesc.Format = (DXGI_FORMAT)image.format;
 	textureDesc.SampleDesc.Count = 1u;
 	textureDesc.SampleDesc.Quality = 0u;
-	textureDesc.Usage = D3D11_USAGE_DEFAULT;
-	textureDesc.BindFlags = D3D11_BIND_SHADER_RESOURCE | D3D11_BIND_RENDER_TARGET;
+	textureDesc.Usage = D3D11_USAGE_IMMUTABLE;
+	textureDesc.BindFlags = D3D11_BIND_SHADER_RESOURCE;
 	textureDesc.CPUAccessFlags = 0u;
-	textureDesc.MiscFlags = D3D11_RESOURCE_MISC_GENERATE_MIPS;
+	textureDesc.MiscFlags = 0u;
 
-	// Create the empty texture.
-	HRESULT hresult = device->CreateTexture2D(&textureDesc, nullptr, &_texture);
+	// Create the texture with every mip level filled in. New objects are only swapped in once both exist,
+	// so a failed upload leaves the previous contents, such as a placeholder, in place.
+	ReleasePtr<ID3D11Texture2D> texture;
+	HRESULT hresult = device->CreateTexture2D(&textureDesc, levels.data(), &texture);
 	if (FAILED(hresult))
-		return;
-
-	// Set the row pitch of the targa image data.
-	uint rowPitch = (_width * 4) * sizeof(uchar);
-
-	// Copy the targa image data into the texture.
-	deviceContext->UpdateSubresource(_texture.get(), 0u, nullptr, targaData.data(), rowPitch, 0u);
+		return false;
 
 	// Setup the shader resource view description.
 	D3D11_SHADER_RESOURCE_VIEW_DESC srvDesc;
@@ -43,14 +237,21 @@ Texture::Texture(ID3D11Device* device, ID3D11DeviceContext* deviceContext, const
 	srvDesc.Texture2D.MipLevels = (uint) - 1;
 
 	// Create the shader resource view for the texture.
-	hresult = device->CreateShaderResourceView(_texture.get(), &srvDesc, &_textureView);
+	ReleasePtr<ID3D11ShaderResourceView> textureView;
+	hresult = device->CreateShaderResourceView(texture.get(), &srvDesc, &textureView);
 	if (FAILED(hresult))
-		return;
-
-	// Generate mipmaps for this texture.
-	deviceContext->GenerateMips(_textureView.get());
+		return false;
 
+	_texture = std::move(texture);
+	_textureView = std::move(textureView);
+	_width = image.width;
+	_height = image.height;
 	_isValid = true;
+	_isResident = true;
+	return true;
+#else
+	return false;
+#endif
 }
 
 ID3D11ShaderResourceView* Texture::GetTexture()
@@ -58,95 +259,51 @@ ID3D11ShaderResourceView* Texture::GetTexture()
 	return _textureView.get();
 }
 
-std::vector<uchar> Texture::LoadTarga32Bit(const char* filename)
+const std::vector<uchar>& Texture::GetPixels() const
 {
-	struct TargaHeader
-	{
-		uint8_t data1[12];
-		uint16_t width;
-		uint16_t height;
-		uint8_t bpp;
-		uint8_t data2;
-	};
-
-
-	FILE* filePtr = nullptr;
-	size_t countRead = 0u;
-
-	// Open the targa file for reading in binary.
-	int error = fopen_s(&filePtr, filename, "rb");
-	if (error != 0)
-		return std::vector<uchar>();
-
-	// Read in the file header.
-	TargaHeader targaFileHeader;
-	countRead = fread(&targaFileHeader, sizeof(TargaHeader), 1, filePtr);
-	if (countRead != 1u)
-	{
-		fclose(filePtr);
-		return std::vector<uchar>();
-	}
+	return _pixels;
+}
 
-	// Get the important information from the header.
-	_height = targaFileHeader.height;
-	_width = targaFileHeader.width;
-	uchar bpp = targaFileHeader.bpp;
+std::vector<uchar> Texture::DecodeDdsPixels(const DdsFile& dds)
+{
+	DdsFile::Level level = dds.GetLevel(0u);
+	size_t pixelCount = (size_t)level.width * level.height;
 
-	// Check that it is 32 bit and not 24 bit.
-	if (bpp != 32u)
+	switch (dds.GetFormat())
 	{
-		fclose(filePtr);
-		return std::vector<uchar>();
-	}
-
-	// Calculate the size of the 32 bit image data.
-	uint imageSize = _width * _height * 4;
-
-	// Allocate memory for the targa image data.
-	std::vector<uchar> targaImage(imageSize);
+	case DdsFile::Format::R8G8B8A8:
+	case DdsFile::Format::R8G8B8A8Srgb:
+		return std::vector<uchar>(level.data, level.data + pixelCount * 4u);
 
-	// Read in the targa image data.
-	countRead = fread(targaImage.data(), 1u, imageSize, filePtr);
-	if (countRead != imageSize)
+	case DdsFile::Format::B8G8R8A8:
+	case DdsFile::Format::B8G8R8A8Srgb:
+	case DdsFile::Format::B8G8R8X8:
 	{
-		fclose(filePtr);
-		return std::vector<uchar>();
-	}
-
-	// Close the file.
-	error = fclose(filePtr);
-	if (error != 0)
-		return std::vector<uchar>();
-
-	// Allocate memory for the targa destination data.
-	std::vector<uchar> targaData(imageSize);
-
-	// Initialize the index into the targa destination data array.
-	uint index = 0u;
+		std::vector<uchar> pixels(pixelCount * 4u);
+		PixelConvert::BgraToRgba(level.data, pixels.data(), pixelCount);
 
-	// Initialize the index into the targa image data.
-	uint k = (_width * _height * 4) - (_width * 4);
-
-	// Now copy the targa image data into the targa destination array in the correct order since the targa format is stored upside down and also is not in RGBA order.
-	for (uint j = 0; j < _height; j++)
-	{
-		for (uint i = 0; i < _width; i++)
+		// The fourth byte of an X8 format is padding, not alpha.
+		if (dds.GetFormat() == DdsFile::Format::B8G8R8X8)
 		{
-			targaData[index + 0] = targaImage[k + 2];  // Red
-			targaData[index + 1] = targaImage[k + 1];  // Green
-			targaData[index + 2] = targaImage[k + 0];  // Blue
-			targaData[index + 3] = targaImage[k + 3];  // Alpha
-
-			// Increment the indexes into the targa data.
-			k += 4u;
-			index += 4u;
+			for (size_t i = 3u; i < pixels.size(); i += 4u)
+				pixels[i] = 255u;
 		}
-
-		// Set the targa image data index back to the preceding row at the beginning of the column since its reading it in upside down.
-		k -= (_width * 8u);
+		return pixels;
 	}
 
-	return targaData;
+	case DdsFile::Format::BC1:
+	case DdsFile::Format::BC1Srgb:
+		return BlockCompressor::Decompress(level.data, level.width, level.height, BlockCompressor::Format::BC1);
+	case DdsFile::Format::BC3:
+	case DdsFile::Format::BC3Srgb:
+		return BlockCompressor::Decompress(level.data, level.width, level.height, BlockCompressor::Format::BC3);
+	case DdsFile::Format::BC7:
+	case DdsFile::Format::BC7Srgb:
+		return BlockCompressor::Decompress(level.data, level.width, level.height, BlockCompressor::Format::BC7);
+
+	default:
+		return std::vector<uchar>();
+	}
 }
 
 bool Texture::IsValid() const
@@ -154,6 +311,11 @@ bool Texture::IsValid() const
 	return _isValid;
 }
 
+bool Texture::IsResident() const
+{
+	return _isResident;
+}
+
 ushort Texture::GetWidth() const
 {
     return _width;
@@ -163,3 +325,13 @@ ushort Texture::GetHeight() const
 {
     return _height;
 }
+
+TextureBinding Texture::GetBinding()
+{
+	TextureBinding binding;
+	binding.view = _textureView.get();
+	binding.pixels = _pixels.empty() ? nullptr : _pixels.data();
+	binding.width = _width;
+	binding.height = _height;
+	return binding;
+}
@@ -1,27 +1,77 @@
 #pragma once
 
-#include <d3d11.h>
 #include "Common.h"
 #include "ReleasePtr.h"
+#include "DdsFile.h"
+#include "TargaDecoder.h"
+#include "AssetArchive.h"
+#include "RenderBackend.h"
+
+struct ID3D11Device;
+struct ID3D11Texture2D;
 
 class Texture
 {
 public:
 
-	Texture(ID3D11Device* device, ID3D11DeviceContext* context, const char* filename);
+	// Block compression applied to TGA images on load. DDS files keep the format they were saved with, so formats too
+	// slow to encode at load time, like BC7, are cooked into DDS files offline.
+	enum class Compression
+	{
+		None,
+		BC1,
+		BC3,
+		BC7
+	};
+
+	// A decoded texture ready for Upload. Decode fills it without touching Direct3D, so it can be built on any thread.
+	struct Image
+	{
+		DdsFile::Format format = DdsFile::Format::Unknown;	// The DXGI format the texture is created with.
+		ushort width = 0u;
+		ushort height = 0u;
+		std::vector<DdsFile::Level> levels;			// Every mip level, pointing into storage or into an archive mapping.
+		std::vector<std::vector<uchar>> storage;	// Level bytes owned by the image.
+		std::vector<uchar> pixels;					// RGBA8 top level, only decoded for renderers without a device.
+		size_t byteSize = 0u;						// Bytes uploaded to the GPU, used for streaming budgets.
+	};
+
+	// Loads filename from disk, or when an archive is given, the asset of that name straight from the archive's mapping.
+	Texture(ID3D11Device* device, const char* filename, Compression compression = Compression::None, const AssetArchive* archive = nullptr);
+
+	// Creates a 1x1 grey placeholder, shown until Upload replaces it with the real image.
+	Texture(ID3D11Device* device);
+
+	~Texture();
+
+	// Reads and decodes a texture file. With a device in mind the mip chain is built and compressed, otherwise only
+	// the RGBA8 top level is kept. Safe to call from any thread.
+	static bool Decode(const char* filename, Compression compression, const AssetArchive* archive, bool forDevice, Image& image);
+
+	// Creates the resource for a decoded image, replacing what the texture held before. Call on the render thread.
+	bool Upload(ID3D11Device* device, Image& image);
 
 	bool IsValid() const;
+	bool IsResident() const;
 	ID3D11ShaderResourceView* GetTexture();
+	const std::vector<uchar>& GetPixels() const;
 	ushort GetWidth() const;
 	ushort GetHeight() const;
 
+	// What a render backend needs to bind the texture: the view on a device, the RGBA8 pixels without one.
+	TextureBinding GetBinding();
+
 private:
 
-	std::vector<uchar> LoadTarga32Bit(const char* filename);
+	static bool DecodeTarga(TargaDecoder& decoder, Compression compression, bool forDevice, Image& image);
+	static bool DecodeDds(const DdsFile& dds, bool forDevice, Image& image);
+	static std::vector<uchar> DecodeDdsPixels(const DdsFile& dds);
 
 	ReleasePtr<ID3D11Texture2D> _texture;
 	ReleasePtr<ID3D11ShaderResourceView> _textureView;
+	std::vector<uchar> _pixels; // Decoded RGBA8 image, only kept when there is no device to upload it to.
 	ushort _width = 0u;
 	ushort _height = 0u;
 	bool _isValid = false;
+	bool _isResident = false;
 };
\ No newline at end of file
@@ -1,10 +1,4 @@
-// GLOBALS
-cbuffer MatrixBuffer
-{
-    matrix worldMatrix;
-    matrix viewMatrix;
-    matrix projectionMatrix;
-};
+#include "ShaderConstants.hlsli"
 
 // TYPEDEFS
 struct VertexInputType
@@ -27,13 +21,12 @@ PixelInputType TextureVertexShader(VertexInputType input)
 	// Change the position vector to be 4 units for proper matrix calculations.
 	input.position.w = 1.0f;
 
-	// Calculate the position of the vertex against the world, view, and projection matrices.
+	// Calculate the position of the vertex against the world matrix and the combined view and projection matrix.
 	output.position = mul(input.position, worldMatrix);
-	output.position = mul(output.position, viewMatrix);
-	output.position = mul(output.position, projectionMatrix);
+	output.position = mul(output.position, viewProjectionMatrix);
 
 	// Store the texture coordinates for the pixel shader.
-	output.tex = input.tex;
+	output.tex = input.tex + textureOffset;
 
 	return output;
 }
\ No newline at end of file
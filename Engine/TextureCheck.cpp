@@ -0,0 +1,590 @@
+#include "TextureCheck.h"
+#include "MipGenerator.h"
+#include "TargaDecoder.h"
+
+#include <filesystem>
+#include <math.h>
+#include <random>
+#include <string.h>
+
+namespace
+{
+	const uint RANDOM_SEED = 4242u;
+
+	// Small images are odd sized so runs and raw packets cross rows; the large one spans several decoder chunks.
+	const uint WIDTH = 13u;
+	const uint HEIGHT = 7u;
+	const uint LARGE_WIDTH = 317u;
+	const uint LARGE_HEIGHT = 211u;
+	const uint PACKET_WIDTH = 300u;		// More than two of the longest packets per row.
+	const uint PACKET_HEIGHT = 3u;
+
+	// Decoders write into a destination followed by guard bytes that must come back untouched.
+	const size_t GUARD_BYTES = 64u;
+	const uchar GUARD_VALUE = 0xCDu;
+
+	// Palettized images store entries from PALETTE_FIRST on; their indices also reach below and past the stored ones.
+	const uint PALETTE_FIRST = 2u;
+	const uint PALETTE_LENGTH = 6u;
+
+	const uint MIP_WIDTH = 48u;		// Halves to 3 and then to 1, so every level is a whole number of source texels.
+	const uint MIP_HEIGHT = 24u;
+
+	enum class Kind
+	{
+		Greyscale,
+		Indexed,
+		TrueColor
+	};
+
+	struct Variant
+	{
+		const char* name;
+		Kind kind;
+		uint pixelBits;
+		bool rle;
+		bool topDown;
+		bool rightToLeft;
+		uint alphaBits;
+		uint idLength;
+		bool colorMap;		// Palettized images always carry one; true color ones may carry an unused one.
+	};
+
+	const Variant VARIANTS[] =
+	{
+		{ "32-bit bottom-up", Kind::TrueColor, 32u, false, false, false, 8u, 0u, false },
+		{ "32-bit top-down", Kind::TrueColor, 32u, false, true, false, 8u, 0u, false },
+		{ "32-bit right-to-left", Kind::TrueColor, 32u, false, false, true, 8u, 0u, false },
+		{ "24-bit bottom-up", Kind::TrueColor, 24u, false, false, false, 0u, 0u, false },
+		{ "24-bit top-down right-to-left", Kind::TrueColor, 24u, false, true, true, 0u, 0u, false },
+		{ "24-bit with image ID and unused color map", Kind::TrueColor, 24u, false, false, false, 0u, 9u, true },
+		{ "16-bit with alpha", Kind::TrueColor, 16u, false, false, false, 1u, 0u, false },
+		{ "15-bit", Kind::TrueColor, 15u, false, true, false, 0u, 0u, false },
+		{ "8-bit greyscale", Kind::Greyscale, 8u, false, false, false, 0u, 0u, false },
+		{ "8-bit palettized", Kind::Indexed, 8u, false, false, false, 0u, 0u, true },
+		{ "16-bit palettized", Kind::Indexed, 16u, false, true, true, 0u, 0u, true },
+		{ "RLE 32-bit bottom-up", Kind::TrueColor, 32u, true, false, false, 8u, 0u, false },
+		{ "RLE 32-bit top-down right-to-left", Kind::TrueColor, 32u, true, true, true, 8u, 0u, false },
+		{ "RLE 24-bit", Kind::TrueColor, 24u, true, false, false, 0u, 0u, false },
+		{ "RLE 16-bit with alpha", Kind::TrueColor, 16u, true, true, false, 1u, 0u, false },
+		{ "RLE 8-bit greyscale", Kind::Greyscale, 8u, true, false, true, 0u, 0u, false },
+		{ "RLE 8-bit palettized with image ID", Kind::Indexed, 8u, true, false, false, 0u, 3u, true },
+	};
+
+	// A TGA file and the top-down RGBA8 pixels it must decode to.
+	struct TestImage
+	{
+		uint width = 0u;
+		uint height = 0u;
+		std::vector<uchar> file;
+		std::vector<uchar> expected;
+	};
+
+	uint PixelBytes(const Variant& variant)
+	{
+		return (variant.pixelBits + 7u) / 8u;
+	}
+
+	void AppendUint16(std::vector<uchar>& bytes, uint value)
+	{
+		bytes.push_back((uchar)(value & 0xFFu));
+		bytes.push_back((uchar)(value >> 8));
+	}
+
+	uchar Expand5To8(uint value)
+	{
+		return (uchar)((value << 3) | (value >> 2));
+	}
+
+	// The RGBA8 a stored pixel stands for, worked out from the TGA layout rather than from the decoder.
+	void ExpectedColor(const Variant& variant, const uchar* raw, const std::vector<uchar>& palette, uchar* rgba)
+	{
+		switch (variant.kind)
+		{
+		case Kind::Greyscale:
+			rgba[0] = rgba[1] = rgba[2] = raw[0];
+			rgba[3] = 255u;
+			return;
+		case Kind::Indexed:
+		{
+			// Indices outside the stored entries read as transparent black.
+			uint index = variant.pixelBits == 8u ? raw[0] : (uint)raw[0] | ((uint)raw[1] << 8);
+			if (index < PALETTE_FIRST || index >= PALETTE_FIRST + PALETTE_LENGTH)
+			{
+				memset(rgba, 0, 4u);
+				return;
+			}
+			const uchar* entry = palette.data() + (index - PALETTE_FIRST) * 3u;
+			rgba[0] = entry[2];
+			rgba[1] = entry[1];
+			rgba[2] = entry[0];
+			rgba[3] = 255u;
+			return;
+		}
+		case Kind::TrueColor:
+			if (variant.pixelBits <= 16u)
+			{
+				uint value = (uint)raw[0] | ((uint)raw[1] << 8);
+				rgba[0] = Expand5To8((value >> 10) & 0x1Fu);
+				rgba[1] = Expand5To8((value >> 5) & 0x1Fu);
+				rgba[2] = Expand5To8(value & 0x1Fu);
+				rgba[3] = (variant.pixelBits == 16u && variant.alphaBits > 0u && !(value & 0x8000u)) ? 0u : 255u;
+				return;
+			}
+			rgba[0] = raw[2];
+			rgba[1] = raw[1];
+			rgba[2] = raw[0];
+			rgba[3] = variant.pixelBits == 32u ? raw[3] : 255u;
+			return;
+		}
+	}
+
+	// Run length encode whole pixels, letting packets continue from one row into the next as the format allows.
+	void AppendRle(std::vector<uchar>& bytes, const std::vector<uchar>& pixels, uint pixelBytes)
+	{
+		size_t count = pixels.size() / pixelBytes;
+		auto same = [&](size_t a, size_t b) { return memcmp(&pixels[a * pixelBytes], &pixels[b * pixelBytes], pixelBytes) == 0; };
+
+		size_t i = 0u;
+		while (i < count)
+		{
+			size_t run = 1u;
+			while (run < 128u && i + run < count && same(i, i + run))
+				run++;
+			if (run >= 2u)
+			{
+				bytes.push_back((uchar)(0x80u | (run - 1u)));
+				bytes.insert(bytes.end(), &pixels[i * pixelBytes], &pixels[i * pixelBytes] + pixelBytes);
+				i += run;
+				continue;
+			}
+
+			// A raw packet reaches up to the next pair of equal pixels.
+			size_t raw = 1u;
+			while (raw < 128u && i + raw < count && !(i + raw + 1u < count && same(i + raw, i + raw + 1u)))
+				raw++;
+			bytes.push_back((uchar)(raw - 1u));
+			bytes.insert(bytes.end(), &pixels[i * pixelBytes], &pixels[i * pixelBytes] + raw * pixelBytes);
+			i += raw;
+		}
+	}
+
+	// Random pixels in file order, each repeating the one before with the given chance so RLE finds runs.
+	TestImage MakeImage(const Variant& variant, uint width, uint height, double repeatChance, std::mt19937& random)
+	{
+		TestImage image;
+		image.width = width;
+		image.height = height;
+		image.expected.resize((size_t)width * height * 4u);
+
+		std::uniform_real_distribution<double> chance(0.0, 1.0);
+		uint pixelBytes = PixelBytes(variant);
+
+		std::vector<uchar> palette(PALETTE_LENGTH * 3u);
+		for (uchar& byte : palette)
+			byte = (uchar)random();
+
+		std::vector<uchar> pixels((size_t)width * height * pixelBytes);
+		for (uint fileRow = 0u; fileRow < height; ++fileRow)
+		{
+			for (uint fileColumn = 0u; fileColumn < width; ++fileColumn)
+			{
+				size_t index = (size_t)fileRow * width + fileColumn;
+				uchar* raw = &pixels[index * pixelBytes];
+				if (index > 0u && chance(random) < repeatChance)
+				{
+					memcpy(raw, raw - pixelBytes, pixelBytes);
+				}
+				else if (variant.kind == Kind::Indexed)
+				{
+					// Mostly stored entries, with a few indices below and past them.
+					uint entry = random() % (PALETTE_FIRST + PALETTE_LENGTH + 2u);
+					if (variant.pixelBits == 16u && random() % 8u == 0u)
+						entry = 0x1234u;
+					raw[0] = (uchar)(entry & 0xFFu);
+					if (pixelBytes == 2u)
+						raw[1] = (uchar)(entry >> 8);
+				}
+				else
+				{
+					for (uint i = 0u; i < pixelBytes; ++i)
+						raw[i] = (uchar)random();
+				}
+
+				uint x = variant.rightToLeft ? width - 1u - fileColumn : fileColumn;
+				uint y = variant.topDown ? fileRow : height - 1u - fileRow;
+				ExpectedColor(variant, raw, palette, &image.expected[((size_t)y * width + x) * 4u]);
+			}
+		}
+
+		// Header.
+		std::vector<uchar>& file = image.file;
+		file.push_back((uchar)variant.idLength);
+		file.push_back(variant.colorMap ? 1u : 0u);
+		file.push_back((uchar)((variant.kind == Kind::Indexed ? 1u : variant.kind == Kind::TrueColor ? 2u : 3u) + (variant.rle ? 8u : 0u)));
+		AppendUint16(file, variant.colorMap ? PALETTE_FIRST : 0u);
+		AppendUint16(file, variant.colorMap ? PALETTE_LENGTH : 0u);
+		file.push_back(variant.colorMap ? 24u : 0u);
+		AppendUint16(file, 0u);
+		AppendUint16(file, 0u);
+		AppendUint16(file, width);
+		AppendUint16(file, height);
+		file.push_back((uchar)variant.pixelBits);
+		file.push_back((uchar)(variant.alphaBits | (variant.rightToLeft ? 0x10u : 0u) | (variant.topDown ? 0x20u : 0u)));
+
+		// Image ID, color map and pixels.
+		for (uint i = 0u; i < variant.idLength; ++i)
+			file.push_back((uchar)('A' + i));
+		if (variant.colorMap)
+			file.insert(file.end(), palette.begin(), palette.end());
+		if (variant.rle)
+			AppendRle(file, pixels, pixelBytes);
+		else
+			file.insert(file.end(), pixels.begin(), pixels.end());
+
+		return image;
+	}
+
+	bool GuardIntact(const std::vector<uchar>& destination, size_t imageBytes)
+	{
+		for (size_t i = imageBytes; i < destination.size(); ++i)
+		{
+			if (destination[i] != GUARD_VALUE)
+				return false;
+		}
+		return true;
+	}
+
+	bool DecodeMatches(TargaDecoder& decoder, const TestImage& image)
+	{
+		if (!decoder.IsValid() || decoder.GetWidth() != image.width || decoder.GetHeight() != image.height)
+			return false;
+
+		std::vector<uchar> destination(image.expected.size() + GUARD_BYTES, GUARD_VALUE);
+		if (!decoder.Decode(destination.data()))
+			return false;
+		return memcmp(destination.data(), image.expected.data(), image.expected.size()) == 0 && GuardIntact(destination, image.expected.size());
+	}
+
+	// A damaged file must fail to open or to decode, without writing past the destination. The bytes are copied
+	// into a buffer of exactly their size, so a read past the end shows up under a memory checker.
+	bool Rejected(const std::vector<uchar>& file, size_t size, uint width, uint height)
+	{
+		std::vector<uchar> bytes(file.begin(), file.begin() + size);
+		TargaDecoder decoder(bytes.data(), bytes.size());
+		if (!decoder.IsValid())
+			return true;
+
+		std::vector<uchar> destination((size_t)width * height * 4u + GUARD_BYTES, GUARD_VALUE);
+		return !decoder.Decode(destination.data()) && GuardIntact(destination, (size_t)width * height * 4u);
+	}
+
+	bool RejectedFromFile(const std::filesystem::path& path, const std::vector<uchar>& file, size_t size, uint width, uint height)
+	{
+		{
+			std::ofstream stream(path, std::ios::binary | std::ios::trunc);
+			stream.write((const char*)file.data(), (std::streamsize)size);
+		}
+
+		TargaDecoder decoder(path.string().c_str());
+		if (!decoder.IsValid())
+			return true;
+
+		std::vector<uchar> destination((size_t)width * height * 4u + GUARD_BYTES, GUARD_VALUE);
+		return !decoder.Decode(destination.data()) && GuardIntact(destination, (size_t)width * height * 4u);
+	}
+
+	bool DecodesFromFile(const std::filesystem::path& path, const TestImage& image)
+	{
+		{
+			std::ofstream stream(path, std::ios::binary | std::ios::trunc);
+			stream.write((const char*)image.file.data(), (std::streamsize)image.file.size());
+		}
+
+		TargaDecoder decoder(path.string().c_str());
+		return DecodeMatches(decoder, image);
+	}
+
+	// Headers that name something the decoder does not read, or a file too short for what they announce.
+	bool CheckMalformedHeaders(std::ostream& output, std::mt19937& random)
+	{
+		const Variant& base = VARIANTS[3];
+		const Variant& indexed = VARIANTS[9];
+		TestImage image = MakeImage(base, WIDTH, HEIGHT, 0.0, random);
+		TestImage indexedImage = MakeImage(indexed, WIDTH, HEIGHT, 0.0, random);
+
+		struct Corruption
+		{
+			const char* name;
+			bool indexed;
+			size_t offset;
+			std::vector<uchar> bytes;
+		};
+		const Corruption corruptions[] =
+		{
+			{ "zero width", false, 12u, { 0u, 0u } },
+			{ "zero height", false, 14u, { 0u, 0u } },
+			{ "no image data", false, 2u, { 0u } },
+			{ "unknown image type", false, 2u, { 4u } },
+			{ "compressed type 32", false, 2u, { 32u } },
+			{ "12-bit true color", false, 16u, { 12u } },
+			{ "24-bit greyscale", false, 2u, { 3u } },
+			{ "image ID past the end", false, 0u, { 255u } },
+			{ "24-bit palettized", true, 16u, { 24u } },
+			{ "palettized without a color map", true, 1u, { 0u } },
+			{ "8-bit color map entries", true, 7u, { 8u } },
+			{ "color map past the end", true, 5u, { 0xFFu, 0xFFu } },
+			{ "height past the data", false, 14u, { 0x00u, 0x04u } },
+		};
+
+		bool allRejected = true;
+		for (const Corruption& corruption : corruptions)
+		{
+			std::vector<uchar> file = corruption.indexed ? indexedImage.file : image.file;
+			memcpy(file.data() + corruption.offset, corruption.bytes.data(), corruption.bytes.size());
+			uint width = (uint)file[12] | ((uint)file[13] << 8);
+			uint height = (uint)file[14] | ((uint)file[15] << 8);
+			bool rejected = Rejected(file, file.size(), width, height);
+			if (!rejected)
+				output << std::format("Malformed header not rejected: {}", corruption.name) << std::endl;
+			allRejected = allRejected && rejected;
+		}
+		return allRejected;
+	}
+
+	// Mip levels filtered directly in double precision: every destination texel is the average of the whole block of
+	// the level above it in linear space, and only the output of each level is quantized.
+	std::vector<MipGenerator::Level> ReferenceBoxMips(const std::vector<uchar>& pixels, uint width, uint height)
+	{
+		auto toLinear = [](double value) { return value <= 0.04045 ? value / 12.92 : pow((value + 0.055) / 1.055, 2.4); };
+		auto toSrgb = [](double value) { return value <= 0.0031308 ? value * 12.92 : 1.055 * pow(value, 1.0 / 2.4) - 0.055; };
+
+		std::vector<double> level(pixels.size());
+		for (size_t i = 0u; i < pixels.size(); ++i)
+			level[i] = (i % 4u == 3u) ? pixels[i] / 255.0 : toLinear(pixels[i] / 255.0);
+
+		std::vector<MipGenerator::Level> levels;
+		while (width > 1u || height > 1u)
+		{
+			uint nextWidth = width > 1u ? width / 2u : 1u;
+			uint nextHeight = height > 1u ? height / 2u : 1u;
+			uint blockWidth = width / nextWidth;
+			uint blockHeight = height / nextHeight;
+
+			std::vector<double> next((size_t)nextWidth * nextHeight * 4u, 0.0);
+			for (uint y = 0u; y < nextHeight; ++y)
+			{
+				for (uint x = 0u; x < nextWidth; ++x)
+				{
+					double* sum = &next[((size_t)y * nextWidth + x) * 4u];
+					for (uint by = 0u; by < blockHeight; ++by)
+					{
+						for (uint bx = 0u; bx < blockWidth; ++bx)
+						{
+							const double* texel = &level[((size_t)(y * blockHeight + by) * width + x * blockWidth + bx) * 4u];
+							for (uint channel = 0u; channel < 4u; ++channel)
+								sum[channel] += texel[channel] / (blockWidth * blockHeight);
+						}
+					}
+				}
+			}
+
+			MipGenerator::Level output;
+			output.width = nextWidth;
+			output.height = nextHeight;
+			output.pixels.resize(next.size());
+			for (size_t i = 0u; i < next.size(); ++i)
+			{
+				double value = (i % 4u == 3u) ? next[i] : toSrgb(next[i]);
+				output.pixels[i] = (uchar)(value * 255.0 + 0.5);
+			}
+			levels.push_back(std::move(output));
+
+			level = std::move(next);
+			width = nextWidth;
+			height = nextHeight;
+		}
+		return levels;
+	}
+
+	// Largest difference of any channel between the generated levels and the expected ones, or 256 if their sizes differ.
+	uint LevelDifference(const std::vector<MipGenerator::Level>& levels, const std::vector<MipGenerator::Level>& expected)
+	{
+		if (levels.size() != expected.size())
+			return 256u;
+
+		uint difference = 0u;
+		for (size_t level = 0u; level < levels.size(); ++level)
+		{
+			if (levels[level].width != expected[level].width || levels[level].height != expected[level].height ||
+				levels[level].pixels.size() != expected[level].pixels.size())
+				return 256u;
+			for (size_t i = 0u; i < levels[level].pixels.size(); ++i)
+			{
+				uint channel = (uint)abs((int)levels[level].pixels[i] - (int)expected[level].pixels[i]);
+				difference = channel > difference ? channel : difference;
+			}
+		}
+		return difference;
+	}
+
+	bool CheckMips(std::ostream& output, std::mt19937& random)
+	{
+		bool allMatch = true;
+
+		// The box filter against the double precision reference; the generator's conversion tables round to one step.
+		std::vector<uchar> pixels((size_t)MIP_WIDTH * MIP_HEIGHT * 4u);
+		for (uchar& byte : pixels)
+			byte = (uchar)random();
+		MipGenerator::Options box;
+		box.filter = MipGenerator::Filter::Box;
+		uint boxDifference = LevelDifference(MipGenerator::Generate(pixels.data(), MIP_WIDTH, MIP_HEIGHT, box), ReferenceBoxMips(pixels, MIP_WIDTH, MIP_HEIGHT));
+		bool boxMatch = boxDifference <= 1u;
+		allMatch = allMatch && boxMatch;
+		output << std::format("Mips: box filter on {}x{} within {} of the sRGB reference: {}", MIP_WIDTH, MIP_HEIGHT, boxDifference, boxMatch ? "OK" : "MISMATCH") << std::endl;
+
+		// A black and white checker averages to middle grey in linear light, which is 188 in sRGB and 128 without it.
+		const uchar checker[] = { 0u, 0u, 0u, 0u, 255u, 255u, 255u, 255u, 255u, 255u, 255u, 255u, 0u, 0u, 0u, 0u };
+		std::vector<MipGenerator::Level> srgbChecker = MipGenerator::Generate(checker, 2u, 2u, box);
+		MipGenerator::Options linear = box;
+		linear.srgb = false;
+		std::vector<MipGenerator::Level> linearChecker = MipGenerator::Generate(checker, 2u, 2u, linear);
+		bool checkerMatch = srgbChecker.size() == 1u && linearChecker.size() == 1u &&
+			srgbChecker[0].pixels == std::vector<uchar>({ 188u, 188u, 188u, 128u }) &&
+			linearChecker[0].pixels == std::vector<uchar>({ 128u, 128u, 128u, 128u });
+		allMatch = allMatch && checkerMatch;
+		output << std::format("Mips: checker averages to 188 in sRGB and 128 in linear: {}", checkerMatch ? "OK" : "MISMATCH") << std::endl;
+
+		// A constant image stays the same color at every level, through either filter, with and without wrapping.
+		const uint constantSizes[][2] = { { 37u, 19u }, { 64u, 32u }, { 1u, 9u } };
+		bool constantMatch = true;
+		for (MipGenerator::Filter filter : { MipGenerator::Filter::Box, MipGenerator::Filter::Kaiser })
+		{
+			for (uint flags = 0u; flags < 4u; ++flags)
+			{
+				MipGenerator::Options options;
+				options.filter = filter;
+				options.srgb = (flags & 1u) != 0u;
+				options.wrap = (flags & 2u) != 0u;
+				for (const uint* size : constantSizes)
+				{
+					uchar color[4] = { (uchar)random(), (uchar)random(), (uchar)random(), (uchar)random() };
+					std::vector<uchar> constant((size_t)size[0] * size[1] * 4u);
+					for (size_t i = 0u; i < constant.size(); ++i)
+						constant[i] = color[i % 4u];
+
+					std::vector<MipGenerator::Level> levels = MipGenerator::Generate(constant.data(), size[0], size[1], options);
+					constantMatch = constantMatch && levels.size() + 1u == MipGenerator::GetLevelCount(size[0], size[1]);
+					for (const MipGenerator::Level& level : levels)
+					{
+						for (size_t i = 0u; i < level.pixels.size(); ++i)
+							constantMatch = constantMatch && level.pixels[i] == color[i % 4u];
+					}
+				}
+			}
+		}
+		allMatch = allMatch && constantMatch;
+		output << std::format("Mips: constant images stay constant with either filter: {}", constantMatch ? "OK" : "MISMATCH") << std::endl;
+
+		// Splitting rows across threads must not change a byte.
+		const uint threadedSize = 256u;
+		std::vector<uchar> large((size_t)threadedSize * threadedSize * 4u);
+		for (uchar& byte : large)
+			byte = (uchar)random();
+		bool threadMatch = true;
+		for (MipGenerator::Filter filter : { MipGenerator::Filter::Box, MipGenerator::Filter::Kaiser })
+		{
+			MipGenerator::Options threaded;
+			threaded.filter = filter;
+			MipGenerator::Options single = threaded;
+			single.threadCount = 1u;
+			threadMatch = threadMatch && LevelDifference(MipGenerator::Generate(large.data(), threadedSize, threadedSize, threaded),
+				MipGenerator::Generate(large.data(), threadedSize, threadedSize, single)) == 0u;
+		}
+		allMatch = allMatch && threadMatch;
+		output << std::format("Mips: threaded levels match single threaded ones: {}", threadMatch ? "OK" : "MISMATCH") << std::endl;
+
+		return allMatch;
+	}
+}
+
+bool RunTextureCheck(std::ostream& output)
+{
+	namespace fs = std::filesystem;
+
+	bool allMatch = true;
+	std::mt19937 random(RANDOM_SEED);
+	std::error_code error;
+	fs::path directory = fs::temp_directory_path(error) / "texture-check";
+	fs::create_directories(directory, error);
+	fs::path path = directory / "image.tga";
+
+	// Every variant from memory and from a file, then every truncation of it.
+	for (const Variant& variant : VARIANTS)
+	{
+		TestImage image = MakeImage(variant, WIDTH, HEIGHT, 0.5, random);
+		TargaDecoder fromMemory(image.file.data(), image.file.size());
+		bool memoryMatch = DecodeMatches(fromMemory, image);
+		bool fileMatch = DecodesFromFile(path, image);
+
+		bool truncationsRejected = true;
+		for (size_t size = 0u; size < image.file.size(); ++size)
+			truncationsRejected = Rejected(image.file, size, WIDTH, HEIGHT) && truncationsRejected;
+
+		bool match = memoryMatch && fileMatch && truncationsRejected;
+		allMatch = allMatch && match;
+		output << std::format("TGA {}: memory {}, file {}, truncations rejected {}", variant.name, memoryMatch ? "OK" : "MISMATCH",
+			fileMatch ? "OK" : "MISMATCH", truncationsRejected ? "OK" : "MISMATCH") << std::endl;
+	}
+
+	// A solid and a noisy image, so RLE files hold runs and raw packets of the full 128 pixels.
+	for (double repeatChance : { 1.0, 0.0 })
+	{
+		TestImage image = MakeImage(VARIANTS[11], PACKET_WIDTH, PACKET_HEIGHT, repeatChance, random);
+		TargaDecoder fromMemory(image.file.data(), image.file.size());
+		bool memoryMatch = DecodeMatches(fromMemory, image);
+
+		bool truncationsRejected = true;
+		for (size_t size = 0u; size < image.file.size(); ++size)
+			truncationsRejected = Rejected(image.file, size, PACKET_WIDTH, PACKET_HEIGHT) && truncationsRejected;
+
+		bool match = memoryMatch && truncationsRejected;
+		allMatch = allMatch && match;
+		output << std::format("TGA RLE {} packets of 128 pixels: memory {}, truncations rejected {}", repeatChance > 0.5 ? "run" : "raw",
+			memoryMatch ? "OK" : "MISMATCH", truncationsRejected ? "OK" : "MISMATCH") << std::endl;
+	}
+
+	// Images larger than a chunk, so packets and pixels straddle the chunk boundaries of the file reader.
+	for (const Variant& variant : { VARIANTS[1], VARIANTS[4], VARIANTS[11], VARIANTS[12], VARIANTS[14] })
+	{
+		TestImage image = MakeImage(variant, LARGE_WIDTH, LARGE_HEIGHT, 0.75, random);
+		TargaDecoder fromMemory(image.file.data(), image.file.size());
+		bool memoryMatch = DecodeMatches(fromMemory, image);
+		bool fileMatch = DecodesFromFile(path, image);
+
+		const size_t sizes[] = { 17u, 18u, image.file.size() / 2u, TargaDecoder::CHUNK_SIZE - 1u, TargaDecoder::CHUNK_SIZE + 1u, image.file.size() - 1u };
+		bool truncationsRejected = true;
+		for (size_t size : sizes)
+		{
+			// Highly compressed files may be shorter than a chunk.
+			if (size >= image.file.size())
+				continue;
+			truncationsRejected = Rejected(image.file, size, LARGE_WIDTH, LARGE_HEIGHT) && truncationsRejected;
+			truncationsRejected = RejectedFromFile(path, image.file, size, LARGE_WIDTH, LARGE_HEIGHT) && truncationsRejected;
+		}
+
+		bool match = memoryMatch && fileMatch && truncationsRejected;
+		allMatch = allMatch && match;
+		output << std::format("TGA {} {}x{} in {} KB: memory {}, file {}, truncations rejected {}", variant.name, LARGE_WIDTH, LARGE_HEIGHT,
+			image.file.size() / 1024u, memoryMatch ? "OK" : "MISMATCH", fileMatch ? "OK" : "MISMATCH", truncationsRejected ? "OK" : "MISMATCH") << std::endl;
+	}
+
+	bool headersRejected = CheckMalformedHeaders(output, random);
+	allMatch = allMatch && headersRejected;
+	output << std::format("TGA malformed headers rejected: {}", headersRejected ? "OK" : "MISMATCH") << std::endl;
+
+	allMatch = CheckMips(output, random) && allMatch;
+
+	fs::remove_all(directory, error);
+	return allMatch;
+}
@@ -0,0 +1,12 @@
+#pragma once
+
+#include <ostream>
+#include "Common.h"
+
+// Builds TGA files in memory for every layout TargaDecoder reads: uncompressed and RLE, true color at 16, 24 and
+// 32 bits, greyscale and palettized, bottom-up and top-down, left-to-right and right-to-left, and checks the decoded
+// RGBA against the pixels they were written from, both from memory and through the chunked file reader. Checks that
+// every truncation of those files and a set of malformed headers are rejected, and that decoding never writes past
+// the destination. Then checks MipGenerator against a direct sRGB box filter and on constant images.
+// Run with "Engine.exe -check-textures". Returns false if any check fails.
+bool RunTextureCheck(std::ostream& output);
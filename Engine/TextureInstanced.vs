@@ -0,0 +1,42 @@
+#include "ShaderConstants.hlsli"
+
+// TYPEDEFS
+struct VertexInputType
+{
+    float4 position : POSITION;
+    float2 tex : TEXCOORD0;
+
+    // Per-instance data from the instance stream, laid out as InstanceData.
+    float4 world0 : WORLD0;
+    float4 world1 : WORLD1;
+    float4 world2 : WORLD2;
+    float4 world3 : WORLD3;
+    float2 textureOffset : TEXCOORD1;
+};
+
+struct PixelInputType
+{
+    float4 position : SV_POSITION;
+    float2 tex : TEXCOORD0;
+};
+
+// Vertex Shader
+PixelInputType TextureInstancedVertexShader(VertexInputType input)
+{
+	PixelInputType output;
+
+	// Change the position vector to be 4 units for proper matrix calculations.
+	input.position.w = 1.0f;
+
+	// Rebuild the instance's world matrix from its rows.
+	matrix instanceWorldMatrix = matrix(input.world0, input.world1, input.world2, input.world3);
+
+	// Calculate the position of the vertex against the instance's world matrix and the combined view and projection matrix.
+	output.position = mul(input.position, instanceWorldMatrix);
+	output.position = mul(output.position, viewProjectionMatrix);
+
+	// Store the texture coordinates for the pixel shader.
+	output.tex = input.tex + input.textureOffset;
+
+	return output;
+}
\ No newline at end of file
@@ -0,0 +1,121 @@
+#include "TextureStreamer.h"
+#include "Profiler.h"
+
+TextureStreamer::TextureStreamer(ID3D11Device* device, const AssetArchive* archive, size_t uploadBudget)
+	: _device(device)
+	, _archive(archive)
+	, _uploadBudget(uploadBudget)
+{
+}
+
+TextureStreamer::~TextureStreamer()
+{
+	// Requests nobody has started on are dropped; wait for the ones being decoded.
+	_stopping = true;
+	JobSystem::GetDefault().Wait(_decoding);
+
+	// Free what the jobs finished but the render thread never collected.
+	Job* job = _completed.exchange(nullptr, std::memory_order_acquire);
+	while (job)
+	{
+		Job* next = job->next;
+		delete job;
+		job = next;
+	}
+}
+
+std::shared_ptr<Texture> TextureStreamer::Request(const char* filename, Texture::Compression compression)
+{
+	Job* job = new Job();
+	job->texture = std::make_shared<Texture>(_device);
+	job->filename = filename;
+	job->compression = compression;
+	std::shared_ptr<Texture> texture = job->texture;
+
+	// Decoding is long and already spreads mip generation and compression over every core through the job system, so
+	// it runs in the background, where it cannot hold up a frame's parallel work.
+	JobSystem::GetDefault().RunInBackground([this, job] { Decode(job); }, &_decoding);
+
+	_stats.pending++;
+	return texture;
+}
+
+void TextureStreamer::Decode(Job* job)
+{
+	if (_stopping)
+	{
+		delete job;
+		return;
+	}
+
+	// Reading, decoding, mip generation and compression all happen here, off the render thread.
+	PROFILE_SCOPE("TextureStreamer::Decode");
+	job->decoded = Texture::Decode(job->filename.c_str(), job->compression, _archive, _device != nullptr, job->image);
+	PushCompleted(job);
+}
+
+void TextureStreamer::PushCompleted(Job* job)
+{
+	Job* head = _completed.load(std::memory_order_relaxed);
+	do
+	{
+		job->next = head;
+	} while (!_completed.compare_exchange_weak(head, job, std::memory_order_release, std::memory_order_relaxed));
+}
+
+void TextureStreamer::Update()
+{
+	PROFILE_SCOPE("TextureStreamer::Update");
+
+	_stats.uploadedThisFrame = 0u;
+	_stats.uploadedBytesThisFrame = 0u;
+
+	// Take everything the decode jobs have finished. The stack holds the newest job first, so reverse it to keep request order.
+	Job* job = _completed.exchange(nullptr, std::memory_order_acquire);
+	Job* reversed = nullptr;
+	while (job)
+	{
+		Job* next = job->next;
+		job->next = reversed;
+		reversed = job;
+		job = next;
+	}
+	for (job = reversed; job; )
+	{
+		Job* next = job->next;
+		_ready.emplace_back(job);
+		job = next;
+	}
+
+	while (!_ready.empty())
+	{
+		Job& ready = *_ready.front();
+		size_t size = ready.image.byteSize + ready.image.pixels.size();
+		if (_stats.uploadedThisFrame > 0u && _stats.uploadedBytesThisFrame + size > _uploadBudget)
+			break;
+
+		if (ready.decoded && ready.texture->Upload(_device, ready.image))
+		{
+			_stats.uploadedThisFrame++;
+			_stats.uploadedBytesThisFrame += size;
+			_stats.uploadedTotal++;
+		}
+		else
+		{
+			_stats.failedTotal++;
+		}
+
+		_stats.pending--;
+		_ready.pop_front();
+	}
+}
+
+bool TextureStreamer::IsIdle() const
+{
+	return _stats.pending == 0u;
+}
+
+const TextureStreamer::Stats& TextureStreamer::GetStats() const
+{
+	return _stats;
+}
@@ -0,0 +1,79 @@
+#pragma once
+
+#include <d3d11.h>
+#include <atomic>
+#include <deque>
+#include "Common.h"
+#include "Texture.h"
+#include "AssetArchive.h"
+#include "JobSystem.h"
+
+// Loads textures in the background. Request returns a texture straight away that shows a 1x1 placeholder;
+// a background job on the JobSystem reads and decodes the file (including mip generation and block compression),
+// and Update uploads finished images on the render thread within a per-frame byte budget.
+//
+// Decode jobs hand finished textures to the render thread through a lock-free stack, so the render thread never
+// waits on a job holding a lock.
+class TextureStreamer
+{
+public:
+
+	static const size_t DEFAULT_UPLOAD_BUDGET = 4u * 1024u * 1024u;
+
+	struct Stats
+	{
+		uint pending = 0u;					// Requested textures that are not resident yet.
+		uint uploadedThisFrame = 0u;
+		size_t uploadedBytesThisFrame = 0u;
+		uint uploadedTotal = 0u;
+		uint failedTotal = 0u;				// Files that could not be read or decoded; they keep the placeholder.
+	};
+
+	// The archive, when given, must outlive the streamer.
+	TextureStreamer(ID3D11Device* device, const AssetArchive* archive, size_t uploadBudget = DEFAULT_UPLOAD_BUDGET);
+	~TextureStreamer();
+
+	TextureStreamer(const TextureStreamer&) = delete;
+	TextureStreamer& operator=(const TextureStreamer&) = delete;
+
+	// Queues a texture for loading and returns it with the placeholder bound.
+	std::shared_ptr<Texture> Request(const char* filename, Texture::Compression compression = Texture::Compression::None);
+
+	// Uploads finished textures, oldest first, until this frame's budget is spent. At least one texture is uploaded
+	// per call, so an image larger than the budget still arrives. Call once per frame on the render thread.
+	void Update();
+
+	// True when every requested texture has been uploaded or has failed.
+	bool IsIdle() const;
+	const Stats& GetStats() const;
+
+private:
+
+	struct Job
+	{
+		std::shared_ptr<Texture> texture;
+		std::string filename;
+		Texture::Compression compression = Texture::Compression::None;
+		Texture::Image image;
+		bool decoded = false;
+		Job* next = nullptr; // Link in the completion stack.
+	};
+
+	void Decode(Job* job);
+	void PushCompleted(Job* job);
+
+	ID3D11Device* _device = nullptr;
+	const AssetArchive* _archive = nullptr;
+	size_t _uploadBudget = DEFAULT_UPLOAD_BUDGET;
+
+	// Decode jobs still queued or running. Once stopping is set, jobs that have not started drop their request.
+	JobSystem::Counter _decoding;
+	std::atomic<bool> _stopping = false;
+
+	// Decoded jobs pushed by the decode jobs; the render thread takes the whole stack at once.
+	std::atomic<Job*> _completed = nullptr;
+
+	// Render thread only: decoded jobs waiting for upload budget, in request order.
+	std::deque<std::unique_ptr<Job>> _ready;
+	Stats _stats;
+};